@@ -113,7 +113,7 @@ float4 PSMain(PSInput In) : SV_TARGET
 	if (HasDiffuseMap(TEX_CFG) && AlbedoAlpha.a < 0.01f)
 		discard;
 	
-	float3 Normal = texNormals.Sample(AnisoSampler, uv).rgb;
+	float3 Normal = ReconstructPackedNormalZ(texNormals.Sample(AnisoSampler, uv).rgb, HasNormalMapXYOnly(TEX_CFG));
 	const float3 N = normalize(In.vertNormal);
 	const float3 T = normalize(In.vertTangent);
 	float3 SurfaceN = length(Normal) < 0.01 ? N : UnpackNormal(Normal, N, T);
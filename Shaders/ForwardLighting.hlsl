@@ -132,7 +132,7 @@ float4 PSMain(PSInput In) : SV_TARGET
 	const int TEX_CFG = cbPerObject.materialData.textureConfig;
 	
 	float4 AlbedoAlpha = texDiffuse  .Sample(AnisoSampler, uv);
-	float3 Normal      = texNormals  .Sample(AnisoSampler, uv).rgb;
+	float3 Normal      = ReconstructPackedNormalZ(texNormals.Sample(AnisoSampler, uv).rgb, HasNormalMapXYOnly(TEX_CFG));
 	float3 Emissive    = texEmissive .Sample(LinearSampler, uv).rgb;
 	float3 Metalness   = texMetalness.Sample(AnisoSampler, uv).rgb;
 	float3 Roughness   = texRoughness.Sample(AnisoSampler, uv).rgb;
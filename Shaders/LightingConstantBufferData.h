@@ -128,6 +128,7 @@ inline int HasMetallicMap(int textureConfig)                    { return ((textu
 inline int HasHeightMap(int textureConfig)                      { return ((textureConfig & (1 << 6)) > 0 ? 1 : 0); }
 inline int HasEmissiveMap(int textureConfig)                    { return ((textureConfig & (1 << 7)) > 0 ? 1 : 0); }
 inline int HasOcclusionRoughnessMetalnessMap(int textureConfig) { return ((textureConfig & (1 << 8)) > 0 ? 1 : 0); }
+inline int HasNormalMapXYOnly(int textureConfig)                { return ((textureConfig & (1 << 9)) > 0 ? 1 : 0); }
 
 struct MaterialData
 {
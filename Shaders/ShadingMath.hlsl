@@ -41,6 +41,17 @@ inline float3 UnpackNormals(Texture2D normalMap, SamplerState normalSampler, flo
 	return mul(SampledNormal, TBN);
 }
 
+// BC5 compressed normal maps only store XY (B reads 0): reconstruct Z of the packed [0, 1] normal.
+// bXYOnly comes from the material's texture config, other formats are returned as is.
+inline float3 ReconstructPackedNormalZ(float3 SampledNormal, bool bXYOnly)
+{
+	if (!bXYOnly)
+		return SampledNormal;
+	const float2 XY = SampledNormal.rg * 2.0f - 1.0f;
+	const float  Z  = sqrt(saturate(1.0f - dot(XY, XY)));
+	return float3(SampledNormal.rg, Z * 0.5f + 0.5f);
+}
+
 inline float3 UnpackNormal(float3 SampledNormal, float3 worldNormal, float3 worldTangent)
 {
 	SampledNormal = SampledNormal * 2.0f - 1.0f;
@@ -20,6 +20,12 @@
 #include "Scene/Mesh.h"
 #include "Scene/Material.h"
 #include "Scene/Scene.h"
+#include "Core/VirtualFileSystem.h"
+#include "Core/AsyncIO.h"
+#include "Core/MemoryTracking.h"
+#include "Core/ParallelFor.h"
+#include "TextureStreaming.h"
+#include "GPUMarker.h"
 
 #include "../Renderer/Renderer.h"
 
@@ -32,10 +38,14 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/IOSystem.hpp>
+#include <assimp/IOStream.hpp>
 
 using namespace Assimp;
 using namespace DirectX;
 
+#define ENABLE_MATERIAL_TEXTURE_COMPRESSION 1
+
 TaskID AssetLoader::GenerateModelLoadTaskID()
 {
 	static std::atomic<TaskID> LOAD_TASK_ID = 0;
@@ -43,9 +53,11 @@ TaskID AssetLoader::GenerateModelLoadTaskID()
 	return id;
 }
 
-AssetLoader::AssetLoader(ThreadPool& WorkerThreads_Model, ThreadPool& WorkerThreads_Texture, VQRenderer& renderer)
+AssetLoader::AssetLoader(ThreadPool& WorkerThreads_Model, ThreadPool& WorkerThreads_Texture, AsyncIOService& AsyncIO, TextureStreamer& TextureStreamer, VQRenderer& renderer)
 	: mWorkers_ModelLoad(WorkerThreads_Model)
 	, mWorkers_TextureLoad(WorkerThreads_Texture)
+	, mAsyncIO(AsyncIO)
+	, mTextureStreamer(TextureStreamer)
 	, mRenderer(renderer)
 {}
 
@@ -86,17 +98,42 @@ AssetLoader::ModelLoadResults_t AssetLoader::StartLoadingModels(Scene* pScene)
 		{
 			mUniqueModelPaths.insert(ModelPath);
 
-			// check whether Exit signal is given to the app before dispatching workers
-			if (mWorkers_ModelLoad.IsExiting() || mWorkers_TextureLoad.IsExiting())
+			// check whether Exit signal is given to the app (or the load is cancelled) before dispatching workers
+			if (mWorkers_ModelLoad.IsExiting() || mWorkers_TextureLoad.IsExiting() || mbLoadsCancelled)
 			{
 				break;
 			}
 
-			// start loading the model
-			modelLoadResult = std::move(mWorkers_ModelLoad.AddTask([=]()
+			// start reading the model file, import it on a worker once the contents are in memory.
+			// Models are read ahead of the textures as importing them is what queues the texture loads.
+			std::shared_ptr<std::promise<ModelID>> pModelLoadPromise = std::make_shared<std::promise<ModelID>>();
+			modelLoadResult = pModelLoadPromise->get_future().share();
+			auto fnSetModelLoadResult = [this, pModelLoadPromise](ModelID id)
+			{
+				pModelLoadPromise->set_value(id);
+				mLoadProgress.NumModelsLoaded.fetch_add(1);
+			};
+			mLoadProgress.NumModels.fetch_add(1);
+			mAsyncIO.Read(ModelPath, EAsyncIOPriority::HIGH, [=](FAsyncReadResult&& ModelFile)
 			{
-				return ModelLoadParams.pfnImportModel(pScene, this, pRenderer, ModelLoadParams.ModelPath, ModelLoadParams.ModelName);
-			}));
+				if (ModelFile.bCancelled || mWorkers_ModelLoad.IsExiting() || mbLoadsCancelled)
+				{
+					fnSetModelLoadResult(INVALID_ID);
+					return;
+				}
+				mLoadProgress.ModelBytes.fetch_add(ModelFile.Data.Size);
+				mWorkers_ModelLoad.AddTask([=, ModelFile = std::move(ModelFile)]()
+				{
+					SCOPED_CPU_MARKER("LoadWorker_Model");
+					if (mbLoadsCancelled)
+					{
+						fnSetModelLoadResult(INVALID_ID);
+						return;
+					}
+					const FFileData* pModelFile = ModelFile.Data.IsValid() ? &ModelFile.Data : nullptr;
+					fnSetModelLoadResult(ModelLoadParams.pfnImportModel(pScene, this, pRenderer, ModelLoadParams.ModelPath, ModelLoadParams.ModelName, pModelFile));
+				});
+			});
 			ModelLoadResultMap[ModelLoadParams.ModelPath] = modelLoadResult;
 		}
 		else
@@ -112,6 +149,29 @@ AssetLoader::ModelLoadResults_t AssetLoader::StartLoadingModels(Scene* pScene)
 	return ModelLoadResults;
 }
 
+void AssetLoader::CancelLoads()
+{
+	mbLoadsCancelled = true;
+
+	// drop the loads that haven't been dispatched yet
+	std::unique_lock<std::mutex> lk(mMtxQueue_ModelLoad);
+	mModelLoadQueue = std::queue<FModelLoadParams>();
+	mUniqueModelPaths.clear();
+}
+
+void AssetLoader::ResetLoadProgress()
+{
+	mLoadProgress.NumModels = 0;
+	mLoadProgress.NumModelsLoaded = 0;
+	mLoadProgress.NumTextures = 0;
+	mLoadProgress.NumTexturesLoaded = 0;
+	mLoadProgress.ModelBytes = 0;
+	mLoadProgress.TextureBytes = 0;
+	mLoadProgress.NumMaterials = 0;
+	mLoadProgress.NumMaterialsAssigned = 0;
+	mbLoadsCancelled = false;
+}
+
 //----------------------------------------------------------------------------------------------------------------
 // TEXTURE LOADER
 //----------------------------------------------------------------------------------------------------------------
@@ -186,6 +246,33 @@ static AssetLoader::ECustomMapType DetermineCustomMapType(const std::string& Fil
 	return t;
 }
 
+static ETextureCompression GetTextureCompression(AssetLoader::ETextureType Type)
+{
+#if ENABLE_MATERIAL_TEXTURE_COMPRESSION
+	switch (Type)
+	{
+	case AssetLoader::DIFFUSE           : return ETextureCompression::BC1_BC3; // BC3 if there's alpha
+	case AssetLoader::NORMALS           : return ETextureCompression::BC5;
+	case AssetLoader::EMISSIVE          :
+	case AssetLoader::SPECULAR          : return ETextureCompression::BC1;
+	case AssetLoader::CUSTOM_MAP        : return ETextureCompression::BC1;     // occlusion/roughness/metalness
+	case AssetLoader::ALPHA_MASK        :
+	case AssetLoader::HEIGHT            :
+	case AssetLoader::METALNESS         :
+	case AssetLoader::ROUGHNESS         :
+	case AssetLoader::AMBIENT_OCCLUSION : return ETextureCompression::BC4;
+	default: break;
+	}
+#endif
+	return ETextureCompression::NONE;
+}
+
+// albedo & emissive are sRGB encoded (the shaders linearize them), their mips are filtered in linear space
+static bool IsSRGBTexture(AssetLoader::ETextureType Type)
+{
+	return Type == AssetLoader::DIFFUSE || Type == AssetLoader::EMISSIVE;
+}
+
 AssetLoader::TextureLoadResults_t AssetLoader::StartLoadingTextures(TaskID taskID)
 {
 	TextureLoadResults_t TextureLoadResults;
@@ -197,7 +284,7 @@ AssetLoader::TextureLoadResults_t AssetLoader::StartLoadingTextures(TaskID taskI
 		return TextureLoadResults;
 	}
 	
-	std::unordered_map<std::string, std::shared_future<TextureID>> Lookup_TextureLoadResult;
+	std::unordered_map<std::string, std::shared_ptr<TextureLoadPromise_t>> Lookup_TextureLoadResult;
 
 	// process model load queue
 	do
@@ -219,30 +306,33 @@ AssetLoader::TextureLoadResults_t AssetLoader::StartLoadingTextures(TaskID taskI
 				? VQRenderer::GetProceduralTextureEnumFromName(vPathTokens[1])
 				: EProceduralTextures::NUM_PROCEDURAL_TEXTURES;
 
-			// check whether Exit signal is given to the app before dispatching workers
-			if (mWorkers_TextureLoad.IsExiting())
+			// check whether Exit signal is given to the app (or the load is cancelled) before dispatching workers
+			if (mWorkers_TextureLoad.IsExiting() || mbLoadsCancelled)
 			{
 				break;
 			}
 
-			// dispatch worker thread
-			std::shared_future<TextureID> texLoadResult = std::move(mWorkers_TextureLoad.AddTask([this, TexLoadParams, ProcTex]()
+			// dispatch the file read, the texture is created on a worker thread once the contents are in memory
+			std::shared_ptr<TextureLoadPromise_t> pTexLoadResult = std::make_shared<TextureLoadPromise_t>();
+			mLoadProgress.NumTextures.fetch_add(1);
+			if (bProceduralTexture)
 			{
-				constexpr bool GENERATE_MIPS = true;
-				const bool IS_PROCEDURAL = ProcTex != EProceduralTextures::NUM_PROCEDURAL_TEXTURES;
-				if (IS_PROCEDURAL)
+				mWorkers_TextureLoad.AddTask([this, ProcTex, pTexLoadResult]() 
 				{
-					return mRenderer.GetProceduralTexture(ProcTex);
-				}
-
-				return mRenderer.CreateTextureFromFile(TexLoadParams.TexturePath.c_str(), GENERATE_MIPS);
-			}));
+					pTexLoadResult->SetValue(mRenderer.GetTextureResidencyHandle(mRenderer.GetProceduralTexture(ProcTex)));
+					mLoadProgress.NumTexturesLoaded.fetch_add(1);
+				});
+			}
+			else
+			{
+				LoadTextureAsync(TexLoadParams, pTexLoadResult);
+			}
 
 			// update results lookup for the shared textures (among different materials)
-			Lookup_TextureLoadResult[TexLoadParams.TexturePath] = texLoadResult;
+			Lookup_TextureLoadResult[TexLoadParams.TexturePath] = pTexLoadResult;
 
 			// record load results
-			TextureLoadResults.emplace(std::make_pair(TexLoadParams.MatID, FTextureLoadResult{ TexLoadParams.TexType, TexLoadParams.TexturePath, std::move(texLoadResult) }));
+			TextureLoadResults.emplace(std::make_pair(TexLoadParams.MatID, FTextureLoadResult{ TexLoadParams.TexType, TexLoadParams.TexturePath, std::move(pTexLoadResult) }));
 		}
 		// shared textures among materials
 		else
@@ -253,7 +343,7 @@ AssetLoader::TextureLoadResults_t AssetLoader::StartLoadingTextures(TaskID taskI
 
 	ctx.UniquePaths.clear();
 
-	// Currently mRenderer.CreateTextureFromFile() starts the texture uploads
+	// Currently mRenderer.CreateTextureFromFileAsync() starts the texture uploads
 	///mRenderer.StartTextureUploads();
 
 	mLookup_TextureLoadContext.erase(taskID);
@@ -261,6 +351,90 @@ AssetLoader::TextureLoadResults_t AssetLoader::StartLoadingTextures(TaskID taskI
 	return std::move(TextureLoadResults);
 }
 
+void AssetLoader::LoadTextureAsync(const FTextureLoadParams& TexLoadParams, const std::shared_ptr<TextureLoadPromise_t>& pTexLoadPromise)
+{
+	constexpr bool GENERATE_MIPS = true;
+	const std::string         TexturePath = TexLoadParams.TexturePath;
+	const ETextureCompression Compression = GetTextureCompression(TexLoadParams.TexType);
+	const bool                bSRGB       = IsSRGBTexture(TexLoadParams.TexType);
+
+	// don't wait for residency here: free the worker to decode the next image while the upload thread
+	// copies this one. DoAssignments() continues on the residency of the material's textures.
+	auto fnSetTextureLoadResult = [this, pTexLoadPromise](const FTextureResidencyHandle& Texture)
+	{
+		pTexLoadPromise->SetValue(Texture);
+		mLoadProgress.NumTexturesLoaded.fetch_add(1);
+	};
+	auto fnCreateTextureFromFile = [this, TexturePath, Compression, bSRGB, fnSetTextureLoadResult](uint64 SourceHash)
+	{
+		SCOPED_CPU_MARKER("LoadWorker_TextureFromFile");
+		fnSetTextureLoadResult(mbLoadsCancelled 
+			? FTextureResidencyHandle::Failed()
+			: mRenderer.CreateTextureFromFileAsync(TexturePath.c_str(), GENERATE_MIPS, Compression, bSRGB, SourceHash)
+		);
+	};
+	auto fnIsCancelled = [this, fnSetTextureLoadResult](const FAsyncReadResult& Result)
+	{
+		const bool bCancelled = Result.bCancelled || mWorkers_TextureLoad.IsExiting() || mbLoadsCancelled;
+		if (bCancelled)
+			fnSetTextureLoadResult(FTextureResidencyHandle::Failed());
+		else
+			mLoadProgress.TextureBytes.fetch_add(Result.Data.Size);
+		return bCancelled;
+	};
+
+	// uncompressed textures are decoded from the file by the renderer
+	if (Compression == ETextureCompression::NONE)
+	{
+		mWorkers_TextureLoad.AddTask([fnCreateTextureFromFile]() { fnCreateTextureFromFile(0); });
+		return;
+	}
+
+	// Cooked textures take two reads: the source file for the content hash that keys the texture cache,
+	// then the cached DDS file which is uploaded straight from the read buffer. A cache miss (or a failed
+	// read) falls back to CreateTextureFromFileAsync() which decodes & cooks the texture, reusing the hash
+	// computed here. The decode still reads the file itself: Image can only decode from a file path.
+	// The texture streamer uploads only the mip tail of the large textures, the rest is streamed on demand.
+	mAsyncIO.Read(TexturePath, EAsyncIOPriority::NORMAL, [=](FAsyncReadResult&& SourceFile)
+	{
+		if (fnIsCancelled(SourceFile))
+			return;
+		mWorkers_TextureLoad.AddTask([=, SourceFile = std::move(SourceFile)]()
+		{
+			SCOPED_CPU_MARKER("LoadWorker_TextureCacheLookup");
+			if (!SourceFile.Data.IsValid())
+			{
+				fnCreateTextureFromFile(0); // logs the error
+				return;
+			}
+
+			const uint64 SourceHash = TextureCache::HashMemory(SourceFile.Data.pData, SourceFile.Data.Size);
+			const std::string CachedTexturePath = TextureCache::GetCachedTexturePath(VQRenderer::TextureCacheDirectory, TexturePath, SourceHash, Compression, GENERATE_MIPS, bSRGB);
+			if (!DirectoryUtil::FileExists(CachedTexturePath))
+			{
+				fnCreateTextureFromFile(SourceHash);
+				return;
+			}
+
+			mAsyncIO.Read(CachedTexturePath, EAsyncIOPriority::NORMAL, [=](FAsyncReadResult&& CachedFile)
+			{
+				if (fnIsCancelled(CachedFile))
+					return;
+				mWorkers_TextureLoad.AddTask([=, CachedFile = std::move(CachedFile)]()
+				{
+					SCOPED_CPU_MARKER("LoadWorker_CookedTexture");
+					std::shared_ptr<FCookedTexture> pCookedTexture = std::make_shared<FCookedTexture>();
+					if (!TextureCache::LoadCookedTexture(CachedFile.Data.pData, CachedFile.Data.Size, CachedFile.Data.pOwner, CachedTexturePath, *pCookedTexture))
+					{
+						fnCreateTextureFromFile(SourceHash);
+						return;
+					}
+					fnSetTextureLoadResult(mTextureStreamer.CreateTexture(DirectoryUtil::GetFileNameFromPath(TexturePath), CachedTexturePath, pCookedTexture));
+				});
+			});
+		});
+	});
+}
 
 static AssetLoader::ETextureType GetTextureType(aiTextureType aiType)
 {
@@ -306,116 +480,153 @@ static AssetLoader::ETextureType GetTextureType(aiTextureType aiType)
 	return AssetLoader::ETextureType::NUM_TEXTURE_TYPES;
 }
 
-void AssetLoader::FMaterialTextureAssignments::DoAssignments(Scene* pScene, VQRenderer* pRenderer)
+// returns the component mapping of the occlusion/roughness/metalness map
+static UINT AssignMaterialTexture(Material& mat, AssetLoader::ETextureType Type, const std::string& TexturePath, TextureID texID, VQRenderer* pRenderer, UINT OcclRoughMtlMap_ComponentMapping)
 {
-	for (FMaterialTextureAssignment& assignment : mAssignments)
+	switch (Type)
 	{
-		Material& mat = pScene->GetMaterial(assignment.matID);
-
-		bool bFound = mTextureLoadResults.find(assignment.matID) != mTextureLoadResults.end();
-		if (!bFound)
+	case AssetLoader::DIFFUSE           : mat.TexDiffuseMap   = texID; break;
+	case AssetLoader::NORMALS           :
+		mat.TexNormalMap     = texID;
+		mat.bNormalMapXYOnly = mat.TexNormalMap != INVALID_ID && pRenderer->GetTextureFormat(mat.TexNormalMap) == DXGI_FORMAT_BC5_UNORM;
+		break;
+	case AssetLoader::ALPHA_MASK        : mat.TexAlphaMaskMap = texID; break;
+	case AssetLoader::EMISSIVE          : mat.TexEmissiveMap  = texID; break;
+	case AssetLoader::METALNESS         : mat.TexMetallicMap  = texID; break;
+	case AssetLoader::ROUGHNESS         : mat.TexRoughnessMap = texID; break;
+	case AssetLoader::SPECULAR          : assert(false); /*mat.TexSpecularMap  = texID;*/ break;
+	case AssetLoader::HEIGHT            : mat.TexHeightMap    = texID; break;
+	case AssetLoader::AMBIENT_OCCLUSION : mat.TexAmbientOcclusionMap = texID; break;
+	case AssetLoader::CUSTOM_MAP        :
+	{
+		const AssetLoader::ECustomMapType customMapType = DetermineCustomMapType(TexturePath);
+		switch (customMapType)
 		{
-			Log::Error("TextureLoadResutls for MatID=%d not found!", assignment.matID);
-			continue;
+		case AssetLoader::OCCLUSION_ROUGHNESS_METALNESS:
+			OcclRoughMtlMap_ComponentMapping; // leave as is
+			mat.TexOcclusionRoughnessMetalnessMap = texID;
+			break;
+		case AssetLoader::METALNESS_ROUGHNESS:
+			// turns out: even the file is named in reverse order, the common thing to do is to store
+			//            roughness in G and metalness in B channels. Hence we're not handling this case 
+			//            here.
+#if 0 
+			OcclRoughMtlMap_ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(
+				  D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1
+				, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2
+				, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1
+				, D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0
+			);
+			mat.TexOcclusionRoughnessMetalnessMap = texID;
+			break;
+#endif
+		case AssetLoader::ROUGHNESS_METALNESS:
+			OcclRoughMtlMap_ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(
+				D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1
+				, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1
+				, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2
+				, D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0
+			);
+			mat.TexOcclusionRoughnessMetalnessMap = texID;
+			break;
+		default:
+		case AssetLoader::UNKNOWN:
+			Log::Warning("Unknown custom map (%s) type for material MatID=%d!", TexturePath.c_str(), mat.ID);
+			DetermineCustomMapType(TexturePath);
+			break;
 		}
+	} break;
+	default:
+		Log::Warning("TODO");
+		break;
+	}
+	return OcclRoughMtlMap_ComponentMapping;
+}
+
+void AssetLoader::FMaterialTextureAssignments::DoAssignments(Scene* pScene, VQRenderer* pRenderer, AssetLoader* pAssetLoader)
+{
+	// the textures of a material, the continuation of the last one to be uploaded assigns them all
+	struct FMaterialTextures
+	{
+		MaterialID                      matID = INVALID_ID;
+		std::vector<FTextureLoadResult> Results;
+		std::vector<TextureID>          TexIDs; // INVALID_ID if the texture couldn't be loaded or uploaded
+		std::atomic<uint>               NumPending = 0;
+	};
+	const ThreadPool* pWorkerThreads   = &mWorkersThreads;
+	FLoadProgress*    pLoadProgress    = &pAssetLoader->mLoadProgress;
+	TextureStreamer*  pTextureStreamer = &pAssetLoader->mTextureStreamer;
+
+	// runs on the thread that completes the last texture of the material: a texture worker or the upload thread
+	auto fnAssignMaterialTextures = [pScene, pRenderer, pWorkerThreads, pLoadProgress, pTextureStreamer](const FMaterialTextures& Textures)
+	{
+		if (!pWorkerThreads->IsExiting()) // the scene may be gone
+		{
+			Material& mat = pScene->GetMaterial(Textures.matID);
+			UINT OcclRoughMtlMap_ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			for (size_t i = 0; i < Textures.Results.size(); ++i)
+			{
+				const FTextureLoadResult& result = Textures.Results[i];
+				OcclRoughMtlMap_ComponentMapping = AssignMaterialTexture(mat, result.type, result.TexturePath, Textures.TexIDs[i], pRenderer, OcclRoughMtlMap_ComponentMapping);
+			}
 
-		UINT OcclRoughMtlMap_ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			InitializeMaterialSRVs(pRenderer, mat, mat.SRVMaterialMaps, OcclRoughMtlMap_ComponentMapping);
+			if (pTextureStreamer)
+				pTextureStreamer->RegisterMaterial(mat, OcclRoughMtlMap_ComponentMapping);
+		}
+		pLoadProgress->NumMaterialsAssigned.fetch_add(1);
+	};
 
+	for (FMaterialTextureAssignment& assignment : mAssignments)
+	{
 		auto pair_itBeginEnd = mTextureLoadResults.equal_range(assignment.matID);
-		for (auto it = pair_itBeginEnd.first; it != pair_itBeginEnd.second; ++it)
+		if (pair_itBeginEnd.first == pair_itBeginEnd.second)
 		{
-			const MaterialID& matID = it->first;
-			FTextureLoadResult& result = it->second;
-			
-			if (mWorkersThreads.IsExiting())
-				break;
+			Log::Error("TextureLoadResutls for MatID=%d not found!", assignment.matID);
+			continue;
+		}
 
-			assert(result.texLoadResult.valid());
+		std::shared_ptr<FMaterialTextures> pTextures = std::make_shared<FMaterialTextures>();
+		pTextures->matID = assignment.matID;
+		for (auto it = pair_itBeginEnd.first; it != pair_itBeginEnd.second; ++it)
+			pTextures->Results.push_back(it->second);
+		pTextures->TexIDs.resize(pTextures->Results.size(), INVALID_ID);
+		pTextures->NumPending = static_cast<uint>(pTextures->Results.size());
+		pLoadProgress->NumMaterials.fetch_add(1);
 
-			result.texLoadResult.wait();
-			switch (result.type)
-			{
-			case DIFFUSE           : mat.TexDiffuseMap   = result.texLoadResult.get(); break;
-			case NORMALS           : mat.TexNormalMap    = result.texLoadResult.get(); break;
-			case ALPHA_MASK        : mat.TexAlphaMaskMap = result.texLoadResult.get(); break;
-			case EMISSIVE          : mat.TexEmissiveMap  = result.texLoadResult.get(); break;
-			case METALNESS         : mat.TexMetallicMap  = result.texLoadResult.get(); break;
-			case ROUGHNESS         : mat.TexRoughnessMap = result.texLoadResult.get(); break;
-			case SPECULAR          : assert(false); /*mat.TexSpecularMap  = result.texLoadResult.get();*/ break;
-			case HEIGHT            : mat.TexHeightMap    = result.texLoadResult.get(); break;
-			case AMBIENT_OCCLUSION : mat.TexAmbientOcclusionMap = result.texLoadResult.get(); break;
-			case CUSTOM_MAP        :
+		// continue on the texture ID, then on its residency: the shaders shouldn't sample a texture that's being copied into
+		for (size_t i = 0; i < pTextures->Results.size(); ++i)
+		{
+			assert(pTextures->Results[i].pTexLoadResult);
+			pTextures->Results[i].pTexLoadResult->Then([pTextures, i, fnAssignMaterialTextures](const FTextureResidencyHandle& Texture)
 			{
-				const ECustomMapType customMapType = DetermineCustomMapType(result.TexturePath);
-				switch (customMapType)
+				Texture.OnUploadDone([pTextures, i, fnAssignMaterialTextures, texID = Texture.ID](bool bResident)
 				{
-				case OCCLUSION_ROUGHNESS_METALNESS:
-					OcclRoughMtlMap_ComponentMapping; // leave as is
-					mat.TexOcclusionRoughnessMetalnessMap = result.texLoadResult.get();
-					break;
-				case METALNESS_ROUGHNESS:
-					// turns out: even the file is named in reverse order, the common thing to do is to store
-					//            roughness in G and metalness in B channels. Hence we're not handling this case 
-					//            here.
-#if 0 
-					OcclRoughMtlMap_ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(
-						  D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1
-						, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2
-						, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1
-						, D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0
-					);
-					mat.TexOcclusionRoughnessMetalnessMap = result.texLoadResult.get();
-					break;
-#endif
-				case ROUGHNESS_METALNESS:
-					OcclRoughMtlMap_ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(
-						D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1
-						, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1
-						, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2
-						, D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0
-					);
-					mat.TexOcclusionRoughnessMetalnessMap = result.texLoadResult.get();
-					break;
-				default:
-				case UNKNOWN:
-					Log::Warning("Unknown custom map (%s) type for material MatID=%d!", result.TexturePath.c_str(), assignment.matID);
-					DetermineCustomMapType(result.TexturePath);
-					break;
-				}
-			} break;
-			default:
-				Log::Warning("TODO");
-				break;
-			}
+					if (bResident)
+						pTextures->TexIDs[i] = texID;
+					else if (texID != INVALID_ID)
+						Log::Warning("Texture upload failed, not assigning it to MatID=%d: %s", pTextures->matID, pTextures->Results[i].TexturePath.c_str());
+
+					if (pTextures->NumPending.fetch_sub(1) == 1)
+						fnAssignMaterialTextures(*pTextures);
+				});
+			});
 		}
-
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::ALBEDO, mat.TexDiffuseMap);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::NORMALS, mat.TexNormalMap);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::EMISSIVE, mat.TexEmissiveMap);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::ALPHA_MASK, mat.TexAlphaMaskMap);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::METALLIC, mat.TexMetallicMap);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::ROUGHNESS, mat.TexRoughnessMap);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::OCCLUSION_ROUGHNESS_METALNESS, mat.TexOcclusionRoughnessMetalnessMap, OcclRoughMtlMap_ComponentMapping);
-		pRenderer->InitializeSRV(mat.SRVMaterialMaps, EMaterialTextureMapBindings::AMBIENT_OCCLUSION, mat.TexAmbientOcclusionMap);
 	}
 }
 
-void AssetLoader::FMaterialTextureAssignments::WaitForTextureLoads()
+void AssetLoader::InitializeMaterialSRVs(VQRenderer* pRenderer, const Material& mat, SRV_ID srvID, uint OcclRoughMtlMapComponentMapping)
 {
-	for (auto it = mTextureLoadResults.begin(); it != mTextureLoadResults.end(); ++it)
-	{
-		const MaterialID& matID = it->first;
-		const FTextureLoadResult& result = it->second;
-		assert(result.texLoadResult.valid());
-
-		if (mWorkersThreads.IsExiting())
-			break;
-
-		result.texLoadResult.wait();
-	}
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::ALBEDO, mat.TexDiffuseMap);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::NORMALS, mat.TexNormalMap);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::EMISSIVE, mat.TexEmissiveMap);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::ALPHA_MASK, mat.TexAlphaMaskMap);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::METALLIC, mat.TexMetallicMap);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::ROUGHNESS, mat.TexRoughnessMap);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::OCCLUSION_ROUGHNESS_METALNESS, mat.TexOcclusionRoughnessMetalnessMap, OcclRoughMtlMapComponentMapping);
+	pRenderer->InitializeSRV(srvID, EMaterialTextureMapBindings::AMBIENT_OCCLUSION, mat.TexAmbientOcclusionMap);
 }
 
-
 //----------------------------------------------------------------------------------------------------------------
 // ASSIMP HELPER FUNCTIONS
 //----------------------------------------------------------------------------------------------------------------
@@ -442,15 +653,14 @@ static std::vector<AssetLoader::FTextureLoadParams> GenerateTextureLoadParams(
 	return TexLoadParams;
 }
 
-static Mesh ProcessAssimpMesh(
-	VQRenderer*          pRenderer
-	, aiMesh*            pMesh
-	, const aiScene*     pScene
-	, const std::string& ModelName
+static void ConvertAssimpMesh(
+	  const aiMesh*                             pMesh
+	, std::vector<FVertexWithNormalAndTangent>& Vertices
+	, std::vector<unsigned>&                    Indices
 )
 {
-	std::vector<FVertexWithNormalAndTangent> Vertices;
-	std::vector<unsigned> Indices;
+	Vertices.reserve(pMesh->mNumVertices);
+	Indices.reserve(size_t(pMesh->mNumFaces) * 3); // triangulated
 
 	// Walk through each of the mesh's vertices
 	for (unsigned int i = 0; i < pMesh->mNumVertices; i++)
@@ -496,177 +706,221 @@ static Mesh ProcessAssimpMesh(
 	// now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
 	for (unsigned int i = 0; i < pMesh->mNumFaces; i++)
 	{
-		aiFace face = pMesh->mFaces[i];
+		const aiFace& face = pMesh->mFaces[i];
 		// retrieve all indices of the face and store them in the indices vector
 		for (unsigned int j = 0; j < face.mNumIndices; j++)
 			Indices.push_back(face.mIndices[j]);
 	}
-
-	return Mesh(pRenderer, Vertices, Indices, ModelName);;
 }
 
-static Model::Data ProcessAssimpNode(
-	const std::string& ModelName,
-	aiNode* const      pNode,
+static MaterialID ProcessAssimpMaterial(
 	const aiScene*     pAiScene,
+	unsigned           iMaterial,
 	const std::string& modelDirectory,
 	AssetLoader*       pAssetLoader,
 	Scene*             pScene,
-	VQRenderer*        pRenderer,
 	AssetLoader::FMaterialTextureAssignments& MaterialTextureAssignments,
 	TaskID                                    taskID
 )
 {
-	Model::Data modelData;
+	// MATERIAL - http://assimp.sourceforge.net/lib_html/materials.html
+	aiMaterial* material = pAiScene->mMaterials[iMaterial];
 
-	for (unsigned int i = 0; i < pNode->mNumMeshes; i++)
-	{	// process all the node's meshes (if any)
-		aiMesh* pAiMesh = pAiScene->mMeshes[pNode->mMeshes[i]];
-
-		// MATERIAL - http://assimp.sourceforge.net/lib_html/materials.html
-		aiMaterial* material = pAiScene->mMaterials[pAiMesh->mMaterialIndex];
-
-		// Every material assumed to have a name 
-		std::string uniqueMatName;
+	// Every material assumed to have a name 
+	std::string uniqueMatName;
+	{
+		aiString matName;
+		if (aiReturn_SUCCESS != material->Get(AI_MATKEY_NAME, matName))
+		// material doesn't have a name, use generic name Material#
 		{
-			aiString matName;
-			if (aiReturn_SUCCESS != material->Get(AI_MATKEY_NAME, matName))
-			// material doesn't have a name, use generic name Material#
-			{
-				matName = std::string("Material#") + std::to_string(pAiMesh->mMaterialIndex);
-			}
-
-			// Data/Models/%MODEL_NAME%/... : index 2 will give model name
-			auto vFolders = DirectoryUtil::GetFlattenedFolderHierarchy(modelDirectory);
-			assert(vFolders.size() > 2);
-			const std::string ModelFolderName = vFolders[2];
-			uniqueMatName = matName.C_Str();
-			// modelDirectory = "Data/Models/%MODEL_NAME%/"
-			// Materials use the following unique naming: %MODEL_NAME%/%MATERIAL_NAME%
-			uniqueMatName = ModelFolderName + "/" + uniqueMatName;
+			matName = std::string("Material#") + std::to_string(iMaterial);
 		}
 
-		// Create new Material
-		MaterialID matID = pScene->CreateMaterial(uniqueMatName);
-		Material& mat = pScene->GetMaterial(matID);
-
-		// get texture paths to load
-		AssetLoader::FMaterialTextureAssignment MatTexAssignment = {};
-		std::vector<AssetLoader::FTextureLoadParams> diffuseMaps  = GenerateTextureLoadParams(material, matID, aiTextureType_DIFFUSE , modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> specularMaps = GenerateTextureLoadParams(material, matID, aiTextureType_SPECULAR, modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> normalMaps   = GenerateTextureLoadParams(material, matID, aiTextureType_NORMALS , modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> heightMaps   = GenerateTextureLoadParams(material, matID, aiTextureType_HEIGHT  , modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> alphaMaps    = GenerateTextureLoadParams(material, matID, aiTextureType_OPACITY , modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> emissiveMaps = GenerateTextureLoadParams(material, matID, aiTextureType_EMISSIVE, modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> occlRoughMetlMaps = GenerateTextureLoadParams(material, matID, aiTextureType_UNKNOWN, modelDirectory);
-		std::vector<AssetLoader::FTextureLoadParams> aoMaps = GenerateTextureLoadParams(material, matID, aiTextureType_AMBIENT_OCCLUSION, modelDirectory);
-		
-		// queue texture load
-		std::array<decltype(diffuseMaps)*, 8> TexLoadParams = { &diffuseMaps, &specularMaps, &normalMaps, &heightMaps, &alphaMaps, &emissiveMaps, &occlRoughMetlMaps, &aoMaps };
-		int iTexType = 0;
-		for (const auto* pvLoadParams : TexLoadParams)
+		// Data/Models/%MODEL_NAME%/... : index 2 will give model name
+		auto vFolders = DirectoryUtil::GetFlattenedFolderHierarchy(modelDirectory);
+		assert(vFolders.size() > 2);
+		const std::string ModelFolderName = vFolders[2];
+		uniqueMatName = matName.C_Str();
+		// modelDirectory = "Data/Models/%MODEL_NAME%/"
+		// Materials use the following unique naming: %MODEL_NAME%/%MATERIAL_NAME%
+		uniqueMatName = ModelFolderName + "/" + uniqueMatName;
+	}
+
+	// Create new Material
+	MaterialID matID = pScene->CreateMaterial(uniqueMatName);
+	Material& mat = pScene->GetMaterial(matID);
+
+	// get texture paths to load
+	AssetLoader::FMaterialTextureAssignment MatTexAssignment = {};
+	std::vector<AssetLoader::FTextureLoadParams> diffuseMaps  = GenerateTextureLoadParams(material, matID, aiTextureType_DIFFUSE , modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> specularMaps = GenerateTextureLoadParams(material, matID, aiTextureType_SPECULAR, modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> normalMaps   = GenerateTextureLoadParams(material, matID, aiTextureType_NORMALS , modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> heightMaps   = GenerateTextureLoadParams(material, matID, aiTextureType_HEIGHT  , modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> alphaMaps    = GenerateTextureLoadParams(material, matID, aiTextureType_OPACITY , modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> emissiveMaps = GenerateTextureLoadParams(material, matID, aiTextureType_EMISSIVE, modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> occlRoughMetlMaps = GenerateTextureLoadParams(material, matID, aiTextureType_UNKNOWN, modelDirectory);
+	std::vector<AssetLoader::FTextureLoadParams> aoMaps = GenerateTextureLoadParams(material, matID, aiTextureType_AMBIENT_OCCLUSION, modelDirectory);
+	
+	// queue texture load
+	std::array<decltype(diffuseMaps)*, 8> TexLoadParams = { &diffuseMaps, &specularMaps, &normalMaps, &heightMaps, &alphaMaps, &emissiveMaps, &occlRoughMetlMaps, &aoMaps };
+	for (const auto* pvLoadParams : TexLoadParams)
+	{
+		for (const AssetLoader::FTextureLoadParams& param : *pvLoadParams)
 		{
-			int iTex = 0;
-			for (const AssetLoader::FTextureLoadParams& param : *pvLoadParams)
-			{
-				pAssetLoader->QueueTextureLoad(taskID, param);
-				++iTex;
-			}
-			++iTexType;
+			pAssetLoader->QueueTextureLoad(taskID, param);
 		}
+	}
 
 
-		// unflatten the material texture assignments
-		MatTexAssignment.matID = matID;
-		MaterialTextureAssignments.mAssignments.push_back(std::move(MatTexAssignment));
+	// unflatten the material texture assignments
+	MatTexAssignment.matID = matID;
+	MaterialTextureAssignments.mAssignments.push_back(std::move(MatTexAssignment));
 
-		aiColor3D color(0.f, 0.f, 0.f);
-		if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_DIFFUSE, color))
-		{
-			mat.diffuse = XMFLOAT3(color.r, color.g, color.b);
-		}
+	aiColor3D color(0.f, 0.f, 0.f);
+	if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_DIFFUSE, color))
+	{
+		mat.diffuse = XMFLOAT3(color.r, color.g, color.b);
+	}
 
-		aiColor3D specular(0.f, 0.f, 0.f);
-		if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_SPECULAR, specular))
-		{
-			mat.specular = XMFLOAT3(specular.r, specular.g, specular.b);
-		}
+	aiColor3D specular(0.f, 0.f, 0.f);
+	if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_SPECULAR, specular))
+	{
+		mat.specular = XMFLOAT3(specular.r, specular.g, specular.b);
+	}
 
-		aiColor3D transparent(0.0f, 0.0f, 0.0f);
-		if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_TRANSPARENT, transparent))
-		{	// Defines the transparent color of the material, this is the color to be multiplied 
-			// with the color of translucent light to construct the final 'destination color' 
-			// for a particular position in the screen buffer. T
-			//
-			int a = 5;
-		}
+	aiColor3D transparent(0.0f, 0.0f, 0.0f);
+	if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_TRANSPARENT, transparent))
+	{	// Defines the transparent color of the material, this is the color to be multiplied 
+		// with the color of translucent light to construct the final 'destination color' 
+		// for a particular position in the screen buffer. T
+		//
+		int a = 5;
+	}
 
-		float opacity = 0.0f;
-		if (aiReturn_SUCCESS == material->Get(AI_MATKEY_OPACITY, opacity))
-		{
-			mat.alpha = opacity;
-		}
+	float opacity = 0.0f;
+	if (aiReturn_SUCCESS == material->Get(AI_MATKEY_OPACITY, opacity))
+	{
+		mat.alpha = opacity;
+	}
 
-		float shininess = 0.0f;
-		if (aiReturn_SUCCESS == material->Get(AI_MATKEY_SHININESS, shininess))
-		{
-			// Phong Shininess -> Beckmann BRDF Roughness conversion
-			//
-			// https://simonstechblog.blogspot.com/2011/12/microfacet-brdf.html
-			// https://computergraphics.stackexchange.com/questions/1515/what-is-the-accepted-method-of-converting-shininess-to-roughness-and-vice-versa
-			//
-			mat.roughness = sqrtf(2.0f / (2.0f + shininess));
-		}
+	float shininess = 0.0f;
+	if (aiReturn_SUCCESS == material->Get(AI_MATKEY_SHININESS, shininess))
+	{
+		// Phong Shininess -> Beckmann BRDF Roughness conversion
+		//
+		// https://simonstechblog.blogspot.com/2011/12/microfacet-brdf.html
+		// https://computergraphics.stackexchange.com/questions/1515/what-is-the-accepted-method-of-converting-shininess-to-roughness-and-vice-versa
+		//
+		mat.roughness = sqrtf(2.0f / (2.0f + shininess));
+	}
 
-		aiColor3D emissiveIntensity(0.0f, 0.0f, 0.0f);
-		if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_EMISSIVE, emissiveIntensity))
-		{
-			mat.emissiveIntensity = emissiveIntensity.r;
-		}
+	aiColor3D emissiveIntensity(0.0f, 0.0f, 0.0f);
+	if (aiReturn_SUCCESS == material->Get(AI_MATKEY_COLOR_EMISSIVE, emissiveIntensity))
+	{
+		mat.emissiveIntensity = emissiveIntensity.r;
+	}
 
-		// other material keys to consider
-		//
-		// AI_MATKEY_TWOSIDED
-		// AI_MATKEY_ENABLE_WIREFRAME
-		// AI_MATKEY_BLEND_FUNC
-		// AI_MATKEY_BUMPSCALING
-		
-		Mesh mesh = ProcessAssimpMesh(pRenderer, pAiMesh, pAiScene, ModelName);
-		MeshID id = pScene->AddMesh(std::move(mesh));
-		modelData.mOpaueMeshIDs.push_back(id);
-		
-		modelData.mOpaqueMaterials[modelData.mOpaueMeshIDs.back()] = matID;
-		if (mat.IsTransparent())
-		{
-			modelData.mTransparentMeshIDs.push_back(modelData.mOpaueMeshIDs.back());
-		}
-	} // for: NumMeshes
+	// other material keys to consider
+	//
+	// AI_MATKEY_TWOSIDED
+	// AI_MATKEY_ENABLE_WIREFRAME
+	// AI_MATKEY_BLEND_FUNC
+	// AI_MATKEY_BUMPSCALING
 
+	return matID;
+}
+
+// Flattens the aiNode tree into the mesh order of a depth-first traversal (node's meshes, then its children).
+// MeshIDs and MaterialIDs are assigned in this order, which keeps them deterministic regardless of the
+// number of threads converting the meshes.
+static void GatherAssimpNodeMeshes(const aiNode* pNode, std::vector<unsigned>& OutMeshIndices)
+{
+	for (unsigned int i = 0; i < pNode->mNumMeshes; i++)
+		OutMeshIndices.push_back(pNode->mMeshes[i]);
 	for (unsigned int i = 0; i < pNode->mNumChildren; i++)
-	{	// then do the same for each of its children
-		Model::Data childModelData = ProcessAssimpNode(ModelName, pNode->mChildren[i], pAiScene, modelDirectory, pAssetLoader, pScene, pRenderer, MaterialTextureAssignments, taskID);
-		std::vector<MeshID>& ChildMeshes = childModelData.mOpaueMeshIDs;
-		std::vector<MeshID>& ChildMeshesTransparent = childModelData.mTransparentMeshIDs;
-
-		std::copy(ChildMeshes.begin(), ChildMeshes.end(), std::back_inserter(modelData.mOpaueMeshIDs));
-		std::copy(ChildMeshesTransparent.begin(), ChildMeshesTransparent.end(), std::back_inserter(modelData.mTransparentMeshIDs));
-		for (auto& kvp : childModelData.mOpaqueMaterials)
+		GatherAssimpNodeMeshes(pNode->mChildren[i], OutMeshIndices);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------
+// ASSIMP VFS ADAPTER
+//----------------------------------------------------------------------------------------------------------------
+// Read-only Assimp file IO through the VirtualFileSystem: packed model files (and the files they
+// reference, e.g. .mtl) are read from the mapped pak file, the rest falls back to the loose files.
+class FAssimpIOStream_VFS : public IOStream
+{
+public:
+	FAssimpIOStream_VFS(FFileData&& Data) : mData(std::move(Data)) {}
+
+	size_t Read(void* pvBuffer, size_t pSize, size_t pCount) override
+	{
+		if (pSize == 0) return 0;
+		const size_t Count = std::min(pCount, (mData.Size - mPosition) / pSize);
+		memcpy(pvBuffer, mData.pData + mPosition, Count * pSize);
+		mPosition += Count * pSize;
+		return Count;
+	}
+	size_t Write(const void* pvBuffer, size_t pSize, size_t pCount) override { return 0; }
+	aiReturn Seek(size_t pOffset, aiOrigin pOrigin) override
+	{
+		size_t NewPosition = 0;
+		switch (pOrigin)
 		{
-#if _DEBUG
-			assert(modelData.mOpaqueMaterials.find(kvp.first) == modelData.mOpaqueMaterials.end());
-#endif
-			modelData.mOpaqueMaterials[kvp.first] = kvp.second;
+		case aiOrigin_SET: NewPosition = pOffset; break;
+		case aiOrigin_CUR: NewPosition = mPosition + pOffset; break;
+		case aiOrigin_END: NewPosition = mData.Size - pOffset; break; // offset counts back from the end
+		default: return aiReturn_FAILURE;
 		}
-	} // for: NumChildren
+		if (NewPosition > mData.Size)
+			return aiReturn_FAILURE;
+		mPosition = NewPosition;
+		return aiReturn_SUCCESS;
+	}
+	size_t Tell() const override { return mPosition; }
+	size_t FileSize() const override { return mData.Size; }
+	void Flush() override {}
 
-	return modelData;
-}
+private:
+	FFileData mData;
+	size_t    mPosition = 0;
+};
+
+// The model file itself can be handed over already read (AsyncIOService).
+class FAssimpIOSystem_VFS : public IOSystem
+{
+public:
+	FAssimpIOSystem_VFS(const std::string& ModelFilePath, const FFileData* pModelFile)
+		: mModelFilePath(pModelFile ? VirtualFileSystem::NormalizePath(ModelFilePath) : "")
+		, mModelFile(pModelFile ? *pModelFile : FFileData{})
+	{}
+
+	bool Exists(const char* pFile) const override { return IsModelFile(pFile) || VirtualFileSystem::FileExists(pFile); }
+	char getOsSeparator() const override { return '/'; }
+	IOStream* Open(const char* pFile, const char* pMode = "rb") override
+	{
+		if (strchr(pMode, 'w') || strchr(pMode, 'a')) // read-only
+			return nullptr;
+		FFileData Data = IsModelFile(pFile) ? mModelFile : VirtualFileSystem::ReadFile(pFile);
+		return Data.IsValid() ? new FAssimpIOStream_VFS(std::move(Data)) : nullptr;
+	}
+	void Close(IOStream* pFile) override { delete pFile; }
+	bool ComparePaths(const char* one, const char* second) const override
+	{
+		return VirtualFileSystem::NormalizePath(one) == VirtualFileSystem::NormalizePath(second);
+	}
+
+private:
+	bool IsModelFile(const char* pFile) const { return mModelFile.IsValid() && VirtualFileSystem::NormalizePath(pFile) == mModelFilePath; }
+
+	std::string mModelFilePath;
+	FFileData   mModelFile; // shares the read buffer
+};
 
 
 //----------------------------------------------------------------------------------------------------------------
 // IMPORT MODEL FUNCTION FOR WORKER THREADS
 //----------------------------------------------------------------------------------------------------------------
-ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName)
+ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName, const FFileData* pModelFile)
 {
 	constexpr auto ASSIMP_LOAD_FLAGS
 		= aiProcess_Triangulate
@@ -690,6 +944,10 @@ ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRen
 
 	// Import Assimp Scene
 	Importer importer;
+	if (pModelFile || VirtualFileSystem::IsAnyPakFileMounted())
+	{
+		importer.SetIOHandler(new FAssimpIOSystem_VFS(objFilePath, pModelFile)); // owned by the importer
+	}
 	const aiScene* pAiScene = importer.ReadFile(objFilePath, ASSIMP_LOAD_FLAGS);
 	if (!pAiScene || pAiScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !pAiScene->mRootNode)
 	{
@@ -699,30 +957,81 @@ ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRen
 	t.Tick(); float fTimeReadFile = t.DeltaTime();
 	Log::Info("   [%.2fs] ReadFile=%s ", fTimeReadFile, objFilePath.c_str());
 
-	// parse scene and initialize model data
-	FMaterialTextureAssignments MaterialTextureAssignments(pAssetLoader->mWorkers_TextureLoad);
-	Model::Data data = ProcessAssimpNode(ModelName, pAiScene->mRootNode, pAiScene, modelDirectory, pAssetLoader, pScene, pRenderer, MaterialTextureAssignments, taskID);
+	// flatten the node tree
+	std::vector<unsigned> MeshIndices;
+	GatherAssimpNodeMeshes(pAiScene->mRootNode, MeshIndices);
+	const uint NumMeshes = static_cast<uint>(MeshIndices.size());
 
-	pRenderer->UploadVertexAndIndexBufferHeaps(); // load VB/IBs
+	// material setup: serial as it creates Scene materials & queues the texture loads, once per assimp material
+	FMaterialTextureAssignments MaterialTextureAssignments(pAssetLoader->mWorkers_TextureLoad);
+	std::vector<MaterialID> MeshMaterialIDs(NumMeshes, INVALID_ID);
+	std::unordered_map<unsigned, MaterialID> LookupMaterialIDs; // aiMaterial index -> MaterialID
+	for (uint iMesh = 0; iMesh < NumMeshes; ++iMesh)
+	{
+		const unsigned iMaterial = pAiScene->mMeshes[MeshIndices[iMesh]]->mMaterialIndex;
+		auto it = LookupMaterialIDs.find(iMaterial);
+		if (it == LookupMaterialIDs.end())
+		{
+			it = LookupMaterialIDs.emplace(iMaterial, ProcessAssimpMaterial(pAiScene, iMaterial, modelDirectory, pAssetLoader, pScene, MaterialTextureAssignments, taskID)).first;
+		}
+		MeshMaterialIDs[iMesh] = it->second;
+	}
+	t.Tick(); const float fTimeMaterialSetup = t.DeltaTime();
 
+	// start decoding textures while the meshes are being converted
 	if (!MaterialTextureAssignments.mAssignments.empty())
 		MaterialTextureAssignments.mTextureLoadResults = pAssetLoader->StartLoadingTextures(taskID);
 
+	// mesh conversion: parallel over the meshes, the model loading thread works on the meshes too
+	struct FMeshData
+	{
+		std::vector<FVertexWithNormalAndTangent> Vertices;
+		std::vector<unsigned> Indices;
+		inline size_t GetSizeInBytes() const { return Vertices.capacity() * sizeof(FVertexWithNormalAndTangent) + Indices.capacity() * sizeof(unsigned); }
+	};
+	std::vector<FMeshData> MeshData(NumMeshes);
+	ParallelFor(NumMeshes, 1, &pAssetLoader->mWorkers_ModelLoad, [&](uint MeshBegin, uint MeshEnd)
+	{
+		for (uint iMesh = MeshBegin; iMesh < MeshEnd; ++iMesh)
+		{
+			ConvertAssimpMesh(pAiScene->mMeshes[MeshIndices[iMesh]], MeshData[iMesh].Vertices, MeshData[iMesh].Indices);
+			MemoryTracking::OnAlloc(EMemoryTag::MODEL_IMPORT, MeshData[iMesh].GetSizeInBytes());
+		}
+	});
+	t.Tick(); const float fTimeMeshConversion = t.DeltaTime();
+
+	// create the meshes in the flattened order for deterministic MeshIDs & buffer placement in the VB/IB heaps
+	Model::Data data;
+	for (uint iMesh = 0; iMesh < NumMeshes; ++iMesh)
+	{
+		const MaterialID matID = MeshMaterialIDs[iMesh];
+		MeshID id = pScene->AddMesh(Mesh(pRenderer, MeshData[iMesh].Vertices, MeshData[iMesh].Indices, ModelName));
+		MemoryTracking::OnFree(EMemoryTag::MODEL_IMPORT, MeshData[iMesh].GetSizeInBytes());
+		MeshData[iMesh] = FMeshData(); // release the CPU copy
+		
+		data.mOpaueMeshIDs.push_back(id);
+		data.mOpaqueMaterials[id] = matID;
+		if (pScene->GetMaterial(matID).IsTransparent())
+		{
+			data.mTransparentMeshIDs.push_back(id);
+		}
+	}
+
+	pRenderer->UploadVertexAndIndexBufferHeaps(); // load VB/IBs
+
 	// cache the imported model in Scene
 	ModelID mID = pScene->CreateModel();
 	Model& model = pScene->GetModel(mID);
 	model = Model(objFilePath, ModelName, std::move(data));
 
-	// SYNC POINT : wait for textures to load
-	{
-		MaterialTextureAssignments.WaitForTextureLoads();
-	}
-
-	// assign TextureIDs to the materials;
-	MaterialTextureAssignments.DoAssignments(pScene, pRenderer);
+	// assign TextureIDs to the materials once they're uploaded, the worker doesn't wait for the textures
+	MaterialTextureAssignments.DoAssignments(pScene, pRenderer, pAssetLoader);
 
-	t.Stop();
-	Log::Info("   [%.2fs] Loaded Model '%s'.", fTimeReadFile + t.DeltaTime(), ModelName.c_str());
+	t.Stop(); const float fTimeUpload = t.DeltaTime();
+	Log::Info("   [%.2fs] Loaded Model '%s' (%u meshes, %zu materials): ReadFile=%.2fs MaterialSetup=%.2fs MeshConversion=%.2fs Upload=%.2fs"
+		, fTimeReadFile + fTimeMaterialSetup + fTimeMeshConversion + fTimeUpload, ModelName.c_str(), NumMeshes, LookupMaterialIDs.size()
+		, fTimeReadFile, fTimeMaterialSetup, fTimeMeshConversion, fTimeUpload
+	);
 	return mID;
 }
 
@@ -18,15 +18,21 @@
 #pragma once
 
 #include "Scene/Model.h"
+#include "../Renderer/TextureResidency.h"
 
 #include <set>
 #include <queue>
 #include <mutex>
 #include <future>
+#include <atomic>
 
 class ThreadPool;
+class AsyncIOService;
+class TextureStreamer;
 class Scene;
 class GameObject;
+struct Material;
+struct FFileData;
 
 class AssetLoader
 {
@@ -70,11 +76,12 @@ public:
 		MaterialID   MatID;
 		std::string  TexturePath;
 	};
+	using TextureLoadPromise_t = Promise<FTextureResidencyHandle>; // fulfilled once the texture is created (ID=INVALID_ID if the load failed), the upload may be in flight
 	struct FTextureLoadResult
 	{
 		ETextureType   type; // material textures: diffuse/normal/alpha_mask/...
 		std::string TexturePath;
-		std::shared_future<TextureID> texLoadResult;
+		std::shared_ptr<TextureLoadPromise_t> pTexLoadResult;
 	};
 	using TextureLoadResults_t = std::unordered_multimap<MaterialID, FTextureLoadResult>;
 
@@ -83,7 +90,7 @@ public:
 	//
 	struct FModelLoadParams
 	{
-		using pfnImportModel_t = ModelID(*)(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName);
+		using pfnImportModel_t = ModelID(*)(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName, const FFileData* pModelFile);
 
 		GameObject* pObject = nullptr;
 		std::string      ModelPath;
@@ -93,6 +100,21 @@ public:
 	using ModelLoadResult_t    = std::shared_future<ModelID>;
 	using ModelLoadResults_t   = std::unordered_map<GameObject*, ModelLoadResult_t>;
 
+	//
+	// LOAD PROGRESS
+	//
+	struct FLoadProgress // counts the loads dispatched since ResetLoadProgress()
+	{
+		std::atomic<uint>   NumModels         = 0;
+		std::atomic<uint>   NumModelsLoaded   = 0; // incl. the failed & cancelled ones
+		std::atomic<uint>   NumTextures       = 0;
+		std::atomic<uint>   NumTexturesLoaded = 0; // incl. the failed & cancelled ones
+		std::atomic<uint64> ModelBytes        = 0; // file bytes read through AsyncIOService
+		std::atomic<uint64> TextureBytes      = 0; // file bytes read through AsyncIOService
+		std::atomic<uint>   NumMaterials         = 0; // materials w/ texture assignments
+		std::atomic<uint>   NumMaterialsAssigned = 0; // their textures are uploaded & SRVs initialized
+	};
+
 	struct FMaterialTextureAssignment
 	{
 		MaterialID matID = INVALID_ID;
@@ -100,8 +122,10 @@ public:
 	struct FMaterialTextureAssignments
 	{
 		FMaterialTextureAssignments(const ThreadPool& workers) : mWorkersThreads(workers) {}
-		void DoAssignments(Scene* pScene, VQRenderer* pRenderer);
-		void WaitForTextureLoads();
+
+		// Doesn't wait on the textures: each material is assigned its textures & its SRVs are initialized once they're
+		// uploaded, on the thread that completes the last one. FLoadProgress::NumMaterialsAssigned tracks the completion.
+		void DoAssignments(Scene* pScene, VQRenderer* pRenderer, AssetLoader* pAssetLoader);
 
 		const ThreadPool&                       mWorkersThreads; // to check if pool IsExiting()
 		std::vector<FMaterialTextureAssignment> mAssignments;
@@ -111,7 +135,10 @@ public:
 	//
 	// CLASS INTERFACE
 	// 
-	AssetLoader(ThreadPool& WorkerThreads_Model, ThreadPool& WorkerThreads_Texture, VQRenderer& renderer);
+	AssetLoader(ThreadPool& WorkerThreads_Model, ThreadPool& WorkerThreads_Texture, AsyncIOService& AsyncIO, TextureStreamer& TextureStreamer, VQRenderer& renderer);
+
+	// writes the material's textures into the NUM_MATERIAL_TEXTURE_MAP_BINDINGS descriptors of srvID
+	static void InitializeMaterialSRVs(VQRenderer* pRenderer, const Material& mat, SRV_ID srvID, uint OcclRoughMtlMapComponentMapping);
 
 	inline const ThreadPool& GetThreadPool_TextureLoad() const { return mWorkers_TextureLoad; }
 
@@ -122,8 +149,18 @@ public:
 	ModelLoadResults_t   StartLoadingModels(Scene* pScene);
 	TextureLoadResults_t StartLoadingTextures(TaskID taskID);
 
+	// Cancels the scene load: the queued & in-flight loads complete w/ INVALID_ID as soon as they reach
+	// a cancellation point (file read, worker task start). ResetLoadProgress() clears the cancellation.
+	void                 CancelLoads();
+	void                 ResetLoadProgress();
+	inline bool          IsLoadCancelled() const { return mbLoadsCancelled; }
+	inline const FLoadProgress& GetLoadProgress() const { return mLoadProgress; }
+
 private:
-	static ModelID ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName = "NONE");
+	// pModelFile: contents of objFilePath if it's already read, the files it references are read through the VirtualFileSystem
+	static ModelID ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName = "NONE", const FFileData* pModelFile = nullptr);
+
+	void LoadTextureAsync(const FTextureLoadParams& TexLoadParams, const std::shared_ptr<TextureLoadPromise_t>& pTexLoadPromise);
 
 	//
 	// DATA
@@ -131,6 +168,8 @@ private:
 private:
 	ThreadPool& mWorkers_ModelLoad;
 	ThreadPool& mWorkers_TextureLoad;
+	AsyncIOService& mAsyncIO;
+	TextureStreamer& mTextureStreamer;
 	VQRenderer& mRenderer;
 
 	template<class T> struct FLoadTaskContext
@@ -146,4 +185,7 @@ private:
 	std::mutex                   mMtxQueue_ModelLoad;
 
 	std::unordered_map<std::string, ModelID> mLoadedModels;
+
+	FLoadProgress                mLoadProgress;
+	std::atomic<bool>            mbLoadsCancelled = false;
 };
\ No newline at end of file
@@ -0,0 +1,373 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#define NOMINMAX
+
+#include "BenchmarkRunner.h"
+#include "Scene/Camera.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace DirectX;
+
+static float GetShortestArc(float From, float To)
+{
+	float Arc = std::fmod(To - From, XM_2PI);
+	if (Arc >  XM_PI) Arc -= XM_2PI;
+	if (Arc < -XM_PI) Arc += XM_2PI;
+	return Arc;
+}
+
+static float MsBetween(uint64 BeginNs, uint64 EndNs) { return static_cast<float>(EndNs - BeginNs) * 1e-6f; }
+
+//----------------------------------------------------------------------------------------------------------------
+// CAMERA PATH
+//----------------------------------------------------------------------------------------------------------------
+FCameraPath FCameraPath::FromSceneCameras(const Scene& Scene)
+{
+	FCameraPath Path;
+	for (size_t i = 0; i < Scene.GetNumSceneCameras(); ++i)
+	{
+		const Camera& Cam = Scene.GetCamera(i);
+		Path.Keys.push_back({ Cam.GetPositionF(), Cam.GetYaw(), Cam.GetPitch() });
+	}
+
+	if (Path.Keys.size() == 1)
+	{
+		const FKey Key = Path.Keys.front();
+		Path.Keys.clear();
+		for (int i = 0; i < 4; ++i)
+			Path.Keys.push_back({ Key.Position, Key.Yaw + i * XM_PIDIV2, Key.Pitch });
+	}
+	return Path;
+}
+
+FCameraPath::FKey FCameraPath::Evaluate(float t) const
+{
+	assert(!Keys.empty());
+	const int NumKeys = static_cast<int>(Keys.size());
+
+	// segment i1 -> i2, i0 & i3 are the neighbors on the closed loop
+	const float Segment = (t - std::floor(t)) * NumKeys;
+	const int   i1 = std::min(static_cast<int>(Segment), NumKeys - 1);
+	const int   i0 = (i1 + NumKeys - 1) % NumKeys;
+	const int   i2 = (i1 + 1) % NumKeys;
+	const int   i3 = (i1 + 2) % NumKeys;
+	const float s  = Segment - i1;
+
+	FKey Key;
+	XMStoreFloat3(&Key.Position, XMVectorCatmullRom(
+		  XMLoadFloat3(&Keys[i0].Position)
+		, XMLoadFloat3(&Keys[i1].Position)
+		, XMLoadFloat3(&Keys[i2].Position)
+		, XMLoadFloat3(&Keys[i3].Position)
+		, s
+	));
+	Key.Yaw   = Keys[i1].Yaw   + GetShortestArc(Keys[i1].Yaw, Keys[i2].Yaw) * s;
+	Key.Pitch = Keys[i1].Pitch + (Keys[i2].Pitch - Keys[i1].Pitch) * s;
+	return Key;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARK RUNNER
+//----------------------------------------------------------------------------------------------------------------
+void BenchmarkRunner::Initialize(const FBenchmarkSettings& Settings, const std::vector<std::string>& AvailableLevels)
+{
+	assert(Settings.NumFrames > 0 && Settings.FixedTimestep > 0.0f);
+	mSettings = Settings;
+	mLevels.clear();
+	mNextLevel = 0;
+
+	const std::vector<std::string>& Levels = Settings.Levels.empty() ? AvailableLevels : Settings.Levels;
+	for (const std::string& LevelName : Levels)
+	{
+		if (std::find(AvailableLevels.begin(), AvailableLevels.end(), LevelName) == AvailableLevels.end())
+		{
+			Log::Error("[Benchmark] Skipping unknown level: %s", LevelName.c_str());
+			continue;
+		}
+		FLevel Level;
+		Level.Name = LevelName;
+		Level.Frames.resize(Settings.NumFrames);
+		mLevels.push_back(std::move(Level));
+	}
+
+	if (mLevels.empty())
+	{
+		Log::Error("[Benchmark] No levels to run");
+		return;
+	}
+	Log::Info("[Benchmark] %d levels, %u warmup + %u measured frames each, fixed timestep %.2fms"
+		, static_cast<int>(mLevels.size()), Settings.NumWarmupFrames, Settings.NumFrames, Settings.FixedTimestep * 1000.0f);
+}
+
+void BenchmarkRunner::BeginLevel(const Scene& Scene, uint64 UpdateLoop)
+{
+	assert(!IsLevelRunning() && mNextLevel < static_cast<int>(mLevels.size()));
+	FLevel& Level = mLevels[mNextLevel];
+	Level.FirstMeasuredLoop = UpdateLoop + mSettings.NumWarmupFrames;
+	Level.Path = FCameraPath::FromSceneCameras(Scene);
+	mNumRenderFramesRecorded.store(0, std::memory_order_relaxed);
+
+	// the render thread picks the level up w/ the frame snapshot of this update loop
+	mActiveLevel.store(mNextLevel, std::memory_order_release);
+	Log::Info("[Benchmark] Level %s: %d cameras", Level.Name.c_str(), static_cast<int>(Scene.GetNumSceneCameras()));
+}
+
+void BenchmarkRunner::UpdateCamera(Camera& Cam, uint64 UpdateLoop) const
+{
+	const int iLevel = mActiveLevel.load(std::memory_order_relaxed);
+	if (iLevel == INVALID_LEVEL || mLevels[iLevel].Path.Keys.empty())
+		return;
+
+	// the measured frames go around the path once, the warmup frames lead into its start
+	const FLevel& Level = mLevels[iLevel];
+	const int64 Frame = static_cast<int64>(UpdateLoop) - static_cast<int64>(Level.FirstMeasuredLoop);
+	const FCameraPath::FKey Key = Level.Path.Evaluate(static_cast<float>(Frame) / mSettings.NumFrames);
+
+	Cam.SetPosition(Key.Position);
+	Cam.Rotate(Key.Yaw - Cam.GetYaw(), Key.Pitch - Cam.GetPitch());
+	Cam.UpdateViewMatrix();
+}
+
+bool BenchmarkRunner::TryEndLevel(uint64 UpdateLoop)
+{
+	const int iLevel = mActiveLevel.load(std::memory_order_relaxed);
+	assert(iLevel != INVALID_LEVEL);
+	const FLevel& Level = mLevels[iLevel];
+
+	const bool bUpdateFramesDone = UpdateLoop >= Level.FirstMeasuredLoop + mSettings.NumFrames;
+	const bool bRenderFramesDone = mNumRenderFramesRecorded.load(std::memory_order_acquire) >= mSettings.NumFrames;
+	if (!bUpdateFramesDone || !bRenderFramesDone)
+		return false;
+
+	mActiveLevel.store(INVALID_LEVEL, std::memory_order_relaxed);
+	++mNextLevel;
+	LogLevelSummary(Level);
+	return true;
+}
+
+const std::string* BenchmarkRunner::GetNextLevel() const
+{
+	return mNextLevel < static_cast<int>(mLevels.size()) ? &mLevels[mNextLevel].Name : nullptr;
+}
+
+void BenchmarkRunner::Finish()
+{
+	WriteJSONReport(mSettings.ReportPath + ".json");
+	WriteCSVReport(mSettings.ReportPath + ".csv");
+	mbFinished.store(true, std::memory_order_release);
+}
+
+FBenchmarkFrame* BenchmarkRunner::GetFrame(uint64 LoopIndex)
+{
+	const int iLevel = mActiveLevel.load(std::memory_order_acquire);
+	if (iLevel == INVALID_LEVEL)
+		return nullptr;
+
+	FLevel& Level = mLevels[iLevel];
+	if (LoopIndex < Level.FirstMeasuredLoop || LoopIndex >= Level.FirstMeasuredLoop + mSettings.NumFrames)
+		return nullptr;
+	return &Level.Frames[LoopIndex - Level.FirstMeasuredLoop];
+}
+
+void BenchmarkRunner::RecordRenderFrame(uint64 RenderLoop, uint64 PreRenderBeginNs, uint64 RenderFrameBeginNs, uint64 RenderFrameEndNs)
+{
+	const uint64 LastRenderFrameBeginNs = mLastRenderFrameBeginNs;
+	mLastRenderFrameBeginNs = PreRenderBeginNs;
+
+	FBenchmarkFrame* pFrame = GetFrame(RenderLoop);
+	if (!pFrame)
+		return;
+
+	pFrame->PreRenderMs  = MsBetween(PreRenderBeginNs, RenderFrameBeginNs);
+	pFrame->RenderCmdsMs = MsBetween(RenderFrameBeginNs, RenderFrameEndNs);
+	pFrame->FrameMs      = LastRenderFrameBeginNs == 0 ? 0.0f : MsBetween(LastRenderFrameBeginNs, PreRenderBeginNs);
+	mNumRenderFramesRecorded.fetch_add(1, std::memory_order_release);
+}
+
+float BenchmarkRunner::GetPercentile(std::vector<float>& Values, float Percentile)
+{
+	if (Values.empty())
+		return 0.0f;
+	std::sort(Values.begin(), Values.end());
+	const size_t Rank = static_cast<size_t>(std::ceil(Percentile / 100.0f * Values.size()));
+	return Values[std::min(std::max<size_t>(Rank, 1), Values.size()) - 1];
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// REPORTS
+//----------------------------------------------------------------------------------------------------------------
+struct FBenchmarkMetric
+{
+	const char* pName;
+	float FBenchmarkFrame::* pTiming;
+};
+static const FBenchmarkMetric BENCHMARK_METRICS[] =
+{
+	  { "UpdateMs"    , &FBenchmarkFrame::UpdateMs     }
+	, { "CullingMs"   , &FBenchmarkFrame::CullingMs    }
+	, { "PreRenderMs" , &FBenchmarkFrame::PreRenderMs  }
+	, { "RenderCmdsMs", &FBenchmarkFrame::RenderCmdsMs }
+	, { "FrameMs"     , &FBenchmarkFrame::FrameMs      }
+};
+
+struct FBenchmarkMetricSummary
+{
+	float Min, Avg, P50, P95, P99, Max;
+};
+static FBenchmarkMetricSummary Summarize(const std::vector<FBenchmarkFrame>& Frames, float FBenchmarkFrame::* pTiming)
+{
+	std::vector<float> Values;
+	Values.reserve(Frames.size());
+	double Sum = 0.0;
+	for (const FBenchmarkFrame& Frame : Frames)
+	{
+		Values.push_back(Frame.*pTiming);
+		Sum += Frame.*pTiming;
+	}
+
+	FBenchmarkMetricSummary s = {};
+	if (Values.empty())
+		return s;
+	s.P50 = BenchmarkRunner::GetPercentile(Values, 50.0f); // sorts
+	s.P95 = BenchmarkRunner::GetPercentile(Values, 95.0f);
+	s.P99 = BenchmarkRunner::GetPercentile(Values, 99.0f);
+	s.Min = Values.front();
+	s.Max = Values.back();
+	s.Avg = static_cast<float>(Sum / Values.size());
+	return s;
+}
+
+void BenchmarkRunner::LogLevelSummary(const FLevel& Level) const
+{
+	Log::Info("[Benchmark] Level %s: %u frames", Level.Name.c_str(), mSettings.NumFrames);
+	for (const FBenchmarkMetric& Metric : BENCHMARK_METRICS)
+	{
+		const FBenchmarkMetricSummary s = Summarize(Level.Frames, Metric.pTiming);
+		Log::Info("[Benchmark]   %-12s : avg %.3f | p50 %.3f | p95 %.3f | p99 %.3f | max %.3f", Metric.pName, s.Avg, s.P50, s.P95, s.P99, s.Max);
+	}
+}
+
+bool BenchmarkRunner::WriteJSONReport(const std::string& FilePath) const
+{
+	std::error_code ec;
+	const std::filesystem::path Directory = std::filesystem::path(FilePath).parent_path();
+	if (!Directory.empty())
+		std::filesystem::create_directories(Directory, ec);
+
+	std::ofstream File(FilePath, std::ios::out | std::ios::trunc);
+	if (!File.is_open())
+	{
+		Log::Error("[Benchmark] Cannot write the report: %s", FilePath.c_str());
+		return false;
+	}
+
+	File << "{\n";
+	File << "\"NumWarmupFrames\":" << mSettings.NumWarmupFrames << ",\n";
+	File << "\"NumFrames\":" << mSettings.NumFrames << ",\n";
+	File << "\"FixedTimestepMs\":" << mSettings.FixedTimestep * 1000.0f << ",\n";
+	File << "\"Levels\":[\n";
+	for (size_t iLevel = 0; iLevel < mLevels.size(); ++iLevel)
+	{
+		const FLevel& Level = mLevels[iLevel];
+		File << "{\"Name\":\"" << Level.Name << "\",\n";
+
+		File << " \"Timings\":{\n";
+		for (size_t iMetric = 0; iMetric < std::size(BENCHMARK_METRICS); ++iMetric)
+		{
+			const FBenchmarkMetric& Metric = BENCHMARK_METRICS[iMetric];
+			const FBenchmarkMetricSummary s = Summarize(Level.Frames, Metric.pTiming);
+			File << "  \"" << Metric.pName << "\":{"
+				<< "\"Min\":" << s.Min << ",\"Avg\":" << s.Avg << ",\"P50\":" << s.P50
+				<< ",\"P95\":" << s.P95 << ",\"P99\":" << s.P99 << ",\"Max\":" << s.Max << "}"
+				<< (iMetric + 1 < std::size(BENCHMARK_METRICS) ? ",\n" : "\n");
+		}
+		File << " },\n";
+
+		// render command counts vary w/ the camera, the rest is per scene
+		double SumMeshRenderCommands = 0.0, SumShadowMeshRenderCommands = 0.0, SumBoundingBoxRenderCommands = 0.0;
+		for (const FBenchmarkFrame& Frame : Level.Frames)
+		{
+			SumMeshRenderCommands        += Frame.Stats.NumMeshRenderCommands;
+			SumShadowMeshRenderCommands  += Frame.Stats.NumShadowMeshRenderCommands;
+			SumBoundingBoxRenderCommands += Frame.Stats.NumBoundingBoxRenderCommands;
+		}
+		const double NumFrames = static_cast<double>(Level.Frames.size());
+		const FSceneStats& Stats = Level.Frames.back().Stats;
+		File << " \"Stats\":{"
+			<< "\"AvgMeshRenderCommands\":" << SumMeshRenderCommands / NumFrames
+			<< ",\"AvgShadowMeshRenderCommands\":" << SumShadowMeshRenderCommands / NumFrames
+			<< ",\"AvgBoundingBoxRenderCommands\":" << SumBoundingBoxRenderCommands / NumFrames
+			<< ",\"NumMeshes\":" << Stats.NumMeshes
+			<< ",\"NumModels\":" << Stats.NumModels
+			<< ",\"NumMaterials\":" << Stats.NumMaterials
+			<< ",\"NumObjects\":" << Stats.NumObjects
+			<< ",\"NumCameras\":" << Stats.NumCameras
+			<< ",\"NumSpotLights\":" << Stats.NumSpotLights
+			<< ",\"NumPointLights\":" << Stats.NumPointLights
+			<< ",\"NumDirectionalLights\":" << Stats.NumDirectionalLights
+			<< ",\"NumShadowingSpotLights\":" << Stats.NumShadowingSpotLights
+			<< ",\"NumShadowingPointLights\":" << Stats.NumShadowingPointLights
+			<< "}\n";
+		File << "}" << (iLevel + 1 < mLevels.size() ? ",\n" : "\n");
+	}
+	File << "]\n}\n";
+
+	Log::Info("[Benchmark] Report written: %s", FilePath.c_str());
+	return true;
+}
+
+bool BenchmarkRunner::WriteCSVReport(const std::string& FilePath) const
+{
+	std::ofstream File(FilePath, std::ios::out | std::ios::trunc);
+	if (!File.is_open())
+	{
+		Log::Error("[Benchmark] Cannot write the report: %s", FilePath.c_str());
+		return false;
+	}
+
+	File << "Level,Frame";
+	for (const FBenchmarkMetric& Metric : BENCHMARK_METRICS)
+		File << "," << Metric.pName;
+	File << ",MeshRenderCommands,ShadowMeshRenderCommands,BoundingBoxRenderCommands\n";
+
+	for (const FLevel& Level : mLevels)
+	{
+		for (size_t iFrame = 0; iFrame < Level.Frames.size(); ++iFrame)
+		{
+			const FBenchmarkFrame& Frame = Level.Frames[iFrame];
+			File << Level.Name << "," << iFrame;
+			for (const FBenchmarkMetric& Metric : BENCHMARK_METRICS)
+				File << "," << Frame.*Metric.pTiming;
+			File << "," << Frame.Stats.NumMeshRenderCommands
+				<< "," << Frame.Stats.NumShadowMeshRenderCommands
+				<< "," << Frame.Stats.NumBoundingBoxRenderCommands << "\n";
+		}
+	}
+
+	Log::Info("[Benchmark] Report written: %s", FilePath.c_str());
+	return true;
+}
@@ -0,0 +1,133 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Core/Types.h"
+#include "Scene/Scene.h" // FSceneStats
+
+#include <DirectXMath.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+class Camera;
+
+//----------------------------------------------------------------------------------------------------------------
+// CAMERA PATH
+//----------------------------------------------------------------------------------------------------------------
+// Closed loop through the key poses: Catmull-Rom spline on the positions, yaw/pitch interpolated on the shortest arc.
+struct FCameraPath
+{
+	struct FKey
+	{
+		DirectX::XMFLOAT3 Position;
+		float             Yaw   = 0.0f; // radians
+		float             Pitch = 0.0f; // radians
+	};
+	std::vector<FKey> Keys;
+
+	// goes through the scene cameras in order and back to the first one, a single camera turns 360deg in place
+	static FCameraPath FromSceneCameras(const Scene& Scene);
+
+	FKey Evaluate(float t) const; // t in [0, 1), wraps around
+};
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARK RUNNER
+//----------------------------------------------------------------------------------------------------------------
+// Flies the active camera of each level on its FCameraPath w/ a fixed timestep & records per-frame CPU timings.
+// The measured frames of a level cover the path exactly once, the warmup frames before them aren't recorded.
+// Update thread : BeginLevel() -> UpdateCamera() & GetFrame() every loop -> TryEndLevel() -> next level / Finish()
+// Render thread : RecordRenderFrame() every loop
+// Render loop N renders the snapshot of update loop N, the frames are keyed by that loop index.
+// Runs in the Windows/D3D12 build only: there's no headless or null-device mode, see Renderer/NullBackend.h.
+struct FBenchmarkSettings
+{
+	std::vector<std::string> Levels;
+	uint        NumWarmupFrames = 0;
+	uint        NumFrames       = 0;  // measured per level
+	float       FixedTimestep   = 0.0f;
+	std::string ReportPath;           // w/o extension, .json & .csv are written
+};
+
+struct FBenchmarkFrame
+{
+	// update thread
+	float UpdateMs  = 0.0f; // Scene::Update()
+	float CullingMs = 0.0f; // Scene::PostUpdate(): culling & render lists
+	FSceneStats Stats = {};
+
+	// render thread
+	float PreRenderMs  = 0.0f; // RenderThread_PreRender(): deferred releases, constant buffer pages, command list resets
+	float RenderCmdsMs = 0.0f; // RenderThread_RenderFrame(): command recording, submit & present
+	float FrameMs      = 0.0f; // render loop to render loop
+};
+
+class BenchmarkRunner
+{
+public:
+	static constexpr int INVALID_LEVEL = -1;
+
+	// drops the levels that aren't in AvailableLevels, all of them if Settings.Levels is empty
+	void Initialize(const FBenchmarkSettings& Settings, const std::vector<std::string>& AvailableLevels);
+	inline bool  IsEnabled() const { return !mLevels.empty(); }
+	inline bool  IsFinished() const { return mbFinished.load(std::memory_order_acquire); }
+	inline float GetFixedTimestep() const { return mSettings.FixedTimestep; }
+	inline const std::string& GetFirstLevel() const { return mLevels.front().Name; }
+
+	// update thread
+	inline bool IsLevelRunning() const { return mActiveLevel.load(std::memory_order_relaxed) != INVALID_LEVEL; }
+	void BeginLevel(const Scene& Scene, uint64 UpdateLoop); // first warmup frame
+	void UpdateCamera(Camera& Cam, uint64 UpdateLoop) const;
+	bool TryEndLevel(uint64 UpdateLoop);                      // true once both threads recorded the measured frames of the level
+	const std::string* GetNextLevel() const;                  // nullptr after the last level
+	void Finish();                                            // writes the reports, IsFinished() returns true afterwards
+
+	// update & render threads, nullptr outside the measured frames. The threads write their own fields.
+	FBenchmarkFrame* GetFrame(uint64 LoopIndex);
+
+	// render thread
+	void RecordRenderFrame(uint64 RenderLoop, uint64 PreRenderBeginNs, uint64 RenderFrameBeginNs, uint64 RenderFrameEndNs);
+
+	// nearest-rank percentile, sorts Values
+	static float GetPercentile(std::vector<float>& Values, float Percentile);
+
+private:
+	struct FLevel
+	{
+		std::string                  Name;
+		std::vector<FBenchmarkFrame> Frames; // allocated upfront, the render thread never sees a reallocation
+		uint64                       FirstMeasuredLoop = 0;
+		FCameraPath                  Path;
+	};
+
+	bool WriteJSONReport(const std::string& FilePath) const;
+	bool WriteCSVReport(const std::string& FilePath) const;
+	void LogLevelSummary(const FLevel& Level) const;
+
+private:
+	FBenchmarkSettings  mSettings;
+	std::vector<FLevel> mLevels;
+	int                 mNextLevel = 0;                         // update thread
+	std::atomic<int>    mActiveLevel = INVALID_LEVEL;           // written by the update thread before publishing the frame snapshot
+	std::atomic<uint>   mNumRenderFramesRecorded = 0;           // of the active level
+	uint64              mLastRenderFrameBeginNs = 0;            // render thread
+	std::atomic<bool>   mbFinished = false;
+};
@@ -0,0 +1,462 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#define NOMINMAX
+#include "AsyncIO.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cassert>
+
+static constexpr ULONG_PTR COMPLETION_KEY_READ = 0;
+static constexpr ULONG_PTR COMPLETION_KEY_WAKE = 1;
+static constexpr uint64    OVERLAPPED_READ_CHUNK_SIZE = 16ull * 1024 * 1024; // ReadFile() takes a DWORD, large files are read in chunks
+
+namespace
+{
+	struct FOverlappedRead
+	{
+		OVERLAPPED          Overlapped = {}; // first member: the completion port hands back &Overlapped
+		HANDLE              hFile = INVALID_HANDLE_VALUE;
+		AsyncReadHandle_t   hRead;
+		std::shared_ptr<std::vector<uint8>> pBuffer;
+		uint64              Size = 0;
+		uint64              Offset = 0;
+	};
+
+	bool IssueOverlappedReadChunk(FOverlappedRead* pRead)
+	{
+		const uint64 Offset = pRead->Offset;
+		const DWORD  NumBytesToRead = static_cast<DWORD>(std::min(pRead->Size - Offset, OVERLAPPED_READ_CHUNK_SIZE));
+		pRead->Overlapped = {};
+		pRead->Overlapped.Offset     = static_cast<DWORD>(Offset & 0xFFFFFFFFull);
+		pRead->Overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+
+		// a synchronous completion still queues a completion packet
+		const BOOL bResult = ::ReadFile(pRead->hFile, pRead->pBuffer->data() + Offset, NumBytesToRead, nullptr, &pRead->Overlapped);
+		return bResult || GetLastError() == ERROR_IO_PENDING;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// ASYNC IO SERVICE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+void AsyncIOService::Initialize(EAsyncIOBackend Backend, uint NumThreads, uint QueueDepth)
+{
+	assert(!mbInitialized);
+	mBackend = Backend;
+	mQueueDepth = std::max(1u, QueueDepth);
+	mbExiting.store(false);
+
+	if (mBackend == EAsyncIOBackend::OVERLAPPED && !InitializeOverlappedBackend())
+	{
+		Log::Warning("AsyncIOService: couldn't create the I/O completion port (error=%u), falling back to the thread pool backend", GetLastError());
+		mBackend = EAsyncIOBackend::THREAD_POOL;
+	}
+
+	if (mBackend == EAsyncIOBackend::OVERLAPPED)
+	{
+		mIOThreads.emplace_back(&AsyncIOService::OverlappedIOThread_Main, this);
+	}
+	else
+	{
+		for (uint i = 0; i < std::max(1u, NumThreads); ++i)
+			mIOThreads.emplace_back(&AsyncIOService::ThreadPoolIOThread_Main, this);
+	}
+
+	mbInitialized = true;
+}
+
+bool AsyncIOService::InitializeOverlappedBackend()
+{
+	mhCompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+	return mhCompletionPort != nullptr;
+}
+
+void AsyncIOService::Exit()
+{
+	if (!mbInitialized)
+		return;
+
+	mbExiting.store(true);
+
+	// cancel the requests that haven't started, the I/O threads finish (or abort) the ones in flight
+	RequestQueue_t CancelledRequests;
+	{
+		std::lock_guard<std::mutex> lk(mMtxQueue);
+		std::swap(CancelledRequests, mQueue);
+	}
+	for (const AsyncReadHandle_t& hRead : CancelledRequests)
+	{
+		hRead->bCancelled.store(true);
+		Complete(hRead, FFileData{});
+	}
+
+	WakeIOThreads();
+	for (std::thread& IOThread : mIOThreads)
+		IOThread.join();
+	mIOThreads.clear();
+
+	if (mhCompletionPort)
+	{
+		CloseHandle(mhCompletionPort);
+		mhCompletionPort = nullptr;
+	}
+	mbInitialized = false;
+}
+
+AsyncReadHandle_t AsyncIOService::Read(const std::string& FilePath, EAsyncIOPriority Priority, AsyncReadCallback_t Callback)
+{
+	std::vector<FAsyncReadDesc> Reads(1);
+	Reads[0].FilePath = FilePath;
+	Reads[0].Priority = Priority;
+	Reads[0].Callback = std::move(Callback);
+
+	std::vector<AsyncReadHandle_t> Handles;
+	ReadBatch(std::move(Reads), &Handles);
+	return Handles[0];
+}
+
+void AsyncIOService::ReadBatch(std::vector<FAsyncReadDesc>&& Reads, std::vector<AsyncReadHandle_t>* pOutHandles)
+{
+	std::vector<AsyncReadHandle_t> Handles;
+	Handles.reserve(Reads.size());
+	for (FAsyncReadDesc& Desc : Reads)
+		Handles.push_back(CreateRequest(std::move(Desc)));
+
+	// not initialized or shutting down: read on the calling thread / cancel
+	if (!mbInitialized || mbExiting)
+	{
+		{
+			std::lock_guard<std::mutex> lk(mMtxQueue);
+			mNumOutstanding += Handles.size();
+		}
+		for (const AsyncReadHandle_t& hRead : Handles)
+		{
+			hRead->bCancelled.store(mbExiting.load());
+			Complete(hRead, hRead->bCancelled ? FFileData{} : VirtualFileSystem::ReadFile(hRead->FilePath));
+		}
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lk(mMtxQueue);
+			for (const AsyncReadHandle_t& hRead : Handles)
+			{
+				hRead->SequenceNumber = mNextSequenceNumber++;
+				mQueue.insert(hRead);
+			}
+			mNumOutstanding += Handles.size();
+		}
+		WakeIOThreads();
+	}
+
+	if (pOutHandles)
+	{
+		*pOutHandles = std::move(Handles);
+	}
+}
+
+void AsyncIOService::Cancel(const AsyncReadHandle_t& hRead)
+{
+	if (!hRead)
+		return;
+
+	bool bRemovedFromQueue = false;
+	{
+		std::lock_guard<std::mutex> lk(mMtxQueue);
+		hRead->bCancelled.store(true);
+		bRemovedFromQueue = mQueue.erase(hRead) > 0;
+
+		// in flight: abort the pending read, the I/O thread completes the request w/ ERROR_OPERATION_ABORTED
+		if (!bRemovedFromQueue && hRead->pInFlightRead)
+		{
+			FOverlappedRead* pRead = static_cast<FOverlappedRead*>(hRead->pInFlightRead);
+			CancelIoEx(pRead->hFile, &pRead->Overlapped);
+		}
+	}
+
+	if (bRemovedFromQueue)
+	{
+		Complete(hRead, FFileData{});
+	}
+}
+
+void AsyncIOService::WaitIdle()
+{
+	std::unique_lock<std::mutex> lk(mMtxQueue);
+	mCVIdle.wait(lk, [this]() { return mNumOutstanding == 0; });
+}
+
+bool AsyncIOService::IsIdle() const
+{
+	std::lock_guard<std::mutex> lk(mMtxQueue);
+	return mNumOutstanding == 0;
+}
+
+FAsyncIOStats AsyncIOService::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtxQueue);
+	return mStats;
+}
+
+AsyncReadHandle_t AsyncIOService::CreateRequest(FAsyncReadDesc&& Desc)
+{
+	AsyncReadHandle_t hRead = std::make_shared<FAsyncReadRequest>();
+	hRead->FilePath = std::move(Desc.FilePath);
+	hRead->Priority = Desc.Priority;
+	hRead->Callback = std::move(Desc.Callback);
+	return hRead;
+}
+
+void AsyncIOService::WakeIOThreads()
+{
+	if (mBackend == EAsyncIOBackend::OVERLAPPED)
+	{
+		if (mhCompletionPort)
+			PostQueuedCompletionStatus(mhCompletionPort, 0, COMPLETION_KEY_WAKE, nullptr);
+	}
+	else
+	{
+		mCVQueue.notify_all();
+	}
+}
+
+void AsyncIOService::Complete(const AsyncReadHandle_t& hRead, FFileData&& Data)
+{
+	FAsyncReadResult Result;
+	Result.FilePath   = hRead->FilePath;
+	Result.bCancelled = hRead->bCancelled.load();
+	if (!Result.bCancelled)
+	{
+		Result.Data = std::move(Data);
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(mMtxQueue);
+		++mStats.NumRequests;
+		if (Result.bCancelled)             ++mStats.NumCancelled;
+		else if (!Result.Data.IsValid())   ++mStats.NumFailed;
+		else                             { ++mStats.NumCompleted; mStats.BytesRead += Result.Data.Size; }
+	}
+
+	if (!Result.bCancelled && !Result.Data.IsValid())
+	{
+		Log::Error("AsyncIOService: cannot read file: %s", Result.FilePath.c_str());
+	}
+
+	AsyncReadCallback_t Callback = std::move(hRead->Callback);
+	if (Callback)
+	{
+		Callback(std::move(Result));
+	}
+
+	// idle only after the callbacks are done: they usually queue the decoding work
+	{
+		std::lock_guard<std::mutex> lk(mMtxQueue);
+		assert(mNumOutstanding > 0);
+		if (--mNumOutstanding == 0)
+			mCVIdle.notify_all();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// BACKENDS
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+void AsyncIOService::ThreadPoolIOThread_Main()
+{
+	for (;;)
+	{
+		AsyncReadHandle_t hRead;
+		{
+			std::unique_lock<std::mutex> lk(mMtxQueue);
+			mCVQueue.wait(lk, [this]() { return mbExiting || !mQueue.empty(); });
+			if (mQueue.empty())
+				return; // exiting
+			hRead = *mQueue.begin();
+			mQueue.erase(mQueue.begin());
+		}
+
+		// blocking read: VirtualFileSystem resolves the packed files & falls back to the loose ones
+		FFileData Data;
+		if (!hRead->bCancelled)
+		{
+			Data = VirtualFileSystem::ReadFile(hRead->FilePath);
+		}
+		Complete(hRead, std::move(Data));
+	}
+}
+
+void AsyncIOService::OverlappedIOThread_Main()
+{
+	std::vector<FOverlappedRead*>  InFlightReads;
+	std::vector<AsyncReadHandle_t> Batch;
+	bool bCancelledInFlightReads = false;
+
+	auto fnFinishRead = [&](FOverlappedRead* pRead, bool bSuccess)
+	{
+		{
+			std::lock_guard<std::mutex> lk(mMtxQueue);
+			pRead->hRead->pInFlightRead = nullptr;
+		}
+		CloseHandle(pRead->hFile);
+
+		FFileData Data;
+		if (bSuccess)
+		{
+			Data.pData  = pRead->pBuffer->data();
+			Data.Size   = static_cast<size_t>(pRead->Size);
+			Data.pOwner = pRead->pBuffer;
+		}
+		AsyncReadHandle_t hRead = std::move(pRead->hRead);
+		InFlightReads.erase(std::find(InFlightReads.begin(), InFlightReads.end(), pRead));
+		delete pRead;
+
+		Complete(hRead, std::move(Data));
+	};
+
+	auto fnBeginRead = [&](const AsyncReadHandle_t& hRead)
+	{
+		if (hRead->bCancelled)
+		{
+			Complete(hRead, FFileData{});
+			return;
+		}
+
+		// packed files are memory mapped already
+		if (VirtualFileSystem::IsPacked(hRead->FilePath))
+		{
+			Complete(hRead, VirtualFileSystem::ReadFile(hRead->FilePath));
+			return;
+		}
+
+		HANDLE hFile = CreateFileA(hRead->FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		LARGE_INTEGER FileSize = {};
+		if (hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hFile, &FileSize) || !CreateIoCompletionPort(hFile, mhCompletionPort, COMPLETION_KEY_READ, 0))
+		{
+			if (hFile != INVALID_HANDLE_VALUE)
+				CloseHandle(hFile);
+			Complete(hRead, FFileData{});
+			return;
+		}
+
+		FOverlappedRead* pRead = new FOverlappedRead();
+		pRead->hFile   = hFile;
+		pRead->hRead   = hRead;
+		pRead->Size    = static_cast<uint64>(FileSize.QuadPart);
+		pRead->pBuffer = std::make_shared<std::vector<uint8>>(std::max<size_t>(1, static_cast<size_t>(pRead->Size))); // non-null data for empty files
+		InFlightReads.push_back(pRead);
+
+		if (pRead->Size == 0)
+		{
+			fnFinishRead(pRead, true);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lk(mMtxQueue);
+			hRead->pInFlightRead = pRead;
+		}
+		if (!IssueOverlappedReadChunk(pRead))
+		{
+			fnFinishRead(pRead, false);
+		}
+	};
+
+	for (;;)
+	{
+		// issue the highest priority requests up to the queue depth
+		{
+			std::lock_guard<std::mutex> lk(mMtxQueue);
+			while (InFlightReads.size() + Batch.size() < mQueueDepth && !mQueue.empty())
+			{
+				Batch.push_back(*mQueue.begin());
+				mQueue.erase(mQueue.begin());
+			}
+		}
+		for (const AsyncReadHandle_t& hRead : Batch)
+		{
+			fnBeginRead(hRead);
+		}
+		Batch.clear();
+
+		if (mbExiting)
+		{
+			if (InFlightReads.empty())
+				break;
+			if (!bCancelledInFlightReads)
+			{
+				for (FOverlappedRead* pRead : InFlightReads)
+					CancelIoEx(pRead->hFile, &pRead->Overlapped);
+				bCancelledInFlightReads = true;
+			}
+		}
+
+		// wait for a completion or a wake-up (new requests / exit)
+		DWORD       NumBytesTransferred = 0;
+		ULONG_PTR   CompletionKey = 0;
+		OVERLAPPED* pOverlapped = nullptr;
+		const BOOL  bResult = GetQueuedCompletionStatus(mhCompletionPort, &NumBytesTransferred, &CompletionKey, &pOverlapped, INFINITE);
+		if (pOverlapped == nullptr)
+		{
+			if (!bResult)
+			{
+				Log::Error("AsyncIOService: GetQueuedCompletionStatus() failed (error=%u)", GetLastError());
+				break;
+			}
+			continue; // COMPLETION_KEY_WAKE
+		}
+
+		FOverlappedRead* pRead = reinterpret_cast<FOverlappedRead*>(pOverlapped);
+		if (!bResult || NumBytesTransferred == 0) // error, ERROR_OPERATION_ABORTED or unexpected EOF
+		{
+			fnFinishRead(pRead, false);
+			continue;
+		}
+
+		pRead->Offset += NumBytesTransferred;
+		if (pRead->Offset >= pRead->Size)
+		{
+			fnFinishRead(pRead, true);
+		}
+		else if (pRead->hRead->bCancelled || mbExiting || !IssueOverlappedReadChunk(pRead))
+		{
+			fnFinishRead(pRead, false);
+		}
+	}
+
+	// GetQueuedCompletionStatus() failure: nothing will dequeue the completions of the remaining reads.
+	// Cancel them & wait for the kernel to be done w/ their OVERLAPPED & buffer before freeing those.
+	for (FOverlappedRead* pRead : std::vector<FOverlappedRead*>(InFlightReads))
+	{
+		CancelIoEx(pRead->hFile, &pRead->Overlapped);
+		DWORD NumBytesTransferred = 0;
+		GetOverlappedResult(pRead->hFile, &pRead->Overlapped, &NumBytesTransferred, TRUE); // ERROR_OPERATION_ABORTED or the completed chunk
+		fnFinishRead(pRead, false);
+	}
+}
+
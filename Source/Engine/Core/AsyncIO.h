@@ -0,0 +1,148 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+#include "VirtualFileSystem.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class EAsyncIOBackend
+{
+	OVERLAPPED = 0, // a single I/O thread keeps QueueDepth overlapped reads in flight on an I/O completion port
+	THREAD_POOL,    // NumThreads threads doing blocking reads
+
+	NUM_ASYNC_IO_BACKENDS
+};
+
+enum class EAsyncIOPriority
+{
+	LOW = 0,
+	NORMAL,
+	HIGH,
+
+	NUM_ASYNC_IO_PRIORITIES
+};
+
+struct FAsyncReadResult
+{
+	std::string FilePath;
+	FFileData   Data;               // !IsValid() if the file couldn't be read or the request got cancelled
+	bool        bCancelled = false;
+};
+
+// Called exactly once per request from an I/O thread (or from Cancel()/Exit() for the requests that haven't started).
+// Keep it short: hand the decoding over to the worker threads, a slow callback stalls the reads behind it.
+using AsyncReadCallback_t = std::function<void(FAsyncReadResult&&)>;
+
+struct FAsyncReadRequest
+{
+	std::string         FilePath;
+	EAsyncIOPriority    Priority = EAsyncIOPriority::NORMAL;
+	AsyncReadCallback_t Callback;
+	uint64              SequenceNumber = 0; // FIFO within the same priority
+	std::atomic<bool>   bCancelled = false;
+	void*               pInFlightRead = nullptr; // OVERLAPPED backend, guarded by the service's queue mutex
+};
+using AsyncReadHandle_t = std::shared_ptr<FAsyncReadRequest>;
+
+struct FAsyncReadDesc
+{
+	std::string         FilePath;
+	EAsyncIOPriority    Priority = EAsyncIOPriority::NORMAL;
+	AsyncReadCallback_t Callback;
+};
+
+struct FAsyncIOStats
+{
+	uint64 NumRequests  = 0;
+	uint64 NumCompleted = 0;
+	uint64 NumFailed    = 0;
+	uint64 NumCancelled = 0;
+	uint64 BytesRead    = 0;
+};
+
+// Asynchronous whole-file reads for the asset loaders. The reads are queued by priority and issued
+// in batches, the completion callback receives the file contents. Files packed into a mounted pak
+// file complete without any I/O as they're already memory mapped (see VirtualFileSystem).
+class AsyncIOService
+{
+public:
+	AsyncIOService() = default;
+	~AsyncIOService() { Exit(); }
+	AsyncIOService(const AsyncIOService&) = delete;
+	AsyncIOService& operator=(const AsyncIOService&) = delete;
+
+	// falls back to THREAD_POOL if the OVERLAPPED backend can't be initialized
+	void Initialize(EAsyncIOBackend Backend, uint NumThreads, uint QueueDepth = 32);
+	void Exit(); // cancels the queued requests and waits for the ones in flight
+
+	AsyncReadHandle_t Read(const std::string& FilePath, EAsyncIOPriority Priority, AsyncReadCallback_t Callback);
+	void              ReadBatch(std::vector<FAsyncReadDesc>&& Reads, std::vector<AsyncReadHandle_t>* pOutHandles = nullptr); // single lock & wake-up for all the reads
+	void              Cancel(const AsyncReadHandle_t& hRead);
+	void              WaitIdle(); // blocks until all the requests issued so far are completed
+	bool              IsIdle() const;
+
+	inline EAsyncIOBackend GetBackend() const { return mBackend; }
+	inline bool            IsInitialized() const { return mbInitialized; }
+	FAsyncIOStats          GetStats() const;
+
+private:
+	struct FRequestOrder
+	{
+		bool operator()(const AsyncReadHandle_t& l, const AsyncReadHandle_t& r) const
+		{
+			return l->Priority != r->Priority ? l->Priority > r->Priority : l->SequenceNumber < r->SequenceNumber;
+		}
+	};
+	using RequestQueue_t = std::set<AsyncReadHandle_t, FRequestOrder>;
+
+	bool InitializeOverlappedBackend();
+	void OverlappedIOThread_Main();
+	void ThreadPoolIOThread_Main();
+
+	AsyncReadHandle_t CreateRequest(FAsyncReadDesc&& Desc);
+	void              WakeIOThreads();
+	void              Complete(const AsyncReadHandle_t& hRead, FFileData&& Data); // invokes the callback & updates the stats
+
+private:
+	EAsyncIOBackend              mBackend = EAsyncIOBackend::THREAD_POOL;
+	uint                         mQueueDepth = 0;
+	bool                         mbInitialized = false;
+	std::atomic<bool>            mbExiting = false;
+
+	std::vector<std::thread>     mIOThreads;
+	void*                        mhCompletionPort = nullptr; // OVERLAPPED backend
+
+	mutable std::mutex           mMtxQueue;
+	std::condition_variable      mCVQueue;    // THREAD_POOL backend: wakes the I/O threads
+	std::condition_variable      mCVIdle;     // WaitIdle()
+	RequestQueue_t               mQueue;
+	uint64                       mNextSequenceNumber = 0;
+	uint64                       mNumOutstanding = 0; // queued + in flight
+	FAsyncIOStats                mStats;
+};
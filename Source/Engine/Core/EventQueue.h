@@ -0,0 +1,155 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// Bounded lock-free multi-producer / single-consumer queue of trivially copyable items (D. Vyukov's bounded queue).
+// Each consumer thread owns one: the items are copied into a ring of preallocated cells, pushing & draining
+// don't allocate, lock or refcount. Each cell carries a sequence number that tells whether it's free to write
+// for the producer of a given position or ready to read for the consumer.
+template<class T>
+class MPSCQueue
+{
+	static_assert(std::is_trivially_copyable<T>::value, "MPSCQueue items are copied around as raw bytes");
+public:
+	explicit MPSCQueue(size_t Capacity); // rounded up to a power of 2
+
+	bool TryPush(const T& Item); // returns false if the queue is full
+	void Push(const T& Item);    // yields until the consumer makes room, for the events that can't be dropped
+	// returns false if MaxNumQueued items are already waiting: droppable items leave room for the Push()es,
+	// the consumer thread can't wait for itself if it pushes to its own queue
+	bool TryPush(const T& Item, size_t MaxNumQueued);
+
+	// consumer thread: pops & processes the items that were pushed before the call, so that the producers
+	// can't stall the consumer by pushing new items while it's draining. Returns the # items processed.
+	template<class TFunc> size_t Drain(TFunc&& fnProcess);
+
+	inline bool   IsEmpty() const     { return mEnqueuePos.load(std::memory_order_acquire) == mDequeuePos.load(std::memory_order_relaxed); }
+	inline size_t GetCapacity() const { return mMask + 1; }
+	inline size_t GetNumQueued() const { return mEnqueuePos.load(std::memory_order_relaxed) - mDequeuePos.load(std::memory_order_relaxed); } // approximate
+
+private:
+	struct FCell
+	{
+		std::atomic<size_t> Sequence;
+		T                   Item;
+	};
+	bool TryPop(T& OutItem);
+
+private:
+	std::unique_ptr<FCell[]>         mpCells;
+	size_t                           mMask = 0;
+	alignas(64) std::atomic<size_t>  mEnqueuePos{ 0 };
+	alignas(64) std::atomic<size_t>  mDequeuePos{ 0 }; // only written by the consumer, atomic for IsEmpty()
+};
+
+
+// -------------------------------------------------------------------------------------
+template<class T>
+MPSCQueue<T>::MPSCQueue(size_t Capacity)
+{
+	size_t PowerOf2Capacity = 2;
+	while (PowerOf2Capacity < Capacity)
+		PowerOf2Capacity <<= 1;
+
+	mpCells.reset(new FCell[PowerOf2Capacity]);
+	mMask = PowerOf2Capacity - 1;
+	for (size_t i = 0; i < PowerOf2Capacity; ++i)
+		mpCells[i].Sequence.store(i, std::memory_order_relaxed);
+}
+
+template<class T>
+bool MPSCQueue<T>::TryPush(const T& Item)
+{
+	FCell* pCell = nullptr;
+	size_t Pos = mEnqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		pCell = &mpCells[Pos & mMask];
+		const size_t Sequence = pCell->Sequence.load(std::memory_order_acquire);
+		const intptr_t Diff = static_cast<intptr_t>(Sequence) - static_cast<intptr_t>(Pos);
+		if (Diff == 0) // cell is free for this position, claim it
+		{
+			if (mEnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (Diff < 0) // cell still holds the item from the previous lap: full
+		{
+			return false;
+		}
+		else // another producer claimed the position
+		{
+			Pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	pCell->Item = Item;
+	pCell->Sequence.store(Pos + 1, std::memory_order_release); // publish to the consumer
+	return true;
+}
+
+template<class T>
+bool MPSCQueue<T>::TryPush(const T& Item, size_t MaxNumQueued)
+{
+	return GetNumQueued() < MaxNumQueued && TryPush(Item);
+}
+
+template<class T>
+void MPSCQueue<T>::Push(const T& Item)
+{
+	while (!TryPush(Item))
+		std::this_thread::yield();
+}
+
+template<class T>
+bool MPSCQueue<T>::TryPop(T& OutItem)
+{
+	const size_t Pos = mDequeuePos.load(std::memory_order_relaxed);
+	FCell& Cell = mpCells[Pos & mMask];
+	const size_t Sequence = Cell.Sequence.load(std::memory_order_acquire);
+	if (static_cast<intptr_t>(Sequence) - static_cast<intptr_t>(Pos + 1) < 0)
+		return false; // empty, or the producer of this position hasn't finished writing yet
+
+	OutItem = Cell.Item;
+	Cell.Sequence.store(Pos + mMask + 1, std::memory_order_release); // free for the next lap
+	mDequeuePos.store(Pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+template<class T>
+template<class TFunc>
+size_t MPSCQueue<T>::Drain(TFunc&& fnProcess)
+{
+	const size_t EndPos = mEnqueuePos.load(std::memory_order_acquire);
+	size_t NumProcessed = 0;
+	T Item;
+	while (mDequeuePos.load(std::memory_order_relaxed) != EndPos && TryPop(Item))
+	{
+		fnProcess(Item);
+		++NumProcessed;
+	}
+	return NumProcessed;
+}
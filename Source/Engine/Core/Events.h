@@ -25,6 +25,9 @@
 
 #include "../../Renderer/HDR.h"
 
+#include <cstring>
+#include <type_traits>
+
 //
 // EVENT BASE CLASS
 //
@@ -37,6 +40,10 @@
 // Instead of dynamic casting the pointer and check-null, we'll use an enum
 // in each event to distinguish events from one another.
 //
+// Events are trivially copyable structs deriving from IEvent: they're copied by
+// value into the lock-free queue of the consuming thread (FEventRecord), there's
+// no heap allocation or refcounting per event.
+//
 enum EEventType
 {
 	// Windows->VQE window events
@@ -71,6 +78,27 @@ struct IEvent
 	HWND       hwnd = 0;
 };
 
+// Fixed size copy of an event, the item type of the event queues
+struct FEventRecord
+{
+	static constexpr size_t MAX_EVENT_SIZE = 48;
+
+	FEventRecord() = default;
+	template<class TEvent> FEventRecord(const TEvent& Event)
+	{
+		static_assert(std::is_base_of<IEvent, TEvent>::value, "Events must derive from IEvent");
+		static_assert(std::is_trivially_copyable<TEvent>::value, "Events are copied into the event queues as raw bytes");
+		static_assert(sizeof(TEvent) <= MAX_EVENT_SIZE, "Event doesn't fit into FEventRecord, increase MAX_EVENT_SIZE");
+		memcpy(mData, &Event, sizeof(TEvent));
+	}
+
+	inline const IEvent& Get() const { return *reinterpret_cast<const IEvent*>(mData); }
+	template<class TEvent> inline const TEvent& Get() const { return *reinterpret_cast<const TEvent*>(mData); }
+
+private:
+	alignas(8) unsigned char mData[MAX_EVENT_SIZE];
+};
+
 
 // -------------------------------------------------------------------------------------
 struct SetMouseCaptureEvent : public IEvent
@@ -112,9 +140,9 @@ struct WindowResizeEvent : public IEvent
 
 struct WindowCloseEvent : public IEvent
 {
-	WindowCloseEvent(HWND hwnd_) : IEvent(EEventType::WINDOW_CLOSE_EVENT, hwnd_){}
+	WindowCloseEvent(HWND hwnd_, Signal* pSignal) : IEvent(EEventType::WINDOW_CLOSE_EVENT, hwnd_), pSignal_WindowDependentResourcesDestroyed(pSignal) {}
 
-	mutable Signal Signal_WindowDependentResourcesDestroyed;
+	Signal* pSignal_WindowDependentResourcesDestroyed = nullptr; // owned by the main thread, which waits on it
 };
 
 struct ToggleFullscreenEvent : public IEvent
@@ -20,6 +20,7 @@
 
 #include "Libs/VQUtils/Source/utils.h"
 #include "Libs/VQUtils/Libs/tinyxml2/tinyxml2.h"
+#include "VirtualFileSystem.h"
 
 #include <fstream>
 #include <cassert>
@@ -51,6 +52,18 @@ static std::pair<std::string, std::string> ParseLineINI(const std::string& iniLi
 	return SettingNameValuePair;
 }
 
+// reads through the VirtualFileSystem: scene & material files can be packed
+static tinyxml2::XMLError LoadXMLDocument(tinyxml2::XMLDocument& doc, const std::string& FilePath)
+{
+	const FFileData File = VirtualFileSystem::ReadFile(FilePath);
+	if (!File.IsValid())
+	{
+		Log::Error("Couldn't read XML file: %s", FilePath.c_str());
+		return tinyxml2::XML_ERROR_FILE_NOT_FOUND;
+	}
+	return doc.Parse(reinterpret_cast<const char*>(File.pData), File.Size);
+}
+
 static std::unordered_map<std::string, EDisplayMode> S_LOOKUP_STR_TO_DISPLAYMODE =
 {
 	  { "Fullscreen"           , EDisplayMode::EXCLUSIVE_FULLSCREEN   }
@@ -123,6 +136,21 @@ FStartupParameters VQEngine::ParseEngineSettingsFile()
 				else
 					params.EngineSettings.gfx.MaxFrameRate = StrUtil::ParseInt(SettingValue);
 			}
+			if (SettingName == "FrameLimiterSpinThresholdMs")
+			{
+				params.bOverrideGFXSetting_FrameLimiterSpinThreshold = true;
+				params.EngineSettings.gfx.FrameLimiterSpinThresholdMs = StrUtil::ParseFloat(SettingValue);
+			}
+			if (SettingName == "TextureStreaming")
+			{
+				params.bOverrideGFXSetting_bTextureStreaming = true;
+				params.EngineSettings.gfx.bTextureStreaming = StrUtil::ParseBool(SettingValue);
+			}
+			if (SettingName == "TextureStreamingBudgetMB")
+			{
+				params.bOverrideGFXSetting_TextureStreamingBudget = true;
+				params.EngineSettings.gfx.TextureStreamingBudgetMB = StrUtil::ParseInt(SettingValue);
+			}
 
 			// 
 			// Engine
@@ -191,6 +219,16 @@ FStartupParameters VQEngine::ParseEngineSettingsFile()
 				params.bOverrideENGSetting_StartupScene = true;
 				params.EngineSettings.StartupScene = SettingValue;
 			}
+			if (SettingName == "UpdateRenderFrameLatency")
+			{
+				params.bOverrideENGSetting_UpdateRenderFrameLatency = true;
+				params.EngineSettings.UpdateRenderFrameLatency = StrUtil::ParseInt(SettingValue);
+			}
+			if (SettingName == "HotReloadShaders")
+			{
+				params.bOverrideENGSetting_bHotReloadShaders = true;
+				params.EngineSettings.bHotReloadShaders = StrUtil::ParseBool(SettingValue);
+			}
 			
 		}
 	}
@@ -712,7 +750,7 @@ FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
 
 	// parse XML
 	tinyxml2::XMLDocument doc;
-	doc.LoadFile(SceneFile.c_str());
+	LoadXMLDocument(doc, SceneFile);
 
 	// scene name
 	SceneRep.SceneName = DirectoryUtil::GetFileNameWithoutExtension(SceneFile);
@@ -783,7 +821,7 @@ std::vector<FMaterialRepresentation> VQEngine::ParseMaterialFile(const std::stri
 
 	// open xml file
 	tinyxml2::XMLDocument doc;
-	doc.LoadFile(MaterialFilePath.c_str());
+	LoadXMLDocument(doc, MaterialFilePath);
 
 	XMLElement* pRoot = doc.FirstChildElement();
 
@@ -0,0 +1,168 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "FileWatcher.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+FileWatcher::FFileState FileWatcher::GetFileState(const std::string& FilePath)
+{
+	FFileState State;
+	std::error_code ec;
+	const fs::file_time_type WriteTime = fs::last_write_time(FilePath, ec);
+	if (ec)
+		return State;
+	const uintmax_t Size = fs::file_size(FilePath, ec);
+	if (ec)
+		return State;
+
+	State.WriteTime = static_cast<uint64>(WriteTime.time_since_epoch().count());
+	State.Size = static_cast<uint64>(Size);
+	State.bExists = true;
+	return State;
+}
+
+void FileWatcher::Initialize(const std::vector<std::string>& FilePaths, uint PollIntervalMs)
+{
+	Exit();
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mFiles.clear();
+		mChangedFiles.clear();
+		mPollIntervalMs = PollIntervalMs;
+		mbExiting.store(false);
+	}
+	AddFiles(FilePaths);
+
+	if (PollIntervalMs > 0)
+		mPollingThread = std::thread(&FileWatcher::PollingThread_Main, this);
+	Log::Info("[FileWatcher] Watching %zu files (poll interval: %ums)", GetNumWatchedFiles(), PollIntervalMs);
+}
+
+void FileWatcher::Exit()
+{
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mbExiting.store(true);
+	}
+	mCVExit.notify_all();
+	if (mPollingThread.joinable())
+		mPollingThread.join();
+}
+
+void FileWatcher::AddFiles(const std::vector<std::string>& FilePaths)
+{
+	// stat the new files outside the lock
+	std::vector<std::pair<std::string, FFileState>> NewFiles;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		for (const std::string& FilePath : FilePaths)
+		{
+			if (mFiles.find(FilePath) == mFiles.end())
+				NewFiles.push_back({ FilePath, FFileState() });
+		}
+	}
+	for (auto& NewFile : NewFiles)
+		NewFile.second = GetFileState(NewFile.first);
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	for (auto& NewFile : NewFiles)
+	{
+		if (mFiles.find(NewFile.first) == mFiles.end())
+			mFiles[NewFile.first].State = NewFile.second;
+	}
+}
+
+void FileWatcher::CheckFiles()
+{
+	std::vector<std::string> FilePaths;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		FilePaths.reserve(mFiles.size());
+		for (const auto& it : mFiles)
+			FilePaths.push_back(it.first);
+	}
+
+	std::vector<FFileState> States(FilePaths.size());
+	for (size_t i = 0; i < FilePaths.size(); ++i)
+		States[i] = GetFileState(FilePaths[i]);
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	for (size_t i = 0; i < FilePaths.size(); ++i)
+	{
+		FWatchedFile& File = mFiles.at(FilePaths[i]);
+		const FFileState& State = States[i];
+		if (State == File.State)
+		{
+			File.bPending = false; // changed back, e.g. a backup copy got restored
+			continue;
+		}
+
+		if (File.bPending && State == File.PendingState)
+		{
+			File.State = State;
+			File.bPending = false;
+			mChangedFiles.insert(FilePaths[i]);
+			continue;
+		}
+
+		// wait a poll for the file to settle
+		File.PendingState = State;
+		File.bPending = true;
+	}
+}
+
+std::vector<std::string> FileWatcher::PollChanges()
+{
+	CheckFiles();
+	return PopChangedFiles();
+}
+
+std::vector<std::string> FileWatcher::PopChangedFiles()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	std::vector<std::string> ChangedFiles(mChangedFiles.begin(), mChangedFiles.end());
+	mChangedFiles.clear();
+	return ChangedFiles;
+}
+
+size_t FileWatcher::GetNumWatchedFiles() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	return mFiles.size();
+}
+
+void FileWatcher::PollingThread_Main()
+{
+	std::unique_lock<std::mutex> lk(mMtx);
+	while (!mbExiting.load())
+	{
+		mCVExit.wait_for(lk, std::chrono::milliseconds(mPollIntervalMs), [this]() { return mbExiting.load(); });
+		if (mbExiting.load())
+			break;
+
+		lk.unlock();
+		CheckFiles();
+		lk.lock();
+	}
+}
@@ -0,0 +1,85 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Watches a set of files for changes to their write time or size. Stats the files periodically instead of
+// relying on the OS change notifications, which is plenty for the few hundred shader source files and works
+// the same on every platform. A change is reported once the file stays the same for a poll, so that the
+// editors writing a file in several steps (truncate, write, rename) don't trigger a reload per step.
+// Thread-safe.
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	~FileWatcher() { Exit(); }
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// PollIntervalMs: 0 doesn't start the polling thread, call PollChanges() instead
+	void Initialize(const std::vector<std::string>& FilePaths, uint PollIntervalMs);
+	void Exit();
+
+	void                     AddFiles(const std::vector<std::string>& FilePaths); // the files that are already watched are ignored
+	std::vector<std::string> PollChanges();     // stats the files on the calling thread, then returns & clears the changes
+	std::vector<std::string> PopChangedFiles(); // returns & clears the changes detected by the polling thread
+
+	size_t GetNumWatchedFiles() const;
+
+private:
+	struct FFileState
+	{
+		uint64 WriteTime = 0;
+		uint64 Size = 0;
+		bool   bExists = false;
+
+		inline bool operator==(const FFileState& o) const { return WriteTime == o.WriteTime && Size == o.Size && bExists == o.bExists; }
+		inline bool operator!=(const FFileState& o) const { return !(*this == o); }
+	};
+	struct FWatchedFile
+	{
+		FFileState State;
+		FFileState PendingState; // changed state, waiting to settle
+		bool       bPending = false;
+	};
+	static FFileState GetFileState(const std::string& FilePath);
+
+	void CheckFiles();
+	void PollingThread_Main();
+
+private:
+	mutable std::mutex                            mMtx;
+	std::condition_variable                       mCVExit;
+	std::atomic<bool>                             mbExiting = false;
+	std::thread                                   mPollingThread;
+	uint                                          mPollIntervalMs = 0;
+
+	std::unordered_map<std::string, FWatchedFile> mFiles;
+	std::set<std::string>                         mChangedFiles;
+};
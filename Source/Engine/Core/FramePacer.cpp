@@ -0,0 +1,214 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#define NOMINMAX
+#include "FramePacer.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 // Windows 10 1803+
+#endif
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using DurationMs = std::chrono::duration<double, std::milli>;
+
+static constexpr double OVERSLEEP_ESTIMATE_DECAY = 0.98; // per coarse sleep
+
+static double GetThreadCPUTimeMs()
+{
+#ifdef _WIN32
+	FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+	if (!GetThreadTimes(GetCurrentThread(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+		return 0.0;
+	const uint64 Kernel = (static_cast<uint64>(KernelTime.dwHighDateTime) << 32) | KernelTime.dwLowDateTime;
+	const uint64 User   = (static_cast<uint64>(UserTime.dwHighDateTime) << 32) | UserTime.dwLowDateTime;
+	return (Kernel + User) / 10000.0; // 100ns units
+#else
+	timespec ts = {};
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+void FramePacer::Initialize(float SpinThresholdMs, EFramePacingMethod Method)
+{
+	Exit();
+	mMethod = Method;
+	mSpinThresholdMs.store(SpinThresholdMs);
+	mbFirstFrame = true;
+	mOversleepEstimateMs = 0.0;
+	ResetStats();
+
+#ifdef _WIN32
+	if (Method == EFramePacingMethod::SLEEP_AND_SPIN)
+	{
+		mhWaitableTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!mhWaitableTimer)
+		{
+			// older Windows: the default timer resolution is coarse, the oversleep estimate widens the spin window to cover it
+			Log::Warning("FramePacer: High resolution waitable timer isn't supported, falling back to the default timer");
+			mhWaitableTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+		}
+	}
+#endif
+}
+
+void FramePacer::Exit()
+{
+#ifdef _WIN32
+	if (mhWaitableTimer)
+	{
+		CloseHandle(mhWaitableTimer);
+		mhWaitableTimer = nullptr;
+	}
+#endif
+}
+
+void FramePacer::CoarseSleepUntil(Clock::time_point WakeTime)
+{
+#ifdef _WIN32
+	const double SleepTimeMs = DurationMs(WakeTime - Clock::now()).count();
+	if (SleepTimeMs <= 0.0)
+		return;
+	if (mhWaitableTimer)
+	{
+		LARGE_INTEGER DueTime = {};
+		DueTime.QuadPart = -static_cast<LONGLONG>(SleepTimeMs * 10000.0); // relative, 100ns units
+		if (SetWaitableTimerEx(mhWaitableTimer, &DueTime, 0, NULL, NULL, NULL, 0))
+		{
+			WaitForSingleObject(mhWaitableTimer, INFINITE);
+			return;
+		}
+	}
+	Sleep(static_cast<DWORD>(SleepTimeMs));
+#else
+	// steady_clock is CLOCK_MONOTONIC
+	const auto WakeTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(WakeTime.time_since_epoch()).count();
+	timespec ts = {};
+	ts.tv_sec  = static_cast<time_t>(WakeTimeNs / 1000000000);
+	ts.tv_nsec = static_cast<long>(WakeTimeNs % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR);
+#endif
+}
+
+float FramePacer::WaitForNextFrame()
+{
+	const Clock::time_point Now = Clock::now();
+	const double TargetFrameTimeMs = mTargetFrameTimeMs.load();
+	if (mbFirstFrame)
+	{
+		mbFirstFrame = false;
+		mFrameStart = mLastWakeTime = Now;
+		return 0.0f;
+	}
+	if (TargetFrameTimeMs <= 0.0)
+	{
+		UpdateStats(DurationMs(Now - mLastWakeTime).count(), 0.0, 0.0, 0.0, 0.0, false);
+		mFrameStart = mLastWakeTime = Now;
+		return 0.0f;
+	}
+
+	const Clock::time_point Deadline = mFrameStart + std::chrono::duration_cast<Clock::duration>(DurationMs(TargetFrameTimeMs));
+	if (Now >= Deadline)
+	{
+		// missed: start over from now instead of rushing the next frames to catch up
+		UpdateStats(DurationMs(Now - mLastWakeTime).count(), TargetFrameTimeMs, 0.0, 0.0, 0.0, true);
+		mFrameStart = mLastWakeTime = Now;
+		return 0.0f;
+	}
+
+	const double CPUTimeBegin = GetThreadCPUTimeMs();
+	if (mMethod == EFramePacingMethod::SLEEP_AND_SPIN)
+	{
+		const double SpinWindowMs = mSpinThresholdMs.load() + mOversleepEstimateMs;
+		const Clock::time_point WakeTime = Deadline - std::chrono::duration_cast<Clock::duration>(DurationMs(SpinWindowMs));
+		if (WakeTime > Now)
+		{
+			CoarseSleepUntil(WakeTime);
+			const double OversleepMs = std::max(0.0, DurationMs(Clock::now() - WakeTime).count());
+			mOversleepEstimateMs = std::min(TargetFrameTimeMs, std::max(OversleepMs, mOversleepEstimateMs * OVERSLEEP_ESTIMATE_DECAY));
+
+			std::lock_guard<std::mutex> lk(mMtxStats);
+			++mNumCoarseSleeps;
+			mStats.AvgOversleepMs += (OversleepMs - mStats.AvgOversleepMs) / mNumCoarseSleeps;
+			mStats.MaxOversleepMs = std::max(mStats.MaxOversleepMs, OversleepMs);
+		}
+	}
+
+	const Clock::time_point SpinStart = Clock::now();
+	Clock::time_point WakeTime = SpinStart;
+	while (WakeTime < Deadline)
+	{
+		std::this_thread::yield();
+		WakeTime = Clock::now();
+	}
+	const double WaitCPUTimeMs = GetThreadCPUTimeMs() - CPUTimeBegin;
+
+	const double WaitTimeMs = DurationMs(WakeTime - Now).count();
+	UpdateStats(DurationMs(WakeTime - mLastWakeTime).count(), TargetFrameTimeMs, WaitTimeMs, DurationMs(WakeTime - SpinStart).count(), WaitCPUTimeMs, false);
+
+	// the next frame is paced from the deadline, so the wake-up latency doesn't accumulate
+	mFrameStart = Deadline;
+	mLastWakeTime = WakeTime;
+	return static_cast<float>(WaitTimeMs);
+}
+
+void FramePacer::UpdateStats(double FrameTimeMs, double TargetFrameTimeMs, double WaitTimeMs, double SpinTimeMs, double WaitCPUTimeMs, bool bMissed)
+{
+	std::lock_guard<std::mutex> lk(mMtxStats);
+	FFramePacingStats& s = mStats;
+	++s.NumFrames;
+	if (bMissed)
+		++s.NumMissedFrames;
+
+	const double Delta = FrameTimeMs - s.AvgFrameTimeMs;
+	s.AvgFrameTimeMs += Delta / s.NumFrames;
+	mFrameTimeM2 += Delta * (FrameTimeMs - s.AvgFrameTimeMs);
+	s.JitterMs = s.NumFrames > 1 ? std::sqrt(mFrameTimeM2 / (s.NumFrames - 1)) : 0.0;
+	if (TargetFrameTimeMs > 0.0)
+		s.MaxErrorMs = std::max(s.MaxErrorMs, std::abs(FrameTimeMs - TargetFrameTimeMs));
+
+	s.WaitTimeMs    += WaitTimeMs;
+	s.SpinTimeMs    += SpinTimeMs;
+	s.WaitCPUTimeMs += WaitCPUTimeMs;
+}
+
+FFramePacingStats FramePacer::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtxStats);
+	return mStats;
+}
+
+void FramePacer::ResetStats()
+{
+	std::lock_guard<std::mutex> lk(mMtxStats);
+	mStats = {};
+	mFrameTimeM2 = 0.0;
+	mNumCoarseSleeps = 0;
+}
+
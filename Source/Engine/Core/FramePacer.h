@@ -0,0 +1,98 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+enum class EFramePacingMethod
+{
+	SPIN = 0,       // yields in a loop until the deadline: precise, but keeps a core busy for the whole wait
+	SLEEP_AND_SPIN, // sleeps on a high resolution timer until shortly before the deadline, spins the rest
+
+	NUM_FRAME_PACING_METHODS
+};
+
+struct FFramePacingStats
+{
+	uint64 NumFrames        = 0;
+	uint64 NumMissedFrames  = 0;   // took longer than the target frame time, no wait
+	double AvgFrameTimeMs   = 0.0;
+	double JitterMs         = 0.0; // standard deviation of the frame time
+	double MaxErrorMs       = 0.0; // largest |frame time - target frame time|
+	double AvgOversleepMs   = 0.0; // coarse sleep wake-ups past the requested time
+	double MaxOversleepMs   = 0.0;
+	double WaitTimeMs       = 0.0; // total, sleep + spin
+	double SpinTimeMs       = 0.0;
+	double WaitCPUTimeMs    = 0.0; // CPU time of the pacing thread while waiting
+
+	inline double GetWaitCPUUtilization() const { return WaitTimeMs > 0.0 ? WaitCPUTimeMs / WaitTimeMs : 0.0; }
+};
+
+// Limits the frame rate of the thread calling WaitForNextFrame() w/ absolute deadlines, so that a late wake-up
+// doesn't delay the following frames. SLEEP_AND_SPIN sleeps until SpinThresholdMs (+ the recent oversleep of the
+// timer) before the deadline and spins the rest, which keeps the precision of spinning at a fraction of its CPU cost.
+// The target frame time can be changed from any thread, WaitForNextFrame() is called by the paced thread only.
+class FramePacer
+{
+public:
+	FramePacer() = default;
+	~FramePacer() { Exit(); }
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	void Initialize(float SpinThresholdMs, EFramePacingMethod Method = EFramePacingMethod::SLEEP_AND_SPIN);
+	void Exit();
+
+	inline void SetTargetFrameTime(float TargetFrameTimeMs) { mTargetFrameTimeMs.store(TargetFrameTimeMs); } // 0: unlimited
+	inline void SetSpinThreshold(float SpinThresholdMs)     { mSpinThresholdMs.store(SpinThresholdMs); }
+	inline float GetTargetFrameTime() const                 { return mTargetFrameTimeMs.load(); }
+
+	// blocks until the target frame time has passed since the last frame, returns the time waited in ms
+	float WaitForNextFrame();
+
+	FFramePacingStats GetStats() const;
+	void              ResetStats();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	void CoarseSleepUntil(Clock::time_point WakeTime);
+	void UpdateStats(double FrameTimeMs, double TargetFrameTimeMs, double WaitTimeMs, double SpinTimeMs, double WaitCPUTimeMs, bool bMissed);
+
+private:
+	EFramePacingMethod mMethod = EFramePacingMethod::SLEEP_AND_SPIN;
+	std::atomic<float> mTargetFrameTimeMs = 0.0f;
+	std::atomic<float> mSpinThresholdMs = 1.0f;
+	void*              mhWaitableTimer = nullptr; // Win32 high resolution waitable timer
+
+	// paced thread
+	bool               mbFirstFrame = true;
+	Clock::time_point  mFrameStart;
+	Clock::time_point  mLastWakeTime;
+	double             mOversleepEstimateMs = 0.0; // decaying max of the timer's oversleep, widens the spin window
+
+	mutable std::mutex mMtxStats;
+	FFramePacingStats  mStats;
+	double             mFrameTimeM2 = 0.0; // Welford's running variance
+	uint64             mNumCoarseSleeps = 0;
+};
@@ -0,0 +1,127 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "FrameSnapshotRing.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <cassert>
+
+using DurationMs = std::chrono::duration<double, std::milli>;
+
+void FrameSnapshotRing::Initialize(uint Latency)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mLatency = std::clamp(Latency, 1u, MAX_LATENCY);
+	mSlots = {};
+	mNextWriteSlot = mNextReadSlot = 0;
+	mLastWrittenSlot = INVALID_SLOT;
+	mbAborted = false;
+	mStats = {};
+}
+
+void FrameSnapshotRing::Abort()
+{
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mbAborted = true;
+	}
+	mCVSlotFree.notify_all();
+	mCVSlotReady.notify_all();
+}
+
+int FrameSnapshotRing::BeginWrite()
+{
+	const Clock::time_point WaitBegin = Clock::now();
+	std::unique_lock<std::mutex> lk(mMtx);
+	mCVSlotFree.wait(lk, [&]() { return mbAborted || mSlots[mNextWriteSlot].State == ESlotState::FREE; });
+	if (mbAborted)
+		return INVALID_SLOT;
+
+	const int Slot = static_cast<int>(mNextWriteSlot);
+	mNextWriteSlot = (mNextWriteSlot + 1) % GetNumSlots();
+	mSlots[Slot].State = ESlotState::WRITING;
+	mSlots[Slot].WriteBeginTime = Clock::now();
+	mStats.ProducerWaitMs += DurationMs(mSlots[Slot].WriteBeginTime - WaitBegin).count();
+	return Slot;
+}
+
+void FrameSnapshotRing::EndWrite(int Slot)
+{
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		assert(Slot >= 0 && mSlots[Slot].State == ESlotState::WRITING);
+		mSlots[Slot].State = ESlotState::READY;
+		mLastWrittenSlot = Slot;
+		++mStats.NumFramesPublished;
+	}
+	mCVSlotReady.notify_one();
+}
+
+int FrameSnapshotRing::GetLastWrittenSlot() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	return mLastWrittenSlot;
+}
+
+void FrameSnapshotRing::WaitUntilConsumed()
+{
+	std::unique_lock<std::mutex> lk(mMtx);
+	mCVSlotFree.wait(lk, [&]()
+	{
+		return mbAborted || std::none_of(mSlots.begin(), mSlots.end(), [](const FSlot& s) { return s.State == ESlotState::READY || s.State == ESlotState::READING; });
+	});
+}
+
+int FrameSnapshotRing::BeginRead()
+{
+	const Clock::time_point WaitBegin = Clock::now();
+	std::unique_lock<std::mutex> lk(mMtx);
+	mCVSlotReady.wait(lk, [&]() { return mbAborted || mSlots[mNextReadSlot].State == ESlotState::READY; });
+	if (mbAborted)
+		return INVALID_SLOT;
+
+	const int Slot = static_cast<int>(mNextReadSlot);
+	mNextReadSlot = (mNextReadSlot + 1) % GetNumSlots();
+	mSlots[Slot].State = ESlotState::READING;
+	mStats.ConsumerWaitMs += DurationMs(Clock::now() - WaitBegin).count();
+	return Slot;
+}
+
+void FrameSnapshotRing::EndRead(int Slot)
+{
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		assert(Slot >= 0 && mSlots[Slot].State == ESlotState::READING);
+		mSlots[Slot].State = ESlotState::FREE;
+
+		const double LatencyMs = DurationMs(Clock::now() - mSlots[Slot].WriteBeginTime).count();
+		++mStats.NumFramesConsumed;
+		mStats.AvgLatencyMs += (LatencyMs - mStats.AvgLatencyMs) / mStats.NumFramesConsumed;
+		mStats.MaxLatencyMs = std::max(mStats.MaxLatencyMs, LatencyMs);
+	}
+	mCVSlotFree.notify_all(); // BeginWrite() & WaitUntilConsumed()
+}
+
+FFrameSnapshotStats FrameSnapshotRing::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	return mStats;
+}
+
@@ -0,0 +1,89 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+struct FFrameSnapshotStats
+{
+	uint64 NumFramesPublished = 0;
+	uint64 NumFramesConsumed  = 0;
+	double AvgLatencyMs       = 0.0; // BeginWrite() -> EndRead(): from the start of the update to the end of the render of a frame
+	double MaxLatencyMs       = 0.0;
+	double ProducerWaitMs     = 0.0; // update thread waiting for a free slot: render bound
+	double ConsumerWaitMs     = 0.0; // render thread waiting for a published snapshot: update bound
+};
+
+// Hands the per-frame scene data over from the update thread to the render thread. The snapshots themselves
+// (FSceneView, FSceneShadowView and the post process parameters of the scene view) live in the Scene, indexed
+// by the slot; the ring tracks which thread owns each slot:
+//
+//   FREE --BeginWrite()--> WRITING --EndWrite()--> READY --BeginRead()--> READING --EndRead()--> FREE
+//        (update thread)                                  (render thread)
+//
+// The update thread can run up to Latency frames ahead of the render thread: w/ Latency=1, frame N-1 is rendered
+// while frame N is updated. Single producer, single consumer; snapshots are consumed in the order they're published.
+class FrameSnapshotRing
+{
+public:
+	static constexpr uint MAX_LATENCY = 3;
+	static constexpr int  INVALID_SLOT = -1;
+
+	void Initialize(uint Latency); // clamped to [1, MAX_LATENCY]
+	void Abort();                  // wakes up the waiting threads, Begin*() return INVALID_SLOT from then on
+
+	// update thread
+	int  BeginWrite();             // blocks until the next slot is free
+	void EndWrite(int Slot);       // publishes the snapshot
+	int  GetLastWrittenSlot() const; // the previous frame's snapshot, to carry over the persistent parameters
+	void WaitUntilConsumed();      // blocks until all the published snapshots are rendered
+
+	// render thread
+	int  BeginRead();              // blocks until a snapshot is published
+	void EndRead(int Slot);
+
+	inline uint GetLatency() const  { return mLatency; }
+	inline uint GetNumSlots() const { return mLatency + 1; }
+	FFrameSnapshotStats GetStats() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+	enum class ESlotState { FREE, WRITING, READY, READING };
+	struct FSlot
+	{
+		ESlotState        State = ESlotState::FREE;
+		Clock::time_point WriteBeginTime;
+	};
+
+	mutable std::mutex      mMtx;
+	std::condition_variable mCVSlotFree;
+	std::condition_variable mCVSlotReady;
+	std::array<FSlot, MAX_LATENCY + 1> mSlots;
+	uint                    mLatency = 1;
+	uint                    mNextWriteSlot = 0;
+	uint                    mNextReadSlot = 0;
+	int                     mLastWrittenSlot = INVALID_SLOT;
+	bool                    mbAborted = false;
+	FFrameSnapshotStats     mStats;
+};
@@ -17,6 +17,8 @@
 //	Contact: volkanilbeyli@gmail.com
 #pragma once
 
+#include "MemoryTracking.h"
+
 //
 // Resources on memory management
 //
@@ -95,6 +97,7 @@ inline MemoryPool<TObject>::MemoryPool(size_t NumBlocks, size_t Alignment)
 	assert(this->mpNextFreeBlock);
 	this->mpAlloc = this->mpNextFreeBlock;
 	this->mAllocSize = AllocSize;
+	MemoryTracking::OnAlloc(EMemoryTag::SCENE, AllocSize);
 
 	// setup list structure
 	Block* pWalk = this->mpNextFreeBlock;
@@ -139,7 +142,10 @@ inline MemoryPool<TObject>::~MemoryPool()
 	}
 
 	if (mpAlloc)
+	{
+		MemoryTracking::OnFree(EMemoryTag::SCENE, mAllocSize);
 		free(mpAlloc);
+	}
 }
 
 template<class TObject>
@@ -0,0 +1,192 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#define NOMINMAX
+#include "MemoryTracking.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace MemoryTracking
+{
+	static const char* TAG_NAMES[] =
+	{
+		  "Scene"
+		, "RenderCommands"
+		, "ModelImport"
+		, "ImageDecode"
+		, "ShaderBlobs"
+	};
+	static_assert(std::size(TAG_NAMES) == static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS), "Missing memory tag names");
+
+	// written by any thread
+	struct alignas(64) FTagCounters
+	{
+		std::atomic<int64>  NumBytesLive   = 0;
+		std::atomic<int64>  NumBytesPeak   = 0;
+		std::atomic<uint64> NumAllocations = 0;
+		std::atomic<uint64> NumFrees       = 0;
+	};
+	// written by the Tick() thread
+	struct FTagFrameCounters
+	{
+		uint64 NumAllocationsAtFirstTick = 0;
+		uint64 NumAllocationsAtLastTick  = 0;
+		uint64 NumAllocationsLastFrame   = 0;
+		uint64 MaxAllocationsPerFrame    = 0;
+		uint64 NumAllocationsThisSecond  = 0;
+		float  AllocationsPerSecond      = 0.0f;
+	};
+	static FTagCounters      sCounters     [static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS)];
+	static FTagFrameCounters sFrameCounters[static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS)];
+	static uint64 sNumFrames = 0;
+	static float  sSecondTimer = 0.0f;
+	static double sTickedTime = 0.0;
+
+	const char* GetTagName(EMemoryTag Tag)
+	{
+		return Tag < EMemoryTag::NUM_MEMORY_TAGS ? TAG_NAMES[static_cast<size_t>(Tag)] : "Unknown";
+	}
+
+#if VQENGINE_MEMORY_TRACKING
+	void OnAlloc(EMemoryTag Tag, size_t NumBytes)
+	{
+		FTagCounters& c = sCounters[static_cast<size_t>(Tag)];
+		c.NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		const int64 NumBytesLive = c.NumBytesLive.fetch_add(static_cast<int64>(NumBytes), std::memory_order_relaxed) + static_cast<int64>(NumBytes);
+		int64 NumBytesPeak = c.NumBytesPeak.load(std::memory_order_relaxed);
+		while (NumBytesLive > NumBytesPeak && !c.NumBytesPeak.compare_exchange_weak(NumBytesPeak, NumBytesLive, std::memory_order_relaxed));
+	}
+
+	void OnFree(EMemoryTag Tag, size_t NumBytes)
+	{
+		FTagCounters& c = sCounters[static_cast<size_t>(Tag)];
+		c.NumFrees.fetch_add(1, std::memory_order_relaxed);
+		c.NumBytesLive.fetch_sub(static_cast<int64>(NumBytes), std::memory_order_relaxed);
+	}
+#endif
+
+	std::shared_ptr<void> TrackAllocation(EMemoryTag Tag, size_t NumBytes)
+	{
+#if VQENGINE_MEMORY_TRACKING
+		OnAlloc(Tag, NumBytes);
+		return std::shared_ptr<void>(nullptr, [Tag, NumBytes](void*) { OnFree(Tag, NumBytes); });
+#else
+		return nullptr;
+#endif
+	}
+
+	void Tick(float dt)
+	{
+		const bool bFirstTick = sNumFrames == 0;
+		sSecondTimer += dt;
+		if (!bFirstTick)
+			sTickedTime += dt; // same span as the per-frame allocation counts
+		const bool bSecondElapsed = sSecondTimer >= 1.0f;
+
+		for (size_t i = 0; i < std::size(sCounters); ++i)
+		{
+			FTagFrameCounters& f = sFrameCounters[i];
+			const uint64 NumAllocations = sCounters[i].NumAllocations.load(std::memory_order_relaxed);
+			if (bFirstTick)
+			{
+				f.NumAllocationsAtFirstTick = f.NumAllocationsAtLastTick = NumAllocations;
+			}
+
+			f.NumAllocationsLastFrame = NumAllocations - f.NumAllocationsAtLastTick;
+			f.NumAllocationsAtLastTick = NumAllocations;
+			f.MaxAllocationsPerFrame = std::max(f.MaxAllocationsPerFrame, f.NumAllocationsLastFrame);
+			f.NumAllocationsThisSecond += f.NumAllocationsLastFrame;
+			if (bSecondElapsed)
+			{
+				f.AllocationsPerSecond = f.NumAllocationsThisSecond / sSecondTimer;
+				f.NumAllocationsThisSecond = 0;
+			}
+		}
+
+		if (bSecondElapsed)
+			sSecondTimer = 0.0f;
+		++sNumFrames;
+	}
+
+	FMemoryTagStats GetStats(EMemoryTag Tag)
+	{
+		const FTagCounters&      c = sCounters[static_cast<size_t>(Tag)];
+		const FTagFrameCounters& f = sFrameCounters[static_cast<size_t>(Tag)];
+		const uint64 NumAllocations = c.NumAllocations.load(std::memory_order_relaxed);
+		const uint64 NumFrees       = c.NumFrees.load(std::memory_order_relaxed);
+
+		FMemoryTagStats s;
+		s.pName = GetTagName(Tag);
+		s.NumBytesLive = static_cast<uint64>(std::max<int64>(0, c.NumBytesLive.load(std::memory_order_relaxed)));
+		s.NumBytesPeak = static_cast<uint64>(c.NumBytesPeak.load(std::memory_order_relaxed));
+		s.NumAllocations = NumAllocations;
+		s.NumLiveAllocations = NumAllocations > NumFrees ? NumAllocations - NumFrees : 0;
+		s.NumAllocationsLastFrame = f.NumAllocationsLastFrame;
+		s.MaxAllocationsPerFrame = f.MaxAllocationsPerFrame;
+		s.AllocationsPerSecond = f.AllocationsPerSecond;
+		return s;
+	}
+
+	bool WriteReport(const std::string& FilePath)
+	{
+		std::error_code ec;
+		const std::filesystem::path Directory = std::filesystem::path(FilePath).parent_path();
+		if (!Directory.empty())
+			std::filesystem::create_directories(Directory, ec);
+
+		std::ofstream File(FilePath, std::ios::out | std::ios::trunc);
+		if (!File.is_open())
+		{
+			Log::Error("[MemoryTracking] Cannot write the report: %s", FilePath.c_str());
+			return false;
+		}
+
+		File << "{\n";
+		File << "\"Enabled\":" << (VQENGINE_MEMORY_TRACKING ? "true" : "false") << ",\n";
+		File << "\"NumFrames\":" << sNumFrames << ",\n";
+		File << "\"Seconds\":" << sTickedTime << ",\n";
+		File << "\"Tags\":[\n";
+		for (size_t i = 0; i < std::size(sCounters); ++i)
+		{
+			const FMemoryTagStats s = GetStats(static_cast<EMemoryTag>(i));
+			const FTagFrameCounters& f = sFrameCounters[i];
+			const uint64 NumFrameAllocations = f.NumAllocationsAtLastTick - f.NumAllocationsAtFirstTick; // w/o the startup allocations
+
+			File << "{\"Name\":\"" << s.pName << "\""
+				<< ", \"BytesLive\":" << s.NumBytesLive
+				<< ", \"BytesPeak\":" << s.NumBytesPeak
+				<< ", \"NumAllocations\":" << s.NumAllocations
+				<< ", \"NumLiveAllocations\":" << s.NumLiveAllocations
+				<< ", \"AvgAllocationsPerFrame\":" << (sNumFrames > 1 ? double(NumFrameAllocations) / (sNumFrames - 1) : 0.0)
+				<< ", \"MaxAllocationsPerFrame\":" << s.MaxAllocationsPerFrame
+				<< ", \"AvgAllocationsPerSecond\":" << (sTickedTime > 0.0 ? NumFrameAllocations / sTickedTime : 0.0)
+				<< "}" << (i + 1 < std::size(sCounters) ? "," : "") << "\n";
+		}
+		File << "]\n}\n";
+
+		Log::Info("[MemoryTracking] Wrote the report: %s", FilePath.c_str());
+		return true;
+	}
+}
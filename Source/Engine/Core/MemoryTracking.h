@@ -0,0 +1,108 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <memory>
+#include <string>
+
+// 0: compiles out the allocation hooks, the tagged allocators & the tracking handles don't count anything.
+// Set w/ the VQENGINE_MEMORY_TRACKING CMake option, on by default.
+#ifndef VQENGINE_MEMORY_TRACKING
+#define VQENGINE_MEMORY_TRACKING 1
+#endif
+
+// CPU memory of the engine subsystems. The allocations are tracked explicitly at the allocation sites
+// the engine owns: the global operator new isn't hooked as the assimp DLL takes ownership of & frees
+// objects allocated by the engine (the VFS IO handler), which rules out a size header per allocation.
+enum class EMemoryTag : uint8
+{
+	SCENE = 0,       // Scene MemoryPools
+	RENDER_COMMANDS, // mesh/light/bounding box render command lists of the scene & shadow views
+	MODEL_IMPORT,    // vertex & index buffers converted from the assimp meshes before the GPU upload
+	IMAGE_DECODE,    // decoded texture images & the mip generation scratch images
+	SHADER_BLOBS,    // compiled & cached shader bytecode
+
+	NUM_MEMORY_TAGS
+};
+
+struct FMemoryTagStats
+{
+	const char* pName = nullptr;
+	uint64 NumBytesLive = 0;
+	uint64 NumBytesPeak = 0;
+	uint64 NumAllocations = 0;          // since startup
+	uint64 NumLiveAllocations = 0;
+	uint64 NumAllocationsLastFrame = 0;
+	uint64 MaxAllocationsPerFrame = 0;
+	float  AllocationsPerSecond = 0.0f; // over the last second
+};
+
+// Per-tag counters are updated w/ relaxed atomics, the hooks are thread-safe & lock-free.
+namespace MemoryTracking
+{
+	const char* GetTagName(EMemoryTag Tag);
+
+#if VQENGINE_MEMORY_TRACKING
+	void OnAlloc(EMemoryTag Tag, size_t NumBytes);
+	void OnFree(EMemoryTag Tag, size_t NumBytes);
+#else
+	inline void OnAlloc(EMemoryTag, size_t) {}
+	inline void OnFree(EMemoryTag, size_t) {}
+#endif
+
+	// For the memory allocated by other libraries (COM blobs etc.) that is copied around by reference: 
+	// the bytes are freed from the tag when the last copy of the returned handle is released.
+	std::shared_ptr<void> TrackAllocation(EMemoryTag Tag, size_t NumBytes);
+
+	// Call once per frame from the same thread: samples the per-frame & per-second allocation counts
+	void Tick(float dt);
+
+	FMemoryTagStats GetStats(EMemoryTag Tag);
+
+	// JSON report of the per-tag stats since startup
+	bool WriteReport(const std::string& FilePath);
+}
+
+// STL allocator that counts the container memory towards Tag, e.g.
+//    std::vector<FMeshRenderCommand, TaggedAllocator<FMeshRenderCommand, EMemoryTag::RENDER_COMMANDS>>
+template<class T, EMemoryTag Tag>
+struct TaggedAllocator
+{
+	using value_type = T;
+	template<class U> struct rebind { using other = TaggedAllocator<U, Tag>; };
+
+	TaggedAllocator() = default;
+	template<class U> TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+	inline T* allocate(size_t NumObjects)
+	{
+		T* p = std::allocator<T>().allocate(NumObjects);
+		MemoryTracking::OnAlloc(Tag, NumObjects * sizeof(T));
+		return p;
+	}
+	inline void deallocate(T* p, size_t NumObjects)
+	{
+		MemoryTracking::OnFree(Tag, NumObjects * sizeof(T));
+		std::allocator<T>().deallocate(p, NumObjects);
+	}
+};
+template<class T, class U, EMemoryTag Tag> inline bool operator==(const TaggedAllocator<T, Tag>&, const TaggedAllocator<U, Tag>&) { return true; }
+template<class T, class U, EMemoryTag Tag> inline bool operator!=(const TaggedAllocator<T, Tag>&, const TaggedAllocator<U, Tag>&) { return false; }
@@ -0,0 +1,92 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include "../../../Libs/VQUtils/Source/Multithreading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Fork-join loop over a ThreadPool. Header only so that both the engine & the renderer libraries can use it.
+//
+// Calls fnProcessItems(ItemBegin, ItemEnd) for chunks of ItemsPerTask items. The calling thread processes chunks as well
+// and only waits on the chunks that are already being processed: safe to call from a worker of pWorkers.
+// pWorkers == nullptr processes all the items on the calling thread.
+inline void ParallelFor(uint NumItems, uint ItemsPerTask, ThreadPool* pWorkers, const std::function<void(uint ItemBegin, uint ItemEnd)>& fnProcessItems)
+{
+	if (NumItems == 0)
+		return;
+	ItemsPerTask = std::max(1u, ItemsPerTask);
+	const uint NumTasks = (NumItems + ItemsPerTask - 1) / ItemsPerTask;
+	if (!pWorkers || NumTasks == 1)
+	{
+		fnProcessItems(0, NumItems);
+		return;
+	}
+
+	// Workers grab the next chunk until there's none left. This thread works on the chunks too, so
+	// the loop completes even if the pool is busy (or this thread is one of its workers): the helpers
+	// that get to run after the last chunk is taken return right away. The context is shared w/ them.
+	struct FContext
+	{
+		std::atomic<uint>       NextTask{ 0 };
+		std::atomic<uint>       NumTasksDone{ 0 };
+		std::mutex              Mtx;
+		std::condition_variable cvAllTasksDone;
+		const std::function<void(uint, uint)>* pfnProcessItems = nullptr; // only dereferenced for a valid task
+		uint NumItems = 0, ItemsPerTask = 0, NumTasks = 0;
+	};
+	std::shared_ptr<FContext> pCtx = std::make_shared<FContext>();
+	pCtx->pfnProcessItems = &fnProcessItems;
+	pCtx->NumItems = NumItems;
+	pCtx->ItemsPerTask = ItemsPerTask;
+	pCtx->NumTasks = NumTasks;
+
+	auto fnWork = [pCtx]()
+	{
+		FContext& ctx = *pCtx;
+		for (uint iTask = ctx.NextTask.fetch_add(1); iTask < ctx.NumTasks; iTask = ctx.NextTask.fetch_add(1))
+		{
+			const uint ItemBegin = iTask * ctx.ItemsPerTask;
+			const uint ItemEnd = std::min(ItemBegin + ctx.ItemsPerTask, ctx.NumItems);
+			(*ctx.pfnProcessItems)(ItemBegin, ItemEnd);
+			if (ctx.NumTasksDone.fetch_add(1) + 1 == ctx.NumTasks)
+			{
+				std::lock_guard<std::mutex> lk(ctx.Mtx);
+				ctx.cvAllTasksDone.notify_all();
+			}
+		}
+	};
+
+	const size_t NumHelpers = std::min<size_t>(NumTasks - 1, std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1));
+	for (size_t i = 0; i < NumHelpers; ++i)
+	{
+		pWorkers->AddTask(fnWork);
+	}
+	fnWork();
+
+	std::unique_lock<std::mutex> lk(pCtx->Mtx);
+	pCtx->cvAllTasksDone.wait(lk, [&]() { return pCtx->NumTasksDone.load() == pCtx->NumTasks; });
+}
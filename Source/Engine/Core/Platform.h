@@ -42,7 +42,10 @@ struct FStartupParameters
 	uint8 bOverrideGFXSetting_bUseTripleBuffering         : 1;
 	uint8 bOverrideGFXSetting_bAA                         : 1;
 	uint8 bOverrideGFXSetting_bMaxFrameRate               : 1;
+	uint8 bOverrideGFXSetting_FrameLimiterSpinThreshold   : 1;
 	uint8 bOverrideGFXSetting_bHDR                        : 1;
+	uint8 bOverrideGFXSetting_bTextureStreaming           : 1;
+	uint8 bOverrideGFXSetting_TextureStreamingBudget      : 1;
 
 	uint8 bOverrideENGSetting_MainWindowHeight            : 1;
 	uint8 bOverrideENGSetting_MainWindowWidth             : 1;
@@ -57,7 +60,16 @@ struct FStartupParameters
 
 	uint8 bOverrideENGSetting_bAutomatedTest              : 1;
 	uint8 bOverrideENGSetting_bTestFrames                 : 1;
+	uint8 bOverrideENGSetting_bBenchmarkRun               : 1;
+	uint8 bOverrideENGSetting_BenchmarkLevels             : 1;
+	uint8 bOverrideENGSetting_NumBenchmarkWarmupFrames    : 1;
+	uint8 bOverrideENGSetting_NumBenchmarkFrames          : 1;
+	uint8 bOverrideENGSetting_BenchmarkReportPath         : 1;
+	uint8 bOverrideENGSetting_MemoryReportPath            : 1;
 	uint8 bOverrideENGSetting_StartupScene                : 1;
+	uint8 bOverrideENGSetting_UpdateRenderFrameLatency    : 1;
+	uint8 bOverrideENGSetting_bBuildPakFile               : 1;
+	uint8 bOverrideENGSetting_bHotReloadShaders           : 1;
 };
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
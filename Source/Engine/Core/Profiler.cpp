@@ -0,0 +1,310 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#define NOMINMAX
+#include "Profiler.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler
+{
+	using Clock = std::chrono::steady_clock;
+
+	enum EEventType : uint32
+	{
+		EVENT_SCOPE = 0,
+		EVENT_COUNTER
+	};
+
+	struct FEvent
+	{
+		const char* pName;
+		uint64      TimeNs;  // begin of the scope / time of the counter sample
+		uint64      Payload; // duration of the scope in ns / bits of the counter value
+		uint32      Type;
+	};
+
+	// The export reads the slots while the owner thread may be overwriting them, like a seqlock: the fields are
+	// relaxed atomics (plain moves on x64) and the torn events are detected & dropped w/ the write counter.
+	struct FEventSlot
+	{
+		std::atomic<const char*> pName;
+		std::atomic<uint64>      TimeNs;
+		std::atomic<uint64>      Payload;
+		std::atomic<uint32>      Type;
+
+		inline void Store(const FEvent& e)
+		{
+			pName.store(e.pName, std::memory_order_relaxed);
+			TimeNs.store(e.TimeNs, std::memory_order_relaxed);
+			Payload.store(e.Payload, std::memory_order_relaxed);
+			Type.store(e.Type, std::memory_order_relaxed);
+		}
+		inline FEvent Load() const
+		{
+			FEvent e;
+			e.pName = pName.load(std::memory_order_relaxed);
+			e.TimeNs = TimeNs.load(std::memory_order_relaxed);
+			e.Payload = Payload.load(std::memory_order_relaxed);
+			e.Type = Type.load(std::memory_order_relaxed);
+			return e;
+		}
+	};
+	static_assert((EVENT_RING_SIZE & (EVENT_RING_SIZE - 1)) == 0, "EVENT_RING_SIZE must be a power of 2");
+
+	struct FThreadRing
+	{
+		std::unique_ptr<FEventSlot[]> pEvents;
+		std::atomic<uint64>       NumWritten{ 0 };
+		uint32                    ThreadIndex = 0;
+		std::string               Name;       // guarded by sMtxRings
+	};
+
+	static const Clock::time_point                   sEpoch = Clock::now();
+	static std::atomic<bool>                         sbEnabled{ true };
+	static std::mutex                                sMtxRings;
+	static std::vector<std::unique_ptr<FThreadRing>> sRings; // the rings outlive their threads, so that their events can be exported
+	static uint32                                    sNumThreadsRegistered = 0;
+	static thread_local FThreadRing*                 tlpRing = nullptr;
+
+	static std::string GetOSThreadName(uint32 ThreadIndex)
+	{
+#ifdef _WIN32
+		PWSTR pDescription = nullptr;
+		if (SUCCEEDED(GetThreadDescription(GetCurrentThread(), &pDescription)) && pDescription)
+		{
+			std::string Name;
+			const int Size = WideCharToMultiByte(CP_UTF8, 0, pDescription, -1, nullptr, 0, nullptr, nullptr);
+			if (Size > 1)
+			{
+				Name.resize(Size - 1);
+				WideCharToMultiByte(CP_UTF8, 0, pDescription, -1, &Name[0], Size, nullptr, nullptr);
+			}
+			LocalFree(pDescription);
+			if (!Name.empty())
+				return Name;
+		}
+#endif
+		return "Thread " + std::to_string(ThreadIndex);
+	}
+
+	static FThreadRing& GetThreadRing()
+	{
+		if (!tlpRing)
+		{
+			std::unique_ptr<FThreadRing> pRing = std::make_unique<FThreadRing>();
+			pRing->pEvents.reset(new FEventSlot[EVENT_RING_SIZE]);
+
+			std::lock_guard<std::mutex> lk(sMtxRings);
+			pRing->ThreadIndex = sNumThreadsRegistered++;
+			pRing->Name = GetOSThreadName(pRing->ThreadIndex);
+			tlpRing = pRing.get();
+			sRings.push_back(std::move(pRing));
+		}
+		return *tlpRing;
+	}
+
+	static inline void Write(FThreadRing& Ring, const FEvent& Event)
+	{
+		const uint64 Pos = Ring.NumWritten.load(std::memory_order_relaxed);
+		Ring.pEvents[Pos & (EVENT_RING_SIZE - 1)].Store(Event);
+		Ring.NumWritten.store(Pos + 1, std::memory_order_release);
+	}
+
+
+	void SetEnabled(bool bEnabled) { sbEnabled.store(bEnabled, std::memory_order_relaxed); }
+	bool IsEnabled() { return sbEnabled.load(std::memory_order_relaxed); }
+
+	uint64 GetTimeNs()
+	{
+		return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sEpoch).count());
+	}
+
+	void SetThreadName(const char* pName)
+	{
+		FThreadRing& Ring = GetThreadRing();
+		std::lock_guard<std::mutex> lk(sMtxRings);
+		Ring.Name = pName;
+	}
+
+	uint64 BeginScope()
+	{
+		if (!sbEnabled.load(std::memory_order_relaxed))
+			return 0;
+		GetThreadRing(); // EndScope() writes to it
+		return std::max<uint64>(GetTimeNs(), 1);
+	}
+
+	void EndScope(const char* pName, uint64 BeginTimeNs)
+	{
+		if (BeginTimeNs == 0)
+			return; // the profiler was disabled when the scope began
+
+		FEvent Event;
+		Event.pName = pName;
+		Event.TimeNs = BeginTimeNs;
+		Event.Payload = GetTimeNs() - BeginTimeNs;
+		Event.Type = EVENT_SCOPE;
+
+		Write(*tlpRing, Event); // registered by BeginScope()
+	}
+
+	void Counter(const char* pName, double Value)
+	{
+		if (!sbEnabled.load(std::memory_order_relaxed))
+			return;
+
+		FEvent Event;
+		Event.pName = pName;
+		Event.TimeNs = GetTimeNs();
+		static_assert(sizeof(Value) == sizeof(Event.Payload), "");
+		memcpy(&Event.Payload, &Value, sizeof(Value));
+		Event.Type = EVENT_COUNTER;
+		Write(GetThreadRing(), Event);
+	}
+
+
+	static void WriteJSONString(std::ostream& Out, const char* pStr)
+	{
+		Out << '"';
+		for (const char* p = pStr; *p; ++p)
+		{
+			if (*p == '"' || *p == '\\') Out << '\\';
+			if (static_cast<unsigned char>(*p) >= 0x20)
+				Out << *p;
+		}
+		Out << '"';
+	}
+
+	bool ExportChromeTrace(const std::string& FilePath)
+	{
+		const Clock::time_point ExportBegin = Clock::now();
+
+		std::error_code ec;
+		const std::filesystem::path Directory = std::filesystem::path(FilePath).parent_path();
+		if (!Directory.empty())
+			std::filesystem::create_directories(Directory, ec);
+
+		std::ofstream File(FilePath, std::ios::out | std::ios::trunc);
+		if (!File.is_open())
+		{
+			Log::Error("[Profiler] Cannot write the trace file: %s", FilePath.c_str());
+			return false;
+		}
+
+		// held for the whole export: the benchmark threads release their rings
+		std::lock_guard<std::mutex> lk(sMtxRings);
+
+		size_t NumEventsExported = 0;
+		std::vector<FEvent> Events;
+		char Line[512];
+		File << "{\"traceEvents\":[\n";
+		bool bFirstEvent = true;
+		for (const std::unique_ptr<FThreadRing>& pRing : sRings)
+		{
+			const FThreadRing& Ring = *pRing;
+			const uint32 TID = Ring.ThreadIndex;
+
+			File << (bFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << TID << ",\"args\":{\"name\":";
+			WriteJSONString(File, Ring.Name.c_str());
+			File << "}}";
+			bFirstEvent = false;
+
+			// copy the ring while its thread keeps recording, then drop the events that might have been
+			// overwritten during the copy: the oldest ones
+			const uint64 End   = Ring.NumWritten.load(std::memory_order_acquire);
+			const uint64 Begin = End > EVENT_RING_SIZE ? End - EVENT_RING_SIZE : 0;
+			Events.resize(static_cast<size_t>(End - Begin));
+			for (uint64 i = Begin; i < End; ++i)
+				Events[static_cast<size_t>(i - Begin)] = Ring.pEvents[i & (EVENT_RING_SIZE - 1)].Load();
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64 EndAfterCopy = Ring.NumWritten.load(std::memory_order_relaxed);
+			const uint64 ValidBegin = std::min(End, std::max(Begin, EndAfterCopy > EVENT_RING_SIZE ? EndAfterCopy - EVENT_RING_SIZE + 1 : 0));
+
+			for (size_t i = static_cast<size_t>(ValidBegin - Begin); i < Events.size(); ++i)
+			{
+				const FEvent& e = Events[i];
+				File << ",\n{\"name\":";
+				WriteJSONString(File, e.pName);
+				if (e.Type == EVENT_SCOPE)
+				{
+					snprintf(Line, sizeof(Line), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", TID, e.TimeNs / 1000.0, e.Payload / 1000.0);
+				}
+				else
+				{
+					double Value = 0.0;
+					memcpy(&Value, &e.Payload, sizeof(Value));
+					snprintf(Line, sizeof(Line), ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%g}}", TID, e.TimeNs / 1000.0, Value);
+				}
+				File << Line;
+			}
+			NumEventsExported += Events.size() - static_cast<size_t>(ValidBegin - Begin);
+		}
+		File << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+		if (!File.good())
+		{
+			Log::Error("[Profiler] Error writing the trace file: %s", FilePath.c_str());
+			return false;
+		}
+		Log::Info("[Profiler] Exported %zu events of %zu threads in %.2fms: %s", NumEventsExported, sRings.size()
+			, std::chrono::duration<double, std::milli>(Clock::now() - ExportBegin).count(), FilePath.c_str());
+		return true;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------
+// FRAME HISTORY
+//-------------------------------------------------------------------------------------------------------------
+void FrameHistory::Add(float Value)
+{
+	mValues[mNext] = Value;
+	mNext = (mNext + 1) % SIZE;
+	mCount = std::min(mCount + 1, SIZE);
+}
+
+float FrameHistory::GetMax() const
+{
+	float Max = 0.0f;
+	for (size_t i = 0; i < mCount; ++i) // the values are written from index 0 on
+		Max = std::max(Max, mValues[i]);
+	return Max;
+}
+
+float FrameHistory::GetAverage() const
+{
+	float Sum = 0.0f;
+	for (size_t i = 0; i < mCount; ++i)
+		Sum += mValues[i];
+	return mCount > 0 ? Sum / mCount : 0.0f;
+}
@@ -0,0 +1,70 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <string>
+
+// Portable instrumentation profiler. SCOPED_CPU_MARKER scopes & counters are recorded w/ nanosecond timestamps
+// into a fixed size ring per thread: only the owning thread writes to its ring, w/o locks or allocations after
+// the first event of the thread. The rings keep the last EVENT_RING_SIZE events of each thread, which can be
+// exported in the chrome://tracing JSON format (also read by Tracy's import-chrome tool).
+namespace Profiler
+{
+	constexpr size_t EVENT_RING_SIZE = 64 * 1024; // events per thread, power of 2
+
+	void   SetEnabled(bool bEnabled); // recording is enabled by default
+	bool   IsEnabled();
+	uint64 GetTimeNs();               // since startup
+
+	// Names the calling thread in the trace. The threads that don't call it are named after their OS thread
+	// description (the worker pools) or their thread id.
+	void SetThreadName(const char* pName);
+
+	// pName must outlive the profiler (string literals): only the pointer is recorded.
+	// BeginScope() returns the begin timestamp to pass to EndScope(), 0 if the profiler is disabled.
+	uint64 BeginScope();
+	void   EndScope(const char* pName, uint64 BeginTimeNs);
+	void   Counter(const char* pName, double Value);
+
+	// Writes the events in the rings of all the threads that recorded one, the threads keep recording
+	bool ExportChromeTrace(const std::string& FilePath);
+}
+
+// Fixed size ring of the recent values of a per-frame metric for the UI charts: ImGui::PlotLines() reads it
+// in place w/ GetOffset() instead of the history being slid by one every frame.
+class FrameHistory
+{
+public:
+	static constexpr size_t SIZE = 160;
+
+	void Add(float Value);
+
+	inline const float* GetData() const   { return mValues; }
+	inline int          GetOffset() const { return static_cast<int>(mNext); } // index of the oldest value
+	inline size_t       GetCount() const  { return mCount; }
+	float GetMax() const;
+	float GetAverage() const;
+
+private:
+	float  mValues[SIZE] = {};
+	size_t mNext  = 0;
+	size_t mCount = 0;
+};
@@ -0,0 +1,72 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+
+// std::promise w/ continuations: Then() runs the continuation right away if the value is set, otherwise on the
+// thread that sets it, usually a worker or the texture upload thread, so keep the continuations short.
+// Header only so that both the engine & the renderer libraries can use it.
+template<class T>
+class Promise
+{
+public:
+	using Continuation_t = std::function<void(const T&)>;
+
+	Promise() : mFuture(mPromise.get_future().share()) {}
+
+	inline const std::shared_future<T>& GetFuture() const { return mFuture; }
+
+	// call once
+	void SetValue(const T& Value)
+	{
+		mPromise.set_value(Value); // the continuations can read the future
+		std::vector<Continuation_t> Continuations;
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			mbValueSet = true;
+			std::swap(Continuations, mContinuations);
+		}
+		for (Continuation_t& fn : Continuations)
+			fn(Value);
+	}
+
+	void Then(Continuation_t&& fn)
+	{
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			if (!mbValueSet)
+			{
+				mContinuations.push_back(std::move(fn));
+				return;
+			}
+		}
+		fn(mFuture.get());
+	}
+
+private:
+	std::promise<T>             mPromise;
+	std::shared_future<T>       mFuture;
+	std::mutex                  mMtx;
+	bool                        mbValueSet = false;
+	std::vector<Continuation_t> mContinuations;
+};
@@ -19,8 +19,11 @@
 #pragma once
 
 #include "Types.h"
+#include "MemoryTracking.h"
+#include "Shaders/LightingConstantBufferData.h"
 #include <DirectXMath.h>
 #include <string>
+#include <vector>
 
 struct FMeshRenderCommandBase
 {
@@ -31,6 +34,9 @@ struct FMeshRenderCommand : public FMeshRenderCommandBase
 {
 	MaterialID matID = INVALID_ID;
 	DirectX::XMMATRIX matNormalTransformation; //ID ?
+	// material state of the frame: the update thread edits the materials & swaps their SRVs while the render thread draws
+	VQ_SHADER_DATA::MaterialData matData;
+	SRV_ID matSRV = INVALID_ID;
 	std::string ModelName;
 	std::string MaterialName;
 };
@@ -45,4 +51,8 @@ struct FWireframeRenderCommand : public FMeshRenderCommandBase
 	DirectX::XMFLOAT3 color;
 };
 using FLightRenderCommand = FWireframeRenderCommand;
-using FBoundingBoxRenderCommand = FWireframeRenderCommand;
\ No newline at end of file
+using FBoundingBoxRenderCommand = FWireframeRenderCommand;
+
+// render command lists are rebuilt every frame, their allocations are tracked to catch the per-frame regressions
+template<class TRenderCommand>
+using RenderCommandList = std::vector<TRenderCommand, TaggedAllocator<TRenderCommand, EMemoryTag::RENDER_COMMANDS>>;
@@ -32,35 +32,28 @@ void VQEngine::MainThread_HandleEvents()
 	if (mEventQueue_VQEToWin_Main.IsEmpty())
 		return;
 
-	// Swap event recording buffers so we can read & process a limited number of events safely.
-	mEventQueue_VQEToWin_Main.SwapBuffers();
-	std::queue<EventPtr_t>& q = mEventQueue_VQEToWin_Main.GetBackContainer();
-
-	// process the events
-	std::shared_ptr<IEvent> pEvent = nullptr;
-	while (!q.empty())
+	// process the events recorded so far
+	mEventQueue_VQEToWin_Main.Drain([&](const FEventRecord& Event)
 	{
-		pEvent = std::move(q.front());
-		q.pop();
-
-		switch (pEvent->mType)
+		const IEvent& e = Event.Get();
+		switch (e.mType)
 		{
 		case MOUSE_CAPTURE_EVENT:
 		{
-			std::shared_ptr<SetMouseCaptureEvent> p = std::static_pointer_cast<SetMouseCaptureEvent>(pEvent);
-			this->SetMouseCaptureForWindow(p->hwnd, p->bCapture, p->bReleaseAtCapturedPosition);
+			const SetMouseCaptureEvent& p = Event.Get<SetMouseCaptureEvent>();
+			this->SetMouseCaptureForWindow(p.hwnd, p.bCapture, p.bReleaseAtCapturedPosition);
 		} break;
 		case HANDLE_WINDOW_TRANSITIONS_EVENT:
 		{
-			auto& pWnd = this->GetWindow(pEvent->hwnd);
-			HandleWindowTransitions(pWnd, this->GetWindowSettings(pEvent->hwnd));
+			auto& pWnd = this->GetWindow(e.hwnd);
+			HandleWindowTransitions(pWnd, this->GetWindowSettings(e.hwnd));
 		} break;
 		case SHOW_WINDOW_EVENT:
 		{
-			this->GetWindow(pEvent->hwnd)->Show();
+			this->GetWindow(e.hwnd)->Show();
 		} break;
 		}
-	}
+	});
 }
 
 void VQEngine::HandleWindowTransitions(std::unique_ptr<Window>& pWin, const FWindowSettings& settings)
@@ -182,93 +175,87 @@ static void UpdateImGui_MousePosition1(long x, long y)
 
 void VQEngine::UpdateThread_HandleEvents()
 {
-	// Swap event recording buffers so we can read & process a limited number of events safely.
-	mEventQueue_WinToVQE_Update.SwapBuffers();
-	std::queue<EventPtr_t>& q = mEventQueue_WinToVQE_Update.GetBackContainer();
-
-	if (q.empty())
-		return;
-
-	// process the events
-	std::shared_ptr<IEvent> pEvent = nullptr;
-	while (!q.empty())
+	// process the events recorded so far: the ones pushed while draining are processed next frame
+	mEventQueue_WinToVQE_Update.Drain([&](const FEventRecord& Event)
 	{
-		pEvent = std::move(q.front());
-		q.pop();
-
-		switch (pEvent->mType)
+		switch (Event.Get().mType)
 		{
 		case KEY_DOWN_EVENT:
 		{
-			std::shared_ptr<KeyDownEvent> p = std::static_pointer_cast<KeyDownEvent>(pEvent);
-			mInputStates.at(p->hwnd).UpdateKeyDown(p->data);
-			UpdateImGui_KeyDown(p->data);
+			const KeyDownEvent& p = Event.Get<KeyDownEvent>();
+			mInputStates.at(p.hwnd).UpdateKeyDown(p.data);
+			UpdateImGui_KeyDown(p.data);
 
 		} break;
 		case KEY_UP_EVENT:
 		{
-			std::shared_ptr<KeyUpEvent> p = std::static_pointer_cast<KeyUpEvent>(pEvent);
-			mInputStates.at(p->hwnd).UpdateKeyUp(p->wparam, p->bMouseEvent);
-			UpdateImGui_KeyUp(p->wparam, p->bMouseEvent);
+			const KeyUpEvent& p = Event.Get<KeyUpEvent>();
+			mInputStates.at(p.hwnd).UpdateKeyUp(p.wparam, p.bMouseEvent);
+			UpdateImGui_KeyUp(p.wparam, p.bMouseEvent);
 		} break;
 
 		case MOUSE_MOVE_EVENT:
 		{
-			std::shared_ptr<MouseMoveEvent> p = std::static_pointer_cast<MouseMoveEvent>(pEvent);
-			mInputStates.at(p->hwnd).UpdateMousePos(p->x, p->y, 0);
-			UpdateImGui_MousePosition1(p->x, p->y);
+			const MouseMoveEvent& p = Event.Get<MouseMoveEvent>();
+			mInputStates.at(p.hwnd).UpdateMousePos(p.x, p.y, 0);
+			UpdateImGui_MousePosition1(p.x, p.y);
 		} break;
 		case MOUSE_SCROLL_EVENT:
 		{
-			std::shared_ptr<MouseScrollEvent> p = std::static_pointer_cast<MouseScrollEvent>(pEvent);
-			mInputStates.at(p->hwnd).UpdateMousePos(0, 0, p->scroll);
+			const MouseScrollEvent& p = Event.Get<MouseScrollEvent>();
+			mInputStates.at(p.hwnd).UpdateMousePos(0, 0, p.scroll);
 		} break;
 		case MOUSE_INPUT_EVENT:
 		{
-			std::shared_ptr<MouseInputEvent> p = std::static_pointer_cast<MouseInputEvent>(pEvent);
+			const MouseInputEvent& p = Event.Get<MouseInputEvent>();
+			float ScrollDelta = p.data.scrollDelta;
 
 			// discard the scroll event if its outside the application window
-			if (p->data.scrollDelta)
+			if (ScrollDelta)
 			{
 				POINT pt; GetCursorPos(&pt);
-				ScreenToClient(p->hwnd, &pt);
+				ScreenToClient(p.hwnd, &pt);
 				
 				const bool bOutOfWindow = pt.x < 0 || pt.y < 0 
-					|| pt.x > this->GetWindow(p->hwnd)->GetWidth() 
-					|| pt.y > this->GetWindow(p->hwnd)->GetHeight();
+					|| pt.x > this->GetWindow(p.hwnd)->GetWidth() 
+					|| pt.y > this->GetWindow(p.hwnd)->GetHeight();
 				if (bOutOfWindow)
 				{
-					p->data.scrollDelta = 0;
+					ScrollDelta = 0;
 				}
 			}
 
-			mInputStates.at(p->hwnd).UpdateMousePos_Raw(
-				  p->data.relativeX
-				, p->data.relativeY
-				, static_cast<short>(p->data.scrollDelta)
+			mInputStates.at(p.hwnd).UpdateMousePos_Raw(
+				  p.data.relativeX
+				, p.data.relativeY
+				, static_cast<short>(ScrollDelta)
 			);
 
 			ImGuiIO& io = ImGui::GetIO();
-			UpdateImGui_MousePosition(pEvent->hwnd);
-			io.MouseWheel += p->data.scrollDelta;
+			UpdateImGui_MousePosition(p.hwnd);
+			io.MouseWheel += ScrollDelta;
 		} break;
-		case WINDOW_RESIZE_EVENT: UpdateThread_HandleWindowResizeEvent(pEvent);  break;
+		case WINDOW_RESIZE_EVENT: UpdateThread_HandleWindowResizeEvent(&Event.Get());  break;
+		case SET_SWAPCHAIN_FORMAT_EVENT: UpdateThread_HandleSetSwapchainFormatEvent(&Event.Get()); break;
 		}
-	}
+	});
 
 }
 
-void VQEngine::UpdateThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent>& pEvent)
+void VQEngine::UpdateThread_HandleWindowResizeEvent(const IEvent* pEvent)
 {
-	std::shared_ptr<WindowResizeEvent> p = std::static_pointer_cast<WindowResizeEvent>(pEvent);
+	const WindowResizeEvent* p = static_cast<const WindowResizeEvent*>(pEvent);
 
 	const uint uWidth  = p->width ;
 	const uint uHeight = p->height;
 
 	if (p->hwnd == mpWinMain->GetHWND())
 	{
-		SwapChain& Swapchain = mRenderer.GetWindowSwapChain(p->hwnd);
-		const int NUM_BACK_BUFFERS =  Swapchain.GetNumBackBuffers();
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+		const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update; // the published snapshots are only read by the render thread
+#else
+		const int FRAME_DATA_INDEX = 0;
+#endif
 
 		// Update Camera Projection Matrices
 		Camera& cam = mpScene->GetActiveCamera(); // TODO: all cameras?
@@ -278,9 +265,8 @@ void VQEngine::UpdateThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent
 		cam.SetProjectionMatrix(UpdatedProjectionMatrixParams);
 
 		// Update PostProcess Data
-		for (int i = 0; i < NUM_BACK_BUFFERS; ++i)
 		{
-			FPostProcessParameters& PPParams = mpScene->GetPostProcessParameters(i);
+			FPostProcessParameters& PPParams = mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
 
 			// Update FidelityFX constant blocks
 			if (PPParams.IsFFXCASEnabled())
@@ -299,6 +285,22 @@ void VQEngine::UpdateThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent
 	}
 }
 
+void VQEngine::UpdateThread_HandleSetSwapchainFormatEvent(const IEvent* pEvent)
+{
+	const SetSwapchainFormatEvent* p = static_cast<const SetSwapchainFormatEvent*>(pEvent);
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
+#else
+	const int FRAME_DATA_INDEX = 0;
+#endif
+	if (p->hwnd != mpWinMain->GetHWND() || !mpScene)
+		return;
+
+	// same test as SwapChain::IsHDRFormat(), the render thread has already switched the format
+	const bool bHDRFormat = p->format == DXGI_FORMAT_R16G16B16A16_FLOAT || p->format == DXGI_FORMAT_R10G10B10A2_UNORM;
+	mpScene->GetPostProcessParameters(FRAME_DATA_INDEX).TonemapperParams.OutputDisplayCurve = bHDRFormat ? EDisplayCurve::Linear : EDisplayCurve::sRGB;
+}
+
 
 
 // ------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -314,47 +316,39 @@ void VQEngine::RenderThread_HandleEvents()
 	if (mbStopAllThreads)
 		return;
 
-	// Swap event recording buffers so we can read & process a limited number of events safely.
-	//   Otherwise, theoretically the producer (Main) thread could keep adding new events 
-	//   while we're spinning on the queue items below, and cause render thread to stall while, say, resizing.
-	mEventQueue_WinToVQE_Renderer.SwapBuffers();
-	std::queue<EventPtr_t>& q = mEventQueue_WinToVQE_Renderer.GetBackContainer();
-
-	if (q.empty())
+	if (mEventQueue_WinToVQE_Renderer.IsEmpty())
 		return;
 
 	// keep track of the resize events per HWND and only handle the last one 
-	std::unordered_map<HWND, std::shared_ptr<WindowResizeEvent>> pLastResizeEventLookup;
+	std::unordered_map<HWND, WindowResizeEvent> LastResizeEventLookup;
 
-	// process the events
-	std::shared_ptr<IEvent> pEvent = nullptr;
-	while (!q.empty())
+	// Only process the events recorded so far. Otherwise, theoretically the producer (Main) thread could keep adding new events 
+	// while we're spinning on the queue items below, and cause render thread to stall while, say, resizing.
+	mEventQueue_WinToVQE_Renderer.Drain([&](const FEventRecord& Event)
 	{
-		pEvent = std::move(q.front());
-		q.pop();
-
+		const IEvent* pEvent = &Event.Get();
 		switch (pEvent->mType)
 		{
-		case EEventType::WINDOW_RESIZE_EVENT             : pLastResizeEventLookup[pEvent->hwnd] = std::static_pointer_cast<WindowResizeEvent>(pEvent); break;
-		case EEventType::TOGGLE_FULLSCREEN_EVENT         : RenderThread_HandleToggleFullscreenEvent(pEvent.get()); break;
-		case EEventType::WINDOW_CLOSE_EVENT              : RenderThread_HandleWindowCloseEvent(pEvent.get()); break;
-		case EEventType::SET_VSYNC_EVENT                 : RenderThread_HandleSetVSyncEvent(pEvent.get()); break;
-		case EEventType::SET_SWAPCHAIN_FORMAT_EVENT      : RenderThread_HandleSetSwapchainFormatEvent(pEvent.get()); break;
-		case EEventType::SET_HDR10_STATIC_METADATA_EVENT : RenderThread_HandleSetHDRMetaDataEvent(pEvent.get()); break;
+		case EEventType::WINDOW_RESIZE_EVENT             : LastResizeEventLookup.insert_or_assign(pEvent->hwnd, Event.Get<WindowResizeEvent>()); break;
+		case EEventType::TOGGLE_FULLSCREEN_EVENT         : RenderThread_HandleToggleFullscreenEvent(pEvent); break;
+		case EEventType::WINDOW_CLOSE_EVENT              : RenderThread_HandleWindowCloseEvent(pEvent); break;
+		case EEventType::SET_VSYNC_EVENT                 : RenderThread_HandleSetVSyncEvent(pEvent); break;
+		case EEventType::SET_SWAPCHAIN_FORMAT_EVENT      : RenderThread_HandleSetSwapchainFormatEvent(pEvent); break;
+		case EEventType::SET_HDR10_STATIC_METADATA_EVENT : RenderThread_HandleSetHDRMetaDataEvent(pEvent); break;
 		}
-	}
+	});
 
 	// Handle the last resize event per hwnd and ignore the rest of it so the app can stay responsive while resizing.
-	for (auto it = pLastResizeEventLookup.begin(); it != pLastResizeEventLookup.end(); ++it)
+	for (auto it = LastResizeEventLookup.begin(); it != LastResizeEventLookup.end(); ++it)
 	{
-		RenderThread_HandleWindowResizeEvent(it->second);
+		RenderThread_HandleWindowResizeEvent(&it->second);
 	}
 
 }
 
-void VQEngine::RenderThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent>& pEvent)
+void VQEngine::RenderThread_HandleWindowResizeEvent(const IEvent* pEvent)
 {
-	const std::shared_ptr<WindowResizeEvent> pResizeEvent = std::static_pointer_cast<WindowResizeEvent>(pEvent);
+	const WindowResizeEvent* pResizeEvent = static_cast<const WindowResizeEvent*>(pEvent);
 	const HWND&                      hwnd = pResizeEvent->hwnd;
 	const int                       WIDTH = pResizeEvent->width;
 	const int                      HEIGHT = pResizeEvent->height;
@@ -379,10 +373,10 @@ void VQEngine::RenderThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent
 	const FSetHDRMetaDataParams HDRMetaData = this->GatherHDRMetaDataParameters(hwnd);
 
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	mEventQueue_WinToVQE_Update.AddItem(pResizeEvent);
+	mEventQueue_WinToVQE_Update.Push(*pResizeEvent);
 #endif
 
-	Swapchain.WaitForGPU();
+	Swapchain.WaitForGPU(); // the back buffers & the AO pass' resources are released immediately
 	Swapchain.Resize(WIDTH, HEIGHT, Swapchain.GetFormat());
 	if (bFullscreenTransition)
 	{
@@ -396,7 +390,12 @@ void VQEngine::RenderThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent
 	pWnd->OnResize(WIDTH, HEIGHT);
 	mRenderer.OnWindowSizeChanged(hwnd, WIDTH, HEIGHT);
 
-	const auto& PPParams = this->mpScene->GetPostProcessParameters(0);
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Render;
+#else
+	const int FRAME_DATA_INDEX = 0;
+#endif
+	const auto& PPParams = this->mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
 	const bool bFSREnabled = PPParams.IsFSREnabled() && !bUseHDRRenderPath; // TODO: remove this when FSR-HDR is implemented
 	const bool bUpscaling = bFSREnabled || 0; // update here when other upscaling methods are added
 
@@ -415,14 +414,15 @@ void VQEngine::RenderThread_HandleWindowCloseEvent(const IEvent* pEvent)
 
 	Log::Info("RenderThread: Handle Window Close event <%x>", hwnd);
 
+	Swapchain.WaitForGPU(); // the AO pass' screen size dependent resources aren't released on the frame fence
 	RenderThread_UnloadWindowSizeDependentResources(hwnd);
-	pWindowCloseEvent->Signal_WindowDependentResourcesDestroyed.NotifyAll();
+	pWindowCloseEvent->pSignal_WindowDependentResourcesDestroyed->NotifyAll();
 
 	if (hwnd == mpWinMain->GetHWND())
 	{
 		mbStopAllThreads.store(true);
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-		RenderThread_SignalUpdateThread();
+		mFrameSnapshots.Abort(); // no more snapshots are rendered, wake up the update thread if it's waiting for a free slot
 #endif
 	}
 }
@@ -456,9 +456,14 @@ void VQEngine::RenderThread_HandleToggleFullscreenEvent(const IEvent* pEvent)
 		WndSettings_.Height = pWnd->GetHeight();
 	}
 
-	Swapchain.WaitForGPU(); // make sure GPU is finished
+	Swapchain.WaitForGPU(); // make sure GPU is finished: the back buffers & the AO pass' resources are released immediately
 
-	const auto& PPParams = this->mpScene->GetPostProcessParameters(0);
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Render;
+#else
+	const int FRAME_DATA_INDEX = 0;
+#endif
+	const auto& PPParams = this->mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
 	const bool bFSREnabled = PPParams.IsFSREnabled();
 	const bool bUpscaling = bFSREnabled || 0; // update here when other upscaling methods are added
 
@@ -524,7 +529,7 @@ void VQEngine::RenderThread_HandleSetVSyncEvent(const IEvent* pEvent)
 	const int                             WIDTH = bFullscreenState ? pWnd->GetFullscreenWidth() : pWnd->GetWidth();
 	const int                            HEIGHT = bFullscreenState ? pWnd->GetFullscreenHeight() : pWnd->GetHeight();
 
-	Swapchain.WaitForGPU(); // make sure GPU is finished
+	Swapchain.WaitForGPU(); // make sure GPU is finished: the back buffers & the AO pass' resources are released immediately
 	{
 		auto& ctx = mRenderer.GetWindowRenderContext(hwnd);
 
@@ -582,11 +587,9 @@ void VQEngine::RenderThread_HandleSetSwapchainFormatEvent(const IEvent* pEvent)
 
 	mbMainWindowHDRTransitionInProgress.store(false);
 
-	const int NUM_BACK_BUFFERS  = Swapchain.GetNumBackBuffers();
-	const int BACK_BUFFER_INDEX = Swapchain.GetCurrentBackBufferIndex();
+	// the update thread owns the post process parameters, it picks the display curve from the format
 	const EDisplayCurve OutputDisplayCurve = Swapchain.IsHDRFormat() ? EDisplayCurve::Linear : EDisplayCurve::sRGB;
-	for (int i = 0; i < NUM_BACK_BUFFERS; ++i)
-		mpScene->GetPostProcessParameters(i).TonemapperParams.OutputDisplayCurve = OutputDisplayCurve;
+	mEventQueue_WinToVQE_Update.Push(*pSwapchainEvent);
 	
 	Log::Info("Set Swapchain Format: %s | OutputDisplayCurve: %s"
 		, VQRenderer::DXGIFormatAsString(pSwapchainEvent->format).data()
@@ -216,14 +216,14 @@ void VQEngine::OnWindowResize(HWND hWnd)
 	if (w == 0) { w = 8; Log::Warning("WND RESIZE TOO SMALL"); }
 #endif
 
-	mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<WindowResizeEvent>(w, h, hWnd));
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<WindowResizeEvent>(w, h, hWnd));
+	mEventQueue_WinToVQE_Renderer.Push(WindowResizeEvent(w, h, hWnd));
+	mEventQueue_WinToVQE_Update.Push(WindowResizeEvent(w, h, hWnd));
 }
 
 void VQEngine::OnToggleFullscreen(HWND hWnd)
 {
-	mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<ToggleFullscreenEvent>(hWnd));
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<ToggleFullscreenEvent>(hWnd));
+	mEventQueue_WinToVQE_Renderer.Push(ToggleFullscreenEvent(hWnd));
+	mEventQueue_WinToVQE_Update.Push(ToggleFullscreenEvent(hWnd));
 }
 
 //------------------------------------------------------------------------------------
@@ -280,12 +280,12 @@ void VQEngine::DispatchHDRSwapchainTransitionEvents(HWND hwnd)
 			, (bCurrentMonitorSupportsHDR ? "HDR-capable" : "SDR")
 		);
 		mbMainWindowHDRTransitionInProgress.store(true);
-		mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetSwapchainFormatEvent>(hwnd, FORMAT));
+		mEventQueue_WinToVQE_Renderer.Push(SetSwapchainFormatEvent(hwnd, FORMAT));
 
 		// recycle resize events to reload frame-dependent resources in order to
 		// update tonemapper PSO so it has the right HDR or SDR output
-		mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<WindowResizeEvent>(W, H, hwnd));
-		mEventQueue_WinToVQE_Update.AddItem(std::make_unique<WindowResizeEvent>(W, H, hwnd));
+		mEventQueue_WinToVQE_Renderer.Push(WindowResizeEvent(W, H, hwnd));
+		mEventQueue_WinToVQE_Update.Push(WindowResizeEvent(W, H, hwnd));
 	}
 }
 
@@ -323,10 +323,10 @@ void VQEngine::OnWindowCreate(HWND hWnd)
 
 void VQEngine::OnWindowClose(HWND hwnd_)
 {
-	std::shared_ptr<WindowCloseEvent> ptr = std::make_shared<WindowCloseEvent>(hwnd_);
-	mEventQueue_WinToVQE_Renderer.AddItem(ptr);
+	Signal Signal_WindowDependentResourcesDestroyed;
+	mEventQueue_WinToVQE_Renderer.Push(WindowCloseEvent(hwnd_, &Signal_WindowDependentResourcesDestroyed));
 
-	ptr->Signal_WindowDependentResourcesDestroyed.Wait();
+	Signal_WindowDependentResourcesDestroyed.Wait();
 	if (hwnd_ == mpWinMain->GetHWND())
 	{
 		PostQuitMessage(0); // must be called from the main thread.
@@ -368,13 +368,13 @@ void VQEngine::OnWindowLoseFocus(HWND hwnd)
 void VQEngine::OnKeyDown(HWND hwnd, WPARAM wParam)
 {
 	constexpr bool bIsMouseEvent = false;
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<KeyDownEvent>(hwnd, wParam, bIsMouseEvent));
+	mEventQueue_WinToVQE_Update.Push(KeyDownEvent(hwnd, wParam, bIsMouseEvent));
 }
 
 void VQEngine::OnKeyUp(HWND hwnd, WPARAM wParam)
 {
 	constexpr bool bIsMouseEvent = false;
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<KeyUpEvent>(hwnd, wParam, bIsMouseEvent));
+	mEventQueue_WinToVQE_Update.Push(KeyUpEvent(hwnd, wParam, bIsMouseEvent));
 }
 
 
@@ -386,25 +386,26 @@ void VQEngine::OnKeyUp(HWND hwnd, WPARAM wParam)
 void VQEngine::OnMouseButtonDown(HWND hwnd, WPARAM wParam, bool bIsDoubleClick)
 {
 	constexpr bool bIsMouseEvent = true;
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<KeyDownEvent>(hwnd, wParam, bIsMouseEvent, bIsDoubleClick));
+	mEventQueue_WinToVQE_Update.Push(KeyDownEvent(hwnd, wParam, bIsMouseEvent, bIsDoubleClick));
 }
 
 void VQEngine::OnMouseButtonUp(HWND hwnd, WPARAM wParam)
 {
 	constexpr bool bIsMouseEvent = true;
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<KeyUpEvent>(hwnd, wParam, bIsMouseEvent));
+	mEventQueue_WinToVQE_Update.Push(KeyUpEvent(hwnd, wParam, bIsMouseEvent));
 }
 
 void VQEngine::OnMouseScroll(HWND hwnd, short scroll)
 {
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<MouseScrollEvent>(hwnd, scroll));
+	mEventQueue_WinToVQE_Update.Push(MouseScrollEvent(hwnd, scroll));
 }
 
 
 void VQEngine::OnMouseMove(HWND hwnd, long x, long y)
 {
 	//Log::Info("MouseMove : (%ld, %ld)", x, y);
-	mEventQueue_WinToVQE_Update.AddItem(std::make_unique<MouseMoveEvent>(hwnd, x, y));
+	// dropped if the update thread is too far behind, the next one has the latest position
+	mEventQueue_WinToVQE_Update.TryPush(MouseMoveEvent(hwnd, x, y), mEventQueue_WinToVQE_Update.GetCapacity() / 2);
 }
 
 
@@ -415,7 +416,8 @@ void VQEngine::OnMouseInput(HWND hwnd, LPARAM lParam)
 
 	if (bMouseInputEvent)
 	{
-		mEventQueue_WinToVQE_Update.AddItem(std::make_shared<MouseInputEvent>(data, hwnd));
+		// dropped if the update thread is too far behind
+		mEventQueue_WinToVQE_Update.TryPush(MouseInputEvent(data, hwnd), mEventQueue_WinToVQE_Update.GetCapacity() / 2);
 	}
 }
 
@@ -0,0 +1,596 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#define NOMINMAX
+#include "VirtualFileSystem.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+static constexpr uint32 PAK_FILE_MAGIC       = 0x4B505156; // "VQPK"
+static constexpr uint32 PAK_FILE_VERSION     = 1;
+static constexpr uint64 PAK_ENTRY_ALIGNMENT  = 4096;
+static constexpr float  PAK_COMPRESSION_KEEP_RATIO = 0.9f; // store uncompressed unless it saves at least 10%
+
+namespace
+{
+	enum EPakCompression : uint32
+	{
+		PAK_COMPRESSION_NONE = 0,
+		PAK_COMPRESSION_LZ4,
+	};
+
+	struct FPakHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumEntries;
+		uint32 Reserved;
+		uint64 TOCOffset;
+		uint64 StringTableOffset;
+		uint64 StringTableSize;
+	};
+
+	struct FPakEntry
+	{
+		uint64 PathHash;
+		uint64 DataOffset;
+		uint64 StoredSize; // == Size when uncompressed
+		uint64 Size;
+		uint32 PathOffset; // into the string table
+		uint32 PathLength;
+		uint32 Compression;
+		uint32 Reserved;
+	};
+
+	struct FMountedPakFile
+	{
+		std::string                  FilePath;
+		std::shared_ptr<FMappedFile> pFile;
+		const FPakEntry*             pEntries = nullptr; // in the mapping, sorted by PathHash
+		uint32                       NumEntries = 0;
+		const char*                  pStringTable = nullptr;
+
+		const FPakEntry* Find(uint64 PathHash, const std::string& NormalizedPath) const;
+	};
+}
+
+static std::shared_mutex             sMtxMountedPakFiles;
+static std::vector<FMountedPakFile>  sMountedPakFiles;
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// MEMORY MAPPED FILE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+FMappedFile::~FMappedFile()
+{
+	if (mpView)    UnmapViewOfFile(mpView);
+	if (mhMapping) CloseHandle(mhMapping);
+	if (mhFile)    CloseHandle(mhFile);
+}
+
+bool FMappedFile::Open(const std::string& FilePath)
+{
+	assert(mhFile == nullptr);
+	HANDLE hFile = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	mhFile = hFile;
+
+	LARGE_INTEGER FileSize = {};
+	if (!GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart == 0)
+		return false;
+
+	mhMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mhMapping)
+		return false;
+
+	mpView = MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0);
+	mSize = static_cast<size_t>(FileSize.QuadPart);
+	return mpView != nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// LZ4 BLOCK FORMAT
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+// Minimal codec for the LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md):
+// greedy single-probe hash matching for compression, bounds checked decompression.
+namespace LZ4
+{
+	static constexpr size_t MIN_MATCH     = 4;
+	static constexpr size_t LAST_LITERALS = 5;  // the last 5 bytes are always literals
+	static constexpr size_t MF_LIMIT      = 12; // the last match starts at least 12 bytes before the end
+	static constexpr size_t MAX_OFFSET    = 65535;
+	static constexpr int    HASH_LOG      = 16;
+
+	static inline uint32 Read32(const uint8* p) { uint32 v; memcpy(&v, p, sizeof(v)); return v; }
+	static inline uint32 Hash(uint32 Sequence) { return (Sequence * 2654435761u) >> (32 - HASH_LOG); }
+
+	static inline size_t CompressBound(size_t Size) { return Size + Size / 255 + 16; }
+
+	static inline uint8* WriteLength(uint8* op, size_t Length)
+	{
+		for (; Length >= 255; Length -= 255) *op++ = 255;
+		*op++ = static_cast<uint8>(Length);
+		return op;
+	}
+
+	// returns the compressed size, pDst should have CompressBound(SrcSize) bytes
+	static size_t Compress(const uint8* pSrc, size_t SrcSize, uint8* pDst)
+	{
+		std::vector<uint32> HashTable(size_t(1) << HASH_LOG, 0);
+		const uint8* ip     = pSrc;
+		const uint8* anchor = pSrc;
+		const uint8* iend   = pSrc + SrcSize;
+		uint8*       op     = pDst;
+
+		if (SrcSize > MF_LIMIT)
+		{
+			const uint8* mflimit    = iend - MF_LIMIT;
+			const uint8* matchlimit = iend - LAST_LITERALS;
+			while (ip < mflimit)
+			{
+				const uint32 Sequence = Read32(ip);
+				const uint32 h = Hash(Sequence);
+				const uint8* ref = pSrc + HashTable[h];
+				HashTable[h] = static_cast<uint32>(ip - pSrc);
+
+				if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET || Read32(ref) != Sequence)
+				{
+					++ip;
+					continue;
+				}
+
+				const uint8* MatchStart = ip;
+				const size_t Offset = static_cast<size_t>(ip - ref);
+				ip += MIN_MATCH; ref += MIN_MATCH;
+				while (ip < matchlimit && *ip == *ref) { ++ip; ++ref; }
+
+				const size_t LiteralLength = static_cast<size_t>(MatchStart - anchor);
+				const size_t MatchLength   = static_cast<size_t>(ip - MatchStart) - MIN_MATCH;
+
+				uint8* pToken = op++;
+				*pToken = static_cast<uint8>((std::min<size_t>(LiteralLength, 15) << 4) | std::min<size_t>(MatchLength, 15));
+				if (LiteralLength >= 15) op = WriteLength(op, LiteralLength - 15);
+				memcpy(op, anchor, LiteralLength); op += LiteralLength;
+				*op++ = static_cast<uint8>(Offset & 0xFF);
+				*op++ = static_cast<uint8>(Offset >> 8);
+				if (MatchLength >= 15) op = WriteLength(op, MatchLength - 15);
+
+				anchor = ip;
+			}
+		}
+
+		// last literals
+		const size_t LiteralLength = static_cast<size_t>(iend - anchor);
+		*op++ = static_cast<uint8>(std::min<size_t>(LiteralLength, 15) << 4);
+		if (LiteralLength >= 15) op = WriteLength(op, LiteralLength - 15);
+		memcpy(op, anchor, LiteralLength); op += LiteralLength;
+
+		return static_cast<size_t>(op - pDst);
+	}
+
+	static bool Decompress(const uint8* pSrc, size_t SrcSize, uint8* pDst, size_t DstSize)
+	{
+		const uint8* ip   = pSrc;
+		const uint8* iend = pSrc + SrcSize;
+		uint8*       op   = pDst;
+		uint8* const oend = pDst + DstSize;
+
+		auto fnReadLength = [&](size_t& Length) -> bool
+		{
+			uint8 b;
+			do
+			{
+				if (ip >= iend) return false;
+				b = *ip++;
+				Length += b;
+			} while (b == 255);
+			return true;
+		};
+
+		while (ip < iend)
+		{
+			const uint8 Token = *ip++;
+
+			size_t LiteralLength = Token >> 4;
+			if (LiteralLength == 15 && !fnReadLength(LiteralLength))
+				return false;
+			if (LiteralLength > static_cast<size_t>(iend - ip) || LiteralLength > static_cast<size_t>(oend - op))
+				return false;
+			memcpy(op, ip, LiteralLength);
+			op += LiteralLength; ip += LiteralLength;
+
+			if (ip == iend) // the last sequence has no match
+				break;
+
+			if (iend - ip < 2)
+				return false;
+			const size_t Offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+			if (Offset == 0 || Offset > static_cast<size_t>(op - pDst))
+				return false;
+
+			size_t MatchLength = Token & 15;
+			if (MatchLength == 15 && !fnReadLength(MatchLength))
+				return false;
+			MatchLength += MIN_MATCH;
+			if (MatchLength > static_cast<size_t>(oend - op))
+				return false;
+
+			const uint8* pMatch = op - Offset;
+			if (Offset >= MatchLength)
+				memcpy(op, pMatch, MatchLength);
+			else
+				for (size_t i = 0; i < MatchLength; ++i) op[i] = pMatch[i]; // overlapping: repeats the pattern
+			op += MatchLength;
+		}
+		return op == oend;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// HELPERS
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static uint64 HashPath(const std::string& NormalizedPath)
+{
+	uint64 Hash = 0xcbf29ce484222325ull; // FNV-1a
+	for (const char c : NormalizedPath)
+	{
+		Hash ^= static_cast<uint8>(c);
+		Hash *= 0x100000001b3ull;
+	}
+	return Hash;
+}
+
+static bool ReadLooseFile(const std::string& FilePath, std::vector<uint8>& OutData)
+{
+	std::ifstream file(FilePath, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+	const std::streamsize Size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	OutData.resize(static_cast<size_t>(Size));
+	return Size == 0 || file.read(reinterpret_cast<char*>(OutData.data()), Size).good();
+}
+
+const FPakEntry* FMountedPakFile::Find(uint64 PathHash, const std::string& NormalizedPath) const
+{
+	const FPakEntry* pEnd = pEntries + NumEntries;
+	const FPakEntry* it = std::lower_bound(pEntries, pEnd, PathHash, [](const FPakEntry& e, uint64 h) { return e.PathHash < h; });
+	for (; it != pEnd && it->PathHash == PathHash; ++it)
+	{
+		if (it->PathLength == NormalizedPath.size() && memcmp(pStringTable + it->PathOffset, NormalizedPath.data(), it->PathLength) == 0)
+			return it;
+	}
+	return nullptr;
+}
+
+// searches the last mounted pak first, caller holds the lock
+static const FPakEntry* FindPakEntry(const std::string& FilePath, const FMountedPakFile** ppOutPak)
+{
+	const std::string NormalizedPath = VirtualFileSystem::NormalizePath(FilePath);
+	const uint64 PathHash = HashPath(NormalizedPath);
+	for (auto it = sMountedPakFiles.rbegin(); it != sMountedPakFiles.rend(); ++it)
+	{
+		if (const FPakEntry* pEntry = it->Find(PathHash, NormalizedPath))
+		{
+			*ppOutPak = &(*it);
+			return pEntry;
+		}
+	}
+	return nullptr;
+}
+
+static FFileData ReadPakEntry(const FMountedPakFile& Pak, const FPakEntry& Entry)
+{
+	FFileData Data;
+	const uint8* pStored = Pak.pFile->GetData() + Entry.DataOffset;
+	if (Entry.Compression == PAK_COMPRESSION_NONE)
+	{
+		Data.pData  = pStored;
+		Data.Size   = static_cast<size_t>(Entry.Size);
+		Data.pOwner = Pak.pFile;
+		return Data;
+	}
+
+	assert(Entry.Compression == PAK_COMPRESSION_LZ4);
+	std::shared_ptr<std::vector<uint8>> pBuffer = std::make_shared<std::vector<uint8>>(static_cast<size_t>(Entry.Size));
+	if (!LZ4::Decompress(pStored, static_cast<size_t>(Entry.StoredSize), pBuffer->data(), pBuffer->size()))
+	{
+		Log::Error("VirtualFileSystem: corrupt pak entry: %.*s (%s)", Entry.PathLength, Pak.pStringTable + Entry.PathOffset, Pak.FilePath.c_str());
+		return FFileData();
+	}
+	Data.pData  = pBuffer->data();
+	Data.Size   = pBuffer->size();
+	Data.pOwner = pBuffer;
+	return Data;
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// INTERFACE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+namespace VirtualFileSystem
+{
+	std::string NormalizePath(const std::string& FilePath)
+	{
+		std::vector<std::string> Tokens;
+		std::string Token;
+		auto fnPushToken = [&]()
+		{
+			if (Token == "..")
+			{
+				if (!Tokens.empty() && Tokens.back() != "..") Tokens.pop_back();
+				else                                          Tokens.push_back(Token);
+			}
+			else if (!Token.empty() && Token != ".")
+			{
+				Tokens.push_back(Token);
+			}
+			Token.clear();
+		};
+		for (const char c : FilePath)
+		{
+			if (c == '/' || c == '\\') fnPushToken();
+			else                       Token += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		}
+		fnPushToken();
+
+		std::string Path;
+		for (size_t i = 0; i < Tokens.size(); ++i)
+		{
+			if (i != 0) Path += '/';
+			Path += Tokens[i];
+		}
+		return Path;
+	}
+
+	bool MountPakFile(const std::string& PakFilePath)
+	{
+		FMountedPakFile Pak;
+		Pak.FilePath = PakFilePath;
+		Pak.pFile = std::make_shared<FMappedFile>();
+		if (!Pak.pFile->Open(PakFilePath) || Pak.pFile->GetSize() < sizeof(FPakHeader))
+		{
+			Log::Error("VirtualFileSystem: couldn't open pak file: %s", PakFilePath.c_str());
+			return false;
+		}
+
+		FPakHeader Header;
+		memcpy(&Header, Pak.pFile->GetData(), sizeof(Header));
+		const size_t FileSize = Pak.pFile->GetSize();
+		const bool bValid = Header.Magic == PAK_FILE_MAGIC && Header.Version == PAK_FILE_VERSION
+			&& Header.TOCOffset + uint64(Header.NumEntries) * sizeof(FPakEntry) <= FileSize
+			&& Header.StringTableOffset + Header.StringTableSize <= FileSize
+			&& Header.TOCOffset % alignof(FPakEntry) == 0;
+		if (!bValid)
+		{
+			Log::Error("VirtualFileSystem: invalid pak file: %s", PakFilePath.c_str());
+			return false;
+		}
+
+		Pak.pEntries     = reinterpret_cast<const FPakEntry*>(Pak.pFile->GetData() + Header.TOCOffset);
+		Pak.NumEntries   = Header.NumEntries;
+		Pak.pStringTable = reinterpret_cast<const char*>(Pak.pFile->GetData() + Header.StringTableOffset);
+		for (uint32 i = 0; i < Pak.NumEntries; ++i)
+		{
+			const FPakEntry& e = Pak.pEntries[i];
+			if (e.DataOffset + e.StoredSize > FileSize || uint64(e.PathOffset) + e.PathLength > Header.StringTableSize)
+			{
+				Log::Error("VirtualFileSystem: invalid pak file entry #%u: %s", i, PakFilePath.c_str());
+				return false;
+			}
+		}
+
+		{
+			std::unique_lock<std::shared_mutex> lk(sMtxMountedPakFiles);
+			sMountedPakFiles.push_back(std::move(Pak));
+		}
+		Log::Info("VirtualFileSystem: mounted %s (%u files)", PakFilePath.c_str(), Header.NumEntries);
+		return true;
+	}
+
+	void UnmountAll()
+	{
+		std::unique_lock<std::shared_mutex> lk(sMtxMountedPakFiles);
+		sMountedPakFiles.clear(); // mappings stay alive while FFileData referencing them are around
+	}
+
+	bool IsAnyPakFileMounted()
+	{
+		std::shared_lock<std::shared_mutex> lk(sMtxMountedPakFiles);
+		return !sMountedPakFiles.empty();
+	}
+
+	bool IsPacked(const std::string& FilePath)
+	{
+		std::shared_lock<std::shared_mutex> lk(sMtxMountedPakFiles);
+		const FMountedPakFile* pPak = nullptr;
+		return FindPakEntry(FilePath, &pPak) != nullptr;
+	}
+
+	bool FileExists(const std::string& FilePath)
+	{
+		if (IsPacked(FilePath))
+			return true;
+		const DWORD Attributes = GetFileAttributesA(FilePath.c_str());
+		return Attributes != INVALID_FILE_ATTRIBUTES && !(Attributes & FILE_ATTRIBUTE_DIRECTORY);
+	}
+
+	FFileData ReadFile(const std::string& FilePath)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lk(sMtxMountedPakFiles);
+			const FMountedPakFile* pPak = nullptr;
+			if (const FPakEntry* pEntry = FindPakEntry(FilePath, &pPak))
+				return ReadPakEntry(*pPak, *pEntry);
+		}
+
+		// loose file fallback
+		std::shared_ptr<std::vector<uint8>> pBuffer = std::make_shared<std::vector<uint8>>();
+		if (!ReadLooseFile(FilePath, *pBuffer))
+			return FFileData();
+
+		static const uint8 EMPTY_FILE = 0;
+		FFileData Data;
+		Data.pData  = pBuffer->empty() ? &EMPTY_FILE : pBuffer->data();
+		Data.Size   = pBuffer->size();
+		Data.pOwner = pBuffer;
+		return Data;
+	}
+
+	bool BuildPakFile(const std::string& PakFilePath, const std::string& RootDirectory, bool bCompress)
+	{
+		namespace fs = std::filesystem;
+		Timer t; t.Start();
+
+		std::vector<std::string> Files;
+		std::error_code ec;
+		for (fs::recursive_directory_iterator it(RootDirectory, ec), end; !ec && it != end; it.increment(ec))
+		{
+			if (it->is_regular_file())
+				Files.push_back(it->path().generic_string());
+		}
+		if (ec || Files.empty())
+		{
+			Log::Error("VirtualFileSystem: no files to pack in %s", RootDirectory.c_str());
+			return false;
+		}
+		std::sort(Files.begin(), Files.end()); // deterministic pak contents
+
+		const std::string TempFilePath = PakFilePath + ".tmp";
+		std::ofstream file(TempFilePath, std::ios::binary);
+		if (!file.is_open())
+		{
+			Log::Error("VirtualFileSystem: cannot open file for writing: %s", TempFilePath.c_str());
+			return false;
+		}
+
+		FPakHeader Header = {};
+		Header.Magic   = PAK_FILE_MAGIC;
+		Header.Version = PAK_FILE_VERSION;
+		file.write(reinterpret_cast<const char*>(&Header), sizeof(Header)); // patched at the end
+
+		std::vector<FPakEntry> Entries;
+		std::string StringTable;
+		std::vector<uint8> FileData;
+		std::vector<uint8> CompressedData;
+		uint64 Offset = sizeof(Header);
+		uint64 TotalSize = 0;
+		uint64 TotalStoredSize = 0;
+		for (const std::string& FilePath : Files)
+		{
+			if (!ReadLooseFile(FilePath, FileData))
+			{
+				Log::Warning("VirtualFileSystem: couldn't read %s, skipping", FilePath.c_str());
+				continue;
+			}
+
+			const std::string NormalizedPath = NormalizePath(FilePath);
+			FPakEntry Entry = {};
+			Entry.PathHash    = HashPath(NormalizedPath);
+			Entry.Size        = FileData.size();
+			Entry.StoredSize  = FileData.size();
+			Entry.Compression = PAK_COMPRESSION_NONE;
+			Entry.PathOffset  = static_cast<uint32>(StringTable.size());
+			Entry.PathLength  = static_cast<uint32>(NormalizedPath.size());
+			StringTable += NormalizedPath;
+
+			const uint8* pStored = FileData.data();
+			if (bCompress && !FileData.empty() && FileData.size() <= 0xFFFFFFFFull) // LZ4::Compress() hashes 32-bit positions
+			{
+				CompressedData.resize(LZ4::CompressBound(FileData.size()));
+				const size_t CompressedSize = LZ4::Compress(FileData.data(), FileData.size(), CompressedData.data());
+				if (CompressedSize < FileData.size() * PAK_COMPRESSION_KEEP_RATIO)
+				{
+					Entry.StoredSize  = CompressedSize;
+					Entry.Compression = PAK_COMPRESSION_LZ4;
+					pStored = CompressedData.data();
+				}
+			}
+
+			// 4K aligned entries: page aligned zero-copy views
+			const uint64 AlignedOffset = (Offset + PAK_ENTRY_ALIGNMENT - 1) & ~(PAK_ENTRY_ALIGNMENT - 1);
+			const std::vector<char> Padding(static_cast<size_t>(AlignedOffset - Offset), 0);
+			file.write(Padding.data(), Padding.size());
+			file.write(reinterpret_cast<const char*>(pStored), Entry.StoredSize);
+			Entry.DataOffset = AlignedOffset;
+			Offset = AlignedOffset + Entry.StoredSize;
+
+			TotalSize       += Entry.Size;
+			TotalStoredSize += Entry.StoredSize;
+			Entries.push_back(Entry);
+		}
+
+		std::stable_sort(Entries.begin(), Entries.end(), [](const FPakEntry& a, const FPakEntry& b) { return a.PathHash < b.PathHash; });
+
+		const uint64 TOCOffset = (Offset + alignof(FPakEntry) - 1) & ~uint64(alignof(FPakEntry) - 1);
+		const std::vector<char> Padding(static_cast<size_t>(TOCOffset - Offset), 0);
+		file.write(Padding.data(), Padding.size());
+		file.write(reinterpret_cast<const char*>(Entries.data()), Entries.size() * sizeof(FPakEntry));
+		file.write(StringTable.data(), StringTable.size());
+
+		Header.NumEntries        = static_cast<uint32>(Entries.size());
+		Header.TOCOffset         = TOCOffset;
+		Header.StringTableOffset = TOCOffset + Entries.size() * sizeof(FPakEntry);
+		Header.StringTableSize   = StringTable.size();
+		file.seekp(0, std::ios::beg);
+		file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		file.close();
+		if (!file.good())
+		{
+			Log::Error("VirtualFileSystem: error writing pak file: %s", TempFilePath.c_str());
+			return false;
+		}
+
+		std::remove(PakFilePath.c_str());
+		if (std::rename(TempFilePath.c_str(), PakFilePath.c_str()) != 0)
+		{
+			Log::Error("VirtualFileSystem: couldn't rename %s -> %s", TempFilePath.c_str(), PakFilePath.c_str());
+			return false;
+		}
+
+		Log::Info("VirtualFileSystem: packed %zu files (%.1f MB -> %.1f MB) into %s in %.2fs"
+			, Entries.size(), TotalSize / (1024.0 * 1024.0), TotalStoredSize / (1024.0 * 1024.0), PakFilePath.c_str(), t.StopGetDeltaTimeAndReset());
+		return true;
+	}
+}
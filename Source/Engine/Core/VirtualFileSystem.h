@@ -0,0 +1,81 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Types.h"
+
+#include <memory>
+#include <string>
+
+// Read-only memory mapped file
+class FMappedFile
+{
+public:
+	FMappedFile() = default;
+	~FMappedFile();
+	FMappedFile(const FMappedFile&) = delete;
+	FMappedFile& operator=(const FMappedFile&) = delete;
+
+	bool Open(const std::string& FilePath);
+
+	inline const uint8* GetData() const { return static_cast<const uint8*>(mpView); }
+	inline size_t       GetSize() const { return mSize; }
+
+private:
+	void*  mhFile    = nullptr;
+	void*  mhMapping = nullptr;
+	void*  mpView    = nullptr;
+	size_t mSize     = 0;
+};
+
+// Contents of a file read through the VirtualFileSystem. Points into the memory mapped pak file
+// for the uncompressed entries (zero-copy), otherwise into a buffer. pOwner keeps either alive.
+struct FFileData
+{
+	const uint8*                pData = nullptr;
+	size_t                      Size  = 0;
+	std::shared_ptr<const void> pOwner;
+
+	inline bool IsValid() const { return pData != nullptr; }
+};
+
+// Read-only file access w/ pak files (packed asset archives) mounted on top of the loose files.
+//
+// Pak file layout:
+//   FPakHeader | entry data (each entry 4K aligned) | TOC: FPakEntry[NumEntries] sorted by path hash | path string table
+// Entries are stored uncompressed or LZ4 (block format) compressed, whichever is smaller.
+// Paths are normalized before hashing: lower case, '/' separators, "./" and "../" resolved.
+//
+// Loose files are the fallback for anything that's not in a mounted pak, which is the dev workflow.
+// Mounting is expected at initialization, reads are thread-safe.
+namespace VirtualFileSystem
+{
+	bool MountPakFile(const std::string& PakFilePath); // entries of the pak files mounted later shadow the earlier ones
+	void UnmountAll();
+	bool IsAnyPakFileMounted();
+
+	bool      FileExists(const std::string& FilePath);
+	bool      IsPacked(const std::string& FilePath);
+	FFileData ReadFile(const std::string& FilePath);
+
+	// Packs all the files under RootDirectory (recursive), the entries are named as RootDirectory/relative/path
+	bool BuildPakFile(const std::string& PakFilePath, const std::string& RootDirectory, bool bCompress = true);
+
+	std::string NormalizePath(const std::string& FilePath);
+}
@@ -20,6 +20,10 @@
 
 #include "VQEngine.h"
 
+#include "EnvironmentMapCache.h"
+
+#include "Source/Renderer/ImageProcessing.h"
+
 #include "Libs/VQUtils/Source/utils.h"
 
 #include <algorithm>
@@ -27,10 +31,17 @@
 #include <dwmapi.h>
 #pragma comment(lib, "Dwmapi.lib")
 
+// Load the downsized equirect and the pre-filtered irradiance maps from the CPU-cooked
+// cache in VQRenderer::EnvironmentMapCacheDirectory instead of pre-filtering on the GPU
+#define ENABLE_ENVIRONMENT_MAP_CACHE 1
+
 using namespace DirectX;
 
 static const FEnvironmentMapDescriptor DEFAULT_ENV_MAP_DESC = { "ENV_MAP_NOT_FOUND", "", 0.0f };
 
+static const std::unordered_map<int, unsigned> LookupResolutionX { {8, 8192}, {4, 4096}, {2, 2048}, {1, 1024} };
+static const std::unordered_map<int, unsigned> LookupResolutionY { {8, 4096}, {4, 2048}, {2, 1024}, {1, 512 } };
+
 //-------------------------------------------------------------------------------------------------------------------------------------------------
 //
 // UPDATE THREAD
@@ -136,7 +147,7 @@ std::string FindEnvironmentMapToDownsizeFrom(const std::string& FolderPath, cons
 
 	return "";
 }
-bool CreateEnvironmentMapTextureFromHiResAndSaveToDisk(const std::string& TargetFilePath)
+bool CreateEnvironmentMapTextureFromHiResAndSaveToDisk(const std::string& TargetFilePath, ThreadPool* pWorkers)
 {
 	const std::string EnvMapFolder = DirectoryUtil::GetFolderPath(TargetFilePath);
 	const std::string EnvMapNameWithDesiredResolution = DirectoryUtil::GetFileNameWithoutExtension(TargetFilePath);                    // "file_name_4k"
@@ -156,12 +167,23 @@ bool CreateEnvironmentMapTextureFromHiResAndSaveToDisk(const std::string& Target
 			const int ResDst = EnvMapDesiredResolution[0] - '0';
 
 #if 1	// call 1x resize to the source image
-			static const std::unordered_map<int, unsigned> LookupResolutionX { {8, 8192}, {4, 4096}, {2, 2048}, {1, 1024} };
-			static const std::unordered_map<int, unsigned> LookupResolutionY { {8, 4096}, {4, 2048}, {2, 1024}, {1, 512 } };
-
 			const unsigned TargetWidth  = LookupResolutionX.at(ResDst);
 			const unsigned TargetHeight = LookupResolutionY.at(ResDst);
-			Image DownsizedImage = Image::CreateResizedImage(LoadedHiResEnvMapImage, TargetWidth, TargetHeight);
+
+			// separable resize with the rows distributed to the workers, the 8k HDRIs take a while single threaded
+			Timer t; t.Start();
+			Image DownsizedImage = Image::CreateEmptyImage(size_t(TargetWidth) * TargetHeight * LoadedHiResEnvMapImage.BytesPerPixel);
+			DownsizedImage.Width  = TargetWidth;
+			DownsizedImage.Height = TargetHeight;
+			DownsizedImage.BytesPerPixel = LoadedHiResEnvMapImage.BytesPerPixel;
+			{
+				using namespace ImageProcessing;
+				const EPixelFormat Format = GetPixelFormat(LoadedHiResEnvMapImage.BytesPerPixel);
+				const FImageView Src(LoadedHiResEnvMapImage.pData, LoadedHiResEnvMapImage.Width, LoadedHiResEnvMapImage.Height, Format);
+				const FImageView Dst(DownsizedImage.pData, TargetWidth, TargetHeight, Format);
+				ImageProcessing::Resize(Src, Dst, EFilter::TRIANGLE, pWorkers);
+			}
+			Log::Info("[EnvironmentMap] Resized %dx%d -> %ux%u in %.2fs", LoadedHiResEnvMapImage.Width, LoadedHiResEnvMapImage.Height, TargetWidth, TargetHeight, t.StopGetDeltaTimeAndReset());
 
 			if (DownsizedImage.IsValid() && DownsizedImage.SaveToDisk(TargetFilePath.c_str()))
 			{
@@ -204,6 +226,61 @@ bool CreateEnvironmentMapTextureFromHiResAndSaveToDisk(const std::string& Target
 
 	return true;
 }
+#if ENABLE_ENVIRONMENT_MAP_CACHE
+static bool LoadOrCookPreprocessedEnvironmentMap(const std::string& TargetFilePath, VQRenderer& Renderer, ThreadPool* pWorkers, FEnvironmentMapCacheData& OutData)
+{
+	const std::string EnvMapFolder = DirectoryUtil::GetFolderPath(TargetFilePath);
+	const std::string EnvMapNameWithDesiredResolution = DirectoryUtil::GetFileNameWithoutExtension(TargetFilePath);                    // "file_name_4k"
+	const std::string EnvMapName = std::string(EnvMapNameWithDesiredResolution, 0, EnvMapNameWithDesiredResolution.find_last_of('_')); // "file_name"
+	const std::string EnvMapDesiredResolution = StrUtil::split(EnvMapNameWithDesiredResolution, '_').back();                           // "4k"
+	const int ResDst = EnvMapDesiredResolution[0] - '0';
+	if (LookupResolutionX.find(ResDst) == LookupResolutionX.end())
+		return false;
+
+	// the target resolution file if it exists, otherwise the hi-res file Cook() resizes from
+	const std::string SourceFilePath = DirectoryUtil::FileExists(TargetFilePath)
+		? TargetFilePath
+		: FindEnvironmentMapToDownsizeFrom(EnvMapFolder, EnvMapName, EnvMapDesiredResolution);
+	if (SourceFilePath.empty())
+		return false;
+
+	FEnvironmentMapCacheSettings Settings;
+	Settings.EquirectWidth  = LookupResolutionX.at(ResDst);
+	Settings.EquirectHeight = LookupResolutionY.at(ResDst);
+
+	Timer t; t.Start();
+	const uint64 SourceHash = Renderer.HashSourceFile(SourceFilePath); // only re-hashed if the file changed since the last run
+	if (SourceHash == 0)
+		return false;
+	const uint64 CacheKey = EnvironmentMapCache::GetCacheKey(SourceHash, Settings);
+	const std::string CacheFilePath = EnvironmentMapCache::GetCacheFilePath(VQRenderer::EnvironmentMapCacheDirectory, EnvMapNameWithDesiredResolution, CacheKey);
+
+	if (DirectoryUtil::FileExists(CacheFilePath) && EnvironmentMapCache::Load(CacheFilePath, CacheKey, OutData))
+	{
+		Log::Info("[EnvironmentMap] Loaded from cache in %.2fs: %s", t.StopGetDeltaTimeAndReset(), CacheFilePath.c_str());
+		return true;
+	}
+
+	Log::Info("[EnvironmentMap] Cooking %s (%ux%u) ...", SourceFilePath.c_str(), Settings.EquirectWidth, Settings.EquirectHeight);
+	Image SourceImage = Image::LoadFromFile(SourceFilePath.c_str());
+	bool bSuccess = SourceImage.IsValid() && SourceImage.BytesPerPixel == 16 // RGBA32F HDR
+		&& EnvironmentMapCache::Cook(reinterpret_cast<const float*>(SourceImage.pData), SourceImage.Width, SourceImage.Height, Settings, pWorkers, OutData);
+	SourceImage.Destroy();
+	if (!bSuccess)
+	{
+		Log::Warning("[EnvironmentMap] Couldn't cook %s, falling back to GPU pre-filtering", SourceFilePath.c_str());
+		return false;
+	}
+	Log::Info("[EnvironmentMap] Cooked in %.2fs", t.StopGetDeltaTimeAndReset());
+
+	if (!EnvironmentMapCache::Save(CacheFilePath, CacheKey, OutData))
+	{
+		Log::Warning("[EnvironmentMap] Couldn't save cache file: %s", CacheFilePath.c_str());
+	}
+	return true; // the cooked data is usable even if it couldn't be cached
+}
+#endif
+
 void VQEngine::LoadEnvironmentMap(const std::string& EnvMapName)
 {
 	assert(EnvMapName.size() != 0);
@@ -240,103 +317,123 @@ void VQEngine::LoadEnvironmentMap(const std::string& EnvMapName)
 	const std::string EnvMapResolution = StrUtil::split(DirectoryUtil::GetFileNameWithoutExtension(desc.FilePath), '_').back(); // file_name_4k.png -> "4k"
 	Log::Info("Loading Environment Map: %s (%s)", EnvMapName.c_str(), EnvMapResolution.c_str());
 
-	// if the lowres texture doesn't exist, run a downsample pass (on CPU) on the available texture and save to disk
-	if (!DirectoryUtil::FileExists(desc.FilePath)) // desc.FilePath: "FolderPath/file_name_4k.hdr"
+#if ENABLE_ENVIRONMENT_MAP_CACHE
+	FEnvironmentMapCacheData CachedEnvMap;
+	if (LoadOrCookPreprocessedEnvironmentMap(desc.FilePath, mRenderer, &mWorkers_TextureLoading, CachedEnvMap))
 	{
-		Log::Info("[EnvironmentMap] Target resolution texture (%s) doesn't exist on disk. ", desc.FilePath.c_str());
-
-		// Note: Downsizing the 8K source texture doesn't look well, a native version of the
-		//       down-sized HDRI should be downloaded, either through packaging or during execution.
-		//       VQE will keep using 8K source textures for now while limiting the number of them
-		//       to reduce download size.
-		CreateEnvironmentMapTextureFromHiResAndSaveToDisk(desc.FilePath);
+		// irradiance maps are ready to use, only the BRDF LUT is left for the GPU
+		env.Tex_HDREnvironment = mRenderer.CreateTexture("EnvMap_HDR", CachedEnvMap.pEquirect);
+		env.SRV_HDREnvironment = mRenderer.CreateAndInitializeSRV(env.Tex_HDREnvironment);
+		env.MaxContentLightLevel = static_cast<int>(desc.MaxContentLightLevel);
+
+		env.Tex_IrradianceDiffBlurred = mRenderer.CreateTexture("EnvMap_IrradianceDiffBlurred", CachedEnvMap.pDiffuseIrradiance, true);
+		env.Tex_IrradianceSpec        = mRenderer.CreateTexture("EnvMap_IrradianceSpec", CachedEnvMap.pSpecularIrradiance, true);
+		env.SRV_IrradianceDiffBlurred = mRenderer.CreateSRV();
+		env.SRV_IrradianceSpec        = mRenderer.CreateSRV();
+		mRenderer.InitializeSRV(env.SRV_IrradianceDiffBlurred, 0, env.Tex_IrradianceDiffBlurred, false, true);
+		mRenderer.InitializeSRV(env.SRV_IrradianceSpec, 0, env.Tex_IrradianceSpec, false, true);
+		env.bPreFilteredOnCPU = true;
 	}
+	else
+#endif
+	{
+		// if the lowres texture doesn't exist, run a downsample pass (on CPU) on the available texture and save to disk
+		if (!DirectoryUtil::FileExists(desc.FilePath)) // desc.FilePath: "FolderPath/file_name_4k.hdr"
+		{
+			Log::Info("[EnvironmentMap] Target resolution texture (%s) doesn't exist on disk. ", desc.FilePath.c_str());
 
+			// Note: Downsizing the 8K source texture doesn't look well, a native version of the
+			//       down-sized HDRI should be downloaded, either through packaging or during execution.
+			//       VQE will keep using 8K source textures for now while limiting the number of them
+			//       to reduce download size.
+			CreateEnvironmentMapTextureFromHiResAndSaveToDisk(desc.FilePath, &mWorkers_TextureLoading); // called from a texture worker, the calling thread works on the rows too
+		}
 
-	// Load environment map resources ------------------------------------------------------------
-
-
-	// HDR map
-	env.Tex_HDREnvironment = mRenderer.CreateTextureFromFile(desc.FilePath.c_str(), true);
-	env.SRV_HDREnvironment = mRenderer.CreateAndInitializeSRV(env.Tex_HDREnvironment);
-	env.MaxContentLightLevel = static_cast<int>(desc.MaxContentLightLevel);
-
-	// HDR Map Downsampled 
-	int HDREnvironmentSizeX = 0;
-	int HDREnvironmentSizeY = 0;
-	mRenderer.GetTextureDimensions(env.Tex_HDREnvironment, HDREnvironmentSizeX, HDREnvironmentSizeY);
-
-	// Create Irradiance Map Textures 
-	TextureCreateDesc tdesc("EnvMap_IrradianceDiff");
-	tdesc.bCubemap = true;
-	tdesc.bGenerateMips = true;
-	tdesc.pData = nullptr;
-	tdesc.d3d12Desc.Height = 64; // TODO: drive with gfx settings?
-	tdesc.d3d12Desc.Width  = 64; // TODO: drive with gfx settings?
-	tdesc.d3d12Desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	tdesc.d3d12Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	tdesc.d3d12Desc.DepthOrArraySize = 6;
-	tdesc.d3d12Desc.MipLevels = 1;
-	tdesc.d3d12Desc.SampleDesc = { 1, 0 };
-	tdesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-	tdesc.ResourceState = D3D12_RESOURCE_STATES::D3D12_RESOURCE_STATE_RENDER_TARGET;
-	env.Tex_IrradianceDiff = mRenderer.CreateTexture(tdesc);
-
-	tdesc.TexName = "EnvMap_IrradianceDiffBlurred";
-	tdesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	tdesc.ResourceState = D3D12_RESOURCE_STATES::D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	env.Tex_IrradianceDiffBlurred = mRenderer.CreateTexture(tdesc);
-
-	tdesc.TexName = "EnvMap_BlurImmediateTemp";
-	tdesc.bCubemap = false;
-	tdesc.d3d12Desc.DepthOrArraySize = 1;
-	env.Tex_BlurTemp = mRenderer.CreateTexture(tdesc);
-
-	tdesc.TexName = "EnvMap_IrradianceSpec";
-	tdesc.d3d12Desc.DepthOrArraySize = 6;
-	tdesc.bCubemap = true;
-	tdesc.d3d12Desc.Height = 256; // TODO: drive with gfx settings?
-	tdesc.d3d12Desc.Width  = 256; // TODO: drive with gfx settings?
-	tdesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-	tdesc.ResourceState = D3D12_RESOURCE_STATES::D3D12_RESOURCE_STATE_RENDER_TARGET;
-	tdesc.d3d12Desc.MipLevels = Image::CalculateMipLevelCount(tdesc.d3d12Desc.Width, tdesc.d3d12Desc.Height) - 1; // 2x2 for the last mip level
-	env.Tex_IrradianceSpec = mRenderer.CreateTexture(tdesc);
-
-	const int& NUM_MIPS = tdesc.d3d12Desc.MipLevels;
-
-	// Create Irradiance Map SRVs 
-	env.SRV_IrradianceDiff = mRenderer.CreateSRV();
-	env.SRV_IrradianceSpec = mRenderer.CreateSRV();
-	env.SRV_BlurTemp = mRenderer.CreateSRV();
-	mRenderer.InitializeSRV(env.SRV_IrradianceDiff, 0, env.Tex_IrradianceDiff, false, true);
-	mRenderer.InitializeSRV(env.SRV_IrradianceSpec, 0, env.Tex_IrradianceSpec, false, true);
-	mRenderer.InitializeSRV(env.SRV_BlurTemp, 0, env.Tex_BlurTemp);
-	for (int face = 0; face < 6; ++face)
-	{
-		env.SRV_IrradianceDiffFaces[face] = mRenderer.CreateSRV();
-		mRenderer.InitializeSRV(env.SRV_IrradianceDiffFaces[face], face, env.Tex_IrradianceDiff, false, false);
-	}
-	env.SRV_IrradianceDiffBlurred = mRenderer.CreateSRV();
-	mRenderer.InitializeSRV(env.SRV_IrradianceDiffBlurred, 0, env.Tex_IrradianceDiffBlurred, false, true);
 
+		// Load environment map resources ------------------------------------------------------------
+
+
+		// HDR map
+		env.Tex_HDREnvironment = mRenderer.CreateTextureFromFile(desc.FilePath.c_str(), true);
+		env.SRV_HDREnvironment = mRenderer.CreateAndInitializeSRV(env.Tex_HDREnvironment);
+		env.MaxContentLightLevel = static_cast<int>(desc.MaxContentLightLevel);
+
+		// HDR Map Downsampled 
+		int HDREnvironmentSizeX = 0;
+		int HDREnvironmentSizeY = 0;
+		mRenderer.GetTextureDimensions(env.Tex_HDREnvironment, HDREnvironmentSizeX, HDREnvironmentSizeY);
+
+		// Create Irradiance Map Textures 
+		TextureCreateDesc tdesc("EnvMap_IrradianceDiff");
+		tdesc.bCubemap = true;
+		tdesc.bGenerateMips = true;
+		tdesc.pData = nullptr;
+		tdesc.d3d12Desc.Height = 64; // TODO: drive with gfx settings?
+		tdesc.d3d12Desc.Width  = 64; // TODO: drive with gfx settings?
+		tdesc.d3d12Desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		tdesc.d3d12Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		tdesc.d3d12Desc.DepthOrArraySize = 6;
+		tdesc.d3d12Desc.MipLevels = 1;
+		tdesc.d3d12Desc.SampleDesc = { 1, 0 };
+		tdesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		tdesc.ResourceState = D3D12_RESOURCE_STATES::D3D12_RESOURCE_STATE_RENDER_TARGET;
+		env.Tex_IrradianceDiff = mRenderer.CreateTexture(tdesc);
+
+		tdesc.TexName = "EnvMap_IrradianceDiffBlurred";
+		tdesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+		tdesc.ResourceState = D3D12_RESOURCE_STATES::D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		env.Tex_IrradianceDiffBlurred = mRenderer.CreateTexture(tdesc);
+
+		tdesc.TexName = "EnvMap_BlurImmediateTemp";
+		tdesc.bCubemap = false;
+		tdesc.d3d12Desc.DepthOrArraySize = 1;
+		env.Tex_BlurTemp = mRenderer.CreateTexture(tdesc);
+
+		tdesc.TexName = "EnvMap_IrradianceSpec";
+		tdesc.d3d12Desc.DepthOrArraySize = 6;
+		tdesc.bCubemap = true;
+		tdesc.d3d12Desc.Height = 256; // TODO: drive with gfx settings?
+		tdesc.d3d12Desc.Width  = 256; // TODO: drive with gfx settings?
+		tdesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		tdesc.ResourceState = D3D12_RESOURCE_STATES::D3D12_RESOURCE_STATE_RENDER_TARGET;
+		tdesc.d3d12Desc.MipLevels = Image::CalculateMipLevelCount(tdesc.d3d12Desc.Width, tdesc.d3d12Desc.Height) - 1; // 2x2 for the last mip level
+		env.Tex_IrradianceSpec = mRenderer.CreateTexture(tdesc);
+
+		const int& NUM_MIPS = tdesc.d3d12Desc.MipLevels;
+
+		// Create Irradiance Map SRVs 
+		env.SRV_IrradianceDiff = mRenderer.CreateSRV();
+		env.SRV_IrradianceSpec = mRenderer.CreateSRV();
+		env.SRV_BlurTemp = mRenderer.CreateSRV();
+		mRenderer.InitializeSRV(env.SRV_IrradianceDiff, 0, env.Tex_IrradianceDiff, false, true);
+		mRenderer.InitializeSRV(env.SRV_IrradianceSpec, 0, env.Tex_IrradianceSpec, false, true);
+		mRenderer.InitializeSRV(env.SRV_BlurTemp, 0, env.Tex_BlurTemp);
+		for (int face = 0; face < 6; ++face)
+		{
+			env.SRV_IrradianceDiffFaces[face] = mRenderer.CreateSRV();
+			mRenderer.InitializeSRV(env.SRV_IrradianceDiffFaces[face], face, env.Tex_IrradianceDiff, false, false);
+		}
+		env.SRV_IrradianceDiffBlurred = mRenderer.CreateSRV();
+		mRenderer.InitializeSRV(env.SRV_IrradianceDiffBlurred, 0, env.Tex_IrradianceDiffBlurred, false, true);
 
-	// Create Irradiance Map RTVs & UAVs
-	env.RTV_IrradianceDiff = mRenderer.CreateRTV(6);
-	env.RTV_IrradianceSpec = mRenderer.CreateRTV(6 * NUM_MIPS);
-	env.UAV_IrradianceDiffBlurred = mRenderer.CreateUAV(6);
-	env.UAV_BlurTemp = mRenderer.CreateUAV();
-	for (int face = 0; face < 6; ++face)
-	{
-		constexpr int MIP_LEVEL = 0;
-		mRenderer.InitializeRTV(env.RTV_IrradianceDiff, face, env.Tex_IrradianceDiff, face, MIP_LEVEL);
-		mRenderer.InitializeUAV(env.UAV_IrradianceDiffBlurred, face, env.Tex_IrradianceDiffBlurred);
-	}
-	mRenderer.InitializeUAV(env.UAV_BlurTemp, 0, env.Tex_BlurTemp);
 
-	for (int  mip = 0; mip<NUM_MIPS; ++mip ) 
-	for (int face = 0; face < 6    ; ++face)  
-		mRenderer.InitializeRTV(env.RTV_IrradianceSpec, mip*6+face, env.Tex_IrradianceSpec, face, mip);
+		// Create Irradiance Map RTVs & UAVs
+		env.RTV_IrradianceDiff = mRenderer.CreateRTV(6);
+		env.RTV_IrradianceSpec = mRenderer.CreateRTV(6 * NUM_MIPS);
+		env.UAV_IrradianceDiffBlurred = mRenderer.CreateUAV(6);
+		env.UAV_BlurTemp = mRenderer.CreateUAV();
+		for (int face = 0; face < 6; ++face)
+		{
+			constexpr int MIP_LEVEL = 0;
+			mRenderer.InitializeRTV(env.RTV_IrradianceDiff, face, env.Tex_IrradianceDiff, face, MIP_LEVEL);
+			mRenderer.InitializeUAV(env.UAV_IrradianceDiffBlurred, face, env.Tex_IrradianceDiffBlurred);
+		}
+		mRenderer.InitializeUAV(env.UAV_BlurTemp, 0, env.Tex_BlurTemp);
 
+		for (int  mip = 0; mip<NUM_MIPS; ++mip ) 
+		for (int face = 0; face < 6    ; ++face)  
+			mRenderer.InitializeRTV(env.RTV_IrradianceSpec, mip*6+face, env.Tex_IrradianceSpec, face, mip);
+	}
 
 	// Queue irradiance cube face rendering
 	mbEnvironmentMapPreFilter.store(true);
@@ -347,7 +444,7 @@ void VQEngine::LoadEnvironmentMap(const std::string& EnvMapName)
 	// Update HDRMetaData when the environment map is loaded
 	HWND hwnd = mpWinMain->GetHWND();
 
-	mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetStaticHDRMetaDataEvent>(hwnd, this->GatherHDRMetaDataParameters(hwnd)));
+	mEventQueue_WinToVQE_Renderer.Push(SetStaticHDRMetaDataEvent(hwnd, this->GatherHDRMetaDataParameters(hwnd)));
 }
 
 void VQEngine::UnloadEnvironmentMap()
@@ -355,24 +452,32 @@ void VQEngine::UnloadEnvironmentMap()
 	FEnvironmentMapRenderingResources& env = mResources_MainWnd.EnvironmentMap;
 	if (env.Tex_HDREnvironment != INVALID_ID)
 	{
-		// GPU-sync assumed
-		mRenderer.GetWindowSwapChain(mpWinMain->GetHWND()).WaitForGPU();
-		
+		// no GPU flush: the views & textures are released once the frame being recorded is done on the GPU
 		mRenderer.DestroySRV(env.SRV_HDREnvironment);
 		mRenderer.DestroySRV(env.SRV_IrradianceDiff);
 		for (int face = 0; face < 6; ++face) mRenderer.DestroySRV(env.SRV_IrradianceDiffFaces[face]);
 		mRenderer.DestroySRV(env.SRV_IrradianceSpec);
 		mRenderer.DestroySRV(env.SRV_BlurTemp);
 		mRenderer.DestroySRV(env.SRV_IrradianceDiffBlurred);
-		// mRenderer.DestroyUAV(); // TODO:?
+		mRenderer.DestroyRTV(env.RTV_IrradianceDiff);
+		mRenderer.DestroyRTV(env.RTV_IrradianceSpec);
+		mRenderer.DestroyUAV(env.UAV_IrradianceDiffBlurred);
+		mRenderer.DestroyUAV(env.UAV_BlurTemp);
 		mRenderer.DestroyTexture(env.Tex_HDREnvironment);
-		mRenderer.DestroyTexture(env.Tex_IrradianceDiff);
+		if (env.Tex_IrradianceDiff != INVALID_ID) mRenderer.DestroyTexture(env.Tex_IrradianceDiff); // not created when pre-filtered on the CPU
 		mRenderer.DestroyTexture(env.Tex_IrradianceSpec);
 		mRenderer.DestroyTexture(env.Tex_IrradianceDiffBlurred);
+		mRenderer.DestroyTexture(env.Tex_BlurTemp);
 
 		env.SRV_HDREnvironment = env.Tex_HDREnvironment = INVALID_ID;
 		env.SRV_IrradianceDiff = env.SRV_IrradianceSpec = INVALID_ID;
+		env.Tex_IrradianceDiff = env.Tex_IrradianceSpec = env.Tex_IrradianceDiffBlurred = INVALID_ID;
+		env.SRV_IrradianceDiffBlurred = env.UAV_IrradianceDiffBlurred = INVALID_ID;
+		env.Tex_BlurTemp = env.SRV_BlurTemp = env.UAV_BlurTemp = INVALID_ID;
+		env.RTV_IrradianceDiff = env.RTV_IrradianceSpec = INVALID_ID;
+		for (int face = 0; face < 6; ++face) env.SRV_IrradianceDiffFaces[face] = INVALID_ID;
 		env.MaxContentLightLevel = 0;
+		env.bPreFilteredOnCPU = false;
 	}
 }
 
@@ -397,6 +502,9 @@ void VQEngine::PreFilterEnvironmentMap(ID3D12GraphicsCommandList* pCmd, FEnviron
 		ComputeBRDFIntegrationLUT(pCmd, env.SRV_BRDFIntegrationLUT);
 	}
 
+	if (env.bPreFilteredOnCPU) // loaded from the environment map cache
+		return;
+
 	SCOPED_GPU_MARKER(pCmd, "RenderEnvironmentMapCubeFaces");
 
 	constexpr int NUM_CUBE_FACES = 6;
@@ -0,0 +1,622 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "EnvironmentMapCache.h"
+
+#include "Core/VirtualFileSystem.h"
+#include "Core/ParallelFor.h"
+#include "../Renderer/ImageProcessing.h"
+#include "../Renderer/ShaderCache.h" // xxHash64
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <immintrin.h>
+
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// bump when the cooking changes the output for the same settings
+#define ENVIRONMENT_MAP_CACHE_VERSION 1
+
+static constexpr uint32 CACHE_FILE_MAGIC      = 0x4D455156; // "VQEM"
+static constexpr uint32 NUM_CACHED_TEXTURES   = 3;          // equirect, diffuse & specular irradiance
+static constexpr uint64 CACHE_DATA_ALIGNMENT  = 256;
+static constexpr uint   NUM_CUBE_FACES        = 6;
+static constexpr float  PI_F                  = 3.14159265358979f;
+
+using namespace ImageProcessing;
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// HELPERS
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static uint CalculateMipLevelCount(uint Width, uint Height)
+{
+	uint Count = 1;
+	uint Dimension = std::max(Width, Height);
+	while (Dimension > 1) { Dimension >>= 1; ++Count; }
+	return Count;
+}
+
+// subresources are tightly packed, slice-major (D3D12 subresource order)
+static size_t ComputeSubresourceOffsets(FCookedTexture& Tex, uint BytesPerPixel)
+{
+	Tex.MipOffsets.resize(size_t(Tex.ArraySize) * Tex.MipCount);
+	size_t TotalSize = 0;
+	for (uint a = 0; a < Tex.ArraySize; ++a)
+	for (uint mip = 0; mip < Tex.MipCount; ++mip)
+	{
+		Tex.MipOffsets[a * Tex.MipCount + mip] = TotalSize;
+		TotalSize += size_t(std::max(1u, Tex.Width >> mip)) * std::max(1u, Tex.Height >> mip) * BytesPerPixel;
+	}
+	return TotalSize;
+}
+
+static std::shared_ptr<FCookedTexture> CreateRGBA16FTexture(uint Width, uint Height, uint MipCount, uint ArraySize)
+{
+	std::shared_ptr<FCookedTexture> pTex = std::make_shared<FCookedTexture>();
+	pTex->Format    = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	pTex->Width     = Width;
+	pTex->Height    = Height;
+	pTex->MipCount  = MipCount;
+	pTex->ArraySize = ArraySize;
+	pTex->Data.resize(ComputeSubresourceOffsets(*pTex, GetBytesPerPixel(EPixelFormat::RGBA16_FLOAT)));
+	return pTex;
+}
+
+static inline void EncodeRowRGBA16F(const float* pRGBA32F, uint NumPixels, const uint8* pDst)
+{
+	Convert(FImageView(const_cast<float*>(pRGBA32F), NumPixels, 1, EPixelFormat::RGBA32_FLOAT)
+		  , FImageView(const_cast<uint8*>(pDst), NumPixels, 1, EPixelFormat::RGBA16_FLOAT));
+}
+
+static inline void Normalize(float v[3])
+{
+	const float InvLen = 1.0f / std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	v[0] *= InvLen; v[1] *= InvLen; v[2] *= InvLen;
+}
+static inline void Cross(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// EQUIRECT SAMPLING
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+// matches DirectionToEquirectUV() in ShadingMath.hlsl
+static inline void DirectionToEquirectUV(const float d[3], float& u, float& v)
+{
+	u = std::atan2(d[2], d[0]) / (-2.0f * PI_F) + 0.5f;
+	v = std::asin(std::min(std::max(-d[1], -1.0f), 1.0f)) / PI_F + 0.5f;
+}
+// inverse of the above for the texel centers: latitude from v, longitude from u
+static inline void EquirectTexelDirection(uint x, uint y, uint Width, uint Height, float OutDirection[3], float& OutCosLatitude)
+{
+	const float Phi      = (0.5f - (x + 0.5f) / Width) * 2.0f * PI_F;
+	const float Latitude = ((y + 0.5f) / Height - 0.5f) * PI_F;
+	OutCosLatitude = std::cos(Latitude);
+	OutDirection[0] = std::cos(Phi) * OutCosLatitude;
+	OutDirection[1] = -std::sin(Latitude);
+	OutDirection[2] = std::sin(Phi) * OutCosLatitude;
+}
+
+struct FEquirectMip
+{
+	const float* pData;
+	uint Width;
+	uint Height;
+};
+
+// bilinear, wraps horizontally and clamps vertically
+static inline __m128 SampleBilinear(const FEquirectMip& Mip, float u, float v)
+{
+	const float fx = u * Mip.Width  - 0.5f;
+	const float fy = v * Mip.Height - 0.5f;
+	const float x0f = std::floor(fx);
+	const float y0f = std::floor(fy);
+	const __m128 tx = _mm_set1_ps(fx - x0f);
+	const __m128 ty = _mm_set1_ps(fy - y0f);
+
+	const int W = static_cast<int>(Mip.Width);
+	const int H = static_cast<int>(Mip.Height);
+	const int x0 = ((static_cast<int>(x0f) % W) + W) % W;
+	const int x1 = (x0 + 1) % W;
+	const int y0 = std::min(std::max(static_cast<int>(y0f), 0), H - 1);
+	const int y1 = std::min(std::max(static_cast<int>(y0f) + 1, 0), H - 1);
+
+	const __m128 c00 = _mm_loadu_ps(Mip.pData + (size_t(y0) * W + x0) * 4);
+	const __m128 c01 = _mm_loadu_ps(Mip.pData + (size_t(y0) * W + x1) * 4);
+	const __m128 c10 = _mm_loadu_ps(Mip.pData + (size_t(y1) * W + x0) * 4);
+	const __m128 c11 = _mm_loadu_ps(Mip.pData + (size_t(y1) * W + x1) * 4);
+	const __m128 Top    = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c01, c00), tx));
+	const __m128 Bottom = _mm_add_ps(c10, _mm_mul_ps(_mm_sub_ps(c11, c10), tx));
+	return _mm_add_ps(Top, _mm_mul_ps(_mm_sub_ps(Bottom, Top), ty));
+}
+
+static inline __m128 SampleTrilinear(const std::vector<FEquirectMip>& Mips, const float Direction[3], float MipLevel)
+{
+	float u, v;
+	DirectionToEquirectUV(Direction, u, v);
+
+	MipLevel = std::min(std::max(MipLevel, 0.0f), static_cast<float>(Mips.size() - 1));
+	const uint  Mip0 = static_cast<uint>(MipLevel);
+	const uint  Mip1 = std::min(Mip0 + 1, static_cast<uint>(Mips.size() - 1));
+	const float t = MipLevel - Mip0;
+
+	const __m128 c0 = SampleBilinear(Mips[Mip0], u, v);
+	if (t == 0.0f || Mip0 == Mip1)
+		return c0;
+	const __m128 c1 = SampleBilinear(Mips[Mip1], u, v);
+	return _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c1, c0), _mm_set1_ps(t)));
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// SPHERICAL HARMONICS
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static inline void EvaluateSHBasis(const float d[3], float Y[9])
+{
+	const float x = d[0], y = d[1], z = d[2];
+	Y[0] = 0.282095f;
+	Y[1] = 0.488603f * y;
+	Y[2] = 0.488603f * z;
+	Y[3] = 0.488603f * x;
+	Y[4] = 1.092548f * x * y;
+	Y[5] = 1.092548f * y * z;
+	Y[6] = 0.315392f * (3.0f * z * z - 1.0f);
+	Y[7] = 1.092548f * x * z;
+	Y[8] = 0.546274f * (x * x - y * y);
+}
+
+// Lambert convolution per band (PI, 2PI/3, PI/4) divided by PI: the diffuse
+// convolution shader outputs irradiance / PI, the cached cubemap matches that.
+static const float SH_BAND_FACTORS[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// SPECULAR PREFILTER
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+// Mirrors PSMain_SpecularIrradiance() in CubemapConvolution.hlsl: N=V=R, GGX importance sampling
+// w/ the sample's source mip picked from its PDF. The samples only depend on the roughness, so
+// they're computed once per mip in tangent space.
+struct FPrefilterSample
+{
+	float L[3]; // tangent space
+	float NdotL;
+	float MipLevel;
+};
+
+static inline float RadicalInverse_VdC(uint32 bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+static inline float NormalDistributionGGX(float NdotH, float Roughness)
+{
+	const float a  = Roughness * Roughness;
+	const float a2 = a * a;
+	const float nh2 = NdotH * NdotH;
+	const float denom = PI_F * (nh2 * (a2 - 1.0f) + 1.0f) * (nh2 * (a2 - 1.0f) + 1.0f);
+	if (denom < 1e-6f) return 1.0f;
+	return a2 / denom;
+}
+
+static std::vector<FPrefilterSample> ComputePrefilterSamples(float Roughness, uint NumSamples, uint EquirectWidth, uint EquirectHeight)
+{
+	std::vector<FPrefilterSample> Samples;
+	if (Roughness == 0.0f) // all the samples collapse to the mirror direction
+	{
+		Samples.push_back({ { 0.0f, 0.0f, 1.0f }, 1.0f, 0.0f });
+		return Samples;
+	}
+
+	const float a = Roughness * Roughness;
+	const float OmegaP = 4.0f * PI_F / (6.0f * EquirectWidth * EquirectHeight);
+	constexpr float MIP_BIAS = -1.0f;
+	Samples.reserve(NumSamples);
+	for (uint i = 0; i < NumSamples; ++i)
+	{
+		const float Xi0 = static_cast<float>(i) / NumSamples;
+		const float Xi1 = RadicalInverse_VdC(i);
+		const float Phi = 2.0f * PI_F * Xi0;
+		const float CosTheta = std::sqrt((1.0f - Xi1) / (1.0f + (a * a - 1.0f) * Xi1));
+		const float SinTheta = std::sqrt(std::max(0.0f, 1.0f - CosTheta * CosTheta));
+		const float H[3] = { std::cos(Phi) * SinTheta, std::sin(Phi) * SinTheta, CosTheta };
+
+		// L = reflect(-V, H) w/ V = N = +Z
+		FPrefilterSample s;
+		s.L[0] = 2.0f * CosTheta * H[0];
+		s.L[1] = 2.0f * CosTheta * H[1];
+		s.L[2] = 2.0f * CosTheta * H[2] - 1.0f;
+		s.NdotL = s.L[2];
+		if (s.NdotL <= 0.0f)
+			continue;
+
+		const float NdotH = CosTheta;
+		const float HdotV = CosTheta;
+		const float pdf = NormalDistributionGGX(NdotH, Roughness) * NdotH / (4.0f * HdotV);
+		const float OmegaS = 1.0f / std::max(NumSamples * pdf, 0.00001f);
+		s.MipLevel = std::max(0.5f * std::log2(OmegaS / OmegaP) + MIP_BIAS, 0.0f);
+		Samples.push_back(s);
+	}
+	return Samples;
+}
+
+
+namespace
+{
+	struct FCacheFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint64 Key;
+		float  SH9Irradiance[9 * 3];
+		uint32 NumTextures;
+	};
+	struct FCacheFileTexture
+	{
+		uint32 Format;
+		uint32 Width;
+		uint32 Height;
+		uint32 MipCount;
+		uint32 ArraySize;
+		uint32 BytesPerPixel;
+		uint64 DataOffset; // from the beginning of the file
+		uint64 DataSize;
+	};
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// INTERFACE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+uint64 FEnvironmentMapCacheSettings::GetHash() const
+{
+	const uint64 Fields[] =
+	{
+		  ENVIRONMENT_MAP_CACHE_VERSION
+		, EquirectWidth
+		, EquirectHeight
+		, DiffuseCubemapSize
+		, SpecularCubemapSize
+		, SpecularMipCount
+		, SpecularSampleCount
+		, DiffuseSourceMip
+	};
+	return ShaderCache::Hash(Fields, sizeof(Fields));
+}
+
+namespace EnvironmentMapCache
+{
+	uint64 GetCacheKey(uint64 SourceHash, const FEnvironmentMapCacheSettings& Settings)
+	{
+		const uint64 Fields[] = { Settings.GetHash(), SourceHash };
+		return ShaderCache::Hash(Fields, sizeof(Fields));
+	}
+
+	std::string GetCacheFilePath(const std::string& CacheDirectory, const std::string& EnvMapName, uint64 CacheKey)
+	{
+		char KeyStr[17];
+		snprintf(KeyStr, sizeof(KeyStr), "%016llx", CacheKey);
+		return CacheDirectory + "/" + EnvMapName + "_" + KeyStr + ".envmap";
+	}
+
+	void GetCubemapTexelDirection(uint Face, uint x, uint y, uint Size, float d[3])
+	{
+		const float u = 2.0f * (x + 0.5f) / Size - 1.0f;
+		const float v = 2.0f * (y + 0.5f) / Size - 1.0f;
+		switch (Face)
+		{
+		case 0: d[0] =  1.0f; d[1] = -v;    d[2] = -u;    break; // +X
+		case 1: d[0] = -1.0f; d[1] = -v;    d[2] =  u;    break; // -X
+		case 2: d[0] =  u;    d[1] =  1.0f; d[2] =  v;    break; // +Y
+		case 3: d[0] =  u;    d[1] = -1.0f; d[2] = -v;    break; // -Y
+		case 4: d[0] =  u;    d[1] = -v;    d[2] =  1.0f; break; // +Z
+		case 5: d[0] = -u;    d[1] = -v;    d[2] = -1.0f; break; // -Z
+		default: assert(false); break;
+		}
+		Normalize(d);
+	}
+
+	void ProjectIrradianceSH9(const float* pRGBA32F, uint Width, uint Height, ThreadPool* pWorkers, std::array<float, 9 * 3>& OutSH9)
+	{
+		// per-row partial sums are reduced in row order afterwards: same result for any number of threads
+		std::vector<double> RowSums(size_t(Height) * 27, 0.0);
+		const double TexelSolidAngle = (2.0 * PI_F / Width) * (PI_F / Height); // * cos(latitude)
+
+		ParallelFor(Height, 8, pWorkers, [&](uint RowBegin, uint RowEnd)
+		{
+			for (uint y = RowBegin; y < RowEnd; ++y)
+			{
+				double* pSum = &RowSums[size_t(y) * 27];
+				for (uint x = 0; x < Width; ++x)
+				{
+					float Direction[3]; float CosLatitude;
+					EquirectTexelDirection(x, y, Width, Height, Direction, CosLatitude);
+
+					float Y[9];
+					EvaluateSHBasis(Direction, Y);
+					const float* pRGB = pRGBA32F + (size_t(y) * Width + x) * 4;
+					const double dOmega = TexelSolidAngle * CosLatitude;
+					for (int i = 0; i < 9; ++i)
+					{
+						pSum[i * 3 + 0] += pRGB[0] * Y[i] * dOmega;
+						pSum[i * 3 + 1] += pRGB[1] * Y[i] * dOmega;
+						pSum[i * 3 + 2] += pRGB[2] * Y[i] * dOmega;
+					}
+				}
+			}
+		});
+
+		double SH9[27] = {};
+		for (uint y = 0; y < Height; ++y)
+			for (int i = 0; i < 27; ++i)
+				SH9[i] += RowSums[size_t(y) * 27 + i];
+		for (int i = 0; i < 27; ++i)
+			OutSH9[i] = static_cast<float>(SH9[i] * SH_BAND_FACTORS[i / 3]);
+	}
+
+	void EvaluateSH9(const std::array<float, 9 * 3>& SH9, const float Direction[3], float OutRGB[3])
+	{
+		float Y[9];
+		EvaluateSHBasis(Direction, Y);
+		for (int c = 0; c < 3; ++c)
+		{
+			float Sum = 0.0f;
+			for (int i = 0; i < 9; ++i)
+				Sum += SH9[i * 3 + c] * Y[i];
+			OutRGB[c] = std::max(Sum, 0.0f); // ringing can go negative
+		}
+	}
+
+	bool Cook(const float* pRGBA32F, uint Width, uint Height, const FEnvironmentMapCacheSettings& Settings, ThreadPool* pWorkers, FEnvironmentMapCacheData& OutData)
+	{
+		if (!pRGBA32F || Width == 0 || Height == 0 || Settings.EquirectWidth == 0 || Settings.EquirectHeight == 0)
+			return false;
+
+		// equirect mip chain in float: mip0 at the target resolution, then the min filter like the runtime mip generation for HDR textures
+		const uint EquirectMipCount = CalculateMipLevelCount(Settings.EquirectWidth, Settings.EquirectHeight);
+		std::vector<std::vector<float>> EquirectMips(EquirectMipCount);
+		std::vector<FEquirectMip> Mips(EquirectMipCount);
+		for (uint mip = 0; mip < EquirectMipCount; ++mip)
+		{
+			const uint W = std::max(1u, Settings.EquirectWidth  >> mip);
+			const uint H = std::max(1u, Settings.EquirectHeight >> mip);
+			EquirectMips[mip].resize(size_t(W) * H * 4);
+			Mips[mip] = { EquirectMips[mip].data(), W, H };
+
+			const FImageView Dst(EquirectMips[mip].data(), W, H, EPixelFormat::RGBA32_FLOAT);
+			if (mip == 0)
+			{
+				if (Width == W && Height == H)
+					memcpy(EquirectMips[0].data(), pRGBA32F, EquirectMips[0].size() * sizeof(float));
+				else
+					Resize(FImageView(const_cast<float*>(pRGBA32F), Width, Height, EPixelFormat::RGBA32_FLOAT), Dst, EFilter::TRIANGLE, pWorkers);
+			}
+			else
+			{
+				const FImageView Src(EquirectMips[mip - 1].data(), Mips[mip - 1].Width, Mips[mip - 1].Height, EPixelFormat::RGBA32_FLOAT);
+				Downsample2x2(Src, Dst, EFilter::MIN, pWorkers);
+			}
+		}
+
+		OutData.pEquirect = CreateRGBA16FTexture(Settings.EquirectWidth, Settings.EquirectHeight, EquirectMipCount, 1);
+		for (uint mip = 0; mip < EquirectMipCount; ++mip)
+		{
+			const FImageView Src(EquirectMips[mip].data(), Mips[mip].Width, Mips[mip].Height, EPixelFormat::RGBA32_FLOAT);
+			const FImageView Dst(const_cast<uint8*>(OutData.pEquirect->GetMipData(mip)), Mips[mip].Width, Mips[mip].Height, EPixelFormat::RGBA16_FLOAT);
+			Convert(Src, Dst, pWorkers);
+		}
+
+		// diffuse irradiance: SH9 projection, evaluated for each cube texel
+		const FEquirectMip& DiffuseSource = Mips[std::min(Settings.DiffuseSourceMip, EquirectMipCount - 1)];
+		ProjectIrradianceSH9(DiffuseSource.pData, DiffuseSource.Width, DiffuseSource.Height, pWorkers, OutData.SH9Irradiance);
+
+		const uint DiffuseSize = Settings.DiffuseCubemapSize;
+		OutData.pDiffuseIrradiance = CreateRGBA16FTexture(DiffuseSize, DiffuseSize, 1, NUM_CUBE_FACES);
+		ParallelFor(NUM_CUBE_FACES * DiffuseSize, DiffuseSize, pWorkers, [&](uint RowBegin, uint RowEnd)
+		{
+			std::vector<float> Row(DiffuseSize * 4);
+			for (uint r = RowBegin; r < RowEnd; ++r)
+			{
+				const uint Face = r / DiffuseSize;
+				const uint y    = r % DiffuseSize;
+				for (uint x = 0; x < DiffuseSize; ++x)
+				{
+					float Direction[3];
+					GetCubemapTexelDirection(Face, x, y, DiffuseSize, Direction);
+					EvaluateSH9(OutData.SH9Irradiance, Direction, &Row[x * 4]);
+					Row[x * 4 + 3] = 1.0f;
+				}
+				EncodeRowRGBA16F(Row.data(), DiffuseSize, OutData.pDiffuseIrradiance->GetMipData(0, Face) + size_t(y) * DiffuseSize * 8);
+			}
+		});
+
+		// specular irradiance: GGX prefiltered mip chain
+		const uint SpecularSize = Settings.SpecularCubemapSize;
+		const uint SpecularMipCount = std::max(1u, std::min(Settings.SpecularMipCount, CalculateMipLevelCount(SpecularSize, SpecularSize)));
+		OutData.pSpecularIrradiance = CreateRGBA16FTexture(SpecularSize, SpecularSize, SpecularMipCount, NUM_CUBE_FACES);
+		for (uint mip = 0; mip < SpecularMipCount; ++mip)
+		{
+			const float Roughness = SpecularMipCount > 1 ? static_cast<float>(mip) / (SpecularMipCount - 1) : 0.0f;
+			const std::vector<FPrefilterSample> Samples = ComputePrefilterSamples(Roughness, Settings.SpecularSampleCount, Settings.EquirectWidth, Settings.EquirectHeight);
+			const uint MipSize = std::max(1u, SpecularSize >> mip);
+
+			ParallelFor(NUM_CUBE_FACES * MipSize, 1, pWorkers, [&](uint RowBegin, uint RowEnd)
+			{
+				std::vector<float> Row(MipSize * 4);
+				for (uint r = RowBegin; r < RowEnd; ++r)
+				{
+					const uint Face = r / MipSize;
+					const uint y    = r % MipSize;
+					for (uint x = 0; x < MipSize; ++x)
+					{
+						float N[3];
+						GetCubemapTexelDirection(Face, x, y, MipSize, N);
+
+						// tangent frame of ImportanceSampleGGX()
+						const float Up[3] = { std::abs(N[2]) < 0.999f ? 0.0f : 1.0f, 0.0f, std::abs(N[2]) < 0.999f ? 1.0f : 0.0f };
+						float T[3], B[3];
+						Cross(Up, N, T); Normalize(T);
+						Cross(N, T, B);
+
+						__m128 Sum = _mm_setzero_ps();
+						float TotalWeight = 0.0f;
+						for (const FPrefilterSample& s : Samples)
+						{
+							const float L[3] =
+							{
+								  T[0] * s.L[0] + B[0] * s.L[1] + N[0] * s.L[2]
+								, T[1] * s.L[0] + B[1] * s.L[1] + N[1] * s.L[2]
+								, T[2] * s.L[0] + B[2] * s.L[1] + N[2] * s.L[2]
+							};
+							Sum = _mm_add_ps(Sum, _mm_mul_ps(SampleTrilinear(Mips, L, s.MipLevel), _mm_set1_ps(s.NdotL)));
+							TotalWeight += s.NdotL;
+						}
+						_mm_storeu_ps(&Row[x * 4], _mm_div_ps(Sum, _mm_set1_ps(std::max(TotalWeight, 0.0001f))));
+						Row[x * 4 + 3] = 1.0f;
+					}
+					EncodeRowRGBA16F(Row.data(), MipSize, OutData.pSpecularIrradiance->GetMipData(mip, Face) + size_t(y) * MipSize * 8);
+				}
+			});
+		}
+
+		return true;
+	}
+
+	bool Save(const std::string& CacheFilePath, uint64 CacheKey, const FEnvironmentMapCacheData& Data)
+	{
+		const FCookedTexture* pTextures[NUM_CACHED_TEXTURES] = { Data.pEquirect.get(), Data.pDiffuseIrradiance.get(), Data.pSpecularIrradiance.get() };
+
+		FCacheFileHeader Header = {};
+		Header.Magic       = CACHE_FILE_MAGIC;
+		Header.Version     = ENVIRONMENT_MAP_CACHE_VERSION;
+		Header.Key         = CacheKey;
+		Header.NumTextures = NUM_CACHED_TEXTURES;
+		memcpy(Header.SH9Irradiance, Data.SH9Irradiance.data(), sizeof(Header.SH9Irradiance));
+
+		FCacheFileTexture TextureHeaders[NUM_CACHED_TEXTURES] = {};
+		uint64 Offset = sizeof(FCacheFileHeader) + sizeof(TextureHeaders);
+		for (uint i = 0; i < NUM_CACHED_TEXTURES; ++i)
+		{
+			if (!pTextures[i])
+				return false;
+			FCookedTexture Layout = *pTextures[i]; // recompute the size from the layout, the texels might not be owned by the texture
+			FCacheFileTexture& t = TextureHeaders[i];
+			Offset = (Offset + CACHE_DATA_ALIGNMENT - 1) & ~(CACHE_DATA_ALIGNMENT - 1);
+			t.Format        = static_cast<uint32>(Layout.Format);
+			t.Width         = Layout.Width;
+			t.Height        = Layout.Height;
+			t.MipCount      = Layout.MipCount;
+			t.ArraySize     = Layout.ArraySize;
+			t.BytesPerPixel = GetBytesPerPixel(EPixelFormat::RGBA16_FLOAT);
+			t.DataOffset    = Offset;
+			t.DataSize      = ComputeSubresourceOffsets(Layout, t.BytesPerPixel);
+			Offset += t.DataSize;
+		}
+
+		// write to a temporary file first so an interrupted write doesn't leave a corrupt cache behind
+		const std::string TempFilePath = CacheFilePath + ".tmp";
+		{
+			std::ofstream file(TempFilePath, std::ios::binary);
+			if (!file.is_open())
+			{
+				Log::Error("EnvironmentMapCache: cannot open file for writing: %s", TempFilePath.c_str());
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+			file.write(reinterpret_cast<const char*>(TextureHeaders), sizeof(TextureHeaders));
+			for (uint i = 0; i < NUM_CACHED_TEXTURES; ++i)
+			{
+				const std::vector<char> Padding(static_cast<size_t>(TextureHeaders[i].DataOffset - static_cast<uint64>(file.tellp())), 0);
+				file.write(Padding.data(), Padding.size());
+				file.write(reinterpret_cast<const char*>(pTextures[i]->GetData()), TextureHeaders[i].DataSize);
+			}
+			if (!file.good())
+				return false;
+		}
+		std::remove(CacheFilePath.c_str());
+		return std::rename(TempFilePath.c_str(), CacheFilePath.c_str()) == 0;
+	}
+
+	bool Load(const std::string& CacheFilePath, uint64 CacheKey, FEnvironmentMapCacheData& OutData)
+	{
+		std::shared_ptr<FMappedFile> pFile = std::make_shared<FMappedFile>();
+		if (!pFile->Open(CacheFilePath) || pFile->GetSize() < sizeof(FCacheFileHeader) + sizeof(FCacheFileTexture) * NUM_CACHED_TEXTURES)
+			return false;
+
+		FCacheFileHeader Header;
+		memcpy(&Header, pFile->GetData(), sizeof(Header));
+		if (Header.Magic != CACHE_FILE_MAGIC || Header.Version != ENVIRONMENT_MAP_CACHE_VERSION || Header.Key != CacheKey || Header.NumTextures != NUM_CACHED_TEXTURES)
+		{
+			Log::Warning("EnvironmentMapCache: stale cache file: %s", CacheFilePath.c_str());
+			return false;
+		}
+
+		std::shared_ptr<FCookedTexture> pTextures[NUM_CACHED_TEXTURES];
+		for (uint i = 0; i < NUM_CACHED_TEXTURES; ++i)
+		{
+			FCacheFileTexture t;
+			memcpy(&t, pFile->GetData() + sizeof(FCacheFileHeader) + i * sizeof(FCacheFileTexture), sizeof(t));
+
+			std::shared_ptr<FCookedTexture> pTex = std::make_shared<FCookedTexture>();
+			pTex->Format    = static_cast<DXGI_FORMAT>(t.Format);
+			pTex->Width     = t.Width;
+			pTex->Height    = t.Height;
+			pTex->MipCount  = t.MipCount;
+			pTex->ArraySize = t.ArraySize;
+			const size_t ExpectedSize = ComputeSubresourceOffsets(*pTex, t.BytesPerPixel);
+			if (t.MipCount == 0 || ExpectedSize != t.DataSize || t.DataOffset + t.DataSize > pFile->GetSize())
+			{
+				Log::Error("EnvironmentMapCache: corrupt cache file: %s", CacheFilePath.c_str());
+				return false;
+			}
+			pTex->pExternalData = pFile->GetData() + t.DataOffset;
+			pTex->pExternalDataOwner = pFile; // the mapping lives until the last texture upload referencing it is done
+			pTextures[i] = std::move(pTex);
+		}
+
+		memcpy(OutData.SH9Irradiance.data(), Header.SH9Irradiance, sizeof(Header.SH9Irradiance));
+		OutData.pEquirect           = std::move(pTextures[0]);
+		OutData.pDiffuseIrradiance  = std::move(pTextures[1]);
+		OutData.pSpecularIrradiance = std::move(pTextures[2]);
+		return true;
+	}
+}
@@ -0,0 +1,77 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Core/Types.h"
+#include "../Renderer/TextureCache.h"
+
+#include <array>
+#include <memory>
+#include <string>
+
+class ThreadPool;
+
+// CPU preprocessing of the HDR environment maps. The downsized equirect (w/ its mip chain),
+// the SH9 diffuse irradiance and the GGX prefiltered specular cubemap are cooked once
+// and stored in a single file in VQRenderer::EnvironmentMapCacheDirectory, which is
+// memory mapped on load and uploaded without any further processing.
+//
+// None of this touches the GPU: the cooking can run & be verified headless.
+struct FEnvironmentMapCacheSettings
+{
+	uint EquirectWidth        = 0;   // resolution of the cached equirect, the source is resized if it doesn't match
+	uint EquirectHeight       = 0;
+	uint DiffuseCubemapSize   = 64;  // SH9 irradiance evaluated per texel
+	uint SpecularCubemapSize  = 256;
+	uint SpecularMipCount     = 8;   // 256 -> 2x2, roughness = mip / (SpecularMipCount-1)
+	uint SpecularSampleCount  = 512; // GGX importance samples per texel
+	uint DiffuseSourceMip     = 3;   // equirect mip the SH9 coefficients are projected from
+
+	uint64 GetHash() const;
+};
+
+struct FEnvironmentMapCacheData
+{
+	// Irradiance SH9 coefficients (RGB, Lambert convolution & 1/PI applied):
+	// E(n)/PI = sum_i SH9Irradiance[i] * Y_i(n), which is what the diffuse irradiance cubemap stores.
+	std::array<float, 9 * 3>        SH9Irradiance = {};
+
+	std::shared_ptr<FCookedTexture> pEquirect;           // RGBA16F w/ mips (min filtered like the runtime HDR mips)
+	std::shared_ptr<FCookedTexture> pDiffuseIrradiance;  // RGBA16F cubemap
+	std::shared_ptr<FCookedTexture> pSpecularIrradiance; // RGBA16F cubemap w/ SpecularMipCount mips
+};
+
+namespace EnvironmentMapCache
+{
+	// Key = xxHash64 of the source file content hash (see FileHashCache) & the cache settings (incl. the target resolution)
+	uint64      GetCacheKey(uint64 SourceHash, const FEnvironmentMapCacheSettings& Settings);
+	std::string GetCacheFilePath(const std::string& CacheDirectory, const std::string& EnvMapName, uint64 CacheKey);
+
+	// pRGBA32F: Width*Height equirect texels. The rows are distributed to pWorkers (optional),
+	// the results don't depend on the number of threads.
+	bool Cook(const float* pRGBA32F, uint Width, uint Height, const FEnvironmentMapCacheSettings& Settings, ThreadPool* pWorkers, FEnvironmentMapCacheData& OutData);
+
+	bool Save(const std::string& CacheFilePath, uint64 CacheKey, const FEnvironmentMapCacheData& Data);
+	bool Load(const std::string& CacheFilePath, uint64 CacheKey, FEnvironmentMapCacheData& OutData); // maps the file once, the textures point into the mapping
+
+	// building blocks of Cook()
+	void ProjectIrradianceSH9(const float* pRGBA32F, uint Width, uint Height, ThreadPool* pWorkers, std::array<float, 9 * 3>& OutSH9);
+	void EvaluateSH9(const std::array<float, 9 * 3>& SH9, const float Direction[3], float OutRGB[3]);
+	void GetCubemapTexelDirection(uint Face, uint x, uint y, uint Size, float OutDirection[3]); // D3D cube face order & orientation
+}
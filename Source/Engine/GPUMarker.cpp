@@ -20,12 +20,15 @@
 #include "GPUMarker.h"
 
 ScopedMarker::ScopedMarker(const char* pLabel, unsigned PIXColor)
+	: mpLabel(pLabel)
+	, mBeginTimeNs(Profiler::BeginScope())
 {
 	PIXBeginEvent(PIXColor, pLabel);
 }
 ScopedMarker::~ScopedMarker()
 {
 	PIXEndEvent();
+	Profiler::EndScope(mpLabel, mBeginTimeNs);
 }
 
 // https://devblogs.microsoft.com/pix/winpixeventruntime/#:~:text=An%20%E2%80%9Cevent%E2%80%9D%20represents%20a%20region,a%20single%20point%20in%20time.
@@ -25,6 +25,8 @@
 #endif
 #include "WinPixEventRuntime/Include/WinPixEventRuntime/pix3.h"
 
+#include "Core/Profiler.h"
+
 #define SCOPED_GPU_MARKER(pCmd, pStr)       ScopedGPUMarker GPUMarker(pCmd,pStr)
 #define SCOPED_CPU_MARKER(pStr)             ScopedMarker    CPUMarker(pStr)
 #define SCOPED_CPU_MARKER_C(pStr, PIXColor) ScopedMarker    CPUMarker(pStr, PIXColor)
@@ -33,11 +35,18 @@ struct ID3D12GraphicsCommandList;
 struct ID3D12CommandQueue;
 
 
+// PIX event + Profiler scope
 class ScopedMarker
 {
 public:
 	ScopedMarker(const char* pLabel, unsigned PIXColor = PIX_COLOR_DEFAULT);
 	~ScopedMarker();
+
+	ScopedMarker(const ScopedMarker&)            = delete;
+	ScopedMarker& operator=(const ScopedMarker&) = delete;
+private:
+	const char* mpLabel;
+	uint64      mBeginTimeNs;
 };
 
 class ScopedGPUMarker// : public ScopedMarker
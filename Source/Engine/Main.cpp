@@ -80,6 +80,38 @@ void ParseCommandLineParameters(FStartupParameters& refStartupParams, PSTR pScmd
 				refStartupParams.EngineSettings.NumAutomatedTestFrames = std::atoi(paramValue.c_str());
 			}
 		}
+		if (paramName == "-Benchmark")
+		{
+			refStartupParams.bOverrideENGSetting_bBenchmarkRun = true;
+			refStartupParams.EngineSettings.bBenchmarkRun = true;
+		}
+		if (paramName == "-BenchmarkLevels")
+		{
+			refStartupParams.bOverrideENGSetting_bBenchmarkRun = true;
+			refStartupParams.EngineSettings.bBenchmarkRun = true;
+			refStartupParams.bOverrideENGSetting_BenchmarkLevels = true;
+			refStartupParams.EngineSettings.BenchmarkLevels = paramValue;
+		}
+		if (paramName == "-BenchmarkWarmupFrames")
+		{
+			refStartupParams.bOverrideENGSetting_NumBenchmarkWarmupFrames = true;
+			refStartupParams.EngineSettings.NumBenchmarkWarmupFrames = StrUtil::ParseInt(paramValue);
+		}
+		if (paramName == "-BenchmarkFrames")
+		{
+			refStartupParams.bOverrideENGSetting_NumBenchmarkFrames = true;
+			refStartupParams.EngineSettings.NumBenchmarkFrames = StrUtil::ParseInt(paramValue);
+		}
+		if (paramName == "-BenchmarkReport")
+		{
+			refStartupParams.bOverrideENGSetting_BenchmarkReportPath = true;
+			refStartupParams.EngineSettings.BenchmarkReportPath = paramValue;
+		}
+		if (paramName == "-MemoryReport")
+		{
+			refStartupParams.bOverrideENGSetting_MemoryReportPath = true;
+			refStartupParams.EngineSettings.MemoryReportPath = paramValue;
+		}
 		if (paramName == "-Width" || paramName == "-W")
 		{
 			refStartupParams.bOverrideENGSetting_MainWindowWidth = true;
@@ -160,12 +192,49 @@ void ParseCommandLineParameters(FStartupParameters& refStartupParams, PSTR pScmd
 			else
 				refStartupParams.EngineSettings.gfx.MaxFrameRate = StrUtil::ParseInt(paramValue);
 		}
+		if (paramName == "-FrameLimiterSpinThreshold")
+		{
+			refStartupParams.bOverrideGFXSetting_FrameLimiterSpinThreshold = true;
+			refStartupParams.EngineSettings.gfx.FrameLimiterSpinThresholdMs = StrUtil::ParseFloat(paramValue);
+		}
+		if (paramName == "-TextureStreaming")
+		{
+			refStartupParams.bOverrideGFXSetting_bTextureStreaming = true;
+			if (paramValue.empty())
+			{
+				refStartupParams.EngineSettings.gfx.bTextureStreaming = true;
+			}
+			else
+			{
+				refStartupParams.EngineSettings.gfx.bTextureStreaming = StrUtil::ParseBool(paramValue);
+			}
+		}
+		if (paramName == "-TextureStreamingBudget")
+		{
+			refStartupParams.bOverrideGFXSetting_TextureStreamingBudget = true;
+			refStartupParams.EngineSettings.gfx.TextureStreamingBudgetMB = StrUtil::ParseInt(paramValue);
+		}
 
 		if (paramName == "-Scene")
 		{
 			refStartupParams.bOverrideENGSetting_StartupScene = true;
 			refStartupParams.EngineSettings.StartupScene = paramValue;
 		}
+		if (paramName == "-UpdateRenderFrameLatency")
+		{
+			refStartupParams.bOverrideENGSetting_UpdateRenderFrameLatency = true;
+			refStartupParams.EngineSettings.UpdateRenderFrameLatency = StrUtil::ParseInt(paramValue);
+		}
+		if (paramName == "-BuildPak")
+		{
+			refStartupParams.bOverrideENGSetting_bBuildPakFile = true;
+			refStartupParams.EngineSettings.bBuildPakFile = true;
+		}
+		if (paramName == "-HotReloadShaders")
+		{
+			refStartupParams.bOverrideENGSetting_bHotReloadShaders = true;
+			refStartupParams.EngineSettings.bHotReloadShaders = paramValue.empty() ? true : StrUtil::ParseBool(paramValue);
+		}
 	}
 }
 
@@ -52,5 +52,6 @@ int Material::GetTextureConfig() const
 	textureConfig |= TexHeightMap                      == -1 ? 0 : (1 << 6);
 	textureConfig |= TexEmissiveMap                    == -1 ? 0 : (1 << 7);
 	textureConfig |= TexOcclusionRoughnessMetalnessMap == -1 ? 0 : (1 << 8);
+	textureConfig |= (TexNormalMap == -1 || !bNormalMapXYOnly) ? 0 : (1 << 9);
 	return textureConfig;
 }
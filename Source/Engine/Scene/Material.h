@@ -70,6 +70,8 @@ struct Material // 56 Bytes
 	TextureID TexAmbientOcclusionMap = INVALID_ID;
 	
 	SRV_ID SRVMaterialMaps = INVALID_ID;
+
+	bool bNormalMapXYOnly = false; // BC5 normal maps store XY only, the shaders reconstruct Z
 	//------------------------------------------------------------
 
 	VQ_SHADER_DATA::MaterialData GetCBufferData() const;
@@ -358,6 +358,19 @@ void Scene::PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX)
 	SceneView.cameraPosition = XMLoadFloat3(&camPos);
 	SceneView.MainViewCameraYaw = cam.GetYaw();
 	SceneView.MainViewCameraPitch = cam.GetPitch();
+	{
+		Camera skyCam = mCameras[mIndex_SelectedCamera].Clone(); // Clone() isn't const
+		FCameraParameters p = {};
+		p.bInitializeCameraController = false;
+		p.ProjectionParams = skyCam.GetProjectionParameters();
+		p.ProjectionParams.bPerspectiveProjection = true;
+		p.ProjectionParams.FieldOfView = p.ProjectionParams.FieldOfView * RAD2DEG; // TODO: remove the need for this conversion
+		p.x = p.y = p.z = 0;
+		p.Yaw   = SceneView.MainViewCameraYaw   * RAD2DEG;
+		p.Pitch = SceneView.MainViewCameraPitch * RAD2DEG;
+		skyCam.InitializeCamera(p);
+		SceneView.environmentMapViewProj = skyCam.GetViewMatrix() * skyCam.GetProjectionMatrix();
+	}
 
 	const FFrustumPlaneset ViewFrustumPlanes = FFrustumPlaneset::ExtractFromMatrix(SceneView.viewProj);
 
@@ -634,7 +647,7 @@ void Scene::PrepareLightMeshRenderParams(FSceneView& SceneView) const
 }
 
 
-void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, std::vector<FMeshRenderCommand>& MeshRenderCommands) const
+void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, RenderCommandList<FMeshRenderCommand>& MeshRenderCommands) const
 {
 	SCOPED_CPU_MARKER("Scene::PrepareSceneMeshRenderParams()");
 
@@ -702,6 +715,9 @@ void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustum
 			meshRenderCmd.matWorldTransformation = pTF->matWorldTransformation();
 			meshRenderCmd.matNormalTransformation = pTF->NormalMatrix(meshRenderCmd.matWorldTransformation);
 			meshRenderCmd.matID = model.mData.mOpaqueMaterials.at(meshID);
+			const Material& mat = mMaterials.at(meshRenderCmd.matID);
+			meshRenderCmd.matData = mat.GetCBufferData();
+			meshRenderCmd.matSRV = mat.SRVMaterialMaps;
 			MeshRenderCommands.push_back(meshRenderCmd);
 		}
 	}
@@ -730,6 +746,9 @@ void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustum
 			meshRenderCmd.matWorldTransformation = pTF->matWorldTransformation();
 			meshRenderCmd.matNormalTransformation = pTF->NormalMatrix(meshRenderCmd.matWorldTransformation);
 			meshRenderCmd.matID = model.mData.mOpaqueMaterials.at(id);
+			const Material& mat = mMaterials.at(meshRenderCmd.matID);
+			meshRenderCmd.matData = mat.GetCBufferData();
+			meshRenderCmd.matSRV = mat.SRVMaterialMaps;
 
 			meshRenderCmd.ModelName = model.mModelName;
 			meshRenderCmd.MaterialName = ""; // TODO
@@ -904,7 +923,7 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 		for (size_t iFrustum = 0; iFrustum < NumMeshFrustums; ++iFrustum)
 		{
 			FSceneShadowView::FShadowView*& pShadowView = FrustumIndex_pShadowViewLookup.at(iFrustum);
-			std::vector<FShadowMeshRenderCommand>& vMeshRenderList = pShadowView->meshRenderCommands;
+			RenderCommandList<FShadowMeshRenderCommand>& vMeshRenderList = pShadowView->meshRenderCommands;
 			vMeshRenderList.clear();
 
 			const std::vector<size_t>& CulledBoundingBoxIndexList_Msh = MeshFrustumCullWorkerContext.vCulledBoundingBoxIndexListPerView[iFrustum];
@@ -931,7 +950,7 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 
 	auto fnGatherMeshRenderParamsForLight = [&](const Light& l, FSceneShadowView::FShadowView& ShadowView)
 	{
-		std::vector<FShadowMeshRenderCommand>& vMeshRenderList = ShadowView.meshRenderCommands;
+		RenderCommandList<FShadowMeshRenderCommand>& vMeshRenderList = ShadowView.meshRenderCommands;
 		vMeshRenderList.clear();
 		for (const GameObject* pObj : mpObjects)
 		{
@@ -30,6 +30,8 @@
 #include "../AssetLoader.h"
 #include "../PostProcess/PostProcess.h"
 
+#include <chrono>
+
 // fwd decl
 class Input;
 struct Material;
@@ -64,6 +66,7 @@ struct FSceneView
 	DirectX::XMMATRIX     proj;
 	DirectX::XMMATRIX     projInverse;
 	DirectX::XMMATRIX     directionalLightProjection;
+	DirectX::XMMATRIX     environmentMapViewProj; // main view rotation only, the sky is centered on the camera
 	DirectX::XMVECTOR     cameraPosition;
 	float                 MainViewCameraYaw = 0.0f;
 	float                 MainViewCameraPitch = 0.0f;
@@ -80,10 +83,10 @@ struct FSceneView
 	FSceneRenderParameters sceneParameters;
 	FPostProcessParameters postProcessParameters;
 
-	std::vector<FMeshRenderCommand>  meshRenderCommands;
-	std::vector<FLightRenderCommand> lightRenderCommands;
-	std::vector<FLightRenderCommand> lightBoundsRenderCommands;
-	std::vector<FBoundingBoxRenderCommand> boundingBoxRenderCommands;
+	RenderCommandList<FMeshRenderCommand>  meshRenderCommands;
+	RenderCommandList<FLightRenderCommand> lightRenderCommands;
+	RenderCommandList<FLightRenderCommand> lightBoundsRenderCommands;
+	RenderCommandList<FBoundingBoxRenderCommand> boundingBoxRenderCommands;
 
 };
 struct FSceneShadowView
@@ -91,7 +94,7 @@ struct FSceneShadowView
 	struct FShadowView
 	{
 		DirectX::XMMATRIX matViewProj;
-		std::vector<FShadowMeshRenderCommand> meshRenderCommands;
+		RenderCommandList<FShadowMeshRenderCommand> meshRenderCommands;
 	};
 	struct FPointLightLinearDepthParams
 	{
@@ -136,6 +139,47 @@ struct FSceneStats
 	uint NumCameras;
 };
 
+//--- Scene Loading ---
+// Scene::StartLoading() sets up the load, Scene::UpdateLoading() then runs the CPU stages in order, a few
+// items per frame within the time budget, while the models & textures load on the worker threads.
+enum class ESceneLoadStage
+{
+	BUILTIN_MESHES = 0,
+	SCENE_SPECIFIC,       // Scene::LoadScene()
+	BUILTIN_MATERIALS,
+	SCENE_MATERIALS,      // per material, starts the texture loads
+	GAME_OBJECTS,         // per object, starts the model loads
+	LIGHTS,
+	CAMERAS,
+	POST_PROCESS,
+	MODELS,               // worker threads
+	TEXTURES,             // worker threads, overlaps w/ MODELS
+	MATERIAL_ASSIGNMENTS, // upload thread & workers, as the textures become resident
+	BOUNDING_BOXES,       // Scene::OnLoadComplete() from here on
+	INITIALIZE_SCENE,     // Scene::InitializeScene()
+
+	NUM_SCENE_LOAD_STAGES
+};
+const char* GetSceneLoadStageName(ESceneLoadStage Stage);
+
+struct FSceneLoadStageStats
+{
+	uint   NumItems = 0;
+	uint   NumItemsDone = 0;
+	uint64 NumBytes = 0;       // file bytes read, MODELS & TEXTURES
+	float  StartTime = -1.0f;  // seconds since the load started, < 0 if the stage hasn't started
+	float  EndTime = -1.0f;    // < 0 if the stage hasn't finished
+};
+struct FSceneLoadProgress
+{
+	std::array<FSceneLoadStageStats, static_cast<size_t>(ESceneLoadStage::NUM_SCENE_LOAD_STAGES)> Stages;
+	ESceneLoadStage CurrentStage = ESceneLoadStage::BUILTIN_MESHES;
+	bool            bCancelled = false;
+
+	float GetProgress() const; // [0-1], stages are weighted by their typical share of the load time
+};
+//--- Scene Loading ---
+
 class SceneBoundingBoxHierarchy
 {
 public:
@@ -207,6 +251,7 @@ class Scene
 {
 	// Engine has easy access to the scene as scene is essentially a part of the engine.
 	friend class VQEngine; 
+	friend class TextureStreamer; // swaps the streamed textures of the materials
 
 //----------------------------------------------------------------------------------------------------------------
 // SCENE INTERFACE
@@ -242,8 +287,12 @@ private: // Derived Scenes shouldn't access these functions
 	void PreUpdate(int FRAME_DATA_INDEX, int FRAME_DATA_PREV_INDEX);
 	void Update(float dt, int FRAME_DATA_INDEX = 0);
 	void PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX = 0);
-	void StartLoading(const BuiltinMeshArray_t& builtinMeshes, FSceneRepresentation& scene);
+	void StartLoading(const BuiltinMeshArray_t& builtinMeshes, const FSceneRepresentation& scene);
+	bool UpdateLoading(float TimeBudgetSeconds); // returns true once the CPU stages are done, the model/texture loads are finished & the materials are assigned
+	void CancelLoading();
 	void OnLoadComplete();
+	inline bool               IsLoading() const { return mLoadContext.bLoading; }
+	inline FSceneLoadProgress GetLoadProgress() const { return mLoadProgress; }
 	void Unload(); // serial-only for now. maybe MT later.
 	void RenderUI(FUIState& UIState, uint32_t W, uint32_t H);
 	void HandleInput(FSceneView& SceneView);
@@ -251,7 +300,7 @@ private: // Derived Scenes shouldn't access these functions
 	void GatherSceneLightData(FSceneView& SceneView) const;
 
 	void PrepareLightMeshRenderParams(FSceneView& SceneView) const;
-	void PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, std::vector<FMeshRenderCommand>& MeshRenderCommands) const;
+	void PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, RenderCommandList<FMeshRenderCommand>& MeshRenderCommands) const;
 	void PrepareShadowMeshRenderParams(FSceneShadowView& ShadowView, const FFrustumPlaneset& ViewFrustumPlanesInWorldSpace, ThreadPool& UpdateWorkerThreadPool) const;
 	void PrepareBoundingBoxRenderParams(FSceneView& SceneView) const;
 	
@@ -262,12 +311,16 @@ private: // Derived Scenes shouldn't access these functions
 
 	void LoadBuiltinMaterials(TaskID taskID, const std::vector<FGameObjectRepresentation>& GameObjsToBeLoaded);
 	void LoadBuiltinMeshes(const BuiltinMeshArray_t& builtinMeshes);
-	void LoadGameObjects(std::vector<FGameObjectRepresentation>&& GameObjects); // TODO: consider using FSceneRepresentation as the parameter and read the corresponding member
-	void LoadSceneMaterials(const std::vector<FMaterialRepresentation>& Materials, TaskID taskID);
+	void LoadGameObject(FGameObjectRepresentation&& ObjRep);
 	void LoadLights(const std::vector<Light>& SceneLights);
 	void LoadCameras(std::vector<FCameraParameters>& CameraParams);
 	void LoadPostProcessSettings();
 
+	float GetLoadTime() const; // seconds since StartLoading()
+	void  BeginLoadStage(ESceneLoadStage Stage, uint NumItems);
+	void  EndLoadStage(ESceneLoadStage Stage);
+	void  LogLoadReport() const;
+
 	void CalculateGameObjectLocalSpaceBoundingBoxes();
 public:
 	Scene(VQEngine& engine
@@ -286,6 +339,7 @@ public:
 	inline const Camera& GetActiveCamera() const { return mCameras[mIndex_SelectedCamera]; }
 	inline       Camera& GetActiveCamera() { return mCameras[mIndex_SelectedCamera]; }
 	inline       size_t  GetNumSceneCameras() const { return mCameras.size(); }
+	inline const Camera& GetCamera(size_t i) const { return mCameras[i]; }
 
 	inline       int&    GetActiveCameraIndex() { return mIndex_SelectedCamera; }
 	inline       int&    GetActiveEnvironmentMapPresetIndex() { return mIndex_ActiveEnvironmentMapPreset; }
@@ -378,6 +432,17 @@ private:
 
 	AssetLoader::ModelLoadResults_t          mModelLoadResults;
 	AssetLoader::FMaterialTextureAssignments mMaterialAssignments;
+
+	struct FSceneLoadContext
+	{
+		bool                                  bLoading = false;
+		const BuiltinMeshArray_t*             pBuiltinMeshes = nullptr;
+		FSceneRepresentation                  SceneRep;
+		TaskID                                taskID = INVALID_ID;
+		std::chrono::steady_clock::time_point StartTime;
+	};
+	FSceneLoadContext  mLoadContext;
+	FSceneLoadProgress mLoadProgress;
 	
 	// cache
 	std::unordered_map<std::string, MaterialID> mLoadedMaterials;
@@ -76,27 +76,255 @@ MaterialID Scene::LoadMaterial(const FMaterialRepresentation& matRep, TaskID tas
 	return id;
 }
 
-void Scene::StartLoading(const BuiltinMeshArray_t& builtinMeshes, FSceneRepresentation& sceneRep)
+//----------------------------------------------------------------------------------------------------------------
+// STAGED LOADING
+//----------------------------------------------------------------------------------------------------------------
+const char* GetSceneLoadStageName(ESceneLoadStage Stage)
+{
+	switch (Stage)
+	{
+	case ESceneLoadStage::BUILTIN_MESHES       : return "BUILTIN_MESHES";
+	case ESceneLoadStage::SCENE_SPECIFIC       : return "SCENE_SPECIFIC";
+	case ESceneLoadStage::BUILTIN_MATERIALS    : return "BUILTIN_MATERIALS";
+	case ESceneLoadStage::SCENE_MATERIALS      : return "SCENE_MATERIALS";
+	case ESceneLoadStage::GAME_OBJECTS         : return "GAME_OBJECTS";
+	case ESceneLoadStage::LIGHTS               : return "LIGHTS";
+	case ESceneLoadStage::CAMERAS              : return "CAMERAS";
+	case ESceneLoadStage::POST_PROCESS         : return "POST_PROCESS";
+	case ESceneLoadStage::MODELS               : return "MODELS";
+	case ESceneLoadStage::TEXTURES             : return "TEXTURES";
+	case ESceneLoadStage::MATERIAL_ASSIGNMENTS : return "MATERIAL_ASSIGNMENTS";
+	case ESceneLoadStage::BOUNDING_BOXES       : return "BOUNDING_BOXES";
+	case ESceneLoadStage::INITIALIZE_SCENE     : return "INITIALIZE_SCENE";
+	default: break;
+	}
+	return "UNKNOWN";
+}
+
+float FSceneLoadProgress::GetProgress() const
+{
+	// rough share of the load time per stage: file loads dominate, the rest is mostly serial CPU work
+	constexpr float STAGE_WEIGHTS[] =
+	{
+		1.0f, // BUILTIN_MESHES
+		2.0f, // SCENE_SPECIFIC
+		2.0f, // BUILTIN_MATERIALS
+		2.0f, // SCENE_MATERIALS
+		4.0f, // GAME_OBJECTS
+		1.0f, // LIGHTS
+		1.0f, // CAMERAS
+		1.0f, // POST_PROCESS
+		40.0f, // MODELS
+		40.0f, // TEXTURES
+		4.0f, // MATERIAL_ASSIGNMENTS
+		1.0f, // BOUNDING_BOXES
+		1.0f, // INITIALIZE_SCENE
+	};
+	static_assert(_countof(STAGE_WEIGHTS) == static_cast<size_t>(ESceneLoadStage::NUM_SCENE_LOAD_STAGES), "Missing scene load stage weight");
+
+	float Progress = 0.0f;
+	float WeightSum = 0.0f;
+	for (size_t i = 0; i < Stages.size(); ++i)
+	{
+		const FSceneLoadStageStats& Stage = Stages[i];
+		const float StageProgress = Stage.EndTime >= 0.0f ? 1.0f
+			: (Stage.NumItems > 0 ? static_cast<float>(Stage.NumItemsDone) / Stage.NumItems : 0.0f);
+		Progress += STAGE_WEIGHTS[i] * StageProgress;
+		WeightSum += STAGE_WEIGHTS[i];
+	}
+	return Progress / WeightSum;
+}
+
+float Scene::GetLoadTime() const
+{
+	return std::chrono::duration<float>(std::chrono::steady_clock::now() - mLoadContext.StartTime).count();
+}
+
+void Scene::BeginLoadStage(ESceneLoadStage Stage, uint NumItems)
+{
+	FSceneLoadStageStats& Stats = mLoadProgress.Stages[static_cast<size_t>(Stage)];
+	Stats.NumItems = NumItems;
+	Stats.StartTime = GetLoadTime();
+}
+
+void Scene::EndLoadStage(ESceneLoadStage Stage)
+{
+	FSceneLoadStageStats& Stats = mLoadProgress.Stages[static_cast<size_t>(Stage)];
+	if (Stats.StartTime < 0.0f) // a stage w/o work, e.g. no textures to load
+		Stats.StartTime = GetLoadTime();
+	Stats.NumItemsDone = Stats.NumItems;
+	Stats.EndTime = GetLoadTime();
+}
+
+void Scene::LogLoadReport() const
+{
+	// one line per stage w/ a fixed prefix so the headless/CI runs can grep & track the timings
+	const float LoadTime = GetLoadTime();
+	Log::Info("[SceneLoad] scene=%s status=%s time=%.2fms", mSceneRepresentation.SceneName.c_str()
+		, mLoadProgress.bCancelled ? "CANCELLED" : "LOADED", LoadTime * 1000.0f);
+	for (size_t i = 0; i < mLoadProgress.Stages.size(); ++i)
+	{
+		const FSceneLoadStageStats& Stats = mLoadProgress.Stages[i];
+		const bool bStarted = Stats.StartTime >= 0.0f;
+		const float EndTime = Stats.EndTime >= 0.0f ? Stats.EndTime : LoadTime;
+		Log::Info("[SceneLoad]   stage=%-20s items=%u/%u bytes=%llu start=%.2fms time=%.2fms%s"
+			, GetSceneLoadStageName(static_cast<ESceneLoadStage>(i))
+			, Stats.NumItemsDone, Stats.NumItems
+			, Stats.NumBytes
+			, bStarted ? Stats.StartTime * 1000.0f : 0.0f
+			, bStarted ? (EndTime - Stats.StartTime) * 1000.0f : 0.0f
+			, !bStarted ? " (not started)" : (Stats.EndTime < 0.0f ? " (unfinished)" : "")
+		);
+	}
+}
+
+void Scene::StartLoading(const BuiltinMeshArray_t& builtinMeshes, const FSceneRepresentation& sceneRep)
 {
 	mRenderer.WaitForLoadCompletion();
 
 	Log::Info("[Scene] Loading Scene: %s", sceneRep.SceneName.c_str());
-	const TaskID taskID = AssetLoader::GenerateModelLoadTaskID();
-
 
 	mSceneRepresentation = sceneRep;
 
-	LoadBuiltinMeshes(builtinMeshes);
+	mLoadContext.bLoading = true;
+	mLoadContext.pBuiltinMeshes = &builtinMeshes;
+	mLoadContext.SceneRep = sceneRep;
+	mLoadContext.taskID = AssetLoader::GenerateModelLoadTaskID();
+	mLoadContext.StartTime = std::chrono::steady_clock::now();
+
+	mLoadProgress = {};
+	mAssetLoader.ResetLoadProgress();
+}
 
-	this->LoadScene(sceneRep); // scene-specific load 
+bool Scene::UpdateLoading(float TimeBudgetSeconds)
+{
+	if (!mLoadContext.bLoading)
+		return true;
 
-	LoadBuiltinMaterials(taskID, sceneRep.Objects);
-	LoadSceneMaterials(sceneRep.Materials, taskID);
+	const std::chrono::steady_clock::time_point SliceStart = std::chrono::steady_clock::now();
+	auto fnIsOutOfTime = [&]() { return std::chrono::duration<float>(std::chrono::steady_clock::now() - SliceStart).count() >= TimeBudgetSeconds; };
 
-	LoadGameObjects(std::move(sceneRep.Objects));
-	LoadLights(sceneRep.Lights);
-	LoadCameras(sceneRep.Cameras);
-	LoadPostProcessSettings();
+	FSceneRepresentation& sceneRep = mLoadContext.SceneRep;
+	const TaskID taskID = mLoadContext.taskID;
+
+	// CPU stages: they write into the scene containers, so they run on the calling (update) thread.
+	// At least one item is processed per call so that the load progresses even w/ a tiny budget.
+	bool bProcessedItem = false;
+	while (mLoadProgress.CurrentStage < ESceneLoadStage::MODELS && !(bProcessedItem && fnIsOutOfTime()))
+	{
+		const ESceneLoadStage Stage = mLoadProgress.CurrentStage;
+		FSceneLoadStageStats& Stats = mLoadProgress.Stages[static_cast<size_t>(Stage)];
+		if (Stats.StartTime < 0.0f)
+		{
+			uint NumItems = 1;
+			if (Stage == ESceneLoadStage::SCENE_MATERIALS) NumItems = static_cast<uint>(sceneRep.Materials.size());
+			if (Stage == ESceneLoadStage::GAME_OBJECTS   ) NumItems = static_cast<uint>(sceneRep.Objects.size());
+			BeginLoadStage(Stage, NumItems);
+		}
+
+		if (Stats.NumItemsDone < Stats.NumItems)
+		{
+			const uint iItem = Stats.NumItemsDone;
+			switch (Stage)
+			{
+			case ESceneLoadStage::BUILTIN_MESHES   : LoadBuiltinMeshes(*mLoadContext.pBuiltinMeshes); break;
+			case ESceneLoadStage::SCENE_SPECIFIC   : this->LoadScene(sceneRep); break; // scene-specific load
+			case ESceneLoadStage::BUILTIN_MATERIALS: LoadBuiltinMaterials(taskID, sceneRep.Objects); break;
+			case ESceneLoadStage::SCENE_MATERIALS  : LoadMaterial(sceneRep.Materials[iItem], taskID); break;
+			case ESceneLoadStage::GAME_OBJECTS     : LoadGameObject(std::move(sceneRep.Objects[iItem])); break;
+			case ESceneLoadStage::LIGHTS           : LoadLights(sceneRep.Lights); break;
+			case ESceneLoadStage::CAMERAS          : LoadCameras(sceneRep.Cameras); break;
+			case ESceneLoadStage::POST_PROCESS     : LoadPostProcessSettings(); break;
+			default: assert(false); break;
+			}
+			++Stats.NumItemsDone;
+			bProcessedItem = true;
+		}
+		if (Stats.NumItemsDone < Stats.NumItems)
+			continue;
+
+		// stage done, kick off the background work it enables
+		EndLoadStage(Stage);
+		if (Stage == ESceneLoadStage::SCENE_MATERIALS)
+		{
+			if (Stats.NumItems > 0)
+				Log::Info("[Scene] Materials Created (%u)", Stats.NumItems);
+
+			// kickoff background workers for texture loading
+			if (!mMaterialAssignments.mAssignments.empty())
+			{
+				BeginLoadStage(ESceneLoadStage::TEXTURES, 0);
+				mMaterialAssignments.mTextureLoadResults = mAssetLoader.StartLoadingTextures(taskID);
+				Log::Info("[Scene] Start loading textures... (%u)", mMaterialAssignments.mTextureLoadResults.size());
+			}
+		}
+		if (Stage == ESceneLoadStage::GAME_OBJECTS)
+		{
+			// kickoff workers for loading models
+			BeginLoadStage(ESceneLoadStage::MODELS, 0);
+			mModelLoadResults = mAssetLoader.StartLoadingModels(this);
+			Log::Info("[Scene] Start loading models...");
+		}
+		mLoadProgress.CurrentStage = static_cast<ESceneLoadStage>(static_cast<int>(Stage) + 1);
+	}
+	if (mLoadProgress.CurrentStage < ESceneLoadStage::MODELS)
+		return false;
+
+	// worker stages: poll the asset loader. Models queue their own textures while importing,
+	// so the texture loads are only done once the models are.
+	const AssetLoader::FLoadProgress& AssetLoadProgress = mAssetLoader.GetLoadProgress();
+	FSceneLoadStageStats& Models   = mLoadProgress.Stages[static_cast<size_t>(ESceneLoadStage::MODELS)];
+	FSceneLoadStageStats& Textures = mLoadProgress.Stages[static_cast<size_t>(ESceneLoadStage::TEXTURES)];
+	
+	Models.NumItemsDone = AssetLoadProgress.NumModelsLoaded;
+	Models.NumItems     = AssetLoadProgress.NumModels;
+	Models.NumBytes     = AssetLoadProgress.ModelBytes;
+	Textures.NumItemsDone = AssetLoadProgress.NumTexturesLoaded;
+	Textures.NumItems     = AssetLoadProgress.NumTextures;
+	Textures.NumBytes     = AssetLoadProgress.TextureBytes;
+	if (Textures.StartTime < 0.0f && Textures.NumItems > 0)
+		Textures.StartTime = GetLoadTime();
+
+	const bool bModelsLoaded = Models.NumItemsDone == Models.NumItems;
+	if (bModelsLoaded && Models.EndTime < 0.0f)
+	{
+		EndLoadStage(ESceneLoadStage::MODELS);
+		mLoadProgress.CurrentStage = ESceneLoadStage::TEXTURES;
+	}
+	const bool bTexturesLoaded = bModelsLoaded && Textures.NumItemsDone == Textures.NumItems;
+	if (bTexturesLoaded && Textures.EndTime < 0.0f)
+	{
+		EndLoadStage(ESceneLoadStage::TEXTURES);
+		mLoadProgress.CurrentStage = ESceneLoadStage::MATERIAL_ASSIGNMENTS;
+
+		// the materials are assigned their textures as the uploads complete, the models' materials are already registered
+		BeginLoadStage(ESceneLoadStage::MATERIAL_ASSIGNMENTS, 0);
+		mMaterialAssignments.DoAssignments(this, &mRenderer, &mAssetLoader);
+	}
+	if (!bTexturesLoaded)
+		return false;
+
+	FSceneLoadStageStats& Assignments = mLoadProgress.Stages[static_cast<size_t>(ESceneLoadStage::MATERIAL_ASSIGNMENTS)];
+	Assignments.NumItemsDone = AssetLoadProgress.NumMaterialsAssigned;
+	Assignments.NumItems     = AssetLoadProgress.NumMaterials;
+	const bool bMaterialsAssigned = Assignments.NumItemsDone == Assignments.NumItems;
+	if (bMaterialsAssigned && Assignments.EndTime < 0.0f)
+		EndLoadStage(ESceneLoadStage::MATERIAL_ASSIGNMENTS);
+	return bMaterialsAssigned;
+}
+
+void Scene::CancelLoading()
+{
+	if (!mLoadContext.bLoading)
+		return;
+
+	// the caller waits for the in-flight loads to drain before unloading the scene
+	mAssetLoader.CancelLoads();
+	mLoadProgress.bCancelled = true;
+	mLoadContext.bLoading = false;
+
+	Log::Warning("[Scene] Loading cancelled: %s (stage=%s)", mSceneRepresentation.SceneName.c_str(), GetSceneLoadStageName(mLoadProgress.CurrentStage));
+	LogLoadReport();
 }
 
 void Scene::LoadBuiltinMaterials(TaskID taskID, const std::vector<FGameObjectRepresentation>& GameObjsToBeLoaded)
@@ -162,94 +390,55 @@ void Scene::LoadBuiltinMeshes(const BuiltinMeshArray_t& builtinMeshes)
 	}
 }
 
-void Scene::LoadGameObjects(std::vector<FGameObjectRepresentation>&& GameObjects)
+void Scene::LoadGameObject(FGameObjectRepresentation&& ObjRep)
 {
-	constexpr bool B_LOAD_GAMEOBJECTS_SERIAL = true;
+	// GameObject
+	GameObject* pObj = mGameObjectPool.Allocate(1);
+	pObj->mModelID = INVALID_ID;
+	pObj->mTransformID = INVALID_ID;
 
-	if constexpr (B_LOAD_GAMEOBJECTS_SERIAL)
-	{
-		for (FGameObjectRepresentation& ObjRep : GameObjects)
-		{
-			// GameObject
-			GameObject* pObj = mGameObjectPool.Allocate(1);
-			pObj->mModelID = INVALID_ID;
-			pObj->mTransformID = INVALID_ID;
+	// Transform
+	Transform* pTransform = mTransformPool.Allocate(1);
+	*pTransform = std::move(ObjRep.tf);
+	mpTransforms.push_back(pTransform);
 
-			// Transform
-			Transform* pTransform = mTransformPool.Allocate(1);
-			*pTransform = std::move(ObjRep.tf);
-			mpTransforms.push_back(pTransform);
+	TransformID tID = static_cast<TransformID>(mpTransforms.size() - 1);
+	pObj->mTransformID = tID;
 
-			TransformID tID = static_cast<TransformID>(mpTransforms.size() - 1);
-			pObj->mTransformID = tID;
+	// Model
+	const bool bModelIsBuiltinMesh = !ObjRep.BuiltinMeshName.empty();
+	const bool bModelIsLoadedFromFile = !ObjRep.ModelFilePath.empty();
+	assert(bModelIsBuiltinMesh != bModelIsLoadedFromFile);
 
-			// Model
-			const bool bModelIsBuiltinMesh = !ObjRep.BuiltinMeshName.empty();
-			const bool bModelIsLoadedFromFile = !ObjRep.ModelFilePath.empty();
-			assert(bModelIsBuiltinMesh != bModelIsLoadedFromFile);
-
-			if (bModelIsBuiltinMesh)
-			{
-				ModelID mID = this->CreateModel();
-				Model& model = mModels.at(mID);
-
-				// create/get mesh
-				MeshID meshID = mEngine.GetBuiltInMeshID(ObjRep.BuiltinMeshName);
-				model.mData.mOpaueMeshIDs.push_back(meshID);
-
-				// material
-				MaterialID matID = this->mDefaultMaterialID;
-				if (!ObjRep.MaterialName.empty())
-				{
-					matID = this->CreateMaterial(ObjRep.MaterialName);
-				}
-				Material& mat = this->GetMaterial(matID);
-				const bool bTransparentMesh = mat.IsTransparent();
-				model.mData.mOpaqueMaterials[meshID] = matID; // todo: handle transparency
-
-				model.mbLoaded = true;
-				pObj->mModelID = mID;
-			}
-			else
-			{
-				mAssetLoader.QueueModelLoad(pObj, ObjRep.ModelFilePath, ObjRep.ModelName);
-			}
-
-
-			mpObjects.push_back(pObj);
-		}
-	}
-	else // THREADED LOAD
+	if (bModelIsBuiltinMesh)
 	{
-		// dispatch workers
-		assert(false); // TODO: profile first
-	}
+		ModelID mID = this->CreateModel();
+		Model& model = mModels.at(mID);
 
-	// kickoff workers for loading models
-	mModelLoadResults = mAssetLoader.StartLoadingModels(this);
-	Log::Info("[Scene] Start loading models...");
+		// create/get mesh
+		MeshID meshID = mEngine.GetBuiltInMeshID(ObjRep.BuiltinMeshName);
+		model.mData.mOpaueMeshIDs.push_back(meshID);
 
-}
+		// material
+		MaterialID matID = this->mDefaultMaterialID;
+		if (!ObjRep.MaterialName.empty())
+		{
+			matID = this->CreateMaterial(ObjRep.MaterialName);
+		}
+		Material& mat = this->GetMaterial(matID);
+		const bool bTransparentMesh = mat.IsTransparent();
+		model.mData.mOpaqueMaterials[meshID] = matID; // todo: handle transparency
 
-void Scene::LoadSceneMaterials(const std::vector<FMaterialRepresentation>& Materials, TaskID taskID)
-{
-	// Create scene materials before deserializing gameobjects
-	uint NumMaterials = 0;
-	for (const FMaterialRepresentation& matRep : Materials)
+		model.mbLoaded = true;
+		pObj->mModelID = mID;
+	}
+	else
 	{
-		this->LoadMaterial(matRep, taskID);
-		++NumMaterials;
+		mAssetLoader.QueueModelLoad(pObj, ObjRep.ModelFilePath, ObjRep.ModelName);
 	}
 
-	if (NumMaterials > 0)
-		Log::Info("[Scene] Materials Created (%u)", NumMaterials);
 
-	// kickoff background workers for texture loading
-	if (!mMaterialAssignments.mAssignments.empty())
-	{
-		mMaterialAssignments.mTextureLoadResults = mAssetLoader.StartLoadingTextures(taskID);
-		Log::Info("[Scene] Start loading textures... (%u)", mMaterialAssignments.mTextureLoadResults.size());
-	}
+	mpObjects.push_back(pObj);
 }
 
 void Scene::LoadLights(const std::vector<Light>& SceneLights)
@@ -344,15 +533,23 @@ void Scene::OnLoadComplete()
 		pObj->mModelID = res.get();
 	}
 
-	// assign material data
-	mMaterialAssignments.DoAssignments(this, &mRenderer);
-
 	// calculate local-space game object AABBs
+	mLoadProgress.CurrentStage = ESceneLoadStage::BOUNDING_BOXES;
+	BeginLoadStage(ESceneLoadStage::BOUNDING_BOXES, static_cast<uint>(mpObjects.size()));
 	CalculateGameObjectLocalSpaceBoundingBoxes();
+	EndLoadStage(ESceneLoadStage::BOUNDING_BOXES);
 
 	Log::Info("[Scene] %s loaded.", mSceneRepresentation.SceneName.c_str());
 	mSceneRepresentation.loadSuccess = 1;
+
+	mLoadProgress.CurrentStage = ESceneLoadStage::INITIALIZE_SCENE;
+	BeginLoadStage(ESceneLoadStage::INITIALIZE_SCENE, 1);
 	this->InitializeScene();
+	EndLoadStage(ESceneLoadStage::INITIALIZE_SCENE);
+
+	mLoadContext.bLoading = false;
+	mLoadContext.SceneRep = {};
+	LogLoadReport();
 }
 
 void Scene::Unload()
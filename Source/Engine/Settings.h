@@ -37,6 +37,10 @@ struct FGraphicsSettings
 
 	float RenderScale = 1.0f;
 	int   MaxFrameRate = -1; // -1: Auto (RefreshRate x 1.15) | 0: Unlimited | <int>: specified value
+	float FrameLimiterSpinThresholdMs = 1.0f; // the frame limiter sleeps until this long before the frame deadline, and spins the rest
+
+	bool bTextureStreaming       = true;
+	int  TextureStreamingBudgetMB = 1024; // streamed material textures, mip tails included
 };
 
 struct FWindowSettings
@@ -62,6 +66,17 @@ struct FEngineSettings
 
 	bool bAutomatedTestRun     = false;
 	int NumAutomatedTestFrames = -1;
+
+	bool bBenchmarkRun = false; // flies through BenchmarkLevels on camera paths w/ a fixed timestep, writes the timing reports & quits
+	std::string BenchmarkLevels;  // comma separated level names, empty: all the levels in Data/Scenes.ini
+	int NumBenchmarkWarmupFrames = 120; // per level, not recorded
+	int NumBenchmarkFrames = 1000;      // per level
+	std::string BenchmarkReportPath;    // w/o extension, .json & .csv are written
+	std::string MemoryReportPath;       // per-tag CPU memory stats written on exit, empty: no report
 	
 	std::string StartupScene;
+	int UpdateRenderFrameLatency = 1; // VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS: # frames [1-3] the update thread can run ahead of the render thread
+
+	bool bBuildPakFile     = false; // packs Data/ into Data.pak on startup
+	bool bHotReloadShaders = false; // watches the shader source files & recompiles the PSOs depending on the changed ones
 };
\ No newline at end of file
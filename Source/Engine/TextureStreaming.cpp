@@ -0,0 +1,405 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "TextureStreaming.h"
+#include "AssetLoader.h"
+#include "Scene/Scene.h"
+#include "Scene/Material.h"
+#include "Core/AsyncIO.h"
+#include "GPUMarker.h"
+
+#include "../Renderer/Renderer.h"
+#include "../Renderer/TextureCache.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+using namespace DirectX;
+
+//----------------------------------------------------------------------------------------------------------------
+// TEXTURE STREAMER
+//----------------------------------------------------------------------------------------------------------------
+static constexpr uint MIP_TAIL_SIZE = 128;          // textures are created w/ the mips of this size & smaller
+static constexpr uint MAX_STREAMING_REQUESTS = 16;  // textures being streamed at the same time
+
+template<class TMaterial> static auto GetMaterialTextures(TMaterial& mat) -> std::array<decltype(&mat.TexDiffuseMap), 9>
+{
+	return { &mat.TexDiffuseMap, &mat.TexNormalMap, &mat.TexEmissiveMap, &mat.TexHeightMap, &mat.TexAlphaMaskMap
+		, &mat.TexMetallicMap, &mat.TexRoughnessMap, &mat.TexOcclusionRoughnessMetalnessMap, &mat.TexAmbientOcclusionMap };
+}
+
+TextureStreamer::TextureStreamer(VQRenderer& Renderer, AsyncIOService& AsyncIO, ThreadPool& Workers)
+	: mRenderer(Renderer)
+	, mAsyncIO(AsyncIO)
+	, mWorkers(Workers)
+{}
+
+void TextureStreamer::Initialize(bool bEnabled, uint BudgetMB)
+{
+	mbEnabled = bEnabled;
+	mBudgetBytes = uint64(BudgetMB) << 20;
+	Log::Info("TextureStreamer: %s, budget=%uMB", bEnabled ? "enabled" : "disabled", BudgetMB);
+}
+
+void TextureStreamer::Reset()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	++mGeneration; // results of the requests in flight are released as they come in
+	mTextures.clear();
+	mStreamedTextures.clear();
+	mLookup_TextureIndex.clear();
+	mMaterials.clear();
+	mLookup_MaterialIndex.clear();
+	mMaterialTextureRefs.clear();
+	mNumStreamingRequests = 0;
+	mTargetBytes = 0;
+}
+
+FTextureStreamingStats TextureStreamer::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	FTextureStreamingStats Stats;
+	Stats.NumStreamedTextures = static_cast<uint>(mTextures.size());
+	Stats.NumStreamingRequests = mNumStreamingRequests;
+	Stats.TargetBytes = mTargetBytes;
+	Stats.BudgetBytes = mBudgetBytes;
+	for (const TextureStreaming::FTexture& Texture : mTextures)
+		Stats.ResidentBytes += Texture.GetSize(Texture.ResidentMip);
+	return Stats;
+}
+
+FTextureResidencyHandle TextureStreamer::CreateTexture(const std::string& TexName, const std::string& CachedTexturePath, const std::shared_ptr<FCookedTexture>& pCookedTexture)
+{
+	const FCookedTexture& Cooked = *pCookedTexture;
+
+	// the mip tail starts at the first mip that fits MIP_TAIL_SIZE, block compressed
+	// textures need the top mip to be multiple of 4 texels so it can stop earlier.
+	uint MinResidentMip = 0;
+	auto fnCanBeTopMip = [&](uint mip) { return ((Cooked.Width >> mip) % 4) == 0 && ((Cooked.Height >> mip) % 4) == 0; };
+	while (MinResidentMip + 1 < Cooked.MipCount
+		&& std::max(Cooked.Width >> MinResidentMip, Cooked.Height >> MinResidentMip) > MIP_TAIL_SIZE
+		&& fnCanBeTopMip(MinResidentMip + 1))
+	{
+		++MinResidentMip;
+	}
+
+	const bool bStreamed = mbEnabled && MinResidentMip > 0 && Cooked.ArraySize == 1 && Cooked.MipCount <= TextureStreaming::MAX_MIP_COUNT;
+	if (!bStreamed)
+		return mRenderer.CreateTextureAsync(TexName, pCookedTexture);
+
+	FStreamedTexture StreamedTexture;
+	StreamedTexture.Name = TexName;
+	StreamedTexture.CachedTexturePath = CachedTexturePath;
+	StreamedTexture.pMipTail = std::make_shared<FCookedTexture>(TextureCache::CopyMipChain(Cooked, MinResidentMip));
+
+	TextureStreaming::FTexture Texture;
+	Texture.Width = Cooked.Width;
+	Texture.Height = Cooked.Height;
+	Texture.MipCount = Cooked.MipCount;
+	Texture.MinResidentMip = MinResidentMip;
+	for (uint mip = 0; mip < Cooked.MipCount; ++mip)
+		Texture.MipSizes[mip] = TextureCache::GetMipSize(Cooked, mip);
+	Texture.ResidentMip = Texture.DesiredMip = Texture.TargetMip = MinResidentMip;
+
+	const FTextureResidencyHandle Handle = mRenderer.CreateTextureAsync(TexName, StreamedTexture.pMipTail);
+	StreamedTexture.ID = Handle.ID;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mLookup_TextureIndex[Handle.ID] = static_cast<uint>(mTextures.size());
+		mTextures.push_back(Texture);
+		mStreamedTextures.push_back(std::move(StreamedTexture));
+	}
+	return Handle;
+}
+
+void TextureStreamer::RegisterMaterial(const Material& mat, uint OcclRoughMtlMapComponentMapping)
+{
+	if (!mbEnabled)
+		return;
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	std::vector<uint> TextureIndices;
+	for (const TextureID* pTexID : GetMaterialTextures(mat))
+	{
+		auto it = mLookup_TextureIndex.find(*pTexID);
+		if (it != mLookup_TextureIndex.end() && std::find(TextureIndices.begin(), TextureIndices.end(), it->second) == TextureIndices.end())
+			TextureIndices.push_back(it->second);
+	}
+	if (TextureIndices.empty() || mLookup_MaterialIndex.find(mat.ID) != mLookup_MaterialIndex.end())
+		return;
+
+	const uint MaterialIndex = static_cast<uint>(mMaterials.size());
+	FStreamedMaterial StreamedMaterial;
+	StreamedMaterial.ID = mat.ID;
+	StreamedMaterial.OcclRoughMtlMapComponentMapping = OcclRoughMtlMapComponentMapping;
+	StreamedMaterial.SRVMaterialMaps[0] = mat.SRVMaterialMaps;
+	StreamedMaterial.UVScale = std::max(mat.tiling.x, mat.tiling.y);
+	mMaterials.push_back(StreamedMaterial);
+	mLookup_MaterialIndex[mat.ID] = MaterialIndex;
+
+	for (uint TextureIndex : TextureIndices)
+	{
+		mMaterialTextureRefs.push_back({ MaterialIndex, TextureIndex });
+		mStreamedTextures[TextureIndex].Materials.push_back(MaterialIndex);
+	}
+}
+
+void TextureStreamer::Update(Scene& scene, const FSceneView& SceneView, uint NumFramesInFlight)
+{
+	std::vector<FAsyncReadDesc> Reads;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		++mFrameIndex;
+		// the update thread runs ahead of the render thread, which has the back buffer count of frames on the GPU
+		mReleaseDelay = NumFramesInFlight * 2 + 1;
+
+		CommitStreamedTextures(scene);
+		ReleaseTextures();
+		if (mTextures.empty())
+			return;
+
+		TextureStreaming::FView View;
+		XMFLOAT4X4 proj;
+		XMStoreFloat4x4(&proj, SceneView.proj);
+		XMStoreFloat3(&View.CameraPosition, SceneView.cameraPosition);
+		View.ProjectionScaleY = proj._22;
+		View.ViewportHeight = static_cast<float>(SceneView.SceneRTHeight);
+
+		// world space bounding spheres of the culled meshes
+		mVisibleMeshes.clear();
+		for (const FMeshRenderCommand& cmd : SceneView.meshRenderCommands)
+		{
+			auto itMaterial = mLookup_MaterialIndex.find(cmd.matID);
+			auto itMesh = scene.mMeshes.find(cmd.meshID);
+			if (itMaterial == mLookup_MaterialIndex.end() || itMesh == scene.mMeshes.end())
+				continue;
+
+			const FBoundingBox BB = itMesh->second.GetLocalSpaceBoundingBox();
+			const XMVECTOR vMin = XMLoadFloat3(&BB.ExtentMin);
+			const XMVECTOR vMax = XMLoadFloat3(&BB.ExtentMax);
+			const float MaxScale = std::max({
+				  XMVectorGetX(XMVector3Length(cmd.matWorldTransformation.r[0]))
+				, XMVectorGetX(XMVector3Length(cmd.matWorldTransformation.r[1]))
+				, XMVectorGetX(XMVector3Length(cmd.matWorldTransformation.r[2]))
+			});
+
+			TextureStreaming::FVisibleMesh Mesh;
+			Mesh.MaterialIndex = itMaterial->second;
+			XMStoreFloat3(&Mesh.Center, XMVector3Transform((vMin + vMax) * 0.5f, cmd.matWorldTransformation));
+			Mesh.Radius = XMVectorGetX(XMVector3Length((vMax - vMin) * 0.5f)) * MaxScale;
+			Mesh.UVScale = mMaterials[itMaterial->second].UVScale;
+			mVisibleMeshes.push_back(Mesh);
+		}
+
+		TextureStreaming::ComputeMaterialScreenSizes(View, mVisibleMeshes, static_cast<uint>(mMaterials.size()), mMaterialScreenSizes);
+		TextureStreaming::UpdateTexturePriorities(mTextures, mMaterialTextureRefs, mMaterialScreenSizes, mFrameIndex);
+		mTargetBytes = TextureStreaming::AllocateBudget(mTextures, mBudgetBytes, mFrameIndex);
+
+		// stream out first to make room, then stream in the textures that are the largest on screen
+		mStreamingCandidates.clear();
+		for (uint i = 0; i < mTextures.size(); ++i)
+		{
+			if (!mStreamedTextures[i].bStreaming && mTextures[i].TargetMip != mTextures[i].ResidentMip)
+				mStreamingCandidates.push_back(i);
+		}
+		std::sort(mStreamingCandidates.begin(), mStreamingCandidates.end(), [&](uint l, uint r)
+		{
+			const bool bEvictL = mTextures[l].TargetMip > mTextures[l].ResidentMip;
+			const bool bEvictR = mTextures[r].TargetMip > mTextures[r].ResidentMip;
+			return bEvictL != bEvictR ? bEvictL : mTextures[l].ScreenSize > mTextures[r].ScreenSize;
+		});
+		for (uint i : mStreamingCandidates)
+		{
+			if (mNumStreamingRequests >= MAX_STREAMING_REQUESTS)
+				break;
+			StreamTexture(i, mTextures[i].TargetMip, Reads);
+		}
+	}
+
+	// issued outside the lock: reads can complete on this thread
+	if (!Reads.empty())
+		mAsyncIO.ReadBatch(std::move(Reads));
+}
+
+void TextureStreamer::StreamTexture(uint TextureIndex, uint TopMip, std::vector<FAsyncReadDesc>& Reads)
+{
+	FStreamedTexture& StreamedTexture = mStreamedTextures[TextureIndex];
+	const TextureStreaming::FTexture& Texture = mTextures[TextureIndex];
+	StreamedTexture.bStreaming = true;
+	StreamedTexture.StreamingMip = TopMip;
+	StreamedTexture.StreamedTexture = {};
+	++mNumStreamingRequests;
+
+	// evicting down to the mip tail doesn't need any I/O
+	if (TopMip == Texture.MinResidentMip)
+	{
+		mStreamingResults.push_back({ TextureIndex, mGeneration, mRenderer.CreateTextureAsync(StreamedTexture.Name, StreamedTexture.pMipTail) });
+		return;
+	}
+
+	// read the cached texture again and upload [TopMip, MipCount) straight from the read buffer
+	const uint64      Generation = mGeneration;
+	const std::string Name = StreamedTexture.Name;
+	const std::string CachedTexturePath = StreamedTexture.CachedTexturePath;
+	const uint        Width = Texture.Width;
+	const uint        Height = Texture.Height;
+	const uint        MipCount = Texture.MipCount;
+	auto fnStreamTexture = [=](const FAsyncReadResult& CachedFile)
+	{
+		SCOPED_CPU_MARKER("StreamWorker_Texture");
+		FTextureResidencyHandle Handle;
+		std::shared_ptr<FCookedTexture> pCookedTexture = std::make_shared<FCookedTexture>();
+		const bool bLoaded = CachedFile.Data.IsValid()
+			&& TextureCache::LoadCookedTexture(CachedFile.Data.pData, CachedFile.Data.Size, CachedFile.Data.pOwner, CachedTexturePath, *pCookedTexture)
+			&& pCookedTexture->Width == Width && pCookedTexture->Height == Height && pCookedTexture->MipCount == MipCount;
+		if (bLoaded)
+			Handle = mRenderer.CreateTextureAsync(Name, TextureCache::GetMipChain(pCookedTexture, TopMip));
+		else
+			Log::Warning("TextureStreamer: couldn't stream %s", CachedTexturePath.c_str());
+		OnTextureStreamed(TextureIndex, Generation, Handle);
+	};
+
+	FAsyncReadDesc Read;
+	Read.FilePath = CachedTexturePath;
+	Read.Priority = EAsyncIOPriority::LOW; // don't hold back the level loads
+	Read.Callback = [this, TextureIndex, Generation, fnStreamTexture](FAsyncReadResult&& CachedFile)
+	{
+		if (CachedFile.bCancelled || mWorkers.IsExiting())
+		{
+			OnTextureStreamed(TextureIndex, Generation, {});
+			return;
+		}
+		mWorkers.AddTask([fnStreamTexture, CachedFile = std::move(CachedFile)]() { fnStreamTexture(CachedFile); });
+	};
+	Reads.push_back(std::move(Read));
+}
+
+void TextureStreamer::OnTextureStreamed(uint TextureIndex, uint64 Generation, const FTextureResidencyHandle& Texture)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mStreamingResults.push_back({ TextureIndex, Generation, Texture });
+}
+
+void TextureStreamer::CommitStreamedTextures(Scene& scene)
+{
+	for (const FStreamingResult& Result : mStreamingResults)
+	{
+		if (Result.Generation != mGeneration)
+		{
+			if (Result.Texture.ID != INVALID_ID)
+				mPendingReleases.push_back({ mFrameIndex, Result.Texture });
+			continue;
+		}
+
+		FStreamedTexture& StreamedTexture = mStreamedTextures[Result.TextureIndex];
+		StreamedTexture.StreamedTexture = Result.Texture;
+		if (Result.Texture.ID == INVALID_ID)
+		{
+			// keep what's resident from now on
+			mTextures[Result.TextureIndex].MinResidentMip = mTextures[Result.TextureIndex].ResidentMip;
+			StreamedTexture.bStreaming = false;
+			--mNumStreamingRequests;
+		}
+	}
+	mStreamingResults.clear();
+
+	// A material's inactive SRV table may still be used by the frames in flight for mReleaseDelay frames after the swap.
+	// Textures are committed once all their materials can swap tables, the rest waits for the next frames.
+	auto fnCanSwapSRVs = [&](uint MaterialIndex) { return mFrameIndex >= mMaterials[MaterialIndex].LastSwapFrame + mReleaseDelay; };
+	mChangedMaterials.clear();
+	for (uint i = 0; i < mStreamedTextures.size(); ++i)
+	{
+		FStreamedTexture& StreamedTexture = mStreamedTextures[i];
+		if (!StreamedTexture.bStreaming || StreamedTexture.StreamedTexture.ID == INVALID_ID || !StreamedTexture.StreamedTexture.IsUploadDone())
+			continue;
+		if (StreamedTexture.StreamedTexture.IsUploadFailed())
+		{
+			// same as a failed read: keep what's resident from now on
+			mPendingReleases.push_back({ mFrameIndex, StreamedTexture.StreamedTexture });
+			mTextures[i].MinResidentMip = mTextures[i].ResidentMip;
+			StreamedTexture.StreamedTexture = {};
+			StreamedTexture.bStreaming = false;
+			--mNumStreamingRequests;
+			continue;
+		}
+		if (!std::all_of(StreamedTexture.Materials.begin(), StreamedTexture.Materials.end(), fnCanSwapSRVs))
+			continue;
+
+		const TextureID OldTexture = StreamedTexture.ID;
+		const TextureID NewTexture = StreamedTexture.StreamedTexture.ID;
+		for (uint MaterialIndex : StreamedTexture.Materials)
+		{
+			FStreamedMaterial& StreamedMaterial = mMaterials[MaterialIndex];
+			for (TextureID* pTexID : GetMaterialTextures(scene.GetMaterial(StreamedMaterial.ID)))
+			{
+				if (*pTexID == OldTexture)
+					*pTexID = NewTexture;
+			}
+			if (!StreamedMaterial.bTexturesChanged)
+			{
+				StreamedMaterial.bTexturesChanged = true;
+				mChangedMaterials.push_back(MaterialIndex);
+			}
+		}
+
+		mPendingReleases.push_back({ mFrameIndex + mReleaseDelay, { OldTexture, {} } });
+		mLookup_TextureIndex.erase(OldTexture);
+		mLookup_TextureIndex[NewTexture] = i;
+		StreamedTexture.ID = NewTexture;
+		StreamedTexture.StreamedTexture = {};
+		StreamedTexture.bStreaming = false;
+		mTextures[i].ResidentMip = StreamedTexture.StreamingMip;
+		--mNumStreamingRequests;
+	}
+
+	// write the new textures into the inactive SRV tables and swap
+	for (uint MaterialIndex : mChangedMaterials)
+	{
+		FStreamedMaterial& StreamedMaterial = mMaterials[MaterialIndex];
+		Material& mat = scene.GetMaterial(StreamedMaterial.ID);
+		const uint InactiveSRV = StreamedMaterial.ActiveSRV ^ 1;
+		if (StreamedMaterial.SRVMaterialMaps[InactiveSRV] == INVALID_ID)
+			StreamedMaterial.SRVMaterialMaps[InactiveSRV] = mRenderer.CreateSRV(NUM_MATERIAL_TEXTURE_MAP_BINDINGS);
+
+		AssetLoader::InitializeMaterialSRVs(&mRenderer, mat, StreamedMaterial.SRVMaterialMaps[InactiveSRV], StreamedMaterial.OcclRoughMtlMapComponentMapping);
+		mat.SRVMaterialMaps = StreamedMaterial.SRVMaterialMaps[InactiveSRV];
+		StreamedMaterial.ActiveSRV = InactiveSRV;
+		StreamedMaterial.LastSwapFrame = mFrameIndex;
+		StreamedMaterial.bTexturesChanged = false;
+	}
+}
+
+void TextureStreamer::ReleaseTextures()
+{
+	for (size_t i = 0; i < mPendingReleases.size();)
+	{
+		FPendingRelease& Release = mPendingReleases[i];
+		if (mFrameIndex < Release.Frame || !Release.Texture.IsUploadDone()) // don't pull the texture from under the upload thread
+		{
+			++i;
+			continue;
+		}
+		mRenderer.DestroyTexture(Release.Texture.ID);
+		Release = std::move(mPendingReleases.back());
+		mPendingReleases.pop_back();
+	}
+}
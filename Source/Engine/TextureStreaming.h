@@ -0,0 +1,204 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Core/Types.h"
+#include "../Renderer/Texture.h"
+
+#include <DirectXMath.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class VQRenderer;
+class AsyncIOService;
+class ThreadPool;
+class Scene;
+struct Material;
+struct FSceneView;
+struct FCookedTexture;
+struct FAsyncReadDesc;
+
+//----------------------------------------------------------------------------------------------------------------
+// TEXTURE STREAMING POLICY
+//----------------------------------------------------------------------------------------------------------------
+// CPU side of the mip streaming: which mips each texture needs given the visible meshes,
+// and which of those fit in the memory budget. No GPU/file access (TextureStreamingPolicy.cpp), tested in VQETests.
+namespace TextureStreaming
+{
+	constexpr uint MAX_MIP_COUNT = 16;
+
+	struct FTexture
+	{
+		uint   Width = 0;
+		uint   Height = 0;
+		uint   MipCount = 0;
+		uint   MinResidentMip = 0;              // mips [MinResidentMip, MipCount) are always resident
+		uint64 MipSizes[MAX_MIP_COUNT] = {};    // in bytes
+
+		uint   ResidentMip = 0;                 // top mip on the GPU
+		uint   DesiredMip = 0;                  // top mip the visible meshes need, set by UpdateTexturePriorities()
+		uint   TargetMip = 0;                   // top mip that fits the budget, set by AllocateBudget()
+		float  ScreenSize = 0.0f;               // texels needed along the largest dimension, 0 if not visible
+		uint64 LastVisibleFrame = 0;
+
+		uint64 GetSize(uint TopMip) const;      // bytes of the mips [TopMip, MipCount)
+	};
+
+	struct FMaterialTextureRef
+	{
+		uint MaterialIndex = 0;
+		uint TextureIndex = 0;
+	};
+
+	struct FVisibleMesh
+	{
+		uint              MaterialIndex = 0;
+		DirectX::XMFLOAT3 Center;          // world space bounding sphere
+		float             Radius = 0.0f;
+		float             UVScale = 1.0f;  // material tiling: the texture repeats UVScale times across the mesh
+	};
+
+	struct FView
+	{
+		DirectX::XMFLOAT3 CameraPosition;
+		float             ProjectionScaleY = 1.0f; // proj._22 = 1/tan(FovY/2)
+		float             ViewportHeight = 0.0f;
+	};
+
+	float GetProjectedScreenSize(const FView& View, const DirectX::XMFLOAT3& Center, float Radius); // diameter in pixels
+	uint  GetDesiredMip(const FTexture& Texture, float ScreenSize);
+
+	// OutMaterialScreenSizes[MaterialIndex]: largest projected size * UVScale of the meshes using the material, 0 if none is visible
+	void   ComputeMaterialScreenSizes(const FView& View, const std::vector<FVisibleMesh>& VisibleMeshes, uint NumMaterials, std::vector<float>& OutMaterialScreenSizes);
+	// sets ScreenSize & DesiredMip of the textures, LastVisibleFrame of the visible ones
+	void   UpdateTexturePriorities(std::vector<FTexture>& Textures, const std::vector<FMaterialTextureRef>& MaterialTextureRefs, const std::vector<float>& MaterialScreenSizes, uint64 FrameIndex);
+	// Sets TargetMip of the textures and returns the total size of the targets:
+	//  - visible textures keep their resident mips and stream in up to DesiredMip, the others keep what they have
+	//  - over budget, the least recently visible textures are evicted down to their mip tails (LRU)
+	//  - if that's not enough, the visible textures drop mips, the most oversampled ones first
+	uint64 AllocateBudget(std::vector<FTexture>& Textures, uint64 BudgetBytes, uint64 FrameIndex);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// TEXTURE STREAMER
+//----------------------------------------------------------------------------------------------------------------
+struct FTextureStreamingStats
+{
+	uint   NumStreamedTextures = 0;
+	uint   NumStreamingRequests = 0; // in flight
+	uint64 ResidentBytes = 0;
+	uint64 TargetBytes = 0;
+	uint64 BudgetBytes = 0;
+};
+
+// Streams the mips of the cooked material textures: the textures are created with their mip tails only,
+// the update thread then picks the mips to stream in/out every frame from the culled mesh render commands.
+// A texture changing its mips is re-created w/ the new mip chain, the materials referencing it
+// switch to a second SRV table once it's resident and the old texture is released a few frames later.
+class TextureStreamer
+{
+public:
+	TextureStreamer(VQRenderer& Renderer, AsyncIOService& AsyncIO, ThreadPool& Workers);
+
+	void Initialize(bool bEnabled, uint BudgetMB);
+	void Reset(); // forget the textures & materials of the unloaded scene
+
+	inline bool IsEnabled() const { return mbEnabled; }
+	FTextureStreamingStats GetStats() const;
+
+	// asset loader threads: creates the texture w/ its mip tail if it's big enough to stream, or w/ all the mips otherwise
+	FTextureResidencyHandle CreateTexture(const std::string& TexName, const std::string& CachedTexturePath, const std::shared_ptr<FCookedTexture>& pCookedTexture);
+	void                    RegisterMaterial(const Material& mat, uint OcclRoughMtlMapComponentMapping);
+
+	// update thread, after the scene views are prepared
+	void Update(Scene& scene, const FSceneView& SceneView, uint NumFramesInFlight); // back buffers + the snapshots the update thread runs ahead
+
+private:
+	struct FStreamedTexture
+	{
+		TextureID                       ID = INVALID_ID;  // mips [ResidentMip, MipCount)
+		std::string                     Name;
+		std::string                     CachedTexturePath;
+		std::shared_ptr<FCookedTexture> pMipTail;         // [MinResidentMip, MipCount) kept in memory for the evictions
+		std::vector<uint>               Materials;
+
+		bool                            bStreaming = false;
+		uint                            StreamingMip = 0;
+		FTextureResidencyHandle         StreamedTexture;  // valid once the new mip chain is created
+	};
+	struct FStreamedMaterial
+	{
+		MaterialID ID = INVALID_ID;
+		uint       OcclRoughMtlMapComponentMapping = 0;
+		SRV_ID     SRVMaterialMaps[2] = { INVALID_ID, INVALID_ID };
+		uint       ActiveSRV = 0;
+		uint64     LastSwapFrame = 0;
+		float      UVScale = 1.0f;
+		bool       bTexturesChanged = false;
+	};
+	struct FStreamingResult
+	{
+		uint                    TextureIndex = 0;
+		uint64                  Generation = 0;
+		FTextureResidencyHandle Texture; // ID == INVALID_ID if the stream in failed
+	};
+	struct FPendingRelease
+	{
+		uint64                  Frame = 0;
+		FTextureResidencyHandle Texture;
+	};
+
+	void StreamTexture(uint TextureIndex, uint TopMip, std::vector<FAsyncReadDesc>& Reads); // queues the read or creates the mip tail
+	void OnTextureStreamed(uint TextureIndex, uint64 Generation, const FTextureResidencyHandle& Texture);
+	void CommitStreamedTextures(Scene& scene);
+	void ReleaseTextures();
+
+private:
+	VQRenderer&     mRenderer;
+	AsyncIOService& mAsyncIO;
+	ThreadPool&     mWorkers;
+
+	bool   mbEnabled = false;
+	uint64 mBudgetBytes = 0;
+	uint64 mTargetBytes = 0;
+	uint64 mFrameIndex = 1;
+	uint   mReleaseDelay = 0; // frames a texture or an SRV table could still be in use by the GPU
+
+	mutable std::mutex                                   mMtx; // registration & streaming results
+	uint64                                               mGeneration = 0;
+	std::vector<TextureStreaming::FTexture>              mTextures;
+	std::vector<FStreamedTexture>                        mStreamedTextures;
+	std::unordered_map<TextureID, uint>                  mLookup_TextureIndex;
+	std::vector<FStreamedMaterial>                       mMaterials;
+	std::unordered_map<MaterialID, uint>                 mLookup_MaterialIndex;
+	std::vector<TextureStreaming::FMaterialTextureRef>   mMaterialTextureRefs;
+	std::vector<FStreamingResult>                        mStreamingResults;
+	uint                                                 mNumStreamingRequests = 0;
+
+	// update thread
+	std::vector<FPendingRelease>                         mPendingReleases;
+	std::vector<TextureStreaming::FVisibleMesh>          mVisibleMeshes;
+	std::vector<float>                                   mMaterialScreenSizes;
+	std::vector<uint>                                    mStreamingCandidates;
+	std::vector<uint>                                    mChangedMaterials;
+};
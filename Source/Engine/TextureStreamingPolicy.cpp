@@ -0,0 +1,158 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "TextureStreaming.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+
+using namespace DirectX;
+
+//----------------------------------------------------------------------------------------------------------------
+// TEXTURE STREAMING POLICY
+//----------------------------------------------------------------------------------------------------------------
+namespace TextureStreaming
+{
+	uint64 FTexture::GetSize(uint TopMip) const
+	{
+		uint64 Size = 0;
+		for (uint mip = TopMip; mip < MipCount; ++mip)
+			Size += MipSizes[mip];
+		return Size;
+	}
+
+	float GetProjectedScreenSize(const FView& View, const XMFLOAT3& Center, float Radius)
+	{
+		const float dx = Center.x - View.CameraPosition.x;
+		const float dy = Center.y - View.CameraPosition.y;
+		const float dz = Center.z - View.CameraPosition.z;
+		const float Distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		if (Distance <= Radius)
+			return FLT_MAX; // camera is inside the bounding sphere
+
+		// diameter 2R at view depth D covers 2R * proj._22 / D in NDC, which is ViewportHeight/2 pixels per unit
+		return Radius * View.ProjectionScaleY * View.ViewportHeight / Distance;
+	}
+
+	uint GetDesiredMip(const FTexture& Texture, float ScreenSize)
+	{
+		if (ScreenSize <= 0.0f)
+			return Texture.MinResidentMip;
+
+		const float MaxDimension = static_cast<float>(std::max(Texture.Width, Texture.Height));
+		if (ScreenSize >= MaxDimension)
+			return 0;
+
+		const uint Mip = static_cast<uint>(std::floor(std::log2(MaxDimension / ScreenSize)));
+		return std::min(Mip, Texture.MinResidentMip);
+	}
+
+	void ComputeMaterialScreenSizes(const FView& View, const std::vector<FVisibleMesh>& VisibleMeshes, uint NumMaterials, std::vector<float>& OutMaterialScreenSizes)
+	{
+		OutMaterialScreenSizes.assign(NumMaterials, 0.0f);
+		for (const FVisibleMesh& Mesh : VisibleMeshes)
+		{
+			assert(Mesh.MaterialIndex < NumMaterials);
+			const float ScreenSize = GetProjectedScreenSize(View, Mesh.Center, Mesh.Radius);
+			const float TexelsNeeded = ScreenSize == FLT_MAX ? FLT_MAX : ScreenSize * Mesh.UVScale;
+			OutMaterialScreenSizes[Mesh.MaterialIndex] = std::max(OutMaterialScreenSizes[Mesh.MaterialIndex], TexelsNeeded);
+		}
+	}
+
+	void UpdateTexturePriorities(std::vector<FTexture>& Textures, const std::vector<FMaterialTextureRef>& MaterialTextureRefs, const std::vector<float>& MaterialScreenSizes, uint64 FrameIndex)
+	{
+		for (FTexture& Texture : Textures)
+			Texture.ScreenSize = 0.0f;
+
+		for (const FMaterialTextureRef& Ref : MaterialTextureRefs)
+		{
+			FTexture& Texture = Textures[Ref.TextureIndex];
+			Texture.ScreenSize = std::max(Texture.ScreenSize, MaterialScreenSizes[Ref.MaterialIndex]);
+		}
+
+		for (FTexture& Texture : Textures)
+		{
+			Texture.DesiredMip = GetDesiredMip(Texture, Texture.ScreenSize);
+			if (Texture.ScreenSize > 0.0f)
+				Texture.LastVisibleFrame = FrameIndex;
+		}
+	}
+
+	uint64 AllocateBudget(std::vector<FTexture>& Textures, uint64 BudgetBytes, uint64 FrameIndex)
+	{
+		// what the textures would like to have: no mips are dropped unless the budget requires
+		uint64 TotalSize = 0;
+		for (FTexture& Texture : Textures)
+		{
+			const bool bVisible = Texture.LastVisibleFrame == FrameIndex;
+			Texture.TargetMip = bVisible ? std::min(Texture.ResidentMip, Texture.DesiredMip) : Texture.ResidentMip;
+			TotalSize += Texture.GetSize(Texture.TargetMip);
+		}
+		if (TotalSize <= BudgetBytes)
+			return TotalSize;
+
+		// evict the textures that haven't been visible for the longest time
+		std::vector<uint> EvictionCandidates;
+		for (uint i = 0; i < Textures.size(); ++i)
+		{
+			const FTexture& Texture = Textures[i];
+			if (Texture.LastVisibleFrame != FrameIndex && Texture.TargetMip < Texture.MinResidentMip)
+				EvictionCandidates.push_back(i);
+		}
+		std::sort(EvictionCandidates.begin(), EvictionCandidates.end(), [&](uint l, uint r) { return Textures[l].LastVisibleFrame < Textures[r].LastVisibleFrame; });
+		for (uint i : EvictionCandidates)
+		{
+			FTexture& Texture = Textures[i];
+			TotalSize -= Texture.GetSize(Texture.TargetMip) - Texture.GetSize(Texture.MinResidentMip);
+			Texture.TargetMip = Texture.MinResidentMip;
+			if (TotalSize <= BudgetBytes)
+				return TotalSize;
+		}
+
+		// drop mips from the visible textures one at a time, starting w/ the most oversampled ones:
+		// the texels of the top mip per screen pixel is the detail lost by dropping it.
+		auto fnGetOversampling = [](const FTexture& Texture)
+		{
+			const uint MaxDimension = std::max(Texture.Width, Texture.Height) >> Texture.TargetMip;
+			return static_cast<float>(MaxDimension) / std::max(Texture.ScreenSize, 1.0f);
+		};
+		using Candidate_t = std::pair<float, uint>; // oversampling, texture index
+		std::priority_queue<Candidate_t> DowngradeCandidates;
+		for (uint i = 0; i < Textures.size(); ++i)
+		{
+			const FTexture& Texture = Textures[i];
+			if (Texture.LastVisibleFrame == FrameIndex && Texture.TargetMip < Texture.MinResidentMip)
+				DowngradeCandidates.push({ fnGetOversampling(Texture), i });
+		}
+		while (TotalSize > BudgetBytes && !DowngradeCandidates.empty())
+		{
+			FTexture& Texture = Textures[DowngradeCandidates.top().second];
+			DowngradeCandidates.pop();
+
+			TotalSize -= Texture.MipSizes[Texture.TargetMip];
+			++Texture.TargetMip;
+			if (Texture.TargetMip < Texture.MinResidentMip)
+				DowngradeCandidates.push({ fnGetOversampling(Texture), static_cast<uint>(&Texture - Textures.data()) });
+		}
+		return TotalSize;
+	}
+}
@@ -22,7 +22,14 @@
 #include "Core/Platform.h"
 #include "Core/Window.h"
 #include "Core/Events.h"
+#include "Core/EventQueue.h"
 #include "Core/Input.h"
+#include "Core/AsyncIO.h"
+#include "Core/FileWatcher.h"
+#include "Core/FramePacer.h"
+#include "Core/FrameSnapshotRing.h"
+#include "Core/Profiler.h"
+#include "Core/MemoryTracking.h"
 #include "Scene/Scene.h"
 #include "Scene/Mesh.h"
 #include "Scene/Camera.h"
@@ -31,6 +38,8 @@
 #include "RenderPass/DepthPrePass.h"
 #include "Settings.h"
 #include "AssetLoader.h"
+#include "TextureStreaming.h"
+#include "BenchmarkRunner.h"
 #include "VQUI.h"
 
 
@@ -38,6 +47,7 @@
 #include "Libs/VQUtils/Source/Timer.h"
 
 #include "Source/Renderer/Renderer.h"
+#include "Source/Renderer/CommandList.h"
 
 #include <memory>
 
@@ -47,7 +57,7 @@
 
 // Pipelined - saparate Update & Render threads
 // Otherwise, Simulation thread for update + render
-#define VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS 0
+#define VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS 1
 
 
 // Outputs Render/Update thread sync values on each Tick()
@@ -70,6 +80,8 @@ struct FLoadingScreenData
 	SRV_ID GetSelectedLoadingScreenSRV_ID() const;
 	void RotateLoadingScreenImageIndex();
 
+	std::atomic<float> Progress = 0.0f; // [0-1] scene load progress, written by the update thread
+
 	// TODO: animation resources
 };
 
@@ -106,6 +118,8 @@ struct FEnvironmentMapRenderingResources
 
 	SRV_ID SRV_BRDFIntegrationLUT = INVALID_ID;
 
+	bool bPreFilteredOnCPU = false; // irradiance maps loaded from the environment map cache, no GPU convolution
+
 	//
 	// HDR10 Static Metadata Parameters -------------------------------
 	// https://docs.microsoft.com/en-us/windows/win32/api/dxgi1_5/ns-dxgi1_5-dxgi_hdr_metadata_hdr10
@@ -272,8 +286,10 @@ public:
 	void RenderThread_UnloadWindowSizeDependentResources(HWND hwnd);
 
 	// PRE_RENDER()
-	// - TBA
+	// - Swaps in the hot reloaded shaders
+	// - Allocates & resets the command lists and the constant buffer memory of the frame
 	void RenderThread_PreRender();
+	void RenderThread_HandleShaderHotReload();
 
 	// RENDER()
 	// - Records command lists in parallel per FSceneView
@@ -310,6 +326,7 @@ public:
 	void UpdateThread_UpdateAppState(const float dt);
 	void UpdateThread_UpdateScene_MainWnd(const float dt);
 	void UpdateThread_UpdateScene_DebugWnd(const float dt);
+	void UpdateThread_UpdateBenchmark(); // -Benchmark: camera flythrough & level transitions
 
 	// PostUpdate()
 	// - Computes visibility per FSceneView
@@ -349,14 +366,14 @@ public:
 
 	inline const FResourceNames& GetResourceNames() const { return mResourceNames; }
 	inline AssetLoader& GetAssetLoader() { return mAssetLoader; }
+	inline TextureStreamer& GetTextureStreamer() { return mTextureStreamer; }
 
 
 private:
 	//-------------------------------------------------------------------------------------------------
 	using EnvironmentMapDescLookup_t  = std::unordered_map<std::string, FEnvironmentMapDescriptor>;
 	//-------------------------------------------------------------------------------------------------
-	using EventPtr_t                  = std::shared_ptr<IEvent>;
-	using EventQueue_t                = BufferedContainer<std::queue<EventPtr_t>, EventPtr_t>;
+	using EventQueue_t                = MPSCQueue<FEventRecord>;
 	//-------------------------------------------------------------------------------------------------
 	using RenderingResourcesLookup_t  = std::unordered_map<HWND, std::shared_ptr<FRenderingResources>>;
 	using WindowLookup_t              = std::unordered_map<HWND, std::unique_ptr<Window>>;
@@ -375,12 +392,15 @@ private:
 #endif
 	ThreadPool                      mWorkers_ModelLoading;
 	ThreadPool                      mWorkers_TextureLoading;
+	AsyncIOService                  mAsyncIO;
+	FileWatcher                     mShaderFileWatcher; // bHotReloadShaders
 
 	// sync
 	std::atomic<bool>               mbStopAllThreads;
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	std::unique_ptr<Semaphore>      mpSemUpdate;
-	std::unique_ptr<Semaphore>      mpSemRender;
+	FrameSnapshotRing               mFrameSnapshots; // update thread -> render thread handoff of the per-frame scene data
+	int                             mIndex_FrameSnapshot_Update; // slot owned by the update thread, valid between Wait/Signal
+	int                             mIndex_FrameSnapshot_Render; // slot owned by the render thread, valid between Wait/Signal
 #endif
 	
 	// windows
@@ -405,6 +425,7 @@ private:
 	VQRenderer                      mRenderer;
 
 	// assets 
+	TextureStreamer                 mTextureStreamer;
 	AssetLoader                     mAssetLoader;
 	BuiltinMeshArray_t              mBuiltinMeshes;
 	std::vector<FDisplayHDRProfile> mDisplayHDRProfiles;
@@ -440,7 +461,11 @@ private:
 	// ui
 	ImGuiContext*                   mpImGuiContext;
 	FUIState                        mUIState;
+	std::vector<FUIDrawData>        mUIDrawData; // per frame, indexed like the scene views
 	FRenderStats                    mRenderStats;
+	FrameHistory                    mFrameHistory_FPS;
+	FrameHistory                    mFrameHistory_FrameTimeMs;
+	FrameHistory                    mFrameHistory_AllocationsPerFrame; // tracked allocations, see EMemoryTag
 
 	// rendering resources per window
 #if 0
@@ -458,6 +483,8 @@ private:
 	Timer                           mTimer;
 	Timer                           mTimerRender;
 	float                           mEffectiveFrameRateLimit_ms;
+	FramePacer                      mFramePacer;
+	BenchmarkRunner                 mBenchmark;
 
 	// misc.
 	// One Swapchain.Resize() call is required for the first time 
@@ -471,6 +498,7 @@ private:
 	void                            InitializeWindows(const FStartupParameters& Params);
 	void                            InitializeHDRProfiles();
 	void                            InitializeEnvironmentMaps();
+	void                            InitializeVirtualFileSystem();
 	void                            InitializeScenes();
 	void                            InitializeUI(HWND hwnd);
 	void                            InitializeThreads();
@@ -478,6 +506,15 @@ private:
 	void                            ExitThreads();
 	void                            ExitUI();
 
+	// # frames the update/render thread has completed: the loop counters of the pipelined threads, the simulation ticks otherwise
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	inline uint64                   GetUpdateFrameIndex() const { return mNumUpdateLoopsExecuted.load(); }
+	inline uint64                   GetRenderFrameIndex() const { return mNumRenderLoopsExecuted.load(); }
+#else
+	inline uint64                   GetUpdateFrameIndex() const { return mNumSimulationTicks; }
+	inline uint64                   GetRenderFrameIndex() const { return mNumSimulationTicks; }
+#endif
+
 	void                            HandleWindowTransitions(std::unique_ptr<Window>& pWin, const FWindowSettings& settings);
 	void                            SetMouseCaptureForWindow(HWND hwnd, bool bCaptureMouse, bool bReleaseAtCapturedPosition);
 	inline void                     SetMouseCaptureForWindow(Window* pWin, bool bCaptureMouse, bool bReleaseAtCapturedPosition) { this->SetMouseCaptureForWindow(pWin->GetHWND(), bCaptureMouse, bReleaseAtCapturedPosition); };
@@ -485,6 +522,7 @@ private:
 	void                            InitializeBuiltinMeshes();
 	void                            LoadLoadingScreenData(); // data is loaded in parallel but it blocks the calling thread until load is complete
 	void                            Load_SceneData_Dispatch();
+	void                            CancelSceneLoad(); // cancels the loads of mpScene and waits for the in-flight ones to complete
 	void                            LoadEnvironmentMap(const std::string& EnvMapName);
 
 	HRESULT                         RenderThread_RenderMainWindow_LoadingScreen(FWindowRenderContext& ctx);
@@ -497,14 +535,15 @@ private:
 	void                            RenderThread_HandleEvents();
 	void                            MainThread_HandleEvents();
 
-	void                            RenderThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent>& pEvent);
+	void                            RenderThread_HandleWindowResizeEvent(const IEvent* pEvent);
 	void                            RenderThread_HandleWindowCloseEvent(const IEvent* pEvent);
 	void                            RenderThread_HandleToggleFullscreenEvent(const IEvent* pEvent);
 	void                            RenderThread_HandleSetVSyncEvent(const IEvent* pEvent);
 	void                            RenderThread_HandleSetSwapchainFormatEvent(const IEvent* pEvent);
 	void                            RenderThread_HandleSetHDRMetaDataEvent(const IEvent* pEvent);
 
-	void                            UpdateThread_HandleWindowResizeEvent(const std::shared_ptr<IEvent>& pEvent);
+	void                            UpdateThread_HandleWindowResizeEvent(const IEvent* pEvent);
+	void                            UpdateThread_HandleSetSwapchainFormatEvent(const IEvent* pEvent);
 
 	//
 	// FRAME RENDERING PIPELINE
@@ -538,8 +577,8 @@ private:
 	//
 	// RENDER HELPERS
 	//
-	void                            DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh);
-	void                            DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView);
+	void                            DrawMesh(HAL::CommandList& Cmd, const Mesh& mesh);
+	void                            DrawShadowViewMeshList(HAL::CommandList& Cmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView);
 
 	std::unique_ptr<Window>&        GetWindow(HWND hwnd);
 	const std::unique_ptr<Window>&  GetWindow(HWND hwnd) const;
@@ -564,7 +603,7 @@ private:
 	bool                            IsHDRSettingOn() const;
 
 	void                            SetEffectiveFrameRateLimit();
-	float                           FramePacing(const float dt);
+	float                           FramePacing(); // returns the time waited in ms
 	const FDisplayHDRProfile*       GetHDRProfileIfExists(const wchar_t* pwStrLogicalDisplayName);
 	FSetHDRMetaDataParams           GatherHDRMetaDataParameters(HWND hwnd);
 
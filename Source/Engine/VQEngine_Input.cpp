@@ -44,8 +44,7 @@ static void Toggle(bool& b) { b = !b; }
 void VQEngine::HandleEngineInput()
 {
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
-	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
 #endif
 
 	for (decltype(mInputStates)::iterator it = mInputStates.begin(); it != mInputStates.end(); ++it)
@@ -65,7 +64,7 @@ void VQEngine::HandleEngineInput()
 				constexpr bool CAPTURE_MOUSE = false;
 				constexpr bool MOUSE_VISIBLE = true;
 				constexpr bool RELEASE_WHERE_CAPTURED = true;
-				mEventQueue_VQEToWin_Main.AddItem(std::make_shared<SetMouseCaptureEvent>(hwnd, CAPTURE_MOUSE, MOUSE_VISIBLE, RELEASE_WHERE_CAPTURED));
+				mEventQueue_VQEToWin_Main.Push(SetMouseCaptureEvent(hwnd, CAPTURE_MOUSE, MOUSE_VISIBLE, RELEASE_WHERE_CAPTURED));
 			}
 		}
 	}
@@ -91,8 +90,7 @@ void VQEngine::HandleUIInput()
 			{
 				WaitUntilRenderingFinishes();
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-				const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
-				const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
+				const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
 #endif
 				FPostProcessParameters& PPParams = mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
 				PPParams.bEnableCAS = !PPParams.bEnableCAS;
@@ -106,8 +104,7 @@ void VQEngine::HandleUIInput()
 void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 {
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
-	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
 #endif
 	const bool bIsShiftDown = input.IsKeyDown("Shift");
 	//const bool bIsAltDown = input.IsKeyDown("Alt"); // Alt+Z detection doesn't work, TODO: fix
@@ -126,7 +123,7 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 		const bool bCapture = true;
 		const bool bVisible = !bCapture; // visible=false if capture=true
 		const bool bReleaseWhereCaptured = false; // doesn't matter for this event
-		mEventQueue_VQEToWin_Main.AddItem(std::make_shared< SetMouseCaptureEvent>(hwnd, bCapture, bVisible, bReleaseWhereCaptured));
+		mEventQueue_VQEToWin_Main.Push(SetMouseCaptureEvent(hwnd, bCapture, bVisible, bReleaseWhereCaptured));
 	}
 	if (bMouseLeftReleased || bMouseRightReleased)
 	{
@@ -136,7 +133,7 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 		// release where captured if camera is updated
 		// if UI is interacted with (click & drag), then don't update the release positionDown(Input::EMouseButtons::MOUSE_BUTTON_RIGHT);
 		const bool bReleaseWhereCaptured = !bMouseInputUsedByUI;
-		mEventQueue_VQEToWin_Main.AddItem(std::make_shared< SetMouseCaptureEvent>(hwnd, bCapture, bVisible, bReleaseWhereCaptured));
+		mEventQueue_VQEToWin_Main.Push(SetMouseCaptureEvent(hwnd, bCapture, bVisible, bReleaseWhereCaptured));
 	}
 
 	// UI
@@ -151,7 +148,7 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 	if (input.IsKeyTriggered("V")) // Vsync
 	{
 		auto& SwapChain = mRenderer.GetWindowSwapChain(hwnd);
-		mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetVSyncEvent>(hwnd, !SwapChain.IsVSyncOn()));
+		mEventQueue_WinToVQE_Renderer.Push(SetVSyncEvent(hwnd, !SwapChain.IsVSyncOn()));
 	}
 	if (input.IsKeyTriggered("M")) // MSAA
 	{
@@ -173,8 +170,8 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 
 		const uint32 W = mpWinMain->GetWidth();
 		const uint32 H = mpWinMain->GetHeight();
-		mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<WindowResizeEvent>(W, H, hwnd));
-		mEventQueue_WinToVQE_Update.AddItem(std::make_unique<WindowResizeEvent>(W, H, hwnd));
+		mEventQueue_WinToVQE_Renderer.Push(WindowResizeEvent(W, H, hwnd));
+		mEventQueue_WinToVQE_Update.Push(WindowResizeEvent(W, H, hwnd));
 		Log::Info("Toggle FSR: %d", PPParams.bEnableFSR);
 	}
 
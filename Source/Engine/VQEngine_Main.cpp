@@ -17,6 +17,7 @@
 //	Contact: volkanilbeyli@gmail.com
 
 #include "VQEngine.h"
+#include "Core/VirtualFileSystem.h"
 #include "Libs/VQUtils/Source/utils.h"
 
 #include <cassert>
@@ -37,20 +38,32 @@ void ReportSystemInfo(const VQSystemInfo::FSystemInfo& i, bool bDetailed = false
 	Log::Info("\n%s", sysInfo.c_str());
 }
 #endif
+// the update thread's queue takes the raw mouse input, which can arrive at 1-8kHz
+constexpr size_t EVENT_QUEUE_CAPACITY_MAIN     = 256;
+constexpr size_t EVENT_QUEUE_CAPACITY_RENDERER = 256;
+constexpr size_t EVENT_QUEUE_CAPACITY_UPDATE   = 4096;
+
 VQEngine::VQEngine()
-	: mAssetLoader(mWorkers_ModelLoading, mWorkers_TextureLoading, mRenderer)
+	: mEventQueue_VQEToWin_Main(EVENT_QUEUE_CAPACITY_MAIN)
+	, mEventQueue_WinToVQE_Renderer(EVENT_QUEUE_CAPACITY_RENDERER)
+	, mEventQueue_WinToVQE_Update(EVENT_QUEUE_CAPACITY_UPDATE)
+	, mTextureStreamer(mRenderer, mAsyncIO, mWorkers_TextureLoading)
+	, mAssetLoader(mWorkers_ModelLoading, mWorkers_TextureLoading, mAsyncIO, mTextureStreamer, mRenderer)
 	, mRenderPass_AO(FAmbientOcclusionPass::EMethod::FFX_CACAO)
 {}
 
 void VQEngine::MainThread_Tick()
 {
-#if !VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const uint64& mNumRenderLoopsExecuted = mNumSimulationTicks;
-#endif
+	const uint64 FrameIndex = GetRenderFrameIndex();
+
+	if (mBenchmark.IsFinished())
+	{
+		PostQuitMessage(0);
+	}
 
 	if (this->mSettings.bAutomatedTestRun)
 	{
-		if (this->mSettings.NumAutomatedTestFrames <= mNumRenderLoopsExecuted)
+		if (this->mSettings.NumAutomatedTestFrames <= FrameIndex)
 		{
 			PostQuitMessage(0);
 		}
@@ -65,6 +78,7 @@ bool VQEngine::Initialize(const FStartupParameters& Params)
 {
 	Timer  t;  t.Reset();  t.Start();
 	Timer t2; t2.Reset(); t2.Start();
+	Profiler::SetThreadName("MainThread");
 
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
 	ThreadPool& WorkerThreads = mWorkers_Update;
@@ -73,6 +87,7 @@ bool VQEngine::Initialize(const FStartupParameters& Params)
 #endif
 
 	InitializeEngineSettings(Params);
+	InitializeVirtualFileSystem();
 	InitializeEnvironmentMaps();
 	InitializeHDRProfiles();
 	float f1 = t.Tick();
@@ -82,6 +97,7 @@ bool VQEngine::Initialize(const FStartupParameters& Params)
 	InitializeScenes();
 	float f2 = t.Tick();
 	InitializeThreads();
+	mFramePacer.Initialize(mSettings.gfx.FrameLimiterSpinThresholdMs);
 	SetEffectiveFrameRateLimit();
 	float f4 = t.Tick();
 
@@ -105,7 +121,7 @@ bool VQEngine::Initialize(const FStartupParameters& Params)
 			HWND hwnd = mpWinMain->GetHWND();
 			if (!mpWinMain->IsClosed())
 			{
-				mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetStaticHDRMetaDataEvent>(hwnd, this->GatherHDRMetaDataParameters(hwnd)));
+				mEventQueue_WinToVQE_Renderer.Push(SetStaticHDRMetaDataEvent(hwnd, this->GatherHDRMetaDataParameters(hwnd)));
 			}
 		});
 	});
@@ -126,8 +142,25 @@ void VQEngine::Exit()
 {
 	ExitThreads();
 
+	const FFramePacingStats FramePacingStats = mFramePacer.GetStats();
+	Log::Info("FramePacing: %llu frames, avg=%.2fms jitter=%.3fms max err=%.3fms missed=%llu | CPU while waiting=%.1f%%"
+		, FramePacingStats.NumFrames, FramePacingStats.AvgFrameTimeMs, FramePacingStats.JitterMs, FramePacingStats.MaxErrorMs
+		, FramePacingStats.NumMissedFrames, FramePacingStats.GetWaitCPUUtilization() * 100.0);
+	mFramePacer.Exit();
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const FFrameSnapshotStats FrameSnapshotStats = mFrameSnapshots.GetStats();
+	Log::Info("FrameSnapshots: %llu frames, latency=%u, update-to-render latency avg=%.2fms max=%.2fms | update waited %.1fms, render waited %.1fms"
+		, FrameSnapshotStats.NumFramesConsumed, mFrameSnapshots.GetLatency(), FrameSnapshotStats.AvgLatencyMs, FrameSnapshotStats.MaxLatencyMs
+		, FrameSnapshotStats.ProducerWaitMs, FrameSnapshotStats.ConsumerWaitMs);
+#endif
+
 	mRenderer.Unload();
 	mRenderer.Exit();
+
+	if (!mSettings.MemoryReportPath.empty())
+		MemoryTracking::WriteReport(mSettings.MemoryReportPath);
+
+	VirtualFileSystem::UnmountAll();
 }
 
 
@@ -153,6 +186,7 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	s.gfx.bUseTripleBuffering = true;
 	s.gfx.RenderScale = 1.0f;
 	s.gfx.MaxFrameRate = -1; // Auto
+	s.gfx.FrameLimiterSpinThresholdMs = 1.0f;
 
 	s.WndMain.Width = 1920;
 	s.WndMain.Height = 1080;
@@ -171,8 +205,23 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	s.bAutomatedTestRun = false;
 	s.NumAutomatedTestFrames = 100; // default num frames to run if -Test is specified in cmd line params
 
+	s.bBenchmarkRun = false;
+	s.BenchmarkLevels = ""; // all
+	s.NumBenchmarkWarmupFrames = 120;
+	s.NumBenchmarkFrames = 1000;
+	s.BenchmarkReportPath = "Benchmarks/VQE_Benchmark";
+	s.MemoryReportPath = "Logs/VQE_Memory.json";
+
 	s.StartupScene = "Default";
 
+	s.bBuildPakFile = false;
+	s.UpdateRenderFrameLatency = 1;
+#ifdef _DEBUG
+	s.bHotReloadShaders = true;
+#else
+	s.bHotReloadShaders = false;
+#endif
+
 	// Override #0 : from file
 	FStartupParameters paramFile = VQEngine::ParseEngineSettingsFile();
 	const FEngineSettings& pf = paramFile.EngineSettings;
@@ -181,6 +230,9 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	if (paramFile.bOverrideGFXSetting_bUseTripleBuffering)         s.gfx.bUseTripleBuffering = pf.gfx.bUseTripleBuffering;
 	if (paramFile.bOverrideGFXSetting_RenderScale)                 s.gfx.RenderScale         = pf.gfx.RenderScale;
 	if (paramFile.bOverrideGFXSetting_bMaxFrameRate)               s.gfx.MaxFrameRate        = pf.gfx.MaxFrameRate;
+	if (paramFile.bOverrideGFXSetting_FrameLimiterSpinThreshold)   s.gfx.FrameLimiterSpinThresholdMs = pf.gfx.FrameLimiterSpinThresholdMs;
+	if (paramFile.bOverrideGFXSetting_bTextureStreaming)           s.gfx.bTextureStreaming   = pf.gfx.bTextureStreaming;
+	if (paramFile.bOverrideGFXSetting_TextureStreamingBudget)      s.gfx.TextureStreamingBudgetMB = pf.gfx.TextureStreamingBudgetMB;
 
 	if (paramFile.bOverrideENGSetting_MainWindowWidth)             s.WndMain.Width            = pf.WndMain.Width;
 	if (paramFile.bOverrideENGSetting_MainWindowHeight)            s.WndMain.Height           = pf.WndMain.Height;
@@ -202,6 +254,8 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	}
 
 	if (paramFile.bOverrideENGSetting_StartupScene)              s.StartupScene = pf.StartupScene;
+	if (paramFile.bOverrideENGSetting_UpdateRenderFrameLatency)  s.UpdateRenderFrameLatency = pf.UpdateRenderFrameLatency;
+	if (paramFile.bOverrideENGSetting_bHotReloadShaders)         s.bHotReloadShaders = pf.bHotReloadShaders;
 
 	// Override #1 : if there's command line params
 	if (Params.bOverrideGFXSetting_bVSync)                      s.gfx.bVsync               = p.gfx.bVsync;
@@ -209,6 +263,9 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	if (Params.bOverrideGFXSetting_bUseTripleBuffering)         s.gfx.bUseTripleBuffering  = p.gfx.bUseTripleBuffering;
 	if (Params.bOverrideGFXSetting_RenderScale)                 s.gfx.RenderScale          = p.gfx.RenderScale;
 	if (Params.bOverrideGFXSetting_bMaxFrameRate)               s.gfx.MaxFrameRate         = p.gfx.MaxFrameRate;
+	if (Params.bOverrideGFXSetting_FrameLimiterSpinThreshold)   s.gfx.FrameLimiterSpinThresholdMs = p.gfx.FrameLimiterSpinThresholdMs;
+	if (Params.bOverrideGFXSetting_bTextureStreaming)           s.gfx.bTextureStreaming    = p.gfx.bTextureStreaming;
+	if (Params.bOverrideGFXSetting_TextureStreamingBudget)      s.gfx.TextureStreamingBudgetMB = p.gfx.TextureStreamingBudgetMB;
 
 	if (Params.bOverrideENGSetting_MainWindowWidth)             s.WndMain.Width            = p.WndMain.Width;
 	if (Params.bOverrideENGSetting_MainWindowHeight)            s.WndMain.Height           = p.WndMain.Height;
@@ -228,8 +285,28 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 		s.bAutomatedTestRun = true;
 		s.NumAutomatedTestFrames = p.NumAutomatedTestFrames;
 	}
+	if (Params.bOverrideENGSetting_bBenchmarkRun)            s.bBenchmarkRun            = p.bBenchmarkRun;
+	if (Params.bOverrideENGSetting_BenchmarkLevels)          s.BenchmarkLevels          = p.BenchmarkLevels;
+	if (Params.bOverrideENGSetting_NumBenchmarkWarmupFrames) s.NumBenchmarkWarmupFrames = p.NumBenchmarkWarmupFrames;
+	if (Params.bOverrideENGSetting_NumBenchmarkFrames)       s.NumBenchmarkFrames       = p.NumBenchmarkFrames;
+	if (Params.bOverrideENGSetting_BenchmarkReportPath)      s.BenchmarkReportPath      = p.BenchmarkReportPath;
+	if (Params.bOverrideENGSetting_MemoryReportPath)         s.MemoryReportPath         = p.MemoryReportPath;
 
 	if (Params.bOverrideENGSetting_StartupScene)             s.StartupScene           = p.StartupScene;
+	if (Params.bOverrideENGSetting_UpdateRenderFrameLatency) s.UpdateRenderFrameLatency = p.UpdateRenderFrameLatency;
+	if (Params.bOverrideENGSetting_bBuildPakFile)            s.bBuildPakFile          = p.bBuildPakFile;
+	if (Params.bOverrideENGSetting_bHotReloadShaders)        s.bHotReloadShaders      = p.bHotReloadShaders;
+
+	// benchmarks measure the CPU work of the frame, not the display
+	if (s.bBenchmarkRun)
+	{
+		s.gfx.bVsync = false;
+		s.gfx.MaxFrameRate = 0;
+		s.NumBenchmarkWarmupFrames = std::max(s.NumBenchmarkWarmupFrames, 0);
+		s.NumBenchmarkFrames = std::max(s.NumBenchmarkFrames, 1);
+		if (!Params.bOverrideENGSetting_MemoryReportPath)
+			s.MemoryReportPath = s.BenchmarkReportPath + "_Memory.json"; // next to the timing reports
+	}
 }
 
 void VQEngine::InitializeWindows(const FStartupParameters& Params)
@@ -284,6 +361,20 @@ void VQEngine::InitializeEnvironmentMaps()
 	}
 }
 
+void VQEngine::InitializeVirtualFileSystem()
+{
+	// Data.pak is optional: assets that aren't packed are read from the loose files under Data/
+	const std::string PakFilePath = "Data.pak";
+	if (mSettings.bBuildPakFile)
+	{
+		VirtualFileSystem::BuildPakFile(PakFilePath, "Data/");
+	}
+	if (DirectoryUtil::FileExists(PakFilePath))
+	{
+		VirtualFileSystem::MountPakFile(PakFilePath);
+	}
+}
+
 void VQEngine::InitializeScenes()
 {
 	std::vector<std::string>& mSceneNames = mResourceNames.mSceneNames;
@@ -297,6 +388,20 @@ void VQEngine::InitializeScenes()
 
 	// read scene files from disk: Data/Scenes/
 
+	if (mSettings.bBenchmarkRun)
+	{
+		FBenchmarkSettings BenchmarkSettings;
+		if (!mSettings.BenchmarkLevels.empty())
+			BenchmarkSettings.Levels = StrUtil::split(mSettings.BenchmarkLevels, ',');
+		BenchmarkSettings.NumWarmupFrames = static_cast<uint>(mSettings.NumBenchmarkWarmupFrames);
+		BenchmarkSettings.NumFrames       = static_cast<uint>(mSettings.NumBenchmarkFrames);
+		BenchmarkSettings.FixedTimestep   = 1.0f / 60.0f;
+		BenchmarkSettings.ReportPath      = mSettings.BenchmarkReportPath;
+		mBenchmark.Initialize(BenchmarkSettings, mSceneNames);
+		if (mBenchmark.IsEnabled())
+			mSettings.StartupScene = mBenchmark.GetFirstLevel();
+	}
+
 	// set the selected scene index
 	auto it2 = std::find_if(mSceneNames.begin(), mSceneNames.end(), [&](const std::string& scn) { return scn == mSettings.StartupScene; });
 	bool bSceneNameMatch = it2 != mSceneNames.end();
@@ -325,22 +430,27 @@ void VQEngine::InitializeScenes()
 
 void VQEngine::InitializeThreads()
 {
-	const int NUM_SWAPCHAIN_BACKBUFFERS = mSettings.gfx.bUseTripleBuffering ? 3 : 2;
 	const size_t HWThreads  = ThreadPool::sHardwareThreadCount;
 	const size_t HWCores    = HWThreads / 2;
 	const size_t NumRuntimeWorkers = HWCores - 2; // reserve 2 cores for Update + Render threads
 	const size_t NumLoadtimeWorkers    = HWThreads;
 
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	mpSemUpdate.reset(new Semaphore(NUM_SWAPCHAIN_BACKBUFFERS, NUM_SWAPCHAIN_BACKBUFFERS));
-	mpSemRender.reset(new Semaphore(0                        , NUM_SWAPCHAIN_BACKBUFFERS));
+	mFrameSnapshots.Initialize(static_cast<uint>(std::max(1, mSettings.UpdateRenderFrameLatency)));
+	mIndex_FrameSnapshot_Update = FrameSnapshotRing::INVALID_SLOT;
+	mIndex_FrameSnapshot_Render = FrameSnapshotRing::INVALID_SLOT;
+	mUIDrawData.resize(mFrameSnapshots.GetNumSlots());
 	
 	mbRenderThreadInitialized.store(false);
+#else
+	mUIDrawData.resize(1);
 #endif
 	mbStopAllThreads.store(false);
 
 	mWorkers_ModelLoading.Initialize(NumLoadtimeWorkers, "LoadWorkers_Model");
 	mWorkers_TextureLoading.Initialize(NumLoadtimeWorkers, "LoadWorkers_Texture");
+	mAsyncIO.Initialize(EAsyncIOBackend::OVERLAPPED, 2); // the thread count is for the THREAD_POOL fallback
+	mTextureStreamer.Initialize(mSettings.gfx.bTextureStreaming, static_cast<uint>(mSettings.gfx.TextureStreamingBudgetMB));
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
 	mRenderThread = std::thread(&VQEngine::RenderThread_Main, this);
 	mUpdateThread = std::thread(&VQEngine::UpdateThread_Main, this);
@@ -354,6 +464,7 @@ void VQEngine::InitializeThreads()
 
 void VQEngine::ExitThreads()
 {
+	mAsyncIO.Exit(); // cancels the pending reads before the loaders they feed are gone
 	mWorkers_ModelLoading.Exit();
 	mWorkers_TextureLoading.Exit();
 	mbStopAllThreads.store(true);
@@ -37,18 +37,18 @@
 void VQEngine::RenderThread_Main()
 {
 	Log::Info("RenderThread Created.");
+	Profiler::SetThreadName("RenderThread");
 	RenderThread_Inititalize();
 
-	RenderThread_HandleEvents();
-
 	float dt = 0.0f;
 	while (!this->mbStopAllThreads)
 	{
 		float dt = mTimerRender.Tick();
+		Profiler::Counter("RenderThread dt (ms)", dt * 1000.0f);
 
 		RenderThread_Tick();
 
-		float SleepTime = FramePacing(dt);
+		float SleepTime = FramePacing();
 
 		// RenderThread_Logging()
 		constexpr int LOGGING_PERIOD = 4; // seconds
@@ -73,12 +73,13 @@ void VQEngine::RenderThread_WaitForUpdateThread()
 	Log::Info("r:wait : u=%llu, r=%llu", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
 #endif
 
-	mpSemRender->Wait();
+	mIndex_FrameSnapshot_Render = mFrameSnapshots.BeginRead(); // the oldest snapshot the update thread published
 }
 
 void VQEngine::RenderThread_SignalUpdateThread()
 {
-	mpSemUpdate->Signal();
+	mFrameSnapshots.EndRead(mIndex_FrameSnapshot_Render); // the slot can be written again
+	mIndex_FrameSnapshot_Render = FrameSnapshotRing::INVALID_SLOT;
 }
 #endif
 
@@ -87,29 +88,43 @@ void VQEngine::RenderThread_Tick()
 {
 	SCOPED_CPU_MARKER_C("RenderThread_Tick()", 0xFF007700);
 
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	// the events are handled w/ a snapshot acquired, the handlers read the frame data of the render thread
+	RenderThread_WaitForUpdateThread();
+	if (mIndex_FrameSnapshot_Render == FrameSnapshotRing::INVALID_SLOT)
+		return; // exiting
+#endif
+
 	RenderThread_HandleEvents();
 
 	if (this->mbStopAllThreads)
-		return; // HandleEvents() can set @this->mbStopAllThreads true with WindowCloseEvent;
-
+	{
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	RenderThread_WaitForUpdateThread();
+		RenderThread_SignalUpdateThread();
 #endif
+		return; // HandleEvents() can set @this->mbStopAllThreads true with WindowCloseEvent;
+	}
 
 #if DEBUG_LOG_THREAD_SYNC_VERBOSE
 	Log::Info(/*"RenderThread_Tick() : */"r%d (u=%llu)", mNumRenderLoopsExecuted.load(), mNumUpdateLoopsExecuted.load());
 #endif
 
+	const uint64 PreRenderBeginNs = Profiler::GetTimeNs();
 	RenderThread_PreRender();
+	const uint64 RenderFrameBeginNs = Profiler::GetTimeNs();
 	RenderThread_RenderFrame();
+	if (mBenchmark.IsEnabled())
+	{
+		mBenchmark.RecordRenderFrame(GetRenderFrameIndex(), PreRenderBeginNs, RenderFrameBeginNs, Profiler::GetTimeNs());
+	}
 
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
 	++mNumRenderLoopsExecuted;
 
 	RenderThread_SignalUpdateThread();
-#endif
-
+#else
 	RenderThread_HandleEvents();
+#endif
 }
 
 
@@ -135,6 +150,14 @@ void VQEngine::RenderThread_Inititalize()
 	mNumRenderLoopsExecuted.store(0);
 #endif
 
+#if VQENGINE_MEMORY_TRACKING
+	FRendererMemoryHooks MemoryHooks;
+	MemoryHooks.fnOnImageAlloc    = [](size_t NumBytes) { MemoryTracking::OnAlloc(EMemoryTag::IMAGE_DECODE, NumBytes); };
+	MemoryHooks.fnOnImageFree     = [](size_t NumBytes) { MemoryTracking::OnFree(EMemoryTag::IMAGE_DECODE, NumBytes); };
+	MemoryHooks.fnTrackShaderBlob = [](size_t NumBytes) { return MemoryTracking::TrackAllocation(EMemoryTag::SHADER_BLOBS, NumBytes); };
+	mRenderer.SetMemoryHooks(MemoryHooks);
+#endif
+
 	// Initialize Renderer: Device, Queues, Heaps
 	mRenderer.Initialize(mSettings.gfx);
 
@@ -150,14 +173,14 @@ void VQEngine::RenderThread_Inititalize()
 		}
 
 		mRenderer.InitializeRenderContext(mpWinMain.get(), NUM_SWAPCHAIN_BUFFERS, mSettings.gfx.bVsync, bCreateHDRSwapchain);
-		mEventQueue_VQEToWin_Main.AddItem(std::make_shared<HandleWindowTransitionsEvent>(mpWinMain->GetHWND()));
+		mEventQueue_VQEToWin_Main.Push(HandleWindowTransitionsEvent(mpWinMain->GetHWND()));
 	}
 	if(mpWinDebug)
 	{
 		const bool bIsContainingWindowOnHDRScreen = VQSystemInfo::FMonitorInfo::CheckHDRSupport(mpWinDebug->GetHWND());
 		constexpr bool bCreateHDRSwapchain = false; // only main window in HDR for now
 		mRenderer.InitializeRenderContext(mpWinDebug.get(), NUM_SWAPCHAIN_BUFFERS, false, bCreateHDRSwapchain);
-		mEventQueue_VQEToWin_Main.AddItem(std::make_shared<HandleWindowTransitionsEvent>(mpWinDebug->GetHWND()));
+		mEventQueue_VQEToWin_Main.Push(HandleWindowTransitionsEvent(mpWinDebug->GetHWND()));
 	}
 
 	// initialize builtin meshes
@@ -180,6 +203,12 @@ void VQEngine::RenderThread_Inititalize()
 		mRenderPass_AO.Initialize(mRenderer.GetDevicePtr());
 	}
 
+	if (mSettings.bHotReloadShaders)
+	{
+		constexpr uint SHADER_FILE_POLL_INTERVAL_MS = 250;
+		mShaderFileWatcher.Initialize(mRenderer.GetShaderSourceFiles(), SHADER_FILE_POLL_INTERVAL_MS);
+	}
+
 	// load window resources
 	const bool bFullscreen = mpWinMain->IsFullscreen();
 	const int W = bFullscreen ? mpWinMain->GetFullscreenWidth() : mpWinMain->GetWidth();
@@ -196,8 +225,9 @@ void VQEngine::RenderThread_Inititalize()
 void VQEngine::RenderThread_Exit()
 {
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	mpSemUpdate->Signal();
+	mFrameSnapshots.Abort(); // wake up the update thread if it's waiting for a free slot
 #endif
+	mShaderFileWatcher.Exit();
 	mRenderPass_AO.Exit();
 }
 
@@ -667,9 +697,8 @@ void VQEngine::RenderThread_UnloadWindowSizeDependentResources(HWND hwnd)
 	{
 		FRenderingResources_MainWindow& r = mResources_MainWnd;
 
-		// sync GPU
-		auto& ctx = mRenderer.GetWindowRenderContext(hwnd);
-		ctx.SwapChain.WaitForGPU();
+		// no GPU flush for the render targets: DestroyTexture() releases them once the frame being recorded is done on the GPU.
+		// The AO pass is the exception, see the callers.
 
 		mRenderer.DestroyTexture(r.Tex_SceneDepthMSAA);
 		mRenderer.DestroyTexture(r.Tex_SceneColorMSAA);
@@ -689,7 +718,7 @@ void VQEngine::RenderThread_UnloadWindowSizeDependentResources(HWND hwnd)
 		mRenderer.DestroyTexture(r.Tex_PostProcess_FSR_EASUOut);
 		mRenderer.DestroyTexture(r.Tex_PostProcess_FSR_RCASOut);
 
-		mRenderPass_AO.OnDestroyWindowSizeDependentResources();
+		mRenderPass_AO.OnDestroyWindowSizeDependentResources(); // FFX CACAO releases its resources immediately: GPU must be idle
 	}
 
 	// TODO: generic implementation of other window procedures for unload
@@ -712,15 +741,39 @@ static uint32_t GetNumShadowViewCmdRecordingThreads(const FSceneShadowView& Shad
 	return 0;
 #endif
 }
+void VQEngine::RenderThread_HandleShaderHotReload()
+{
+	SCOPED_CPU_MARKER("RenderThread_HandleShaderHotReload()");
+
+	// kick off the recompiles, they're swapped in at the start of a later frame once they're done
+	mRenderer.ReloadShaders(mShaderFileWatcher.PopChangedFiles());
+
+	// no command list of this frame references the PSOs yet, & the replaced PSOs are released
+	// once the frames that might be using them are done on the GPU
+	if (mRenderer.ApplyShaderReloads() > 0)
+	{
+		mShaderFileWatcher.AddFiles(mRenderer.GetShaderSourceFiles()); // new includes
+	}
+}
+
 void VQEngine::RenderThread_PreRender()
 {
+	const uint64 FrameIndex = GetRenderFrameIndex();
 	SCOPED_CPU_MARKER("RenderThread_PreRender()");
 	FWindowRenderContext& ctx = mRenderer.GetWindowRenderContext(mpWinMain->GetHWND());
+
+	if (mSettings.bHotReloadShaders)
+	{
+		RenderThread_HandleShaderHotReload();
+	}
+
+	// release the textures & recycle the descriptors destroyed in the frames that are no longer in flight
+	mRenderer.ProcessDeferredReleases();
 	
 	const int NUM_BACK_BUFFERS  = ctx.GetNumSwapchainBuffers();
 	const int BACK_BUFFER_INDEX = ctx.GetCurrentSwapchainBufferIndex();
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int FRAME_DATA_INDEX  = mNumRenderLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX  = mIndex_FrameSnapshot_Render;
 #else
 	const int FRAME_DATA_INDEX = 0;
 #endif
@@ -736,19 +789,15 @@ void VQEngine::RenderThread_PreRender()
 	const uint32_t NumCmdRecordingThreads_CMP = 0;
 	const uint32_t NumCmdRecordingThreads_CPY = 0;
 	const uint32_t NumCmdRecordingThreads = NumCmdRecordingThreads_GFX + NumCmdRecordingThreads_CPY + NumCmdRecordingThreads_CMP;
-	const uint32_t ConstantBufferBytesPerThread = 12 * MEGABYTE;
 #else
 	const uint32_t NumCmdRecordingThreads_GFX = 1;
 	const uint32_t NumCmdRecordingThreads = NumCmdRecordingThreads_GFX;
-	const uint32_t ConstantBufferBytesPerThread = 36 * MEGABYTE;
 #endif
 
 	ctx.AllocateCommandLists(CommandQueue::EType::GFX, NumCmdRecordingThreads_GFX);
 	ctx.ResetCommandLists(CommandQueue::EType::GFX, NumCmdRecordingThreads_GFX);
-	ctx.AllocateConstantBufferMemory(NumCmdRecordingThreads, ConstantBufferBytesPerThread);
-
-	for (size_t iThread = 0; iThread < NumCmdRecordingThreads; ++iThread)
-		ctx.GetConstantBufferHeap(iThread).OnBeginFrame();
+	ctx.AllocateConstantBufferHeaps(NumCmdRecordingThreads);
+	ctx.BeginConstantBufferFrame(FrameIndex);
 
 	ID3D12DescriptorHeap* ppHeaps[] = { mRenderer.GetDescHeap(EResourceHeapType::CBV_SRV_UAV_HEAP) };
 
@@ -987,6 +1036,17 @@ HRESULT VQEngine::RenderThread_RenderMainWindow_LoadingScreen(FWindowRenderConte
 
 	pCmd->DrawIndexedInstanced(3, 1, 0, 0, 0);
 
+	// Draw progress bar
+	const float LoadProgress = mLoadingScreenData.Progress.load();
+	if (LoadProgress > 0.0f)
+	{
+		const float ProgressBarColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const LONG  ProgressBarHeight  = (LONG)RenderResolutionY / 128 + 4;
+		const LONG  ProgressBarWidth   = (LONG)(RenderResolutionX * (LoadProgress < 1.0f ? LoadProgress : 1.0f));
+		D3D12_RECT  rectProgressBar    { 0, (LONG)RenderResolutionY - ProgressBarHeight, ProgressBarWidth, (LONG)RenderResolutionY };
+		pCmd->ClearRenderTargetView(rtvHandle, ProgressBarColor, 1, &rectProgressBar);
+	}
+
 	pCmd->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pSwapChainRT
 		, D3D12_RESOURCE_STATE_RENDER_TARGET
 		, D3D12_RESOURCE_STATE_PRESENT)
@@ -1017,7 +1077,7 @@ HRESULT VQEngine::RenderThread_RenderMainWindow_Scene(FWindowRenderContext& ctx)
 	const int NUM_BACK_BUFFERS              = ctx.GetNumSwapchainBuffers();
 	const int BACK_BUFFER_INDEX             = ctx.GetCurrentSwapchainBufferIndex();
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int FRAME_DATA_INDEX              = mNumRenderLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX              = mIndex_FrameSnapshot_Render;
 #else
 	const int FRAME_DATA_INDEX = 0;
 #endif
@@ -1056,8 +1116,8 @@ HRESULT VQEngine::RenderThread_RenderMainWindow_Scene(FWindowRenderContext& ctx)
 			RefPPParams.bEnableFSR = false;
 #if 0
 			// this causes UI pass PSO to not match the render target format
-			mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<WindowResizeEvent>(W, H, mpWinMain->GetHWND()));
-			mEventQueue_WinToVQE_Update.AddItem(std::make_unique<WindowResizeEvent>(W, H, mpWinMain->GetHWND()));
+			mEventQueue_WinToVQE_Renderer.Push(WindowResizeEvent(W, H, mpWinMain->GetHWND()));
+			mEventQueue_WinToVQE_Update.Push(WindowResizeEvent(W, H, mpWinMain->GetHWND()));
 #endif
 		}
 	}
@@ -32,29 +32,23 @@
 //
 // DRAW COMMANDS
 //
-void VQEngine::DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh)
+void VQEngine::DrawMesh(HAL::CommandList& Cmd, const Mesh& mesh)
 {
 	SCOPED_CPU_MARKER("DrawMesh");
-	using namespace DirectX;
-	const bool& bMSAA = mSettings.gfx.bAntiAliasing;
 
 	// Draw Object -----------------------------------------------
 	const auto VBIBIDs = mesh.GetIABufferIDs();
 	const uint32 NumIndices = mesh.GetNumIndices();
 	const uint32 NumInstances = 1;
-	const BufferID& VB_ID = VBIBIDs.first;
-	const BufferID& IB_ID = VBIBIDs.second;
-	const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
-	const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
 
-	pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	pCmd->IASetVertexBuffers(0, 1, &vb);
-	pCmd->IASetIndexBuffer(&ib);
+	Cmd.SetPrimitiveTopology(HAL::EPrimitiveTopology::TRIANGLE_LIST);
+	Cmd.SetVertexBuffer(VBIBIDs.first);
+	Cmd.SetIndexBuffer(VBIBIDs.second);
 
-	pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+	Cmd.DrawIndexedInstanced(NumIndices, NumInstances);
 }
 
-void VQEngine::DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView)
+void VQEngine::DrawShadowViewMeshList(HAL::CommandList& Cmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView)
 {
 	using namespace DirectX;
 	struct FCBufferLightVS
@@ -63,19 +57,26 @@ void VQEngine::DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBu
 		XMMATRIX matWorld;
 	};
 
-	for (const FShadowMeshRenderCommand& renderCmd : shadowView.meshRenderCommands)
+	// set constant buffer data: one allocation for the whole view, the draws are skipped if it fails
+	ConstantBufferArray<FCBufferLightVS> CBuffers;
+	size_t NumMeshDraws = shadowView.meshRenderCommands.size();
+	if (NumMeshDraws > 0 && !pCBufferHeap->AllocConstantBufferArray(static_cast<uint32_t>(NumMeshDraws), CBuffers))
+	{
+		Log::Warning("DrawShadowViewMeshList(): couldn't allocate the constant buffers, skipping %zu draws", NumMeshDraws);
+		NumMeshDraws = 0;
+	}
+
+	for (size_t iCmd = 0; iCmd < NumMeshDraws; ++iCmd)
 	{
 		SCOPED_CPU_MARKER("Process_ShadowMeshRenderCommand");
-		// set constant buffer data
-		FCBufferLightVS* pCBuffer = {};
-		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
-		pCBufferHeap->AllocConstantBuffer(sizeof(decltype(pCBuffer)), (void**)(&pCBuffer), &cbAddr);
-		pCBuffer->matWorldViewProj = renderCmd.matWorldViewProj;
-		pCBuffer->matWorld = renderCmd.matWorldTransformation;
-		pCmd->SetGraphicsRootConstantBufferView(0, cbAddr);
+		const FShadowMeshRenderCommand& renderCmd = shadowView.meshRenderCommands[iCmd];
+		FCBufferLightVS& CBuffer = CBuffers[iCmd];
+		CBuffer.matWorldViewProj = renderCmd.matWorldViewProj;
+		CBuffer.matWorld = renderCmd.matWorldTransformation;
+		Cmd.SetGraphicsRootConstantBufferView(0, CBuffers.GetGPUAddress(iCmd));
 
 		const Mesh& mesh = mpScene->mMeshes.at(renderCmd.meshID);
-		DrawMesh(pCmd, mesh);
+		DrawMesh(Cmd, mesh);
 	}
 }
 
@@ -92,8 +93,9 @@ void VQEngine::RenderDirectionalShadowMaps(ID3D12GraphicsCommandList* pCmd, Dyna
 		const std::string marker = "Directional";
 		SCOPED_GPU_MARKER(pCmd, marker.c_str());
 
-		pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_PSO));
-		pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(7));
+		HAL::D3D12CommandList Cmd(pCmd, mRenderer);
+		Cmd.SetPipelineState(EBuiltinPSOs::DEPTH_PASS_PSO);
+		Cmd.SetGraphicsRootSignature(7);
 
 		const float RenderResolutionX = 2048.0f; // TODO
 		const float RenderResolutionY = 2048.0f; // TODO
@@ -113,7 +115,7 @@ void VQEngine::RenderDirectionalShadowMaps(ID3D12GraphicsCommandList* pCmd, Dyna
 			pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
 		}
 
-		DrawShadowViewMeshList(pCmd, pCBufferHeap, SceneShadowView.ShadowView_Directional);
+		DrawShadowViewMeshList(Cmd, pCBufferHeap, SceneShadowView.ShadowView_Directional);
 	}
 }
 void VQEngine::RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& SceneShadowView)
@@ -136,8 +138,9 @@ void VQEngine::RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuff
 	//
 	// SPOT LIGHTS
 	//
-	pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_PSO));
-	pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(7));
+	HAL::D3D12CommandList Cmd(pCmd, mRenderer);
+	Cmd.SetPipelineState(EBuiltinPSOs::DEPTH_PASS_PSO);
+	Cmd.SetGraphicsRootSignature(7);
 	
 	for (uint i = 0; i < SceneShadowView.NumSpotShadowViews; ++i)
 	{
@@ -157,7 +160,7 @@ void VQEngine::RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuff
 		D3D12_CLEAR_FLAGS DSVClearFlags = D3D12_CLEAR_FLAGS::D3D12_CLEAR_FLAG_DEPTH;
 		pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
 
-		DrawShadowViewMeshList(pCmd, pCBufferHeap, ShadowView);
+		DrawShadowViewMeshList(Cmd, pCBufferHeap, ShadowView);
 	}
 }
 void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& SceneShadowView, size_t iBegin, size_t NumPointLights)
@@ -183,8 +186,9 @@ void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuf
 	pCmd->RSSetScissorRects(1, &scissorsRect);
 #endif
 
-	pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_LINEAR_PSO));
-	pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(8));
+	HAL::D3D12CommandList Cmd(pCmd, mRenderer);
+	Cmd.SetPipelineState(EBuiltinPSOs::DEPTH_PASS_LINEAR_PSO);
+	Cmd.SetGraphicsRootSignature(8);
 	for (size_t i = iBegin; i < iBegin + NumPointLights; ++i)
 	{
 		const std::string marker = "Point[" + std::to_string(i) + "]";
@@ -196,7 +200,7 @@ void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuf
 
 		pCBuffer->vLightPos = SceneShadowView.PointLightLinearDepthParams[i].vWorldPos;
 		pCBuffer->fFarPlane = SceneShadowView.PointLightLinearDepthParams[i].fFarPlane;
-		pCmd->SetGraphicsRootConstantBufferView(1, cbAddr);
+		Cmd.SetGraphicsRootConstantBufferView(1, cbAddr);
 
 		for (size_t face = 0; face < 6; ++face)
 		{
@@ -217,7 +221,7 @@ void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuf
 			pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
 
 			// draw render list
-			DrawShadowViewMeshList(pCmd, pCBufferHeap, ShadowView);
+			DrawShadowViewMeshList(Cmd, pCBufferHeap, ShadowView);
 		}
 	}
 }
@@ -264,53 +268,47 @@ void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBuffer
 	pCmd->RSSetViewports(1, &viewport);
 	pCmd->RSSetScissorRects(1, &scissorsRect);
 
-	pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA ? EBuiltinPSOs::DEPTH_PREPASS_PSO_MSAA_4 : EBuiltinPSOs::DEPTH_PREPASS_PSO));
-	pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(14)); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
+	HAL::D3D12CommandList Cmd(pCmd, mRenderer);
+	Cmd.SetPipelineState(EBuiltinPSOs::DEPTH_PREPASS_PSO, bMSAA ? PSO_FEATURE_MSAA_4 : 0);
+	Cmd.SetGraphicsRootSignature(14); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
+
+	// per-object constants for the whole view in one allocation, the draws are skipped if it fails
+	ConstantBufferArray<PerObjectData> PerObjs;
+	size_t NumMeshDraws = SceneView.meshRenderCommands.size();
+	if (NumMeshDraws > 0 && !pCBufferHeap->AllocConstantBufferArray(static_cast<uint32_t>(NumMeshDraws), PerObjs))
+	{
+		Log::Warning("DepthPrePass: couldn't allocate the per-object constant buffers, skipping %zu draws", NumMeshDraws);
+		NumMeshDraws = 0;
+	}
 
 	// draw meshes
-	for (const FMeshRenderCommand& meshRenderCmd : SceneView.meshRenderCommands)
+	for (size_t iCmd = 0; iCmd < NumMeshDraws; ++iCmd)
 	{
+		const FMeshRenderCommand& meshRenderCmd = SceneView.meshRenderCommands[iCmd];
 		if (mpScene->mMeshes.find(meshRenderCmd.meshID) == mpScene->mMeshes.end())
 		{
 			Log::Warning("MeshID=%d couldn't be found", meshRenderCmd.meshID);
 			continue; // skip drawing this mesh
 		}
 
-		const Material& mat = mpScene->GetMaterial(meshRenderCmd.matID);
 		const Mesh& mesh = mpScene->mMeshes.at(meshRenderCmd.meshID);
-		const auto VBIBIDs = mesh.GetIABufferIDs();
-		const uint32 NumIndices = mesh.GetNumIndices();
-		const uint32 NumInstances = 1;
-		const BufferID& VB_ID = VBIBIDs.first;
-		const BufferID& IB_ID = VBIBIDs.second;
-		const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
-		const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
-
 
 		// set constant buffer data
-		PerObjectData* pPerObj = {};
-		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
-		pCBufferHeap->AllocConstantBuffer(sizeof(decltype(pPerObj)), (void**)(&pPerObj), &cbAddr);
+		PerObjectData& PerObj = PerObjs[iCmd];
+		PerObj.matWorldViewProj = meshRenderCmd.matWorldTransformation * SceneView.viewProj;
+		PerObj.matWorld = meshRenderCmd.matWorldTransformation;
+		PerObj.matNormal = meshRenderCmd.matNormalTransformation;
+		PerObj.materialData = meshRenderCmd.matData;
 
-		pPerObj->matWorldViewProj = meshRenderCmd.matWorldTransformation * SceneView.viewProj;
-		pPerObj->matWorld = meshRenderCmd.matWorldTransformation;
-		pPerObj->matNormal = meshRenderCmd.matNormalTransformation;
-		pPerObj->materialData = std::move(mat.GetCBufferData());
-
-		pCmd->SetGraphicsRootConstantBufferView(1, cbAddr);
+		Cmd.SetGraphicsRootConstantBufferView(1, PerObjs.GetGPUAddress(iCmd));
 
 		// set textures
-		if (mat.SRVMaterialMaps != INVALID_ID)
+		if (meshRenderCmd.matSRV != INVALID_ID)
 		{
-			pCmd->SetGraphicsRootDescriptorTable(0, mRenderer.GetSRV(mat.SRVMaterialMaps).GetGPUDescHandle(0));
-			//pCmd->SetGraphicsRootDescriptorTable(4, mRenderer.GetSRV(mat.SRVMaterialMaps).GetGPUDescHandle(0));
+			Cmd.SetGraphicsRootDescriptorTable(0, meshRenderCmd.matSRV);
 		}
 
-		pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		pCmd->IASetVertexBuffers(0, 1, &vb);
-		pCmd->IASetIndexBuffer(&ib);
-
-		pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+		DrawMesh(Cmd, mesh);
 	}
 
 	// resolve if MSAA
@@ -484,14 +482,12 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	pCmd->RSSetViewports(1, &viewport);
 	pCmd->RSSetScissorRects(1, &scissorsRect);
 
-	pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA ? EBuiltinPSOs::FORWARD_LIGHTING_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_PSO));
-	pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(5)); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
+	HAL::D3D12CommandList Cmd(pCmd, mRenderer);
+	Cmd.SetPipelineState(EBuiltinPSOs::FORWARD_LIGHTING_PSO, bMSAA ? PSO_FEATURE_MSAA_4 : 0);
+	Cmd.SetGraphicsRootSignature(5); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
 
 	// set PerFrame constants
 	{
-		const CBV_SRV_UAV& NullCubemapSRV = mRenderer.GetSRV(mResources_MainWnd.SRV_NullCubemap);
-		const CBV_SRV_UAV& NullTex2DSRV   = mRenderer.GetSRV(mResources_MainWnd.SRV_NullTexture2D);
-
 		constexpr UINT PerFrameRSBindSlot = 3;
 		PerFrameData* pPerFrame = {};
 		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
@@ -511,24 +507,14 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 			pPerFrame->fAmbientLightingFactor *= 0.005f;
 		}
 
-		//pCmd->SetGraphicsRootDescriptorTable(PerFrameRSBindSlot, );
-		pCmd->SetGraphicsRootConstantBufferView(PerFrameRSBindSlot, cbAddr);
-		pCmd->SetGraphicsRootDescriptorTable(4, mRenderer.GetSRV(mResources_MainWnd.SRV_ShadowMaps_Spot).GetGPUDescHandle(0));
-		pCmd->SetGraphicsRootDescriptorTable(5, mRenderer.GetSRV(mResources_MainWnd.SRV_ShadowMaps_Point).GetGPUDescHandle(0));
-		pCmd->SetGraphicsRootDescriptorTable(6, mRenderer.GetSRV(mResources_MainWnd.SRV_ShadowMaps_Directional).GetGPUDescHandle(0));
-		pCmd->SetGraphicsRootDescriptorTable(7, bDrawEnvironmentMap
-			? mRenderer.GetSRV(mResources_MainWnd.EnvironmentMap.SRV_IrradianceDiffBlurred).GetGPUDescHandle(0)
-			: NullCubemapSRV.GetGPUDescHandle()
-		);
-		pCmd->SetGraphicsRootDescriptorTable(8, bDrawEnvironmentMap
-			? mRenderer.GetSRV(mResources_MainWnd.EnvironmentMap.SRV_IrradianceSpec).GetGPUDescHandle(0)
-			: NullCubemapSRV.GetGPUDescHandle()
-		);
-		pCmd->SetGraphicsRootDescriptorTable(9, bDrawEnvironmentMap
-			? mRenderer.GetSRV(mResources_MainWnd.EnvironmentMap.SRV_BRDFIntegrationLUT).GetGPUDescHandle()
-			: NullTex2DSRV.GetGPUDescHandle()
-		);
-		pCmd->SetGraphicsRootDescriptorTable(10, mRenderer.GetSRV(mResources_MainWnd.SRV_FFXCACAO_Out).GetGPUDescHandle());
+		Cmd.SetGraphicsRootConstantBufferView(PerFrameRSBindSlot, cbAddr);
+		Cmd.SetGraphicsRootDescriptorTable(4, mResources_MainWnd.SRV_ShadowMaps_Spot);
+		Cmd.SetGraphicsRootDescriptorTable(5, mResources_MainWnd.SRV_ShadowMaps_Point);
+		Cmd.SetGraphicsRootDescriptorTable(6, mResources_MainWnd.SRV_ShadowMaps_Directional);
+		Cmd.SetGraphicsRootDescriptorTable(7, bDrawEnvironmentMap ? mResources_MainWnd.EnvironmentMap.SRV_IrradianceDiffBlurred : mResources_MainWnd.SRV_NullCubemap);
+		Cmd.SetGraphicsRootDescriptorTable(8, bDrawEnvironmentMap ? mResources_MainWnd.EnvironmentMap.SRV_IrradianceSpec        : mResources_MainWnd.SRV_NullCubemap);
+		Cmd.SetGraphicsRootDescriptorTable(9, bDrawEnvironmentMap ? mResources_MainWnd.EnvironmentMap.SRV_BRDFIntegrationLUT    : mResources_MainWnd.SRV_NullTexture2D);
+		Cmd.SetGraphicsRootDescriptorTable(10, mResources_MainWnd.SRV_FFXCACAO_Out);
 	}
 
 	// set PerView constants
@@ -545,8 +531,7 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 
 		// TODO: PreView data
 
-		//pCmd->SetGraphicsRootDescriptorTable(PerViewRSBindSlot, D3D12_GPU_DESCRIPTOR_HANDLE{ cbAddr });
-		pCmd->SetGraphicsRootConstantBufferView(PerViewRSBindSlot, cbAddr);
+		Cmd.SetGraphicsRootConstantBufferView(PerViewRSBindSlot, cbAddr);
 	}
 
 
@@ -556,29 +541,32 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 		constexpr UINT PerObjRSBindSlot = 1;
 		SCOPED_GPU_MARKER(pCmd, "Geometry");
 
-		for (const FMeshRenderCommand& meshRenderCmd : SceneView.meshRenderCommands)
+		// per-object constants for the whole view in one allocation, the draws are skipped if it fails
+		ConstantBufferArray<PerObjectData> PerObjs;
+		size_t NumMeshDraws = SceneView.meshRenderCommands.size();
+		if (NumMeshDraws > 0 && !pCBufferHeap->AllocConstantBufferArray(static_cast<uint32_t>(NumMeshDraws), PerObjs))
 		{
-			const Material& mat = mpScene->GetMaterial(meshRenderCmd.matID);
-
-			// set constant buffer data
-			PerObjectData* pPerObj = {};
-			D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
-			pCBufferHeap->AllocConstantBuffer(sizeof(decltype(pPerObj)), (void**)(&pPerObj), &cbAddr);
+			Log::Warning("Geometry: couldn't allocate the per-object constant buffers, skipping %zu draws", NumMeshDraws);
+			NumMeshDraws = 0;
+		}
 
+		for (size_t iCmd = 0; iCmd < NumMeshDraws; ++iCmd)
+		{
+			const FMeshRenderCommand& meshRenderCmd = SceneView.meshRenderCommands[iCmd];
 
-			pPerObj->matWorldViewProj = meshRenderCmd.matWorldTransformation * SceneView.viewProj;
-			pPerObj->matWorld         = meshRenderCmd.matWorldTransformation;
-			pPerObj->matNormal        = meshRenderCmd.matNormalTransformation;
-			pPerObj->materialData = std::move(mat.GetCBufferData());
+			// set constant buffer data
+			PerObjectData& PerObj = PerObjs[iCmd];
+			PerObj.matWorldViewProj = meshRenderCmd.matWorldTransformation * SceneView.viewProj;
+			PerObj.matWorld         = meshRenderCmd.matWorldTransformation;
+			PerObj.matNormal        = meshRenderCmd.matNormalTransformation;
+			PerObj.materialData     = meshRenderCmd.matData;
 
-			pCmd->SetGraphicsRootConstantBufferView(PerObjRSBindSlot, cbAddr);
+			Cmd.SetGraphicsRootConstantBufferView(PerObjRSBindSlot, PerObjs.GetGPUAddress(iCmd));
 
 			// set textures
-			if (mat.SRVMaterialMaps != INVALID_ID)
+			if (meshRenderCmd.matSRV != INVALID_ID)
 			{
-				pCmd->SetGraphicsRootDescriptorTable(0, mRenderer.GetSRV(mat.SRVMaterialMaps).GetGPUDescHandle(0));
-				//pCmd->SetGraphicsRootDescriptorTable(4, mRenderer.GetSRV(mat.SRVMaterialMaps).GetGPUDescHandle(0));
-
+				Cmd.SetGraphicsRootDescriptorTable(0, meshRenderCmd.matSRV);
 			}
 
 			// draw mesh
@@ -589,20 +577,7 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 			}
 
 			const Mesh& mesh = mpScene->mMeshes.at(meshRenderCmd.meshID);
-
-			const auto VBIBIDs = mesh.GetIABufferIDs();
-			const uint32 NumIndices = mesh.GetNumIndices();
-			const uint32 NumInstances = 1;
-			const BufferID& VB_ID = VBIBIDs.first;
-			const BufferID& IB_ID = VBIBIDs.second;
-			const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
-			const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
-
-			pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			pCmd->IASetVertexBuffers(0, 1, &vb);
-			pCmd->IASetIndexBuffer(&ib);
-
-			pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+			DrawMesh(Cmd, mesh);
 		}
 	}
 
@@ -610,12 +585,9 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	if(!SceneView.lightBoundsRenderCommands.empty())
 	{
 		SCOPED_GPU_MARKER(pCmd, "LightBounds");
-		pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA 
-			? EBuiltinPSOs::WIREFRAME_PSO_MSAA_4 
-			: EBuiltinPSOs::WIREFRAME_PSO)
-		);
+		Cmd.SetPipelineState(EBuiltinPSOs::WIREFRAME_PSO, bMSAA ? PSO_FEATURE_MSAA_4 : 0);
 
-		pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(6)); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
+		Cmd.SetGraphicsRootSignature(6); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
 		for (const FLightRenderCommand& lightBoundRenderCmd : SceneView.lightBoundsRenderCommands)
 		{
 			// set constant buffer data
@@ -624,25 +596,11 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 			pCBufferHeap->AllocConstantBuffer(sizeof(decltype(pCBuffer)), (void**)(&pCBuffer), &cbAddr);
 			pCBuffer->color            = lightBoundRenderCmd.color;
 			pCBuffer->matModelViewProj = lightBoundRenderCmd.matWorldTransformation * SceneView.viewProj;
-			pCmd->SetGraphicsRootConstantBufferView(0, cbAddr);
+			Cmd.SetGraphicsRootConstantBufferView(0, cbAddr);
 
-			// set IA
+			// set IA & draw
 			const Mesh& mesh = mpScene->mMeshes.at(lightBoundRenderCmd.meshID);
-
-			const auto VBIBIDs = mesh.GetIABufferIDs();
-			const uint32 NumIndices = mesh.GetNumIndices();
-			const uint32 NumInstances = 1;
-			const BufferID& VB_ID = VBIBIDs.first;
-			const BufferID& IB_ID = VBIBIDs.second;
-			const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
-			const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
-
-			pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			pCmd->IASetVertexBuffers(0, 1, &vb);
-			pCmd->IASetIndexBuffer(&ib);
-
-			// draw
-			pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+			DrawMesh(Cmd, mesh);
 		}
 	}
 
@@ -650,12 +608,8 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	if(!SceneView.lightRenderCommands.empty())
 	{
 		SCOPED_GPU_MARKER(pCmd, "Lights");
-		pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA
-			? EBuiltinPSOs::UNLIT_PSO_MSAA_4
-			: EBuiltinPSOs::UNLIT_PSO)
-		);
-		if(SceneView.lightBoundsRenderCommands.empty())
-			pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(6)); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
+		Cmd.SetPipelineState(EBuiltinPSOs::UNLIT_PSO, bMSAA ? PSO_FEATURE_MSAA_4 : 0);
+		Cmd.SetGraphicsRootSignature(6); // filtered out if the light bounds have already bound it
 
 		for (const FLightRenderCommand& lightRenderCmd : SceneView.lightRenderCommands)
 		{
@@ -665,25 +619,11 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 			pCBufferHeap->AllocConstantBuffer(sizeof(decltype(pCBuffer)), (void**)(&pCBuffer), &cbAddr);
 			pCBuffer->color            = lightRenderCmd.color;
 			pCBuffer->matModelViewProj = lightRenderCmd.matWorldTransformation * SceneView.viewProj;
-			pCmd->SetGraphicsRootConstantBufferView(0, cbAddr);
+			Cmd.SetGraphicsRootConstantBufferView(0, cbAddr);
 
-			// set IA
+			// set IA & draw
 			const Mesh& mesh = mpScene->mMeshes.at(lightRenderCmd.meshID);
-
-			const auto VBIBIDs = mesh.GetIABufferIDs();
-			const uint32 NumIndices = mesh.GetNumIndices();
-			const uint32 NumInstances = 1;
-			const BufferID& VB_ID = VBIBIDs.first;
-			const BufferID& IB_ID = VBIBIDs.second;
-			const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
-			const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
-
-			pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			pCmd->IASetVertexBuffers(0, 1, &vb);
-			pCmd->IASetIndexBuffer(&ib);
-
-			// draw
-			pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+			DrawMesh(Cmd, mesh);
 		}
 	}
 
@@ -692,11 +632,8 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	{
 		SCOPED_GPU_MARKER(pCmd, "BoundingBoxes");
 
-		pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA
-			? EBuiltinPSOs::WIREFRAME_PSO_MSAA_4
-			: EBuiltinPSOs::WIREFRAME_PSO)
-		);
-		pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(6)); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
+		Cmd.SetPipelineState(EBuiltinPSOs::WIREFRAME_PSO, bMSAA ? PSO_FEATURE_MSAA_4 : 0);
+		Cmd.SetGraphicsRootSignature(6); // hardcoded root signature for now until shader reflection and rootsignature management is implemented
 
 
 		// set IA
@@ -705,14 +642,10 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 		const auto VBIBIDs = mesh.GetIABufferIDs();
 		const uint32 NumIndices = mesh.GetNumIndices();
 		const uint32 NumInstances = 1;
-		const BufferID& VB_ID = VBIBIDs.first;
-		const BufferID& IB_ID = VBIBIDs.second;
-		const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
-		const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
 
-		pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		pCmd->IASetVertexBuffers(0, 1, &vb);
-		pCmd->IASetIndexBuffer(&ib);
+		Cmd.SetPrimitiveTopology(HAL::EPrimitiveTopology::TRIANGLE_LIST);
+		Cmd.SetVertexBuffer(VBIBIDs.first);
+		Cmd.SetIndexBuffer(VBIBIDs.second);
 
 		for(const FBoundingBoxRenderCommand& BBRenderCmd: SceneView.boundingBoxRenderCommands)
 		{
@@ -722,8 +655,8 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 			pCBufferHeap->AllocConstantBuffer(sizeof(decltype(pCBuffer)), (void**)(&pCBuffer), &cbAddr);
 			pCBuffer->color = BBRenderCmd.color;
 			pCBuffer->matModelViewProj = BBRenderCmd.matWorldTransformation * SceneView.viewProj;
-			pCmd->SetGraphicsRootConstantBufferView(0, cbAddr);
-			pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+			Cmd.SetGraphicsRootConstantBufferView(0, cbAddr);
+			Cmd.DrawIndexedInstanced(NumIndices, NumInstances);
 		}
 	}
 
@@ -734,32 +667,21 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 
 		ID3D12DescriptorHeap* ppHeaps[] = { mRenderer.GetDescHeap(EResourceHeapType::CBV_SRV_UAV_HEAP) };
 
-		Camera skyCam = mpScene->GetActiveCamera().Clone();
-		FCameraParameters p = {};
-		p.bInitializeCameraController = false;
-		p.ProjectionParams = skyCam.GetProjectionParameters();
-		p.ProjectionParams.bPerspectiveProjection = true;
-		p.ProjectionParams.FieldOfView = p.ProjectionParams.FieldOfView * RAD2DEG; // TODO: remove the need for this conversion
-		p.x = p.y = p.z = 0;
-		p.Yaw   = SceneView.MainViewCameraYaw   * RAD2DEG;
-		p.Pitch = SceneView.MainViewCameraPitch * RAD2DEG;
-		skyCam.InitializeCamera(p);
-
 		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
 		FFrameConstantBuffer * pConstBuffer = {};
 		pCBufferHeap->AllocConstantBuffer(sizeof(FFrameConstantBuffer ), (void**)(&pConstBuffer), &cbAddr);
-		pConstBuffer->matModelViewProj = skyCam.GetViewMatrix() * skyCam.GetProjectionMatrix();
+		pConstBuffer->matModelViewProj = SceneView.environmentMapViewProj;
 
-		pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA ? EBuiltinPSOs::SKYDOME_PSO_MSAA_4 : EBuiltinPSOs::SKYDOME_PSO));
+		Cmd.SetPipelineState(EBuiltinPSOs::SKYDOME_PSO, bMSAA ? PSO_FEATURE_MSAA_4 : 0);
 
 		// hardcoded root signature for now until shader reflection and rootsignature management is implemented
-		pCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(2));
+		Cmd.SetGraphicsRootSignature(2);
 
 		pCmd->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-		pCmd->SetGraphicsRootDescriptorTable(0, mRenderer.GetSRV(mResources_MainWnd.EnvironmentMap.SRV_HDREnvironment).GetGPUDescHandle());
-		pCmd->SetGraphicsRootConstantBufferView(1, cbAddr);
+		Cmd.SetGraphicsRootDescriptorTable(0, mResources_MainWnd.EnvironmentMap.SRV_HDREnvironment);
+		Cmd.SetGraphicsRootConstantBufferView(1, cbAddr);
 
-		DrawMesh(pCmd, mBuiltinMeshes[EBuiltInMeshes::CUBE]);
+		DrawMesh(Cmd, mBuiltinMeshes[EBuiltInMeshes::CUBE]);
 	}
 }
 
@@ -1178,7 +1100,12 @@ void VQEngine::RenderUI(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBu
 		const float clearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 		pCmd->ClearRenderTargetView(rtvHandle, clearColor, 0, NULL);
 	}
-#if !VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const FUIDrawData& UIDrawData = mUIDrawData[mIndex_FrameSnapshot_Render];
+#else
+	const FUIDrawData& UIDrawData = mUIDrawData[0];
+#endif
+	if (!UIDrawData.IsEmpty())
 	{
 		SCOPED_GPU_MARKER(pCmd, "UI");
 
@@ -1187,32 +1114,17 @@ void VQEngine::RenderUI(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBu
 			float matTransformation[4][4];
 		};
 
-		ImGuiIO& io = ImGui::GetIO();
-
-		ImGui::Render();
-
-		ImDrawData* draw_data = ImGui::GetDrawData();
-
-		// Create and grow vertex/index buffers if needed
+		// copy the draw lists of the frame into the upload heap
 		char* pVertices = NULL;
 		D3D12_VERTEX_BUFFER_VIEW VerticesView;
-
-		pCBufferHeap->AllocVertexBuffer(draw_data->TotalVtxCount, sizeof(ImDrawVert), (void**)&pVertices, &VerticesView);
+		pCBufferHeap->AllocVertexBuffer(static_cast<uint32_t>(UIDrawData.Vertices.size()), sizeof(ImDrawVert), (void**)&pVertices, &VerticesView);
 
 		char* pIndices = NULL;
 		D3D12_INDEX_BUFFER_VIEW IndicesView;
-		pCBufferHeap->AllocIndexBuffer(draw_data->TotalIdxCount, sizeof(ImDrawIdx), (void**)&pIndices, &IndicesView);
+		pCBufferHeap->AllocIndexBuffer(static_cast<uint32_t>(UIDrawData.Indices.size()), sizeof(ImDrawIdx), (void**)&pIndices, &IndicesView);
 
-		ImDrawVert* vtx_dst = (ImDrawVert*)pVertices;
-		ImDrawIdx* idx_dst = (ImDrawIdx*)pIndices;
-		for (int n = 0; n < draw_data->CmdListsCount; n++)
-		{
-			const ImDrawList* cmd_list = draw_data->CmdLists[n];
-			memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-			memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-			vtx_dst += cmd_list->VtxBuffer.Size;
-			idx_dst += cmd_list->IdxBuffer.Size;
-		}
+		memcpy(pVertices, UIDrawData.Vertices.data(), UIDrawData.Vertices.size() * sizeof(ImDrawVert));
+		memcpy(pIndices , UIDrawData.Indices.data() , UIDrawData.Indices.size()  * sizeof(ImDrawIdx));
 
 		// Setup orthographic projection matrix into our constant buffer
 		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
@@ -1221,8 +1133,8 @@ void VQEngine::RenderUI(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBu
 			pCBufferHeap->AllocConstantBuffer(sizeof(cb), (void**)&constant_buffer, &cbAddr);
 
 			float L = 0.0f;
-			float R = io.DisplaySize.x;
-			float B = io.DisplaySize.y;
+			float R = UIDrawData.DisplaySize.x;
+			float B = UIDrawData.DisplaySize.y;
 			float T = 0.0f;
 			float proj[4][4] =
 			{
@@ -1237,8 +1149,8 @@ void VQEngine::RenderUI(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBu
 		// Setup viewport
 		D3D12_VIEWPORT vp;
 		memset(&vp, 0, sizeof(D3D12_VIEWPORT));
-		vp.Width = io.DisplaySize.x;
-		vp.Height = io.DisplaySize.y;
+		vp.Width = UIDrawData.DisplaySize.x;
+		vp.Height = UIDrawData.DisplaySize.y;
 		vp.MinDepth = 0.0f;
 		vp.MaxDepth = 1.0f;
 		vp.TopLeftX = vp.TopLeftY = 0.0f;
@@ -1256,38 +1168,21 @@ void VQEngine::RenderUI(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBu
 		pCmd->SetGraphicsRootConstantBufferView(1, cbAddr);
 
 		// Render command lists
-		int vtx_offset = 0;
-		int idx_offset = 0;
-		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		for (const FUIDrawCommand& drawCmd : UIDrawData.Commands)
 		{
-			const ImDrawList* drawList = draw_data->CmdLists[n];
-			for (int cmd_i = 0; cmd_i < drawList->CmdBuffer.Size; cmd_i++)
+			const D3D12_RECT r =
 			{
-				const ImDrawCmd* pcmd = &drawList->CmdBuffer[cmd_i];
-				if (pcmd->UserCallback)
-				{
-					pcmd->UserCallback(drawList, pcmd);
-				}
-				else
-				{
-					const D3D12_RECT r =
-					{
-						(LONG)pcmd->ClipRect.x,
-						(LONG)pcmd->ClipRect.y,
-						(LONG)pcmd->ClipRect.z,
-						(LONG)pcmd->ClipRect.w
-					};
-					pCmd->RSSetScissorRects(1, &r);
-					pCmd->SetGraphicsRootDescriptorTable(0, ((CBV_SRV_UAV*)(pcmd->TextureId))->GetGPUDescHandle());
+				(LONG)drawCmd.ClipRect.x,
+				(LONG)drawCmd.ClipRect.y,
+				(LONG)drawCmd.ClipRect.z,
+				(LONG)drawCmd.ClipRect.w
+			};
+			pCmd->RSSetScissorRects(1, &r);
+			pCmd->SetGraphicsRootDescriptorTable(0, ((CBV_SRV_UAV*)(drawCmd.TextureId))->GetGPUDescHandle());
 
-					pCmd->DrawIndexedInstanced(pcmd->ElemCount, 1, idx_offset, vtx_offset, 0);
-				}
-				idx_offset += pcmd->ElemCount;
-			}
-			vtx_offset += drawList->VtxBuffer.Size;
+			pCmd->DrawIndexedInstanced(drawCmd.ElemCount, 1, drawCmd.IndexOffset, drawCmd.VertexOffset, 0);
 		}
 	}
-#endif
 
 	if(!bHDR)
 	{
@@ -1393,6 +1288,7 @@ HRESULT VQEngine::PresentFrame(FWindowRenderContext& ctx)
 	{
 		SCOPED_CPU_MARKER("ExecuteCommandLists()");
 		PresentQueue.pQueue->ExecuteCommandLists(NumCommandLists, (ID3D12CommandList**)vCmdLists.data());
+		mRenderer.SignalFrameSubmitted(PresentQueue.pQueue);
 	}
 	{
 		SCOPED_CPU_MARKER("SwapchainPresent");
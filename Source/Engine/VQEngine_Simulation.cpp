@@ -36,6 +36,7 @@
 void VQEngine::SimulationThread_Main()
 {
 	Log::Info("SimulationThread Created.");
+	Profiler::SetThreadName("SimulationThread");
 
 	SimulationThread_Initialize();
 
@@ -44,10 +45,13 @@ void VQEngine::SimulationThread_Main()
 	while (!mbStopAllThreads && !bQuit)
 	{
 		dt = mTimer.Tick(); // update timer
+		Profiler::Counter("SimulationThread dt (ms)", dt * 1000.0f);
+		if (mBenchmark.IsEnabled())
+			dt = mBenchmark.GetFixedTimestep(); // reproducible simulation regardless of the frame times
 
 		SimulationThread_Tick(dt);
 
-		float FrameLimiterTimeSpent = FramePacing(dt);
+		float FrameLimiterTimeSpent = FramePacing();
 
 		// SimulationThread_Logging()
 		constexpr int LOGGING_PERIOD = 4; // seconds
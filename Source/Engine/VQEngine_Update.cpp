@@ -34,10 +34,14 @@
 
 using namespace DirectX;
 
+// CPU time per frame given to the scene load stages on the update thread, keeps the loading screen responsive
+constexpr float SCENE_LOAD_TIME_BUDGET_SECONDS = 0.008f;
+
 
 void VQEngine::UpdateThread_Main()
 {
 	Log::Info("UpdateThread Created.");
+	Profiler::SetThreadName("UpdateThread");
 
 	UpdateThread_Inititalize();
 
@@ -46,6 +50,9 @@ void VQEngine::UpdateThread_Main()
 	while (!mbStopAllThreads && !bQuit)
 	{
 		dt = mTimer.Tick(); // update timer
+		Profiler::Counter("UpdateThread dt (ms)", dt * 1000.0f);
+		if (mBenchmark.IsEnabled())
+			dt = mBenchmark.GetFixedTimestep(); // reproducible simulation regardless of the frame times
 
 		UpdateThread_Tick(dt);
 
@@ -93,11 +100,16 @@ void VQEngine::UpdateThread_Tick(const float dt)
 	SCOPED_CPU_MARKER_C("UpdateThread_Tick()", 0xFF000077);
 
 	dt_RenderWaitTime = UpdateThread_WaitForRenderThread();
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	if (mIndex_FrameSnapshot_Update == FrameSnapshotRing::INVALID_SLOT)
+		return; // exiting
+#endif
 
-	UpdateThread_HandleEvents();
-
+	// the events write into the frame data after the persistent parameters are carried over
 	UpdateThread_PreUpdate();
 
+	UpdateThread_HandleEvents();
+
 #if DEBUG_LOG_THREAD_SYNC_VERBOSE
 	Log::Info(/*"UpdateThread_Tick() : */"u%d (r=%llu)", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
 #endif
@@ -106,7 +118,15 @@ void VQEngine::UpdateThread_Tick(const float dt)
 
 	UpdateThread_PostUpdate();
 
+	MemoryTracking::Tick(dt);
+
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	// the UI is updated in the same snapshot as the scene, SimulationThread_Tick() does it in the serial mode
+	if (!(mbLoadingLevel || mbLoadingEnvironmentMap))
+	{
+		UpdateUIState(mpWinMain->GetHWND(), dt);
+	}
+
 	++mNumUpdateLoopsExecuted;
 
 	UpdateThread_SignalRenderThread();
@@ -115,6 +135,11 @@ void VQEngine::UpdateThread_Tick(const float dt)
 
 void VQEngine::UpdateThread_Exit()
 {
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	// let the render thread finish the published frames before the scene goes away
+	mFrameSnapshots.WaitUntilConsumed();
+	mFrameSnapshots.Abort();
+#endif
 	mpScene->Unload();
 	ExitUI();
 }
@@ -123,13 +148,21 @@ void VQEngine::UpdateThread_PreUpdate()
 {
 	SCOPED_CPU_MARKER("UpdateThread_PreUpdate()");
 
-	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
+#else
+	const int FRAME_DATA_INDEX = 0;
+#endif
+
+	// no UI is drawn in the frames that don't update it, e.g. while loading
+	mUIDrawData[FRAME_DATA_INDEX].Clear();
 
 	if (mpScene)
 	{
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-		const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
-		const int FRAME_DATA_PREV_INDEX = (FRAME_DATA_INDEX == 0) ? (NUM_BACK_BUFFERS - 1) : (FRAME_DATA_INDEX - 1);
+		// carry over the persistent parameters from the last published snapshot, which the render thread only reads
+		const int FRAME_DATA_LAST_WRITTEN = mFrameSnapshots.GetLastWrittenSlot();
+		const int FRAME_DATA_PREV_INDEX = FRAME_DATA_LAST_WRITTEN == FrameSnapshotRing::INVALID_SLOT ? FRAME_DATA_INDEX : FRAME_DATA_LAST_WRITTEN;
 		mpScene->PreUpdate(FRAME_DATA_INDEX, FRAME_DATA_PREV_INDEX);
 #else
 		mpScene->PreUpdate(0, 0);
@@ -155,12 +188,15 @@ void VQEngine::UpdateThread_UpdateAppState(const float dt)
 	case EAppState::LOADING:
 		if (mbLoadingLevel || mbLoadingEnvironmentMap)
 		{
-			// animate loading screen
+			// run the scene load stages for a slice of the frame, models & textures load on the worker threads
+			const bool bSceneLoadStagesFinished = !mbLoadingLevel || mpScene->UpdateLoading(SCENE_LOAD_TIME_BUDGET_SECONDS);
 
+			// animate loading screen
+			mLoadingScreenData.Progress.store(mbLoadingLevel ? mpScene->GetLoadProgress().GetProgress() : 0.0f);
 
 			// check if loading is done
 			const int NumActiveTasks = mWorkers_ModelLoading.GetNumActiveTasks() + mWorkers_TextureLoading.GetNumActiveTasks();
-			const bool bLoadTasksFinished = NumActiveTasks == 0;
+			const bool bLoadTasksFinished = bSceneLoadStagesFinished && NumActiveTasks == 0;
 			if (bLoadTasksFinished)
 			{
 				if (mbLoadingLevel)
@@ -176,6 +212,7 @@ void VQEngine::UpdateThread_UpdateAppState(const float dt)
 				mbLoadingEnvironmentMap.store(false);
 
 				mLoadingScreenData.RotateLoadingScreenImageIndex();
+				mLoadingScreenData.Progress.store(0.0f);
 
 				float dt_loading = mTimer.StopGetDeltaTimeAndReset();
 				Log::Info("Loading completed in %.2fs, starting scene simulation", dt_loading);
@@ -187,6 +224,8 @@ void VQEngine::UpdateThread_UpdateAppState(const float dt)
 		// TODO: threaded?
 		UpdateThread_UpdateScene_MainWnd(dt);
 		UpdateThread_UpdateScene_DebugWnd(dt);
+		if (mBenchmark.IsEnabled())
+			UpdateThread_UpdateBenchmark();
 		break;
 	}
 }
@@ -195,9 +234,9 @@ void VQEngine::UpdateThread_PostUpdate()
 {
 	SCOPED_CPU_MARKER("UpdateThread_PostUpdate()");
 
+	const uint64 FrameIndex = GetUpdateFrameIndex();
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
-	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
 	ThreadPool& mWorkerThreads = mWorkers_Update;
 #else
 	const int FRAME_DATA_INDEX = 0;
@@ -209,7 +248,26 @@ void VQEngine::UpdateThread_PostUpdate()
 		return;
 	}
 
+	const uint64 PostUpdateBeginNs = Profiler::GetTimeNs();
 	mpScene->PostUpdate(mWorkerThreads, FRAME_DATA_INDEX);
+	if (FBenchmarkFrame* pBenchmarkFrame = mBenchmark.GetFrame(FrameIndex))
+	{
+		pBenchmarkFrame->CullingMs = (Profiler::GetTimeNs() - PostUpdateBeginNs) * 1e-6f;
+		pBenchmarkFrame->Stats = mpScene->GetSceneRenderStats(FRAME_DATA_INDEX);
+	}
+
+	// pick the mips to stream from the culled meshes of this frame
+	if (mTextureStreamer.IsEnabled())
+	{
+		const uint NumBackBuffers = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+		// the published snapshots still reference the swapped out SRVs until the render thread records them
+		const uint NumFramesInFlight = NumBackBuffers + mFrameSnapshots.GetLatency();
+#else
+		const uint NumFramesInFlight = NumBackBuffers;
+#endif
+		mTextureStreamer.Update(*mpScene, mpScene->GetSceneView(FRAME_DATA_INDEX), NumFramesInFlight);
+	}
 
 	// input post update
 	for (auto it = mInputStates.begin(); it != mInputStates.end(); ++it)
@@ -233,18 +291,19 @@ float VQEngine::UpdateThread_WaitForRenderThread()
 
 	Timer t;
 	t.Start();
-	mpSemUpdate->Wait();
+	mIndex_FrameSnapshot_Update = mFrameSnapshots.BeginWrite(); // blocks while the render thread is Latency frames behind
 	t.Stop();
 	return t.DeltaTime();
 }
 void VQEngine::UpdateThread_SignalRenderThread()
 {
-	mpSemRender->Signal();
+	mFrameSnapshots.EndWrite(mIndex_FrameSnapshot_Update);
+	mIndex_FrameSnapshot_Update = FrameSnapshotRing::INVALID_SLOT;
 }
 
 void VQEngine::WaitUntilRenderingFinishes()
 {
-	while (mNumRenderLoopsExecuted != mNumUpdateLoopsExecuted);
+	mFrameSnapshots.WaitUntilConsumed();
 }
 #else
 float VQEngine::UpdateThread_WaitForRenderThread() { return 0.0f; }
@@ -295,46 +354,17 @@ void VQEngine::SetEffectiveFrameRateLimit()
 	{
 		mEffectiveFrameRateLimit_ms = 1000.0f / mSettings.gfx.MaxFrameRate;
 	}
+	mFramePacer.SetTargetFrameTime(mEffectiveFrameRateLimit_ms);
+
 	const bool bUnlimitedFrameRate = mEffectiveFrameRateLimit_ms == 0.0f;
 	if (bUnlimitedFrameRate) Log::Info("FrameRateLimit : Unlimited");
 	else                     Log::Info("FrameRateLimit : %.2fms | %d FPS", mEffectiveFrameRateLimit_ms, static_cast<int>(1000.0f / mEffectiveFrameRateLimit_ms));
 }
 
-float VQEngine::FramePacing(float dt)
+float VQEngine::FramePacing()
 {
-	float SleepTime = 0.0f;
-	if (mEffectiveFrameRateLimit_ms != 0.0f)
-	{
-		SCOPED_CPU_MARKER_C("Sleep (FrameLimiter)", 0xFF552200);
-		const float TimeBudgetLeft_ms = mEffectiveFrameRateLimit_ms - dt;
-		if (TimeBudgetLeft_ms > 0.0f)
-		{
-#if 0
-			// ------------------------------------------------------------------
-			//                          WARNING
-			// ------------------------------------------------------------------
-			// The OS call for Sleep(ms) doesn't yield back in time and the frame
-			// time limiter doesn't work as precise, resulting in frame times of
-			// 20, 30, 60 and 1000. This is because OS doesn't guarantee exact
-			// timing for the Sleep(), hence we should use it with Sleep(0)
-			// with an accumulator
-			SleepTime = mTimerRender.TotalTime();
-			Sleep((DWORD)TimeBudgetLeft_ms);
-			SleepTime = mTimerRender.TotalTime() - SleepTime;
-			// ------------------------------------------------------------------
-#else
-			float Acc = TimeBudgetLeft_ms / 1000;
-			Timer SleepTimer;
-			SleepTimer.Start();
-			while (Acc > 0.0f)
-			{
-				Sleep(0);
-				Acc -= SleepTimer.Tick();
-			}
-#endif
-		}
-	}
-	return SleepTime;
+	SCOPED_CPU_MARKER_C("Sleep (FrameLimiter)", 0xFF552200);
+	return mFramePacer.WaitForNextFrame();
 }
 
 const FDisplayHDRProfile* VQEngine::GetHDRProfileIfExists(const wchar_t* pwStrLogicalDisplayName)
@@ -359,17 +389,22 @@ const FDisplayHDRProfile* VQEngine::GetHDRProfileIfExists(const wchar_t* pwStrLo
 
 void VQEngine::UpdateThread_UpdateScene_MainWnd(const float dt)
 {
+	const uint64 FrameIndex = GetUpdateFrameIndex();
 	std::unique_ptr<Window>& pWin = mpWinMain;
 	HWND hwnd = pWin->GetHWND();
 
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(hwnd);
-	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
 #else
 	const int FRAME_DATA_INDEX = 0;
 #endif
 
+	const uint64 UpdateBeginNs = Profiler::GetTimeNs();
 	mpScene->Update(dt, FRAME_DATA_INDEX);
+	if (FBenchmarkFrame* pBenchmarkFrame = mBenchmark.GetFrame(FrameIndex))
+	{
+		pBenchmarkFrame->UpdateMs = (Profiler::GetTimeNs() - UpdateBeginNs) * 1e-6f;
+	}
 
 	HandleEngineInput(); // system-wide input (esc/mouse click on wnd)
 	for (decltype(mInputStates)::iterator it = mInputStates.begin(); it != mInputStates.end(); ++it)
@@ -394,6 +429,34 @@ void VQEngine::UpdateThread_UpdateScene_DebugWnd(const float dt)
 	const Input& input = mInputStates.at(hwnd);
 }
 
+void VQEngine::UpdateThread_UpdateBenchmark()
+{
+	const uint64 FrameIndex = GetUpdateFrameIndex();
+	if (mBenchmark.IsFinished())
+		return; // waiting for the main thread to quit
+
+	if (!mBenchmark.IsLevelRunning())
+	{
+		mBenchmark.BeginLevel(*mpScene, FrameIndex); // level just finished loading
+	}
+	else if (mBenchmark.TryEndLevel(FrameIndex))
+	{
+		const std::string* pNextLevel = mBenchmark.GetNextLevel();
+		if (!pNextLevel)
+		{
+			mBenchmark.Finish();
+			return;
+		}
+
+		const std::vector<std::string>& SceneNames = mResourceNames.mSceneNames;
+		mIndex_SelectedScene = static_cast<int>(std::find(SceneNames.begin(), SceneNames.end(), *pNextLevel) - SceneNames.begin());
+		StartLoadingScene(mIndex_SelectedScene);
+		return;
+	}
+
+	// after the camera controllers, before the view is culled & snapshotted in PostUpdate()
+	mBenchmark.UpdateCamera(mpScene->GetActiveCamera(), FrameIndex);
+}
 
 void VQEngine::Load_SceneData_Dispatch()
 {
@@ -404,23 +467,32 @@ void VQEngine::Load_SceneData_Dispatch()
 	mQueue_SceneLoad.pop();
 
 
-	const int NUM_SWAPCHAIN_BACKBUFFERS = mSettings.gfx.bUseTripleBuffering ? 3 : 2;
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	const int NUM_FRAME_DATA = static_cast<int>(mFrameSnapshots.GetNumSlots());
+#else
+	const int NUM_FRAME_DATA = 1;
+#endif
 	const Input& input = mInputStates.at(mpWinMain->GetHWND());
 
 	auto fnCreateSceneInstance = [&](const std::string& SceneType, std::unique_ptr<Scene>& pScene) -> void
 	{
-		     if (SceneType == "Default")          pScene = std::make_unique<DefaultScene>(*this, NUM_SWAPCHAIN_BACKBUFFERS, input, mpWinMain, mRenderer);
-		else if (SceneType == "Sponza")           pScene = std::make_unique<SponzaScene >(*this, NUM_SWAPCHAIN_BACKBUFFERS, input, mpWinMain, mRenderer);
-		else if (SceneType == "StressTest")       pScene = std::make_unique<StressTestScene >(*this, NUM_SWAPCHAIN_BACKBUFFERS, input, mpWinMain, mRenderer);
-		else if (SceneType == "EnvironmentMapUnitTest") pScene = std::make_unique<EnvironmentMapUnitTestScene >(*this, NUM_SWAPCHAIN_BACKBUFFERS, input, mpWinMain, mRenderer);
+		     if (SceneType == "Default")          pScene = std::make_unique<DefaultScene>(*this, NUM_FRAME_DATA, input, mpWinMain, mRenderer);
+		else if (SceneType == "Sponza")           pScene = std::make_unique<SponzaScene >(*this, NUM_FRAME_DATA, input, mpWinMain, mRenderer);
+		else if (SceneType == "StressTest")       pScene = std::make_unique<StressTestScene >(*this, NUM_FRAME_DATA, input, mpWinMain, mRenderer);
+		else if (SceneType == "EnvironmentMapUnitTest") pScene = std::make_unique<EnvironmentMapUnitTestScene >(*this, NUM_FRAME_DATA, input, mpWinMain, mRenderer);
 	};
 
 	const bool bUpscalingEnabled = mpScene ? mpScene->GetPostProcessParameters(0).IsFSREnabled() : false;
 	if (mpScene)
 	{
+		if (mpScene->IsLoading())
+		{
+			CancelSceneLoad(); // switching scenes mid-load
+		}
 		this->WaitUntilRenderingFinishes();
 		mpScene->Unload(); // is this really necessary when we fnCreateSceneInstance() ?
 	}
+	mTextureStreamer.Reset();
 
 	// load scene representation from disk
 	const std::string SceneFilePath = "Data/Levels/" + SceneFileName + ".xml";
@@ -439,8 +511,8 @@ void VQEngine::Load_SceneData_Dispatch()
 	{
 		const uint32 W = mpWinMain->GetWidth();
 		const uint32 H = mpWinMain->GetHeight();
-		mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<WindowResizeEvent>(W, H, mpWinMain->GetHWND()));
-		mEventQueue_WinToVQE_Update.AddItem(std::make_unique<WindowResizeEvent>(W, H, mpWinMain->GetHWND()));
+		mEventQueue_WinToVQE_Renderer.Push(WindowResizeEvent(W, H, mpWinMain->GetHWND()));
+		mEventQueue_WinToVQE_Update.Push(WindowResizeEvent(W, H, mpWinMain->GetHWND()));
 	}
 	//----------------------------------------------------------------------
 	
@@ -451,10 +523,38 @@ void VQEngine::Load_SceneData_Dispatch()
 	// start loading environment map textures
 	if (!SceneRep.EnvironmentMapPreset.empty())
 	{
-		mWorkers_TextureLoading.AddTask([=]() { LoadEnvironmentMap(SceneRep.EnvironmentMapPreset); });
+		mWorkers_TextureLoading.AddTask([=]() { SCOPED_CPU_MARKER("LoadWorker_EnvironmentMap"); LoadEnvironmentMap(SceneRep.EnvironmentMapPreset); });
 	}
 }
 
+void VQEngine::CancelSceneLoad()
+{
+	Timer t; t.Start();
+	mpScene->CancelLoading();
+
+	// the cancelled loads complete w/ INVALID_ID, wait for the file reads & the worker tasks still
+	// touching the scene to drain. Read callbacks dispatch worker tasks and vice versa, hence the loop.
+	do
+	{
+		mAsyncIO.WaitIdle();
+		while (mWorkers_ModelLoading.GetNumActiveTasks() + mWorkers_TextureLoading.GetNumActiveTasks() > 0)
+		{
+			std::this_thread::yield();
+		}
+	} while (!mAsyncIO.IsIdle());
+
+	// the material assignments continue on the texture uploads & write into the scene's materials as well
+	const AssetLoader::FLoadProgress& LoadProgress = mAssetLoader.GetLoadProgress();
+	while (LoadProgress.NumMaterialsAssigned < LoadProgress.NumMaterials)
+	{
+		std::this_thread::yield();
+	}
+
+	mbLoadingEnvironmentMap.store(false);
+	mLoadingScreenData.Progress.store(0.0f);
+	Log::Info("[SceneLoad] Cancelled loads drained in %.2fms", t.StopGetDeltaTimeAndReset() * 1000.0f);
+}
+
 SRV_ID FLoadingScreenData::GetSelectedLoadingScreenSRV_ID() const
 {
 	assert(SelectedLoadingScreenSRVIndex < SRVs.size());
@@ -569,6 +669,7 @@ void VQEngine::StartLoadingEnvironmentMap(int IndexEnvMap)
 	mbLoadingEnvironmentMap = true;
 	mWorkers_TextureLoading.AddTask([&, IndexEnvMap]()
 	{
+		SCOPED_CPU_MARKER("LoadWorker_EnvironmentMap");
 		LoadEnvironmentMap(mResourceNames.mEnvironmentMapPresetNames[IndexEnvMap]);
 	});
 }
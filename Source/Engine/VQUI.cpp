@@ -17,6 +17,7 @@
 //	Contact: volkanilbeyli@gmail.com
 #define NOMINMAX
 #include <utility>
+#include <ctime>
 #include "VQEngine.h"
 #include "GPUMarker.h"
 
@@ -191,8 +192,7 @@ void VQEngine::UpdateUIState(HWND hwnd, float dt)
 
 	// Data for the UI controller to update
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
-	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
-	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
+	const int FRAME_DATA_INDEX = mIndex_FrameSnapshot_Update;
 #endif
 	FPostProcessParameters& PPParams = mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
 	FSceneRenderParameters& SceneParams = mpScene->GetSceneView(FRAME_DATA_INDEX).sceneParameters;
@@ -202,6 +202,15 @@ void VQEngine::UpdateUIState(HWND hwnd, float dt)
 
 	UpdateImGUIState(hwnd);
 
+	mFrameHistory_FPS.Add(dt > 0.0f ? 1.0f / dt : 0.0f);
+	mFrameHistory_FrameTimeMs.Add(dt * 1000.0f);
+	{
+		uint64 NumAllocations = 0;
+		for (size_t i = 0; i < static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS); ++i)
+			NumAllocations += MemoryTracking::GetStats(static_cast<EMemoryTag>(i)).NumAllocationsLastFrame;
+		mFrameHistory_AllocationsPerFrame.Add(static_cast<float>(NumAllocations));
+	}
+
 	ImGui::NewFrame();
 	style.FrameBorderSize = 1.0f;
 
@@ -214,16 +223,53 @@ void VQEngine::UpdateUIState(HWND hwnd, float dt)
 		if (mUIState.bWindowVisible_GraphicsSettingsPanel) DrawGraphicsSettingsWindow(SceneParams, PPParams);
 	}
 
-	// If we fired an event that would trigger loading,
-	// i.e. changing the scene or the environment map, call ImGui::EndFrame()
-	// here to prevent calling NewFrame() before Render/EndFrame is called.
-	// Render() won't be called if we're changing the level because the appstate
-	// will cause VQengine to render the loading screen which doesn't call ImGui::Render(),
-	// and as a result ImGui crashes on a double NewFrame() call.
+	// If we fired an event that would trigger loading, i.e. changing the scene or the environment map,
+	// only end the frame: the loading screen is rendered instead of the UI.
+	// Otherwise, the draw lists are copied into the frame data, the render thread never calls into ImGui.
 	if (!mQueue_SceneLoad.empty() || mbLoadingEnvironmentMap.load())
 	{
 		ImGui::EndFrame();
 	}
+	else
+	{
+		ImGui::Render();
+		mUIDrawData[FRAME_DATA_INDEX].Capture(ImGui::GetDrawData());
+	}
+}
+
+void FUIDrawData::Clear()
+{
+	Vertices.clear();
+	Indices.clear();
+	Commands.clear();
+}
+
+void FUIDrawData::Capture(const ImDrawData* pDrawData)
+{
+	Clear();
+	DisplaySize = ImGui::GetIO().DisplaySize;
+	Vertices.reserve(pDrawData->TotalVtxCount);
+	Indices.reserve(pDrawData->TotalIdxCount);
+
+	for (int n = 0; n < pDrawData->CmdListsCount; n++)
+	{
+		const ImDrawList* pDrawList = pDrawData->CmdLists[n];
+		const int32_t VertexOffset = static_cast<int32_t>(Vertices.size());
+		uint32_t IndexOffset = static_cast<uint32_t>(Indices.size());
+
+		Vertices.insert(Vertices.end(), pDrawList->VtxBuffer.Data, pDrawList->VtxBuffer.Data + pDrawList->VtxBuffer.Size);
+		Indices.insert(Indices.end(), pDrawList->IdxBuffer.Data, pDrawList->IdxBuffer.Data + pDrawList->IdxBuffer.Size);
+		for (int cmd_i = 0; cmd_i < pDrawList->CmdBuffer.Size; cmd_i++)
+		{
+			const ImDrawCmd& cmd = pDrawList->CmdBuffer[cmd_i];
+			assert(cmd.UserCallback == nullptr); // draw callbacks would run on the update thread, the engine doesn't use them
+			if (cmd.UserCallback == nullptr)
+			{
+				Commands.push_back({ cmd.ClipRect, cmd.TextureId, cmd.ElemCount, IndexOffset, VertexOffset });
+			}
+			IndexOffset += cmd.ElemCount;
+		}
+	}
 }
 
 // ============================================================================================================================
@@ -351,6 +397,9 @@ static size_t DetermineChartMaxValueIndex(int RecentHighestFPS)
 	}
 	return iFPSGraphMaxValue;
 }
+constexpr float FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS[] = { 2.0f, 4.0f, 8.0f, 16.7f, 33.3f, 66.7f, 100.0f, 250.0f, 1000.0f };
+constexpr const char* FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS_STR[] = { "2ms", "4ms", "8ms", "16.7ms", "33.3ms", "66.7ms", "100ms", "250ms", "1s" };
+constexpr const char* CPU_TRACE_DIRECTORY = "Traces"; // chrome://tracing JSON files exported from the profiler window
 
 //
 // Helpers
@@ -377,31 +426,46 @@ static ImVec4 SelectFPSColor(int FPS)
 	return FPSColors[iColor];
 }
 
-static void DrawFPSChart(int fps)
+static void DrawFPSChart(const FrameHistory& FPSHistory)
 {
-	// data
-	constexpr size_t FPS_HISTORY_SIZE = 160;
-	static float  FPS_HISTORY[FPS_HISTORY_SIZE] = {};
-	
-	// update data
-	float RecentHighestFPS = 0.0f;
-	for (size_t i = 1; i < FPS_HISTORY_SIZE; ++i) 
-	{
-		FPS_HISTORY[i - 1] = FPS_HISTORY[i]; // slide
-		RecentHighestFPS = std::max(RecentHighestFPS, FPS_HISTORY[i]);
-	}
-	FPS_HISTORY[FPS_HISTORY_SIZE-1] = static_cast<float>(fps); // log the last fps
-	RecentHighestFPS = std::max(RecentHighestFPS, FPS_HISTORY[FPS_HISTORY_SIZE - 1]);
-
+	const float RecentHighestFPS = FPSHistory.GetMax();
 	const size_t iFPSGraphMaxValue = DetermineChartMaxValueIndex(static_cast<int>(RecentHighestFPS));
 
 	// ui
 	const ImVec2 GRAPH_SIZE = ImVec2(0, 60);
-	ImGui::PlotLines(FPS_GRAPH_MAX_FPS_THRESHOLDS_STR[iFPSGraphMaxValue], FPS_HISTORY, FPS_HISTORY_SIZE, 0, "FPS", 0.0f, (float)FPS_GRAPH_MAX_FPS_THRESHOLDS[iFPSGraphMaxValue], GRAPH_SIZE);
+	ImGui::PlotLines(FPS_GRAPH_MAX_FPS_THRESHOLDS_STR[iFPSGraphMaxValue], FPSHistory.GetData(), FrameHistory::SIZE, FPSHistory.GetOffset(), "FPS", 0.0f, (float)FPS_GRAPH_MAX_FPS_THRESHOLDS[iFPSGraphMaxValue], GRAPH_SIZE);
 }
-static void DrawFrameTimeChart()
+static void DrawFrameTimeChart(const FrameHistory& FrameTimeHistoryMs)
 {
-	// TODO
+	const float RecentHighestFrameTime = FrameTimeHistoryMs.GetMax();
+	size_t iGraphMaxValue = 0;
+	while (iGraphMaxValue < _countof(FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS) - 1 && RecentHighestFrameTime >= FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS[iGraphMaxValue])
+		++iGraphMaxValue; // FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS are in increasing order
+
+	char Overlay[64];
+	snprintf(Overlay, sizeof(Overlay), "ms (avg %.2f, max %.2f)", FrameTimeHistoryMs.GetAverage(), RecentHighestFrameTime);
+
+	// ui
+	const ImVec2 GRAPH_SIZE = ImVec2(0, 60);
+	ImGui::PlotLines(FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS_STR[iGraphMaxValue], FrameTimeHistoryMs.GetData(), FrameHistory::SIZE, FrameTimeHistoryMs.GetOffset(), Overlay, 0.0f, FRAME_TIME_GRAPH_MAX_MS_THRESHOLDS[iGraphMaxValue], GRAPH_SIZE);
+}
+static void DrawAllocationsChart(const FrameHistory& AllocationsHistory)
+{
+	char Overlay[64];
+	snprintf(Overlay, sizeof(Overlay), "allocs/frame (avg %.1f, max %.0f)", AllocationsHistory.GetAverage(), AllocationsHistory.GetMax());
+
+	// ui
+	const ImVec2 GRAPH_SIZE = ImVec2(0, 40);
+	ImGui::PlotLines("##AllocationsPerFrame", AllocationsHistory.GetData(), FrameHistory::SIZE, AllocationsHistory.GetOffset(), Overlay, 0.0f, std::max(1.0f, AllocationsHistory.GetMax()), GRAPH_SIZE);
+}
+static std::string GetCPUTraceFilePath()
+{
+	const std::time_t Now = std::time(nullptr);
+	std::tm LocalTime = {};
+	localtime_s(&LocalTime, &Now);
+	char FileName[64];
+	std::strftime(FileName, sizeof(FileName), "VQE_%Y-%m-%d_%H-%M-%S.json", &LocalTime);
+	return std::string(CPU_TRACE_DIRECTORY) + "/" + FileName;
 }
 
 
@@ -570,8 +634,16 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 		ImGui::TextColored(DataTextColor      , "Resolution : %ix%i", W, H);
 		ImGui::TextColored(SelectFPSColor(fps), "FPS        : %d (%.2f ms)", fps, frameTime_ms);
 		
-		DrawFPSChart(fps);
-		DrawFrameTimeChart();
+		DrawFPSChart(mFrameHistory_FPS);
+		DrawFrameTimeChart(mFrameHistory_FrameTimeMs);
+
+		if (ImGui::Button("Export CPU Trace"))
+		{
+			// off the update thread: the rings of all the threads are written out
+			mWorkers_ModelLoading.AddTask([FilePath = GetCPUTraceFilePath()]() { Profiler::ExportChromeTrace(FilePath); });
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Writes the recent CPU profiler scopes of all threads, open w/ chrome://tracing");
 	}
 
 	ImGuiSpacing3();
@@ -638,6 +710,18 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 			ImGui::TextColored(DataTextColor, "Dispatch Calls : %d", mRenderStats.NumDispatches);
 #endif
 		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("MEMORY", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "%-14s %9s %9s %8s", "Tag", "Live", "Peak", "Allocs/s");
+			ImGui::TextColored(DataTextColor, "-------------------------------------------");
+			for (size_t i = 0; i < static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS); ++i)
+			{
+				const FMemoryTagStats m = MemoryTracking::GetStats(static_cast<EMemoryTag>(i));
+				ImGui::TextColored(DataTextColor, "%-14s %9s %9s %8.0f", m.pName, StrUtil::FormatByte(m.NumBytesLive).c_str(), StrUtil::FormatByte(m.NumBytesPeak).c_str(), m.AllocationsPerSecond);
+			}
+			DrawAllocationsChart(mFrameHistory_AllocationsPerFrame);
+		}
 	}
 	ImGui::End();
 }
@@ -675,8 +759,8 @@ void VQEngine::DrawPostProcessSettings(FPostProcessParameters& PPParams)
 	// fns
 	auto fnSendWindowResizeEvents = [&]()
 	{
-		mEventQueue_WinToVQE_Renderer.AddItem(std::make_unique<WindowResizeEvent>(W, H, mpWinMain->GetHWND()));
-		mEventQueue_WinToVQE_Update.AddItem(std::make_unique<WindowResizeEvent>(W, H, mpWinMain->GetHWND()));
+		mEventQueue_WinToVQE_Renderer.Push(WindowResizeEvent(W, H, mpWinMain->GetHWND()));
+		mEventQueue_WinToVQE_Update.Push(WindowResizeEvent(W, H, mpWinMain->GetHWND()));
 	};
 
 	// one time initialization
@@ -840,12 +924,12 @@ void VQEngine::DrawGraphicsSettingsWindow(FSceneRenderParameters& SceneRenderPar
 
 		if (ImGui::Checkbox("VSync (V)", &gfx.bVsync))
 		{
-			mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetVSyncEvent>(hwnd, gfx.bVsync));
+			mEventQueue_WinToVQE_Renderer.Push(SetVSyncEvent(hwnd, gfx.bVsync));
 		}
 		bool bFS = mpWinMain->IsFullscreen();
 		if (ImGui::Checkbox("Fullscreen (Alt+Enter)", &bFS))
 		{
-			mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<ToggleFullscreenEvent>(hwnd));
+			mEventQueue_WinToVQE_Renderer.Push(ToggleFullscreenEvent(hwnd));
 		}
 	}
 	else
@@ -16,6 +16,10 @@
 //
 //	Contact: volkanilbeyli@gmail.com
 
+#include "Libs/imgui/imgui.h"
+
+#include <vector>
+
 struct FUIState
 {
 	bool bWindowVisible_KeyMappings;
@@ -27,4 +31,26 @@ struct FUIState
 
 	bool bUIOnSeparateWindow;
 	bool bProfiler_ShowEngineStats;
-};
\ No newline at end of file
+};
+
+// ImGui draw lists copied out at the end of the UI update, so the render thread
+// draws the UI of its own frame without touching the ImGui context.
+struct FUIDrawCommand
+{
+	ImVec4      ClipRect;
+	ImTextureID TextureId;
+	uint32_t    ElemCount;
+	uint32_t    IndexOffset;
+	int32_t     VertexOffset;
+};
+struct FUIDrawData
+{
+	ImVec2                      DisplaySize = {};
+	std::vector<ImDrawVert>     Vertices;
+	std::vector<ImDrawIdx>      Indices;
+	std::vector<FUIDrawCommand> Commands;
+
+	void Clear();
+	void Capture(const ImDrawData* pDrawData);
+	inline bool IsEmpty() const { return Commands.empty(); }
+};
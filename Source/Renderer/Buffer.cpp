@@ -21,6 +21,7 @@
 
 #include "Libs/D3DX12/d3dx12.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stdlib.h>
 
@@ -215,191 +216,195 @@ void StaticBufferHeap::UploadData(ID3D12GraphicsCommandList* pCmd)
 
 
 //
-// DYNAMIC BUFFER HEAP
+// UPLOAD PAGE POOL
 //
-void DynamicBufferHeap::Create(ID3D12Device* pDevice, uint32_t numberOfBackBuffers, uint32_t memTotalSize)
+void UploadPagePool::Create(ID3D12Device* pDevice, const char* name)
 {
-    m_memTotalSize = AlignOffset(memTotalSize, 256u);
-
-    m_mem.Create(numberOfBackBuffers, memTotalSize);
-
-    ThrowIfFailed(pDevice->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(memTotalSize),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_pBuffer)));
-    SetName(m_pBuffer, "DynamicBufferHeap::m_pBuffer");
-
-    m_pBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_pData));
+    mpDevice = pDevice;
+    mName = name;
 }
 
-void DynamicBufferHeap::Destroy()
+void UploadPagePool::Destroy()
 {
-    m_pBuffer->Release();
-    m_mem.Destroy();
+    std::lock_guard<std::mutex> lk(mMtx);
+    for (std::unique_ptr<FPage>& pPage : mPages)
+        pPage->pResource->Release();
+    mPages.clear();
+    mFreePages.clear();
+    mRetiredPages.clear();
+    mMemoryInUse = 0;
 }
 
-bool DynamicBufferHeap::AllocConstantBuffer(uint32_t size, void** pData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferViewDesc)
+UploadPagePool::FPage* UploadPagePool::AcquirePage(uint32 minSize)
 {
-    size = AlignOffset(size, 256u);
+    std::lock_guard<std::mutex> lk(mMtx);
 
-    uint32_t memOffset;
-    if (m_mem.Alloc(size, &memOffset) == false)
+    // reuse the smallest free page that fits, the dedicated pages are only reused for the large allocations
+    auto itBest = mFreePages.end();
+    for (auto it = mFreePages.begin(); it != mFreePages.end(); ++it)
     {
-        Log::Error("Ran out of mem for 'dynamic' buffers, increase the allocated size\n");
-        MessageBox(NULL, "Out of DynamicBufferHeap memory", "Error", MB_ICONERROR | MB_OK);
-        PostMessage(NULL, WM_QUIT, NULL, NULL);
-        return false;
+        if ((*it)->Size >= minSize && (itBest == mFreePages.end() || (*it)->Size < (*itBest)->Size))
+            itBest = it;
     }
 
-    *pData = (void*)(m_pData + memOffset);
+    FPage* pPage = nullptr;
+    if (itBest != mFreePages.end())
+    {
+        pPage = *itBest;
+        *itBest = mFreePages.back();
+        mFreePages.pop_back();
+    }
+    else
+    {
+        const uint32 pageSize = minSize <= PAGE_SIZE ? PAGE_SIZE : AlignOffset(minSize, PAGE_SIZE);
 
-    *pBufferViewDesc = m_pBuffer->GetGPUVirtualAddress() + memOffset;
+        std::unique_ptr<FPage> pNewPage = std::make_unique<FPage>();
+        HRESULT hr = mpDevice->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(pageSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&pNewPage->pResource));
+        if (FAILED(hr))
+        {
+            Log::Error("UploadPagePool<%s>: couldn't create a %u KB page", mName.c_str(), pageSize / static_cast<uint32>(KILOBYTE));
+            return nullptr;
+        }
+        SetName(pNewPage->pResource, "%s::Page[%d]", mName.c_str(), static_cast<int>(mPages.size()));
+        pNewPage->pResource->Map(0, nullptr, reinterpret_cast<void**>(&pNewPage->pData));
+        pNewPage->GPUAddress = pNewPage->pResource->GetGPUVirtualAddress();
+        pNewPage->Size = pageSize;
+
+        pPage = pNewPage.get();
+        mPages.push_back(std::move(pNewPage));
+        ++mStats.NumPages;
+        if (pageSize > PAGE_SIZE)
+            ++mStats.NumDedicatedPages;
+        mStats.MemorySize += pageSize;
+    }
 
-    return true;
+    mMemoryInUse += pPage->Size;
+    mStats.PeakMemoryInUse = std::max(mStats.PeakMemoryInUse, mMemoryInUse);
+    return pPage;
 }
 
-bool DynamicBufferHeap::AllocVertexBuffer(uint32_t NumVertices, uint32_t strideInBytes, void** ppData, D3D12_VERTEX_BUFFER_VIEW* pView)
+void UploadPagePool::RetirePages(std::vector<FPage*>& pages, uint64 frameFence)
 {
-    uint32_t size = AlignOffset(NumVertices * strideInBytes, 256u);
-
-    uint32_t memOffset;
-    if (m_mem.Alloc(size, &memOffset) == false)
-        return false;
-
-    *ppData = (void*)(m_pData + memOffset);
-
-
-    pView->BufferLocation = m_pBuffer->GetGPUVirtualAddress() + memOffset;
-    pView->StrideInBytes = strideInBytes;
-    pView->SizeInBytes = size;
-
-    return true;
+    std::lock_guard<std::mutex> lk(mMtx);
+    for (FPage* pPage : pages)
+        mRetiredPages.push_back({ frameFence, pPage });
+    pages.clear();
 }
 
-bool DynamicBufferHeap::AllocIndexBuffer(uint32_t NumIndices, uint32_t strideInBytes, void** ppData, D3D12_INDEX_BUFFER_VIEW* pView)
+void UploadPagePool::RecyclePages(uint64 completedFrameFence)
 {
-    uint32_t size = AlignOffset(NumIndices * strideInBytes, 256u);
-
-    uint32_t memOffset;
-    if (m_mem.Alloc(size, &memOffset) == false)
-        return false;
-
-    *ppData = (void*)(m_pData + memOffset);
-
-    pView->BufferLocation = m_pBuffer->GetGPUVirtualAddress() + memOffset;
-    pView->Format = (strideInBytes == 4) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
-    pView->SizeInBytes = size;
-
-    return true;
+    std::lock_guard<std::mutex> lk(mMtx);
+    while (!mRetiredPages.empty() && mRetiredPages.front().first <= completedFrameFence)
+    {
+        FPage* pPage = mRetiredPages.front().second;
+        mMemoryInUse -= pPage->Size;
+        mFreePages.push_back(pPage);
+        mRetiredPages.pop_front();
+    }
 }
 
-//--------------------------------------------------------------------------------------
-//
-// OnBeginFrame
-//
-//--------------------------------------------------------------------------------------
-void DynamicBufferHeap::OnBeginFrame()
+FUploadPagePoolStats UploadPagePool::GetStats() const
 {
-    m_mem.OnBeginFrame();
+    std::lock_guard<std::mutex> lk(mMtx);
+    return mStats;
 }
 
 
 //
-// RING BUFFER
-// 
-void RingBuffer::Create(uint32_t TotalSize)
+// DYNAMIC BUFFER HEAP
+//
+void DynamicBufferHeap::Create(UploadPagePool* pPagePool)
 {
-    m_Head = 0;
-    m_AllocatedSize = 0;
-    m_TotalSize = TotalSize;
+    m_pPagePool = pPagePool;
 }
-uint32_t RingBuffer::PaddingToAvoidCrossOver(uint32_t size)
+
+void DynamicBufferHeap::Destroy()
 {
-    int tail = GetTail();
-    if ((tail + size) > m_TotalSize)
-        return (m_TotalSize - tail);
-    else
-        return 0;
+    m_pages.clear(); // owned by the pool
+    m_pPagePool = nullptr;
 }
-bool RingBuffer::Alloc(uint32_t size, uint32_t* pOut)
+
+bool DynamicBufferHeap::Alloc(uint32_t size, uint32_t usedSize, char** ppData, D3D12_GPU_VIRTUAL_ADDRESS* pGPUAddress)
 {
-    if (m_AllocatedSize + size <= m_TotalSize)
+    // the allocation sizes are multiples of ALIGNMENT, so the offset within a page stays aligned
+    if (m_pages.empty() || m_pageOffset + size > m_pages.back()->Size)
     {
-        if (pOut)
-            *pOut = GetTail();
-
-        m_AllocatedSize += size;
-        return true;
+        UploadPagePool::FPage* pPage = m_pPagePool->AcquirePage(size);
+        if (!pPage)
+        {
+            Log::Error("Ran out of mem for 'dynamic' buffers\n");
+            MessageBox(NULL, "Out of DynamicBufferHeap memory", "Error", MB_ICONERROR | MB_OK);
+            PostMessage(NULL, WM_QUIT, NULL, NULL);
+            return false;
+        }
+        m_pages.push_back(pPage);
+        m_pageOffset = 0;
     }
 
-    assert(false);
-    return false;
+    const UploadPagePool::FPage* pPage = m_pages.back();
+    *ppData = pPage->pData + m_pageOffset;
+    *pGPUAddress = pPage->GPUAddress + m_pageOffset;
+    m_pageOffset += size;
+
+    ++m_stats.NumAllocations;
+    m_stats.NumBytesAllocated += size;
+    m_stats.NumPaddingBytes += size - usedSize;
+    m_bytesThisFrame += size;
+    return true;
 }
-bool RingBuffer::Free(uint32_t size)
+
+bool DynamicBufferHeap::AllocConstantBuffer(uint32_t size, void** pData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferViewDesc)
 {
-    if (m_AllocatedSize > size)
-    {
-        m_Head = (m_Head + size) % m_TotalSize;
-        m_AllocatedSize -= size;
-        return true;
-    }
-    return false;
+    return Alloc(AlignOffset(size, ALIGNMENT), size, reinterpret_cast<char**>(pData), pBufferViewDesc);
 }
 
-
-//
-// RING BUFFER WITH TABS
-//
-void RingBufferWithTabs::Create(uint32_t numberOfBackBuffers, uint32_t memTotalSize)
+bool DynamicBufferHeap::AllocVertexBuffer(uint32_t NumVertices, uint32_t strideInBytes, void** ppData, D3D12_VERTEX_BUFFER_VIEW* pView)
 {
-    m_backBufferIndex = 0;
-    m_numberOfBackBuffers = numberOfBackBuffers;
+    uint32_t size = AlignOffset(NumVertices * strideInBytes, ALIGNMENT);
 
-    //init mem per frame tracker
-    m_memAllocatedInFrame = 0;
-    for (int i = 0; i < 4; i++)
-        m_allocatedMemPerBackBuffer[i] = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS GPUAddress;
+    if (!Alloc(size, NumVertices * strideInBytes, reinterpret_cast<char**>(ppData), &GPUAddress))
+        return false;
 
-    m_mem.Create(memTotalSize);
-}
+    pView->BufferLocation = GPUAddress;
+    pView->StrideInBytes = strideInBytes;
+    pView->SizeInBytes = size;
 
-void RingBufferWithTabs::Destroy()
-{
-    m_mem.Free(m_mem.GetSize());
+    return true;
 }
 
-bool RingBufferWithTabs::Alloc(uint32_t size, uint32_t* pOut)
+bool DynamicBufferHeap::AllocIndexBuffer(uint32_t NumIndices, uint32_t strideInBytes, void** ppData, D3D12_INDEX_BUFFER_VIEW* pView)
 {
-    uint32_t padding = m_mem.PaddingToAvoidCrossOver(size);
-    if (padding > 0)
-    {
-        m_memAllocatedInFrame += padding;
+    uint32_t size = AlignOffset(NumIndices * strideInBytes, ALIGNMENT);
 
-        if (m_mem.Alloc(padding, NULL) == false) //alloc chunk to avoid crossover, ignore offset        
-        {
-            return false;  //no mem, cannot allocate apdding
-        }
-    }
+    D3D12_GPU_VIRTUAL_ADDRESS GPUAddress;
+    if (!Alloc(size, NumIndices * strideInBytes, reinterpret_cast<char**>(ppData), &GPUAddress))
+        return false;
 
-    if (m_mem.Alloc(size, pOut) == true)
-    {
-        m_memAllocatedInFrame += size;
-        return true;
-    }
-    return false;
+    pView->BufferLocation = GPUAddress;
+    pView->Format = (strideInBytes == 4) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+    pView->SizeInBytes = size;
+
+    return true;
 }
 
-void RingBufferWithTabs::OnBeginFrame()
+//--------------------------------------------------------------------------------------
+//
+// OnBeginFrame
+//
+//--------------------------------------------------------------------------------------
+void DynamicBufferHeap::OnBeginFrame(uint64 frameFence)
 {
-    m_allocatedMemPerBackBuffer[m_backBufferIndex] = m_memAllocatedInFrame;
-    m_memAllocatedInFrame = 0;
-
-    m_backBufferIndex = (m_backBufferIndex + 1) % m_numberOfBackBuffers;
+    m_pPagePool->RetirePages(m_pages, m_frameFence);
+    m_pageOffset = 0;
+    m_frameFence = frameFence;
 
-    // free all the entries for the oldest buffer in one go
-    uint32_t memToFree = m_allocatedMemPerBackBuffer[m_backBufferIndex];
-    m_mem.Free(memToFree);
-}
\ No newline at end of file
+    m_stats.PeakBytesPerFrame = std::max(m_stats.PeakBytesPerFrame, m_bytesThisFrame);
+    m_bytesThisFrame = 0;
+}
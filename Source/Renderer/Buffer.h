@@ -49,7 +49,11 @@
 #include "ResourceHeaps.h"
 #include "Common.h"
 
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 struct ID3D12Device;
 struct ID3D12Resource;
@@ -165,77 +169,107 @@ private:
 
 
 //
-// RING BUFFERS
+// UPLOAD PAGE POOL
 //
-class RingBuffer
+struct FUploadPagePoolStats
+{
+    uint32 NumPages = 0;
+    uint32 NumDedicatedPages = 0; // pages larger than PAGE_SIZE, for the allocations that don't fit in a page
+    uint64 MemorySize = 0;        // committed by all the pages
+    uint64 PeakMemoryInUse = 0;   // held by the heaps or waiting for the GPU
+};
+
+// Pool of persistently mapped upload heap pages shared by the per-thread DynamicBufferHeaps of a window.
+// The pages are recycled once the frame fence they're retired w/ is completed, new pages are created on demand.
+// Thread-safe.
+class UploadPagePool
 {
 public:
-    void Create(uint32_t TotalSize);
+    static constexpr uint32 PAGE_SIZE = 2 * MEGABYTE;
+    struct FPage
+    {
+        ID3D12Resource*           pResource = nullptr;
+        char*                     pData = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+        uint32                    Size = 0;
+    };
 
-    inline uint32_t GetSize() { return m_AllocatedSize; }
-    inline uint32_t GetHead() { return m_Head; }
-    inline uint32_t GetTail() { return (m_Head + m_AllocatedSize) % m_TotalSize; }
+    void   Create(ID3D12Device* pDevice, const char* name);
+    void   Destroy(); // GPU must be idle
 
-    //helper to avoid allocating chunks that wouldn't fit contiguously in the ring
-    uint32_t PaddingToAvoidCrossOver(uint32_t size);
-    bool Alloc(uint32_t size, uint32_t* pOut);
-    bool Free(uint32_t size);
+    FPage* AcquirePage(uint32 minSize); // returns nullptr if a new page can't be created
+    void   RetirePages(std::vector<FPage*>& pages, uint64 frameFence); // takes the pages
+    void   RecyclePages(uint64 completedFrameFence);
+
+    FUploadPagePoolStats GetStats() const;
 
 private:
-    uint32_t m_Head;
-    uint32_t m_AllocatedSize;
-    uint32_t m_TotalSize;
+    ID3D12Device*                          mpDevice = nullptr;
+    std::string                            mName;
+    mutable std::mutex                     mMtx;
+    std::vector<std::unique_ptr<FPage>>    mPages;
+    std::vector<FPage*>                    mFreePages;
+    std::deque<std::pair<uint64, FPage*>>  mRetiredPages; // <frame fence, page>, in fence order
+    uint64                                 mMemoryInUse = 0;
+    FUploadPagePoolStats                   mStats;
 };
 
-// 
-// This class can be thought as ring buffer inside a ring buffer. The outer ring is for , 
-// the frames and the internal one is for the resources that were allocated for that frame.
-// The size of the outer ring is typically the number of back buffers.
 //
-// When the outer ring is full, for the next allocation it automatically frees the entries 
-// of the oldest frame and makes those entries available for the next frame. This happens 
-// when you call 'OnBeginFrame()' 
+// DYNAMIC BUFFER HEAP
 //
-class RingBufferWithTabs
+struct FDynamicBufferHeapStats
 {
-public:
-    void Create(uint32_t numberOfBackBuffers, uint32_t memTotalSize);
-    void Destroy();
-    bool Alloc(uint32_t size, uint32_t* pOut);
-    void OnBeginFrame();
-
-private:
-    //internal ring buffer
-    RingBuffer m_mem;
-
-    //this is the external ring buffer (I could have reused the RingBuffer class though)
-    uint32_t m_backBufferIndex = 0;
-    uint32_t m_numberOfBackBuffers = 0;
-
-    uint32_t m_memAllocatedInFrame = 0;
-    uint32_t m_allocatedMemPerBackBuffer[4];
+    uint64 NumAllocations = 0;
+    uint64 NumBytesAllocated = 0; // incl. the alignment padding
+    uint64 NumPaddingBytes = 0;
+    uint64 PeakBytesPerFrame = 0;
 };
 
+// Typed view of the constant buffers allocated in one go w/ DynamicBufferHeap::AllocConstantBufferArray()
+template<class T>
+struct ConstantBufferArray
+{
+    char*                     pData = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+    uint32_t                  Stride = 0;
 
+    inline T& operator[](size_t i) const { return *reinterpret_cast<T*>(pData + i * Stride); }
+    inline D3D12_GPU_VIRTUAL_ADDRESS GetGPUAddress(size_t i) const { return GPUAddress + i * Stride; }
+};
 
-
-//
-// DYNAMIC BUFFER HEAP
-//
-class DynamicBufferHeap // RingBuffer Buffer with suballocated rings for perframe/perdraw data
+// Linear allocator for the per-frame data of a command recording thread: suballocates a chain of pages
+// acquired from the shared UploadPagePool as the frame needs them, and retires them at the next frame.
+// Not thread-safe: one heap per recording thread.
+class DynamicBufferHeap
 {
 public:
-    void Create(ID3D12Device* pDevice, uint32_t numberOfBackBuffers, uint32_t memTotalSize);
+    static constexpr uint32_t ALIGNMENT = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+    void Create(UploadPagePool* pPagePool);
     void Destroy();
 
     bool AllocIndexBuffer   (uint32_t numbeOfIndices , uint32_t strideInBytes, void** pData, D3D12_INDEX_BUFFER_VIEW* pView);
     bool AllocVertexBuffer  (uint32_t numbeOfVertices, uint32_t strideInBytes, void** pData, D3D12_VERTEX_BUFFER_VIEW* pView);
     bool AllocConstantBuffer(uint32_t size, void** pData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferViewDesc);
-    void OnBeginFrame();
+
+    // a single allocation for the per-draw constants of a view, the elements are aligned for the CBV root descriptors
+    template<class T> bool AllocConstantBufferArray(uint32_t numElements, ConstantBufferArray<T>& arr)
+    {
+        arr.Stride = AlignOffset(static_cast<uint32_t>(sizeof(T)), ALIGNMENT);
+        return Alloc(arr.Stride * numElements, static_cast<uint32_t>(sizeof(T)) * numElements, &arr.pData, &arr.GPUAddress);
+    }
+
+    void OnBeginFrame(uint64 frameFence); // retires the pages of the previous frame to the pool
+    inline const FDynamicBufferHeapStats& GetStats() const { return m_stats; }
+
+private:
+    bool Alloc(uint32_t size, uint32_t usedSize, char** ppData, D3D12_GPU_VIRTUAL_ADDRESS* pGPUAddress);
 
 private:
-    uint32_t            m_memTotalSize = 0;
-    RingBufferWithTabs  m_mem;
-    char* m_pData = nullptr;
-    ID3D12Resource* m_pBuffer = nullptr;
+    UploadPagePool*                     m_pPagePool = nullptr;
+    std::vector<UploadPagePool::FPage*> m_pages;      // pages of the current frame, allocating from the last one
+    uint32_t                            m_pageOffset = 0;
+    uint64                              m_frameFence = 1; // fence of the frame the pages are used in
+    uint64                              m_bytesThisFrame = 0;
+    FDynamicBufferHeapStats             m_stats;
 };
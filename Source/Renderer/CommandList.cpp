@@ -0,0 +1,162 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "CommandList.h"
+
+#include <cassert>
+
+namespace HAL
+{
+	FCommandListStats& FCommandListStats::operator+=(const FCommandListStats& Other)
+	{
+		NumDrawCalls               += Other.NumDrawCalls;
+		NumIndices                 += Other.NumIndices;
+		NumInstances               += Other.NumInstances;
+		NumPipelineStateChanges    += Other.NumPipelineStateChanges;
+		NumRootSignatureChanges    += Other.NumRootSignatureChanges;
+		NumConstantBufferViewBinds += Other.NumConstantBufferViewBinds;
+		NumDescriptorTableBinds    += Other.NumDescriptorTableBinds;
+		NumVertexBufferBinds       += Other.NumVertexBufferBinds;
+		NumIndexBufferBinds        += Other.NumIndexBufferBinds;
+		NumTopologyChanges         += Other.NumTopologyChanges;
+		NumRedundantStateChanges   += Other.NumRedundantStateChanges;
+		return *this;
+	}
+
+	void CommandList::Reset()
+	{
+		mPso = INVALID_ID;
+		mPsoKey = 0;
+		mRootSignature = INVALID_ID;
+		for (uint i = 0; i < MAX_ROOT_PARAMETERS; ++i)
+		{
+			mRootCBVs[i] = 0;
+			mRootDescriptorTables[i] = { INVALID_ID, 0 };
+		}
+		mTopology = EPrimitiveTopology::NUM_PRIMITIVE_TOPOLOGIES;
+		mVertexBuffer = INVALID_ID;
+		mIndexBuffer = INVALID_ID;
+		mStats = {};
+	}
+
+	void CommandList::SetPipelineState(PSO_ID Pso, PSOPermutationKey Key)
+	{
+		if (mbFilterRedundantState && Pso == mPso && Key == mPsoKey)
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		mPso = Pso;
+		mPsoKey = Key;
+		++mStats.NumPipelineStateChanges;
+		BackendSetPipelineState(Pso, Key);
+	}
+
+	void CommandList::SetGraphicsRootSignature(int RootSignature)
+	{
+		if (mbFilterRedundantState && RootSignature == mRootSignature)
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		mRootSignature = RootSignature;
+
+		// the root arguments are undefined after a root signature change
+		for (uint i = 0; i < MAX_ROOT_PARAMETERS; ++i)
+		{
+			mRootCBVs[i] = 0;
+			mRootDescriptorTables[i] = { INVALID_ID, 0 };
+		}
+		++mStats.NumRootSignatureChanges;
+		BackendSetGraphicsRootSignature(RootSignature);
+	}
+
+	void CommandList::SetGraphicsRootConstantBufferView(uint RootParameter, uint64 GPUAddress)
+	{
+		assert(RootParameter < MAX_ROOT_PARAMETERS);
+		if (mbFilterRedundantState && GPUAddress == mRootCBVs[RootParameter])
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		mRootCBVs[RootParameter] = GPUAddress;
+		mRootDescriptorTables[RootParameter] = { INVALID_ID, 0 };
+		++mStats.NumConstantBufferViewBinds;
+		BackendSetGraphicsRootConstantBufferView(RootParameter, GPUAddress);
+	}
+
+	void CommandList::SetGraphicsRootDescriptorTable(uint RootParameter, SRV_ID Srv, uint iDescriptor)
+	{
+		assert(RootParameter < MAX_ROOT_PARAMETERS);
+		FDescriptorTable& Table = mRootDescriptorTables[RootParameter];
+		if (mbFilterRedundantState && Srv == Table.Srv && iDescriptor == Table.iDescriptor)
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		Table = { Srv, iDescriptor };
+		mRootCBVs[RootParameter] = 0;
+		++mStats.NumDescriptorTableBinds;
+		BackendSetGraphicsRootDescriptorTable(RootParameter, Srv, iDescriptor);
+	}
+
+	void CommandList::SetPrimitiveTopology(EPrimitiveTopology Topology)
+	{
+		if (mbFilterRedundantState && Topology == mTopology)
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		mTopology = Topology;
+		++mStats.NumTopologyChanges;
+		BackendSetPrimitiveTopology(Topology);
+	}
+
+	void CommandList::SetVertexBuffer(BufferID VertexBuffer)
+	{
+		if (mbFilterRedundantState && VertexBuffer == mVertexBuffer)
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		mVertexBuffer = VertexBuffer;
+		++mStats.NumVertexBufferBinds;
+		BackendSetVertexBuffer(VertexBuffer);
+	}
+
+	void CommandList::SetIndexBuffer(BufferID IndexBuffer)
+	{
+		if (mbFilterRedundantState && IndexBuffer == mIndexBuffer)
+		{
+			++mStats.NumRedundantStateChanges;
+			return;
+		}
+		mIndexBuffer = IndexBuffer;
+		++mStats.NumIndexBufferBinds;
+		BackendSetIndexBuffer(IndexBuffer);
+	}
+
+	void CommandList::DrawIndexedInstanced(uint NumIndices, uint NumInstances, uint FirstIndex, int BaseVertex, uint FirstInstance)
+	{
+		assert(mPso != INVALID_ID && mRootSignature != INVALID_ID);
+		++mStats.NumDrawCalls;
+		mStats.NumIndices += NumIndices;
+		mStats.NumInstances += NumInstances;
+		BackendDrawIndexedInstanced(NumIndices, NumInstances, FirstIndex, BaseVertex, FirstInstance);
+	}
+}
@@ -0,0 +1,152 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+#include "PSOPermutations.h"
+
+struct ID3D12GraphicsCommandList;
+class VQRenderer;
+
+//----------------------------------------------------------------------------------------------------------------
+// RENDERING HAL
+//----------------------------------------------------------------------------------------------------------------
+// Backend agnostic command recording for the draw loops of the scene passes. Resources are referred to w/ the
+// renderer IDs and the backends resolve them. Redundant state is filtered before it reaches the backend, so the
+// backends only see the state changes & draws, which are counted in FCommandListStats.
+//
+// The filtering assumes the HAL owns the state while the CommandList lives: don't set the same state through
+// the native command list in between.
+namespace HAL
+{
+	enum class EBackend
+	{
+		D3D12 = 0,
+		NULL_BACKEND, // records nothing, for testing the state filtering
+
+		NUM_BACKENDS
+	};
+
+	enum class EPrimitiveTopology
+	{
+		TRIANGLE_LIST = 0,
+		LINE_LIST,
+
+		NUM_PRIMITIVE_TOPOLOGIES
+	};
+
+	constexpr uint MAX_ROOT_PARAMETERS = 16;
+
+	struct FCommandListStats
+	{
+		uint64 NumDrawCalls = 0;
+		uint64 NumIndices = 0;
+		uint64 NumInstances = 0;
+
+		// state changes that reached the backend
+		uint64 NumPipelineStateChanges = 0;
+		uint64 NumRootSignatureChanges = 0;
+		uint64 NumConstantBufferViewBinds = 0;
+		uint64 NumDescriptorTableBinds = 0;
+		uint64 NumVertexBufferBinds = 0;
+		uint64 NumIndexBufferBinds = 0;
+		uint64 NumTopologyChanges = 0;
+
+		uint64 NumRedundantStateChanges = 0; // filtered
+
+		inline uint64 GetNumStateChanges() const
+		{
+			return NumPipelineStateChanges + NumRootSignatureChanges + NumConstantBufferViewBinds + NumDescriptorTableBinds
+				+ NumVertexBufferBinds + NumIndexBufferBinds + NumTopologyChanges;
+		}
+		FCommandListStats& operator+=(const FCommandListStats& Other);
+	};
+
+	class CommandList
+	{
+	public:
+		virtual ~CommandList() = default;
+
+		void SetPipelineState(PSO_ID Pso, PSOPermutationKey Key = 0);
+		void SetGraphicsRootSignature(int RootSignature);
+		void SetGraphicsRootConstantBufferView(uint RootParameter, uint64 GPUAddress);
+		void SetGraphicsRootDescriptorTable(uint RootParameter, SRV_ID Srv, uint iDescriptor = 0);
+		void SetPrimitiveTopology(EPrimitiveTopology Topology);
+		void SetVertexBuffer(BufferID VertexBuffer);
+		void SetIndexBuffer(BufferID IndexBuffer);
+		void DrawIndexedInstanced(uint NumIndices, uint NumInstances, uint FirstIndex = 0, int BaseVertex = 0, uint FirstInstance = 0);
+
+		inline EBackend                 GetBackend() const { return mBackend; }
+		inline const FCommandListStats& GetStats() const { return mStats; }
+		inline void                     SetStateFiltering(bool bEnabled) { mbFilterRedundantState = bEnabled; }
+		void                            Reset(); // forgets the bound state & zeroes the stats, for reusing the list in a new recording
+
+	protected:
+		explicit CommandList(EBackend Backend) : mBackend(Backend) { Reset(); }
+
+		virtual void BackendSetPipelineState(PSO_ID Pso, PSOPermutationKey Key) = 0;
+		virtual void BackendSetGraphicsRootSignature(int RootSignature) = 0;
+		virtual void BackendSetGraphicsRootConstantBufferView(uint RootParameter, uint64 GPUAddress) = 0;
+		virtual void BackendSetGraphicsRootDescriptorTable(uint RootParameter, SRV_ID Srv, uint iDescriptor) = 0;
+		virtual void BackendSetPrimitiveTopology(EPrimitiveTopology Topology) = 0;
+		virtual void BackendSetVertexBuffer(BufferID VertexBuffer) = 0;
+		virtual void BackendSetIndexBuffer(BufferID IndexBuffer) = 0;
+		virtual void BackendDrawIndexedInstanced(uint NumIndices, uint NumInstances, uint FirstIndex, int BaseVertex, uint FirstInstance) = 0;
+
+	private:
+		// bound state, INVALID_ID/-1 when unknown
+		struct FDescriptorTable { SRV_ID Srv; uint iDescriptor; };
+		PSO_ID             mPso;
+		PSOPermutationKey  mPsoKey;
+		int                mRootSignature;
+		uint64             mRootCBVs[MAX_ROOT_PARAMETERS];
+		FDescriptorTable   mRootDescriptorTables[MAX_ROOT_PARAMETERS];
+		EPrimitiveTopology mTopology;
+		BufferID           mVertexBuffer;
+		BufferID           mIndexBuffer;
+
+		FCommandListStats  mStats;
+		const EBackend     mBackend;
+		bool               mbFilterRedundantState = true;
+	};
+
+	// Forwards to a native command list, resolves the IDs through the renderer
+	class D3D12CommandList : public CommandList
+	{
+	public:
+		D3D12CommandList(ID3D12GraphicsCommandList* pCmd, VQRenderer& Renderer)
+			: CommandList(EBackend::D3D12), mpCmd(pCmd), mRenderer(Renderer) {}
+
+		inline ID3D12GraphicsCommandList* GetNative() const { return mpCmd; }
+
+	protected:
+		void BackendSetPipelineState(PSO_ID Pso, PSOPermutationKey Key) override;
+		void BackendSetGraphicsRootSignature(int RootSignature) override;
+		void BackendSetGraphicsRootConstantBufferView(uint RootParameter, uint64 GPUAddress) override;
+		void BackendSetGraphicsRootDescriptorTable(uint RootParameter, SRV_ID Srv, uint iDescriptor) override;
+		void BackendSetPrimitiveTopology(EPrimitiveTopology Topology) override;
+		void BackendSetVertexBuffer(BufferID VertexBuffer) override;
+		void BackendSetIndexBuffer(BufferID IndexBuffer) override;
+		void BackendDrawIndexedInstanced(uint NumIndices, uint NumInstances, uint FirstIndex, int BaseVertex, uint FirstInstance) override;
+
+	private:
+		ID3D12GraphicsCommandList* mpCmd;
+		VQRenderer&                mRenderer;
+	};
+}
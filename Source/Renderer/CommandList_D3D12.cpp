@@ -0,0 +1,70 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "CommandList.h"
+#include "Renderer.h"
+
+#include <d3d12.h>
+
+namespace HAL
+{
+	static D3D_PRIMITIVE_TOPOLOGY GetD3D12PrimitiveTopology(EPrimitiveTopology Topology)
+	{
+		switch (Topology)
+		{
+		case EPrimitiveTopology::TRIANGLE_LIST: return D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		case EPrimitiveTopology::LINE_LIST    : return D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+		}
+		return D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	}
+
+	void D3D12CommandList::BackendSetPipelineState(PSO_ID Pso, PSOPermutationKey Key)
+	{
+		mpCmd->SetPipelineState(mRenderer.GetPSO(static_cast<EBuiltinPSOs>(Pso), Key));
+	}
+	void D3D12CommandList::BackendSetGraphicsRootSignature(int RootSignature)
+	{
+		mpCmd->SetGraphicsRootSignature(mRenderer.GetRootSignature(RootSignature));
+	}
+	void D3D12CommandList::BackendSetGraphicsRootConstantBufferView(uint RootParameter, uint64 GPUAddress)
+	{
+		mpCmd->SetGraphicsRootConstantBufferView(RootParameter, GPUAddress);
+	}
+	void D3D12CommandList::BackendSetGraphicsRootDescriptorTable(uint RootParameter, SRV_ID Srv, uint iDescriptor)
+	{
+		mpCmd->SetGraphicsRootDescriptorTable(RootParameter, mRenderer.GetSRV(Srv).GetGPUDescHandle(iDescriptor));
+	}
+	void D3D12CommandList::BackendSetPrimitiveTopology(EPrimitiveTopology Topology)
+	{
+		mpCmd->IASetPrimitiveTopology(GetD3D12PrimitiveTopology(Topology));
+	}
+	void D3D12CommandList::BackendSetVertexBuffer(BufferID VertexBuffer)
+	{
+		const VBV& vb = mRenderer.GetVertexBufferView(VertexBuffer);
+		mpCmd->IASetVertexBuffers(0, 1, &vb);
+	}
+	void D3D12CommandList::BackendSetIndexBuffer(BufferID IndexBuffer)
+	{
+		const IBV& ib = mRenderer.GetIndexBufferView(IndexBuffer);
+		mpCmd->IASetIndexBuffer(&ib);
+	}
+	void D3D12CommandList::BackendDrawIndexedInstanced(uint NumIndices, uint NumInstances, uint FirstIndex, int BaseVertex, uint FirstInstance)
+	{
+		mpCmd->DrawIndexedInstanced(NumIndices, NumInstances, FirstIndex, BaseVertex, FirstInstance);
+	}
+}
@@ -0,0 +1,79 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "DeferredDeletionQueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+void DeferredDeletionQueue::Enqueue(uint64 SafeAfterFenceValue, ReleaseFn_t&& fnRelease)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mPending.push_back({ SafeAfterFenceValue, std::move(fnRelease) });
+	++mStats.NumEnqueued;
+	mStats.MaxNumPending = std::max(mStats.MaxNumPending, static_cast<uint>(mPending.size()));
+}
+
+uint DeferredDeletionQueue::Process(uint64 CompletedFenceValue, float TimeBudgetMs)
+{
+	using clock = std::chrono::steady_clock;
+	const clock::time_point tStart = clock::now();
+	uint NumReleased = 0;
+	while (true)
+	{
+		ReleaseFn_t fnRelease;
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			if (mPending.empty() || mPending.front().SafeAfterFenceValue > CompletedFenceValue)
+				break;
+			if (NumReleased > 0 && std::chrono::duration<float, std::milli>(clock::now() - tStart).count() > TimeBudgetMs)
+			{
+				++mStats.NumBudgetOverruns;
+				break;
+			}
+			fnRelease = std::move(mPending.front().fnRelease);
+			mPending.pop_front();
+			++mStats.NumReleased;
+		}
+		fnRelease(); // outside the lock, releasing a resource can take a while
+		++NumReleased;
+	}
+	return NumReleased;
+}
+
+uint DeferredDeletionQueue::ReleaseAll()
+{
+	std::deque<FPendingRelease> Pending;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		Pending.swap(mPending);
+		mStats.NumReleased += Pending.size();
+	}
+	for (FPendingRelease& Release : Pending)
+		Release.fnRelease();
+	return static_cast<uint>(Pending.size());
+}
+
+FDeferredDeletionStats DeferredDeletionQueue::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	FDeferredDeletionStats Stats = mStats;
+	Stats.NumPending = static_cast<uint>(mPending.size());
+	return Stats;
+}
@@ -0,0 +1,81 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// CPU side of the frame fence: counts the submitted frames, the render thread signals each value on the GPU
+// queue after submitting the frame's command lists. A resource destroyed now might still be referenced by the
+// frame being recorded, which is submitted next: it's safe after GetRecordingFrameFence() completes.
+class FrameFenceTracker
+{
+public:
+	inline uint64 OnFrameSubmitted()                   { return mLastSubmittedFrameFence.fetch_add(1) + 1; } // the value to signal
+	inline uint64 GetLastSubmittedFrameFence() const   { return mLastSubmittedFrameFence.load(); }
+	inline uint64 GetRecordingFrameFence() const       { return mLastSubmittedFrameFence.load() + 1; }
+
+private:
+	std::atomic<uint64> mLastSubmittedFrameFence{ 0 }; // the GPU fence starts at 0: nothing is completed
+};
+
+struct FDeferredDeletionStats
+{
+	uint64 NumEnqueued = 0;
+	uint64 NumReleased = 0;
+	uint   NumPending = 0;
+	uint   MaxNumPending = 0;
+	uint   NumBudgetOverruns = 0; // # Process() calls that left releasable items behind to stay within the time budget
+};
+
+// Defers the release of the GPU resources until the frame fence value they're safe after is completed,
+// so that destroying a resource doesn't require the GPU to be idle. The releases are drained each frame
+// within a time budget, the remaining ones carry over to the next frame.
+// Doesn't know about the graphics API: the fence values are passed in, so a fake fence clock can drive it.
+// Thread-safe: any thread can enqueue, Process() is called by the render thread.
+class DeferredDeletionQueue
+{
+public:
+	using ReleaseFn_t = std::function<void()>;
+
+	void Enqueue(uint64 SafeAfterFenceValue, ReleaseFn_t&& fnRelease);
+
+	// releases the items w/ SafeAfterFenceValue <= CompletedFenceValue, at least one per call so the queue
+	// keeps draining even if a release exceeds the budget. Returns the # items released.
+	uint Process(uint64 CompletedFenceValue, float TimeBudgetMs);
+
+	uint ReleaseAll(); // GPU must be idle
+
+	FDeferredDeletionStats GetStats() const;
+
+private:
+	struct FPendingRelease
+	{
+		uint64      SafeAfterFenceValue;
+		ReleaseFn_t fnRelease;
+	};
+	mutable std::mutex          mMtx;
+	std::deque<FPendingRelease> mPending; // roughly in fence order: the enqueuing threads may race by a frame
+	FDeferredDeletionStats      mStats;
+};
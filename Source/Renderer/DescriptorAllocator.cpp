@@ -0,0 +1,445 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "DescriptorAllocator.h"
+#include "DeferredDeletionQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static inline uint32 FindFirstSetBit(uint32 Value) // Value != 0
+{
+#if defined(_MSC_VER)
+	unsigned long Index; _BitScanForward(&Index, Value); return static_cast<uint32>(Index);
+#else
+	return static_cast<uint32>(__builtin_ctz(Value));
+#endif
+}
+static inline uint32 FindLastSetBit(uint32 Value) // Value != 0
+{
+#if defined(_MSC_VER)
+	unsigned long Index; _BitScanReverse(&Index, Value); return static_cast<uint32>(Index);
+#else
+	return static_cast<uint32>(31 - __builtin_clz(Value));
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------------------
+// RANGE ALLOCATOR
+//-------------------------------------------------------------------------------------------------------------
+void DescriptorRangeAllocator::Initialize(uint32 Size)
+{
+	mBlocks.clear();
+	mUnusedBlocks.clear();
+	mAllocatedBlocks.assign(Size, INVALID_BLOCK);
+	mFLBitmap = 0;
+	for (uint32 fl = 0; fl < FL_COUNT; ++fl)
+	{
+		mSLBitmaps[fl] = 0;
+		for (uint32 sl = 0; sl < SL_COUNT; ++sl)
+			mFreeLists[fl][sl] = INVALID_BLOCK;
+	}
+
+	mSize = Size;
+	mNumFree = Size;
+	mNumFreeRanges = 0;
+	if (Size > 0)
+	{
+		InsertFreeBlock(NewBlock(0, Size));
+	}
+}
+
+// size class of a range: ranges smaller than SL_COUNT map to fl=0 linearly,
+// the larger ones to the power of 2 they're in & one of its SL_COUNT subdivisions.
+static inline void MapSizeClass(uint32 Size, uint32 SL_LOG2, uint32& fl, uint32& sl)
+{
+	const uint32 SL_COUNT = 1u << SL_LOG2;
+	if (Size < SL_COUNT)
+	{
+		fl = 0;
+		sl = Size;
+		return;
+	}
+	const uint32 Log2 = FindLastSetBit(Size);
+	sl = (Size >> (Log2 - SL_LOG2)) ^ SL_COUNT;
+	fl = Log2 - SL_LOG2 + 1;
+}
+
+uint32 DescriptorRangeAllocator::NewBlock(uint32 Offset, uint32 Size)
+{
+	uint32 iBlock = INVALID_BLOCK;
+	if (!mUnusedBlocks.empty())
+	{
+		iBlock = mUnusedBlocks.back();
+		mUnusedBlocks.pop_back();
+	}
+	else
+	{
+		iBlock = static_cast<uint32>(mBlocks.size());
+		mBlocks.emplace_back();
+	}
+	mBlocks[iBlock] = FBlock{};
+	mBlocks[iBlock].Offset = Offset;
+	mBlocks[iBlock].Size = Size;
+	return iBlock;
+}
+
+void DescriptorRangeAllocator::ReleaseBlock(uint32 iBlock)
+{
+	mUnusedBlocks.push_back(iBlock);
+}
+
+void DescriptorRangeAllocator::InsertFreeBlock(uint32 iBlock)
+{
+	FBlock& Block = mBlocks[iBlock];
+	uint32 fl, sl;
+	MapSizeClass(Block.Size, SL_LOG2, fl, sl);
+
+	const uint32 iHead = mFreeLists[fl][sl];
+	Block.bFree = true;
+	Block.PrevFree = INVALID_BLOCK;
+	Block.NextFree = iHead;
+	if (iHead != INVALID_BLOCK)
+		mBlocks[iHead].PrevFree = iBlock;
+	mFreeLists[fl][sl] = iBlock;
+
+	mFLBitmap |= 1u << fl;
+	mSLBitmaps[fl] |= 1u << sl;
+	++mNumFreeRanges;
+}
+
+void DescriptorRangeAllocator::RemoveFreeBlock(uint32 iBlock)
+{
+	FBlock& Block = mBlocks[iBlock];
+	uint32 fl, sl;
+	MapSizeClass(Block.Size, SL_LOG2, fl, sl);
+
+	if (Block.PrevFree != INVALID_BLOCK) mBlocks[Block.PrevFree].NextFree = Block.NextFree;
+	if (Block.NextFree != INVALID_BLOCK) mBlocks[Block.NextFree].PrevFree = Block.PrevFree;
+	if (mFreeLists[fl][sl] == iBlock)
+	{
+		mFreeLists[fl][sl] = Block.NextFree;
+		if (Block.NextFree == INVALID_BLOCK)
+		{
+			mSLBitmaps[fl] &= ~(1u << sl);
+			if (mSLBitmaps[fl] == 0)
+				mFLBitmap &= ~(1u << fl);
+		}
+	}
+	Block.bFree = false;
+	Block.PrevFree = Block.NextFree = INVALID_BLOCK;
+	--mNumFreeRanges;
+}
+
+uint32 DescriptorRangeAllocator::FindFreeBlock(uint32 Size) const
+{
+	// round the size up to the next size class so that any range in the found list fits
+	uint32 SearchSize = Size;
+	if (SearchSize >= SL_COUNT)
+		SearchSize += (1u << (FindLastSetBit(SearchSize) - SL_LOG2)) - 1;
+
+	uint32 fl, sl;
+	MapSizeClass(SearchSize, SL_LOG2, fl, sl);
+	if (fl < FL_COUNT)
+	{
+		uint32 SLBitmap = mSLBitmaps[fl] & (~0u << sl);
+		if (SLBitmap == 0)
+		{
+			const uint32 FLBitmap = fl + 1 < 32 ? (mFLBitmap & (~0u << (fl + 1))) : 0;
+			if (FLBitmap != 0)
+			{
+				fl = FindFirstSetBit(FLBitmap);
+				SLBitmap = mSLBitmaps[fl];
+			}
+		}
+		if (SLBitmap != 0)
+			return mFreeLists[fl][FindFirstSetBit(SLBitmap)];
+	}
+
+	// the only ranges large enough might share the size class w/ the smaller ones: look through its list
+	MapSizeClass(Size, SL_LOG2, fl, sl);
+	for (uint32 iBlock = mFreeLists[fl][sl]; iBlock != INVALID_BLOCK; iBlock = mBlocks[iBlock].NextFree)
+	{
+		if (mBlocks[iBlock].Size >= Size)
+			return iBlock;
+	}
+	return INVALID_BLOCK;
+}
+
+uint32 DescriptorRangeAllocator::Allocate(uint32 Count)
+{
+	assert(Count > 0);
+	if (Count == 0 || Count > mNumFree)
+		return INVALID_OFFSET;
+
+	const uint32 iBlock = FindFreeBlock(Count);
+	if (iBlock == INVALID_BLOCK)
+		return INVALID_OFFSET;
+	RemoveFreeBlock(iBlock);
+
+	// split the remainder off into a free range
+	if (mBlocks[iBlock].Size > Count)
+	{
+		const uint32 iRemainder = NewBlock(mBlocks[iBlock].Offset + Count, mBlocks[iBlock].Size - Count); // may reallocate mBlocks
+		FBlock& Block = mBlocks[iBlock];
+		FBlock& Remainder = mBlocks[iRemainder];
+		Remainder.PrevPhys = iBlock;
+		Remainder.NextPhys = Block.NextPhys;
+		if (Block.NextPhys != INVALID_BLOCK)
+			mBlocks[Block.NextPhys].PrevPhys = iRemainder;
+		Block.NextPhys = iRemainder;
+		Block.Size = Count;
+		InsertFreeBlock(iRemainder);
+	}
+
+	const uint32 Offset = mBlocks[iBlock].Offset;
+	mAllocatedBlocks[Offset] = iBlock;
+	mNumFree -= Count;
+	return Offset;
+}
+
+uint32 DescriptorRangeAllocator::Free(uint32 Offset)
+{
+	assert(Offset < mSize && mAllocatedBlocks[Offset] != INVALID_BLOCK);
+	if (Offset >= mSize || mAllocatedBlocks[Offset] == INVALID_BLOCK)
+		return 0;
+
+	uint32 iBlock = mAllocatedBlocks[Offset];
+	mAllocatedBlocks[Offset] = INVALID_BLOCK;
+	const uint32 Count = mBlocks[iBlock].Size;
+	mNumFree += Count;
+
+	// coalesce w/ the free neighbors
+	const uint32 iPrev = mBlocks[iBlock].PrevPhys;
+	if (iPrev != INVALID_BLOCK && mBlocks[iPrev].bFree)
+	{
+		RemoveFreeBlock(iPrev);
+		mBlocks[iPrev].Size += mBlocks[iBlock].Size;
+		mBlocks[iPrev].NextPhys = mBlocks[iBlock].NextPhys;
+		if (mBlocks[iBlock].NextPhys != INVALID_BLOCK)
+			mBlocks[mBlocks[iBlock].NextPhys].PrevPhys = iPrev;
+		ReleaseBlock(iBlock);
+		iBlock = iPrev;
+	}
+	const uint32 iNext = mBlocks[iBlock].NextPhys;
+	if (iNext != INVALID_BLOCK && mBlocks[iNext].bFree)
+	{
+		RemoveFreeBlock(iNext);
+		mBlocks[iBlock].Size += mBlocks[iNext].Size;
+		mBlocks[iBlock].NextPhys = mBlocks[iNext].NextPhys;
+		if (mBlocks[iNext].NextPhys != INVALID_BLOCK)
+			mBlocks[mBlocks[iNext].NextPhys].PrevPhys = iBlock;
+		ReleaseBlock(iNext);
+	}
+
+	InsertFreeBlock(iBlock);
+	return Count;
+}
+
+uint32 DescriptorRangeAllocator::GetLargestFreeRange() const
+{
+	if (mFLBitmap == 0)
+		return 0;
+	const uint32 fl = FindLastSetBit(mFLBitmap);
+	const uint32 sl = FindLastSetBit(mSLBitmaps[fl]);
+	uint32 Largest = 0;
+	for (uint32 iBlock = mFreeLists[fl][sl]; iBlock != INVALID_BLOCK; iBlock = mBlocks[iBlock].NextFree)
+		Largest = std::max(Largest, mBlocks[iBlock].Size);
+	return Largest;
+}
+
+
+//-------------------------------------------------------------------------------------------------------------
+// DESCRIPTOR ALLOCATOR
+//-------------------------------------------------------------------------------------------------------------
+static uint32 GetThreadCacheIndex()
+{
+	static std::atomic<uint32> sNumThreads{ 0 };
+	thread_local const uint32 ThreadCacheIndex = sNumThreads.fetch_add(1) % DescriptorAllocator::MAX_THREAD_CACHES;
+	return ThreadCacheIndex;
+}
+
+void DescriptorAllocator::Initialize(uint32 NumDescriptors, uint32 ThreadCacheSize, const FrameFenceTracker* pFrameFences)
+{
+	assert(pFrameFences);
+	// same lock order as the allocations: a thread cache, then the allocator
+	for (FThreadCache& Cache : mThreadCaches)
+	{
+		std::lock_guard<std::mutex> lkCache(Cache.Mtx);
+		Cache.Offsets.clear();
+		Cache.Offsets.reserve(ThreadCacheSize);
+	}
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mRanges.Initialize(NumDescriptors);
+		mPendingFrees.clear();
+		mNumPendingFree = 0;
+		mpFrameFences = pFrameFences;
+		mThreadCacheSize = ThreadCacheSize;
+	}
+
+	mNumAllocated = mPeakAllocated = mNumCached = 0;
+	mNumAllocations = mNumFrees = mNumCacheHits = mNumFailedAllocations = 0;
+}
+
+void DescriptorAllocator::OnAllocated(uint32 Count)
+{
+	const uint32 NumAllocated = mNumAllocated.fetch_add(Count, std::memory_order_relaxed) + Count;
+	uint32 Peak = mPeakAllocated.load(std::memory_order_relaxed);
+	while (NumAllocated > Peak && !mPeakAllocated.compare_exchange_weak(Peak, NumAllocated, std::memory_order_relaxed));
+	mNumAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32 DescriptorAllocator::AllocateFromThreadCache()
+{
+	FThreadCache& Cache = mThreadCaches[GetThreadCacheIndex()];
+	std::lock_guard<std::mutex> lkCache(Cache.Mtx); // only contended if more than MAX_THREAD_CACHES threads allocate
+	if (Cache.Offsets.empty())
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		while (Cache.Offsets.size() < mThreadCacheSize)
+		{
+			const uint32 Offset = mRanges.Allocate(1);
+			if (Offset == INVALID_OFFSET)
+				break;
+			Cache.Offsets.push_back(Offset);
+		}
+		// hand out the lowest offsets first so that the cached descriptors stay packed
+		std::sort(Cache.Offsets.begin(), Cache.Offsets.end(), std::greater<uint32>());
+		mNumCached.fetch_add(static_cast<uint32>(Cache.Offsets.size()), std::memory_order_relaxed);
+		if (Cache.Offsets.empty())
+			return INVALID_OFFSET;
+	}
+	else
+	{
+		mNumCacheHits.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const uint32 Offset = Cache.Offsets.back();
+	Cache.Offsets.pop_back();
+	mNumCached.fetch_sub(1, std::memory_order_relaxed);
+	OnAllocated(1);
+	return Offset;
+}
+
+uint32 DescriptorAllocator::AllocateRange(uint32 Count)
+{
+	uint32 Offset = INVALID_OFFSET;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		Offset = mRanges.Allocate(Count);
+	}
+	if (Offset != INVALID_OFFSET)
+		OnAllocated(Count);
+	return Offset;
+}
+
+uint32 DescriptorAllocator::Allocate(uint32 Count)
+{
+	if (Count == 0)
+		return INVALID_OFFSET;
+
+	uint32 Offset = INVALID_OFFSET;
+	if (Count == 1 && mThreadCacheSize > 0)
+		Offset = AllocateFromThreadCache();
+	if (Offset == INVALID_OFFSET)
+		Offset = AllocateRange(Count);
+	if (Offset == INVALID_OFFSET && mThreadCacheSize > 0)
+	{
+		// the free descriptors might be sitting in the caches or fragmenting the heap
+		FlushThreadCaches();
+		Offset = AllocateRange(Count);
+	}
+
+	if (Offset == INVALID_OFFSET)
+		mNumFailedAllocations.fetch_add(1, std::memory_order_relaxed);
+	return Offset;
+}
+
+void DescriptorAllocator::Free(uint32 Offset, uint32 Count)
+{
+	if (Offset == INVALID_OFFSET || Count == 0)
+		return;
+	{
+		// read under the lock: the pending frees stay in fence order
+		std::lock_guard<std::mutex> lk(mMtx);
+		mPendingFrees.push_back({ Offset, Count, mpFrameFences->GetRecordingFrameFence() });
+		mNumPendingFree += Count;
+	}
+	mNumAllocated.fetch_sub(Count, std::memory_order_relaxed);
+	mNumFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DescriptorAllocator::ReleaseCompletedFrees(uint64 CompletedFrameFence)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+
+	// frees are queued in fence order
+	while (!mPendingFrees.empty() && mPendingFrees.front().FrameFence <= CompletedFrameFence)
+	{
+		const FPendingFree& PendingFree = mPendingFrees.front();
+		const uint32 NumFreed = mRanges.Free(PendingFree.Offset);
+		assert(NumFreed == PendingFree.Count); (void)NumFreed;
+		mNumPendingFree -= PendingFree.Count;
+		mPendingFrees.pop_front();
+	}
+}
+
+void DescriptorAllocator::FlushThreadCaches()
+{
+	for (FThreadCache& Cache : mThreadCaches)
+	{
+		std::lock_guard<std::mutex> lkCache(Cache.Mtx);
+		if (Cache.Offsets.empty())
+			continue;
+
+		std::lock_guard<std::mutex> lk(mMtx);
+		for (uint32 Offset : Cache.Offsets)
+			mRanges.Free(Offset);
+		mNumCached.fetch_sub(static_cast<uint32>(Cache.Offsets.size()), std::memory_order_relaxed);
+		Cache.Offsets.clear();
+	}
+}
+
+FDescriptorAllocatorStats DescriptorAllocator::GetStats() const
+{
+	FDescriptorAllocatorStats Stats;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		Stats.NumDescriptors   = mRanges.GetSize();
+		Stats.NumFree          = mRanges.GetNumFree();
+		Stats.NumFreeRanges    = mRanges.GetNumFreeRanges();
+		Stats.LargestFreeRange = mRanges.GetLargestFreeRange();
+		Stats.NumPendingFree   = mNumPendingFree;
+	}
+	Stats.NumAllocated         = mNumAllocated.load(std::memory_order_relaxed);
+	Stats.NumCached            = mNumCached.load(std::memory_order_relaxed);
+	Stats.PeakAllocated        = mPeakAllocated.load(std::memory_order_relaxed);
+	Stats.NumAllocations       = mNumAllocations.load(std::memory_order_relaxed);
+	Stats.NumFrees             = mNumFrees.load(std::memory_order_relaxed);
+	Stats.NumCacheHits         = mNumCacheHits.load(std::memory_order_relaxed);
+	Stats.NumFailedAllocations = mNumFailedAllocations.load(std::memory_order_relaxed);
+	Stats.Fragmentation = Stats.NumFree > 0 ? 1.0f - static_cast<float>(Stats.LargestFreeRange) / Stats.NumFree : 0.0f;
+	return Stats;
+}
@@ -0,0 +1,159 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+class FrameFenceTracker;
+
+// Two-level segregated fit (TLSF) allocator over the index range [0, Size) of a descriptor heap.
+// Free ranges are binned by size class (log2 & 16 linear subdivisions) w/ a bitmap per level, so
+// finding a fitting range & freeing (w/ coalescing of the adjacent free ranges) are O(1).
+// Doesn't know about the graphics API & isn't thread-safe: see DescriptorAllocator.
+class DescriptorRangeAllocator
+{
+public:
+	static constexpr uint32 INVALID_OFFSET = 0xFFFFFFFF;
+
+	void   Initialize(uint32 Size);
+	uint32 Allocate(uint32 Count); // returns INVALID_OFFSET if there's no free range large enough
+	uint32 Free(uint32 Offset);    // returns the # descriptors freed
+
+	inline uint32 GetSize() const { return mSize; }
+	inline uint32 GetNumFree() const { return mNumFree; }
+	inline uint32 GetNumFreeRanges() const { return mNumFreeRanges; }
+	uint32 GetLargestFreeRange() const;
+
+private:
+	static constexpr uint32 SL_LOG2  = 4;
+	static constexpr uint32 SL_COUNT = 1 << SL_LOG2;
+	static constexpr uint32 FL_COUNT = 32 - SL_LOG2 + 1;
+	static constexpr uint32 INVALID_BLOCK = 0xFFFFFFFF;
+
+	struct FBlock
+	{
+		uint32 Offset = 0;
+		uint32 Size = 0;
+		uint32 PrevPhys = INVALID_BLOCK; // adjacent ranges in the heap, for coalescing
+		uint32 NextPhys = INVALID_BLOCK;
+		uint32 PrevFree = INVALID_BLOCK; // free list of the size class
+		uint32 NextFree = INVALID_BLOCK;
+		bool   bFree = false;
+	};
+
+	uint32 NewBlock(uint32 Offset, uint32 Size);
+	void   ReleaseBlock(uint32 iBlock);
+	void   InsertFreeBlock(uint32 iBlock);
+	void   RemoveFreeBlock(uint32 iBlock);
+	uint32 FindFreeBlock(uint32 Size) const;
+
+private:
+	std::vector<FBlock> mBlocks;
+	std::vector<uint32> mUnusedBlocks;
+	std::vector<uint32> mAllocatedBlocks; // block index of the allocations by their offset
+
+	uint32 mFLBitmap = 0;
+	uint32 mSLBitmaps[FL_COUNT] = {};
+	uint32 mFreeLists[FL_COUNT][SL_COUNT];
+
+	uint32 mSize = 0;
+	uint32 mNumFree = 0;
+	uint32 mNumFreeRanges = 0;
+};
+
+struct FDescriptorAllocatorStats
+{
+	uint32 NumDescriptors = 0;
+	uint32 NumAllocated = 0;   // in use
+	uint32 NumPendingFree = 0; // freed but possibly still referenced by the frames in flight
+	uint32 NumCached = 0;      // reserved by the per-thread caches
+	uint32 NumFree = 0;
+	uint32 NumFreeRanges = 0;
+	uint32 LargestFreeRange = 0;
+	uint32 PeakAllocated = 0;
+	uint64 NumAllocations = 0;
+	uint64 NumFrees = 0;
+	uint64 NumCacheHits = 0;
+	uint64 NumFailedAllocations = 0;
+	float  Fragmentation = 0.0f; // 1 - LargestFreeRange/NumFree: 0 when the free descriptors are contiguous
+};
+
+// Thread-safe descriptor allocator on top of DescriptorRangeAllocator:
+// - Free() is deferred until the frame being recorded at the time of the call is completed on the GPU,
+//   so the descriptors of a destroyed view aren't overwritten while the GPU might still read them.
+// - Single descriptor allocations are served from small per-thread caches w/o taking the allocator lock.
+//   The caches are flushed back into the allocator when a range allocation can't be satisfied.
+class DescriptorAllocator
+{
+public:
+	static constexpr uint32 INVALID_OFFSET    = DescriptorRangeAllocator::INVALID_OFFSET;
+	static constexpr uint32 MAX_THREAD_CACHES = 16;
+
+	// ThreadCacheSize=0 disables the per-thread caches. The frees are tagged w/ pFrameFences->GetRecordingFrameFence().
+	void   Initialize(uint32 NumDescriptors, uint32 ThreadCacheSize, const FrameFenceTracker* pFrameFences);
+	uint32 Allocate(uint32 Count); // returns INVALID_OFFSET when the heap is exhausted
+	void   Free(uint32 Offset, uint32 Count);
+
+	// Releases the pending frees up to CompletedFrameFence, the value the GPU signaled last (0: no frame completed yet)
+	void   ReleaseCompletedFrees(uint64 CompletedFrameFence);
+	void   FlushThreadCaches();
+
+	FDescriptorAllocatorStats GetStats() const;
+
+private:
+	struct alignas(64) FThreadCache
+	{
+		std::mutex          Mtx;
+		std::vector<uint32> Offsets;
+	};
+	struct FPendingFree
+	{
+		uint32 Offset;
+		uint32 Count;
+		uint64 FrameFence;
+	};
+	uint32 AllocateFromThreadCache();
+	uint32 AllocateRange(uint32 Count);
+	void   OnAllocated(uint32 Count);
+
+private:
+	mutable std::mutex                             mMtx; // guards the range allocator & the pending frees
+	DescriptorRangeAllocator                       mRanges;
+	std::deque<FPendingFree>                       mPendingFrees;
+	uint32                                         mNumPendingFree = 0;
+	const FrameFenceTracker*                       mpFrameFences = nullptr;
+
+	uint32                                         mThreadCacheSize = 0;
+	std::array<FThreadCache, MAX_THREAD_CACHES>    mThreadCaches;
+
+	std::atomic<uint32>                            mNumAllocated{ 0 };
+	std::atomic<uint32>                            mPeakAllocated{ 0 };
+	std::atomic<uint32>                            mNumCached{ 0 };
+	std::atomic<uint64>                            mNumAllocations{ 0 };
+	std::atomic<uint64>                            mNumFrees{ 0 };
+	std::atomic<uint64>                            mNumCacheHits{ 0 };
+	std::atomic<uint64>                            mNumFailedAllocations{ 0 };
+};
@@ -0,0 +1,547 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "ImageProcessing.h"
+
+#include "../Engine/Core/ParallelFor.h"
+
+#include <immintrin.h>
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+// AVX2 kernels are compiled in when the compiler targets AVX2 (/arch:AVX2), SSE2 otherwise.
+// F16C ships with every AVX2 capable CPU, MSVC exposes it with /arch:AVX2.
+#if defined(__AVX2__)
+#define IMAGE_PROCESSING_AVX2 1
+#else
+#define IMAGE_PROCESSING_AVX2 0
+#endif
+#if IMAGE_PROCESSING_AVX2 && (defined(_MSC_VER) || defined(__F16C__))
+#define IMAGE_PROCESSING_F16C 1
+#else
+#define IMAGE_PROCESSING_F16C 0
+#endif
+
+// aim for a few chunks per worker so the threads that start late still get their share
+#define PARALLEL_CHUNKS_PER_THREAD 4
+
+using namespace ImageProcessing;
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// PIXEL CONVERSION
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static inline float HalfToFloat(uint16 h)
+{
+	const uint32 Sign = static_cast<uint32>(h & 0x8000u) << 16;
+	uint32 Exp  = (h >> 10) & 0x1Fu;
+	uint32 Mant = h & 0x3FFu;
+	uint32 Bits = Sign;
+	if (Exp == 0x1F)
+	{
+		Bits |= 0x7F800000u | (Mant << 13); // inf/nan
+	}
+	else if (Exp != 0)
+	{
+		Bits |= ((Exp + 127 - 15) << 23) | (Mant << 13);
+	}
+	else if (Mant != 0) // subnormal: normalize the mantissa
+	{
+		Exp = 127 - 15 + 1;
+		while ((Mant & 0x400u) == 0) { Mant <<= 1; --Exp; }
+		Bits |= (Exp << 23) | ((Mant & 0x3FFu) << 13);
+	}
+	float f; memcpy(&f, &Bits, sizeof(f));
+	return f;
+}
+static inline uint16 FloatToHalf(float f)
+{
+	uint32 Bits; memcpy(&Bits, &f, sizeof(Bits));
+	const uint32 Sign    = (Bits >> 16) & 0x8000u;
+	const uint32 AbsBits = Bits & 0x7FFFFFFFu;
+	if (AbsBits >= 0x7F800000u) return static_cast<uint16>(Sign | 0x7C00u | (AbsBits > 0x7F800000u ? 0x200u : 0u)); // inf/nan
+	if (AbsBits >= 0x477FF000u) return static_cast<uint16>(Sign | 0x7C00u); // rounds above 65504: inf
+	if (AbsBits <  0x38800000u) // below the smallest normal half: subnormal or zero
+	{
+		if (AbsBits < 0x33000000u) return static_cast<uint16>(Sign);
+		const uint32 Exp   = AbsBits >> 23;
+		const uint32 Mant  = (AbsBits & 0x7FFFFFu) | 0x800000u;
+		const uint32 Shift = 126 - Exp;
+		return static_cast<uint16>(Sign | ((Mant + (1u << (Shift - 1))) >> Shift));
+	}
+	const uint32 Rounded = AbsBits + 0xFFFu + ((AbsBits >> 13) & 1u); // round to nearest even
+	return static_cast<uint16>(Sign | ((Rounded - (112u << 23)) >> 13));
+}
+
+struct FSRGBTables
+{
+	float SRGBToLinear[256];
+	float EncodeThresholds[255]; // linear value half way between two consecutive sRGB codes
+
+	FSRGBTables()
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			const double c = i / 255.0;
+			SRGBToLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+		}
+		for (int i = 0; i < 255; ++i)
+		{
+			EncodeThresholds[i] = 0.5f * (SRGBToLinear[i] + SRGBToLinear[i + 1]);
+		}
+	}
+};
+static const FSRGBTables& GetSRGBTables()
+{
+	static const FSRGBTables Tables;
+	return Tables;
+}
+static inline uint8 LinearToSRGB8(const FSRGBTables& Tables, float v)
+{
+	// the number of thresholds below v is the nearest sRGB code
+	return static_cast<uint8>(std::upper_bound(Tables.EncodeThresholds, Tables.EncodeThresholds + 255, v) - Tables.EncodeThresholds);
+}
+
+// pOut: NumPixels x float4
+static void DecodeRow(const uint8* pRow, EPixelFormat Format, uint NumPixels, float* pOut)
+{
+	switch (Format)
+	{
+	case EPixelFormat::RGBA8_UNORM:
+	{
+		const __m128  Inv255 = _mm_set1_ps(1.0f / 255.0f);
+		const __m128i Zero   = _mm_setzero_si128();
+		uint x = 0;
+		for (; x + 4 <= NumPixels; x += 4)
+		{
+			const __m128i Texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x * 4));
+			const __m128i Lo = _mm_unpacklo_epi8(Texels, Zero);
+			const __m128i Hi = _mm_unpackhi_epi8(Texels, Zero);
+			_mm_storeu_ps(pOut + (x + 0) * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(Lo, Zero)), Inv255));
+			_mm_storeu_ps(pOut + (x + 1) * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(Lo, Zero)), Inv255));
+			_mm_storeu_ps(pOut + (x + 2) * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(Hi, Zero)), Inv255));
+			_mm_storeu_ps(pOut + (x + 3) * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(Hi, Zero)), Inv255));
+		}
+		for (; x < NumPixels; ++x)
+		{
+			for (int c = 0; c < 4; ++c) pOut[x * 4 + c] = pRow[x * 4 + c] / 255.0f;
+		}
+	}	break;
+	case EPixelFormat::RGBA8_UNORM_SRGB:
+	{
+		const FSRGBTables& Tables = GetSRGBTables();
+		for (uint x = 0; x < NumPixels; ++x)
+		{
+			pOut[x * 4 + 0] = Tables.SRGBToLinear[pRow[x * 4 + 0]];
+			pOut[x * 4 + 1] = Tables.SRGBToLinear[pRow[x * 4 + 1]];
+			pOut[x * 4 + 2] = Tables.SRGBToLinear[pRow[x * 4 + 2]];
+			pOut[x * 4 + 3] = pRow[x * 4 + 3] / 255.0f;
+		}
+	}	break;
+	case EPixelFormat::RGBA16_FLOAT:
+	{
+		const uint16* pHalf = reinterpret_cast<const uint16*>(pRow);
+#if IMAGE_PROCESSING_F16C
+		for (uint x = 0; x < NumPixels; ++x)
+		{
+			_mm_storeu_ps(pOut + x * 4, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pHalf + x * 4))));
+		}
+#else
+		for (uint i = 0; i < NumPixels * 4; ++i) pOut[i] = HalfToFloat(pHalf[i]);
+#endif
+	}	break;
+	case EPixelFormat::RGBA32_FLOAT:
+		memcpy(pOut, pRow, NumPixels * 4 * sizeof(float));
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+// pIn: NumPixels x float4
+static void EncodeRow(const float* pIn, EPixelFormat Format, uint NumPixels, uint8* pRow)
+{
+	switch (Format)
+	{
+	case EPixelFormat::RGBA8_UNORM:
+	{
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 One  = _mm_set1_ps(1.0f);
+		const __m128 Max  = _mm_set1_ps(255.0f);
+		const __m128 Half = _mm_set1_ps(0.5f);
+		for (uint x = 0; x < NumPixels; ++x)
+		{
+			const __m128  v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pIn + x * 4), Zero), One);
+			const __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, Max), Half));
+			const __m128i b = _mm_packus_epi16(_mm_packs_epi32(i, i), _mm_setzero_si128());
+			const int Packed = _mm_cvtsi128_si32(b);
+			memcpy(pRow + x * 4, &Packed, 4);
+		}
+	}	break;
+	case EPixelFormat::RGBA8_UNORM_SRGB:
+	{
+		const FSRGBTables& Tables = GetSRGBTables();
+		for (uint x = 0; x < NumPixels; ++x)
+		{
+			pRow[x * 4 + 0] = LinearToSRGB8(Tables, pIn[x * 4 + 0]);
+			pRow[x * 4 + 1] = LinearToSRGB8(Tables, pIn[x * 4 + 1]);
+			pRow[x * 4 + 2] = LinearToSRGB8(Tables, pIn[x * 4 + 2]);
+			pRow[x * 4 + 3] = static_cast<uint8>(std::min(std::max(pIn[x * 4 + 3], 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}	break;
+	case EPixelFormat::RGBA16_FLOAT:
+	{
+		uint16* pHalf = reinterpret_cast<uint16*>(pRow);
+#if IMAGE_PROCESSING_F16C
+		for (uint x = 0; x < NumPixels; ++x)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(pHalf + x * 4), _mm_cvtps_ph(_mm_loadu_ps(pIn + x * 4), _MM_FROUND_TO_NEAREST_INT));
+		}
+#else
+		for (uint i = 0; i < NumPixels * 4; ++i) pHalf[i] = FloatToHalf(pIn[i]);
+#endif
+	}	break;
+	case EPixelFormat::RGBA32_FLOAT:
+		memcpy(pRow, pIn, NumPixels * 4 * sizeof(float));
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// 2x2 DOWNSAMPLE KERNELS
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+// The row kernels read the 2x2 footprint before writing the output texel, and the output
+// never gets ahead of the input, which is what makes the (single threaded) in-place mip generation work.
+
+static void Downsample2x2Row_RGBA8_Box(const uint8* pRow0, const uint8* pRow1, uint8* pOut, uint SrcW, uint DstW)
+{
+	const uint NumPairs = SrcW / 2; // output texels that don't need edge clamping
+	uint x = 0;
+
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Two  = _mm_set1_epi16(2);
+	for (; x + 2 <= NumPairs; x += 2) // 4 input texels per row -> 2 output texels
+	{
+		const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 8));
+		const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 8));
+		__m128i Lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, Zero), _mm_unpacklo_epi8(r1, Zero)); // [t0 | t1] 16-bit channels
+		__m128i Hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, Zero), _mm_unpackhi_epi8(r1, Zero)); // [t2 | t3]
+		Lo = _mm_add_epi16(Lo, _mm_srli_si128(Lo, 8));                                         // [t0+t1 | x]
+		Hi = _mm_add_epi16(Hi, _mm_srli_si128(Hi, 8));                                         // [t2+t3 | x]
+		const __m128i Sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(Lo, Hi), Two), 2);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pOut + x * 4), _mm_packus_epi16(Sum, Sum));
+	}
+	for (; x < DstW; ++x)
+	{
+		const uint x0 = std::min(x * 2 + 0, SrcW - 1);
+		const uint x1 = std::min(x * 2 + 1, SrcW - 1);
+		uint8 Texel[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			Texel[c] = static_cast<uint8>((pRow0[x0 * 4 + c] + pRow0[x1 * 4 + c] + pRow1[x0 * 4 + c] + pRow1[x1 * 4 + c] + 2) / 4);
+		}
+		memcpy(pOut + x * 4, Texel, 4);
+	}
+}
+
+static inline __m128 Reduce2x2(__m128 a, __m128 b, __m128 c, __m128 d, EFilter Filter)
+{
+	if (Filter == EFilter::MIN)
+	{
+		const __m128 MaskRGB = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		const __m128 OneA    = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		const __m128 Min     = _mm_min_ps(_mm_min_ps(a, b), _mm_min_ps(c, d));
+		return _mm_or_ps(_mm_and_ps(Min, MaskRGB), OneA);
+	}
+	return _mm_mul_ps(_mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d)), _mm_set1_ps(0.25f));
+}
+
+static void Downsample2x2Row_RGBA32F(const float* pRow0, const float* pRow1, float* pOut, uint SrcW, uint DstW, EFilter Filter)
+{
+	const uint NumPairs = SrcW / 2;
+	uint x = 0;
+#if IMAGE_PROCESSING_AVX2
+	if (Filter == EFilter::BOX)
+	{
+		const __m256 Quarter = _mm256_set1_ps(0.25f);
+		for (; x + 2 <= NumPairs; x += 2) // 2 output texels per iteration
+		{
+			const __m256 s01 = _mm256_add_ps(_mm256_loadu_ps(pRow0 + x * 8 + 0), _mm256_loadu_ps(pRow1 + x * 8 + 0)); // [t0 | t1]
+			const __m256 s23 = _mm256_add_ps(_mm256_loadu_ps(pRow0 + x * 8 + 8), _mm256_loadu_ps(pRow1 + x * 8 + 8)); // [t2 | t3]
+			const __m256 Sum = _mm256_add_ps(_mm256_permute2f128_ps(s01, s23, 0x20), _mm256_permute2f128_ps(s01, s23, 0x31));
+			_mm256_storeu_ps(pOut + x * 4, _mm256_mul_ps(Sum, Quarter));
+		}
+	}
+#endif
+	for (; x < NumPairs; ++x)
+	{
+		const __m128 a = _mm_loadu_ps(pRow0 + x * 8 + 0);
+		const __m128 b = _mm_loadu_ps(pRow0 + x * 8 + 4);
+		const __m128 c = _mm_loadu_ps(pRow1 + x * 8 + 0);
+		const __m128 d = _mm_loadu_ps(pRow1 + x * 8 + 4);
+		_mm_storeu_ps(pOut + x * 4, Reduce2x2(a, b, c, d, Filter));
+	}
+	for (; x < DstW; ++x) // 1-texel wide source
+	{
+		const uint x0 = std::min(x * 2 + 0, SrcW - 1);
+		const uint x1 = std::min(x * 2 + 1, SrcW - 1);
+		const __m128 Result = Reduce2x2(_mm_loadu_ps(pRow0 + x0 * 4), _mm_loadu_ps(pRow0 + x1 * 4), _mm_loadu_ps(pRow1 + x0 * 4), _mm_loadu_ps(pRow1 + x1 * 4), Filter);
+		_mm_storeu_ps(pOut + x * 4, Result);
+	}
+}
+
+// sRGB, half floats and the min filter on LDR formats: decode both rows into float4, filter, encode.
+// pScratch: 2 x SrcW x float4
+static void Downsample2x2Row_Generic(const uint8* pRow0, const uint8* pRow1, uint8* pOut, uint SrcW, uint DstW, EPixelFormat Format, EFilter Filter, float* pScratch)
+{
+	float* pDecoded0 = pScratch;
+	float* pDecoded1 = pScratch + SrcW * 4;
+	DecodeRow(pRow0, Format, SrcW, pDecoded0);
+	DecodeRow(pRow1, Format, SrcW, pDecoded1);
+	Downsample2x2Row_RGBA32F(pDecoded0, pDecoded1, pDecoded0, SrcW, DstW, Filter); // in-place into the first row
+	EncodeRow(pDecoded0, Format, DstW, pOut);
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// SEPARABLE RESIZE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+struct FFilterTap
+{
+	uint  Index;
+	float Weight;
+};
+struct FFilterTaps // taps of output texel i: Taps[Offsets[i], Offsets[i+1])
+{
+	std::vector<uint>       Offsets;
+	std::vector<FFilterTap> Taps;
+};
+
+static FFilterTaps ComputeFilterTaps(uint SrcSize, uint DstSize, EFilter Filter)
+{
+	FFilterTaps Result;
+	Result.Offsets.resize(DstSize + 1, 0);
+
+	const float Scale       = static_cast<float>(SrcSize) / DstSize;
+	const float FilterScale = std::max(1.0f, Scale); // widen the filter when downsizing
+	const float Radius      = (Filter == EFilter::TRIANGLE ? 1.0f : 0.5f) * FilterScale;
+	for (uint i = 0; i < DstSize; ++i)
+	{
+		const float  Center   = (i + 0.5f) * Scale;
+		const int    Begin    = static_cast<int>(std::floor(Center - Radius));
+		const int    End      = static_cast<int>(std::ceil(Center + Radius));
+		const size_t FirstTap = Result.Taps.size();
+
+		float TotalWeight = 0.0f;
+		for (int j = Begin; j <= End; ++j)
+		{
+			const float t = ((j + 0.5f) - Center) / FilterScale;
+			const float w = Filter == EFilter::TRIANGLE
+				? std::max(0.0f, 1.0f - std::abs(t))
+				: (t >= -0.5f && t < 0.5f ? 1.0f : 0.0f);
+			if (w <= 0.0f)
+				continue;
+			const uint Index = static_cast<uint>(std::min(std::max(j, 0), static_cast<int>(SrcSize) - 1)); // clamp to edge
+			Result.Taps.push_back({ Index, w });
+			TotalWeight += w;
+		}
+		if (TotalWeight <= 0.0f) // shouldn't happen, fall back to point sampling
+		{
+			Result.Taps.push_back({ std::min(static_cast<uint>(Center), SrcSize - 1), 1.0f });
+			TotalWeight = 1.0f;
+		}
+		for (size_t t = FirstTap; t < Result.Taps.size(); ++t)
+		{
+			Result.Taps[t].Weight /= TotalWeight;
+		}
+		Result.Offsets[i + 1] = static_cast<uint>(Result.Taps.size());
+	}
+	return Result;
+}
+
+static inline void AccumulateRow(float* pAccum, const float* pRow, uint NumPixels, float Weight)
+{
+	uint i = 0;
+	const uint NumFloats = NumPixels * 4;
+#if IMAGE_PROCESSING_AVX2
+	const __m256 w8 = _mm256_set1_ps(Weight);
+	for (; i + 8 <= NumFloats; i += 8)
+	{
+		_mm256_storeu_ps(pAccum + i, _mm256_add_ps(_mm256_loadu_ps(pAccum + i), _mm256_mul_ps(_mm256_loadu_ps(pRow + i), w8)));
+	}
+#endif
+	const __m128 w4 = _mm_set1_ps(Weight);
+	for (; i < NumFloats; i += 4)
+	{
+		_mm_storeu_ps(pAccum + i, _mm_add_ps(_mm_loadu_ps(pAccum + i), _mm_mul_ps(_mm_loadu_ps(pRow + i), w4)));
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// INTERFACE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static uint GetRowsPerTask(uint NumRows, uint NumPixelsPerRow, ThreadPool* pWorkers)
+{
+	if (!pWorkers)
+		return std::max(1u, NumRows);
+
+	// don't bother distributing tiny images
+	constexpr uint MIN_PIXELS_PER_TASK = 16 * 1024;
+	const uint NumThreads = static_cast<uint>(std::max<size_t>(1, ThreadPool::sHardwareThreadCount));
+	const uint MinRows    = std::max(1u, MIN_PIXELS_PER_TASK / std::max(1u, NumPixelsPerRow));
+	return std::max(MinRows, NumRows / (NumThreads * PARALLEL_CHUNKS_PER_THREAD));
+}
+
+namespace ImageProcessing
+{
+	size_t FImageView::GetRowPitch() const
+	{
+		return RowPitch != 0 ? RowPitch : static_cast<size_t>(Width) * GetBytesPerPixel(Format);
+	}
+
+	uint GetBytesPerPixel(EPixelFormat Format)
+	{
+		switch (Format)
+		{
+		case EPixelFormat::RGBA8_UNORM:
+		case EPixelFormat::RGBA8_UNORM_SRGB: return 4;
+		case EPixelFormat::RGBA16_FLOAT    : return 8;
+		case EPixelFormat::RGBA32_FLOAT    : return 16;
+		default: assert(false); break;
+		}
+		return 0;
+	}
+
+	EPixelFormat GetPixelFormat(uint BytesPerPixel, bool bSRGB)
+	{
+		switch (BytesPerPixel)
+		{
+		case 4 : return bSRGB ? EPixelFormat::RGBA8_UNORM_SRGB : EPixelFormat::RGBA8_UNORM;
+		case 8 : return EPixelFormat::RGBA16_FLOAT;
+		case 16: return EPixelFormat::RGBA32_FLOAT;
+		default: assert(false); break;
+		}
+		return EPixelFormat::NUM_PIXEL_FORMATS;
+	}
+
+	void Downsample2x2(const FImageView& Src, const FImageView& Dst, EFilter Filter, ThreadPool* pWorkers)
+	{
+		assert(Src.Format == Dst.Format);
+		assert(Filter == EFilter::BOX || Filter == EFilter::MIN);
+		assert(Dst.Width == std::max(1u, Src.Width / 2) && Dst.Height == std::max(1u, Src.Height / 2));
+		assert(!pWorkers || Src.pData != Dst.pData); // in-place only works top to bottom
+
+		const bool bGeneric = !(Src.Format == EPixelFormat::RGBA32_FLOAT || (Src.Format == EPixelFormat::RGBA8_UNORM && Filter == EFilter::BOX));
+		ParallelFor(Dst.Height, GetRowsPerTask(Dst.Height, Src.Width * 2, pWorkers), pWorkers, [&](uint RowBegin, uint RowEnd)
+		{
+			std::vector<float> Scratch(bGeneric ? Src.Width * 4 * 2 : 0);
+			for (uint y = RowBegin; y < RowEnd; ++y)
+			{
+				const uint8* pRow0 = Src.GetRow(std::min(y * 2 + 0, Src.Height - 1));
+				const uint8* pRow1 = Src.GetRow(std::min(y * 2 + 1, Src.Height - 1));
+				uint8*       pOut  = Dst.GetRow(y);
+				if (bGeneric)
+					Downsample2x2Row_Generic(pRow0, pRow1, pOut, Src.Width, Dst.Width, Src.Format, Filter, Scratch.data());
+				else if (Src.Format == EPixelFormat::RGBA8_UNORM)
+					Downsample2x2Row_RGBA8_Box(pRow0, pRow1, pOut, Src.Width, Dst.Width);
+				else
+					Downsample2x2Row_RGBA32F(reinterpret_cast<const float*>(pRow0), reinterpret_cast<const float*>(pRow1), reinterpret_cast<float*>(pOut), Src.Width, Dst.Width, Filter);
+			}
+		});
+	}
+
+	void Convert(const FImageView& Src, const FImageView& Dst, ThreadPool* pWorkers)
+	{
+		assert(Src.Width == Dst.Width && Src.Height == Dst.Height);
+		assert(Src.pData != Dst.pData);
+		ParallelFor(Dst.Height, GetRowsPerTask(Dst.Height, Dst.Width, pWorkers), pWorkers, [&](uint RowBegin, uint RowEnd)
+		{
+			std::vector<float> Row(Src.Width * 4);
+			for (uint y = RowBegin; y < RowEnd; ++y)
+			{
+				DecodeRow(Src.GetRow(y), Src.Format, Src.Width, Row.data());
+				EncodeRow(Row.data(), Dst.Format, Dst.Width, Dst.GetRow(y));
+			}
+		});
+	}
+
+	void Resize(const FImageView& Src, const FImageView& Dst, EFilter Filter, ThreadPool* pWorkers)
+	{
+		assert(Filter == EFilter::BOX || Filter == EFilter::TRIANGLE);
+		assert(Src.pData != Dst.pData);
+		if (Src.Width == 0 || Src.Height == 0 || Dst.Width == 0 || Dst.Height == 0)
+			return;
+
+		const FFilterTaps TapsX = ComputeFilterTaps(Src.Width , Dst.Width , Filter);
+		const FFilterTaps TapsY = ComputeFilterTaps(Src.Height, Dst.Height, Filter);
+		const bool bSrcFloat4 = Src.Format == EPixelFormat::RGBA32_FLOAT;
+
+		// vertical pass into a full-width row, then the horizontal pass: each output row is independent
+		// and the only intermediate memory is a couple of rows per task.
+		ParallelFor(Dst.Height, GetRowsPerTask(Dst.Height, Src.Width, pWorkers), pWorkers, [&](uint RowBegin, uint RowEnd)
+		{
+			std::vector<float> DecodedRow(bSrcFloat4 ? 0 : Src.Width * 4);
+			std::vector<float> Column(Src.Width * 4);
+			std::vector<float> OutRow(Dst.Width * 4);
+			for (uint y = RowBegin; y < RowEnd; ++y)
+			{
+				std::fill(Column.begin(), Column.end(), 0.0f);
+				for (uint t = TapsY.Offsets[y]; t < TapsY.Offsets[y + 1]; ++t)
+				{
+					const FFilterTap& Tap = TapsY.Taps[t];
+					const float* pRow = reinterpret_cast<const float*>(Src.GetRow(Tap.Index));
+					if (!bSrcFloat4)
+					{
+						DecodeRow(Src.GetRow(Tap.Index), Src.Format, Src.Width, DecodedRow.data());
+						pRow = DecodedRow.data();
+					}
+					AccumulateRow(Column.data(), pRow, Src.Width, Tap.Weight);
+				}
+
+				for (uint x = 0; x < Dst.Width; ++x)
+				{
+					__m128 Sum = _mm_setzero_ps();
+					for (uint t = TapsX.Offsets[x]; t < TapsX.Offsets[x + 1]; ++t)
+					{
+						const FFilterTap& Tap = TapsX.Taps[t];
+						Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(&Column[Tap.Index * 4]), _mm_set1_ps(Tap.Weight)));
+					}
+					_mm_storeu_ps(&OutRow[x * 4], Sum);
+				}
+				EncodeRow(OutRow.data(), Dst.Format, Dst.Width, Dst.GetRow(y));
+			}
+		});
+	}
+}
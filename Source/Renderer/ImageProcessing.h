@@ -0,0 +1,79 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <cstddef>
+
+class ThreadPool;
+
+// CPU image processing for the texture pipeline: mip generation and resizing.
+// The kernels are SSE (AVX2/F16C when the compiler targets it) and work on
+// whole rows, rows are distributed to a worker thread pool when one is provided.
+namespace ImageProcessing
+{
+	enum class EPixelFormat
+	{
+		RGBA8_UNORM = 0,
+		RGBA8_UNORM_SRGB, // filtering happens in linear space, alpha is linear
+		RGBA16_FLOAT,
+		RGBA32_FLOAT,
+
+		NUM_PIXEL_FORMATS
+	};
+
+	enum class EFilter
+	{
+		BOX = 0,
+		TRIANGLE, // Resize() only: tent filter, wider than the box filter when downsizing
+		MIN,      // Downsample2x2() only: min of the 2x2 footprint for RGB, alpha=1 (keeps HDR sun from bleeding into the lower mips)
+
+		NUM_FILTERS
+	};
+
+	struct FImageView
+	{
+		void*        pData    = nullptr;
+		uint         Width    = 0;
+		uint         Height   = 0;
+		size_t       RowPitch = 0; // in bytes, 0 for tightly packed rows
+		EPixelFormat Format   = EPixelFormat::RGBA8_UNORM;
+
+		FImageView() = default;
+		FImageView(void* pData_, uint Width_, uint Height_, EPixelFormat Format_, size_t RowPitch_ = 0)
+			: pData(pData_), Width(Width_), Height(Height_), RowPitch(RowPitch_), Format(Format_) {}
+
+		size_t GetRowPitch() const;
+		inline uint8* GetRow(uint y) const { return static_cast<uint8*>(pData) + y * GetRowPitch(); }
+	};
+
+	uint GetBytesPerPixel(EPixelFormat Format);
+	EPixelFormat GetPixelFormat(uint BytesPerPixel, bool bSRGB = false); // 4->RGBA8, 8->RGBA16F, 16->RGBA32F
+
+	// Dst should be max(1, Src.Width/2) x max(1, Src.Height/2) with the same format, odd dimensions clamp at the edges.
+	// Src and Dst can point to the same memory for in-place mip generation, only when pWorkers is nullptr.
+	void Downsample2x2(const FImageView& Src, const FImageView& Dst, EFilter Filter = EFilter::BOX, ThreadPool* pWorkers = nullptr);
+
+	// Pixel format conversion, Src and Dst dimensions should match.
+	void Convert(const FImageView& Src, const FImageView& Dst, ThreadPool* pWorkers = nullptr);
+
+	// Separable resize to arbitrary dimensions, Src and Dst formats can differ.
+	void Resize(const FImageView& Src, const FImageView& Dst, EFilter Filter = EFilter::TRIANGLE, ThreadPool* pWorkers = nullptr);
+}
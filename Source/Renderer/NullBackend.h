@@ -0,0 +1,48 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "CommandList.h"
+
+//----------------------------------------------------------------------------------------------------------------
+// NULL BACKEND
+//----------------------------------------------------------------------------------------------------------------
+// A command list that records nothing. The base class still filters & counts the calls, which is what the HAL
+// tests check w/o a GPU. None of the engine passes are routed through it.
+//
+// There is no null device: resource creation, uploads, descriptors & PSOs go through VQRenderer, which is D3D12
+// only, so UpdateThread_Tick() + RenderThread_RenderMainWindow_Scene() can't run on a machine w/o D3D12.
+namespace HAL
+{
+	class NullCommandList : public CommandList
+	{
+	public:
+		NullCommandList() : CommandList(EBackend::NULL_BACKEND) {}
+
+	protected:
+		void BackendSetPipelineState(PSO_ID, PSOPermutationKey) override {}
+		void BackendSetGraphicsRootSignature(int) override {}
+		void BackendSetGraphicsRootConstantBufferView(uint, uint64) override {}
+		void BackendSetGraphicsRootDescriptorTable(uint, SRV_ID, uint) override {}
+		void BackendSetPrimitiveTopology(EPrimitiveTopology) override {}
+		void BackendSetVertexBuffer(BufferID) override {}
+		void BackendSetIndexBuffer(BufferID) override {}
+		void BackendDrawIndexedInstanced(uint, uint, uint, int, uint) override {}
+	};
+}
@@ -0,0 +1,287 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "PSOCache.h"
+#include "ShaderCache.h" // xxHash64
+
+#include "../../Libs/VQUtils/Source/Timer.h"
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+constexpr const char* PSO_CACHE_INDEX_FILE_NAME = "PSOCache.idx";
+constexpr int         PSO_CACHE_INDEX_VERSION   = 1; // bump when the PSO hash composition or the index format changes
+constexpr uint64      HASH128_SEED_LO           = 0;
+constexpr uint64      HASH128_SEED_HI           = 0x9E3779B97F4A7C15ull;
+
+//-------------------------------------------------------------------------------------------------------------
+// HASH
+//-------------------------------------------------------------------------------------------------------------
+std::string FHash128::ToString() const
+{
+	char HexStr[33];
+	snprintf(HexStr, sizeof(HexStr), "%016llx%016llx", static_cast<unsigned long long>(Hi), static_cast<unsigned long long>(Lo));
+	return HexStr;
+}
+
+bool FHash128::FromString(const std::string& Str, FHash128& OutHash)
+{
+	if (Str.size() != 32)
+		return false;
+	try
+	{
+		OutHash.Hi = std::stoull(Str.substr(0, 16), nullptr, 16);
+		OutHash.Lo = std::stoull(Str.substr(16, 16), nullptr, 16);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+	return true;
+}
+
+void HashBuilder128::Add(const void* pData, size_t Size)
+{
+	mData.append(static_cast<const char*>(pData), Size);
+}
+
+void HashBuilder128::Add(const std::string& Str)
+{
+	mData.append(Str);
+	mData.push_back('\0');
+}
+
+void HashBuilder128::Add(const char* pStr)
+{
+	Add(pStr != nullptr);
+	if (pStr)
+		Add(std::string(pStr));
+}
+
+FHash128 HashBuilder128::GetHash() const
+{
+	FHash128 Hash;
+	Hash.Lo = ShaderCache::Hash(mData.data(), mData.size(), HASH128_SEED_LO);
+	Hash.Hi = ShaderCache::Hash(mData.data(), mData.size(), HASH128_SEED_HI);
+	return Hash;
+}
+
+
+//-------------------------------------------------------------------------------------------------------------
+// PSO CACHE
+//-------------------------------------------------------------------------------------------------------------
+void PSOCache::Initialize(const std::string& CacheDirectory, uint64 DeviceID)
+{
+	Timer t; t.Start();
+	std::lock_guard<std::mutex> lk(mMtx);
+
+	mCacheDirectory = CacheDirectory;
+	mIndexFilePath = (fs::path(CacheDirectory) / PSO_CACHE_INDEX_FILE_NAME).generic_string();
+	mDeviceID = DeviceID;
+	mEntries.clear();
+	mStats = {};
+	mbIndexDirty = false;
+
+	// Index format, one record per line:
+	//   VERSION <version>
+	//   DEVICE  <device id>
+	//   PSO     <pso hash> <blob size> <blob hash> <pso name>
+	std::ifstream Index(mIndexFilePath);
+	if (!Index.is_open())
+	{
+		Log::Info("[PSOCache] No index file found, PSOs will be compiled: %s", mIndexFilePath.c_str());
+		mbIndexDirty = true;
+		return;
+	}
+
+	bool bVersionMatch = false;
+	bool bDeviceMatch = false;
+	std::string line;
+	while (std::getline(Index, line))
+	{
+		std::istringstream ss(line);
+		std::string Record;
+		ss >> Record;
+		if (Record == "VERSION")
+		{
+			int Version = 0;
+			ss >> Version;
+			bVersionMatch = Version == PSO_CACHE_INDEX_VERSION;
+		}
+		else if (Record == "DEVICE")
+		{
+			uint64 IndexDeviceID = 0;
+			ss >> std::hex >> IndexDeviceID >> std::dec;
+			bDeviceMatch = IndexDeviceID == mDeviceID;
+		}
+		else if (Record == "PSO")
+		{
+			std::string HashStr;
+			FHash128 PSOHash;
+			FEntry Entry;
+			ss >> HashStr >> Entry.BlobSize >> std::hex >> Entry.BlobHash >> std::dec;
+			std::getline(ss >> std::ws, Entry.Name);
+			if (FHash128::FromString(HashStr, PSOHash))
+				mEntries[PSOHash] = std::move(Entry);
+		}
+		if (!bVersionMatch)
+			break;
+	}
+
+	if (!bVersionMatch || !bDeviceMatch)
+	{
+		Log::Info("[PSOCache] %s, PSOs will be recompiled", !bVersionMatch ? "Index file version mismatch" : "GPU or driver changed");
+		mEntries.clear();
+		mbIndexDirty = true;
+		return;
+	}
+
+	Log::Info("[PSOCache] Index loaded in %.2fms: %zu PSOs", t.StopGetDeltaTimeAndReset() * 1000.0f, mEntries.size());
+}
+
+void PSOCache::SaveIndex()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (!mbIndexDirty || mIndexFilePath.empty())
+		return;
+
+	// write to a temp file first so that a crash mid-write doesn't leave a truncated index behind
+	const std::string TempFilePath = mIndexFilePath + ".tmp";
+	{
+		std::ofstream Index(TempFilePath, std::ios::out | std::ios::trunc);
+		if (!Index.is_open())
+		{
+			Log::Error("[PSOCache] Cannot write the index file: %s", TempFilePath.c_str());
+			return;
+		}
+
+		char DeviceStr[17];
+		snprintf(DeviceStr, sizeof(DeviceStr), "%016llx", static_cast<unsigned long long>(mDeviceID));
+		Index << "VERSION " << PSO_CACHE_INDEX_VERSION << "\n";
+		Index << "DEVICE " << DeviceStr << "\n";
+		for (const auto& it : mEntries)
+		{
+			char BlobHashStr[17];
+			snprintf(BlobHashStr, sizeof(BlobHashStr), "%016llx", static_cast<unsigned long long>(it.second.BlobHash));
+			Index << "PSO " << it.first.ToString() << " " << it.second.BlobSize << " " << BlobHashStr << " " << it.second.Name << "\n";
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(TempFilePath, mIndexFilePath, ec);
+	if (ec)
+	{
+		Log::Error("[PSOCache] Cannot replace the index file %s: %s", mIndexFilePath.c_str(), ec.message().c_str());
+		return;
+	}
+	mbIndexDirty = false;
+}
+
+std::string PSOCache::GetBlobFilePath(const FHash128& PSOHash) const
+{
+	return (fs::path(mCacheDirectory) / (PSOHash.ToString() + ".pso")).generic_string();
+}
+
+bool PSOCache::LoadBlob(const FHash128& PSOHash, std::vector<uint8>& OutBlob)
+{
+	FEntry Entry;
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		auto it = mEntries.find(PSOHash);
+		if (it == mEntries.end())
+		{
+			++mStats.NumMisses;
+			return false;
+		}
+		Entry = it->second;
+	}
+
+	// read & verify the blob outside the lock
+	std::ifstream File(GetBlobFilePath(PSOHash), std::ios::in | std::ios::binary | std::ios::ate);
+	bool bValidBlob = File.is_open() && static_cast<uint64>(File.tellg()) == Entry.BlobSize;
+	if (bValidBlob)
+	{
+		OutBlob.resize(Entry.BlobSize);
+		File.seekg(0);
+		File.read(reinterpret_cast<char*>(OutBlob.data()), OutBlob.size());
+		bValidBlob = File.good() && ShaderCache::Hash(OutBlob.data(), OutBlob.size()) == Entry.BlobHash;
+	}
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (!bValidBlob)
+	{
+		Log::Warning("[PSOCache] Missing or corrupt PSO blob: %s (%s)", Entry.Name.c_str(), PSOHash.ToString().c_str());
+		OutBlob.clear();
+		mEntries.erase(PSOHash);
+		mbIndexDirty = true;
+		++mStats.NumMisses;
+		return false;
+	}
+	++mStats.NumHits;
+	return true;
+}
+
+void PSOCache::StoreBlob(const FHash128& PSOHash, const std::string& PSOName, const void* pBlob, size_t BlobSize)
+{
+	if (!pBlob || BlobSize == 0)
+		return;
+
+	FEntry Entry;
+	Entry.Name = PSOName;
+	Entry.BlobSize = BlobSize;
+	Entry.BlobHash = ShaderCache::Hash(pBlob, BlobSize);
+
+	{
+		std::ofstream File(GetBlobFilePath(PSOHash), std::ios::out | std::ios::binary | std::ios::trunc);
+		File.write(static_cast<const char*>(pBlob), BlobSize);
+		if (!File.good())
+		{
+			Log::Error("[PSOCache] Cannot write PSO blob: %s", GetBlobFilePath(PSOHash).c_str());
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	mEntries[PSOHash] = std::move(Entry);
+	mbIndexDirty = true;
+}
+
+void PSOCache::RejectBlob(const FHash128& PSOHash)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (mEntries.erase(PSOHash) > 0)
+	{
+		mbIndexDirty = true;
+		++mStats.NumRejected;
+		// the hit becomes a miss: the PSO gets compiled
+		--mStats.NumHits;
+		++mStats.NumMisses;
+	}
+}
+
+FPSOCacheStats PSOCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	FPSOCacheStats Stats = mStats;
+	Stats.NumEntries = static_cast<uint>(mEntries.size());
+	return Stats;
+}
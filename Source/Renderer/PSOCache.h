@@ -0,0 +1,102 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+struct FHash128
+{
+	uint64 Lo = 0;
+	uint64 Hi = 0;
+
+	inline bool IsNull() const { return Lo == 0 && Hi == 0; }
+	inline bool operator==(const FHash128& o) const { return Lo == o.Lo && Hi == o.Hi; }
+	inline bool operator!=(const FHash128& o) const { return !(*this == o); }
+	inline bool operator< (const FHash128& o) const { return Hi != o.Hi ? Hi < o.Hi : Lo < o.Lo; }
+	std::string ToString() const; // 32 hex digits
+	static bool FromString(const std::string& Str, FHash128& OutHash);
+};
+struct FHash128Hasher { inline size_t operator()(const FHash128& h) const { return static_cast<size_t>(h.Lo ^ (h.Hi * 31)); } };
+
+// Builds a stable 128-bit hash (2x xxHash64 w/ different seeds) from the values added to it.
+// Add the fields of a struct one by one instead of its raw bytes: the padding bytes aren't stable.
+class HashBuilder128
+{
+public:
+	void Add(const void* pData, size_t Size);
+	void Add(const std::string& Str); // w/ a terminator, so "AB"+"C" != "A"+"BC"
+	void Add(const char* pStr);       // nullptr is hashed differently than ""
+	template<class T> inline void Add(const T& Value) { static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Add the struct members instead"); Add(&Value, sizeof(T)); }
+
+	FHash128 GetHash() const;
+
+private:
+	std::string mData;
+};
+
+struct FPSOCacheStats
+{
+	uint NumEntries = 0;
+	uint NumHits = 0;
+	uint NumMisses = 0;
+	uint NumRejected = 0; // blobs the driver didn't accept
+};
+
+// Disk cache for the compiled pipeline state blobs (D3D12: ID3D12PipelineState::GetCachedBlob()), one file
+// per PSO named after the hash of its desc & shaders. The index file in the cache directory lists the blobs
+// w/ their size & content hash, & the device they were created on: a different GPU or driver version
+// invalidates all the blobs. Thread-safe.
+class PSOCache
+{
+public:
+	// DeviceID: identifies the adapter & the driver version, the blobs are only valid for the device that created them
+	void Initialize(const std::string& CacheDirectory, uint64 DeviceID);
+	void SaveIndex(); // writes the index file if anything changed since the last save
+
+	// returns false if the PSO isn't cached or its blob file is missing/corrupt
+	bool LoadBlob(const FHash128& PSOHash, std::vector<uint8>& OutBlob);
+	void StoreBlob(const FHash128& PSOHash, const std::string& PSOName, const void* pBlob, size_t BlobSize);
+	void RejectBlob(const FHash128& PSOHash); // the driver refused the cached blob
+
+	FPSOCacheStats GetStats() const;
+
+private:
+	struct FEntry
+	{
+		std::string Name;
+		uint64      BlobSize = 0;
+		uint64      BlobHash = 0;
+	};
+	std::string GetBlobFilePath(const FHash128& PSOHash) const;
+
+private:
+	mutable std::mutex                                 mMtx;
+	std::string                                        mCacheDirectory;
+	std::string                                        mIndexFilePath;
+	uint64                                             mDeviceID = 0;
+	bool                                               mbIndexDirty = false;
+	std::unordered_map<FHash128, FEntry, FHash128Hasher> mEntries;
+	FPSOCacheStats                                     mStats;
+};
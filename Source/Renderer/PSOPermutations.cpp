@@ -0,0 +1,119 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "PSOPermutations.h"
+
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <fstream>
+#include <sstream>
+
+constexpr int PSO_PERMUTATION_USAGE_LOG_VERSION = 1;
+
+const char* GetPSOPermutationFeatureName(EPSOPermutationFeature Feature)
+{
+	switch (Feature)
+	{
+	case PSO_FEATURE_MSAA_4      : return "MSAA4";
+	case PSO_FEATURE_ALPHA_MASKED: return "AlphaMasked";
+	}
+	return "Unknown";
+}
+
+std::string GetPSOPermutationName(const std::string& BasePSOName, PSOPermutationKey Key)
+{
+	std::string Name = BasePSOName;
+	for (PSOPermutationKey i = 0; i < NUM_PSO_PERMUTATION_FEATURES; ++i)
+	{
+		const EPSOPermutationFeature Feature = static_cast<EPSOPermutationFeature>(1u << i);
+		if (Key & Feature)
+		{
+			Name += "_";
+			Name += GetPSOPermutationFeatureName(Feature);
+		}
+	}
+	return Name;
+}
+
+
+bool PSOPermutationUsageLog::Load(const std::string& FilePath, std::vector<FEntry>& OutEntries)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mFilePath = FilePath;
+	mEntries.clear();
+
+	// Usage log format, one record per line:
+	//   VERSION <version>
+	//   <permutation family name> <key>
+	std::ifstream File(FilePath);
+	if (!File.is_open())
+		return false;
+
+	std::string line;
+	bool bVersionMatch = false;
+	while (std::getline(File, line))
+	{
+		std::istringstream ss(line);
+		std::string Name;
+		ss >> Name;
+		if (Name == "VERSION")
+		{
+			int Version = 0;
+			ss >> Version;
+			bVersionMatch = Version == PSO_PERMUTATION_USAGE_LOG_VERSION;
+			if (!bVersionMatch)
+				break;
+			continue;
+		}
+
+		PSOPermutationKey Key = 0;
+		if (!Name.empty() && (ss >> std::hex >> Key))
+			OutEntries.push_back({ Name, Key });
+	}
+
+	if (!bVersionMatch)
+	{
+		Log::Warning("[PSOPermutations] Ignoring usage log w/ a different version: %s", FilePath.c_str());
+		OutEntries.clear();
+		return false;
+	}
+	return true;
+}
+
+void PSOPermutationUsageLog::Record(const std::string& Name, PSOPermutationKey Key)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mEntries.insert({ Name, Key });
+}
+
+void PSOPermutationUsageLog::Save() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (mFilePath.empty() || mEntries.empty()) // keep the last log if nothing was rendered
+		return;
+
+	std::ofstream File(mFilePath, std::ios::out | std::ios::trunc);
+	if (!File.is_open())
+	{
+		Log::Error("[PSOPermutations] Cannot write the usage log: %s", mFilePath.c_str());
+		return;
+	}
+	File << "VERSION " << PSO_PERMUTATION_USAGE_LOG_VERSION << "\n";
+	for (const FEntry& Entry : mEntries)
+		File << Entry.first << " " << std::hex << Entry.second << std::dec << "\n";
+}
@@ -0,0 +1,71 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct FPSOLoadDesc;
+
+// Bitfield of the features a PSO permutation is compiled with
+using PSOPermutationKey = uint32;
+enum EPSOPermutationFeature : PSOPermutationKey
+{
+	PSO_FEATURE_MSAA_4       = 1 << 0, // 4x MSAA render targets
+	PSO_FEATURE_ALPHA_MASKED = 1 << 1, // ALPHA_MASK=1
+
+	NUM_PSO_PERMUTATION_FEATURES = 2
+};
+const char* GetPSOPermutationFeatureName(EPSOPermutationFeature Feature);
+inline uint64 GetPSOPermutationID(PSO_ID pso, PSOPermutationKey Key) { return (static_cast<uint64>(pso) << 32) | Key; }
+std::string GetPSOPermutationName(const std::string& BasePSOName, PSOPermutationKey Key); // e.g. PSO_Object_MSAA4
+
+struct FPSOPermutationDesc
+{
+	std::string       Name;
+	PSOPermutationKey SupportedFeatures = 0;
+	// Features that change the render target / root signature compatibility of the PSO. While a permutation is
+	// compiling, the permutation w/ only its required features is used as the fallback if it's ready.
+	PSOPermutationKey RequiredFeatures = 0;
+	std::function<FPSOLoadDesc(PSOPermutationKey)> fnGetLoadDesc; // PSOName is set by the renderer
+};
+
+// Records the PSO permutations requested during a run so that the next run
+// only prewarms the permutations that were actually used. Thread-safe.
+class PSOPermutationUsageLog
+{
+public:
+	using FEntry = std::pair<std::string, PSOPermutationKey>; // <permutation family name, key>
+
+	// returns false if there's no usage log (first run)
+	bool Load(const std::string& FilePath, std::vector<FEntry>& OutEntries);
+	void Record(const std::string& Name, PSOPermutationKey Key);
+	void Save() const;
+
+private:
+	mutable std::mutex mMtx;
+	std::string        mFilePath;
+	std::set<FEntry>   mEntries;
+};
@@ -0,0 +1,135 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <vector>
+
+// Swaps in the pipelines recompiled in the background at a frame boundary, and defers the release of the
+// pipelines they replace until the frame fence value of the last frame that may reference them is completed.
+//  - a compile that fails (nullptr) keeps the current pipeline
+//  - a newer compile of the same pipeline supersedes the older one that's still pending
+// Templated on the pipeline type so that the swap protocol doesn't depend on the graphics API.
+// Not thread-safe: owned by the render thread, the workers only fulfill the compile tasks.
+template<class TPipeline>
+class PipelineSwapQueue
+{
+public:
+	struct FSwapResult
+	{
+		uint NumSwapped = 0;
+		uint NumFailed  = 0;
+	};
+	using SwapFn_t    = std::function<TPipeline*(uint64 PipelineID, TPipeline* pNewPipeline)>; // returns the replaced pipeline
+	using ReleaseFn_t = std::function<void(TPipeline*)>;
+
+	void Enqueue(uint64 PipelineID, std::shared_future<TPipeline*> CompileTask)
+	{
+		for (FPendingSwap& Pending : mPending)
+		{
+			if (Pending.PipelineID == PipelineID)
+				Pending.bSuperseded = true;
+		}
+		mPending.push_back({ PipelineID, std::move(CompileTask), false });
+	}
+
+	// call at a frame boundary, before any command list of the frame references the pipelines.
+	// The replaced pipelines are released once RetireFenceValue is completed, see ReleaseRetired().
+	FSwapResult SwapReady(uint64 RetireFenceValue, const SwapFn_t& fnSwap)
+	{
+		FSwapResult Result;
+		for (auto it = mPending.begin(); it != mPending.end(); )
+		{
+			if (it->CompileTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++it;
+				continue;
+			}
+
+			TPipeline* pNewPipeline = it->CompileTask.get();
+			if (it->bSuperseded)
+			{
+				if (pNewPipeline) // never bound: can be released right away
+					mRetired.push_back({ 0, pNewPipeline });
+			}
+			else if (!pNewPipeline)
+			{
+				++Result.NumFailed;
+			}
+			else
+			{
+				TPipeline* pOldPipeline = fnSwap(it->PipelineID, pNewPipeline);
+				if (pOldPipeline)
+					mRetired.push_back({ RetireFenceValue, pOldPipeline });
+				++Result.NumSwapped;
+			}
+			it = mPending.erase(it);
+		}
+		return Result;
+	}
+
+	// releases the pipelines whose retire fence value is completed, returns the number of released pipelines
+	uint ReleaseRetired(uint64 CompletedFenceValue, const ReleaseFn_t& fnRelease)
+	{
+		uint NumReleased = 0;
+		for (auto it = mRetired.begin(); it != mRetired.end(); )
+		{
+			if (it->first > CompletedFenceValue)
+			{
+				++it;
+				continue;
+			}
+			fnRelease(it->second);
+			it = mRetired.erase(it);
+			++NumReleased;
+		}
+		return NumReleased;
+	}
+
+	// waits for the pending compiles, and releases their results along w/ all the retired pipelines (GPU must be idle)
+	void ReleaseAll(const ReleaseFn_t& fnRelease)
+	{
+		for (FPendingSwap& Pending : mPending)
+		{
+			if (TPipeline* pPipeline = Pending.CompileTask.get())
+				fnRelease(pPipeline);
+		}
+		mPending.clear();
+		for (auto& Retired : mRetired)
+			fnRelease(Retired.second);
+		mRetired.clear();
+	}
+
+	inline size_t GetNumPending() const { return mPending.size(); }
+	inline size_t GetNumRetired() const { return mRetired.size(); }
+
+private:
+	struct FPendingSwap
+	{
+		uint64                         PipelineID = 0;
+		std::shared_future<TPipeline*> CompileTask;
+		bool                           bSuperseded = false;
+	};
+	std::vector<FPendingSwap>                  mPending;  // in the order they're enqueued
+	std::vector<std::pair<uint64, TPipeline*>> mRetired;  // <fence value the pipeline is safe to release after, pipeline>
+};
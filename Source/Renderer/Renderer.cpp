@@ -39,6 +39,8 @@
 
 #include <cassert>
 #include <atomic>
+#include <chrono>
+#include <future>
 
 
 using namespace Microsoft::WRL;
@@ -116,6 +118,7 @@ void VQRenderer::Initialize(const FGraphicsSettings& Settings)
 	Device* pVQDevice = &mDevice;
 
 	InitializeShaderAndPSOCacheDirectory();
+	mSourceFileHashes.Initialize(VQRenderer::TextureCacheDirectory);
 
 	// Create the device
 	FDeviceCreateDesc deviceDesc = {};
@@ -131,14 +134,17 @@ void VQRenderer::Initialize(const FGraphicsSettings& Settings)
 	mComputeQueue.Create(pVQDevice, CommandQueue::EType::COMPUTE);
 	mCopyQueue.Create(pVQDevice, CommandQueue::EType::COPY);
 
+	// frame fence of the deferred releases
+	ThrowIfFailed(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mpFrameFence)));
+	SetName(mpFrameFence, "FrameFence");
+
 	// Initialize memory
 	InitializeD3D12MA();
 	InitializeHeaps();
 
 	// initialize thread
-	mbExitUploadThread.store(false);
 	mbDefaultResourcesLoaded.store(false);
-	mTextureUploadThread = std::thread(&VQRenderer::TextureUploadThread_Main, this);
+	mTextureUploadQueue.Start(this);
 
 	const size_t HWThreads = ThreadPool::sHardwareThreadCount;
 	const size_t HWCores   = HWThreads >> 1;
@@ -157,9 +163,17 @@ void VQRenderer::Load()
 	float tRS = timer.Tick();
 	Log::Info("[Renderer]    RootSignatures=%.2fs", tRS);
 
+	mShaderCache.Initialize(VQRenderer::ShaderCacheDirectory);
+	mPSOCache.Initialize(VQRenderer::PSOCacheDirectory, GetPSOCacheDeviceID(mDevice.GetAdapterPtr()));
 	LoadPSOs();
+	mShaderCache.SaveIndex();
+	mPSOCache.SaveIndex();
 	float tPSOs = timer.Tick();
-	Log::Info("[Renderer]    PSOs=%.2fs", tPSOs);
+	const FShaderCacheStats ShaderCacheStats = mShaderCache.GetStats();
+	const FPSOCacheStats    PSOCacheStats    = mPSOCache.GetStats();
+	Log::Info("[Renderer]    PSOs=%.2fs (shader cache: %u hits, %u misses, %u/%u source files hashed | PSO cache: %u hits, %u misses, %u rejected)", tPSOs
+		, ShaderCacheStats.NumCacheHits, ShaderCacheStats.NumCacheMisses, ShaderCacheStats.NumSourceFilesHashed, ShaderCacheStats.NumSourceFiles
+		, PSOCacheStats.NumHits, PSOCacheStats.NumMisses, PSOCacheStats.NumRejected);
 
 	LoadDefaultResources();
 	float tDefaultRscs = timer.Tick();
@@ -180,11 +194,21 @@ void VQRenderer::Exit()
 {
 	mWorkers_PSOLoad.Exit();
 	mWorkers_ShaderLoad.Exit();
+	mShaderCache.SaveIndex();
+	mPSOCache.SaveIndex();
+	mPSOPermutationUsageLog.Save();
+	mSourceFileHashes.SaveIndex();
 
-	mbExitUploadThread.store(true);
-	mSignal_UploadThreadWorkReady.NotifyAll();
+	mTextureUploadQueue.Exit(); // fails the uploads that didn't make it
 
 	// clean up memory
+	const std::pair<const char*, EResourceHeapType> DescriptorHeaps[] = { {"CBV_SRV_UAV", CBV_SRV_UAV_HEAP}, {"DSV", DSV_HEAP}, {"RTV", RTV_HEAP} };
+	for (const auto& Heap : DescriptorHeaps)
+	{
+		const FDescriptorAllocatorStats Stats = GetDescriptorHeapStats(Heap.second);
+		Log::Info("[Renderer] Descriptor heap %-11s: peak %u/%u, %llu allocs, %llu frees, %llu thread cache hits, %llu failed allocs, fragmentation=%.2f"
+			, Heap.first, Stats.PeakAllocated, Stats.NumDescriptors, Stats.NumAllocations, Stats.NumFrees, Stats.NumCacheHits, Stats.NumFailedAllocations, Stats.Fragmentation);
+	}
 	mHeapUpload.Destroy();
 	mHeapCBV_SRV_UAV.Destroy();
 	mHeapDSV.Destroy();
@@ -193,6 +217,13 @@ void VQRenderer::Exit()
 	mStaticHeap_IndexBuffer.Destroy();
 
 	// clean up textures
+	const FDeferredDeletionStats DeletionStats = mDeferredDeletions.GetStats();
+	Log::Info("[Renderer] Deferred deletions: %llu released, %u pending, max %u pending, %u frames over the time budget"
+		, DeletionStats.NumReleased, DeletionStats.NumPending, DeletionStats.MaxNumPending, DeletionStats.NumBudgetOverruns);
+	for (auto& it : mRenderContextLookup) // the deferred releases might still be in flight
+		it.second.SwapChain.WaitForGPU();
+	mDeferredDeletions.ReleaseAll();
+	mpFrameFence->Release();
 	for (std::unordered_map<TextureID, Texture>::iterator it = mTextures.begin(); it != mTextures.end(); ++it)
 	{
 		it->second.Destroy();
@@ -211,6 +242,18 @@ void VQRenderer::Exit()
 			pPSO.second->Release();
 	}
 	mPSOs.clear();
+	mPSOLoadDescs.clear();
+	mPSOSwapQueue.ReleaseAll([](ID3D12PipelineState* pPSO) { pPSO->Release(); }); // PSO workers are done at this point
+	for (auto& kvp : mPSOPermutations)
+	{
+		FPSOPermutation& Permutation = kvp.second;
+		ID3D12PipelineState* pPSO = Permutation.pPSO;
+		if (!pPSO && Permutation.LoadTask.valid())
+			pPSO = Permutation.LoadTask.get(); // PSO workers are done at this point
+		if (pPSO)
+			pPSO->Release();
+	}
+	mPSOPermutations.clear();
 
 	// clean up contexts
 	size_t NumBackBuffers = 0;
@@ -225,9 +268,6 @@ void VQRenderer::Exit()
 	mComputeQueue.Destroy();
 	mCopyQueue.Destroy();
 	mDevice.Destroy();
-
-	// clean up remaining threads
-	mTextureUploadThread.join();
 }
 
 void VQRenderer::OnWindowSizeChanged(HWND hwnd, unsigned w, unsigned h)
@@ -344,13 +384,13 @@ void VQRenderer::InitializeHeaps()
 	constexpr uint32 NumDescsSRV = 3800;
 	constexpr uint32 NumDescsUAV = 100;
 	constexpr bool   bCPUVisible = false;
-	mHeapCBV_SRV_UAV.Create(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, NumDescsCBV + NumDescsSRV + NumDescsUAV, bCPUVisible);
+	mHeapCBV_SRV_UAV.Create(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, NumDescsCBV + NumDescsSRV + NumDescsUAV, &mFrameFences, bCPUVisible);
 
 	constexpr uint32 NumDescsDSV = 100;
-	mHeapDSV.Create(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, NumDescsDSV);
+	mHeapDSV.Create(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, NumDescsDSV, &mFrameFences);
 
 	constexpr uint32 NumDescsRTV = 1000;
-	mHeapRTV.Create(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, NumDescsRTV);
+	mHeapRTV.Create(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, NumDescsRTV, &mFrameFences);
 
 	constexpr uint32 STATIC_GEOMETRY_MEMORY_SIZE = 64 * MEGABYTE;
 	constexpr bool USE_GPU_MEMORY = true;
@@ -360,10 +400,34 @@ void VQRenderer::InitializeHeaps()
 
 std::string VQRenderer::ShaderCacheDirectory = "Cache/Shaders";
 std::string VQRenderer::PSOCacheDirectory    = "Cache/PSOs";
+std::string VQRenderer::TextureCacheDirectory= "Cache/Textures";
+std::string VQRenderer::EnvironmentMapCacheDirectory = "Cache/EnvironmentMaps";
 void VQRenderer::InitializeShaderAndPSOCacheDirectory()
 {
 	DirectoryUtil::CreateFolderIfItDoesntExist(VQRenderer::ShaderCacheDirectory);
 	DirectoryUtil::CreateFolderIfItDoesntExist(VQRenderer::PSOCacheDirectory);
+	DirectoryUtil::CreateFolderIfItDoesntExist(VQRenderer::TextureCacheDirectory);
+	DirectoryUtil::CreateFolderIfItDoesntExist(VQRenderer::EnvironmentMapCacheDirectory);
+}
+
+// Cached PSO blobs are only valid for the adapter & driver that created them
+static uint64 GetPSOCacheDeviceID(IDXGIAdapter* pAdapter)
+{
+	DXGI_ADAPTER_DESC AdapterDesc = {};
+	LARGE_INTEGER     DriverVersion = {};
+	if (pAdapter)
+	{
+		pAdapter->GetDesc(&AdapterDesc);
+		pAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion);
+	}
+
+	HashBuilder128 h;
+	h.Add(AdapterDesc.VendorId);
+	h.Add(AdapterDesc.DeviceId);
+	h.Add(AdapterDesc.SubSysId);
+	h.Add(AdapterDesc.Revision);
+	h.Add(DriverVersion.QuadPart);
+	return h.GetHash().Lo;
 }
 
 static std::wstring GetAssetFullPath(LPCWSTR assetName)
@@ -952,8 +1016,6 @@ void VQRenderer::LoadRootSignatures()
 
 void VQRenderer::LoadPSOs()
 {
-	// temp: singl thread pso load from vector
-	// todo: enqueue load descs into the MT queue
 	std::vector< std::pair<PSO_ID, FPSOLoadDesc >> PSOLoadDescs; 
 
 	// FULLSCREEN TRIANGLE PSO
@@ -1070,36 +1132,38 @@ void VQRenderer::LoadPSOs()
 	{
 		const std::wstring ShaderFilePath = GetAssetFullPath(L"Skydome.hlsl");
 
-		FPSOLoadDesc psoLoadDesc = {};
-		psoLoadDesc.PSOName = "PSO_Skydome";
-
-		// Shader description
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_0" });
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_0" });
-
-		// PSO description
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
-		psoDesc.pRootSignature = mpBuiltinRootSignatures[2];
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState.DepthEnable = TRUE;
-		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
-		psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
-		psoDesc.DepthStencilState.StencilEnable = FALSE;
-		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 1;
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
-		psoDesc.SampleDesc.Count = 1;
-
-		PSOLoadDescs.push_back({ EBuiltinPSOs::SKYDOME_PSO, psoLoadDesc });
+		FPSOPermutationDesc PermutationDesc = {};
+		PermutationDesc.Name = "PSO_Skydome";
+		PermutationDesc.SupportedFeatures = PSO_FEATURE_MSAA_4;
+		PermutationDesc.RequiredFeatures  = PSO_FEATURE_MSAA_4;
+		PermutationDesc.fnGetLoadDesc = [this, ShaderFilePath](PSOPermutationKey Key)
+		{
+			FPSOLoadDesc psoLoadDesc = {};
 
-		// MSAA PSO
-		psoLoadDesc.PSOName = "PSO_Skydome_MSAA4";
-		psoDesc.SampleDesc.Count = 4;
-		PSOLoadDescs.push_back({ EBuiltinPSOs::SKYDOME_PSO_MSAA_4, psoLoadDesc });
+			// Shader description
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_0" });
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_0" });
+
+			// PSO description
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
+			psoDesc.pRootSignature = mpBuiltinRootSignatures[2];
+			psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+			psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+			psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+			psoDesc.DepthStencilState.DepthEnable = TRUE;
+			psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+			psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+			psoDesc.DepthStencilState.StencilEnable = FALSE;
+			psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			psoDesc.SampleMask = UINT_MAX;
+			psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			psoDesc.NumRenderTargets = 1;
+			psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			psoDesc.SampleDesc.Count = (Key & PSO_FEATURE_MSAA_4) ? 4 : 1;
+
+			return psoLoadDesc;
+		};
+		RegisterPSOPermutations(EBuiltinPSOs::SKYDOME_PSO, std::move(PermutationDesc));
 	}
 
 
@@ -1107,36 +1171,38 @@ void VQRenderer::LoadPSOs()
 	{
 		const std::wstring ShaderFilePath = GetAssetFullPath(L"Object.hlsl");
 
-		FPSOLoadDesc psoLoadDesc = {};
-		psoLoadDesc.PSOName = "PSO_Object";
-
-		// Shader description
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
-
-		// PSO description
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
-		psoDesc.pRootSignature = mpBuiltinRootSignatures[4];
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState.DepthEnable = TRUE;
-		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-		psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-		psoDesc.DepthStencilState.StencilEnable = FALSE;
-		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 1;
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
-		psoDesc.SampleDesc.Count = 1;
+		FPSOPermutationDesc PermutationDesc = {};
+		PermutationDesc.Name = "PSO_Object";
+		PermutationDesc.SupportedFeatures = PSO_FEATURE_MSAA_4;
+		PermutationDesc.RequiredFeatures  = PSO_FEATURE_MSAA_4;
+		PermutationDesc.fnGetLoadDesc = [this, ShaderFilePath](PSOPermutationKey Key)
+		{
+			FPSOLoadDesc psoLoadDesc = {};
 
-		PSOLoadDescs.push_back({ EBuiltinPSOs::OBJECT_PSO, psoLoadDesc });
+			// Shader description
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
 
-		// MSAA PSO
-		psoLoadDesc.PSOName = "PSO_Object_MSAA4";
-		psoDesc.SampleDesc.Count = 4;
-		PSOLoadDescs.push_back({ EBuiltinPSOs::OBJECT_PSO_MSAA_4, psoLoadDesc });
+			// PSO description
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
+			psoDesc.pRootSignature = mpBuiltinRootSignatures[4];
+			psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+			psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+			psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+			psoDesc.DepthStencilState.DepthEnable = TRUE;
+			psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			psoDesc.DepthStencilState.StencilEnable = FALSE;
+			psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			psoDesc.SampleMask = UINT_MAX;
+			psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			psoDesc.NumRenderTargets = 1;
+			psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			psoDesc.SampleDesc.Count = (Key & PSO_FEATURE_MSAA_4) ? 4 : 1;
+
+			return psoLoadDesc;
+		};
+		RegisterPSOPermutations(EBuiltinPSOs::OBJECT_PSO, std::move(PermutationDesc));
 	}
 
 
@@ -1156,180 +1222,165 @@ void VQRenderer::LoadPSOs()
 	{
 		const std::wstring ShaderFilePath = GetAssetFullPath(L"DepthPrePass.hlsl");
 
-		FPSOLoadDesc psoLoadDesc = {};
-		psoLoadDesc.PSOName = "PSO_FDepthPrePassVSPS";
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
-		psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[14];
-
-
-		// PSO description
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState.DepthEnable = TRUE;
-		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-		psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-		psoDesc.DepthStencilState.StencilEnable = FALSE;
-		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 1;
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R10G10B10A2_UNORM;
-		psoDesc.SampleDesc.Count = 1;
-
-		PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PREPASS_PSO, psoLoadDesc });
-
-
-		// MSAA PSO
-		psoLoadDesc.PSOName = "PSO_FDepthPrePassVSPS_MSAA4";
-		psoDesc.SampleDesc.Count = 4;
-		PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PREPASS_PSO_MSAA_4, psoLoadDesc });
-
-		//{
-		//	psoLoadDesc.ShaderStageCompileDescs.clear();
-		//	psoLoadDesc.PSOName = "PSO_FDepthPrePassVSPS_AlphaMasked";
-		//	psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1", { {"ENABLE_ALPHA_MASK","1"} } });
-		//	psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1", { {"ENABLE_ALPHA_MASK","1"} } });
-		//	psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[14];
-		//	psoDesc.SampleDesc.Count = 1;
-		//	PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PREPASS_ALPHA_MASKED_PSO, psoLoadDesc });
-		//
-		//	psoLoadDesc.PSOName = "PSO_FDepthPrePassVSPS_AlphaMasked_MSAA4";
-		//	psoDesc.SampleDesc.Count = 4;
-		//	PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PREPASS_ALPHA_MASKED_PSO_MSAA_4, psoLoadDesc });
-		//}
+		FPSOPermutationDesc PermutationDesc = {};
+		PermutationDesc.Name = "PSO_FDepthPrePassVSPS";
+		PermutationDesc.SupportedFeatures = PSO_FEATURE_MSAA_4;
+		PermutationDesc.RequiredFeatures  = PSO_FEATURE_MSAA_4;
+		PermutationDesc.fnGetLoadDesc = [this, ShaderFilePath](PSOPermutationKey Key)
+		{
+			FPSOLoadDesc psoLoadDesc = {};
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
+			psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[14];
+
+			// PSO description
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
+			psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+			psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+			psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+			psoDesc.DepthStencilState.DepthEnable = TRUE;
+			psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			psoDesc.DepthStencilState.StencilEnable = FALSE;
+			psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			psoDesc.SampleMask = UINT_MAX;
+			psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			psoDesc.NumRenderTargets = 1;
+			psoDesc.RTVFormats[0] = DXGI_FORMAT_R10G10B10A2_UNORM;
+			psoDesc.SampleDesc.Count = (Key & PSO_FEATURE_MSAA_4) ? 4 : 1;
+
+			return psoLoadDesc;
+		};
+		RegisterPSOPermutations(EBuiltinPSOs::DEPTH_PREPASS_PSO, std::move(PermutationDesc));
 	}
 
 	// FORWARD LIGHTING PSO
 	{
 		const std::wstring ShaderFilePath = GetAssetFullPath(L"ForwardLighting.hlsl");
 
-		FPSOLoadDesc psoLoadDesc = {};
-		psoLoadDesc.PSOName = "PSO_FwdLightingVSPS";
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
-		psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[5];
-
-		// PSO description
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState.DepthEnable = TRUE;
-		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
-		psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
-		psoDesc.DepthStencilState.StencilEnable = FALSE;
-		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 1;
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
-		psoDesc.SampleDesc.Count = 1;
-
-		PSOLoadDescs.push_back({ EBuiltinPSOs::FORWARD_LIGHTING_PSO, psoLoadDesc });
-
-		// MSAA PSO
-		psoLoadDesc.PSOName = "PSO_FwdLightingVSPS_MSAA4";
-		psoDesc.SampleDesc.Count = 4;
-		PSOLoadDescs.push_back({ EBuiltinPSOs::FORWARD_LIGHTING_PSO_MSAA_4, psoLoadDesc });
+		FPSOPermutationDesc PermutationDesc = {};
+		PermutationDesc.Name = "PSO_FwdLightingVSPS";
+		PermutationDesc.SupportedFeatures = PSO_FEATURE_MSAA_4;
+		PermutationDesc.RequiredFeatures  = PSO_FEATURE_MSAA_4;
+		PermutationDesc.fnGetLoadDesc = [this, ShaderFilePath](PSOPermutationKey Key)
+		{
+			FPSOLoadDesc psoLoadDesc = {};
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
+			psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[5];
+
+			// PSO description
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
+			psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+			psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+			psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+			psoDesc.DepthStencilState.DepthEnable = TRUE;
+			psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
+			psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+			psoDesc.DepthStencilState.StencilEnable = FALSE;
+			psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			psoDesc.SampleMask = UINT_MAX;
+			psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			psoDesc.NumRenderTargets = 1;
+			psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			psoDesc.SampleDesc.Count = (Key & PSO_FEATURE_MSAA_4) ? 4 : 1;
+
+			return psoLoadDesc;
+		};
+		RegisterPSOPermutations(EBuiltinPSOs::FORWARD_LIGHTING_PSO, std::move(PermutationDesc));
 	}
 
 	// WIREFRAME/UNLIT PSOs
+	for (EBuiltinPSOs pso : { EBuiltinPSOs::UNLIT_PSO, EBuiltinPSOs::WIREFRAME_PSO })
 	{
 		const std::wstring ShaderFilePath = GetAssetFullPath(L"Unlit.hlsl");
+		const bool bWireframe = pso == EBuiltinPSOs::WIREFRAME_PSO;
 
-		FPSOLoadDesc psoLoadDesc = {};
-		psoLoadDesc.PSOName = "PSO_UnlitVSPS";
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
-		psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[6];
-
-		// PSO description
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
-
-		// unlit
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState.DepthEnable = TRUE;
-		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-		psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-		psoDesc.DepthStencilState.StencilEnable = FALSE;
-		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 1;
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
-		psoDesc.SampleDesc.Count = 1;
-
-		PSOLoadDescs.push_back({ EBuiltinPSOs::UNLIT_PSO, psoLoadDesc });
+		FPSOPermutationDesc PermutationDesc = {};
+		PermutationDesc.Name = bWireframe ? "PSO_WireframeVSPS" : "PSO_UnlitVSPS";
+		PermutationDesc.SupportedFeatures = PSO_FEATURE_MSAA_4;
+		PermutationDesc.RequiredFeatures  = PSO_FEATURE_MSAA_4;
+		PermutationDesc.fnGetLoadDesc = [this, ShaderFilePath, bWireframe](PSOPermutationKey Key)
 		{
-			// MSAA
-			psoLoadDesc.PSOName = "PSO_UnlitVSPS_MSAA4";
-			psoDesc.SampleDesc.Count = 4;
-			PSOLoadDescs.push_back({ EBuiltinPSOs::UNLIT_PSO_MSAA_4, psoLoadDesc });
-		}
-
-		// wireframe
-		psoLoadDesc.PSOName = "PSO_WireframeVSPS";
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-		psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-		psoDesc.SampleDesc.Count = 1;
-		PSOLoadDescs.push_back({ EBuiltinPSOs::WIREFRAME_PSO, psoLoadDesc });
-		{
-			// MSAA
-			psoLoadDesc.PSOName = "PSO_WireframeVSPS_MSAA4";
-			psoDesc.SampleDesc.Count = 4;
-			PSOLoadDescs.push_back({ EBuiltinPSOs::WIREFRAME_PSO_MSAA_4, psoLoadDesc });
-		}
+			FPSOLoadDesc psoLoadDesc = {};
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
+			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
+			psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[6];
+
+			// PSO description
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
+			psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+			psoDesc.RasterizerState.CullMode = bWireframe ? D3D12_CULL_MODE_NONE : D3D12_CULL_MODE_BACK;
+			psoDesc.RasterizerState.FillMode = bWireframe ? D3D12_FILL_MODE_WIREFRAME : D3D12_FILL_MODE_SOLID;
+			psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+			psoDesc.DepthStencilState.DepthEnable = TRUE;
+			psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			psoDesc.DepthStencilState.StencilEnable = FALSE;
+			psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			psoDesc.SampleMask = UINT_MAX;
+			psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			psoDesc.NumRenderTargets = 1;
+			psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			psoDesc.SampleDesc.Count = (Key & PSO_FEATURE_MSAA_4) ? 4 : 1;
+
+			return psoLoadDesc;
+		};
+		RegisterPSOPermutations(pso, std::move(PermutationDesc));
 	}
 
 	// SHADOWMAP PSOs
 	{
 		const std::wstring ShaderFilePath = GetAssetFullPath(L"ShadowDepthPass.hlsl");
 
-		FPSOLoadDesc psoLoadDesc = {};
-		psoLoadDesc.PSOName = "PSO_DepthOnlyVS";
-		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
-		psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[7];
-
-		// PSO description
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
-
-		// unlit
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState.DepthEnable = TRUE;
-		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-		psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-		psoDesc.DepthStencilState.StencilEnable = FALSE;
-		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 0;
-		psoDesc.SampleDesc.Count = 1;
-
-		PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PASS_PSO, psoLoadDesc });
+		// depth only, w/ an alpha masked permutation
+		FPSOPermutationDesc PermutationDesc = {};
+		PermutationDesc.Name = "PSO_DepthOnlyVS";
+		PermutationDesc.SupportedFeatures = PSO_FEATURE_ALPHA_MASKED;
+		PermutationDesc.RequiredFeatures  = PSO_FEATURE_ALPHA_MASKED; // different root signature
+		PermutationDesc.fnGetLoadDesc = [this, ShaderFilePath](PSOPermutationKey Key)
 		{
-			psoLoadDesc.PSOName = "PSO_LinearDepthVSPS";
+			const bool bAlphaMasked = Key & PSO_FEATURE_ALPHA_MASKED;
+
+			FPSOLoadDesc psoLoadDesc = {};
 			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
-			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
-			psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[8];
-			PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PASS_LINEAR_PSO, psoLoadDesc });
-		}
-		{
-			psoLoadDesc.PSOName = "PSO_MaskedDepthVSPS";
-			psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
-			for (FShaderStageCompileDesc& shdDesc : psoLoadDesc.ShaderStageCompileDescs)
+			if (bAlphaMasked)
 			{
-				shdDesc.Macros.push_back({"ALPHA_MASK", "1"});
+				psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
+				for (FShaderStageCompileDesc& shdDesc : psoLoadDesc.ShaderStageCompileDescs)
+				{
+					shdDesc.Macros.push_back({ "ALPHA_MASK", "1" });
+				}
 			}
-			psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[9];
-			PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PASS_ALPHAMASKED_PSO, psoLoadDesc });
-		}
+			psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[bAlphaMasked ? 9 : 7];
+
+			// PSO description
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc = psoLoadDesc.D3D12GraphicsDesc;
+			psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+			psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+			psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+			psoDesc.DepthStencilState.DepthEnable = TRUE;
+			psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			psoDesc.DepthStencilState.StencilEnable = FALSE;
+			psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			psoDesc.SampleMask = UINT_MAX;
+			psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			psoDesc.NumRenderTargets = 0;
+			psoDesc.SampleDesc.Count = 1;
+
+			return psoLoadDesc;
+		};
+		FPSOLoadDesc psoLoadDesc = PermutationDesc.fnGetLoadDesc(0); // linear depth shares the PSO state
+		RegisterPSOPermutations(EBuiltinPSOs::DEPTH_PASS_PSO, std::move(PermutationDesc));
+
+		// linear depth (point lights)
+		psoLoadDesc.PSOName = "PSO_LinearDepthVSPS";
+		psoLoadDesc.ShaderStageCompileDescs.clear();
+		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "VSMain", "vs_5_1" });
+		psoLoadDesc.ShaderStageCompileDescs.push_back(FShaderStageCompileDesc{ ShaderFilePath, "PSMain", "ps_5_1" });
+		psoLoadDesc.D3D12GraphicsDesc.pRootSignature = mpBuiltinRootSignatures[8];
+		PSOLoadDescs.push_back({ EBuiltinPSOs::DEPTH_PASS_LINEAR_PSO, psoLoadDesc });
 	}
 
 
@@ -1472,14 +1523,153 @@ void VQRenderer::LoadPSOs()
 
 	// ---------------------------------------------------------------------------------------------------------------1
 
-	// TODO: threaded PSO loading
-	// single threaded PSO loading for now (shader compilation is still MTd)
-	for (const std::pair<PSO_ID, FPSOLoadDesc>& psoLoadDescIDPair : PSOLoadDescs)
+	// PSO permutations: prewarm the ones used in the last run, or the default permutations on the first run
+	const size_t NumBuiltinPSOs = PSOLoadDescs.size();
+	std::vector<std::pair<PSO_ID, PSOPermutationKey>> PrewarmPermutations;
+	std::vector<PSOPermutationUsageLog::FEntry> UsedPermutations;
+	if (mPSOPermutationUsageLog.Load(VQRenderer::PSOCacheDirectory + "/PSOPermutationUsage.log", UsedPermutations))
 	{
-		mPSOs[psoLoadDescIDPair.first] = this->LoadPSO(psoLoadDescIDPair.second);
+		for (const PSOPermutationUsageLog::FEntry& Entry : UsedPermutations)
+		{
+			auto it = std::find_if(RANGE(mPSOPermutationDescs), [&](const auto& kvp) { return kvp.second.Name == Entry.first; });
+			if (it == mPSOPermutationDescs.end() || (Entry.second & ~it->second.SupportedFeatures))
+				continue; // permutation removed since the last run
+			PrewarmPermutations.push_back({ it->first, Entry.second });
+		}
 	}
+	else
+	{
+		for (const auto& kvp : mPSOPermutationDescs)
+			PrewarmPermutations.push_back({ kvp.first, 0 });
+	}
+	for (const std::pair<PSO_ID, PSOPermutationKey>& Permutation : PrewarmPermutations)
+	{
+		PSOLoadDescs.push_back({ Permutation.first, GetPSOPermutationLoadDesc(Permutation.first, Permutation.second) });
+	}
+
+	// Two level task graph:
+	// 1. the shader stages of all the PSOs are deduplicated by their shader cache key & loaded/compiled in parallel
+	// 2. the shader load worker that completes the last shader stage of a PSO dispatches its PSO creation task
+	struct FShaderStageTask
+	{
+		FShaderStageCompileDesc   CompileDesc;
+		FShaderStageCompileResult Result;
+		std::vector<size_t>       DependentPSOs;
+	};
+	struct FPSOTask
+	{
+		std::vector<size_t>  ShaderStageTasks;
+		std::atomic<int>     NumPendingShaderStages = 0;
+		float                tShadersReady = 0.0f; // ms since the start of the PSO tasks
+		float                tCreate = 0.0f;       // ms
+		ID3D12PipelineState* pPSO = nullptr;
+		std::promise<void>   Done;
+	};
+
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point tStart = Clock::now();
+	auto fnElapsedMs = [tStart]() { return std::chrono::duration<float, std::milli>(Clock::now() - tStart).count(); };
 
-	int a = 5;
+	// build the graph
+	std::vector<FShaderStageTask>      ShaderStageTasks;
+	std::vector<FPSOTask>              PSOTasks(PSOLoadDescs.size());
+	std::unordered_map<uint64, size_t> ShaderStageTaskLookup; // shader cache key -> ShaderStageTasks index
+	size_t NumShaderStages = 0;
+	for (size_t iPSO = 0; iPSO < PSOLoadDescs.size(); ++iPSO)
+	{
+		FPSOTask& PSOTask = PSOTasks[iPSO];
+		for (const FShaderStageCompileDesc& ShaderStageDesc : PSOLoadDescs[iPSO].second.ShaderStageCompileDescs)
+		{
+			if (ShaderStageDesc.FilePath.empty())
+				continue;
+			++NumShaderStages;
+
+			const uint64 ShaderKey = mShaderCache.GetShaderKey(ShaderStageDesc); // 0: source can't be read, don't dedupe
+			auto it = ShaderKey != 0 ? ShaderStageTaskLookup.find(ShaderKey) : ShaderStageTaskLookup.end();
+			size_t iShaderStageTask = 0;
+			if (it == ShaderStageTaskLookup.end())
+			{
+				iShaderStageTask = ShaderStageTasks.size();
+				ShaderStageTasks.push_back({ ShaderStageDesc });
+				if (ShaderKey != 0)
+					ShaderStageTaskLookup[ShaderKey] = iShaderStageTask;
+			}
+			else
+			{
+				iShaderStageTask = it->second;
+			}
+
+			ShaderStageTasks[iShaderStageTask].DependentPSOs.push_back(iPSO);
+			PSOTask.ShaderStageTasks.push_back(iShaderStageTask);
+		}
+		PSOTask.NumPendingShaderStages = static_cast<int>(PSOTask.ShaderStageTasks.size());
+	}
+
+	auto fnDispatchPSOTask = [&](size_t iPSO)
+	{
+		mWorkers_PSOLoad.AddTask([&, iPSO]()
+		{
+			FPSOTask& PSOTask = PSOTasks[iPSO];
+			PSOTask.tShadersReady = fnElapsedMs();
+
+			std::vector<const FShaderStageCompileResult*> ShaderStages;
+			for (size_t iShaderStageTask : PSOTask.ShaderStageTasks)
+				ShaderStages.push_back(&ShaderStageTasks[iShaderStageTask].Result);
+			PSOTask.pPSO = this->CreatePSO(PSOLoadDescs[iPSO].second, ShaderStages);
+
+			PSOTask.tCreate = fnElapsedMs() - PSOTask.tShadersReady;
+			PSOTask.Done.set_value();
+		});
+	};
+
+	// kickoff workers
+	std::vector<std::future<void>> PSOTaskResults;
+	for (size_t iPSO = 0; iPSO < PSOTasks.size(); ++iPSO)
+	{
+		PSOTaskResults.push_back(PSOTasks[iPSO].Done.get_future());
+		if (PSOTasks[iPSO].ShaderStageTasks.empty())
+			fnDispatchPSOTask(iPSO);
+	}
+
+	std::vector<std::shared_future<void>> ShaderStageTaskResults;
+	for (size_t iShaderStageTask = 0; iShaderStageTask < ShaderStageTasks.size(); ++iShaderStageTask)
+	{
+		ShaderStageTaskResults.push_back(mWorkers_ShaderLoad.AddTask([&, iShaderStageTask]()
+		{
+			FShaderStageTask& ShaderStageTask = ShaderStageTasks[iShaderStageTask];
+			ShaderStageTask.Result = this->LoadShader(ShaderStageTask.CompileDesc);
+			for (size_t iPSO : ShaderStageTask.DependentPSOs)
+			{
+				if (PSOTasks[iPSO].NumPendingShaderStages.fetch_sub(1) == 1)
+					fnDispatchPSOTask(iPSO);
+			}
+		}));
+	}
+
+	// SYNC POINT - wait for all the PSOs, & the shader tasks to return as they reference the graph
+	for (std::future<void>& Result : PSOTaskResults)
+		Result.wait();
+	for (std::shared_future<void>& Result : ShaderStageTaskResults)
+		Result.wait();
+	const float tTotal = fnElapsedMs();
+
+	for (size_t iPSO = 0; iPSO < PSOTasks.size(); ++iPSO)
+	{
+		const FPSOTask& PSOTask = PSOTasks[iPSO];
+		if (iPSO < NumBuiltinPSOs)
+		{
+			mPSOs[PSOLoadDescs[iPSO].first] = PSOTask.pPSO;
+			mPSOLoadDescs[PSOLoadDescs[iPSO].first] = PSOLoadDescs[iPSO].second;
+		}
+		else
+		{
+			const std::pair<PSO_ID, PSOPermutationKey>& Permutation = PrewarmPermutations[iPSO - NumBuiltinPSOs];
+			mPSOPermutations[GetPSOPermutationID(Permutation.first, Permutation.second)].pPSO = PSOTask.pPSO;
+		}
+		Log::Info("[Renderer]      %-36s shaders ready @ %7.2fms  create=%6.2fms", PSOLoadDescs[iPSO].second.PSOName.c_str(), PSOTask.tShadersReady, PSOTask.tCreate);
+	}
+	Log::Info("[Renderer]    %zu PSOs loaded in %.2fms (%zu shader stages, %zu unique | %zu PSO permutations prewarmed)"
+		, PSOTasks.size(), tTotal, NumShaderStages, ShaderStageTasks.size(), PrewarmPermutations.size());
 }
 
 void VQRenderer::LoadDefaultResources()
@@ -1540,7 +1730,7 @@ void VQRenderer::LoadDefaultResources()
 }
 void VQRenderer::UploadVertexAndIndexBufferHeaps()
 {
-	std::lock_guard<std::mutex> lk(mMtxTextureUploadQueue);
+	std::lock_guard<std::mutex> lk(mMtxUploadHeap);
 	mStaticHeap_VertexBuffer.UploadData(mHeapUpload.GetCommandList());
 	mStaticHeap_IndexBuffer.UploadData(mHeapUpload.GetCommandList());
 }
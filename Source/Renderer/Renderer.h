@@ -26,6 +26,12 @@
 #include "Buffer.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "PSOCache.h"
+#include "PSOPermutations.h"
+#include "PipelineSwapQueue.h"
+#include "DeferredDeletionQueue.h"
+#include "TextureUploadQueue.h"
 #include "WindowRenderContext.h"
 
 #include "../Engine/Core/Types.h"
@@ -38,6 +44,8 @@
 #include "../../Libs/VQUtils/Source/Multithreading.h"
 
 #include <vector>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <array>
 #include <queue>
@@ -73,20 +81,13 @@ enum EBuiltinPSOs // TODO: hardcoded PSOs until a generic Shader solution is int
 	TONEMAPPER_PSO,
 	HDR_FP16_SWAPCHAIN_PSO,
 	SKYDOME_PSO,
-	SKYDOME_PSO_MSAA_4,
 	OBJECT_PSO,
-	OBJECT_PSO_MSAA_4,
 	DEPTH_PREPASS_PSO,
-	DEPTH_PREPASS_PSO_MSAA_4,
 	FORWARD_LIGHTING_PSO,
-	FORWARD_LIGHTING_PSO_MSAA_4,
 	WIREFRAME_PSO,
-	WIREFRAME_PSO_MSAA_4,
 	UNLIT_PSO,
-	UNLIT_PSO_MSAA_4,
 	DEPTH_PASS_PSO,
 	DEPTH_PASS_LINEAR_PSO,
-	DEPTH_PASS_ALPHAMASKED_PSO,
 	DEPTH_RESOLVE,
 	CUBEMAP_CONVOLUTION_DIFFUSE_PSO,
 	CUBEMAP_CONVOLUTION_DIFFUSE_PER_FACE_PSO,
@@ -110,14 +111,24 @@ enum EProceduralTextures
 	, NUM_PROCEDURAL_TEXTURES
 };
 
+// CPU memory accounting of the renderer's allocations. The engine points these at its memory tracking,
+// the renderer doesn't depend on it. The hooks that aren't set don't count anything.
+struct FRendererMemoryHooks
+{
+	std::function<void(size_t NumBytes)>                  fnOnImageAlloc;    // decoded images & the mip generation scratch images
+	std::function<void(size_t NumBytes)>                  fnOnImageFree;
+	std::function<std::shared_ptr<void>(size_t NumBytes)> fnTrackShaderBlob; // the bytes stay counted until the last copy of the returned handle is released
+};
+
 //-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 //
 // RENDERER
 //
 //-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-class VQRenderer
+class VQRenderer : private TextureUploadQueue<FTextureUploadDesc>::IBackend
 {
 public:
+	inline void                  SetMemoryHooks(const FRendererMemoryHooks& Hooks) { mMemoryHooks = Hooks; } // call before Initialize()
 	void                         Initialize(const FGraphicsSettings& Settings);
 	void                         Load();
 	void                         Unload();
@@ -138,9 +149,14 @@ public:
 
 	// Resource management
 	BufferID                     CreateBuffer(const FBufferDesc& desc);
-	TextureID                    CreateTextureFromFile(const char* pFilePath, bool bGenerateMips = false);
-	TextureID                    CreateTexture(const TextureCreateDesc& desc);
+	TextureID                    CreateTextureFromFile(const char* pFilePath, bool bGenerateMips = false, ETextureCompression Compression = ETextureCompression::NONE, bool bSRGB = false); // blocks until the texture is resident
+	TextureID                    CreateTexture(const TextureCreateDesc& desc); // blocks until the texture is resident
+	FTextureResidencyHandle      CreateTextureFromFileAsync(const char* pFilePath, bool bGenerateMips = false, ETextureCompression Compression = ETextureCompression::NONE, bool bSRGB = false, uint64 SourceHash = 0); // SourceHash=0: hashes the file for the texture cache
+	FTextureResidencyHandle      CreateTextureAsync(const TextureCreateDesc& desc);
+	TextureID                    CreateTexture(const std::string& TexName, const std::shared_ptr<FCookedTexture>& pCookedTexture, bool bCubemap = false); // blocks until the texture is resident
+	FTextureResidencyHandle      CreateTextureAsync(const std::string& TexName, const std::shared_ptr<FCookedTexture>& pCookedTexture, bool bCubemap = false);
 	void                         UploadVertexAndIndexBufferHeaps();
+	inline uint64                HashSourceFile(const std::string& FilePath) { return mSourceFileHashes.HashFile(FilePath); } // texture cache keys, thread-safe
 
 	// Allocates a ResourceView from the respective heap and returns a unique identifier.
 	SRV_ID                       CreateSRV(uint NumDescriptors = 1); // TODO: Rename to Alloc**V()
@@ -161,12 +177,28 @@ public:
 	void                         DestroyTexture(TextureID& texID);
 	void                         DestroySRV(SRV_ID& srvID);
 	void                         DestroyDSV(DSV_ID& dsvID);
+	void                         DestroyRTV(RTV_ID& rtvID);
+	void                         DestroyUAV(UAV_ID& uavID);
+
+	// The destroyed textures & the descriptors of the destroyed views are released once the frames that might be
+	// using them are done on the GPU: call ProcessDeferredReleases() at the start of each frame, before recording
+	// any command list, and SignalFrameSubmitted() right after submitting the frame's command lists.
+	void                         ProcessDeferredReleases();
+	void                         SignalFrameSubmitted(ID3D12CommandQueue* pQueue);
+	FDescriptorAllocatorStats    GetDescriptorHeapStats(EResourceHeapType HeapType) const;
+	inline FDeferredDeletionStats GetDeferredDeletionStats() const { return mDeferredDeletions.GetStats(); }
 
 	// Getters: PSO, RootSignature, Heap
-	inline ID3D12PipelineState*  GetPSO(EBuiltinPSOs pso) const { return mPSOs.at(static_cast<PSO_ID>(pso)); }
+	ID3D12PipelineState*         GetPSO(EBuiltinPSOs pso, PSOPermutationKey Key = 0); // compiles the permutation in the background on first use
 	inline ID3D12RootSignature*  GetRootSignature(int idx) const { return mpBuiltinRootSignatures[idx]; }
 	ID3D12DescriptorHeap*        GetDescHeap(EResourceHeapType HeapType);
 
+	// Shader hot reload: recompiles the PSOs depending on the changed shader source files in the background,
+	// ApplyShaderReloads() swaps them in at a frame boundary & releases the replaced PSOs once their frame fence completes
+	void                         ReloadShaders(const std::vector<std::string>& ChangedShaderFiles);
+	uint                         ApplyShaderReloads(); // returns the # PSOs swapped
+	inline std::vector<std::string> GetShaderSourceFiles() const { return mShaderCache.GetSourceFiles(); }
+
 	// Getters: Resource Views
 	const VBV&                   GetVertexBufferView(BufferID Id) const;
 	const IBV&                   GetIndexBufferView(BufferID Id) const;
@@ -185,6 +217,7 @@ public:
 	void                         GetTextureDimensions(TextureID Id, int& SizeX, int& SizeY, int& NumSlices, int& NumMips) const;
 	uint                         GetTextureMips(TextureID Id) const;
 	uint                         GetTextureSampleCount(TextureID) const;
+	FTextureResidencyHandle      GetTextureResidencyHandle(TextureID Id) const;
 
 	inline const VBV&            GetVBV(BufferID Id) const { return GetVertexBufferView(Id);    }
 	inline const IBV&            GetIBV(BufferID Id) const { return GetIndexBufferView(Id);     }
@@ -200,12 +233,18 @@ public:
 
 	// Texture Residency
 	void QueueTextureUpload(const FTextureUploadDesc& desc);
-	void ProcessTextureUpload(const FTextureUploadDesc& desc);
-	void ProcessTextureUploadQueue();
-	void TextureUploadThread_Main();
-	inline void StartTextureUploads() { mSignal_UploadThreadWorkReady.NotifyOne(); };
+	bool ProcessTextureUpload(const FTextureUploadDesc& desc); // returns false if the texture couldn't be uploaded
+	inline void StartTextureUploads() { mTextureUploadQueue.StartUploads(); };
 
 private:
+	// TextureUploadQueue backend, called from the upload thread
+	bool   RecordTextureUpload(FTextureUploadDesc& desc) override;
+	uint64 SubmitTextureUploads() override;
+	bool   IsTextureUploadBatchComplete(uint64 FenceValue) override;
+	void   WaitForTextureUploadBatch(uint64 FenceValue) override;
+	void   OnTextureResident(TextureID id) override;
+	void   DiscardTextureUpload(FTextureUploadDesc& desc) override;
+
 	using PSOArray_t = std::array<ID3D12PipelineState*, EBuiltinPSOs::NUM_BUILTIN_PSOs>;
 	
 	// GPU
@@ -232,6 +271,7 @@ private:
 
 	// resources & views
 	std::unordered_map<std::string, TextureID>     mLoadedTexturePaths;
+	FileHashCache                                  mSourceFileHashes; // of the cooked textures & environment maps
 	std::unordered_map<TextureID, Texture>         mTextures;
 	std::unordered_map<SamplerID, SAMPLER>         mSamplers;
 	std::unordered_map<BufferID, VBV>              mVBVs;
@@ -256,6 +296,22 @@ private:
 	// root signatures & PSOs
 	std::vector<ID3D12RootSignature*> mpBuiltinRootSignatures;
 	std::unordered_map<PSO_ID, ID3D12PipelineState*> mPSOs;
+	std::unordered_map<PSO_ID, FPSOLoadDesc>         mPSOLoadDescs; // builtin PSOs, kept for the shader hot reload
+	PipelineSwapQueue<ID3D12PipelineState>           mPSOSwapQueue;
+	ShaderCache                                      mShaderCache;
+	PSOCache                                         mPSOCache;
+
+	// PSO permutations: compiled on first use, or prewarmed at startup from the usage log of the last run
+	struct FPSOPermutation
+	{
+		ID3D12PipelineState*                     pPSO = nullptr;
+		std::shared_future<ID3D12PipelineState*> LoadTask;
+		bool                                     bUsed = false; // requested this run
+	};
+	std::unordered_map<PSO_ID, FPSOPermutationDesc>  mPSOPermutationDescs;
+	std::unordered_map<uint64, FPSOPermutation>      mPSOPermutations; // key: (PSO_ID << 32) | PSOPermutationKey
+	std::mutex                                       mMtxPSOPermutations;
+	PSOPermutationUsageLog                           mPSOPermutationUsageLog;
 
 	// data
 	std::unordered_map<HWND, FWindowRenderContext> mRenderContextLookup;
@@ -265,33 +321,29 @@ private:
 	std::unordered_map<EProceduralTextures, SRV_ID>    mLookup_ProceduralTextureSRVs;
 	std::unordered_map<EProceduralTextures, TextureID> mLookup_ProceduralTextureIDs;
 
-	std::atomic<bool>              mbExitUploadThread;
-	Signal                         mSignal_UploadThreadWorkReady;
-	std::thread                    mTextureUploadThread;
-	std::mutex                     mMtxTextureUploadQueue;
-	std::queue<FTextureUploadDesc> mTextureUploadQueue;
+	TextureUploadQueue<FTextureUploadDesc> mTextureUploadQueue;
+	std::mutex                     mMtxUploadHeap; // guards the upload heap command list
 
 	std::atomic<bool>              mbDefaultResourcesLoaded;
+
+	// deferred resource releases, keyed on the fence of the frame that was recording when the resource was destroyed
+	DeferredDeletionQueue          mDeferredDeletions;
+	FrameFenceTracker              mFrameFences;
+	ID3D12Fence*                   mpFrameFence = nullptr;
 	
 	
 	// Multithreaded PSO Loading
-	ThreadPool mWorkers_PSOLoad; // Loading a PSO will use one worker from shaderLoad pool for each shader stage to be compiled
-	struct FPSOLoadTaskContext
-	{
-		std::queue<FPSOLoadDesc> LoadQueue;
-		std::set<std::hash<FPSOLoadDesc>> UniquePSOHashes;
-	};
-	std::unordered_map <TaskID, FPSOLoadTaskContext> mLookup_PSOLoadContext;
+	ThreadPool mWorkers_PSOLoad; // PSO creation tasks, dispatched by the shader load workers once all the shader stages of a PSO are loaded
 
 	// Multithreaded Shader Loading
 	ThreadPool mWorkers_ShaderLoad;
-	struct FShaderLoadTaskContext { std::queue<FShaderStageCompileDesc> LoadQueue; };
-	std::unordered_map < TaskID, FShaderLoadTaskContext> mLookup_ShaderLoadContext;
-	
-	void EnqueueShaderLoadTask(TaskID PSOLoadTaskID, const FShaderStageCompileDesc&);
-	std::vector<std::shared_future<FShaderStageCompileResult>> StartShaderLoadTasks(TaskID PSOLoadTaskID);
+
+	FRendererMemoryHooks mMemoryHooks;
 
 private:
+	inline void OnImageAlloc(size_t NumBytes) const { if (mMemoryHooks.fnOnImageAlloc) mMemoryHooks.fnOnImageAlloc(NumBytes); }
+	inline void OnImageFree (size_t NumBytes) const { if (mMemoryHooks.fnOnImageFree ) mMemoryHooks.fnOnImageFree (NumBytes); }
+
 	void InitializeD3D12MA();
 	void InitializeHeaps();
 	
@@ -301,7 +353,10 @@ private:
 	void LoadDefaultResources();
 	
 
-	ID3D12PipelineState* LoadPSO(const FPSOLoadDesc& psoLoadDesc);
+	ID3D12PipelineState* LoadPSO(const FPSOLoadDesc& psoLoadDesc); // loads a single PSO, blocks until its shaders are loaded
+	void                 RegisterPSOPermutations(EBuiltinPSOs pso, FPSOPermutationDesc&& PermutationDesc);
+	FPSOLoadDesc         GetPSOPermutationLoadDesc(PSO_ID pso, PSOPermutationKey Key) const;
+	ID3D12PipelineState* CreatePSO(const FPSOLoadDesc& psoLoadDesc, const std::vector<const FShaderStageCompileResult*>& ShaderStages);
 	FShaderStageCompileResult LoadShader(const FShaderStageCompileDesc& shaderStageDesc);
 
 	BufferID CreateVertexBuffer(const FBufferDesc& desc);
@@ -322,5 +377,7 @@ public:
 
 	static std::string PSOCacheDirectory;
 	static std::string ShaderCacheDirectory;
+	static std::string TextureCacheDirectory;
+	static std::string EnvironmentMapCacheDirectory;
 	static void InitializeShaderAndPSOCacheDirectory();
 };
\ No newline at end of file
@@ -19,6 +19,8 @@
 #include "Renderer.h"
 #include "Device.h"
 #include "Texture.h"
+#include "TextureCache.h"
+#include "ImageProcessing.h"
 
 #include "../Engine/Core/Window.h"
 
@@ -30,6 +32,7 @@
 
 #include <cassert>
 #include <atomic>
+#include <chrono>
 
 using namespace Microsoft::WRL;
 using namespace VQSystemInfo;
@@ -54,6 +57,7 @@ static BufferID  LAST_USED_VBV_ID = 0;
 static BufferID  LAST_USED_IBV_ID = 0;
 static BufferID  LAST_USED_CBV_ID = 0;
 
+static size_t GetImageSizeInBytes(const Image& img) { return size_t(img.Width) * img.Height * img.BytesPerPixel; }
 
 namespace VQ_DXGI_UTILS
 {
@@ -276,101 +280,6 @@ namespace VQ_DXGI_UTILS
 		return 0;
 	}
 
-	void MipImage(void* pData, uint width, uint height, uint bytesPerPixel)
-	{
-		//compute mip so next call gets the lower mip    
-		int offsetsX[] = { 0,1,0,1 };
-		int offsetsY[] = { 0,0,1,1 };
-
-
-		assert(bytesPerPixel == 4 || bytesPerPixel == 16);
-		
-		if (bytesPerPixel == 4)
-		{
-			uint32_t* pImg = (uint32_t*)pData;
-#define GetByte(color, component) (((color) >> (8 * (component))) & 0xff)
-#define GetColor(ptr, x,y) (ptr[(x)+(y)*width])
-#define SetColor(ptr, x,y, col) ptr[(x)+(y)*width/2]=col;
-
-			for (uint32_t y = 0; y < height; y += 2)
-			{
-				for (uint32_t x = 0; x < width; x += 2)
-				{
-					uint32_t ccc = 0;
-					for (uint32_t c = 0; c < 4; c++)
-					{
-						uint32_t cc = 0;
-						for (uint32_t i = 0; i < 4; i++)
-							cc += GetByte(GetColor(pImg, x + offsetsX[i], y + offsetsY[i]), 3 - c);
-
-						ccc = (ccc << 8) | (cc / 4);
-					}
-					SetColor(pImg, x / 2, y / 2, ccc);
-				}
-			}
-		}
-
-		if (bytesPerPixel == 16)
-		{
-			using std::min;
-			float* pImg = (float*)pData;
-			// each iteration handles 4 pixels from current level, writes out to a single pixel
-			for (uint32_t y = 0; y < height; y += 2) // [0, 2, 4, ...]
-			for (uint32_t x = 0; x < width ; x += 2) // [0, 2, 4, ...]
-			{
-				float rgb[4][3] = {}; // 4 samples of rgb
-				for (uint smp = 0; smp < 4; ++smp)
-				{
-					for (int ch = 0; ch < 3; ++ch) // color channel ~ rgba, care for RGB only
-						rgb[smp][ch] = pImg[(x + offsetsX[smp]) * 4 + (y + offsetsY[smp]) * 4 * width + ch];
-				}
-
-				// filter: use min filter rather than interpolation
-				float rgbFiltered[4];
-				for (int ch = 0; ch < 3; ++ch)
-					rgbFiltered[ch] = min(rgb[0][ch], min(rgb[1][ch], min(rgb[2][ch], rgb[3][ch])));
-				rgbFiltered[3] = 1.0f;
-
-				uint outX = x >> 1;
-				uint outY = y >> 1;
-
-				for (int ch = 0; ch < 4; ++ch)
-					pImg[(outX * 4) + 4 * outY * (width >> 1) + ch] = rgbFiltered[ch];
-			}
-			
-		}
-
-#if 0
-		// For cutouts we need we need to scale the alpha channel to match the coverage of the top MIP map
-		// otherwise cutouts seem to get thinner when smaller mips are used
-		// Credits: http://the-witness.net/news/2010/09/computing-alpha-mipmaps/
-		//
-		if (m_alphaTestCoverage < 1.0)
-		{
-			float ini = 0;
-			float fin = 10;
-			float mid;
-			float alphaPercentage;
-			int iter = 0;
-			for (; iter < 50; iter++)
-			{
-				mid = (ini + fin) / 2;
-				alphaPercentage = GetAlphaCoverage(width / 2, height / 2, mid, (int)(m_cutOff * 255));
-
-				if (fabs(alphaPercentage - m_alphaTestCoverage) < .001)
-					break;
-
-				if (alphaPercentage > m_alphaTestCoverage)
-					fin = mid;
-				if (alphaPercentage < m_alphaTestCoverage)
-					ini = mid;
-			}
-			ScaleAlpha(width / 2, height / 2, mid);
-			//Trace(format("(%4i x %4i), %f, %f, %i\n", width, height, alphaPercentage, 1.0f, 0));       
-		}
-#endif
-	}
-
 	void CopyPixels(void* pData, void* pDest, uint32_t stride, uint32_t bytesWidth, uint32_t height)
 	{
 		for (uint32_t y = 0; y < height; y++)
@@ -399,7 +308,14 @@ BufferID VQRenderer::CreateBuffer(const FBufferDesc& desc)
 	return Id;
 }
 
-TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerateMips /*= false*/)
+TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerateMips /*= false*/, ETextureCompression Compression /*= ETextureCompression::NONE*/, bool bSRGB /*= false*/)
+{
+	FTextureResidencyHandle h = CreateTextureFromFileAsync(pFilePath, bGenerateMips, Compression, bSRGB);
+	h.WaitForResidency();
+	return h.ID;
+}
+
+FTextureResidencyHandle VQRenderer::CreateTextureFromFileAsync(const char* pFilePath, bool bGenerateMips /*= false*/, ETextureCompression Compression /*= ETextureCompression::NONE*/, bool bSRGB /*= false*/, uint64 SourceHash /*= 0*/)
 {
 	// check if we've already loaded the texture
 	auto it = mLoadedTexturePaths.find(pFilePath);
@@ -408,18 +324,18 @@ TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerat
 #if LOG_CACHED_RESOURCES_ON_LOAD
 		Log::Info("Texture already loaded: %s", pFilePath);
 #endif
-		return it->second;
+		return GetTextureResidencyHandle(it->second);
 	}
 	// check path
 	if (strlen(pFilePath) == 0)
 	{
 		Log::Warning("VQRenderer::CreateTextureFromFile: Empty FilePath provided");
-		return INVALID_ID;
+		return FTextureResidencyHandle::Failed();
 	}
 
 	// --------------------------------------------------------
 
-	TextureID ID = INVALID_ID;
+	FTextureResidencyHandle Handle;
 
 	Timer t; t.Start();
 	Texture tex;
@@ -427,7 +343,7 @@ TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerat
 	const std::string FileNameAndExtension = DirectoryUtil::GetFileNameFromPath(pFilePath);
 	TextureCreateDesc tDesc(FileNameAndExtension);
 
-	auto fnLoadImageFromDisk = [](const std::string& FilePath, Image& img)
+	auto fnLoadImageFromDisk = [this](const std::string& FilePath, Image& img)
 	{
 		if (FilePath.empty())
 		{
@@ -440,80 +356,181 @@ TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerat
 		assert(FilePathTokens.size() >= 1);
 
 		img = Image::LoadFromFile(FilePath.c_str());
-		return img.pData && img.BytesPerPixel > 0;
+		if (!img.pData || img.BytesPerPixel <= 0)
+			return false;
+
+		OnImageAlloc(GetImageSizeInBytes(img));
+		return true;
 	};
 
-	Image image;
-	const bool bSuccess = fnLoadImageFromDisk(pFilePath, image);
-	const int MipLevels = bGenerateMips ? image.CalculateMipLevelCount() : 1;
-	if (bSuccess)
+	// Block compressed textures are cooked (mip chain + compression) once and cached on disk,
+	// keyed by the hash of the source file. A cache hit skips the image decode altogether.
+	// The callers which read the source file already pass its hash in so the file isn't read again to hash it.
+	std::shared_ptr<FCookedTexture> pCookedTexture;
+	std::string CachedTexturePath;
+	if (Compression != ETextureCompression::NONE)
 	{
-		// Fill D3D12 Descriptor
-		tDesc.d3d12Desc = {};
-		tDesc.d3d12Desc.Width = image.Width;
-		tDesc.d3d12Desc.Height = image.Height;
-		tDesc.d3d12Desc.Format = image.IsHDR() ? DXGI_FORMAT_R32G32B32A32_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
-		tDesc.d3d12Desc.DepthOrArraySize = 1;
-		tDesc.d3d12Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		tDesc.d3d12Desc.Alignment = 0;
-		tDesc.d3d12Desc.DepthOrArraySize = 1;
-		tDesc.d3d12Desc.MipLevels = MipLevels;
-		tDesc.d3d12Desc.SampleDesc.Count = 1;
-		tDesc.d3d12Desc.SampleDesc.Quality = 0;
-		tDesc.d3d12Desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		tDesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		
-		tDesc.pData = image.pData;
-		tDesc.bGenerateMips = bGenerateMips;
+		if (SourceHash == 0)
+			SourceHash = mSourceFileHashes.HashFile(pFilePath);
+		CachedTexturePath = TextureCache::GetCachedTexturePath(VQRenderer::TextureCacheDirectory, pFilePath, SourceHash, Compression, bGenerateMips, bSRGB);
+		pCookedTexture = std::make_shared<FCookedTexture>();
+		if (SourceHash == 0 || !TextureCache::LoadCookedTexture(CachedTexturePath, *pCookedTexture))
+		{
+			pCookedTexture.reset();
+		}
+	}
 
-		tex.Create(mDevice.GetDevicePtr(), mpAllocator, tDesc);
-		ID = AddTexture_ThreadSafe(std::move(tex));
-		this->QueueTextureUpload(FTextureUploadDesc(std::move(image), ID, tDesc));
+	Image image;
+	const bool bSuccess = pCookedTexture || fnLoadImageFromDisk(pFilePath, image);
 
-		this->StartTextureUploads();
-		std::atomic<bool>& mbResident = mTextures.at(ID).mbResident; // Is this safe?
+	// cache miss: cook the decoded image. HDR images & textures w/ dimensions that aren't 
+	// multiples of 4 aren't compressed and keep going through the runtime mip generation.
+	if (bSuccess && !pCookedTexture && Compression != ETextureCompression::NONE
+		&& TextureCache::CanCompress(image.Width, image.Height, image.IsHDR()))
+	{
+		pCookedTexture = std::make_shared<FCookedTexture>();
+		if (TextureCache::CookTexture(image.pData, image.Width, image.Height, Compression, bGenerateMips, bSRGB, *pCookedTexture))
+		{
+			TextureCache::SaveCookedTexture(CachedTexturePath, *pCookedTexture);
+			OnImageFree(GetImageSizeInBytes(image));
+			image.Destroy();
+		}
+		else
+		{
+			pCookedTexture.reset();
+		}
+	}
 
-		// SYNC POINT - texture residency
-		//------------------------------------------------------------------------------
-		// NOTE: this isn't the best but good enough for small scenes for now.
-		// >60% of the CPU time is spent here during a scene load on the threads
-		while (!mbResident.load()); // BUSY WAIT here until the texture is made resident;
-		//------------------------------------------------------------------------------
+	if (!bSuccess)
+	{
+		Log::Error("VQRenderer::CreateTextureFromFile(): couldn't load %s", pFilePath);
+		return FTextureResidencyHandle::Failed();
+	}
+
+	const bool bCooked = pCookedTexture != nullptr;
+	const int MipLevels = bCooked ? pCookedTexture->MipCount : (bGenerateMips ? image.CalculateMipLevelCount() : 1);
+
+	// Fill D3D12 Descriptor
+	tDesc.d3d12Desc = {};
+	tDesc.d3d12Desc.Width  = bCooked ? pCookedTexture->Width  : image.Width;
+	tDesc.d3d12Desc.Height = bCooked ? pCookedTexture->Height : image.Height;
+	tDesc.d3d12Desc.Format = bCooked ? pCookedTexture->Format : (image.IsHDR() ? DXGI_FORMAT_R32G32B32A32_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM);
+	tDesc.d3d12Desc.DepthOrArraySize = 1;
+	tDesc.d3d12Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	tDesc.d3d12Desc.Alignment = 0;
+	tDesc.d3d12Desc.DepthOrArraySize = 1;
+	tDesc.d3d12Desc.MipLevels = MipLevels;
+	tDesc.d3d12Desc.SampleDesc.Count = 1;
+	tDesc.d3d12Desc.SampleDesc.Quality = 0;
+	tDesc.d3d12Desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	tDesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	
+	tDesc.pData = bCooked ? pCookedTexture->GetData() : image.pData;
+	tDesc.bGenerateMips = bCooked ? false : bGenerateMips; // cooked textures come with their mips
+
+	// the upload thread fulfills the promise once the texture is resident (or fails it), the caller
+	// gets the ID right away and can move on to decoding the next image.
+	std::shared_ptr<TextureResidencyPromise> pResidencyPromise = std::make_shared<TextureResidencyPromise>();
+	tex.Create(mDevice.GetDevicePtr(), mpAllocator, tDesc);
+	tex.mpResidency = pResidencyPromise;
+	Handle = FTextureResidencyHandle::Create(AddTexture_ThreadSafe(std::move(tex)), pResidencyPromise);
+
+	FTextureUploadDesc uploadDesc = bCooked
+		? FTextureUploadDesc(tDesc.pData, Handle.ID, tDesc)
+		: FTextureUploadDesc(std::move(image), Handle.ID, tDesc);
+	uploadDesc.pResidencyPromise = std::move(pResidencyPromise);
+	uploadDesc.pCookedTexture = std::move(pCookedTexture);
+	this->QueueTextureUpload(uploadDesc);
+	this->StartTextureUploads();
 
 #if LOG_RESOURCE_CREATE
-		Log::Info("VQRenderer::CreateTextureFromFile(): [%.2fs] %s", t.StopGetDeltaTimeAndReset(), pFilePath);
+	Log::Info("VQRenderer::CreateTextureFromFile(): [%.2fs] %s", t.StopGetDeltaTimeAndReset(), pFilePath);
 #endif
-	}
 
-	return ID;
+	return Handle;
 }
 
 TextureID VQRenderer::CreateTexture(const TextureCreateDesc& desc)
+{
+	FTextureResidencyHandle h = CreateTextureAsync(desc);
+	h.WaitForResidency();
+	return h.ID;
+}
+
+FTextureResidencyHandle VQRenderer::CreateTextureAsync(const TextureCreateDesc& desc)
 {
 	Texture tex;
 	Timer t; t.Start();
 
-	tex.Create(mDevice.GetDevicePtr(), mpAllocator, desc);
+	std::shared_ptr<TextureResidencyPromise> pResidencyPromise;
 
-	TextureID ID = AddTexture_ThreadSafe(std::move(tex));
+	tex.Create(mDevice.GetDevicePtr(), mpAllocator, desc);
 	if (desc.pData)
 	{
-		this->QueueTextureUpload(FTextureUploadDesc(desc.pData, ID, desc));
-
-		this->StartTextureUploads();
-		std::atomic<bool>& mbResident = mTextures.at(ID).mbResident;
-		while (!mbResident.load());  // busy wait here until the texture is made resident;
+		pResidencyPromise = std::make_shared<TextureResidencyPromise>();
+		tex.mpResidency = pResidencyPromise;
 	}
 
+	const FTextureResidencyHandle Handle = FTextureResidencyHandle::Create(AddTexture_ThreadSafe(std::move(tex)), pResidencyPromise);
 	if (desc.pData)
 	{
+		FTextureUploadDesc uploadDesc(desc.pData, Handle.ID, desc);
+		uploadDesc.pResidencyPromise = std::move(pResidencyPromise);
+		this->QueueTextureUpload(uploadDesc);
+		this->StartTextureUploads();
+
 #if LOG_RESOURCE_CREATE
 		Log::Info("VQRenderer::CreateTexture(): [%.2fs] %s", t.StopGetDeltaTimeAndReset(), desc.TexName.c_str());
 #endif
 	}
 
-	return ID;
+	return Handle;
+}
+TextureID VQRenderer::CreateTexture(const std::string& TexName, const std::shared_ptr<FCookedTexture>& pCookedTexture, bool bCubemap)
+{
+	FTextureResidencyHandle h = CreateTextureAsync(TexName, pCookedTexture, bCubemap);
+	h.WaitForResidency();
+	return h.ID;
 }
+
+FTextureResidencyHandle VQRenderer::CreateTextureAsync(const std::string& TexName, const std::shared_ptr<FCookedTexture>& pCookedTexture, bool bCubemap)
+{
+	assert(pCookedTexture && pCookedTexture->MipCount > 0);
+	assert(!bCubemap || pCookedTexture->ArraySize == 6);
+	const FCookedTexture& cooked = *pCookedTexture;
+
+	TextureCreateDesc tDesc(TexName);
+	tDesc.d3d12Desc = {};
+	tDesc.d3d12Desc.Width  = cooked.Width;
+	tDesc.d3d12Desc.Height = cooked.Height;
+	tDesc.d3d12Desc.Format = cooked.Format;
+	tDesc.d3d12Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	tDesc.d3d12Desc.Alignment = 0;
+	tDesc.d3d12Desc.DepthOrArraySize = static_cast<UINT16>(cooked.ArraySize);
+	tDesc.d3d12Desc.MipLevels = static_cast<UINT16>(cooked.MipCount);
+	tDesc.d3d12Desc.SampleDesc.Count = 1;
+	tDesc.d3d12Desc.SampleDesc.Quality = 0;
+	tDesc.d3d12Desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	tDesc.d3d12Desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	tDesc.pData = cooked.GetData();
+	tDesc.bCubemap = bCubemap;
+
+	Texture tex;
+	FTextureResidencyHandle Handle;
+	std::shared_ptr<TextureResidencyPromise> pResidencyPromise = std::make_shared<TextureResidencyPromise>();
+	tex.Create(mDevice.GetDevicePtr(), mpAllocator, tDesc);
+	tex.mpResidency = pResidencyPromise;
+	Handle = FTextureResidencyHandle::Create(AddTexture_ThreadSafe(std::move(tex)), pResidencyPromise);
+
+	FTextureUploadDesc uploadDesc(tDesc.pData, Handle.ID, tDesc);
+	uploadDesc.pResidencyPromise = std::move(pResidencyPromise);
+	uploadDesc.pCookedTexture = pCookedTexture;
+	this->QueueTextureUpload(uploadDesc);
+	this->StartTextureUploads();
+
+	return Handle;
+}
+
 SRV_ID VQRenderer::CreateAndInitializeSRV(TextureID texID)
 {
 	SRV_ID Id = INVALID_ID;
@@ -744,183 +761,268 @@ void VQRenderer::InitializeUAV(UAV_ID uavID, uint heapIndex, TextureID texID)
 	mTextures.at(texID).InitializeUAV(heapIndex, &mUAVs.at(uavID), &uavDesc);
 }
 
-void VQRenderer::EnqueueShaderLoadTask(TaskID PSOLoadTaskID, const FShaderStageCompileDesc& ShaderStageCompileDesc)
+// Hashes the PSO desc member by member (the structs have padding bytes) along w/ the keys of its shaders,
+// which change w/ the contents of the shader sources & their includes, macros & compiler.
+static FHash128 CalculatePSOHash(const FPSOLoadDesc& psoLoadDesc, bool bComputePSO, ShaderCache& shaderCache, const std::vector<ID3D12RootSignature*>& RootSignatures)
 {
-	FShaderLoadTaskContext& taskContext = mLookup_ShaderLoadContext[PSOLoadTaskID];
-	taskContext.LoadQueue.push(ShaderStageCompileDesc);
-}
+	HashBuilder128 h;
+	h.Add(bComputePSO);
 
-std::vector<std::shared_future<FShaderStageCompileResult>> VQRenderer::StartShaderLoadTasks(TaskID PSOLoadTaskID)
-{
-	if (mLookup_ShaderLoadContext.find(PSOLoadTaskID) == mLookup_ShaderLoadContext.end())
+	for (const FShaderStageCompileDesc& shaderStageDesc : psoLoadDesc.ShaderStageCompileDescs)
 	{
-		Log::Error("Couldn't find PSO Load Task [ID=%d]", PSOLoadTaskID);
-		return {};
+		if (shaderStageDesc.FilePath.empty())
+			continue;
+		h.Add(ShaderUtils::GetShaderStageEnumFromShaderModel(shaderStageDesc.ShaderModel));
+		h.Add(shaderCache.GetShaderKey(shaderStageDesc));
 	}
 
-	// get the task queue associated with the PSOLoadTaskID
-	FShaderLoadTaskContext& taskCtx = mLookup_ShaderLoadContext.at(PSOLoadTaskID);
-	std::queue<FShaderStageCompileDesc>& TaskQueue = taskCtx.LoadQueue;
+	// root signatures are created in a fixed order, the index identifies them across runs
+	auto fnAddRootSignature = [&](ID3D12RootSignature* pRS)
+	{
+		auto it = std::find(RootSignatures.begin(), RootSignatures.end(), pRS);
+		h.Add(it == RootSignatures.end() ? -1 : static_cast<int>(it - RootSignatures.begin()));
+	};
 
-	// kickoff shader load workers
-	std::vector<std::shared_future<FShaderStageCompileResult>> taskResults;
-	while (!TaskQueue.empty())
+	if (bComputePSO)
 	{
-		FShaderStageCompileDesc compileDesc = std::move(TaskQueue.front());
-		TaskQueue.pop();
+		const D3D12_COMPUTE_PIPELINE_STATE_DESC& d = psoLoadDesc.D3D12ComputeDesc;
+		fnAddRootSignature(d.pRootSignature);
+		h.Add(d.NodeMask);
+		h.Add(d.Flags);
+		return h.GetHash();
+	}
 
-		std::shared_future<FShaderStageCompileResult> ShaderCompileResult = mWorkers_ShaderLoad.AddTask([=]()
-		{
-			return this->LoadShader(compileDesc);
-		});
-		taskResults.push_back(std::move(ShaderCompileResult));
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& d = psoLoadDesc.D3D12GraphicsDesc;
+	fnAddRootSignature(d.pRootSignature);
+
+	h.Add(d.StreamOutput.NumEntries);
+	for (UINT i = 0; i < d.StreamOutput.NumEntries; ++i)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& e = d.StreamOutput.pSODeclaration[i];
+		h.Add(e.Stream); h.Add(e.SemanticName); h.Add(e.SemanticIndex); h.Add(e.StartComponent); h.Add(e.ComponentCount); h.Add(e.OutputSlot);
+	}
+	h.Add(d.StreamOutput.NumStrides);
+	for (UINT i = 0; i < d.StreamOutput.NumStrides; ++i)
+		h.Add(d.StreamOutput.pBufferStrides[i]);
+	h.Add(d.StreamOutput.RasterizedStream);
+
+	h.Add(d.BlendState.AlphaToCoverageEnable);
+	h.Add(d.BlendState.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& rt : d.BlendState.RenderTarget)
+	{
+		h.Add(rt.BlendEnable); h.Add(rt.LogicOpEnable);
+		h.Add(rt.SrcBlend); h.Add(rt.DestBlend); h.Add(rt.BlendOp);
+		h.Add(rt.SrcBlendAlpha); h.Add(rt.DestBlendAlpha); h.Add(rt.BlendOpAlpha);
+		h.Add(rt.LogicOp); h.Add(rt.RenderTargetWriteMask);
+	}
+	h.Add(d.SampleMask);
+
+	const D3D12_RASTERIZER_DESC& rs = d.RasterizerState;
+	h.Add(rs.FillMode); h.Add(rs.CullMode); h.Add(rs.FrontCounterClockwise);
+	h.Add(rs.DepthBias); h.Add(rs.DepthBiasClamp); h.Add(rs.SlopeScaledDepthBias);
+	h.Add(rs.DepthClipEnable); h.Add(rs.MultisampleEnable); h.Add(rs.AntialiasedLineEnable);
+	h.Add(rs.ForcedSampleCount); h.Add(rs.ConservativeRaster);
+
+	const D3D12_DEPTH_STENCIL_DESC& ds = d.DepthStencilState;
+	h.Add(ds.DepthEnable); h.Add(ds.DepthWriteMask); h.Add(ds.DepthFunc);
+	h.Add(ds.StencilEnable); h.Add(ds.StencilReadMask); h.Add(ds.StencilWriteMask);
+	for (const D3D12_DEPTH_STENCILOP_DESC& op : { ds.FrontFace, ds.BackFace })
+	{
+		h.Add(op.StencilFailOp); h.Add(op.StencilDepthFailOp); h.Add(op.StencilPassOp); h.Add(op.StencilFunc);
+	}
+
+	// the input layout is reflected from the VS (its key is hashed above) unless the desc provides one
+	h.Add(d.InputLayout.NumElements);
+	for (UINT i = 0; i < d.InputLayout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& e = d.InputLayout.pInputElementDescs[i];
+		h.Add(e.SemanticName); h.Add(e.SemanticIndex); h.Add(e.Format); h.Add(e.InputSlot);
+		h.Add(e.AlignedByteOffset); h.Add(e.InputSlotClass); h.Add(e.InstanceDataStepRate);
 	}
 
-	return taskResults;
+	h.Add(d.IBStripCutValue);
+	h.Add(d.PrimitiveTopologyType);
+	h.Add(d.NumRenderTargets);
+	for (DXGI_FORMAT fmt : d.RTVFormats)
+		h.Add(fmt);
+	h.Add(d.DSVFormat);
+	h.Add(d.SampleDesc.Count);
+	h.Add(d.SampleDesc.Quality);
+	h.Add(d.NodeMask);
+	h.Add(d.Flags);
+	return h.GetHash();
 }
 
 ID3D12PipelineState* VQRenderer::LoadPSO(const FPSOLoadDesc& psoLoadDesc)
 {
-	static std::atomic<TaskID> LAST_USED_TASK_ID = 0;
-	
-	TaskID               PSOLoadTaskID = LAST_USED_TASK_ID.fetch_add(1);
+	// kickoff shader load workers
+	std::vector<std::shared_future<FShaderStageCompileResult>> shaderCompileResults;
+	for (const FShaderStageCompileDesc& shaderStageDesc : psoLoadDesc.ShaderStageCompileDescs)
+	{
+		if (shaderStageDesc.FilePath.empty())
+			continue;
+		shaderCompileResults.push_back(mWorkers_ShaderLoad.AddTask([=]()
+		{
+			return this->LoadShader(shaderStageDesc);
+		}));
+	}
+
+	// SYNC POINT - wait for shaders to load / compile
+	std::vector<FShaderStageCompileResult> ShaderStages;
+	std::vector<const FShaderStageCompileResult*> pShaderStages;
+	for (std::shared_future<FShaderStageCompileResult>& result : shaderCompileResults)
+	{
+		assert(result.valid());
+		ShaderStages.push_back(result.get());
+	}
+	for (const FShaderStageCompileResult& ShaderStage : ShaderStages)
+		pShaderStages.push_back(&ShaderStage);
+
+	return CreatePSO(psoLoadDesc, pShaderStages);
+}
+
+ID3D12PipelineState* VQRenderer::CreatePSO(const FPSOLoadDesc& psoLoadDesc, const std::vector<const FShaderStageCompileResult*>& ShaderStages)
+{
 	ID3D12PipelineState* pPSO = nullptr;
 
 	HRESULT hr = {};
 	ID3D12Device* pDevice = mDevice.GetDevicePtr();
 
-	// calc PSO hash
-	//std::hash<FPSOLoadDesc> PSO_HASH = 
-
-	// check if PSO is cached
-	const bool bCachedPSOExists = false;
-	const bool bCacheDirty = false;
 	const bool bComputePSO = std::find_if(RANGE(psoLoadDesc.ShaderStageCompileDescs) // check if ShaderModel has cs_*_*
 			, [](const FShaderStageCompileDesc& desc) { return ShaderUtils::GetShaderStageEnumFromShaderModel(desc.ShaderModel) == EShaderStage::CS; }
 		) != psoLoadDesc.ShaderStageCompileDescs.end();
 
-	std::vector<std::shared_future<FShaderStageCompileResult>> shaderCompileResults;
+	// check if PSO is cached: the driver skips compiling the PSO if it accepts the cached blob
+	const FHash128 PSOHash = CalculatePSOHash(psoLoadDesc, bComputePSO, mShaderCache, mpBuiltinRootSignatures);
+	std::vector<uint8> CachedPSOBlob;
+	bool bCachedPSOExists = mPSOCache.LoadBlob(PSOHash, CachedPSOBlob);
+	const D3D12_CACHED_PIPELINE_STATE CachedPSO = bCachedPSOExists 
+		? D3D12_CACHED_PIPELINE_STATE{ CachedPSOBlob.data(), CachedPSOBlob.size() } 
+		: D3D12_CACHED_PIPELINE_STATE{ nullptr, 0 };
+
 	std::unordered_map<EShaderStage, ID3D12ShaderReflection*> ShaderReflections;
 
-	// compile PSO if no cache or cache dirty, otherwise load cached binary
-	if (!bCachedPSOExists || bCacheDirty) 
+	// Check for compile errors
+	for (const FShaderStageCompileResult* pShaderCompileResult : ShaderStages)
 	{
-		// Prepare shader loading tasks for worker threads
-		for (const FShaderStageCompileDesc& shaderStageDesc : psoLoadDesc.ShaderStageCompileDescs)
+		if (pShaderCompileResult->ShaderBlob.IsNull())
 		{
-			if (shaderStageDesc.FilePath.empty())
-				continue;
-			EnqueueShaderLoadTask(PSOLoadTaskID, shaderStageDesc);
+			Log::Error("PSO Compile failed: %s", psoLoadDesc.PSOName.c_str());
+			return nullptr;
 		}
+	}
 
-		// kickoff shader compiler workers
-		shaderCompileResults = std::move( StartShaderLoadTasks(PSOLoadTaskID) );
+	// Compile the PSO using the shaders
+	if (bComputePSO) // COMPUTE PSO ------------------------------------------------------------
+	{
+		D3D12_COMPUTE_PIPELINE_STATE_DESC  d3d12ComputePSODesc = psoLoadDesc.D3D12ComputeDesc;
 
-		// SYNC POINT - wait for shaders to load / compile
-		for (std::shared_future<FShaderStageCompileResult>& result : shaderCompileResults)
+		// Assign CS shader blob to PSODesc
+		for (const FShaderStageCompileResult* pShaderCompileResult : ShaderStages)
 		{
-			assert(result.valid());
-			result.wait();
+			const FShaderStageCompileResult& ShaderCompileResult = *pShaderCompileResult;
+
+			CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
+			d3d12ComputePSODesc.CS = ShaderByteCode;
 		}
 
-		// Check for compile errors
-		for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
+		// TODO: assign root signature
+
+		// Compile PSO
+		d3d12ComputePSODesc.CachedPSO = CachedPSO;
+		hr = pDevice->CreateComputePipelineState(&d3d12ComputePSODesc, IID_PPV_ARGS(&pPSO));
+		if (bCachedPSOExists && FAILED(hr))
 		{
-			FShaderStageCompileResult ShaderCompileResult = TaskResult.get();
-			if (ShaderCompileResult.ShaderBlob.IsNull())
-			{
-				Log::Error("PSO Compile failed: PSOLoadTaskID=%d", PSOLoadTaskID);
-				return nullptr;
-			}
+			Log::Warning("Cached PSO rejected by the driver, recompiling: %s", psoLoadDesc.PSOName.c_str());
+			mPSOCache.RejectBlob(PSOHash);
+			bCachedPSOExists = false;
+			d3d12ComputePSODesc.CachedPSO = {};
+			hr = pDevice->CreateComputePipelineState(&d3d12ComputePSODesc, IID_PPV_ARGS(&pPSO));
 		}
+	}
+	else // GRAPHICS PSO ------------------------------------------------------------------------
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12GraphicsPSODesc = psoLoadDesc.D3D12GraphicsDesc;
 
-		// Compile the PSO using the shaders
-		if (bComputePSO) // COMPUTE PSO ------------------------------------------------------------
+		// Assign shader blobs to PSODesc
+		for (const FShaderStageCompileResult* pShaderCompileResult : ShaderStages)
 		{
-			D3D12_COMPUTE_PIPELINE_STATE_DESC  d3d12ComputePSODesc = psoLoadDesc.D3D12ComputeDesc;
+			const FShaderStageCompileResult& ShaderCompileResult = *pShaderCompileResult;
 
-			// Assign CS shader blob to PSODesc
-			for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
+			CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
+			switch (ShaderCompileResult.ShaderStageEnum)
 			{
-				FShaderStageCompileResult ShaderCompileResult = TaskResult.get();
-
-				CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
-				d3d12ComputePSODesc.CS = ShaderByteCode;
+			case EShaderStage::VS: d3d12GraphicsPSODesc.VS = ShaderByteCode; break;
+			case EShaderStage::GS: d3d12GraphicsPSODesc.GS = ShaderByteCode; break;
+			case EShaderStage::DS: d3d12GraphicsPSODesc.DS = ShaderByteCode; break;
+			case EShaderStage::HS: d3d12GraphicsPSODesc.HS = ShaderByteCode; break;
+			case EShaderStage::PS: d3d12GraphicsPSODesc.PS = ShaderByteCode; break;
 			}
 
-			// TODO: assign root signature
-
-			// Compile PSO
-			hr = pDevice->CreateComputePipelineState(&d3d12ComputePSODesc, IID_PPV_ARGS(&pPSO));
+			// reflect shader
+			ID3D12ShaderReflection*& pReflection = ShaderReflections[ShaderCompileResult.ShaderStageEnum];
+			D3DReflect(ShaderByteCode.pShaderBytecode, ShaderByteCode.BytecodeLength, IID_PPV_ARGS(&pReflection));
 		}
-		else // GRAPHICS PSO ------------------------------------------------------------------------
+		
+		// assign input layout
+		std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+		const bool bHasVS = ShaderReflections.find(EShaderStage::VS) != ShaderReflections.end();
+		if (bHasVS)
 		{
-			D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12GraphicsPSODesc = psoLoadDesc.D3D12GraphicsDesc;
-
-			// Assign shader blobs to PSODesc
-			for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
-			{
-				FShaderStageCompileResult ShaderCompileResult = TaskResult.get();
-
-				CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
-				switch (ShaderCompileResult.ShaderStageEnum)
-				{
-				case EShaderStage::VS: d3d12GraphicsPSODesc.VS = ShaderByteCode; break;
-				case EShaderStage::GS: d3d12GraphicsPSODesc.GS = ShaderByteCode; break;
-				case EShaderStage::DS: d3d12GraphicsPSODesc.DS = ShaderByteCode; break;
-				case EShaderStage::HS: d3d12GraphicsPSODesc.HS = ShaderByteCode; break;
-				case EShaderStage::PS: d3d12GraphicsPSODesc.PS = ShaderByteCode; break;
-				}
-
-				// reflect shader
-				ID3D12ShaderReflection*& pReflection = ShaderReflections[ShaderCompileResult.ShaderStageEnum];
-				D3DReflect(ShaderByteCode.pShaderBytecode, ShaderByteCode.BytecodeLength, IID_PPV_ARGS(&pReflection));
-			}
-			
-			// assign input layout
-			std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
-			const bool bHasVS = ShaderReflections.find(EShaderStage::VS) != ShaderReflections.end();
-			if (bHasVS)
-			{
-				inputLayout = ShaderUtils::ReflectInputLayoutFromVS(ShaderReflections.at(EShaderStage::VS));
-				d3d12GraphicsPSODesc.InputLayout = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
-			}
+			inputLayout = ShaderUtils::ReflectInputLayoutFromVS(ShaderReflections.at(EShaderStage::VS));
+			d3d12GraphicsPSODesc.InputLayout = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
+		}
 
-			// TODO: assign root signature
+		// TODO: assign root signature
 #if 0
+		{
+			for (auto& it : ShaderReflections)
 			{
-				for (auto& it : ShaderReflections)
+				EShaderStage eShaderStage = it.first;
+				ID3D12ShaderReflection*& pRefl = it.second;
+
+				D3D12_SHADER_DESC shaderDesc = {};
+				pRefl->GetDesc(&shaderDesc);
+				
+				std::vector< D3D12_SHADER_INPUT_BIND_DESC> boundRscDescs(shaderDesc.BoundResources);
+				for (UINT i = 0; i < shaderDesc.BoundResources; ++i)
 				{
-					EShaderStage eShaderStage = it.first;
-					ID3D12ShaderReflection*& pRefl = it.second;
-
-					D3D12_SHADER_DESC shaderDesc = {};
-					pRefl->GetDesc(&shaderDesc);
-					
-					std::vector< D3D12_SHADER_INPUT_BIND_DESC> boundRscDescs(shaderDesc.BoundResources);
-					for (UINT i = 0; i < shaderDesc.BoundResources; ++i)
-					{
-						pRefl->GetResourceBindingDesc(i, &boundRscDescs[i]);
-					}
-
-					int a = 5;
+					pRefl->GetResourceBindingDesc(i, &boundRscDescs[i]);
 				}
+
+				int a = 5;
 			}
+		}
 #endif
 
-			// Compile PSO
+		// Compile PSO
+		d3d12GraphicsPSODesc.CachedPSO = CachedPSO;
+		hr = pDevice->CreateGraphicsPipelineState(&d3d12GraphicsPSODesc, IID_PPV_ARGS(&pPSO));
+		if (bCachedPSOExists && FAILED(hr))
+		{
+			Log::Warning("Cached PSO rejected by the driver, recompiling: %s", psoLoadDesc.PSOName.c_str());
+			mPSOCache.RejectBlob(PSOHash);
+			bCachedPSOExists = false;
+			d3d12GraphicsPSODesc.CachedPSO = {};
 			hr = pDevice->CreateGraphicsPipelineState(&d3d12GraphicsPSODesc, IID_PPV_ARGS(&pPSO));
 		}
 	}
-	else // load cached PSO
-	{
-		assert(false); // TODO
-	}
 
 	// Check PSO compile result
 	assert(hr == S_OK);
 	SetName(pPSO, psoLoadDesc.PSOName.c_str());
 
+	// cache the compiled PSO for the next run
+	if (SUCCEEDED(hr) && !bCachedPSOExists)
+	{
+		ID3DBlob* pCachedBlob = nullptr;
+		if (SUCCEEDED(pPSO->GetCachedBlob(&pCachedBlob)))
+		{
+			mPSOCache.StoreBlob(PSOHash, psoLoadDesc.PSOName, pCachedBlob->GetBufferPointer(), pCachedBlob->GetBufferSize());
+			pCachedBlob->Release();
+		}
+	}
+
 	// release reflections
 	for(auto it = ShaderReflections.begin(); it != ShaderReflections.end(); ++it)
 	{
@@ -931,27 +1033,173 @@ ID3D12PipelineState* VQRenderer::LoadPSO(const FPSOLoadDesc& psoLoadDesc)
 	return pPSO;
 }
 
-FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc& ShaderStageCompileDesc)
+void VQRenderer::RegisterPSOPermutations(EBuiltinPSOs pso, FPSOPermutationDesc&& PermutationDesc)
 {
-	using namespace ShaderUtils;
-	constexpr const char* SHADER_BINARY_EXTENSION = ".bin";
+	assert((PermutationDesc.RequiredFeatures & ~PermutationDesc.SupportedFeatures) == 0);
+	assert(PermutationDesc.fnGetLoadDesc);
+	mPSOPermutationDescs[static_cast<PSO_ID>(pso)] = std::move(PermutationDesc);
+}
+
+FPSOLoadDesc VQRenderer::GetPSOPermutationLoadDesc(PSO_ID pso, PSOPermutationKey Key) const
+{
+	const FPSOPermutationDesc& PermutationDesc = mPSOPermutationDescs.at(pso);
+	FPSOLoadDesc psoLoadDesc = PermutationDesc.fnGetLoadDesc(Key);
+	psoLoadDesc.PSOName = GetPSOPermutationName(PermutationDesc.Name, Key);
+	return psoLoadDesc;
+}
+
+ID3D12PipelineState* VQRenderer::GetPSO(EBuiltinPSOs pso, PSOPermutationKey Key)
+{
+	const PSO_ID psoID = static_cast<PSO_ID>(pso);
+	auto itDesc = mPSOPermutationDescs.find(psoID);
+	if (itDesc == mPSOPermutationDescs.end())
+	{
+		assert(Key == 0); // not a permutation family
+		return mPSOs.at(psoID);
+	}
+	const FPSOPermutationDesc& PermutationDesc = itDesc->second;
+	assert((Key & ~PermutationDesc.SupportedFeatures) == 0);
+
+	std::unique_lock<std::mutex> lk(mMtxPSOPermutations);
+	FPSOPermutation& Permutation = mPSOPermutations[GetPSOPermutationID(psoID, Key)];
+	if (!Permutation.bUsed)
+	{
+		Permutation.bUsed = true;
+		mPSOPermutationUsageLog.Record(PermutationDesc.Name, Key);
+	}
+	if (Permutation.pPSO)
+		return Permutation.pPSO;
+
+	// first use: compile in the background
+	if (!Permutation.LoadTask.valid())
+	{
+		FPSOLoadDesc psoLoadDesc = GetPSOPermutationLoadDesc(psoID, Key);
+		Log::Info("[Renderer] Compiling PSO permutation on first use: %s", psoLoadDesc.PSOName.c_str());
+		Permutation.LoadTask = mWorkers_PSOLoad.AddTask([=]()
+		{
+			return this->LoadPSO(psoLoadDesc);
+		});
+	}
+
+	if (Permutation.LoadTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		Permutation.pPSO = Permutation.LoadTask.get();
+		return Permutation.pPSO;
+	}
+
+	// still compiling: use the permutation w/ only the required features if it's ready
+	const PSOPermutationKey FallbackKey = Key & PermutationDesc.RequiredFeatures;
+	if (FallbackKey != Key)
+	{
+		auto itFallback = mPSOPermutations.find(GetPSOPermutationID(psoID, FallbackKey));
+		if (itFallback != mPSOPermutations.end() && itFallback->second.pPSO)
+			return itFallback->second.pPSO;
+	}
+
+	// no compatible fallback: wait for the permutation
+	std::shared_future<ID3D12PipelineState*> LoadTask = Permutation.LoadTask;
+	lk.unlock();
+	ID3D12PipelineState* pPSO = LoadTask.get();
+	lk.lock();
+	Permutation.pPSO = pPSO; // references into the unordered_map stay valid
+	return pPSO;
+}
+
+void VQRenderer::ReloadShaders(const std::vector<std::string>& ChangedShaderFiles)
+{
+	if (ChangedShaderFiles.empty())
+		return;
 
-	const std::string ShaderSourcePath = StrUtil::UnicodeToASCII<256>( ShaderStageCompileDesc.FilePath.c_str() ); 
+	// the changed files are re-hashed on the next shader key query, so the PSOs below miss the shader cache
+	mShaderCache.InvalidateSourceFiles(ChangedShaderFiles);
+	const std::unordered_set<std::string> ChangedFiles(ChangedShaderFiles.begin(), ChangedShaderFiles.end());
+	auto fnDependsOnChangedFiles = [&](const FPSOLoadDesc& psoLoadDesc)
+	{
+		for (const FShaderStageCompileDesc& ShaderStageDesc : psoLoadDesc.ShaderStageCompileDescs)
+		{
+			if (!ShaderStageDesc.FilePath.empty() && mShaderCache.DependsOnAny(ShaderCache::GetSourceFilePath(ShaderStageDesc), ChangedFiles))
+				return true;
+		}
+		return false;
+	};
+
+	// gather the dependent PSOs: builtins & the permutations that are loaded
+	std::vector<std::pair<uint64, FPSOLoadDesc>> ReloadDescs;
+	for (const auto& kvp : mPSOLoadDescs)
+	{
+		if (fnDependsOnChangedFiles(kvp.second))
+			ReloadDescs.push_back({ GetPSOPermutationID(kvp.first, 0), kvp.second });
+	}
+	{
+		std::lock_guard<std::mutex> lk(mMtxPSOPermutations);
+		for (const auto& kvp : mPSOPermutations)
+		{
+			if (!kvp.second.pPSO)
+				continue; // not loaded yet
+			const PSO_ID psoID = static_cast<PSO_ID>(kvp.first >> 32);
+			const PSOPermutationKey Key = static_cast<PSOPermutationKey>(kvp.first & 0xFFFFFFFF);
+			FPSOLoadDesc psoLoadDesc = GetPSOPermutationLoadDesc(psoID, Key);
+			if (fnDependsOnChangedFiles(psoLoadDesc))
+				ReloadDescs.push_back({ kvp.first, std::move(psoLoadDesc) });
+		}
+	}
+
+	for (const std::string& FilePath : ChangedShaderFiles)
+		Log::Info("[Renderer] Shader changed: %s", FilePath.c_str());
+	Log::Info("[Renderer] Recompiling %zu dependent PSOs", ReloadDescs.size());
+
+	for (std::pair<uint64, FPSOLoadDesc>& ReloadDesc : ReloadDescs)
+	{
+		const FPSOLoadDesc& psoLoadDesc = ReloadDesc.second;
+		mPSOSwapQueue.Enqueue(ReloadDesc.first, mWorkers_PSOLoad.AddTask([=]()
+		{
+			return this->LoadPSO(psoLoadDesc);
+		}));
+	}
+}
 
-	// calculate shader hash
-	const size_t ShaderHash = GeneratePreprocessorDefinitionsHash(ShaderStageCompileDesc.Macros);
+uint VQRenderer::ApplyShaderReloads()
+{
+	// the replaced PSOs may be referenced up to the frame that's being recorded
+	const uint64 RetireFrameFence = mFrameFences.GetRecordingFrameFence();
+	const PipelineSwapQueue<ID3D12PipelineState>::FSwapResult Result = mPSOSwapQueue.SwapReady(RetireFrameFence, [&](uint64 ID, ID3D12PipelineState* pNewPSO)
+	{
+		const PSO_ID psoID = static_cast<PSO_ID>(ID >> 32);
+		ID3D12PipelineState* pOldPSO = nullptr;
+		if (mPSOPermutationDescs.find(psoID) == mPSOPermutationDescs.end())
+		{
+			pOldPSO = mPSOs.at(psoID);
+			mPSOs.at(psoID) = pNewPSO;
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lk(mMtxPSOPermutations);
+			FPSOPermutation& Permutation = mPSOPermutations.at(ID);
+			pOldPSO = Permutation.pPSO;
+			Permutation.pPSO = pNewPSO;
+		}
+		return pOldPSO;
+	});
 
-	// determine cached shader file name
-	const std::string cacheFileName = ShaderStageCompileDesc.Macros.empty()
-		? DirectoryUtil::GetFileNameWithoutExtension(ShaderSourcePath) + "_" + ShaderStageCompileDesc.EntryPoint + SHADER_BINARY_EXTENSION
-		: DirectoryUtil::GetFileNameWithoutExtension(ShaderSourcePath) + "_" + ShaderStageCompileDesc.EntryPoint + "_" + std::to_string(ShaderHash) + SHADER_BINARY_EXTENSION;
+	if (Result.NumSwapped > 0)
+		Log::Info("[Renderer] Hot reloaded %u PSOs", Result.NumSwapped);
+	if (Result.NumFailed > 0)
+		Log::Warning("[Renderer] %u PSOs failed to recompile, keeping their previous version", Result.NumFailed);
 
-	// determine cached shader file path
-	const std::string CachedShaderBinaryPath = VQRenderer::ShaderCacheDirectory + "\\" + cacheFileName;
+	mPSOSwapQueue.ReleaseRetired(mpFrameFence->GetCompletedValue(), [](ID3D12PipelineState* pPSO) { pPSO->Release(); });
+	return Result.NumSwapped;
+}
+
+FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc& ShaderStageCompileDesc)
+{
+	using namespace ShaderUtils;
+
+	// content addressed cache: the key changes w/ the contents of the source & its includes, macros, compiler, etc.
+	const uint64 ShaderKey = mShaderCache.GetShaderKey(ShaderStageCompileDesc);
+	const std::string CachedShaderBinaryPath = mShaderCache.GetShaderBinaryPath(ShaderStageCompileDesc, ShaderKey);
 
 	// decide whether to use shader cache or compile from source
-	const bool bUseCachedShaders = DirectoryUtil::FileExists(CachedShaderBinaryPath)
-		&& !ShaderUtils::IsCacheDirty(ShaderSourcePath, CachedShaderBinaryPath);
+	const bool bUseCachedShaders = mShaderCache.HasShaderBinary(ShaderKey);
 
 	// load the shader d3dblob
 	FShaderStageCompileResult Result = {};
@@ -980,6 +1228,7 @@ FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc&
 		if (bCompileSuccessful)
 		{
 			CacheShaderBinary(CachedShaderBinaryPath, ShaderBlob.GetByteCodeSize(), ShaderBlob.GetByteCode());
+			mShaderCache.AddShaderBinary(ShaderKey, CachedShaderBinaryPath);
 		}
 		else
 		{
@@ -989,6 +1238,10 @@ FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc&
 		}
 	}
 
+	if (!ShaderBlob.IsNull() && mMemoryHooks.fnTrackShaderBlob)
+	{
+		ShaderBlob.pMemoryTracking = mMemoryHooks.fnTrackShaderBlob(ShaderBlob.GetByteCodeSize());
+	}
 	return Result;
 }
 
@@ -1078,6 +1331,7 @@ ID3D12Resource* VQRenderer::GetTextureResource(TextureID Id)
 
 DXGI_FORMAT VQRenderer::GetTextureFormat(TextureID Id) const
 {
+	std::lock_guard<std::mutex> lk(mMtxTextures);
 	CHECK_TEXTURE(mTextures, Id);
 	return mTextures.at(Id).GetFormat();
 }
@@ -1107,14 +1361,20 @@ uint VQRenderer::GetTextureSampleCount(TextureID Id) const
 	return 0; // TODO:
 }
 
+FTextureResidencyHandle VQRenderer::GetTextureResidencyHandle(TextureID Id) const
+{
+	std::lock_guard<std::mutex> lk(mMtxTextures);
+	CHECK_TEXTURE(mTextures, Id);
+	return FTextureResidencyHandle::Create(Id, mTextures.at(Id).mpResidency);
+}
+
 void VQRenderer::QueueTextureUpload(const FTextureUploadDesc& desc)
 {
-	std::unique_lock<std::mutex> lk(mMtxTextureUploadQueue);
-	mTextureUploadQueue.push(desc);
+	mTextureUploadQueue.Enqueue(FTextureUploadDesc(desc));
 }
 
 
-void VQRenderer::ProcessTextureUpload(const FTextureUploadDesc& desc)
+bool VQRenderer::ProcessTextureUpload(const FTextureUploadDesc& desc)
 {
 	ID3D12GraphicsCommandList* pCmd = mHeapUpload.GetCommandList();
 	ID3D12Device* pDevice = mDevice.GetDevicePtr();
@@ -1124,62 +1384,109 @@ void VQRenderer::ProcessTextureUpload(const FTextureUploadDesc& desc)
 	const void* pData = desc.img.pData ? desc.img.pData : desc.pData;
 	assert(pData);
 
-	const int szArray = 1; // array size (not impl for now)
-	const uint MIP_COUNT = desc.desc.bGenerateMips ? desc.img.CalculateMipLevelCount() : 1;
+	const uint szArray = desc.pCookedTexture ? desc.pCookedTexture->ArraySize : 1; // only the cooked textures come w/ array slices (cubemaps)
+	const uint MIP_COUNT = desc.pCookedTexture ? desc.pCookedTexture->MipCount 
+		: (desc.desc.bGenerateMips ? desc.img.CalculateMipLevelCount() : 1);
 	const UINT bytePP = static_cast<UINT>(VQ_DXGI_UTILS::GetPixelByteSize(desc.desc.d3d12Desc.Format));
 
+	constexpr UINT MAX_SUBRESOURCES = D3D12_REQ_MIP_LEVELS * 6; // cubemap w/ a full mip chain
+	const UINT NUM_SUBRESOURCES = szArray * MIP_COUNT;
+	assert(NUM_SUBRESOURCES <= MAX_SUBRESOURCES);
 
 	UINT64 UplHeapSize;
-	uint32_t num_rows[D3D12_REQ_MIP_LEVELS] = { 0 };
-	UINT64 row_size_in_bytes[D3D12_REQ_MIP_LEVELS] = { 0 };
-	D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedTex2D[D3D12_REQ_MIP_LEVELS];
+	uint32_t num_rows[MAX_SUBRESOURCES] = { 0 };
+	UINT64 row_size_in_bytes[MAX_SUBRESOURCES] = { 0 };
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedTex2D[MAX_SUBRESOURCES];
 	D3D12_RESOURCE_DESC d3dDesc = {};
 
-	pDevice->GetCopyableFootprints(&desc.desc.d3d12Desc, 0, MIP_COUNT, 0, placedTex2D, num_rows, row_size_in_bytes, &UplHeapSize);
+	pDevice->GetCopyableFootprints(&desc.desc.d3d12Desc, 0, NUM_SUBRESOURCES, 0, placedTex2D, num_rows, row_size_in_bytes, &UplHeapSize);
 
+	// Suballocate() submits the pending copies and waits on the oldest batch in flight if the ring is full
 	UINT8* pUploadBufferMem = mHeapUpload.Suballocate(SIZE_T(UplHeapSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 	if (pUploadBufferMem == NULL)
 	{
-		mHeapUpload.UploadToGPUAndWait(); // We ran out of mem in the upload heap, upload contents and try allocating again
-		pUploadBufferMem = mHeapUpload.Suballocate(SIZE_T(UplHeapSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		Log::Error("Texture upload doesn't fit in the upload heap: TexID=%d (%llu bytes)", desc.id, UplHeapSize);
 		assert(pUploadBufferMem);
+		return false;
 	}
 
-	const uint32 imgSizeInBytes = bytePP * placedTex2D[0].Footprint.Width * placedTex2D[0].Footprint.Height;
-
-	//---------------------------------------------------------------------------------------------
-	// Note: the img copy is used here to enable writing MIP levels on top of the available memory.
-	//       This will slow things down, ideally we should be able to use the img in the @desc,
-	//       but const correctness has to be revisited.
-	Image imgCopy = Image::CreateEmptyImage(imgSizeInBytes);
-	memcpy(imgCopy.pData, pData, imgSizeInBytes);
-	//---------------------------------------------------------------------------------------------
-
-	for (int a = 0; a < szArray; ++a)
+	// cooked textures: the mip chain is already in the final format, copy the rows (of blocks) of each mip
+	if (desc.pCookedTexture)
 	{
-		for (uint mip = 0; mip < MIP_COUNT; ++mip)
+		const FCookedTexture& cooked = *desc.pCookedTexture;
+		assert(cooked.MipCount == desc.desc.d3d12Desc.MipLevels);
+		assert(cooked.ArraySize == desc.desc.d3d12Desc.DepthOrArraySize);
+		for (uint a = 0; a < szArray; ++a)
+		for (uint mip = 0; mip < cooked.MipCount; ++mip)
 		{
-			VQ_DXGI_UTILS::CopyPixels(imgCopy.pData
-				, pUploadBufferMem + placedTex2D[mip].Offset
-				, placedTex2D[mip].Footprint.RowPitch
-				, placedTex2D[mip].Footprint.Width * bytePP
-				, num_rows[mip]
+			const uint iSubresource = a * cooked.MipCount + mip;
+			VQ_DXGI_UTILS::CopyPixels((void*)cooked.GetMipData(mip, a)
+				, pUploadBufferMem + placedTex2D[iSubresource].Offset
+				, placedTex2D[iSubresource].Footprint.RowPitch
+				, static_cast<uint32_t>(row_size_in_bytes[iSubresource])
+				, num_rows[iSubresource]
 			);
 
-			if (MIP_COUNT > 1)
-			{
-				VQ_DXGI_UTILS::MipImage(imgCopy.pData, placedTex2D[mip].Footprint.Width, num_rows[mip], bytePP);
-			}
-
-			D3D12_PLACED_SUBRESOURCE_FOOTPRINT slice = placedTex2D[mip];
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT slice = placedTex2D[iSubresource];
 			slice.Offset += (pUploadBufferMem - mHeapUpload.BasePtr());
 
-			CD3DX12_TEXTURE_COPY_LOCATION Dst(pResc, a * MIP_COUNT + mip);
+			CD3DX12_TEXTURE_COPY_LOCATION Dst(pResc, iSubresource);
 			CD3DX12_TEXTURE_COPY_LOCATION Src(mHeapUpload.GetResource(), slice);
 			pCmd->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
 		}
 	}
-	imgCopy.Destroy();
+	else
+	{
+		const uint32 imgSizeInBytes = bytePP * placedTex2D[0].Footprint.Width * placedTex2D[0].Footprint.Height;
+		const ImageProcessing::EFilter MipFilter = bytePP == 16 ? ImageProcessing::EFilter::MIN : ImageProcessing::EFilter::BOX; // keep the HDR sun from bleeding into the lower mips
+
+		//---------------------------------------------------------------------------------------------
+		// Note: the mips are generated by ping-ponging between two scratch images, the 2nd one is only
+		//       as large as mip1. The rows of each mip are distributed to the shader workers which are
+		//       mostly idle after the load, this thread processes the rows as well.
+		const uint32 imgMipScratchSizeInBytes = MIP_COUNT > 1 ? std::max(bytePP, imgSizeInBytes / 4) : bytePP;
+		Image imgCopy = Image::CreateEmptyImage(imgSizeInBytes);
+		Image imgMipScratch = Image::CreateEmptyImage(imgMipScratchSizeInBytes);
+		OnImageAlloc(imgSizeInBytes);
+		OnImageAlloc(imgMipScratchSizeInBytes);
+		memcpy(imgCopy.pData, pData, imgSizeInBytes);
+		//---------------------------------------------------------------------------------------------
+
+		assert(szArray == 1);
+		for (uint a = 0; a < szArray; ++a)
+		{
+			void* pMipScratch[2] = { imgCopy.pData, imgMipScratch.pData };
+			for (uint mip = 0; mip < MIP_COUNT; ++mip)
+			{
+				void* pMipData = pMipScratch[mip % 2];
+				VQ_DXGI_UTILS::CopyPixels(pMipData
+					, pUploadBufferMem + placedTex2D[mip].Offset
+					, placedTex2D[mip].Footprint.RowPitch
+					, placedTex2D[mip].Footprint.Width * bytePP
+					, num_rows[mip]
+				);
+
+				if (mip + 1 < MIP_COUNT)
+				{
+					const ImageProcessing::EPixelFormat PixelFormat = ImageProcessing::GetPixelFormat(bytePP);
+					const ImageProcessing::FImageView Src(pMipData, placedTex2D[mip].Footprint.Width, num_rows[mip], PixelFormat);
+					const ImageProcessing::FImageView Dst(pMipScratch[(mip + 1) % 2], placedTex2D[mip + 1].Footprint.Width, num_rows[mip + 1], PixelFormat);
+					ImageProcessing::Downsample2x2(Src, Dst, MipFilter, &mWorkers_ShaderLoad);
+				}
+
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT slice = placedTex2D[mip];
+				slice.Offset += (pUploadBufferMem - mHeapUpload.BasePtr());
+
+				CD3DX12_TEXTURE_COPY_LOCATION Dst(pResc, a * MIP_COUNT + mip);
+				CD3DX12_TEXTURE_COPY_LOCATION Src(mHeapUpload.GetResource(), slice);
+				pCmd->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
+			}
+		}
+		imgCopy.Destroy();
+		imgMipScratch.Destroy();
+		OnImageFree(imgSizeInBytes);
+		OnImageFree(imgMipScratchSizeInBytes);
+	}
 
 	D3D12_RESOURCE_BARRIER textureBarrier = {};
 	textureBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -1188,56 +1495,52 @@ void VQRenderer::ProcessTextureUpload(const FTextureUploadDesc& desc)
 	textureBarrier.Transition.StateAfter = desc.desc.ResourceState;
 	textureBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
 	pCmd->ResourceBarrier(1, &textureBarrier);
+	return true;
 }
 
-void VQRenderer::ProcessTextureUploadQueue()
+bool VQRenderer::RecordTextureUpload(FTextureUploadDesc& desc)
 {
-	std::unique_lock<std::mutex> lk(mMtxTextureUploadQueue);
-	if (mTextureUploadQueue.empty())
-		return;
-
-	std::vector<std::atomic<bool>*> vTexResidentBools;
-	std::vector<Image> vImages;
-
-	while (!mTextureUploadQueue.empty())
+	assert(mTextures.find(desc.id) != mTextures.end());
+	bool bUploaded = false;
 	{
-		FTextureUploadDesc desc = std::move(mTextureUploadQueue.front());
-		mTextureUploadQueue.pop();
-
-		ProcessTextureUpload(desc);
-
-		assert(mTextures.find(desc.id) != mTextures.end());
-		{
-			std::unique_lock<std::mutex> lk(mMtxTextures);
-			Texture& tex = mTextures.at(desc.id);
-			vTexResidentBools.push_back(&tex.mbResident);
-		}
-
-		if (desc.img.pData)
-		{
-			vImages.push_back(std::move(desc.img));
-		}
+		std::lock_guard<std::mutex> lk(mMtxUploadHeap);
+		bUploaded = ProcessTextureUpload(desc);
 	}
+	DiscardTextureUpload(desc); // pixels are in the upload heap now, free the image memory
+	return bUploaded;
+}
+
+uint64 VQRenderer::SubmitTextureUploads()
+{
+	std::lock_guard<std::mutex> lk(mMtxUploadHeap);
+	return mHeapUpload.UploadToGPU();
+}
 
-	mHeapUpload.UploadToGPUAndWait();
+bool VQRenderer::IsTextureUploadBatchComplete(uint64 FenceValue)
+{
+	return mHeapUpload.IsBatchComplete(FenceValue);
+}
 
-	for (std::atomic<bool>* pbResident : vTexResidentBools)
-		pbResident->store(true);
+void VQRenderer::WaitForTextureUploadBatch(uint64 FenceValue)
+{
+	std::lock_guard<std::mutex> lk(mMtxUploadHeap);
+	mHeapUpload.WaitForBatch(FenceValue);
+}
 
-	for (Image& img : vImages)
-		img.Destroy(); // free the image memory
+void VQRenderer::OnTextureResident(TextureID id)
+{
+	std::unique_lock<std::mutex> lk(mMtxTextures);
+	auto it = mTextures.find(id);
+	if (it != mTextures.end())
+		it->second.mbResident.store(true);
 }
 
-void VQRenderer::TextureUploadThread_Main()
+void VQRenderer::DiscardTextureUpload(FTextureUploadDesc& desc)
 {
-	while (!mbExitUploadThread)
+	if (desc.img.pData)
 	{
-		mSignal_UploadThreadWorkReady.Wait([&]() { return mbExitUploadThread.load() || !mTextureUploadQueue.empty(); });
-		
-		if (mbExitUploadThread)
-			break;
-
-		this->ProcessTextureUploadQueue();
+		OnImageFree(GetImageSizeInBytes(desc.img));
+		desc.img.Destroy();
 	}
 }
 
@@ -1257,8 +1560,13 @@ void VQRenderer::DestroyTexture(TextureID& texID)
 {
 	// Remove texID
 	std::lock_guard<std::mutex> lk(mMtxTextures);
-	mTextures.at(texID).Destroy();
+	
+	// the frames in flight might still be using the texture: release its memory once they're done on the GPU.
+	// The fence is read after the erase: a frame that looked the texture up before is either submitted already
+	// or the one being recorded, a frame recorded later can't find it.
+	Texture tex = mTextures.at(texID); // shallow copy, the map entry doesn't release the resource when erased
 	mTextures.erase(texID);
+	mDeferredDeletions.Enqueue(mFrameFences.GetRecordingFrameFence(), [tex]() mutable { tex.Destroy(); });
 
 	// Remove texture path from cache
 	std::string texPath = "";
@@ -1280,16 +1588,74 @@ void VQRenderer::DestroyTexture(TextureID& texID)
 void VQRenderer::DestroySRV(SRV_ID& srvID)
 {
 	std::lock_guard<std::mutex> lk(mMtxSRVs_CBVs_UAVs);
-	//mSRVs.at(srvID).Destroy(); // TODO
-	mSRVs.erase(srvID);
+	auto it = mSRVs.find(srvID);
+	if (it != mSRVs.end())
+	{
+		mHeapCBV_SRV_UAV.FreeDescriptor(it->second);
+		mSRVs.erase(it);
+	}
 	//Log::Info("Erase SRV_ID=%d", srvID); // todo: verbose logging preprocessor ifdef
 	srvID = INVALID_ID;
 }
 void VQRenderer::DestroyDSV(DSV_ID& dsvID)
 {
 	std::lock_guard<std::mutex> lk(mMtxDSVs);
-	//mDSVs.at(dsvID).Destroy(); // TODO
-	mDSVs.erase(dsvID);
+	auto it = mDSVs.find(dsvID);
+	if (it != mDSVs.end())
+	{
+		mHeapDSV.FreeDescriptor(it->second);
+		mDSVs.erase(it);
+	}
 	dsvID = INVALID_ID;
 }
+void VQRenderer::DestroyRTV(RTV_ID& rtvID)
+{
+	std::lock_guard<std::mutex> lk(mMtxRTVs);
+	auto it = mRTVs.find(rtvID);
+	if (it != mRTVs.end())
+	{
+		mHeapRTV.FreeDescriptor(it->second);
+		mRTVs.erase(it);
+	}
+	rtvID = INVALID_ID;
+}
+void VQRenderer::DestroyUAV(UAV_ID& uavID)
+{
+	std::lock_guard<std::mutex> lk(mMtxSRVs_CBVs_UAVs);
+	auto it = mUAVs.find(uavID);
+	if (it != mUAVs.end())
+	{
+		mHeapCBV_SRV_UAV.FreeDescriptor(it->second);
+		mUAVs.erase(it);
+	}
+	uavID = INVALID_ID;
+}
+
+void VQRenderer::ProcessDeferredReleases()
+{
+	constexpr float DEFERRED_RELEASE_TIME_BUDGET_MS = 0.5f; // the rest of the releases carry over to the next frame
+
+	const uint64 CompletedFrameFence = mpFrameFence->GetCompletedValue();
+	mHeapCBV_SRV_UAV.ReleaseCompletedFrees(CompletedFrameFence);
+	mHeapDSV.ReleaseCompletedFrees(CompletedFrameFence);
+	mHeapRTV.ReleaseCompletedFrees(CompletedFrameFence);
+	mDeferredDeletions.Process(CompletedFrameFence, DEFERRED_RELEASE_TIME_BUDGET_MS);
+}
+
+void VQRenderer::SignalFrameSubmitted(ID3D12CommandQueue* pQueue)
+{
+	ThrowIfFailed(pQueue->Signal(mpFrameFence, mFrameFences.OnFrameSubmitted()));
+}
+
+FDescriptorAllocatorStats VQRenderer::GetDescriptorHeapStats(EResourceHeapType HeapType) const
+{
+	switch (HeapType)
+	{
+	case RTV_HEAP:          return mHeapRTV.GetStats();
+	case DSV_HEAP:          return mHeapDSV.GetStats();
+	case CBV_SRV_UAV_HEAP:  return mHeapCBV_SRV_UAV.GetStats();
+	default: break;
+	}
+	return FDescriptorAllocatorStats{};
+}
 
@@ -50,11 +50,14 @@
 // StaticResourceViewHeap
 //
 //--------------------------------------------------------------------------------------
-void StaticResourceViewHeap::Create(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32 descriptorCount, bool forceCPUVisible)
+void StaticResourceViewHeap::Create(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32 descriptorCount, const FrameFenceTracker* pFrameFences, bool forceCPUVisible)
 {
     mDescriptorCount = descriptorCount;
-    mIndex = 0;
-        
+
+    // the texture loading workers allocate the SRVs concurrently, RTVs & DSVs are allocated by the main/render threads
+    const uint32 ThreadCacheSize = heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ? 16 : 0;
+    mAllocator.Initialize(descriptorCount, ThreadCacheSize, pFrameFences);
+
     mDescriptorElementSize = pDevice->GetDescriptorHandleIncrementSize(heapType);
 
     D3D12_DESCRIPTOR_HEAP_DESC descHeap;
@@ -81,29 +84,231 @@ void StaticResourceViewHeap::Destroy()
 
 bool StaticResourceViewHeap::AllocDescriptor(uint32 size, ResourceView* pRV)
 {
-    if ((mIndex + size) > mDescriptorCount)
+    const uint32 Index = mAllocator.Allocate(size);
+    if (Index == DescriptorAllocator::INVALID_OFFSET)
     {
+        const FDescriptorAllocatorStats Stats = mAllocator.GetStats();
+        Log::Error("StaticResourceViewHeap: cannot allocate %u descriptors: %u/%u allocated, %u pending free, largest free range=%u (fragmentation=%.2f)"
+            , size, Stats.NumAllocated, Stats.NumDescriptors, Stats.NumPendingFree, Stats.LargestFreeRange, Stats.Fragmentation);
         assert(!"StaticResourceViewHeapDX12 heap ran of memory, increase its size");
         return false;
     }
 
     D3D12_CPU_DESCRIPTOR_HANDLE CPUView = mpHeap->GetCPUDescriptorHandleForHeapStart();
-    CPUView.ptr += mIndex * mDescriptorElementSize;
+    CPUView.ptr += static_cast<SIZE_T>(Index) * mDescriptorElementSize;
 
     D3D12_GPU_DESCRIPTOR_HANDLE GPUView = mpHeap->GetGPUDescriptorHandleForHeapStart();
-    GPUView.ptr += mIndex * mDescriptorElementSize;
-
-    mIndex += size;
+    GPUView.ptr += static_cast<UINT64>(Index) * mDescriptorElementSize;
 
     pRV->SetResourceView(size, mDescriptorElementSize, CPUView, GPUView);
 
     return true;
 }
 
+void StaticResourceViewHeap::FreeDescriptor(const ResourceView& rv)
+{
+    if (rv.GetSize() == 0) // not allocated
+        return;
+
+    const SIZE_T HeapStart = mpHeap->GetCPUDescriptorHandleForHeapStart().ptr;
+    const SIZE_T CPUView = rv.GetCPUDescHandle().ptr;
+    assert(CPUView >= HeapStart && (CPUView - HeapStart) % mDescriptorElementSize == 0);
+    
+    const uint32 Index = static_cast<uint32>((CPUView - HeapStart) / mDescriptorElementSize);
+    assert(Index + rv.GetSize() <= mDescriptorCount);
+    mAllocator.Free(Index, rv.GetSize());
+}
+
 
 // ===========================================================================================================================================
 
 
+//--------------------------------------------------------------------------------------
+//
+// UploadFence
+//
+//--------------------------------------------------------------------------------------
+void UploadFence_D3D12::Create(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue)
+{
+    mpQueue = pQueue;
+    HRESULT hr = pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mpFence));
+    if (FAILED(hr))
+    {
+        Log::Error("Couldn't create upload fence.");
+        return;
+    }
+    mpFence->SetName(L"UploadHeap::mFence");
+    mHEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    mLastSignaledValue = 0;
+}
+
+void UploadFence_D3D12::Destroy()
+{
+    if (mpFence) mpFence->Release();
+    if (mHEvent) CloseHandle(mHEvent);
+    mpFence = nullptr;
+    mHEvent = nullptr;
+}
+
+UINT64 UploadFence_D3D12::Signal()
+{
+    ++mLastSignaledValue;
+    mpQueue->Signal(mpFence, mLastSignaledValue);
+    return mLastSignaledValue;
+}
+
+UINT64 UploadFence_D3D12::GetCompletedValue() const
+{
+    return mpFence->GetCompletedValue();
+}
+
+void UploadFence_D3D12::WaitForValue(UINT64 Value)
+{
+    if (mpFence->GetCompletedValue() < Value)
+    {
+        mpFence->SetEventOnCompletion(Value, mHEvent);
+        WaitForSingleObject(mHEvent, INFINITE);
+    }
+}
+
+UINT64 UploadFence_CPU::Signal()
+{
+    ++mLastSignaledValue;
+    if (mLastSignaledValue > mLatencyInBatches)
+    {
+        const UINT64 CompletedValue = mLastSignaledValue - mLatencyInBatches;
+        if (mCompletedValue < CompletedValue)
+            mCompletedValue = CompletedValue;
+    }
+    return mLastSignaledValue;
+}
+
+
+//--------------------------------------------------------------------------------------
+//
+// UploadRingAllocator
+//
+//--------------------------------------------------------------------------------------
+void UploadRingAllocator::Initialize(SIZE_T Size, uint32 MaxInFlightBatches, IUploadFence* pFence)
+{
+    assert(pFence);
+    assert(MaxInFlightBatches > 0);
+    mpFence = pFence;
+    mSize = Size;
+    mMaxInFlightBatches = MaxInFlightBatches;
+    mHead = mTail = 0;
+    mUsedSize = 0;
+    mCurrentBatchSize = 0;
+    mInFlightBatches.clear();
+}
+
+bool UploadRingAllocator::Allocate(SIZE_T Size, SIZE_T Align, SIZE_T& OutOffset)
+{
+    if (Size > mSize)
+        return false;
+
+    // nothing in use: start from the beginning to reduce wrap-around padding.
+    // Only when no batch is in flight, the tail still moves to the end offsets of those when they retire.
+    if (mUsedSize == 0 && mInFlightBatches.empty())
+    {
+        mHead = mTail = 0;
+    }
+    else if (mHead == mTail) // ring is full
+    {
+        return false;
+    }
+
+    SIZE_T Offset = AlignOffset(mHead, Align);
+    bool bWrapAround = false;
+    if (mHead >= mTail) // free ranges: [mHead, mSize) & [0, mTail)
+    {
+        if (Offset + Size > mSize)
+        {
+            if (Size > mTail)
+                return false;
+            Offset = 0;
+            bWrapAround = true;
+        }
+    }
+    else // free range: [mHead, mTail)
+    {
+        if (Offset + Size > mTail)
+            return false;
+    }
+
+    const SIZE_T NewHead = Offset + Size;
+    const SIZE_T AllocationSize = bWrapAround
+        ? (mSize - mHead) + NewHead // the remainder of the ring becomes padding
+        : NewHead - mHead;
+
+    mUsedSize += AllocationSize;
+    mCurrentBatchSize += AllocationSize;
+    mHead = NewHead;
+
+    OutOffset = Offset;
+    return true;
+}
+
+UINT64 UploadRingAllocator::SubmitBatch()
+{
+    // an empty batch doesn't hold any ring memory: signal the fence for the submitted
+    // commands that don't use the ring (e.g. buffer copies) but don't track the batch.
+    if (mCurrentBatchSize == 0)
+    {
+        mLastSubmittedFenceValue = mpFence->Signal();
+        return mLastSubmittedFenceValue;
+    }
+
+    // bound the number of batches in flight
+    while (mInFlightBatches.size() >= mMaxInFlightBatches)
+    {
+        WaitForOldestBatch();
+    }
+
+    FBatch batch;
+    batch.FenceValue = mpFence->Signal();
+    batch.EndOffset = mHead;
+    batch.Size = mCurrentBatchSize;
+    mInFlightBatches.push_back(batch);
+
+    mCurrentBatchSize = 0;
+    mLastSubmittedFenceValue = batch.FenceValue;
+    return batch.FenceValue;
+}
+
+void UploadRingAllocator::RetireCompletedBatches()
+{
+    const UINT64 CompletedValue = mpFence->GetCompletedValue();
+    while (!mInFlightBatches.empty() && mInFlightBatches.front().FenceValue <= CompletedValue)
+    {
+        const FBatch& batch = mInFlightBatches.front();
+        assert(mUsedSize >= batch.Size);
+        mTail = batch.EndOffset;
+        mUsedSize -= batch.Size;
+        mInFlightBatches.pop_front();
+    }
+}
+
+bool UploadRingAllocator::WaitForOldestBatch()
+{
+    if (mInFlightBatches.empty())
+        return false;
+
+    mpFence->WaitForValue(mInFlightBatches.front().FenceValue);
+    RetireCompletedBatches();
+    return true;
+}
+
+void UploadRingAllocator::WaitForAllBatches()
+{
+    if (mInFlightBatches.empty())
+        return;
+
+    mpFence->WaitForValue(mInFlightBatches.back().FenceValue);
+    RetireCompletedBatches();
+}
+
+
 //--------------------------------------------------------------------------------------
 //
 // UploadHeap
@@ -115,10 +320,14 @@ void UploadHeap::Create(ID3D12Device* pDevice, SIZE_T uSize, ID3D12CommandQueue*
     mpQueue = pQueue;
 
     // Create command list and allocators 
-
-    pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&mpCommandAllocator));
-    mpCommandAllocator->SetName(L"UploadHeap::mpCommandAllocator");
-    pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, mpCommandAllocator, nullptr, IID_PPV_ARGS(&mpCommandList));
+    for (uint32 i = 0; i < NUM_IN_FLIGHT_BATCHES; ++i)
+    {
+        pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&mpCommandAllocators[i]));
+        mpCommandAllocators[i]->SetName(L"UploadHeap::mpCommandAllocators[]");
+        mCommandAllocatorFenceValues[i] = 0;
+    }
+    mCurrentCommandAllocator = 0;
+    pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, mpCommandAllocators[0], nullptr, IID_PPV_ARGS(&mpCommandList));
     mpCommandList->SetName(L"UploadHeap::mpCommandList");
 
     // Create buffer to suballocate
@@ -144,41 +353,52 @@ void UploadHeap::Create(ID3D12Device* pDevice, SIZE_T uSize, ID3D12CommandQueue*
         return;
     }
 
-    mpDataCur = mpDataBegin;
     mpDataEnd = mpDataBegin + mpUploadHeap->GetDesc().Width;
 
-    hr = pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mpFence));
-    mHEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    mFenceValue = 1;
+    mFence.Create(pDevice, pQueue);
+    mRing.Initialize(static_cast<SIZE_T>(mpUploadHeap->GetDesc().Width), NUM_IN_FLIGHT_BATCHES, &mFence);
 }
 
 void UploadHeap::Destroy()
 {
     mpUploadHeap->Release();
 
-    if (mpFence) mpFence->Release();
+    mFence.Destroy();
 
     mpCommandList->Release();
-    mpCommandAllocator->Release();
+    for (ID3D12CommandAllocator* pAllocator : mpCommandAllocators)
+        if (pAllocator) pAllocator->Release();
 }
 
 
 UINT8* UploadHeap::Suballocate(SIZE_T uSize, UINT64 uAlign)
 {
-    mpDataCur = reinterpret_cast<UINT8*>(AlignOffset(reinterpret_cast<SIZE_T>(mpDataCur), SIZE_T(uAlign)));
-
-    // return NULL if we ran out of space in the heap
-    if (mpDataCur >= mpDataEnd || mpDataCur + uSize >= mpDataEnd)
+    if (uSize > mRing.GetSize())
     {
+        Log::Error("UploadHeap::Suballocate(): requested size (%llu) is larger than the heap (%llu)", uSize, mRing.GetSize());
         return NULL;
     }
 
-    UINT8* pRet = mpDataCur;
-    mpDataCur += uSize;
-    return pRet;
+    SIZE_T Offset = 0;
+    while (!mRing.Allocate(uSize, SIZE_T(uAlign), Offset))
+    {
+        // We ran out of space in the ring: flush the commands recorded so far
+        // and reclaim the memory of the oldest batch once the GPU is done with it.
+        if (!mRing.IsCurrentBatchEmpty())
+        {
+            UploadToGPU();
+        }
+        else if (!mRing.WaitForOldestBatch())
+        {
+            assert(false); // shouldn't happen: an empty ring should be able to fit uSize
+            return NULL;
+        }
+    }
+
+    return mpDataBegin + Offset;
 }
 
-void UploadHeap::UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue /* =nullptr */)
+UINT64 UploadHeap::UploadToGPU(ID3D12CommandQueue* pCmdQueue /* =nullptr */)
 {
     if (!pCmdQueue)
     {
@@ -187,18 +407,29 @@ void UploadHeap::UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue /* =nullptr */
 
     mpCommandList->Close();
     pCmdQueue->ExecuteCommandLists(1, CommandListCast(&mpCommandList));
-    pCmdQueue->Signal(mpFence, mFenceValue);
-    if (mpFence->GetCompletedValue() < mFenceValue)
-    {
-        mpFence->SetEventOnCompletion(mFenceValue, mHEvent);
-        WaitForSingleObject(mHEvent, INFINITE);
-    }
+    mFence.SetQueue(pCmdQueue);
+    const UINT64 FenceValue = mRing.SubmitBatch();
+    mCommandAllocatorFenceValues[mCurrentCommandAllocator] = FenceValue;
+
+    // Move on to the next command allocator so we can keep recording while the GPU is 
+    // executing this batch. The allocator can only be reset once its last batch is done.
+    mCurrentCommandAllocator = (mCurrentCommandAllocator + 1) % NUM_IN_FLIGHT_BATCHES;
+    mFence.WaitForValue(mCommandAllocatorFenceValues[mCurrentCommandAllocator]);
+    mRing.RetireCompletedBatches();
 
-    ++mFenceValue;
+    mpCommandAllocators[mCurrentCommandAllocator]->Reset();
+    mpCommandList->Reset(mpCommandAllocators[mCurrentCommandAllocator], nullptr);
 
-    // Reset so it can be reused
-    mpCommandAllocator->Reset();
-    mpCommandList->Reset(mpCommandAllocator, nullptr);
+    return FenceValue;
+}
 
-    mpDataCur = mpDataBegin;
-}
\ No newline at end of file
+void UploadHeap::UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue /* =nullptr */)
+{
+    WaitForBatch(UploadToGPU(pCmdQueue));
+}
+
+void UploadHeap::WaitForBatch(UINT64 FenceValue)
+{
+    mFence.WaitForValue(FenceValue);
+    mRing.RetireCompletedBatches();
+}
@@ -40,9 +40,13 @@
 #pragma once
 
 #include "Common.h"
+#include "DescriptorAllocator.h"
 
 #include <d3d12.h>
 
+#include <deque>
+#include <array>
+
 class ResourceView;
 
 enum EResourceHeapType
@@ -58,35 +62,138 @@ enum EResourceHeapType
 class StaticResourceViewHeap
 {
 public:
-    void Create(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32 descriptorCount, bool forceCPUVisible = false);
+    void Create(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32 descriptorCount, const FrameFenceTracker* pFrameFences, bool forceCPUVisible = false);
     void Destroy();
     bool AllocDescriptor(uint32 size, ResourceView* pRV);
-    
+    void FreeDescriptor(const ResourceView& rv); // the descriptors are recycled once the frame being recorded is done on the GPU
+
+    // CompletedFrameFence=0 if no frame is completed yet
+    inline void ReleaseCompletedFrees(uint64 CompletedFrameFence) { mAllocator.ReleaseCompletedFrees(CompletedFrameFence); }
+    inline FDescriptorAllocatorStats GetStats() const { return mAllocator.GetStats(); }
 
     inline ID3D12DescriptorHeap* GetHeap() const { return mpHeap; }
 
 private:
-    uint32 mIndex;
+    DescriptorAllocator mAllocator;
     uint32 mDescriptorCount;
     uint32 mDescriptorElementSize;
 
     ID3D12DescriptorHeap *mpHeap;
 };
 
-// Creates one Upload heap and suballocates memory from the heap
+// Tracks the completion of the submitted upload batches. The ring allocator below only talks to
+// this interface so its allocation/retirement logic can be exercised without a GPU (UploadFence_CPU).
+class IUploadFence
+{
+public:
+    virtual ~IUploadFence() {}
+    virtual UINT64 Signal() = 0; // signals the next fence value after the submitted work, returns the value
+    virtual UINT64 GetCompletedValue() const = 0;
+    virtual void   WaitForValue(UINT64 Value) = 0;
+};
+
+class UploadFence_D3D12 : public IUploadFence
+{
+public:
+    void Create(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue);
+    void Destroy();
+
+    UINT64 Signal() override;
+    UINT64 GetCompletedValue() const override;
+    void   WaitForValue(UINT64 Value) override;
+
+    inline void SetQueue(ID3D12CommandQueue* pQueue) { mpQueue = pQueue; }
+
+private:
+    ID3D12CommandQueue* mpQueue = nullptr;
+    ID3D12Fence*        mpFence = nullptr;
+    UINT64              mLastSignaledValue = 0;
+    HANDLE              mHEvent = nullptr;
+};
+
+// CPU fake: the submitted batches complete after a configurable number of Signal() calls
+// or when they're waited on, which is enough to simulate the GPU lagging behind the CPU.
+class UploadFence_CPU : public IUploadFence
+{
+public:
+    UploadFence_CPU(UINT64 LatencyInBatches = 1) : mLatencyInBatches(LatencyInBatches) {}
+
+    UINT64 Signal() override;
+    UINT64 GetCompletedValue() const override { return mCompletedValue; }
+    void   WaitForValue(UINT64 Value) override { if (mCompletedValue < Value) mCompletedValue = Value; }
+
+private:
+    UINT64 mLatencyInBatches = 1;
+    UINT64 mLastSignaledValue = 0;
+    UINT64 mCompletedValue = 0;
+};
+
+// Ring allocator for the staging memory: allocations made between two SubmitBatch() calls form a
+// batch which is tagged with a fence value. The memory of a batch is reclaimed once its fence value
+// completes, so the CPU can keep filling the ring while the GPU is copying the previous batches.
+class UploadRingAllocator
+{
+public:
+    void Initialize(SIZE_T Size, uint32 MaxInFlightBatches, IUploadFence* pFence);
+
+    // Returns false if there's not enough contiguous space in the ring right now.
+    // Callers are expected to SubmitBatch() and/or WaitForOldestBatch() and try again.
+    bool   Allocate(SIZE_T Size, SIZE_T Align, SIZE_T& OutOffset);
+    UINT64 SubmitBatch(); // closes the current batch, returns the fence value tracking it. Empty batches aren't kept in flight.
+    void   RetireCompletedBatches();
+    bool   WaitForOldestBatch(); // returns false if there's no batch in flight
+    void   WaitForAllBatches();
+
+    inline bool   IsCurrentBatchEmpty()    const { return mCurrentBatchSize == 0; }
+    inline size_t GetNumInFlightBatches()  const { return mInFlightBatches.size(); }
+    inline uint32 GetMaxInFlightBatches()  const { return mMaxInFlightBatches; }
+    inline SIZE_T GetSize()                const { return mSize; }
+    inline SIZE_T GetUsedSize()            const { return mUsedSize; }
+    inline UINT64 GetLastSubmittedFenceValue() const { return mLastSubmittedFenceValue; }
+
+private:
+    struct FBatch
+    {
+        UINT64 FenceValue = 0;
+        SIZE_T EndOffset  = 0; // the ring tail moves here when the batch retires
+        SIZE_T Size       = 0; // includes alignment & wrap-around padding
+    };
+    IUploadFence*      mpFence = nullptr;
+    std::deque<FBatch> mInFlightBatches;
+    SIZE_T             mSize = 0;
+    SIZE_T             mHead = 0; // next allocation
+    SIZE_T             mTail = 0; // beginning of the oldest allocation in use
+    SIZE_T             mUsedSize = 0;
+    SIZE_T             mCurrentBatchSize = 0;
+    uint32             mMaxInFlightBatches = 1;
+    UINT64             mLastSubmittedFenceValue = 0;
+};
+
+// Creates one Upload heap and suballocates memory from the heap in a ring fashion.
+// Up to NUM_IN_FLIGHT_BATCHES command lists can be executing on the GPU while the CPU
+// keeps recording copy commands into the next batch.
 class UploadHeap
 {
 public:
+    static constexpr uint32 NUM_IN_FLIGHT_BATCHES = 3;
+
     void Create(ID3D12Device* pDevice, SIZE_T uSize, ID3D12CommandQueue* pQueue);
     void Destroy();
 
+    // Returns NULL only if uSize doesn't fit in the heap. If the ring is full, the current batch
+    // is submitted and the oldest batch in flight is waited on, so the caller shouldn't have
+    // recorded any commands referencing the allocation it's about to make before calling this.
     UINT8* Suballocate(SIZE_T uSize, UINT64 uAlign);
 
     inline UINT8*                     BasePtr()         const { return mpDataBegin; }
     inline ID3D12Resource*            GetResource()     const { return mpUploadHeap; }
     inline ID3D12GraphicsCommandList* GetCommandList()  const { return mpCommandList; }
 
-    void UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue = nullptr);
+    // Submits the recorded copy commands without waiting on them, returns the fence value to wait on.
+    UINT64 UploadToGPU(ID3D12CommandQueue* pCmdQueue = nullptr);
+    void   UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue = nullptr);
+    inline bool IsBatchComplete(UINT64 FenceValue) const { return mFence.GetCompletedValue() >= FenceValue; }
+    void   WaitForBatch(UINT64 FenceValue);
 
 private:
     ID3D12Device*              mpDevice     = nullptr;
@@ -94,13 +201,13 @@ private:
     ID3D12CommandQueue*        mpQueue      = nullptr;
 
     ID3D12GraphicsCommandList* mpCommandList      = nullptr;
-    ID3D12CommandAllocator*    mpCommandAllocator = nullptr;
+    std::array<ID3D12CommandAllocator*, NUM_IN_FLIGHT_BATCHES> mpCommandAllocators = {};
+    std::array<UINT64                 , NUM_IN_FLIGHT_BATCHES> mCommandAllocatorFenceValues = {};
+    uint32                     mCurrentCommandAllocator = 0;
 
-    UINT8*                     mpDataCur   = nullptr;
     UINT8*                     mpDataEnd   = nullptr; 
     UINT8*                     mpDataBegin = nullptr;
 
-    ID3D12Fence*               mpFence = nullptr;
-    UINT64                     mFenceValue = 0;
-    HANDLE                     mHEvent;
+    UploadFence_D3D12          mFence;
+    UploadRingAllocator        mRing;
 };
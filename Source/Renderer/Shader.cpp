@@ -97,53 +97,6 @@ std::string GetIncludeFileName(const std::string& line)
 	return std::string();
 }
 
-bool AreIncludesDirty(const std::string& srcPath, const std::string& cachePath)
-{
-	const std::string ShaderSourceDir = DirectoryUtil::GetFolderPath(srcPath);
-	const std::string ShaderCacheDir = DirectoryUtil::GetFolderPath(cachePath);
-
-	std::stack<std::string> includeStack;
-	includeStack.push(srcPath);
-	while (!includeStack.empty())
-	{
-		const std::string includeFilePath = includeStack.top();
-		includeStack.pop();
-		std::ifstream src = std::ifstream(includeFilePath.c_str());
-		if (!src.good())
-		{
-			Log::Error("[ShaderCompile] %s : Cannot open include file '%s'", srcPath.c_str(),  includeFilePath.c_str());
-			continue;
-		}
-
-		std::string line;
-		while (getline(src, line))
-		{
-			if (line.size() >= 2 && line[0] == line[1] && line[1] == '/') // skip comment lines
-				continue;
-
-			const std::string includeFileName = GetIncludeFileName(line);
-			if (includeFileName.empty()) continue;
-
-			const std::string includeSourcePath = ShaderSourceDir + includeFileName;
-			const std::string includeCachePath = ShaderCacheDir + includeFileName;
-
-			if (DirectoryUtil::IsFileNewer(includeSourcePath, cachePath))
-				return true;
-			includeStack.push(includeSourcePath);
-		}
-		src.close();
-	}
-	return false;
-}
-
-bool IsCacheDirty(const std::string& sourcePath, const std::string& cachePath)
-{
-	if (!DirectoryUtil::FileExists(cachePath)) 
-		return true;
-
-	return DirectoryUtil::IsFileNewer(sourcePath, cachePath) || AreIncludesDirty(sourcePath, cachePath);
-}
-
 std::vector<D3D12_INPUT_ELEMENT_DESC> ReflectInputLayoutFromVS(ID3D12ShaderReflection* pReflection)
 {
 	D3D12_SHADER_DESC shaderDesc = {};
@@ -413,13 +366,32 @@ void CacheShaderBinary(const std::string& ShaderBinaryFilePath, size_t ShaderBin
 }
 
 
-size_t GeneratePreprocessorDefinitionsHash(const std::vector<FShaderMacro>& macros)
+uint64 GetCompilerVersion(bool bDXC)
+{
+	if (!bDXC)
+		return D3D_COMPILER_VERSION;
+
+	// DXC: the dxcompiler.dll that's loaded, queried once
+	static const uint64 DXC_VERSION = []() -> uint64
+	{
+		CComPtr<IDxcCompiler3>   DXC_compiler3;
+		CComPtr<IDxcVersionInfo> DXC_versionInfo;
+		UINT32 Major = 0, Minor = 0;
+		if (SUCCEEDED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&DXC_compiler3)))
+			&& SUCCEEDED(DXC_compiler3->QueryInterface(IID_PPV_ARGS(&DXC_versionInfo)))
+			&& SUCCEEDED(DXC_versionInfo->GetVersion(&Major, &Minor)))
+		{
+			return (static_cast<uint64>(Major) << 32) | Minor;
+		}
+		Log::Warning("Couldn't query the DirectXCompiler version");
+		return 0;
+	}();
+	return DXC_VERSION;
+}
+
+UINT GetShaderCompileFlags()
 {
-	if (macros.empty()) return 0;
-	std::string concatenatedMacros;
-	for (const FShaderMacro& macro : macros)
-		concatenatedMacros += macro.Name + macro.Value;
-	return std::hash<std::string>()(concatenatedMacros);
+	return SHADER_COMPILE_FLAGS;
 }
 
 EShaderStage GetShaderStageEnumFromShaderModel(const std::string& ShaderModel)
@@ -27,6 +27,7 @@
 #include "../../Libs/DirectXCompiler/inc/dxcapi.h"
 
 #include <string>
+#include <memory>
 #include <array>
 #include <tuple>
 #include <vector>
@@ -94,6 +95,7 @@ public:
 
 		CComPtr<ID3DBlob> pD3DBlob = nullptr;
 		CComPtr<IDxcBlob> pBlobDxc = nullptr;
+		std::shared_ptr<void> pMemoryTracking; // FRendererMemoryHooks::fnTrackShaderBlob() handle: counts the bytecode until the last copy of the blob is released
 	};
 	union ShaderBlobs
 	{
@@ -137,14 +139,13 @@ namespace ShaderUtils
 	//
 	void CacheShaderBinary(const std::string& ShaderBinaryFilePath, size_t ShaderBinarySize, const void* pShaderBinary);
 
-	// Concatenates given FShaderMacros and generates a hash from the resulting string
+	// Compiler version & compile flags the shader binaries depend on, part of the ShaderCache keys
 	//
-	size_t GeneratePreprocessorDefinitionsHash(const std::vector<FShaderMacro>& Macros);
+	uint64 GetCompilerVersion(bool bDXC);
+	UINT   GetShaderCompileFlags();
 
 	std::string  GetCompileError(ID3DBlob*& errorMessage, const std::string& shdPath);
 	std::string  GetIncludeFileName(const std::string& line);
-	bool         AreIncludesDirty(const std::string& srcPath, const std::string& cachePath);
-	bool         IsCacheDirty(const std::string& sourcePath, const std::string& cachePath);
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> ReflectInputLayoutFromVS(ID3D12ShaderReflection* pReflection);
 
@@ -0,0 +1,493 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "ShaderCache.h"
+#include "Shader.h"
+
+#include "../../Libs/VQUtils/Source/utils.h"
+#include "../../Libs/VQUtils/Source/Timer.h"
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+constexpr const char* SHADER_CACHE_INDEX_FILE_NAME = "ShaderCache.idx";
+constexpr int         SHADER_CACHE_INDEX_VERSION   = 1; // bump when the key composition or the index format changes
+
+//-------------------------------------------------------------------------------------------------------------
+// xxHash64
+//-------------------------------------------------------------------------------------------------------------
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+static constexpr uint64 XXH_PRIME64_1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64 XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64 XXH_PRIME64_3 = 0x165667B19E3779F9ull;
+static constexpr uint64 XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64 XXH_PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64 XXH_Rotl64(uint64 x, int r) { return (x << r) | (x >> (64 - r)); }
+static inline uint64 XXH_Read64(const uint8* p) { uint64 v; memcpy(&v, p, sizeof(v)); return v; } // little endian
+static inline uint32 XXH_Read32(const uint8* p) { uint32 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline uint64 XXH_Round(uint64 Acc, uint64 Input)
+{
+	Acc += Input * XXH_PRIME64_2;
+	Acc  = XXH_Rotl64(Acc, 31);
+	return Acc * XXH_PRIME64_1;
+}
+static inline uint64 XXH_MergeRound(uint64 Acc, uint64 Val)
+{
+	Acc ^= XXH_Round(0, Val);
+	return Acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64 ShaderCache::Hash(const void* pData, size_t Size, uint64 Seed)
+{
+	const uint8* p    = static_cast<const uint8*>(pData);
+	const uint8* pEnd = p + Size;
+	uint64 h64;
+
+	if (Size >= 32)
+	{
+		uint64 v1 = Seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		uint64 v2 = Seed + XXH_PRIME64_2;
+		uint64 v3 = Seed;
+		uint64 v4 = Seed - XXH_PRIME64_1;
+		const uint8* pLimit = pEnd - 32;
+		do
+		{
+			v1 = XXH_Round(v1, XXH_Read64(p)); p += 8;
+			v2 = XXH_Round(v2, XXH_Read64(p)); p += 8;
+			v3 = XXH_Round(v3, XXH_Read64(p)); p += 8;
+			v4 = XXH_Round(v4, XXH_Read64(p)); p += 8;
+		} while (p <= pLimit);
+
+		h64 = XXH_Rotl64(v1, 1) + XXH_Rotl64(v2, 7) + XXH_Rotl64(v3, 12) + XXH_Rotl64(v4, 18);
+		h64 = XXH_MergeRound(h64, v1);
+		h64 = XXH_MergeRound(h64, v2);
+		h64 = XXH_MergeRound(h64, v3);
+		h64 = XXH_MergeRound(h64, v4);
+	}
+	else
+	{
+		h64 = Seed + XXH_PRIME64_5;
+	}
+
+	h64 += static_cast<uint64>(Size);
+
+	while (p + 8 <= pEnd)
+	{
+		h64 ^= XXH_Round(0, XXH_Read64(p));
+		h64  = XXH_Rotl64(h64, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= pEnd)
+	{
+		h64 ^= static_cast<uint64>(XXH_Read32(p)) * XXH_PRIME64_1;
+		h64  = XXH_Rotl64(h64, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	while (p < pEnd)
+	{
+		h64 ^= (*p) * XXH_PRIME64_5;
+		h64  = XXH_Rotl64(h64, 11) * XXH_PRIME64_1;
+		++p;
+	}
+
+	// avalanche
+	h64 ^= h64 >> 33;
+	h64 *= XXH_PRIME64_2;
+	h64 ^= h64 >> 29;
+	h64 *= XXH_PRIME64_3;
+	h64 ^= h64 >> 32;
+	return h64;
+}
+
+
+//-------------------------------------------------------------------------------------------------------------
+// HELPERS
+//-------------------------------------------------------------------------------------------------------------
+static std::string NormalizePath(const fs::path& FilePath)
+{
+	return FilePath.lexically_normal().generic_string();
+}
+
+static std::string ToHexString(uint64 Value)
+{
+	char HexStr[17];
+	snprintf(HexStr, sizeof(HexStr), "%016llx", static_cast<unsigned long long>(Value));
+	return HexStr;
+}
+
+// appends the bytes of a key component, w/ a separator so that e.g. {"AB", "C"} & {"A", "BC"} differ
+static void AppendKeyData(std::string& Key, const std::string& Data) { Key += Data; Key += '\0'; }
+static void AppendKeyData(std::string& Key, uint64 Data) { Key.append(reinterpret_cast<const char*>(&Data), sizeof(Data)); }
+
+
+//-------------------------------------------------------------------------------------------------------------
+// SHADER CACHE
+//-------------------------------------------------------------------------------------------------------------
+void ShaderCache::Initialize(const std::string& CacheDirectory)
+{
+	Timer t; t.Start();
+	std::lock_guard<std::mutex> lk(mMtx);
+
+	mCacheDirectory = CacheDirectory;
+	mIndexFilePath = NormalizePath(fs::path(CacheDirectory) / SHADER_CACHE_INDEX_FILE_NAME);
+	mCompilerVersionFXC = ShaderUtils::GetCompilerVersion(false);
+	mCompilerVersionDXC = ShaderUtils::GetCompilerVersion(true);
+	mSourceFiles.clear();
+	mIncludeGraphHashes.clear();
+	mShaderBinaries.clear();
+	mStats = {};
+	mbIndexDirty = false;
+
+	// Index format, one record per line:
+	//   VERSION <version>
+	//   FILE    <size> <write time> <content hash> <num includes> <path>
+	//   INCLUDE <path>                                      (x <num includes>, following their FILE)
+	//   BINARY  <shader key> <binary path>
+	std::ifstream Index(mIndexFilePath);
+	if (!Index.is_open())
+	{
+		Log::Info("[ShaderCache] No index file found, shaders will be compiled: %s", mIndexFilePath.c_str());
+		mbIndexDirty = true;
+		return;
+	}
+
+	auto fnReadPath = [](std::istringstream& ss) { std::string Path; std::getline(ss >> std::ws, Path); return Path; };
+
+	bool bVersionMatch = false;
+	FSourceFile* pLastFile = nullptr;
+	std::string line;
+	while (std::getline(Index, line))
+	{
+		std::istringstream ss(line);
+		std::string Record;
+		ss >> Record;
+		if (Record == "VERSION")
+		{
+			int Version = 0;
+			ss >> Version;
+			bVersionMatch = Version == SHADER_CACHE_INDEX_VERSION;
+			if (!bVersionMatch)
+				break;
+		}
+		else if (Record == "FILE")
+		{
+			FSourceFile File;
+			size_t NumIncludes = 0;
+			ss >> File.Size >> File.WriteTime >> std::hex >> File.ContentHash >> std::dec >> NumIncludes;
+			File.Includes.reserve(NumIncludes);
+			File.bValid = true;
+			pLastFile = &(mSourceFiles[fnReadPath(ss)] = std::move(File));
+		}
+		else if (Record == "INCLUDE" && pLastFile)
+		{
+			pLastFile->Includes.push_back(fnReadPath(ss));
+		}
+		else if (Record == "BINARY")
+		{
+			uint64 Key = 0;
+			ss >> std::hex >> Key >> std::dec;
+			std::string BinaryPath = fnReadPath(ss);
+			std::error_code ec;
+			if (fs::exists(BinaryPath, ec)) // the binaries can be deleted by hand
+				mShaderBinaries[Key] = std::move(BinaryPath);
+			else
+				mbIndexDirty = true;
+		}
+	}
+
+	if (!bVersionMatch)
+	{
+		Log::Warning("[ShaderCache] Index file version mismatch, shaders will be recompiled: %s", mIndexFilePath.c_str());
+		mSourceFiles.clear();
+		mShaderBinaries.clear();
+		mbIndexDirty = true;
+	}
+
+	Log::Info("[ShaderCache] Index loaded in %.2fms: %zu source files, %zu shader binaries"
+		, t.StopGetDeltaTimeAndReset() * 1000.0f, mSourceFiles.size(), mShaderBinaries.size());
+}
+
+void ShaderCache::SaveIndex()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (!mbIndexDirty || mIndexFilePath.empty())
+		return;
+
+	// write to a temp file first so that a crash mid-write doesn't leave a truncated index behind
+	const std::string TempFilePath = mIndexFilePath + ".tmp";
+	{
+		std::ofstream Index(TempFilePath, std::ios::out | std::ios::trunc);
+		if (!Index.is_open())
+		{
+			Log::Error("[ShaderCache] Cannot write the index file: %s", TempFilePath.c_str());
+			return;
+		}
+
+		Index << "VERSION " << SHADER_CACHE_INDEX_VERSION << "\n";
+		for (const auto& it : mSourceFiles)
+		{
+			const FSourceFile& File = it.second;
+			if (!File.bValid)
+				continue;
+			Index << "FILE " << File.Size << " " << File.WriteTime << " " << ToHexString(File.ContentHash) << " " << File.Includes.size() << " " << it.first << "\n";
+			for (const std::string& Include : File.Includes)
+				Index << "INCLUDE " << Include << "\n";
+		}
+		for (const auto& it : mShaderBinaries)
+		{
+			Index << "BINARY " << ToHexString(it.first) << " " << it.second << "\n";
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(TempFilePath, mIndexFilePath, ec);
+	if (ec)
+	{
+		Log::Error("[ShaderCache] Cannot replace the index file %s: %s", mIndexFilePath.c_str(), ec.message().c_str());
+		return;
+	}
+	mbIndexDirty = false;
+}
+
+const ShaderCache::FSourceFile& ShaderCache::ValidateSourceFile(const std::string& FilePath)
+{
+	FSourceFile& File = mSourceFiles[FilePath];
+	if (File.bValidated)
+		return File;
+	File.bValidated = true;
+
+	std::error_code ec;
+	const uint64 Size = static_cast<uint64>(fs::file_size(FilePath, ec));
+	const uint64 WriteTime = ec ? 0 : static_cast<uint64>(fs::last_write_time(FilePath, ec).time_since_epoch().count());
+	if (ec)
+	{
+		File = FSourceFile();
+		File.bValidated = true;
+		mbIndexDirty = true;
+		return File;
+	}
+
+	// unchanged since the index was written: no need to read the file
+	if (File.bValid && File.Size == Size && File.WriteTime == WriteTime)
+		return File;
+
+	std::ifstream Source(FilePath, std::ios::in | std::ios::binary);
+	if (!Source.is_open())
+	{
+		Log::Error("[ShaderCache] Cannot read shader source file: %s", FilePath.c_str());
+		File = FSourceFile();
+		File.bValidated = true;
+		return File;
+	}
+
+	const std::string Contents((std::istreambuf_iterator<char>(Source)), std::istreambuf_iterator<char>());
+
+	File.Size = Size;
+	File.WriteTime = WriteTime;
+	File.ContentHash = Hash(Contents.data(), Contents.size());
+	File.bValid = true;
+	File.Includes.clear();
+	++mStats.NumSourceFilesHashed;
+	mbIndexDirty = true;
+
+	// scan the #include "..." directives, relative to the including file first, then to the working directory
+	const fs::path FileDirectory = fs::path(FilePath).parent_path();
+	std::istringstream Lines(Contents);
+	std::string line;
+	while (std::getline(Lines, line))
+	{
+		if (line.size() >= 2 && line[0] == line[1] && line[1] == '/') // skip comment lines
+			continue;
+
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		const std::string IncludeFileName = ShaderUtils::GetIncludeFileName(line);
+		if (IncludeFileName.empty())
+			continue;
+
+		const std::string IncludePath = NormalizePath(FileDirectory / IncludeFileName);
+		File.Includes.push_back(fs::exists(IncludePath, ec) ? IncludePath : NormalizePath(IncludeFileName));
+	}
+	return File;
+}
+
+uint64 ShaderCache::GetIncludeGraphHash(const std::string& SourceFilePath)
+{
+	auto it = mIncludeGraphHashes.find(SourceFilePath);
+	if (it != mIncludeGraphHashes.end())
+		return it->second;
+
+	// gather the transitive includes: each file once, regardless of how many times it's included
+	std::vector<std::string> Files;
+	std::unordered_set<std::string> Visited;
+	std::vector<std::string> Stack = { SourceFilePath };
+	while (!Stack.empty())
+	{
+		std::string FilePath = std::move(Stack.back());
+		Stack.pop_back();
+		if (!Visited.insert(FilePath).second)
+			continue;
+
+		const FSourceFile& File = ValidateSourceFile(FilePath);
+		if (!File.bValid)
+		{
+			if (FilePath == SourceFilePath)
+			{
+				mIncludeGraphHashes[SourceFilePath] = 0;
+				return 0;
+			}
+			Log::Warning("[ShaderCache] %s : Cannot open include file '%s'", SourceFilePath.c_str(), FilePath.c_str());
+		}
+		Stack.insert(Stack.end(), File.Includes.begin(), File.Includes.end());
+		Files.push_back(std::move(FilePath));
+	}
+
+	// order independent of the traversal
+	std::sort(Files.begin(), Files.end());
+	std::string KeyData;
+	for (const std::string& FilePath : Files)
+	{
+		AppendKeyData(KeyData, FilePath);
+		AppendKeyData(KeyData, mSourceFiles.at(FilePath).ContentHash);
+	}
+	const uint64 GraphHash = Hash(KeyData.data(), KeyData.size());
+	mIncludeGraphHashes[SourceFilePath] = GraphHash;
+	return GraphHash;
+}
+
+uint64 ShaderCache::GetShaderKey(const FShaderStageCompileDesc& ShaderStageCompileDesc)
+{
+	const std::string SourceFilePath = GetSourceFilePath(ShaderStageCompileDesc);
+
+	// SM5 is compiled w/ FXC, SM6 w/ DXC (see ShaderUtils::CompileFromSource())
+	const std::vector<std::string> SMTokens = StrUtil::split(ShaderStageCompileDesc.ShaderModel, '_');
+	const bool bDXC = SMTokens.size() > 1 && SMTokens[1][0] != '5';
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	const uint64 IncludeGraphHash = GetIncludeGraphHash(SourceFilePath);
+	if (IncludeGraphHash == 0)
+		return 0;
+
+	std::string KeyData;
+	AppendKeyData(KeyData, static_cast<uint64>(SHADER_CACHE_INDEX_VERSION));
+	AppendKeyData(KeyData, IncludeGraphHash);
+	AppendKeyData(KeyData, bDXC ? mCompilerVersionDXC : mCompilerVersionFXC);
+	AppendKeyData(KeyData, static_cast<uint64>(ShaderUtils::GetShaderCompileFlags()));
+	AppendKeyData(KeyData, ShaderStageCompileDesc.ShaderModel);
+	AppendKeyData(KeyData, ShaderStageCompileDesc.EntryPoint);
+	for (const FShaderMacro& Macro : ShaderStageCompileDesc.Macros)
+	{
+		AppendKeyData(KeyData, Macro.Name);
+		AppendKeyData(KeyData, Macro.Value);
+	}
+	const uint64 Key = Hash(KeyData.data(), KeyData.size());
+	return Key != 0 ? Key : 1;
+}
+
+std::string ShaderCache::GetShaderBinaryPath(const FShaderStageCompileDesc& ShaderStageCompileDesc, uint64 ShaderKey) const
+{
+	const std::string SourceFilePath = StrUtil::UnicodeToASCII<512>(ShaderStageCompileDesc.FilePath.c_str());
+	const std::string FileName = DirectoryUtil::GetFileNameWithoutExtension(SourceFilePath) + "_" + ShaderStageCompileDesc.EntryPoint + "_" + ToHexString(ShaderKey) + ".bin";
+	return NormalizePath(fs::path(mCacheDirectory) / FileName);
+}
+
+bool ShaderCache::HasShaderBinary(uint64 ShaderKey)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	const bool bHit = ShaderKey != 0 && mShaderBinaries.find(ShaderKey) != mShaderBinaries.end();
+	++(bHit ? mStats.NumCacheHits : mStats.NumCacheMisses);
+	return bHit;
+}
+
+void ShaderCache::AddShaderBinary(uint64 ShaderKey, const std::string& ShaderBinaryPath)
+{
+	if (ShaderKey == 0)
+		return;
+	std::lock_guard<std::mutex> lk(mMtx);
+	mShaderBinaries[ShaderKey] = ShaderBinaryPath;
+	mbIndexDirty = true;
+}
+
+std::string ShaderCache::GetSourceFilePath(const FShaderStageCompileDesc& ShaderStageCompileDesc)
+{
+	return NormalizePath(StrUtil::UnicodeToASCII<512>(ShaderStageCompileDesc.FilePath.c_str()));
+}
+
+std::vector<std::string> ShaderCache::GetSourceFiles() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	std::vector<std::string> FilePaths;
+	for (const auto& it : mSourceFiles)
+	{
+		if (it.second.bValid)
+			FilePaths.push_back(it.first);
+	}
+	return FilePaths;
+}
+
+void ShaderCache::InvalidateSourceFiles(const std::vector<std::string>& FilePaths)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	for (const std::string& FilePath : FilePaths)
+	{
+		auto it = mSourceFiles.find(FilePath);
+		if (it != mSourceFiles.end())
+			it->second.bValidated = false;
+	}
+
+	// the graph hashes of the files including the invalidated ones are stale too,
+	// the rest are cheap to recompute as their files stay validated
+	mIncludeGraphHashes.clear();
+}
+
+bool ShaderCache::DependsOnAny(const std::string& SourceFilePath, const std::unordered_set<std::string>& FilePaths) const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	std::unordered_set<std::string> Visited;
+	std::vector<std::string> Stack = { SourceFilePath };
+	while (!Stack.empty())
+	{
+		std::string FilePath = std::move(Stack.back());
+		Stack.pop_back();
+		if (FilePaths.count(FilePath))
+			return true;
+		if (!Visited.insert(FilePath).second)
+			continue;
+
+		auto it = mSourceFiles.find(FilePath);
+		if (it != mSourceFiles.end())
+			Stack.insert(Stack.end(), it->second.Includes.begin(), it->second.Includes.end());
+	}
+	return false;
+}
+
+FShaderCacheStats ShaderCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	FShaderCacheStats Stats = mStats;
+	Stats.NumSourceFiles = static_cast<uint>(mSourceFiles.size());
+	Stats.NumShaderBinaries = static_cast<uint>(mShaderBinaries.size());
+	return Stats;
+}
@@ -0,0 +1,95 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct FShaderStageCompileDesc;
+
+struct FShaderCacheStats
+{
+	uint NumSourceFiles = 0;     // in the include graph
+	uint NumSourceFilesHashed = 0; // re-read this run as their size/write time changed
+	uint NumShaderBinaries = 0;
+	uint NumCacheHits = 0;
+	uint NumCacheMisses = 0;
+};
+
+// Content addressed shader binary cache. A shader binary is keyed by the xxHash64 of the contents of its
+// source file & all the files it includes, the macros, entry point, shader model, compile flags and the
+// compiler version. The include graph (per file: size, write time, content hash, includes) & the list
+// of cached binaries are kept in a single index file in the cache directory:
+//  - a source file is stat'ed once per run, & only re-read/re-hashed if its size or write time changed
+//  - editing an include invalidates exactly the shaders that (transitively) include it
+// Thread-safe, the shader load workers query it concurrently.
+class ShaderCache
+{
+public:
+	static uint64 Hash(const void* pData, size_t Size, uint64 Seed = 0); // xxHash64
+
+	void Initialize(const std::string& CacheDirectory); // loads & validates the index file
+	void SaveIndex(); // writes the index file if anything changed since the last save
+
+	// returns 0 if the source file can't be read
+	uint64      GetShaderKey(const FShaderStageCompileDesc& ShaderStageCompileDesc);
+	std::string GetShaderBinaryPath(const FShaderStageCompileDesc& ShaderStageCompileDesc, uint64 ShaderKey) const;
+	bool        HasShaderBinary(uint64 ShaderKey);
+	void        AddShaderBinary(uint64 ShaderKey, const std::string& ShaderBinaryPath);
+
+	// hot reload: the source file paths are normalized, use GetSourceFilePath() for the shader stages
+	static std::string       GetSourceFilePath(const FShaderStageCompileDesc& ShaderStageCompileDesc);
+	std::vector<std::string> GetSourceFiles() const; // all the readable files in the include graph
+	void                     InvalidateSourceFiles(const std::vector<std::string>& FilePaths); // re-validated on the next GetShaderKey()
+	bool                     DependsOnAny(const std::string& SourceFilePath, const std::unordered_set<std::string>& FilePaths) const; // source or its transitive includes
+
+	FShaderCacheStats GetStats() const;
+
+private:
+	struct FSourceFile
+	{
+		uint64                   Size = 0;
+		uint64                   WriteTime = 0;
+		uint64                   ContentHash = 0;
+		std::vector<std::string> Includes;          // resolved paths
+		bool                     bValidated = false; // checked against the file on disk this run
+		bool                     bValid = false;     // file could be read
+	};
+
+	const FSourceFile& ValidateSourceFile(const std::string& FilePath);
+	uint64             GetIncludeGraphHash(const std::string& SourceFilePath); // source & its transitive includes
+
+private:
+	mutable std::mutex                           mMtx;
+	std::string                                  mCacheDirectory;
+	std::string                                  mIndexFilePath;
+	uint64                                       mCompilerVersionFXC = 0;
+	uint64                                       mCompilerVersionDXC = 0;
+	bool                                         mbIndexDirty = false;
+
+	std::unordered_map<std::string, FSourceFile> mSourceFiles;
+	std::unordered_map<std::string, uint64>      mIncludeGraphHashes; // this run
+	std::unordered_map<uint64, std::string>      mShaderBinaries;     // key -> binary file path
+	FShaderCacheStats                            mStats;
+};
@@ -40,6 +40,7 @@ Texture::Texture(const Texture& other)
     : mpAlloc                (other.mpAlloc)
     , mpTexture              (other.mpTexture)
     , mbResident             (other.mbResident.load())
+    , mpResidency            (other.mpResidency)
     , mbTypelessTexture      (other.mbTypelessTexture)
     , mStructuredBufferStride(other.mStructuredBufferStride)
     , mMipMapCount           (other.mMipMapCount)
@@ -55,6 +56,7 @@ Texture& Texture::operator=(const Texture& other)
     mpAlloc                 = other.mpAlloc;
     mpTexture               = other.mpTexture;
     mbResident              = other.mbResident.load();
+    mpResidency             = other.mpResidency;
     mbTypelessTexture       = other.mbTypelessTexture;
     mStructuredBufferStride = other.mStructuredBufferStride;
     mMipMapCount            = other.mMipMapCount;
@@ -166,6 +168,17 @@ void Texture::InitializeSRV(uint32 index, CBV_SRV_UAV* pRV, bool bInitAsArrayVie
     //
 
     GetDevice(pDevice, mpTexture);
+
+    // single channel block compressed textures: replicate R so the shaders can keep reading .rgb
+    if (mFormat == DXGI_FORMAT_BC4_UNORM && ShaderComponentMapping == D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING)
+    {
+        ShaderComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(
+              D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0
+            , D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0
+            , D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0
+            , D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1
+        );
+    }
     const bool bCustomComponentMappingSpecified = ShaderComponentMapping != D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 
     D3D12_RESOURCE_DESC resourceDesc = mpTexture->GetDesc();
@@ -269,7 +282,8 @@ void Texture::InitializeSRV(uint32 index, CBV_SRV_UAV* pRV, bool bInitAsArrayVie
                     else
                     {
                         srvDesc.Texture2D.MostDetailedMip = mipLevel;
-                        srvDesc.Texture2D.MipLevels = (mipLevel == -1) ? mMipMapCount : 1;
+                        srvDesc.Texture2D.MipLevels = (mipLevel == -1) ? mMipMapCount
+                            : (bCustomComponentMappingSpecified ? mMipMapCount - mipLevel : 1); // swizzled material textures need their mip chain
                     }
                 }
             }
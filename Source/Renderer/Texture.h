@@ -19,12 +19,16 @@
 #pragma once
 
 #include "Common.h"
+#include "TextureCache.h"
+#include "TextureResidency.h"
 #include "../../Libs/VQUtils/Source/Image.h"
 
 #include <DirectXMath.h>
 
 #include <atomic>
 #include <vector>
+#include <future>
+#include <memory>
 
 namespace D3D12MA { class Allocation; class Allocator; }
 
@@ -98,6 +102,7 @@ private:
 	D3D12MA::Allocation* mpAlloc = nullptr;
 	ID3D12Resource*      mpTexture = nullptr;
 	std::atomic<bool>    mbResident = false;
+	std::shared_ptr<TextureResidencyPromise> mpResidency; // fulfilled when the upload thread is done w/ the texture, null if there's no upload
 	
 	// some texture desc fields
 	bool mbTypelessTexture = false;
@@ -122,4 +127,6 @@ struct FTextureUploadDesc
 	const void* pData;
 	TextureID id;
 	TextureCreateDesc desc;
+	std::shared_ptr<TextureResidencyPromise> pResidencyPromise; // fulfilled by the upload thread, false if the upload failed
+	std::shared_ptr<FCookedTexture> pCookedTexture; // pre-baked mips/blocks, pData points into it
 };
\ No newline at end of file
@@ -0,0 +1,745 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "TextureCache.h"
+#include "ImageProcessing.h"
+#include "ShaderCache.h" // xxHash64
+
+#include "../../Libs/VQUtils/Source/utils.h"
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+
+// bump when the cooking output changes to invalidate the cached textures
+#define TEXTURE_CACHE_VERSION 1
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// MIP GENERATION
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static uint CalculateMipLevelCount(uint Width, uint Height)
+{
+	uint Count = 1;
+	uint Dimension = std::max(Width, Height);
+	while (Dimension > 1) { Dimension >>= 1; ++Count; }
+	return Count;
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// BLOCK COMPRESSION
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+static inline uint16 PackRGB565(int r, int g, int b)
+{
+	return static_cast<uint16>((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+static inline void UnpackRGB565(uint16 c, int rgb[3])
+{
+	const int r = (c >> 11) & 31;
+	const int g = (c >> 5 ) & 63;
+	const int b = (c >> 0 ) & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Bounding box end points w/ diagonal selection & inset, see J.M.P. van Waveren's Real-Time DXT Compression
+static void EncodeBC1Block(const uint8 Texels[16][4], uint8* pOut)
+{
+	int Min[3] = { 255, 255, 255 };
+	int Max[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	for (int c = 0; c < 3; ++c)
+	{
+		Min[c] = std::min(Min[c], (int)Texels[i][c]);
+		Max[c] = std::max(Max[c], (int)Texels[i][c]);
+	}
+
+	// pick the bounding box diagonal that follows the color distribution of the block
+	const int Center[3] = { (Min[0] + Max[0]) / 2, (Min[1] + Max[1]) / 2, (Min[2] + Max[2]) / 2 };
+	int CovRG = 0;
+	int CovBG = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		const int dg = Texels[i][1] - Center[1];
+		CovRG += (Texels[i][0] - Center[0]) * dg;
+		CovBG += (Texels[i][2] - Center[2]) * dg;
+	}
+	if (CovRG < 0) std::swap(Min[0], Max[0]);
+	if (CovBG < 0) std::swap(Min[2], Max[2]);
+
+	// inset the end points to reduce the quantization error
+	for (int c = 0; c < 3; ++c)
+	{
+		const int Inset = (Max[c] - Min[c]) / 16;
+		Max[c] = std::clamp(Max[c] - Inset, 0, 255);
+		Min[c] = std::clamp(Min[c] + Inset, 0, 255);
+	}
+
+	uint16 c0 = PackRGB565(Max[0], Max[1], Max[2]);
+	uint16 c1 = PackRGB565(Min[0], Min[1], Min[2]);
+	if (c0 < c1)
+		std::swap(c0, c1); // c0 > c1: 4-color mode
+
+	uint32 Indices = 0;
+	if (c0 != c1) // c0 == c1: all indices point to c0
+	{
+		int Palette[4][3];
+		UnpackRGB565(c0, Palette[0]);
+		UnpackRGB565(c1, Palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			Palette[2][c] = (2 * Palette[0][c] + 1 * Palette[1][c]) / 3;
+			Palette[3][c] = (1 * Palette[0][c] + 2 * Palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int BestIndex = 0;
+			int BestError = INT_MAX;
+			for (int p = 0; p < 4; ++p)
+			{
+				const int dr = Texels[i][0] - Palette[p][0];
+				const int dg = Texels[i][1] - Palette[p][1];
+				const int db = Texels[i][2] - Palette[p][2];
+				const int Error = dr * dr + dg * dg + db * db;
+				if (Error < BestError) { BestError = Error; BestIndex = p; }
+			}
+			Indices |= static_cast<uint32>(BestIndex) << (2 * i);
+		}
+	}
+
+	pOut[0] = static_cast<uint8>(c0 & 0xFF); pOut[1] = static_cast<uint8>(c0 >> 8);
+	pOut[2] = static_cast<uint8>(c1 & 0xFF); pOut[3] = static_cast<uint8>(c1 >> 8);
+	for (int b = 0; b < 4; ++b)
+		pOut[4 + b] = static_cast<uint8>((Indices >> (8 * b)) & 0xFF);
+}
+
+static void EncodeBC4Block(const uint8 Values[16], uint8* pOut)
+{
+	int Min = 255;
+	int Max = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		Min = std::min(Min, (int)Values[i]);
+		Max = std::max(Max, (int)Values[i]);
+	}
+
+	pOut[0] = static_cast<uint8>(Max);
+	pOut[1] = static_cast<uint8>(Min);
+
+	uint64 Indices = 0;
+	if (Max != Min) // Max > Min: 8-value mode
+	{
+		int Palette[8];
+		Palette[0] = Max;
+		Palette[1] = Min;
+		for (int k = 1; k <= 6; ++k)
+			Palette[k + 1] = ((7 - k) * Max + k * Min + 3) / 7;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int BestIndex = 0;
+			int BestError = INT_MAX;
+			for (int p = 0; p < 8; ++p)
+			{
+				const int Error = std::abs(Values[i] - Palette[p]);
+				if (Error < BestError) { BestError = Error; BestIndex = p; }
+			}
+			Indices |= static_cast<uint64>(BestIndex) << (3 * i);
+		}
+	}
+
+	for (int b = 0; b < 6; ++b)
+		pOut[2 + b] = static_cast<uint8>((Indices >> (8 * b)) & 0xFF);
+}
+
+static DXGI_FORMAT GetCookedFormat(ETextureCompression Compression)
+{
+	switch (Compression)
+	{
+	case ETextureCompression::NONE: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case ETextureCompression::BC1 : return DXGI_FORMAT_BC1_UNORM;
+	case ETextureCompression::BC3 : return DXGI_FORMAT_BC3_UNORM;
+	case ETextureCompression::BC4 : return DXGI_FORMAT_BC4_UNORM;
+	case ETextureCompression::BC5 : return DXGI_FORMAT_BC5_UNORM;
+	default: assert(false); break;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+static size_t GetBlockSizeInBytes(DXGI_FORMAT Format)
+{
+	switch (Format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC4_UNORM: return 8;
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC5_UNORM: return 16;
+	default: break;
+	}
+	return 0; // not block compressed
+}
+
+static size_t GetMipSizeInBytes(DXGI_FORMAT Format, uint Width, uint Height)
+{
+	const size_t BlockSize = GetBlockSizeInBytes(Format);
+	if (BlockSize == 0)
+		return size_t(Width) * Height * 4; // RGBA8
+
+	const size_t NumBlocksX = std::max(1u, (Width  + 3) / 4);
+	const size_t NumBlocksY = std::max(1u, (Height + 3) / 4);
+	return NumBlocksX * NumBlocksY * BlockSize;
+}
+
+static void CompressMip(const uint8* pRGBA8, uint Width, uint Height, DXGI_FORMAT Format, uint8* pOut)
+{
+	const size_t BlockSize = GetBlockSizeInBytes(Format);
+	const uint NumBlocksX = std::max(1u, (Width  + 3) / 4);
+	const uint NumBlocksY = std::max(1u, (Height + 3) / 4);
+
+	uint8 Texels[16][4];
+	uint8 Channel[16];
+	for (uint by = 0; by < NumBlocksY; ++by)
+	for (uint bx = 0; bx < NumBlocksX; ++bx)
+	{
+		// gather the 4x4 block, clamp to edge for the mips smaller than a block
+		for (uint i = 0; i < 16; ++i)
+		{
+			const uint x = std::min(bx * 4 + (i % 4), Width  - 1);
+			const uint y = std::min(by * 4 + (i / 4), Height - 1);
+			memcpy(Texels[i], pRGBA8 + (y * Width + x) * 4, 4);
+		}
+
+		uint8* pBlock = pOut + (by * NumBlocksX + bx) * BlockSize;
+		switch (Format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			EncodeBC1Block(Texels, pBlock);
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+			for (int i = 0; i < 16; ++i) Channel[i] = Texels[i][3];
+			EncodeBC4Block(Channel, pBlock);      // alpha block
+			EncodeBC1Block(Texels, pBlock + 8);   // color block
+			break;
+		case DXGI_FORMAT_BC4_UNORM:
+			for (int i = 0; i < 16; ++i) Channel[i] = Texels[i][0];
+			EncodeBC4Block(Channel, pBlock);
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+			for (int i = 0; i < 16; ++i) Channel[i] = Texels[i][0];
+			EncodeBC4Block(Channel, pBlock);
+			for (int i = 0; i < 16; ++i) Channel[i] = Texels[i][1];
+			EncodeBC4Block(Channel, pBlock + 8);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+}
+
+static bool HasNonOpaqueAlpha(const uint8* pRGBA8, size_t NumTexels)
+{
+	for (size_t i = 0; i < NumTexels; ++i)
+		if (pRGBA8[i * 4 + 3] != 0xFF)
+			return true;
+	return false;
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// DDS
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	constexpr uint32 DDS_MAGIC = 0x20534444; // "DDS "
+	constexpr uint32 DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+	constexpr uint32 DDS_VQE_TAG = 0x00455156; // "VQE", stored in the reserved fields along with the cache version
+
+	constexpr uint32 DDSD_CAPS        = 0x1;
+	constexpr uint32 DDSD_HEIGHT      = 0x2;
+	constexpr uint32 DDSD_WIDTH       = 0x4;
+	constexpr uint32 DDSD_PIXELFORMAT = 0x1000;
+	constexpr uint32 DDSD_MIPMAPCOUNT = 0x20000;
+	constexpr uint32 DDSD_LINEARSIZE  = 0x80000;
+	constexpr uint32 DDPF_FOURCC      = 0x4;
+	constexpr uint32 DDSCAPS_COMPLEX  = 0x8;
+	constexpr uint32 DDSCAPS_TEXTURE  = 0x1000;
+	constexpr uint32 DDSCAPS_MIPMAP   = 0x400000;
+	constexpr uint32 DDS_DIMENSION_TEXTURE2D = 3;
+
+	struct FDDSPixelFormat
+	{
+		uint32 Size;
+		uint32 Flags;
+		uint32 FourCC;
+		uint32 RGBBitCount;
+		uint32 RBitMask;
+		uint32 GBitMask;
+		uint32 BBitMask;
+		uint32 ABitMask;
+	};
+	struct FDDSHeader
+	{
+		uint32          Size;
+		uint32          Flags;
+		uint32          Height;
+		uint32          Width;
+		uint32          PitchOrLinearSize;
+		uint32          Depth;
+		uint32          MipMapCount;
+		uint32          Reserved1[11];
+		FDDSPixelFormat PixelFormat;
+		uint32          Caps;
+		uint32          Caps2;
+		uint32          Caps3;
+		uint32          Caps4;
+		uint32          Reserved2;
+	};
+	struct FDDSHeaderDX10
+	{
+		uint32 DXGIFormat;
+		uint32 ResourceDimension;
+		uint32 MiscFlag;
+		uint32 ArraySize;
+		uint32 MiscFlags2;
+	};
+	static_assert(sizeof(FDDSHeader) == 124, "DDS header size mismatch");
+	static_assert(sizeof(FDDSHeaderDX10) == 20, "DDS DX10 header size mismatch");
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// TEXTURE CACHE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+namespace TextureCache
+{
+	bool CanCompress(uint Width, uint Height, bool bHDR)
+	{
+		return !bHDR && Width >= 4 && Height >= 4 && (Width % 4) == 0 && (Height % 4) == 0;
+	}
+
+	uint64 HashFile(const std::string& FilePath)
+	{
+		std::ifstream file(FilePath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return 0;
+
+		// xxHash64 isn't incremental here: read the whole file, FileHashCache makes this a once per file edit cost
+		std::vector<char> Contents(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(Contents.data(), Contents.size());
+		if (!file.good())
+			return 0;
+		return HashMemory(Contents.data(), Contents.size());
+	}
+
+	uint64 HashMemory(const void* pData, size_t Size)
+	{
+		return ShaderCache::Hash(pData, Size);
+	}
+
+	std::string GetCachedTexturePath(const std::string& CacheDirectory, const std::string& SourceFilePath, uint64 SourceHash, ETextureCompression Compression, bool bGenerateMips, bool bSRGB)
+	{
+		static const char* COMPRESSION_NAMES[] = { "RGBA8", "BC1", "BC3", "BC4", "BC5", "BC1BC3" };
+		static_assert(_countof(COMPRESSION_NAMES) == static_cast<size_t>(ETextureCompression::NUM_TEXTURE_COMPRESSION_TYPES), "Missing compression name");
+
+		char HashStr[17];
+		snprintf(HashStr, sizeof(HashStr), "%016llx", SourceHash);
+
+		return CacheDirectory + "/" + DirectoryUtil::GetFileNameWithoutExtension(SourceFilePath)
+			+ "_" + HashStr
+			+ "_" + COMPRESSION_NAMES[static_cast<size_t>(Compression)]
+			+ (bGenerateMips ? "_mips" : "")
+			+ (bGenerateMips && bSRGB ? "_srgb" : "") // only the mip filtering depends on the color space
+			+ ".dds";
+	}
+
+	bool CookTexture(const void* pRGBA8, uint Width, uint Height, ETextureCompression Compression, bool bGenerateMips, bool bSRGB, FCookedTexture& OutTexture)
+	{
+		if (!pRGBA8 || Width == 0 || Height == 0)
+			return false;
+
+		const uint8* pSrc = static_cast<const uint8*>(pRGBA8);
+		if (Compression == ETextureCompression::BC1_BC3)
+		{
+			Compression = HasNonOpaqueAlpha(pSrc, size_t(Width) * Height) ? ETextureCompression::BC3 : ETextureCompression::BC1;
+		}
+		if (Compression != ETextureCompression::NONE && !CanCompress(Width, Height, false))
+		{
+			Log::Warning("TextureCache::CookTexture(): cannot block compress %ux%u texture", Width, Height);
+			return false;
+		}
+
+		OutTexture.Format   = GetCookedFormat(Compression);
+		OutTexture.Width    = Width;
+		OutTexture.Height   = Height;
+		OutTexture.MipCount = bGenerateMips ? CalculateMipLevelCount(Width, Height) : 1;
+		OutTexture.MipOffsets.resize(OutTexture.MipCount);
+
+		size_t TotalSize = 0;
+		for (uint mip = 0; mip < OutTexture.MipCount; ++mip)
+		{
+			OutTexture.MipOffsets[mip] = TotalSize;
+			TotalSize += GetMipSizeInBytes(OutTexture.Format, std::max(1u, Width >> mip), std::max(1u, Height >> mip));
+		}
+		OutTexture.Data.resize(TotalSize);
+
+		// ping-pong between two scratch buffers for the mip chain, mip0 reads from the source directly.
+		// Textures are cooked on the texture loading workers already, the mips are processed on this thread.
+		const ImageProcessing::EPixelFormat MipFormat = bSRGB ? ImageProcessing::EPixelFormat::RGBA8_UNORM_SRGB : ImageProcessing::EPixelFormat::RGBA8_UNORM;
+		std::vector<uint8> MipScratch[2];
+		const uint8* pMip = pSrc;
+		for (uint mip = 0; mip < OutTexture.MipCount; ++mip)
+		{
+			const uint W = std::max(1u, Width  >> mip);
+			const uint H = std::max(1u, Height >> mip);
+			if (mip > 0)
+			{
+				const uint PrevW = std::max(1u, Width  >> (mip - 1));
+				const uint PrevH = std::max(1u, Height >> (mip - 1));
+				std::vector<uint8>& Dst = MipScratch[mip % 2];
+				Dst.resize(size_t(W) * H * 4);
+				ImageProcessing::Downsample2x2(ImageProcessing::FImageView(const_cast<uint8*>(pMip), PrevW, PrevH, MipFormat), ImageProcessing::FImageView(Dst.data(), W, H, MipFormat));
+				pMip = Dst.data();
+			}
+
+			uint8* pOut = OutTexture.Data.data() + OutTexture.MipOffsets[mip];
+			if (Compression == ETextureCompression::NONE)
+				memcpy(pOut, pMip, size_t(W) * H * 4);
+			else
+				CompressMip(pMip, W, H, OutTexture.Format, pOut);
+		}
+
+		return true;
+	}
+
+	// Validates the headers & fills everything but the texels, returns the size of the texel data
+	static size_t ReadCookedTextureHeaders(uint32 Magic, const FDDSHeader& Header, const FDDSHeaderDX10& HeaderDX10, size_t DataSize, const std::string& CacheFilePath, FCookedTexture& OutTexture)
+	{
+		const bool bValidHeader = Magic == DDS_MAGIC
+			&& Header.Size == sizeof(FDDSHeader)
+			&& Header.PixelFormat.FourCC == DDS_FOURCC_DX10
+			&& Header.Reserved1[0] == DDS_VQE_TAG
+			&& Header.Reserved1[1] == TEXTURE_CACHE_VERSION
+			&& HeaderDX10.ResourceDimension == DDS_DIMENSION_TEXTURE2D
+			&& HeaderDX10.ArraySize == 1
+			&& Header.MipMapCount > 0;
+		if (!bValidHeader)
+		{
+			Log::Warning("TextureCache: invalid or outdated cache file: %s", CacheFilePath.c_str());
+			return 0;
+		}
+
+		OutTexture.Format   = static_cast<DXGI_FORMAT>(HeaderDX10.DXGIFormat);
+		OutTexture.Width    = Header.Width;
+		OutTexture.Height   = Header.Height;
+		OutTexture.MipCount = Header.MipMapCount;
+		OutTexture.MipOffsets.resize(OutTexture.MipCount);
+
+		size_t TotalSize = 0;
+		for (uint mip = 0; mip < OutTexture.MipCount; ++mip)
+		{
+			OutTexture.MipOffsets[mip] = TotalSize;
+			TotalSize += GetMipSizeInBytes(OutTexture.Format, std::max(1u, OutTexture.Width >> mip), std::max(1u, OutTexture.Height >> mip));
+		}
+		if (DataSize < TotalSize)
+		{
+			Log::Warning("TextureCache: truncated cache file: %s", CacheFilePath.c_str());
+			return 0;
+		}
+		return TotalSize;
+	}
+
+	bool LoadCookedTexture(const std::string& CacheFilePath, FCookedTexture& OutTexture)
+	{
+		std::ifstream file(CacheFilePath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+
+		const size_t FileSize = static_cast<size_t>(file.tellg());
+		file.seekg(0, std::ios::beg);
+
+		uint32 Magic = 0;
+		FDDSHeader Header = {};
+		FDDSHeaderDX10 HeaderDX10 = {};
+		const size_t HeaderSize = sizeof(Magic) + sizeof(Header) + sizeof(HeaderDX10);
+		if (FileSize < HeaderSize)
+			return false;
+
+		file.read(reinterpret_cast<char*>(&Magic), sizeof(Magic));
+		file.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+		file.read(reinterpret_cast<char*>(&HeaderDX10), sizeof(HeaderDX10));
+
+		const size_t TotalSize = ReadCookedTextureHeaders(Magic, Header, HeaderDX10, FileSize - HeaderSize, CacheFilePath, OutTexture);
+		if (TotalSize == 0)
+			return false;
+
+		OutTexture.Data.resize(TotalSize);
+		file.read(reinterpret_cast<char*>(OutTexture.Data.data()), TotalSize);
+		return static_cast<size_t>(file.gcount()) == TotalSize;
+	}
+
+	bool LoadCookedTexture(const uint8* pFileData, size_t FileSize, const std::shared_ptr<const void>& pFileDataOwner, const std::string& CacheFilePath, FCookedTexture& OutTexture)
+	{
+		uint32 Magic = 0;
+		FDDSHeader Header = {};
+		FDDSHeaderDX10 HeaderDX10 = {};
+		const size_t HeaderSize = sizeof(Magic) + sizeof(Header) + sizeof(HeaderDX10);
+		if (!pFileData || FileSize < HeaderSize)
+			return false;
+
+		memcpy(&Magic, pFileData, sizeof(Magic));
+		memcpy(&Header, pFileData + sizeof(Magic), sizeof(Header));
+		memcpy(&HeaderDX10, pFileData + sizeof(Magic) + sizeof(Header), sizeof(HeaderDX10));
+
+		if (ReadCookedTextureHeaders(Magic, Header, HeaderDX10, FileSize - HeaderSize, CacheFilePath, OutTexture) == 0)
+			return false;
+
+		OutTexture.pExternalData      = pFileData + HeaderSize;
+		OutTexture.pExternalDataOwner = pFileDataOwner;
+		return true;
+	}
+
+	bool SaveCookedTexture(const std::string& CacheFilePath, const FCookedTexture& Texture)
+	{
+		assert(Texture.ArraySize == 1 && Texture.pExternalData == nullptr); // material textures own their texels
+		std::ofstream file(CacheFilePath, std::ios::binary);
+		if (!file.is_open())
+		{
+			Log::Error("TextureCache: cannot open file for writing: %s", CacheFilePath.c_str());
+			return false;
+		}
+
+		FDDSHeader Header = {};
+		Header.Size              = sizeof(FDDSHeader);
+		Header.Flags             = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		Header.Height            = Texture.Height;
+		Header.Width             = Texture.Width;
+		Header.PitchOrLinearSize = static_cast<uint32>(GetMipSizeInBytes(Texture.Format, Texture.Width, Texture.Height));
+		Header.Depth             = 1;
+		Header.MipMapCount       = Texture.MipCount;
+		Header.Reserved1[0]      = DDS_VQE_TAG;
+		Header.Reserved1[1]      = TEXTURE_CACHE_VERSION;
+		Header.PixelFormat.Size  = sizeof(FDDSPixelFormat);
+		Header.PixelFormat.Flags = DDPF_FOURCC;
+		Header.PixelFormat.FourCC= DDS_FOURCC_DX10;
+		Header.Caps              = DDSCAPS_TEXTURE | (Texture.MipCount > 1 ? (DDSCAPS_COMPLEX | DDSCAPS_MIPMAP) : 0);
+
+		FDDSHeaderDX10 HeaderDX10 = {};
+		HeaderDX10.DXGIFormat        = static_cast<uint32>(Texture.Format);
+		HeaderDX10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+		HeaderDX10.ArraySize         = 1;
+
+		file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+		file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		file.write(reinterpret_cast<const char*>(&HeaderDX10), sizeof(HeaderDX10));
+		file.write(reinterpret_cast<const char*>(Texture.Data.data()), Texture.Data.size());
+		return file.good();
+	}
+
+	size_t GetMipSize(const FCookedTexture& Texture, uint Mip)
+	{
+		return GetMipSizeInBytes(Texture.Format, std::max(1u, Texture.Width >> Mip), std::max(1u, Texture.Height >> Mip));
+	}
+
+	static void InitializeMipChain(const FCookedTexture& Texture, uint TopMip, FCookedTexture& OutTexture)
+	{
+		assert(Texture.ArraySize == 1 && TopMip < Texture.MipCount);
+		OutTexture.Format   = Texture.Format;
+		OutTexture.Width    = std::max(1u, Texture.Width  >> TopMip);
+		OutTexture.Height   = std::max(1u, Texture.Height >> TopMip);
+		OutTexture.MipCount = Texture.MipCount - TopMip;
+		OutTexture.MipOffsets.resize(OutTexture.MipCount);
+		for (uint mip = 0; mip < OutTexture.MipCount; ++mip)
+			OutTexture.MipOffsets[mip] = Texture.MipOffsets[TopMip + mip] - Texture.MipOffsets[TopMip];
+	}
+
+	std::shared_ptr<FCookedTexture> GetMipChain(const std::shared_ptr<FCookedTexture>& pTexture, uint TopMip)
+	{
+		if (TopMip == 0)
+			return pTexture;
+
+		std::shared_ptr<FCookedTexture> pMipChain = std::make_shared<FCookedTexture>();
+		InitializeMipChain(*pTexture, TopMip, *pMipChain);
+		pMipChain->pExternalData      = pTexture->GetMipData(TopMip);
+		pMipChain->pExternalDataOwner = pTexture;
+		return pMipChain;
+	}
+
+	FCookedTexture CopyMipChain(const FCookedTexture& Texture, uint TopMip)
+	{
+		FCookedTexture MipChain;
+		InitializeMipChain(Texture, TopMip, MipChain);
+		const size_t LastMip = Texture.MipCount - 1;
+		const size_t Size = Texture.MipOffsets[LastMip] + GetMipSize(Texture, static_cast<uint>(LastMip)) - Texture.MipOffsets[TopMip];
+		MipChain.Data.assign(Texture.GetMipData(TopMip), Texture.GetMipData(TopMip) + Size);
+		return MipChain;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// FILE HASH CACHE
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------
+namespace fs = std::filesystem;
+
+constexpr const char* FILE_HASH_CACHE_INDEX_FILE_NAME = "SourceFiles.idx";
+constexpr int         FILE_HASH_CACHE_INDEX_VERSION   = 1; // bump when the hash or the index format changes
+
+void FileHashCache::Initialize(const std::string& CacheDirectory)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mIndexFilePath = (fs::path(CacheDirectory) / FILE_HASH_CACHE_INDEX_FILE_NAME).generic_string();
+	mFiles.clear();
+	mStats = {};
+	mbIndexDirty = false;
+
+	// Index format, one record per line:
+	//   VERSION <version>
+	//   FILE    <size> <write time> <content hash> <path>
+	std::ifstream Index(mIndexFilePath);
+	if (!Index.is_open())
+	{
+		mbIndexDirty = true;
+		return;
+	}
+
+	bool bVersionMatch = false;
+	std::string line;
+	while (std::getline(Index, line))
+	{
+		std::istringstream ss(line);
+		std::string Record;
+		ss >> Record;
+		if (Record == "VERSION")
+		{
+			int Version = 0;
+			ss >> Version;
+			bVersionMatch = Version == FILE_HASH_CACHE_INDEX_VERSION;
+			if (!bVersionMatch)
+				break;
+		}
+		else if (Record == "FILE")
+		{
+			FFile File;
+			std::string FilePath;
+			ss >> File.Size >> File.WriteTime >> std::hex >> File.ContentHash >> std::dec;
+			std::getline(ss >> std::ws, FilePath);
+			if (!FilePath.empty())
+				mFiles[FilePath] = File;
+		}
+	}
+
+	if (!bVersionMatch)
+	{
+		Log::Warning("[TextureCache] Source file index version mismatch, the source files will be re-hashed: %s", mIndexFilePath.c_str());
+		mFiles.clear();
+		mbIndexDirty = true;
+	}
+}
+
+void FileHashCache::SaveIndex()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (!mbIndexDirty || mIndexFilePath.empty())
+		return;
+
+	// write to a temp file first so that a crash mid-write doesn't leave a truncated index behind
+	const std::string TempFilePath = mIndexFilePath + ".tmp";
+	{
+		std::ofstream Index(TempFilePath, std::ios::out | std::ios::trunc);
+		if (!Index.is_open())
+		{
+			Log::Error("[TextureCache] Cannot write the source file index: %s", TempFilePath.c_str());
+			return;
+		}
+
+		Index << "VERSION " << FILE_HASH_CACHE_INDEX_VERSION << "\n";
+		for (const auto& it : mFiles)
+		{
+			char HashStr[17];
+			snprintf(HashStr, sizeof(HashStr), "%016llx", static_cast<unsigned long long>(it.second.ContentHash));
+			Index << "FILE " << it.second.Size << " " << it.second.WriteTime << " " << HashStr << " " << it.first << "\n";
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(TempFilePath, mIndexFilePath, ec);
+	if (ec)
+	{
+		Log::Error("[TextureCache] Cannot replace the source file index %s: %s", mIndexFilePath.c_str(), ec.message().c_str());
+		return;
+	}
+	mbIndexDirty = false;
+}
+
+uint64 FileHashCache::HashFile(const std::string& FilePath)
+{
+	std::error_code ec;
+	const uint64 Size = static_cast<uint64>(fs::file_size(FilePath, ec));
+	const uint64 WriteTime = ec ? 0 : static_cast<uint64>(fs::last_write_time(FilePath, ec).time_since_epoch().count());
+	if (ec)
+		return 0;
+
+	const std::string NormalizedFilePath = fs::path(FilePath).lexically_normal().generic_string();
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		auto it = mFiles.find(NormalizedFilePath);
+		if (it != mFiles.end() && it->second.Size == Size && it->second.WriteTime == WriteTime)
+			return it->second.ContentHash; // unchanged since the index was written: no need to read the file
+	}
+
+	// hash outside the lock: the workers hash different files concurrently
+	FFile File;
+	File.Size = Size;
+	File.WriteTime = WriteTime;
+	File.ContentHash = TextureCache::HashFile(FilePath);
+	if (File.ContentHash == 0)
+		return 0;
+
+	std::lock_guard<std::mutex> lk(mMtx);
+	mFiles[NormalizedFilePath] = File;
+	mbIndexDirty = true;
+	++mStats.NumFilesHashed;
+	return File.ContentHash;
+}
+
+FFileHashCacheStats FileHashCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	FFileHashCacheStats Stats = mStats;
+	Stats.NumFiles = static_cast<uint>(mFiles.size());
+	return Stats;
+}
@@ -0,0 +1,122 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <dxgiformat.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Block compression applied when cooking a texture. The cooked textures
+// (mip chain + compressed blocks) are stored in VQRenderer::TextureCacheDirectory.
+enum class ETextureCompression
+{
+	NONE = 0,
+	BC1,      // RGB, 4bpp
+	BC3,      // RGBA, 8bpp
+	BC4,      // R, 4bpp: the SRVs replicate R into GB so shaders can keep reading .rgb
+	BC5,      // RG, 8bpp: normal maps, Z is reconstructed in the shaders
+	BC1_BC3,  // BC3 if the image has non-opaque alpha, BC1 otherwise
+
+	NUM_TEXTURE_COMPRESSION_TYPES
+};
+
+struct FCookedTexture
+{
+	DXGI_FORMAT         Format = DXGI_FORMAT_UNKNOWN;
+	uint                Width = 0;
+	uint                Height = 0;
+	uint                MipCount = 0;
+	uint                ArraySize = 1;  // 6 for cubemaps
+	std::vector<size_t> MipOffsets; // into Data, ArraySize * MipCount entries: slice-major like D3D12 subresources
+	std::vector<uint8>  Data;       // tightly packed rows of blocks (or pixels) for each mip
+
+	// The texels can live in memory owned by something else instead (e.g. a memory mapped cache file),
+	// pExternalDataOwner keeps it alive until the upload is done.
+	const uint8*                pExternalData = nullptr;
+	std::shared_ptr<const void> pExternalDataOwner;
+
+	inline const uint8* GetData() const { return pExternalData ? pExternalData : Data.data(); }
+	inline const uint8* GetMipData(uint mip, uint slice = 0) const { return GetData() + MipOffsets[slice * MipCount + mip]; }
+};
+
+namespace TextureCache
+{
+	// Block compression requires the top mip to be multiple of 4 texels, and there's no HDR encoder
+	bool CanCompress(uint Width, uint Height, bool bHDR);
+
+	uint64 HashFile(const std::string& FilePath); // xxHash64 of the file contents, 0 if the file can't be read. See FileHashCache.
+	uint64 HashMemory(const void* pData, size_t Size); // same hash as HashFile() for the file contents
+	std::string GetCachedTexturePath(const std::string& CacheDirectory, const std::string& SourceFilePath, uint64 SourceHash, ETextureCompression Compression, bool bGenerateMips, bool bSRGB);
+
+	// pRGBA8 points to Width*Height RGBA8 texels. ETextureCompression::NONE cooks an RGBA8 mip chain.
+	// bSRGB: the color channels are sRGB encoded (albedo, emissive), mips are filtered in linear space.
+	bool CookTexture(const void* pRGBA8, uint Width, uint Height, ETextureCompression Compression, bool bGenerateMips, bool bSRGB, FCookedTexture& OutTexture);
+
+	// DDS files with the DX10 header extension
+	bool LoadCookedTexture(const std::string& CacheFilePath, FCookedTexture& OutTexture);
+	bool LoadCookedTexture(const uint8* pFileData, size_t FileSize, const std::shared_ptr<const void>& pFileDataOwner, const std::string& CacheFilePath, FCookedTexture& OutTexture); // texels point into pFileData
+	bool SaveCookedTexture(const std::string& CacheFilePath, const FCookedTexture& Texture);
+
+	// Mips [TopMip, MipCount) of a (non-array) cooked texture as a texture of their own, used for mip streaming.
+	// GetMipChain() points into pTexture's texels and keeps it alive, CopyMipChain() owns a copy of them.
+	std::shared_ptr<FCookedTexture> GetMipChain(const std::shared_ptr<FCookedTexture>& pTexture, uint TopMip);
+	FCookedTexture                  CopyMipChain(const FCookedTexture& Texture, uint TopMip);
+	size_t                          GetMipSize(const FCookedTexture& Texture, uint Mip); // in bytes
+}
+
+struct FFileHashCacheStats
+{
+	uint NumFiles = 0;
+	uint NumFilesHashed = 0; // re-read this run as their size/write time changed
+};
+
+// TextureCache::HashFile() results of the texture & environment map source files, kept in an index file in the
+// texture cache directory: like the ShaderCache source files, a file is stat'ed & only re-read/re-hashed if its
+// size or write time changed. Thread-safe, the texture load workers query it concurrently.
+class FileHashCache
+{
+public:
+	void Initialize(const std::string& CacheDirectory); // loads the index file
+	void SaveIndex(); // writes the index file if anything changed since the last save
+
+	uint64 HashFile(const std::string& FilePath); // 0 if the file can't be read
+
+	FFileHashCacheStats GetStats() const;
+
+private:
+	struct FFile
+	{
+		uint64 Size = 0;
+		uint64 WriteTime = 0;
+		uint64 ContentHash = 0;
+	};
+
+private:
+	mutable std::mutex                     mMtx;
+	std::string                            mIndexFilePath;
+	bool                                   mbIndexDirty = false;
+	std::unordered_map<std::string, FFile> mFiles;
+	FFileHashCacheStats                    mStats;
+};
@@ -0,0 +1,72 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "../Engine/Core/Types.h"
+#include "../Engine/Core/Promise.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+
+using TextureResidencyPromise = Promise<bool>; // fulfilled by the upload thread: true if resident, false if the upload failed
+
+// Returned by the async texture creation functions: the ID is valid right away and can be used to
+// initialize resource views, but the texture shouldn't be sampled until Residency becomes ready.
+struct FTextureResidencyHandle
+{
+	TextureID                                ID = INVALID_ID;
+	std::shared_future<bool>                 Residency;         // invalid for textures that don't upload any data
+	std::shared_ptr<TextureResidencyPromise> pResidencyPromise; // null for textures that don't upload any data
+
+	// the upload thread no longer touches the texture, it's resident or its upload failed
+	inline bool IsUploadDone() const { return !Residency.valid() || Residency.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+	inline bool IsResident() const { return IsUploadDone() && (!Residency.valid() || Residency.get()); }
+	inline bool IsUploadFailed() const { return IsUploadDone() && !IsResident(); }
+	inline bool WaitForResidency() const { return !Residency.valid() || Residency.get(); } // returns false if the upload failed
+
+	// runs fn(bResident) once the upload thread is done w/ the texture: right away if it is, otherwise on the upload thread
+	inline void OnUploadDone(TextureResidencyPromise::Continuation_t&& fn) const
+	{
+		if (pResidencyPromise)
+			pResidencyPromise->Then(std::move(fn));
+		else
+			fn(WaitForResidency()); // nothing to upload or a failed handle: ready
+	}
+
+	static FTextureResidencyHandle Create(TextureID Id, const std::shared_ptr<TextureResidencyPromise>& pResidencyPromise)
+	{
+		FTextureResidencyHandle h;
+		h.ID = Id;
+		h.pResidencyPromise = pResidencyPromise;
+		if (pResidencyPromise)
+			h.Residency = pResidencyPromise->GetFuture();
+		return h;
+	}
+
+	// for the textures that couldn't be created: no ID & a failed residency
+	static FTextureResidencyHandle Failed()
+	{
+		std::promise<bool> Residency;
+		Residency.set_value(false);
+		FTextureResidencyHandle h;
+		h.Residency = Residency.get_future().share();
+		return h;
+	}
+};
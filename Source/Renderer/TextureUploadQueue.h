@@ -0,0 +1,188 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "TextureResidency.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+// Uploads the textures queued by the loading threads on a dedicated upload thread and fulfills their
+// residency promises, which runs the continuations registered on them:
+//  - the uploads are pipelined: once a batch is submitted, the textures queued in the meantime are recorded while the GPU executes it
+//  - an upload that can't be recorded fails the residency of its texture
+//  - the uploads that didn't make it before Exit() fail their residency, so no one waits on them forever
+// The copies, the batch submission & the fences are done by the backend so that the queue doesn't depend on the graphics API.
+// TUploadDesc provides TextureID id & std::shared_ptr<TextureResidencyPromise> pResidencyPromise (may be null).
+// Thread-safe: any thread can enqueue, the backend is called from the upload thread only.
+template<class TUploadDesc>
+class TextureUploadQueue
+{
+public:
+	class IBackend
+	{
+	public:
+		virtual ~IBackend() = default;
+		virtual bool   RecordTextureUpload(TUploadDesc& desc) = 0;           // returns false if nothing was recorded for the texture
+		virtual uint64 SubmitTextureUploads() = 0;                           // returns the fence value of the submitted batch
+		virtual bool   IsTextureUploadBatchComplete(uint64 FenceValue) = 0;
+		virtual void   WaitForTextureUploadBatch(uint64 FenceValue) = 0;
+		virtual void   OnTextureResident(TextureID id) = 0;
+		virtual void   DiscardTextureUpload(TUploadDesc& desc) = 0;          // the upload is dropped w/o being recorded: free its CPU data
+	};
+
+	~TextureUploadQueue() { Exit(); }
+
+	void Start(IBackend* pBackend)
+	{
+		mpBackend = pBackend;
+		mbExit.store(false);
+		mThread = std::thread(&TextureUploadQueue::UploadThread_Main, this);
+	}
+
+	// stops the upload thread once the batches in flight are complete, fails the residency of the uploads left in the queue
+	void Exit()
+	{
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			mbExit.store(true);
+		}
+		mCV.notify_all();
+		if (mThread.joinable())
+			mThread.join();
+	}
+
+	void Enqueue(TUploadDesc&& desc)
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mQueue.push(std::move(desc));
+	}
+	inline void StartUploads() { mCV.notify_one(); } // wakes up the upload thread for the queued uploads
+
+	inline size_t GetNumQueued() const { std::lock_guard<std::mutex> lk(mMtx); return mQueue.size(); }
+	inline bool   IsExiting() const { return mbExit.load(); }
+
+private:
+	struct FPendingUpload
+	{
+		uint64    FenceValue = 0; // 0: batch not submitted yet
+		TextureID TexID = INVALID_ID;
+		std::shared_ptr<TextureResidencyPromise> pResidencyPromise;
+	};
+
+	void UploadThread_Main()
+	{
+		std::unique_lock<std::mutex> lk(mMtx);
+		while (true)
+		{
+			mCV.wait(lk, [&]() { return mbExit.load() || !mQueue.empty(); });
+			if (mbExit)
+				break;
+
+			lk.unlock();
+			ProcessQueue();
+			lk.lock();
+		}
+
+		for (; !mQueue.empty(); mQueue.pop())
+			FailUpload(mQueue.front());
+	}
+
+	void ProcessQueue()
+	{
+		std::deque<FPendingUpload> PendingUploads;
+		auto fnSignalCompletedUploads = [&]()
+		{
+			while (!PendingUploads.empty() && PendingUploads.front().FenceValue != 0 && mpBackend->IsTextureUploadBatchComplete(PendingUploads.front().FenceValue))
+			{
+				FPendingUpload& upload = PendingUploads.front();
+				mpBackend->OnTextureResident(upload.TexID);
+				if (upload.pResidencyPromise)
+					upload.pResidencyPromise->SetValue(true); // wake up the threads waiting on texture residency
+				PendingUploads.pop_front();
+			}
+		};
+
+		std::queue<TUploadDesc> UploadQueue;
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			std::swap(UploadQueue, mQueue);
+		}
+
+		uint64 LastFenceValue = 0;
+		while (!UploadQueue.empty())
+		{
+			for (; !UploadQueue.empty(); UploadQueue.pop())
+			{
+				TUploadDesc& desc = UploadQueue.front();
+				if (mbExit)
+				{
+					FailUpload(desc);
+					continue;
+				}
+				if (!mpBackend->RecordTextureUpload(desc))
+				{
+					if (desc.pResidencyPromise) // nothing was recorded for the texture, it never becomes resident
+						desc.pResidencyPromise->SetValue(false);
+					continue;
+				}
+				PendingUploads.push_back({ 0, desc.id, std::move(desc.pResidencyPromise) });
+			}
+
+			if (!PendingUploads.empty() && PendingUploads.back().FenceValue == 0)
+			{
+				LastFenceValue = mpBackend->SubmitTextureUploads();
+				for (auto it = PendingUploads.rbegin(); it != PendingUploads.rend() && it->FenceValue == 0; ++it)
+					it->FenceValue = LastFenceValue;
+			}
+
+			fnSignalCompletedUploads();
+
+			std::lock_guard<std::mutex> lk(mMtx);
+			std::swap(UploadQueue, mQueue);
+		}
+
+		// nothing left to record, wait for the last batch
+		if (!PendingUploads.empty())
+		{
+			mpBackend->WaitForTextureUploadBatch(LastFenceValue);
+			fnSignalCompletedUploads();
+		}
+	}
+
+	void FailUpload(TUploadDesc& desc)
+	{
+		mpBackend->DiscardTextureUpload(desc);
+		if (desc.pResidencyPromise)
+			desc.pResidencyPromise->SetValue(false);
+	}
+
+	IBackend*               mpBackend = nullptr;
+	std::atomic<bool>       mbExit = false;
+	mutable std::mutex      mMtx;
+	std::condition_variable mCV;
+	std::queue<TUploadDesc> mQueue;
+	std::thread             mThread;
+};
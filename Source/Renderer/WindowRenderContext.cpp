@@ -20,6 +20,8 @@
 #include "WindowRenderContext.h"
 #include "../Engine/Core/Window.h"
 
+#include <algorithm>
+
 void FWindowRenderContext::InitializeContext(const Window* pWin, Device* pVQDevice, int NumSwapchainBuffers, bool bVSync, bool bHDRSwapchain)
 {
 	HWND hwnd = pWin->GetHWND();
@@ -90,8 +92,10 @@ void FWindowRenderContext::InitializeContext(const Window* pWin, Device* pVQDevi
 #endif
 
 	// create 1 constant buffer
+	this->mpConstantBufferPagePool = std::make_unique<UploadPagePool>();
+	this->mpConstantBufferPagePool->Create(pDevice, "ConstantBufferPagePool");
 	this->mDynamicHeap_ConstantBuffer.resize(1);
-	this->mDynamicHeap_ConstantBuffer[0].Create(pDevice, NumSwapchainBuffers, 12 * MEGABYTE);
+	this->mDynamicHeap_ConstantBuffer[0].Create(this->mpConstantBufferPagePool.get());
 }
 
 void FWindowRenderContext::CleanupContext()
@@ -113,10 +117,24 @@ void FWindowRenderContext::CleanupContext()
 	for (ID3D12GraphicsCommandList* pCmd : mpCmdGFX    ) if (pCmd) pCmd->Release();
 	for (ID3D12CommandList*         pCmd : mpCmdCompute) if (pCmd) pCmd->Release();
 	for (ID3D12CommandList*         pCmd : mpCmdCopy   ) if (pCmd) pCmd->Release();
+	FDynamicBufferHeapStats HeapStats;
 	for (DynamicBufferHeap& Heap : mDynamicHeap_ConstantBuffer) // per cmd recording thread?
 	{
+		const FDynamicBufferHeapStats& Stats = Heap.GetStats();
+		HeapStats.NumAllocations    += Stats.NumAllocations;
+		HeapStats.NumBytesAllocated += Stats.NumBytesAllocated;
+		HeapStats.NumPaddingBytes   += Stats.NumPaddingBytes;
+		HeapStats.PeakBytesPerFrame += Stats.PeakBytesPerFrame;
 		Heap.Destroy();
 	}
+	const FUploadPagePoolStats PoolStats = mpConstantBufferPagePool->GetStats();
+	const double NumFrames = static_cast<double>(std::max<uint64>(1, mNumConstantBufferFrames));
+	Log::Info("[Renderer] Constant buffers: %u threads, %.2f MB in %u pages (%u dedicated), peak in use %.2f MB | %.1f allocs/frame, %.1f KB/frame (peak %.1f KB), %.1f%% alignment padding"
+		, static_cast<uint>(mDynamicHeap_ConstantBuffer.size())
+		, PoolStats.MemorySize / static_cast<double>(MEGABYTE), PoolStats.NumPages, PoolStats.NumDedicatedPages, PoolStats.PeakMemoryInUse / static_cast<double>(MEGABYTE)
+		, HeapStats.NumAllocations / NumFrames, HeapStats.NumBytesAllocated / NumFrames / KILOBYTE, HeapStats.PeakBytesPerFrame / static_cast<double>(KILOBYTE)
+		, HeapStats.NumBytesAllocated > 0 ? 100.0 * HeapStats.NumPaddingBytes / HeapStats.NumBytesAllocated : 0.0);
+	mpConstantBufferPagePool->Destroy();
 }
 
 void FWindowRenderContext::AllocateCommandLists(CommandQueue::EType eQueueType, size_t NumRecordingThreads)
@@ -179,7 +197,7 @@ void FWindowRenderContext::AllocateCommandLists(CommandQueue::EType eQueueType,
 		}
 	}
 }
-void FWindowRenderContext::AllocateConstantBufferMemory(uint32_t NumHeaps, uint32_t MemoryPerHeap)
+void FWindowRenderContext::AllocateConstantBufferHeaps(uint32_t NumHeaps)
 {
 	const size_t NumAlreadyAllocatedHeaps = mDynamicHeap_ConstantBuffer.size();
 
@@ -187,17 +205,26 @@ void FWindowRenderContext::AllocateConstantBufferMemory(uint32_t NumHeaps, uint3
 	if (NumAlreadyAllocatedHeaps < NumHeaps)
 	{
 		assert(NumAlreadyAllocatedHeaps >= 1);
-		const uint32_t NumBackBuffers = SwapChain.GetNumBackBuffers();
-
 		mDynamicHeap_ConstantBuffer.resize(NumHeaps);
 
 		for (uint32_t iHeap = (uint32_t)NumAlreadyAllocatedHeaps; iHeap < NumHeaps; ++iHeap)
 		{
-			mDynamicHeap_ConstantBuffer[iHeap].Create(pDevice->GetDevicePtr(), NumBackBuffers, MemoryPerHeap);
+			mDynamicHeap_ConstantBuffer[iHeap].Create(mpConstantBufferPagePool.get());
 		}
 	}
 }
 
+void FWindowRenderContext::BeginConstantBufferFrame(uint64 FrameIndex)
+{
+	// frame fences start at 1: the pages used in frame N are reused once frame N+NumBackBuffers begins
+	const uint64 FrameFence = FrameIndex + 1;
+	const uint64 NumFramesInFlight = SwapChain.GetNumBackBuffers();
+	for (DynamicBufferHeap& Heap : mDynamicHeap_ConstantBuffer) // incl. the heaps of the threads not recording this frame
+		Heap.OnBeginFrame(FrameFence);
+	mpConstantBufferPagePool->RecyclePages(FrameFence > NumFramesInFlight ? FrameFence - NumFramesInFlight : 0);
+	++mNumConstantBufferFrames;
+}
+
 void FWindowRenderContext::ResetCommandLists(CommandQueue::EType eQueueType, size_t NumRecordingThreads)
 {
 	assert(eQueueType == CommandQueue::EType::GFX); // Reset() is ID3D12GraphicsCommandList function
@@ -39,6 +39,7 @@
 #include <vector>
 #include <unordered_map>
 #include <array>
+#include <memory>
 #include <queue>
 #include <set>
 
@@ -58,7 +59,9 @@ public:
 	void AllocateCommandLists(CommandQueue::EType eQueueType, size_t NumRecordingThreads);
 	void ResetCommandLists(CommandQueue::EType eQueueType, size_t NumRecordingThreads);
 
-	void AllocateConstantBufferMemory(uint32_t NumHeaps, uint32_t MemoryPerHeap);
+	// per-thread constant buffer heaps, growing on demand from the context's page pool
+	void AllocateConstantBufferHeaps(uint32_t NumHeaps);
+	void BeginConstantBufferFrame(uint64 FrameIndex); // recycles the pages of the frames that are done on the GPU
 	
 	inline DynamicBufferHeap& GetConstantBufferHeap(size_t iThread) { return mDynamicHeap_ConstantBuffer[iThread]; }
 	inline unsigned short     GetNumSwapchainBuffers() const { return SwapChain.GetNumBackBuffers(); }
@@ -105,7 +108,9 @@ private:
 	std::vector<ID3D12CommandList*>         mpCmdCopy;
 	
 	// constant buffers per recording thread
+	std::unique_ptr<UploadPagePool> mpConstantBufferPagePool; // stable address for the heaps when the context is moved
 	std::vector<DynamicBufferHeap> mDynamicHeap_ConstantBuffer;
+	uint64                         mNumConstantBufferFrames = 0;
 
 	UINT mNumCurrentlyRecordingThreads[CommandQueue::EType::NUM_COMMAND_QUEUE_TYPES];
 };
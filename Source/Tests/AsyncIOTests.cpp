@@ -0,0 +1,322 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/AsyncIO.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/Timer.h"
+#include "Libs/VQUtils/Source/Multithreading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+static std::vector<std::string> WriteTestFiles(const std::string& Directory, uint NumFiles)
+{
+	std::vector<std::string> Files;
+	for (uint i = 0; i < NumFiles; ++i)
+	{
+		const std::string FilePath = Directory + "File" + std::to_string(i) + ".bin";
+		std::vector<uint8> Data(1024 * (i + 1));
+		for (size_t j = 0; j < Data.size(); ++j)
+			Data[j] = static_cast<uint8>(i + j);
+		std::ofstream File(FilePath, std::ios::binary);
+		File.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+		Files.push_back(FilePath);
+	}
+	return Files;
+}
+
+static bool HasTestFileContents(const FFileData& Data, uint iFile)
+{
+	if (!Data.IsValid() || Data.Size != 1024 * (iFile + 1))
+		return false;
+	for (size_t j = 0; j < Data.Size; ++j)
+		if (Data.pData[j] != static_cast<uint8>(iFile + j))
+			return false;
+	return true;
+}
+
+VQ_TEST(AsyncIO_ReadsWithEachBackend)
+{
+	constexpr uint NUM_FILES = 16;
+	const std::vector<std::string> Files = WriteTestFiles(Tests::CreateTempDirectory("AsyncIO"), NUM_FILES);
+
+	for (int iBackend = 0; iBackend < static_cast<int>(EAsyncIOBackend::NUM_ASYNC_IO_BACKENDS); ++iBackend)
+	{
+		AsyncIOService IO;
+		IO.Initialize(static_cast<EAsyncIOBackend>(iBackend), 2, 4);
+
+		std::mutex Mtx;
+		std::vector<int> NumCallbacks(NUM_FILES + 1, 0);
+		std::vector<bool> bContentsMatch(NUM_FILES + 1, false);
+		std::vector<FAsyncReadDesc> Reads(NUM_FILES + 1);
+		for (uint i = 0; i <= NUM_FILES; ++i)
+		{
+			Reads[i].FilePath = i < NUM_FILES ? Files[i] : Files[0] + ".missing";
+			Reads[i].Priority = static_cast<EAsyncIOPriority>(i % static_cast<uint>(EAsyncIOPriority::NUM_ASYNC_IO_PRIORITIES));
+			Reads[i].Callback = [&, i](FAsyncReadResult&& Result)
+			{
+				std::lock_guard<std::mutex> lk(Mtx);
+				++NumCallbacks[i];
+				bContentsMatch[i] = i < NUM_FILES ? HasTestFileContents(Result.Data, i) : !Result.Data.IsValid();
+			};
+		}
+		IO.ReadBatch(std::move(Reads));
+		IO.WaitIdle();
+		VQ_CHECK(IO.IsIdle());
+
+		for (uint i = 0; i <= NUM_FILES; ++i)
+		{
+			VQ_CHECK(NumCallbacks[i] == 1);
+			VQ_CHECK(bContentsMatch[i]);
+		}
+		const FAsyncIOStats Stats = IO.GetStats();
+		VQ_CHECK(Stats.NumRequests == NUM_FILES + 1);
+		VQ_CHECK(Stats.NumCompleted == NUM_FILES);
+		VQ_CHECK(Stats.NumFailed == 1);
+		VQ_CHECK(Stats.NumCancelled == 0);
+		IO.Exit();
+	}
+}
+
+VQ_TEST(AsyncIO_ExitCompletesEveryRequestOnce)
+{
+	constexpr uint NUM_FILES = 8;
+	constexpr uint NUM_READS = 256;
+	const std::vector<std::string> Files = WriteTestFiles(Tests::CreateTempDirectory("AsyncIO_Exit"), NUM_FILES);
+
+	for (int iBackend = 0; iBackend < static_cast<int>(EAsyncIOBackend::NUM_ASYNC_IO_BACKENDS); ++iBackend)
+	{
+		std::atomic<uint> NumCallbacks = 0;
+		std::atomic<uint> NumInvalid = 0; // read, but w/ the wrong contents
+		{
+			AsyncIOService IO;
+			IO.Initialize(static_cast<EAsyncIOBackend>(iBackend), 1, 2);
+
+			std::vector<AsyncReadHandle_t> Handles;
+			for (uint i = 0; i < NUM_READS; ++i)
+			{
+				Handles.push_back(IO.Read(Files[i % NUM_FILES], EAsyncIOPriority::NORMAL, [&, i](FAsyncReadResult&& Result)
+				{
+					if (!Result.bCancelled && !HasTestFileContents(Result.Data, i % NUM_FILES))
+						++NumInvalid;
+					++NumCallbacks;
+				}));
+			}
+			IO.Cancel(Handles.back());
+			IO.Exit(); // cancels the queued reads, waits for the ones in flight
+		}
+		VQ_CHECK(NumCallbacks == NUM_READS);
+		VQ_CHECK(NumInvalid == 0);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+static uint64 HashFileData(const FFileData& Data)
+{
+	// FNV-1a 64, same as the texture cache
+	uint64 Hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < Data.Size; ++i)
+	{
+		Hash ^= Data.pData[i];
+		Hash *= 0x100000001b3ull;
+	}
+	return Hash;
+}
+
+static std::vector<std::string> GatherTextureFiles(uint NumFiles)
+{
+	static const char* TEXTURE_EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr", ".dds" };
+
+	std::vector<std::string> Files;
+	std::error_code ec;
+	for (const std::filesystem::directory_entry& Entry : std::filesystem::recursive_directory_iterator("Data/Textures", ec))
+	{
+		if (!Entry.is_regular_file())
+			continue;
+		std::string Extension = Entry.path().extension().string();
+		std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+		if (std::find(std::begin(TEXTURE_EXTENSIONS), std::end(TEXTURE_EXTENSIONS), Extension) != std::end(TEXTURE_EXTENSIONS))
+			Files.push_back(Entry.path().generic_string());
+	}
+	std::sort(Files.begin(), Files.end());
+	if (NumFiles > 0 && Files.size() > NumFiles)
+		Files.resize(NumFiles);
+	return Files;
+}
+
+struct FBenchmarkPassResult
+{
+	float  Seconds  = 0.0f;
+	uint64 Bytes    = 0;
+	uint64 Checksum = 0; // sum of the file hashes: order independent
+};
+
+static FBenchmarkPassResult RunSyncPass(const std::vector<std::string>& Files, uint NumThreads)
+{
+	ThreadPool Workers;
+	Workers.Initialize(NumThreads, "AsyncIOBenchmark_Sync");
+
+	std::atomic<uint64> Bytes = 0;
+	std::atomic<uint64> Checksum = 0;
+	Timer t; t.Start();
+	{
+		std::vector<std::future<void>> Results;
+		Results.reserve(Files.size());
+		for (const std::string& FilePath : Files)
+		{
+			Results.push_back(Workers.AddTask([&, FilePath]()
+			{
+				std::ifstream file(FilePath, std::ios::binary | std::ios::ate);
+				if (!file.is_open())
+					return;
+
+				FFileData Data;
+				std::shared_ptr<std::vector<uint8>> pBuffer = std::make_shared<std::vector<uint8>>(std::max<size_t>(1, static_cast<size_t>(file.tellg())));
+				file.seekg(0, std::ios::beg);
+				file.read(reinterpret_cast<char*>(pBuffer->data()), pBuffer->size());
+				Data.pData = pBuffer->data();
+				Data.Size = static_cast<size_t>(file.gcount());
+				Data.pOwner = pBuffer;
+
+				Bytes += Data.Size;
+				Checksum += HashFileData(Data);
+			}));
+		}
+		for (std::future<void>& Result : Results)
+			Result.wait();
+	}
+	FBenchmarkPassResult Result;
+	Result.Seconds  = t.StopGetDeltaTimeAndReset();
+	Result.Bytes    = Bytes;
+	Result.Checksum = Checksum;
+
+	Workers.Exit();
+	return Result;
+}
+
+static FBenchmarkPassResult RunAsyncPass(const std::vector<std::string>& Files, uint NumThreads, EAsyncIOBackend Backend)
+{
+	// split the thread budget between the I/O and the hashing
+	const uint NumIOThreads = Backend == EAsyncIOBackend::OVERLAPPED ? 1 : std::max(1u, NumThreads / 2);
+	const uint NumWorkers   = std::max(1u, NumThreads - NumIOThreads);
+
+	ThreadPool Workers;
+	Workers.Initialize(NumWorkers, "AsyncIOBenchmark_Async");
+	AsyncIOService IO;
+	IO.Initialize(Backend, NumIOThreads);
+
+	std::atomic<uint64> Bytes = 0;
+	std::atomic<uint64> Checksum = 0;
+	std::mutex MtxDone;
+	std::condition_variable CVDone;
+	size_t NumDone = 0;
+
+	Timer t; t.Start();
+	{
+		std::vector<FAsyncReadDesc> Reads(Files.size());
+		for (size_t i = 0; i < Files.size(); ++i)
+		{
+			Reads[i].FilePath = Files[i];
+			Reads[i].Callback = [&](FAsyncReadResult&& Result)
+			{
+				Workers.AddTask([&, Data = std::move(Result.Data)]()
+				{
+					Bytes += Data.Size;
+					Checksum += Data.IsValid() ? HashFileData(Data) : 0;
+
+					std::lock_guard<std::mutex> lk(MtxDone);
+					if (++NumDone == Files.size())
+						CVDone.notify_all();
+				});
+			};
+		}
+		IO.ReadBatch(std::move(Reads));
+
+		std::unique_lock<std::mutex> lk(MtxDone);
+		CVDone.wait(lk, [&]() { return NumDone == Files.size(); });
+	}
+	FBenchmarkPassResult Result;
+	Result.Seconds  = t.StopGetDeltaTimeAndReset();
+	Result.Bytes    = Bytes;
+	Result.Checksum = Checksum;
+
+	IO.Exit();
+	Workers.Exit();
+	return Result;
+}
+
+// Loads NumFiles texture files (or all the textures under Data/Textures if 0) with a budget of NumThreads:
+//  - Sync  : NumThreads workers each read (std::ifstream) & hash a file, which is what the texture loaders did
+//  - Async : AsyncIOService reads, workers hash on completion. OVERLAPPED: 1 I/O thread + NumThreads-1 workers,
+//            THREAD_POOL: NumThreads/2 I/O threads + the rest as workers
+// and logs the timings. The hashing stands in for the CPU side of the texture loads.
+static void BenchmarkTextureReads(uint NumFiles, uint NumThreads)
+{
+	const std::vector<std::string> Files = GatherTextureFiles(NumFiles);
+	if (Files.empty())
+	{
+		Log::Warning("  no texture files found under Data/Textures");
+		return;
+	}
+	NumThreads = std::max(2u, NumThreads);
+
+	auto fnLogPass = [](const char* pName, const FBenchmarkPassResult& r)
+	{
+		const float MB = r.Bytes / (1024.0f * 1024.0f);
+		Log::Info("  %-28s: %7.3fs (%8.1f MB/s)", pName, r.Seconds, r.Seconds > 0.0f ? MB / r.Seconds : 0.0f);
+	};
+
+	// the first pass pulls the files into the OS file cache, the rest measure the warm reads
+	const FBenchmarkPassResult Cold       = RunSyncPass(Files, NumThreads);
+	const FBenchmarkPassResult Sync       = RunSyncPass(Files, NumThreads);
+	const FBenchmarkPassResult Overlapped = RunAsyncPass(Files, NumThreads, EAsyncIOBackend::OVERLAPPED);
+	const FBenchmarkPassResult Pool       = RunAsyncPass(Files, NumThreads, EAsyncIOBackend::THREAD_POOL);
+
+	Log::Info("  %zu textures (%.2f MB), %u threads%s", Files.size(), Sync.Bytes / (1024.0f * 1024.0f), NumThreads
+		, VirtualFileSystem::IsAnyPakFileMounted() ? " (pak file mounted: async reads of packed files are served from the mapping)" : "");
+	fnLogPass("Sync (cold)", Cold);
+	fnLogPass("Sync", Sync);
+	fnLogPass("Async (overlapped)", Overlapped);
+	fnLogPass("Async (thread pool)", Pool);
+
+	if (Overlapped.Checksum != Sync.Checksum || Pool.Checksum != Sync.Checksum)
+	{
+		Log::Error("  checksum mismatch: sync=%016llx overlapped=%016llx thread_pool=%016llx", Sync.Checksum, Overlapped.Checksum, Pool.Checksum);
+	}
+}
+
+VQ_BENCHMARK(AsyncIO)
+{
+	const uint NumThreads = static_cast<uint>(ThreadPool::sHardwareThreadCount / 2); // fixed budget: number of cores
+	BenchmarkTextureReads(0, NumThreads);
+}
@@ -0,0 +1,132 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/NullBackend.h"
+
+using namespace HAL;
+
+static constexpr PSO_ID PSO_A = 1;
+static constexpr PSO_ID PSO_B = 2;
+static constexpr int    ROOT_SIGNATURE = 5;
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(CommandList_FiltersRedundantState)
+{
+	NullCommandList Cmd;
+	VQ_CHECK(Cmd.GetBackend() == EBackend::NULL_BACKEND);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		Cmd.SetPipelineState(PSO_A);
+		Cmd.SetGraphicsRootSignature(ROOT_SIGNATURE);
+		Cmd.SetGraphicsRootConstantBufferView(1, 0x10000);
+		Cmd.SetGraphicsRootDescriptorTable(0, 7);
+		Cmd.SetPrimitiveTopology(EPrimitiveTopology::TRIANGLE_LIST);
+		Cmd.SetVertexBuffer(3);
+		Cmd.SetIndexBuffer(4);
+		Cmd.DrawIndexedInstanced(36, 1);
+	}
+
+	const FCommandListStats& Stats = Cmd.GetStats();
+	VQ_CHECK(Stats.NumDrawCalls == 3);
+	VQ_CHECK(Stats.NumIndices == 3 * 36);
+	VQ_CHECK(Stats.NumPipelineStateChanges == 1);
+	VQ_CHECK(Stats.NumRootSignatureChanges == 1);
+	VQ_CHECK(Stats.NumConstantBufferViewBinds == 1);
+	VQ_CHECK(Stats.NumDescriptorTableBinds == 1);
+	VQ_CHECK(Stats.NumTopologyChanges == 1);
+	VQ_CHECK(Stats.NumVertexBufferBinds == 1);
+	VQ_CHECK(Stats.NumIndexBufferBinds == 1);
+	VQ_CHECK(Stats.GetNumStateChanges() == 7);
+	VQ_CHECK(Stats.NumRedundantStateChanges == 2 * 7);
+}
+
+VQ_TEST(CommandList_ChangedStateReachesTheBackend)
+{
+	NullCommandList Cmd;
+	Cmd.SetGraphicsRootSignature(ROOT_SIGNATURE);
+	Cmd.SetPipelineState(PSO_A);
+	Cmd.SetPipelineState(PSO_A, 1);  // same PSO, another permutation
+	Cmd.SetPipelineState(PSO_B, 1);
+	Cmd.SetGraphicsRootDescriptorTable(0, 7);
+	Cmd.SetGraphicsRootDescriptorTable(0, 7, 1); // same SRV, another descriptor
+	Cmd.SetGraphicsRootDescriptorTable(1, 7);    // same SRV, another root parameter
+	Cmd.SetVertexBuffer(3);
+	Cmd.SetVertexBuffer(5);
+
+	const FCommandListStats& Stats = Cmd.GetStats();
+	VQ_CHECK(Stats.NumPipelineStateChanges == 3);
+	VQ_CHECK(Stats.NumDescriptorTableBinds == 3);
+	VQ_CHECK(Stats.NumVertexBufferBinds == 2);
+	VQ_CHECK(Stats.NumRedundantStateChanges == 0);
+}
+
+VQ_TEST(CommandList_RootSignatureChangeInvalidatesTheRootArguments)
+{
+	NullCommandList Cmd;
+	Cmd.SetPipelineState(PSO_A);
+	Cmd.SetGraphicsRootSignature(ROOT_SIGNATURE);
+	Cmd.SetGraphicsRootConstantBufferView(1, 0x10000);
+	Cmd.SetGraphicsRootDescriptorTable(0, 7);
+
+	Cmd.SetGraphicsRootSignature(ROOT_SIGNATURE + 1);
+	Cmd.SetGraphicsRootConstantBufferView(1, 0x10000);
+	Cmd.SetGraphicsRootDescriptorTable(0, 7);
+
+	// a CBV & a table can't share a root parameter: binding one forgets the other
+	Cmd.SetGraphicsRootDescriptorTable(1, 7);
+	Cmd.SetGraphicsRootConstantBufferView(1, 0x10000);
+
+	const FCommandListStats& Stats = Cmd.GetStats();
+	VQ_CHECK(Stats.NumRootSignatureChanges == 2);
+	VQ_CHECK(Stats.NumConstantBufferViewBinds == 3);
+	VQ_CHECK(Stats.NumDescriptorTableBinds == 3);
+	VQ_CHECK(Stats.NumRedundantStateChanges == 0);
+}
+
+VQ_TEST(CommandList_UnfilteredAndReset)
+{
+	NullCommandList Cmd;
+	Cmd.SetStateFiltering(false);
+	Cmd.SetPipelineState(PSO_A);
+	Cmd.SetPipelineState(PSO_A);
+	Cmd.SetVertexBuffer(3);
+	Cmd.SetVertexBuffer(3);
+	VQ_CHECK(Cmd.GetStats().NumPipelineStateChanges == 2);
+	VQ_CHECK(Cmd.GetStats().NumVertexBufferBinds == 2);
+	VQ_CHECK(Cmd.GetStats().NumRedundantStateChanges == 0);
+
+	// a reset list knows nothing of the previous recording's state
+	Cmd.SetStateFiltering(true);
+	Cmd.Reset();
+	VQ_CHECK(Cmd.GetStats().GetNumStateChanges() == 0);
+	Cmd.SetPipelineState(PSO_A);
+	Cmd.SetVertexBuffer(3);
+	VQ_CHECK(Cmd.GetStats().NumPipelineStateChanges == 1);
+	VQ_CHECK(Cmd.GetStats().NumVertexBufferBinds == 1);
+
+	FCommandListStats Total;
+	Total += Cmd.GetStats();
+	Total += Cmd.GetStats();
+	VQ_CHECK(Total.GetNumStateChanges() == 4);
+}
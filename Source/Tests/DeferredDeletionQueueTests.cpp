@@ -0,0 +1,177 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/DeferredDeletionQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// CPU stand-in for the GPU side of the frame fence: the GPU finishes the submitted frames NumFramesInFlight
+// frames later, like the swapchain lets it.
+struct FFakeFrameFence
+{
+	FrameFenceTracker Tracker;
+	uint64 CompletedValue = 0;
+	uint   NumFramesInFlight = 2;
+
+	void SubmitFrame()
+	{
+		const uint64 Signaled = Tracker.OnFrameSubmitted();
+		if (Signaled > NumFramesInFlight)
+			CompletedValue = Signaled - NumFramesInFlight;
+	}
+	void FlushGPU() { CompletedValue = Tracker.GetLastSubmittedFrameFence(); }
+};
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(FrameFenceTracker_RecordingFrameIsTheNextSubmit)
+{
+	FrameFenceTracker Fences;
+	VQ_CHECK(Fences.GetLastSubmittedFrameFence() == 0);
+	VQ_CHECK(Fences.GetRecordingFrameFence() == 1);
+	VQ_CHECK(Fences.OnFrameSubmitted() == 1);
+	VQ_CHECK(Fences.GetRecordingFrameFence() == 2);
+	VQ_CHECK(Fences.OnFrameSubmitted() == 2);
+	VQ_CHECK(Fences.GetLastSubmittedFrameFence() == 2);
+}
+
+VQ_TEST(DeferredDeletionQueue_ReleasesOnceTheRecordingFrameCompletes)
+{
+	FFakeFrameFence Fence;
+	DeferredDeletionQueue Queue;
+	bool bReleased = false;
+
+	// destroyed while frame 1 is recorded: frame 1 might reference the resource
+	const uint64 SafeAfter = Fence.Tracker.GetRecordingFrameFence();
+	Queue.Enqueue(SafeAfter, [&]() { bReleased = true; });
+
+	for (uint iFrame = 0; iFrame < 8; ++iFrame)
+	{
+		Queue.Process(Fence.CompletedValue, 1000.0f);
+		VQ_CHECK(bReleased == (Fence.CompletedValue >= SafeAfter));
+		Fence.SubmitFrame();
+	}
+	VQ_CHECK(bReleased);
+	VQ_CHECK(Queue.GetStats().NumPending == 0);
+}
+
+VQ_TEST(DeferredDeletionQueue_NeverReleasesAFrameInFlight)
+{
+	FFakeFrameFence Fence;
+	Fence.NumFramesInFlight = 3;
+	DeferredDeletionQueue Queue;
+
+	// one resource per frame, each remembers the fence it was destroyed at
+	constexpr uint NUM_FRAMES = 64;
+	std::vector<uint64> ReleasedAtCompletedValue(NUM_FRAMES, 0);
+	std::vector<uint64> DestroyedAtRecordingFence(NUM_FRAMES, 0);
+	for (uint iFrame = 0; iFrame < NUM_FRAMES; ++iFrame)
+	{
+		Queue.Process(Fence.CompletedValue, 1000.0f);
+
+		DestroyedAtRecordingFence[iFrame] = Fence.Tracker.GetRecordingFrameFence();
+		Queue.Enqueue(DestroyedAtRecordingFence[iFrame], [&, iFrame]() { ReleasedAtCompletedValue[iFrame] = Fence.CompletedValue; });
+
+		Fence.SubmitFrame();
+	}
+	Fence.FlushGPU();
+	Queue.Process(Fence.CompletedValue, 1000.0f);
+
+	for (uint iFrame = 0; iFrame < NUM_FRAMES; ++iFrame)
+		VQ_CHECK(ReleasedAtCompletedValue[iFrame] >= DestroyedAtRecordingFence[iFrame]);
+	VQ_CHECK(Queue.GetStats().NumReleased == NUM_FRAMES);
+}
+
+VQ_TEST(DeferredDeletionQueue_AtLeastOneReleasePerCall)
+{
+	DeferredDeletionQueue Queue;
+	uint NumReleased = 0;
+	for (int i = 0; i < 3; ++i)
+		Queue.Enqueue(1, [&]() { ++NumReleased; std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+
+	VQ_CHECK(Queue.Process(0, 0.0f) == 0); // nothing completed
+	VQ_CHECK(Queue.Process(1, 0.0f) == 1); // over the budget after the first
+	VQ_CHECK(Queue.GetStats().NumBudgetOverruns == 1);
+	VQ_CHECK(Queue.Process(1, 1000.0f) == 2);
+	VQ_CHECK(NumReleased == 3);
+}
+
+VQ_TEST(DeferredDeletionQueue_ReleaseAllIgnoresTheFence)
+{
+	DeferredDeletionQueue Queue;
+	uint NumReleased = 0;
+	Queue.Enqueue(100, [&]() { ++NumReleased; });
+	Queue.Enqueue(200, [&]() { ++NumReleased; });
+	VQ_CHECK(Queue.ReleaseAll() == 2);
+	VQ_CHECK(NumReleased == 2);
+	VQ_CHECK(Queue.GetStats().NumPending == 0);
+}
+
+// worker threads destroy resources while the render thread submits frames & drains the queue
+VQ_TEST(DeferredDeletionQueue_ConcurrentDestroys)
+{
+	constexpr uint NUM_THREADS = 4;
+	constexpr uint NUM_DESTROYS_PER_THREAD = 2000;
+	constexpr uint NUM_FRAMES_IN_FLIGHT = 2;
+
+	FrameFenceTracker Tracker;
+	std::atomic<uint64> CompletedValue{ 0 };
+	DeferredDeletionQueue Queue;
+	std::atomic<uint> NumEarlyReleases{ 0 };
+	std::atomic<uint> NumReleased{ 0 };
+
+	std::vector<std::thread> Threads;
+	for (uint t = 0; t < NUM_THREADS; ++t)
+	{
+		Threads.emplace_back([&]()
+		{
+			for (uint i = 0; i < NUM_DESTROYS_PER_THREAD; ++i)
+			{
+				const uint64 SafeAfter = Tracker.GetRecordingFrameFence();
+				Queue.Enqueue(SafeAfter, [&, SafeAfter]()
+				{
+					if (CompletedValue.load() < SafeAfter)
+						NumEarlyReleases.fetch_add(1);
+					NumReleased.fetch_add(1);
+				});
+			}
+		});
+	}
+
+	constexpr uint TOTAL = NUM_THREADS * NUM_DESTROYS_PER_THREAD;
+	while (NumReleased.load() < TOTAL)
+	{
+		Queue.Process(CompletedValue.load(), 0.5f);
+		const uint64 Signaled = Tracker.OnFrameSubmitted();
+		if (Signaled > NUM_FRAMES_IN_FLIGHT)
+			CompletedValue.store(Signaled - NUM_FRAMES_IN_FLIGHT);
+	}
+	for (std::thread& Thread : Threads)
+		Thread.join();
+
+	VQ_CHECK(NumEarlyReleases.load() == 0);
+	VQ_CHECK(Queue.GetStats().NumReleased == TOTAL);
+	VQ_CHECK(Queue.GetStats().NumPending == 0);
+}
@@ -0,0 +1,232 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/DescriptorAllocator.h"
+#include "Source/Renderer/DeferredDeletionQueue.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(DescriptorRangeAllocator_RandomizedAllocations)
+{
+	constexpr uint32 NUM_DESCRIPTORS = 4096;
+	DescriptorRangeAllocator Ranges;
+	Ranges.Initialize(NUM_DESCRIPTORS);
+
+	struct FAllocation { uint32 Offset, Count; };
+	std::vector<FAllocation> Allocations;
+	std::vector<bool> bInUse(NUM_DESCRIPTORS, false);
+	uint32 NumInUse = 0;
+
+	std::mt19937 Rng(42);
+	for (int i = 0; i < 50000; ++i)
+	{
+		if (Allocations.empty() || Rng() % 2)
+		{
+			const uint32 Count = (Rng() % 4 == 0) ? 1 + Rng() % 64 : 1;
+			const uint32 Offset = Ranges.Allocate(Count);
+			if (Offset == DescriptorRangeAllocator::INVALID_OFFSET)
+			{
+				VQ_CHECK(Ranges.GetLargestFreeRange() < Count);
+				continue;
+			}
+			VQ_CHECK(Offset + Count <= NUM_DESCRIPTORS);
+			for (uint32 d = Offset; d < Offset + Count; ++d)
+			{
+				VQ_CHECK(!bInUse[d]);
+				bInUse[d] = true;
+			}
+			NumInUse += Count;
+			Allocations.push_back({ Offset, Count });
+		}
+		else
+		{
+			const size_t iAlloc = Rng() % Allocations.size();
+			const FAllocation Alloc = Allocations[iAlloc];
+			Allocations[iAlloc] = Allocations.back();
+			Allocations.pop_back();
+			VQ_CHECK(Ranges.Free(Alloc.Offset) == Alloc.Count);
+			for (uint32 d = Alloc.Offset; d < Alloc.Offset + Alloc.Count; ++d)
+				bInUse[d] = false;
+			NumInUse -= Alloc.Count;
+		}
+		VQ_CHECK(Ranges.GetNumFree() == NUM_DESCRIPTORS - NumInUse);
+	}
+
+	for (const FAllocation& Alloc : Allocations)
+		Ranges.Free(Alloc.Offset);
+	VQ_CHECK(Ranges.GetNumFree() == NUM_DESCRIPTORS);
+	VQ_CHECK(Ranges.GetNumFreeRanges() == 1); // fully coalesced
+	VQ_CHECK(Ranges.GetLargestFreeRange() == NUM_DESCRIPTORS);
+}
+
+VQ_TEST(DescriptorAllocator_FreeWaitsForTheRecordingFrame)
+{
+	FrameFenceTracker Fences;
+	DescriptorAllocator Allocator;
+	Allocator.Initialize(4, 0, &Fences);
+	uint32 Offsets[4];
+	for (uint32& Offset : Offsets)
+		Offset = Allocator.Allocate(1);
+
+	Allocator.Free(Offsets[0], 1); // while frame 1 is recorded
+	Allocator.ReleaseCompletedFrees(0);
+	VQ_CHECK(Allocator.Allocate(1) == DescriptorAllocator::INVALID_OFFSET);
+	VQ_CHECK(Allocator.GetStats().NumPendingFree == 1);
+
+	Fences.OnFrameSubmitted();
+	Allocator.ReleaseCompletedFrees(0); // frame 1 is still on the GPU
+	VQ_CHECK(Allocator.Allocate(1) == DescriptorAllocator::INVALID_OFFSET);
+
+	Allocator.ReleaseCompletedFrees(1);
+	VQ_CHECK(Allocator.Allocate(1) == Offsets[0]);
+}
+
+VQ_TEST(DescriptorAllocator_FreeAfterTheSubmitWaitsForTheNextFrame)
+{
+	// A view destroyed after frame 1 is submitted but before the render thread starts frame 2
+	// might be referenced by frame 2: it can't be recycled once frame 1 completes.
+	FrameFenceTracker Fences;
+	DescriptorAllocator Allocator;
+	Allocator.Initialize(1, 0, &Fences);
+	const uint32 Offset = Allocator.Allocate(1);
+
+	Allocator.ReleaseCompletedFrees(0); // start of frame 1
+	Fences.OnFrameSubmitted();          // frame 1 submitted
+	Allocator.Free(Offset, 1);
+
+	Allocator.ReleaseCompletedFrees(1); // start of frame 2, frame 1 is done on the GPU
+	VQ_CHECK(Allocator.Allocate(1) == DescriptorAllocator::INVALID_OFFSET);
+	Fences.OnFrameSubmitted();
+	Allocator.ReleaseCompletedFrees(2);
+	VQ_CHECK(Allocator.Allocate(1) == Offset);
+}
+
+VQ_TEST(DescriptorAllocator_ConcurrentAllocationsAndFrees)
+{
+	constexpr uint32 NUM_DESCRIPTORS = 2048;
+	constexpr uint32 NUM_FRAMES_IN_FLIGHT = 2;
+	constexpr int    NUM_WORKERS = 6;
+	constexpr int    NUM_ITERATIONS = 20000;
+
+	FrameFenceTracker Fences;
+	std::atomic<uint64> CompletedFrameFence{ 0 };
+	DescriptorAllocator Allocator;
+	Allocator.Initialize(NUM_DESCRIPTORS, 16, &Fences);
+
+	// per descriptor: the worker owning it & the recording frame when it was last freed
+	std::unique_ptr<std::atomic<int>[]>    Owners(new std::atomic<int>[NUM_DESCRIPTORS]);
+	std::unique_ptr<std::atomic<uint64>[]> FreedAtFence(new std::atomic<uint64>[NUM_DESCRIPTORS]);
+	for (uint32 i = 0; i < NUM_DESCRIPTORS; ++i)
+	{
+		Owners[i] = 0;
+		FreedAtFence[i] = 0;
+	}
+	std::atomic<int> NumOverlaps{ 0 };
+	std::atomic<int> NumEarlyRecycles{ 0 };
+	std::atomic<int> NumWorkersDone{ 0 };
+
+	// render thread: recycles the completed frees & submits frames, the GPU lags NUM_FRAMES_IN_FLIGHT frames behind
+	std::thread RenderThread([&]()
+	{
+		while (NumWorkersDone.load() < NUM_WORKERS)
+		{
+			Allocator.ReleaseCompletedFrees(CompletedFrameFence.load());
+			const uint64 Submitted = Fences.OnFrameSubmitted();
+			if (Submitted > NUM_FRAMES_IN_FLIGHT)
+				CompletedFrameFence.store(Submitted - NUM_FRAMES_IN_FLIGHT);
+			std::this_thread::yield();
+		}
+	});
+
+	std::vector<std::thread> Workers;
+	for (int iWorker = 1; iWorker <= NUM_WORKERS; ++iWorker)
+	{
+		Workers.emplace_back([&, iWorker]()
+		{
+			struct FAllocation { uint32 Offset, Count; };
+			std::vector<FAllocation> Allocations;
+			std::mt19937 Rng(iWorker);
+			auto fnFree = [&](const FAllocation& Alloc)
+			{
+				for (uint32 d = Alloc.Offset; d < Alloc.Offset + Alloc.Count; ++d)
+				{
+					FreedAtFence[d].store(Fences.GetRecordingFrameFence());
+					Owners[d].store(0);
+				}
+				Allocator.Free(Alloc.Offset, Alloc.Count);
+			};
+
+			for (int i = 0; i < NUM_ITERATIONS; ++i)
+			{
+				if (Allocations.size() < 32 && Rng() % 2)
+				{
+					const uint32 Count = (Rng() % 8 == 0) ? 1 + Rng() % 16 : 1; // mostly SRVs, some tables
+					const uint32 Offset = Allocator.Allocate(Count);
+					if (Offset == DescriptorAllocator::INVALID_OFFSET)
+						continue;
+					const uint64 Completed = CompletedFrameFence.load();
+					for (uint32 d = Offset; d < Offset + Count; ++d)
+					{
+						int NoOwner = 0;
+						if (!Owners[d].compare_exchange_strong(NoOwner, iWorker))
+							NumOverlaps.fetch_add(1);
+						if (FreedAtFence[d].load() > Completed)
+							NumEarlyRecycles.fetch_add(1);
+					}
+					Allocations.push_back({ Offset, Count });
+				}
+				else if (!Allocations.empty())
+				{
+					const size_t iAlloc = Rng() % Allocations.size();
+					fnFree(Allocations[iAlloc]);
+					Allocations[iAlloc] = Allocations.back();
+					Allocations.pop_back();
+				}
+			}
+			for (const FAllocation& Alloc : Allocations)
+				fnFree(Alloc);
+			NumWorkersDone.fetch_add(1);
+		});
+	}
+	for (std::thread& t : Workers)
+		t.join();
+	RenderThread.join();
+
+	VQ_CHECK(NumOverlaps.load() == 0);
+	VQ_CHECK(NumEarlyRecycles.load() == 0);
+
+	// GPU idle: everything comes back & coalesces
+	Allocator.ReleaseCompletedFrees(Fences.GetRecordingFrameFence());
+	Allocator.FlushThreadCaches();
+	const FDescriptorAllocatorStats Stats = Allocator.GetStats();
+	VQ_CHECK(Stats.NumAllocated == 0);
+	VQ_CHECK(Stats.NumPendingFree == 0);
+	VQ_CHECK(Stats.NumCached == 0);
+	VQ_CHECK(Stats.NumFree == NUM_DESCRIPTORS);
+	VQ_CHECK(Stats.NumFreeRanges == 1);
+}
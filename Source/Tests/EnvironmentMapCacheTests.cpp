@@ -0,0 +1,233 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/EnvironmentMapCache.h"
+#include "Source/Renderer/ImageProcessing.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace ImageProcessing;
+
+constexpr float PI_F = 3.14159265358979f;
+
+using Radiance_t = std::function<void(const float Direction[3], float OutRGB[3])>;
+
+// texel centers of the equirect, the inverse of DirectionToEquirectUV() in ShadingMath.hlsl
+static std::vector<float> CreateEquirect(uint Width, uint Height, const Radiance_t& fnRadiance)
+{
+	std::vector<float> Texels(size_t(Width) * Height * 4);
+	for (uint y = 0; y < Height; ++y)
+	for (uint x = 0; x < Width; ++x)
+	{
+		const float Phi      = (0.5f - (x + 0.5f) / Width) * 2.0f * PI_F;
+		const float Latitude = ((y + 0.5f) / Height - 0.5f) * PI_F;
+		const float Direction[3] = { std::cos(Phi) * std::cos(Latitude), -std::sin(Latitude), std::sin(Phi) * std::cos(Latitude) };
+		float* pTexel = &Texels[(size_t(y) * Width + x) * 4];
+		fnRadiance(Direction, pTexel);
+		pTexel[3] = 1.0f;
+	}
+	return Texels;
+}
+
+// R: constant, G & B: linear in Y & X. Bands 0 & 1 only, so the SH9 projection is exact.
+constexpr float CONSTANT = 2.0f;
+constexpr float SLOPE    = 0.5f;
+static void LinearRadiance(const float d[3], float OutRGB[3])
+{
+	OutRGB[0] = CONSTANT;
+	OutRGB[1] = CONSTANT + SLOPE * d[1];
+	OutRGB[2] = CONSTANT + SLOPE * d[0];
+}
+
+static FEnvironmentMapCacheSettings GetTestSettings()
+{
+	FEnvironmentMapCacheSettings Settings;
+	Settings.EquirectWidth       = 128;
+	Settings.EquirectHeight      = 64;
+	Settings.DiffuseCubemapSize  = 8;
+	Settings.SpecularCubemapSize = 32;
+	Settings.SpecularMipCount    = 4;
+	Settings.SpecularSampleCount = 64;
+	Settings.DiffuseSourceMip    = 0;
+	return Settings;
+}
+
+static std::vector<float> DecodeMip(const FCookedTexture& Tex, uint Mip, uint Face)
+{
+	const uint W = std::max(1u, Tex.Width >> Mip);
+	const uint H = std::max(1u, Tex.Height >> Mip);
+	std::vector<float> Texels(size_t(W) * H * 4);
+	Convert(FImageView(const_cast<uint8*>(Tex.GetMipData(Mip, Face)), W, H, EPixelFormat::RGBA16_FLOAT)
+		  , FImageView(Texels.data(), W, H, EPixelFormat::RGBA32_FLOAT));
+	return Texels;
+}
+
+static bool IsNear(float a, float b, float Tolerance) { return std::abs(a - b) <= Tolerance; }
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(EnvironmentMapCache_SH9MatchesTheClosedForm)
+{
+	const uint W = 128, H = 64;
+	const std::vector<float> Equirect = CreateEquirect(W, H, &LinearRadiance);
+	std::array<float, 9 * 3> SH9;
+	EnvironmentMapCache::ProjectIrradianceSH9(Equirect.data(), W, H, nullptr, SH9);
+
+	// L(n) = c + s*n.y: L_00 = c*sqrt(4PI), L_1-1 = s*sqrt(4PI/3), the Lambert convolution / PI scales band 1 by 2/3
+	const float L00 = CONSTANT * std::sqrt(4.0f * PI_F);
+	const float L1  = SLOPE * std::sqrt(4.0f * PI_F / 3.0f) * (2.0f / 3.0f);
+	const float Expected[9 * 3] =
+	{
+		L00, L00, L00, // Y00
+		0  , L1 , 0  , // Y1-1: y
+		0  , 0  , 0  , // Y10 : z
+		0  , 0  , L1 , // Y11 : x
+	};
+	for (int i = 0; i < 9 * 3; ++i)
+		VQ_CHECK(IsNear(SH9[i], Expected[i], 0.01f));
+
+	// E(n)/PI = c + 2/3*s*n.y
+	const float Directions[][3] = { {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}, {0, 0, 1}, {0.577350f, 0.577350f, 0.577350f} };
+	for (const float* d : Directions)
+	{
+		float RGB[3];
+		EnvironmentMapCache::EvaluateSH9(SH9, d, RGB);
+		VQ_CHECK(IsNear(RGB[0], CONSTANT, 0.01f));
+		VQ_CHECK(IsNear(RGB[1], CONSTANT + 2.0f / 3.0f * SLOPE * d[1], 0.01f));
+		VQ_CHECK(IsNear(RGB[2], CONSTANT + 2.0f / 3.0f * SLOPE * d[0], 0.01f));
+	}
+}
+
+VQ_TEST(EnvironmentMapCache_PrefilterMipCount)
+{
+	const std::vector<float> Equirect = CreateEquirect(128, 64, &LinearRadiance);
+	FEnvironmentMapCacheSettings Settings = GetTestSettings();
+
+	FEnvironmentMapCacheData Data;
+	VQ_CHECK(EnvironmentMapCache::Cook(Equirect.data(), 128, 64, Settings, nullptr, Data));
+	VQ_CHECK(Data.pSpecularIrradiance->MipCount == 4);
+	VQ_CHECK(Data.pSpecularIrradiance->ArraySize == 6);
+	VQ_CHECK(Data.pSpecularIrradiance->Width == 32 && Data.pSpecularIrradiance->Height == 32);
+	VQ_CHECK(Data.pDiffuseIrradiance->MipCount == 1 && Data.pDiffuseIrradiance->ArraySize == 6);
+	VQ_CHECK(Data.pEquirect->MipCount == 8); // 128x64 -> 1x1
+	VQ_CHECK(Data.pSpecularIrradiance->Data.size() == 6 * (32 * 32 + 16 * 16 + 8 * 8 + 4 * 4) * 8);
+
+	// clamped to the full mip chain of the cubemap
+	Settings.SpecularMipCount = 16;
+	VQ_CHECK(EnvironmentMapCache::Cook(Equirect.data(), 128, 64, Settings, nullptr, Data));
+	VQ_CHECK(Data.pSpecularIrradiance->MipCount == 6); // 32 -> 1
+
+	Settings.SpecularMipCount = 1;
+	VQ_CHECK(EnvironmentMapCache::Cook(Equirect.data(), 128, 64, Settings, nullptr, Data));
+	VQ_CHECK(Data.pSpecularIrradiance->MipCount == 1);
+}
+
+VQ_TEST(EnvironmentMapCache_Roughness0IsTheEnvironment)
+{
+	// R, G & B vary along X, Y & Z: a flipped or rotated cube face shows up in the comparison
+	auto fnRadiance = [](const float d[3], float OutRGB[3])
+	{
+		OutRGB[0] = CONSTANT + SLOPE * d[0];
+		OutRGB[1] = CONSTANT + SLOPE * d[1];
+		OutRGB[2] = CONSTANT + SLOPE * d[2];
+	};
+	const std::vector<float> Equirect = CreateEquirect(128, 64, fnRadiance);
+	const FEnvironmentMapCacheSettings Settings = GetTestSettings();
+	FEnvironmentMapCacheData Data;
+	VQ_CHECK(EnvironmentMapCache::Cook(Equirect.data(), 128, 64, Settings, nullptr, Data));
+
+	// mip 0 is the mirror reflection: the environment itself in each texel's direction
+	const uint Size = Settings.SpecularCubemapSize;
+	float MaxError = 0.0f;
+	for (uint Face = 0; Face < 6; ++Face)
+	{
+		const std::vector<float> Mip0 = DecodeMip(*Data.pSpecularIrradiance, 0, Face);
+		for (uint y = 0; y < Size; ++y)
+		for (uint x = 0; x < Size; ++x)
+		{
+			float Direction[3], Expected[3];
+			EnvironmentMapCache::GetCubemapTexelDirection(Face, x, y, Size, Direction);
+			fnRadiance(Direction, Expected);
+			for (int c = 0; c < 3; ++c)
+				MaxError = std::max(MaxError, std::abs(Mip0[(y * Size + x) * 4 + c] - Expected[c]));
+		}
+	}
+	VQ_CHECK(MaxError < 0.02f); // bilinear sampling of the equirect & RGBA16F
+
+	// the rougher mips average the environment: a constant stays constant
+	const std::vector<float> ConstantEquirect = CreateEquirect(128, 64, [](const float[3], float OutRGB[3]) { OutRGB[0] = OutRGB[1] = OutRGB[2] = CONSTANT; });
+	VQ_CHECK(EnvironmentMapCache::Cook(ConstantEquirect.data(), 128, 64, Settings, nullptr, Data));
+	for (uint Mip = 0; Mip < Data.pSpecularIrradiance->MipCount; ++Mip)
+	for (uint Face = 0; Face < 6; ++Face)
+	{
+		const std::vector<float> Texels = DecodeMip(*Data.pSpecularIrradiance, Mip, Face);
+		for (size_t i = 0; i < Texels.size(); i += 4)
+			VQ_CHECK(IsNear(Texels[i], CONSTANT, 0.01f));
+	}
+}
+
+VQ_TEST(EnvironmentMapCache_KeyChangesWithTheSettings)
+{
+	const uint64 SourceHash = 0x1234567890ABCDEFull;
+	const FEnvironmentMapCacheSettings Settings = GetTestSettings();
+	const uint64 Key = EnvironmentMapCache::GetCacheKey(SourceHash, Settings);
+	VQ_CHECK(Key == EnvironmentMapCache::GetCacheKey(SourceHash, GetTestSettings()));
+	VQ_CHECK(Key != EnvironmentMapCache::GetCacheKey(SourceHash + 1, Settings));
+
+	std::vector<uint64> Keys = { Key };
+	auto fnCheckChanged = [&](void (*fnChange)(FEnvironmentMapCacheSettings&))
+	{
+		FEnvironmentMapCacheSettings Changed = Settings;
+		fnChange(Changed);
+		const uint64 ChangedKey = EnvironmentMapCache::GetCacheKey(SourceHash, Changed);
+		VQ_CHECK(std::find(Keys.begin(), Keys.end(), ChangedKey) == Keys.end());
+		Keys.push_back(ChangedKey);
+	};
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.EquirectWidth = 256; });
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.EquirectHeight = 128; });
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.EquirectWidth = 64; s.EquirectHeight = 128; }); // not just the pixel count
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.DiffuseCubemapSize = 16; });
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.SpecularCubemapSize = 64; });
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.SpecularMipCount = 5; });
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.SpecularSampleCount = 128; });
+	fnCheckChanged([](FEnvironmentMapCacheSettings& s) { s.DiffuseSourceMip = 1; });
+
+	// a cache file cooked w/ other settings isn't loaded
+	const std::string CacheDirectory = Tests::CreateTempDirectory("EnvironmentMapCache_KeyChangesWithTheSettings");
+	const std::vector<float> Equirect = CreateEquirect(128, 64, &LinearRadiance);
+	FEnvironmentMapCacheData Data;
+	VQ_CHECK(EnvironmentMapCache::Cook(Equirect.data(), 128, 64, Settings, nullptr, Data));
+	const std::string CacheFilePath = EnvironmentMapCache::GetCacheFilePath(CacheDirectory, "Test", Key);
+	VQ_CHECK(EnvironmentMapCache::Save(CacheFilePath, Key, Data));
+
+	FEnvironmentMapCacheData Loaded;
+	VQ_CHECK(!EnvironmentMapCache::Load(CacheFilePath, Keys[1], Loaded));
+	VQ_CHECK(EnvironmentMapCache::Load(CacheFilePath, Key, Loaded));
+	VQ_CHECK(Loaded.SH9Irradiance == Data.SH9Irradiance);
+	VQ_CHECK(Loaded.pSpecularIrradiance->MipCount == Data.pSpecularIrradiance->MipCount);
+	VQ_CHECK(std::equal(Data.pSpecularIrradiance->Data.begin(), Data.pSpecularIrradiance->Data.end(), Loaded.pSpecularIrradiance->GetData()));
+}
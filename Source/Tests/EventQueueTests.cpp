@@ -0,0 +1,216 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/EventQueue.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <chrono>
+#include <deque>
+#include <queue>
+#include <vector>
+
+// same layout as MouseMoveEvent, w/o the Windows headers
+struct FTestEvent
+{
+	int   Type = 0;
+	void* hwnd = nullptr;
+	long  x = 0;
+	long  y = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(MPSCQueue_DrainsInPushOrder)
+{
+	MPSCQueue<FTestEvent> Queue(16);
+	VQ_CHECK(Queue.GetCapacity() == 16);
+	VQ_CHECK(Queue.IsEmpty());
+
+	for (long i = 0; i < 16; ++i)
+		VQ_CHECK(Queue.TryPush(FTestEvent{ 0, nullptr, i, 0 }));
+	VQ_CHECK(!Queue.TryPush(FTestEvent{})); // full
+
+	long Expected = 0;
+	VQ_CHECK(Queue.Drain([&](const FTestEvent& e) { VQ_CHECK(e.x == Expected); ++Expected; }) == 16);
+	VQ_CHECK(Queue.IsEmpty());
+	VQ_CHECK(Queue.TryPush(FTestEvent{})); // wrapped around
+}
+
+VQ_TEST(MPSCQueue_TryPushKeepsRoomForPush)
+{
+	MPSCQueue<FTestEvent> Queue(8);
+	VQ_CHECK(Queue.TryPush(FTestEvent{}, 2));
+	VQ_CHECK(Queue.TryPush(FTestEvent{}, 2));
+	VQ_CHECK(!Queue.TryPush(FTestEvent{}, 2));
+	Queue.Push(FTestEvent{});
+	VQ_CHECK(Queue.GetNumQueued() == 3);
+}
+
+VQ_TEST(MPSCQueue_MultipleProducers)
+{
+	constexpr uint NUM_PRODUCERS = 4;
+	constexpr long NUM_EVENTS_PER_PRODUCER = 100000;
+	MPSCQueue<FTestEvent> Queue(256);
+
+	std::vector<std::thread> Producers;
+	for (uint p = 0; p < NUM_PRODUCERS; ++p)
+	{
+		Producers.emplace_back([&, p]()
+		{
+			for (long i = 0; i < NUM_EVENTS_PER_PRODUCER; ++i)
+				Queue.Push(FTestEvent{ 0, nullptr, static_cast<long>(p), i });
+		});
+	}
+
+	// each producer's events arrive in order, none is lost or duplicated
+	std::vector<long> NextExpected(NUM_PRODUCERS, 0);
+	uint64 NumReceived = 0;
+	bool bInOrder = true;
+	while (NumReceived < NUM_PRODUCERS * NUM_EVENTS_PER_PRODUCER)
+	{
+		const size_t NumDrained = Queue.Drain([&](const FTestEvent& e)
+		{
+			bInOrder = bInOrder && e.y == NextExpected[e.x];
+			NextExpected[e.x] = e.y + 1;
+		});
+		if (NumDrained == 0)
+			std::this_thread::yield();
+		NumReceived += NumDrained;
+	}
+	for (std::thread& t : Producers)
+		t.join();
+
+	VQ_CHECK(bInOrder);
+	VQ_CHECK(Queue.IsEmpty());
+	for (long Next : NextExpected)
+		VQ_CHECK(Next == NUM_EVENTS_PER_PRODUCER);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+static std::atomic<uint64> sNumAllocations{ 0 };
+template<class T> struct CountingAllocator
+{
+	using value_type = T;
+	CountingAllocator() = default;
+	template<class U> CountingAllocator(const CountingAllocator<U>&) {}
+	T*   allocate(size_t n)        { sNumAllocations.fetch_add(1, std::memory_order_relaxed); return std::allocator<T>().allocate(n); }
+	void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+	template<class U> bool operator==(const CountingAllocator<U>&) const { return true; }
+	template<class U> bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+struct FEventQueueBenchmarkResult
+{
+	double EventsPerSecond = 0.0;
+	double AllocationsPerEvent = 0.0;
+};
+
+template<class TFuncPush, class TFuncDrain>
+static FEventQueueBenchmarkResult RunEventQueueBenchmark(uint NumEventsPerProducer, uint NumProducers, TFuncPush&& fnPush, TFuncDrain&& fnDrain)
+{
+	using Clock = std::chrono::steady_clock;
+	const uint64 NumEvents = static_cast<uint64>(NumEventsPerProducer) * NumProducers;
+	sNumAllocations.store(0);
+
+	const Clock::time_point Begin = Clock::now();
+	std::vector<std::thread> Producers;
+	for (uint p = 0; p < NumProducers; ++p)
+	{
+		Producers.emplace_back([&, p]()
+		{
+			for (uint i = 0; i < NumEventsPerProducer; ++i)
+				fnPush(FTestEvent{ 0, nullptr, static_cast<long>(p), static_cast<long>(i) });
+		});
+	}
+
+	uint64 NumReceived = 0;
+	int64  Checksum = 0; // keeps the event reads from being optimized away
+	while (NumReceived < NumEvents)
+	{
+		const uint64 NumDrained = fnDrain([&](const FTestEvent& e) { Checksum += e.x + e.y; });
+		if (NumDrained == 0)
+			std::this_thread::yield();
+		NumReceived += NumDrained;
+	}
+	for (std::thread& t : Producers)
+		t.join();
+
+	const double Seconds = std::chrono::duration<double>(Clock::now() - Begin).count();
+	FEventQueueBenchmarkResult Result;
+	Result.EventsPerSecond = NumEvents / Seconds;
+	Result.AllocationsPerEvent = static_cast<double>(sNumAllocations.load()) / NumEvents;
+	return Result;
+}
+
+// Pushes NumEventsPerProducer mouse move sized events from NumProducers threads into the old mutex-guarded
+// double buffered std::queue<std::shared_ptr<>> & into an MPSCQueue while a consumer thread drains them,
+// and logs the events/second & the heap allocations per event of each.
+static void BenchmarkEventQueues(uint NumEventsPerProducer, uint NumProducers)
+{
+	Log::Info("  %u producers x %u events", NumProducers, NumEventsPerProducer);
+
+	// heap allocated & refcounted events in a mutex-guarded double buffered queue
+	{
+		using EventPtr_t = std::shared_ptr<FTestEvent>;
+		using Queue_t = std::queue<EventPtr_t, std::deque<EventPtr_t, CountingAllocator<EventPtr_t>>>;
+		BufferedContainer<Queue_t, EventPtr_t> Queue;
+
+		const FEventQueueBenchmarkResult Result = RunEventQueueBenchmark(NumEventsPerProducer, NumProducers
+			, [&](const FTestEvent& e) { Queue.AddItem(std::allocate_shared<FTestEvent>(CountingAllocator<FTestEvent>(), e)); }
+			, [&](auto&& fnProcess) -> uint64
+			{
+				Queue.SwapBuffers();
+				Queue_t& q = Queue.GetBackContainer();
+				uint64 NumProcessed = 0;
+				while (!q.empty())
+				{
+					EventPtr_t pEvent = std::move(q.front());
+					q.pop();
+					fnProcess(*pEvent);
+					++NumProcessed;
+				}
+				return NumProcessed;
+			}
+		);
+		Log::Info("  BufferedContainer<std::queue<shared_ptr>> : %6.2fM events/s | %.3f allocations/event", Result.EventsPerSecond / 1e6, Result.AllocationsPerEvent);
+	}
+
+	// lock-free bounded queue of fixed size records
+	{
+		MPSCQueue<FTestEvent> Queue(4096);
+		const FEventQueueBenchmarkResult Result = RunEventQueueBenchmark(NumEventsPerProducer, NumProducers
+			, [&](const FTestEvent& e) { Queue.Push(e); }
+			, [&](auto&& fnProcess) -> uint64 { return Queue.Drain(fnProcess); }
+		);
+		Log::Info("  MPSCQueue (fixed size records)            : %6.2fM events/s | %.3f allocations/event", Result.EventsPerSecond / 1e6, Result.AllocationsPerEvent);
+	}
+}
+
+VQ_BENCHMARK(EventQueue)
+{
+	BenchmarkEventQueues(1000000, 1); // main thread spamming mouse moves
+	BenchmarkEventQueues(250000, 4);
+}
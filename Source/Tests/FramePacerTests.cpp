@@ -0,0 +1,122 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/FramePacer.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+using DurationMs = std::chrono::duration<double, std::milli>;
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+// wake-up times depend on the scheduler, only the lower bounds are checked
+VQ_TEST(FramePacer_FramesDontEndEarly)
+{
+	using Clock = std::chrono::steady_clock;
+	constexpr int   NUM_FRAMES = 20;
+	constexpr float TARGET_FRAME_TIME_MS = 5.0f;
+
+	for (int iMethod = 0; iMethod < static_cast<int>(EFramePacingMethod::NUM_FRAME_PACING_METHODS); ++iMethod)
+	{
+		FramePacer Pacer;
+		Pacer.Initialize(1.0f, static_cast<EFramePacingMethod>(iMethod));
+		Pacer.SetTargetFrameTime(TARGET_FRAME_TIME_MS);
+		Pacer.WaitForNextFrame();
+
+		Clock::time_point LastFrameEnd = Clock::now();
+		double MinFrameTimeMs = 1e9;
+		const Clock::time_point Begin = LastFrameEnd;
+		for (int Frame = 0; Frame < NUM_FRAMES; ++Frame)
+		{
+			Pacer.WaitForNextFrame();
+			const Clock::time_point FrameEnd = Clock::now();
+			MinFrameTimeMs = std::min(MinFrameTimeMs, DurationMs(FrameEnd - LastFrameEnd).count());
+			LastFrameEnd = FrameEnd;
+		}
+		const double TotalMs = DurationMs(LastFrameEnd - Begin).count();
+
+		// absolute deadlines: a late frame shortens the next one, but the average can't be under the target
+		VQ_CHECK(TotalMs >= NUM_FRAMES * TARGET_FRAME_TIME_MS - 0.5);
+		VQ_CHECK(MinFrameTimeMs > 0.0);
+		VQ_CHECK(Pacer.GetStats().NumFrames >= NUM_FRAMES);
+	}
+}
+
+VQ_TEST(FramePacer_UnlimitedDoesntWait)
+{
+	FramePacer Pacer;
+	Pacer.Initialize(1.0f);
+	Pacer.SetTargetFrameTime(0.0f);
+	for (int Frame = 0; Frame < 100; ++Frame)
+		VQ_CHECK(Pacer.WaitForNextFrame() == 0.0f);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Paces a synthetic workload (20-80% of the frame budget) at 60, 120 & 144Hz w/ each pacing method for
+// SecondsPerTarget, and logs the frame time jitter & the CPU utilization of the pacing thread while waiting.
+static void BenchmarkFramePacing(float SecondsPerTarget, float SpinThresholdMs)
+{
+	using Clock = std::chrono::steady_clock;
+	constexpr int   TARGET_FRAME_RATES[] = { 60, 120, 144 };
+	constexpr const char* METHOD_NAMES[] = { "Spin", "Sleep+Spin" };
+	static_assert(std::size(METHOD_NAMES) == static_cast<size_t>(EFramePacingMethod::NUM_FRAME_PACING_METHODS), "");
+
+	Log::Info("  %.1fs per target, spin threshold=%.2fms", SecondsPerTarget, SpinThresholdMs);
+	for (int TargetFrameRate : TARGET_FRAME_RATES)
+	{
+		const double TargetFrameTimeMs = 1000.0 / TargetFrameRate;
+		const int    NumFrames = std::max(1, static_cast<int>(SecondsPerTarget * TargetFrameRate));
+		for (int iMethod = 0; iMethod < static_cast<int>(EFramePacingMethod::NUM_FRAME_PACING_METHODS); ++iMethod)
+		{
+			FramePacer Pacer;
+			Pacer.Initialize(SpinThresholdMs, static_cast<EFramePacingMethod>(iMethod));
+			Pacer.SetTargetFrameTime(static_cast<float>(TargetFrameTimeMs));
+
+			// same workload sequence for each method
+			std::mt19937 rng(42);
+			std::uniform_real_distribution<double> distWorkload(0.2, 0.8);
+			Pacer.WaitForNextFrame();
+			for (int Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				const Clock::time_point WorkEnd = Clock::now() + std::chrono::duration_cast<Clock::duration>(DurationMs(TargetFrameTimeMs * distWorkload(rng)));
+				while (Clock::now() < WorkEnd); // stands in for the simulation & command recording
+				Pacer.WaitForNextFrame();
+			}
+
+			const FFramePacingStats s = Pacer.GetStats();
+			Log::Info("  %3dHz %-10s : avg=%6.3fms (target %6.3fms) jitter=%6.3fms max err=%6.3fms missed=%llu | oversleep avg=%.3fms max=%.3fms | wait=%8.1fms spin=%8.1fms CPU while waiting=%5.1f%%"
+				, TargetFrameRate, METHOD_NAMES[iMethod], s.AvgFrameTimeMs, TargetFrameTimeMs, s.JitterMs, s.MaxErrorMs, s.NumMissedFrames
+				, s.AvgOversleepMs, s.MaxOversleepMs, s.WaitTimeMs, s.SpinTimeMs, s.GetWaitCPUUtilization() * 100.0);
+		}
+	}
+}
+
+VQ_BENCHMARK(FramePacing)
+{
+	BenchmarkFramePacing(5.0f, 1.0f); // engine's default FrameLimiterSpinThresholdMs
+}
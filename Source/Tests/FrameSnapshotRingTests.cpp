@@ -0,0 +1,180 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/FrameSnapshotRing.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+using DurationMs = std::chrono::duration<double, std::milli>;
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(FrameSnapshotRing_ConsumesInPublishOrder)
+{
+	FrameSnapshotRing Ring;
+	Ring.Initialize(FrameSnapshotRing::MAX_LATENCY);
+	VQ_CHECK(Ring.GetLastWrittenSlot() == FrameSnapshotRing::INVALID_SLOT);
+
+	std::vector<int> WrittenSlots;
+	for (uint i = 0; i < Ring.GetNumSlots(); ++i)
+	{
+		const int Slot = Ring.BeginWrite();
+		Ring.EndWrite(Slot);
+		WrittenSlots.push_back(Slot);
+		VQ_CHECK(Ring.GetLastWrittenSlot() == Slot);
+	}
+	for (int WrittenSlot : WrittenSlots)
+	{
+		const int Slot = Ring.BeginRead();
+		VQ_CHECK(Slot == WrittenSlot);
+		Ring.EndRead(Slot);
+	}
+
+	const FFrameSnapshotStats Stats = Ring.GetStats();
+	VQ_CHECK(Stats.NumFramesPublished == Ring.GetNumSlots());
+	VQ_CHECK(Stats.NumFramesConsumed == Ring.GetNumSlots());
+}
+
+VQ_TEST(FrameSnapshotRing_UpdateRunsAtMostLatencyFramesAhead)
+{
+	FrameSnapshotRing Ring;
+	Ring.Initialize(1);
+	VQ_CHECK(Ring.GetNumSlots() == 2);
+
+	// frame N-1 published, frame N written: the update thread has to wait for the render thread
+	const int Slot0 = Ring.BeginWrite(); Ring.EndWrite(Slot0);
+	const int Slot1 = Ring.BeginWrite(); Ring.EndWrite(Slot1);
+
+	std::atomic<bool> bWriteBegun = false;
+	std::thread UpdateThread([&]()
+	{
+		const int Slot = Ring.BeginWrite();
+		bWriteBegun = true;
+		Ring.EndWrite(Slot);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	VQ_CHECK(!bWriteBegun);
+
+	const int ReadSlot = Ring.BeginRead();
+	VQ_CHECK(ReadSlot == Slot0);
+	VQ_CHECK(!bWriteBegun); // the slot is freed by EndRead(), not BeginRead()
+	Ring.EndRead(ReadSlot);
+	UpdateThread.join();
+	VQ_CHECK(bWriteBegun);
+	VQ_CHECK(Ring.GetLastWrittenSlot() == Slot0);
+}
+
+VQ_TEST(FrameSnapshotRing_AbortWakesUpTheWaitingThreads)
+{
+	FrameSnapshotRing Ring;
+	Ring.Initialize(2);
+
+	int ReadSlot = 0;
+	std::thread RenderThread([&]() { ReadSlot = Ring.BeginRead(); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	Ring.Abort();
+	RenderThread.join();
+
+	VQ_CHECK(ReadSlot == FrameSnapshotRing::INVALID_SLOT);
+	VQ_CHECK(Ring.BeginWrite() == FrameSnapshotRing::INVALID_SLOT);
+	Ring.WaitUntilConsumed(); // returns right away
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Runs NumFrames of a synthetic update (UpdateMs) & render (RenderMs) workload w/ +/-25% variance serially on a
+// single thread, and pipelined on two threads w/ a frame snapshot ring of latency 1-3, and logs the throughput
+// and the update-to-render latency of each mode.
+static void BenchmarkFramePipelining(uint NumFrames, float UpdateMs, float RenderMs)
+{
+	using Clock = std::chrono::steady_clock;
+	auto fnBusyWork = [](double Ms)
+	{
+		const Clock::time_point End = Clock::now() + std::chrono::duration_cast<Clock::duration>(DurationMs(Ms));
+		while (Clock::now() < End);
+	};
+
+	// same workload sequence for each mode
+	std::vector<std::pair<double, double>> Workloads(NumFrames);
+	{
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<double> distVariance(0.75, 1.25);
+		for (std::pair<double, double>& Workload : Workloads)
+			Workload = { UpdateMs * distVariance(rng), RenderMs * distVariance(rng) };
+	}
+
+	Log::Info("  %u frames, update=%.2fms render=%.2fms (+/-25%%)", NumFrames, UpdateMs, RenderMs);
+
+	// serial: update & render back to back on a single thread
+	{
+		const Clock::time_point Begin = Clock::now();
+		for (const std::pair<double, double>& Workload : Workloads)
+		{
+			fnBusyWork(Workload.first);
+			fnBusyWork(Workload.second);
+		}
+		const double TotalMs = DurationMs(Clock::now() - Begin).count();
+		Log::Info("  Serial      : %7.1f FPS | latency avg=%6.2fms", NumFrames * 1000.0 / TotalMs, TotalMs / NumFrames);
+	}
+
+	// pipelined: update thread produces the snapshots, render thread consumes them
+	for (uint Latency = 1; Latency <= FrameSnapshotRing::MAX_LATENCY; ++Latency)
+	{
+		FrameSnapshotRing Ring;
+		Ring.Initialize(Latency);
+
+		const Clock::time_point Begin = Clock::now();
+		std::thread UpdateThread([&]()
+		{
+			for (const std::pair<double, double>& Workload : Workloads)
+			{
+				const int Slot = Ring.BeginWrite();
+				fnBusyWork(Workload.first);
+				Ring.EndWrite(Slot);
+			}
+		});
+		for (const std::pair<double, double>& Workload : Workloads)
+		{
+			const int Slot = Ring.BeginRead();
+			fnBusyWork(Workload.second);
+			Ring.EndRead(Slot);
+		}
+		UpdateThread.join();
+		const double TotalMs = DurationMs(Clock::now() - Begin).count();
+
+		const FFrameSnapshotStats s = Ring.GetStats();
+		Log::Info("  Pipelined/%u : %7.1f FPS | latency avg=%6.2fms max=%6.2fms | update waited %7.1fms, render waited %7.1fms"
+			, Latency, NumFrames * 1000.0 / TotalMs, s.AvgLatencyMs, s.MaxLatencyMs, s.ProducerWaitMs, s.ConsumerWaitMs);
+	}
+}
+
+VQ_BENCHMARK(FramePipelining)
+{
+	BenchmarkFramePipelining(1000, 4.0f, 6.0f); // render bound
+	BenchmarkFramePipelining(1000, 6.0f, 4.0f); // update bound
+}
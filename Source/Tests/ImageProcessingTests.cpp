@@ -0,0 +1,188 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/ImageProcessing.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/Timer.h"
+#include "Libs/VQUtils/Source/Multithreading.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace ImageProcessing;
+
+// The scalar mip kernels the SIMD ones replaced, w/ the same edge clamping: reference for the results & the timings
+static void ScalarDownsample2x2_RGBA8_Box(const uint8* pSrc, uint SrcW, uint SrcH, uint8* pDst, uint DstW, uint DstH)
+{
+	for (uint y = 0; y < DstH; ++y)
+	{
+		const uint y0 = std::min(y * 2 + 0, SrcH - 1);
+		const uint y1 = std::min(y * 2 + 1, SrcH - 1);
+		for (uint x = 0; x < DstW; ++x)
+		{
+			const uint x0 = std::min(x * 2 + 0, SrcW - 1);
+			const uint x1 = std::min(x * 2 + 1, SrcW - 1);
+			const uint8* p00 = pSrc + (y0 * SrcW + x0) * 4;
+			const uint8* p01 = pSrc + (y0 * SrcW + x1) * 4;
+			const uint8* p10 = pSrc + (y1 * SrcW + x0) * 4;
+			const uint8* p11 = pSrc + (y1 * SrcW + x1) * 4;
+			uint8* pOut = pDst + (y * DstW + x) * 4;
+			for (int c = 0; c < 4; ++c)
+				pOut[c] = static_cast<uint8>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+		}
+	}
+}
+
+static void ScalarDownsample2x2_RGBA32F_Min(const float* pSrc, uint SrcW, uint SrcH, float* pDst, uint DstW, uint DstH)
+{
+	for (uint y = 0; y < DstH; ++y)
+	{
+		const uint y0 = std::min(y * 2 + 0, SrcH - 1);
+		const uint y1 = std::min(y * 2 + 1, SrcH - 1);
+		for (uint x = 0; x < DstW; ++x)
+		{
+			const uint x0 = std::min(x * 2 + 0, SrcW - 1);
+			const uint x1 = std::min(x * 2 + 1, SrcW - 1);
+			const float* p00 = pSrc + (y0 * SrcW + x0) * 4;
+			const float* p01 = pSrc + (y0 * SrcW + x1) * 4;
+			const float* p10 = pSrc + (y1 * SrcW + x0) * 4;
+			const float* p11 = pSrc + (y1 * SrcW + x1) * 4;
+			float* pOut = pDst + (y * DstW + x) * 4;
+			for (int c = 0; c < 3; ++c)
+				pOut[c] = std::min(std::min(p00[c], p01[c]), std::min(p10[c], p11[c]));
+			pOut[3] = 1.0f;
+		}
+	}
+}
+
+static std::vector<uint8> CreateRandomRGBA8(uint W, uint H, uint Seed)
+{
+	std::mt19937 Rng(Seed);
+	std::vector<uint8> Image(size_t(W) * H * 4);
+	for (uint8& v : Image)
+		v = static_cast<uint8>(Rng() & 0xFF);
+	return Image;
+}
+
+static std::vector<float> CreateRandomRGBA32F(uint W, uint H, uint Seed)
+{
+	std::mt19937 Rng(Seed);
+	std::uniform_real_distribution<float> Radiance(0.0f, 64.0f);
+	std::vector<float> Image(size_t(W) * H * 4);
+	for (float& v : Image)
+		v = Radiance(Rng);
+	return Image;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(ImageProcessing_Downsample2x2MatchesScalar)
+{
+	ThreadPool Workers;
+	Workers.Initialize(4, "ImageProcessingTest");
+
+	// odd sizes & thin images exercise the edge clamping & the kernels' scalar tails
+	const uint Sizes[][2] = { { 1, 1 }, { 2, 2 }, { 1, 9 }, { 9, 1 }, { 37, 19 }, { 64, 64 }, { 513, 257 } };
+	for (ThreadPool* pWorkers : { (ThreadPool*)nullptr, &Workers })
+	for (const uint* Size : Sizes)
+	{
+		const uint W = Size[0];
+		const uint H = Size[1];
+		const uint DstW = std::max(1u, W / 2);
+		const uint DstH = std::max(1u, H / 2);
+
+		const std::vector<uint8> SrcRGBA8 = CreateRandomRGBA8(W, H, W * 131 + H);
+		std::vector<uint8> Expected8(size_t(DstW) * DstH * 4);
+		std::vector<uint8> Actual8(Expected8.size());
+		ScalarDownsample2x2_RGBA8_Box(SrcRGBA8.data(), W, H, Expected8.data(), DstW, DstH);
+		Downsample2x2(FImageView(const_cast<uint8*>(SrcRGBA8.data()), W, H, EPixelFormat::RGBA8_UNORM), FImageView(Actual8.data(), DstW, DstH, EPixelFormat::RGBA8_UNORM), EFilter::BOX, pWorkers);
+		VQ_CHECK(Actual8 == Expected8);
+
+		const std::vector<float> SrcRGBA32F = CreateRandomRGBA32F(W, H, W * 131 + H);
+		std::vector<float> Expected32F(size_t(DstW) * DstH * 4);
+		std::vector<float> Actual32F(Expected32F.size());
+		ScalarDownsample2x2_RGBA32F_Min(SrcRGBA32F.data(), W, H, Expected32F.data(), DstW, DstH);
+		Downsample2x2(FImageView(const_cast<float*>(SrcRGBA32F.data()), W, H, EPixelFormat::RGBA32_FLOAT), FImageView(Actual32F.data(), DstW, DstH, EPixelFormat::RGBA32_FLOAT), EFilter::MIN, pWorkers);
+		VQ_CHECK(Actual32F == Expected32F);
+	}
+
+	Workers.Exit();
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Generates the mip chain of a Size x Size image into a ping-pong pair of buffers like the texture cooking does,
+// returns the milliseconds it took. pWorkers: nullptr for the single threaded SIMD path, bScalar for the scalar kernels.
+template<class TTexel>
+static double GenerateMipChain(const std::vector<TTexel>& Image, uint Size, EPixelFormat Format, EFilter Filter, bool bScalar, ThreadPool* pWorkers)
+{
+	std::vector<TTexel> Scratch[2] = { std::vector<TTexel>(Image.size() / 4), std::vector<TTexel>(Image.size() / 4) };
+	Timer t; t.Start();
+	const TTexel* pMip = Image.data();
+	for (uint mip = 1, W = Size; W > 1; ++mip, W /= 2)
+	{
+		TTexel* pDst = Scratch[mip % 2].data();
+		if (!bScalar)
+			Downsample2x2(FImageView(const_cast<TTexel*>(pMip), W, W, Format), FImageView(pDst, W / 2, W / 2, Format), Filter, pWorkers);
+		else if (Format == EPixelFormat::RGBA8_UNORM)
+			ScalarDownsample2x2_RGBA8_Box(reinterpret_cast<const uint8*>(pMip), W, W, reinterpret_cast<uint8*>(pDst), W / 2, W / 2);
+		else
+			ScalarDownsample2x2_RGBA32F_Min(reinterpret_cast<const float*>(pMip), W, W, reinterpret_cast<float*>(pDst), W / 2, W / 2);
+		pMip = pDst;
+	}
+	return t.StopGetDeltaTimeAndReset() * 1000.0;
+}
+
+template<class TTexel>
+static void BenchmarkMipChain(const char* pName, const std::vector<TTexel>& Image, uint Size, EPixelFormat Format, EFilter Filter, ThreadPool& Workers)
+{
+	const double ScalarMs   = GenerateMipChain(Image, Size, Format, Filter, true, nullptr);
+	const double SIMDMs     = GenerateMipChain(Image, Size, Format, Filter, false, nullptr);
+	const double ParallelMs = GenerateMipChain(Image, Size, Format, Filter, false, &Workers);
+	Log::Info("  %-7s %4ux%-4u mips: scalar=%8.2fms | SIMD=%8.2fms (%4.1fx) | SIMD+%zu threads=%8.2fms (%4.1fx)"
+		, pName, Size, Size
+		, ScalarMs
+		, SIMDMs, ScalarMs / SIMDMs
+		, ThreadPool::sHardwareThreadCount, ParallelMs, ScalarMs / ParallelMs
+	);
+}
+
+VQ_BENCHMARK(ImageProcessing)
+{
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "ImageProcessingBenchmark");
+
+	for (uint Size : { 1024u, 2048u, 4096u, 8192u })
+	{
+		BenchmarkMipChain("RGBA8", CreateRandomRGBA8(Size, Size, Size), Size, EPixelFormat::RGBA8_UNORM, EFilter::BOX, Workers);
+	}
+	for (uint Size : { 1024u, 2048u, 4096u }) // 8k RGBA32F is 1GB w/o the mips
+	{
+		BenchmarkMipChain("RGBA32F", CreateRandomRGBA32F(Size, Size, Size), Size, EPixelFormat::RGBA32_FLOAT, EFilter::MIN, Workers);
+	}
+
+	Workers.Exit();
+}
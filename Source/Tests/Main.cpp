@@ -0,0 +1,137 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+// VQETests.exe                    : runs all the tests, the exit code is the # failed tests
+// VQETests.exe -Test=<Filter>     : runs the tests whose name contains Filter
+// VQETests.exe -Benchmark         : runs all the benchmarks
+// VQETests.exe -Benchmark=<Filter>: runs the benchmarks whose name contains Filter
+// VQETests.exe -List              : lists the tests & benchmarks
+//
+// The working directory is expected to be the repo root for the benchmarks that read Data/.
+
+#include "Tests.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Tests
+{
+	struct FCase
+	{
+		ECaseType   Type;
+		const char* pName;
+		Func_t      pFunc;
+	};
+
+	// function local: the registrars of the other translation units can run before this one is initialized
+	static std::vector<FCase>& GetCases()
+	{
+		static std::vector<FCase> sCases;
+		return sCases;
+	}
+
+	static int sNumFailedChecks = 0; // of the running test
+
+	FRegistrar::FRegistrar(ECaseType Type, const char* pName, Func_t pFunc)
+	{
+		GetCases().push_back({ Type, pName, pFunc });
+	}
+
+	void ReportFailure(const char* pFile, int Line, const char* pExpression)
+	{
+		++sNumFailedChecks;
+		Log::Error("    %s(%d): check failed: %s", pFile, Line, pExpression);
+	}
+
+	std::string CreateTempDirectory(const char* pName)
+	{
+		const std::filesystem::path Directory = std::filesystem::temp_directory_path() / "VQETests" / pName;
+		std::error_code ec;
+		std::filesystem::remove_all(Directory, ec);
+		std::filesystem::create_directories(Directory, ec);
+		return Directory.generic_string() + "/";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Tests;
+	using Clock = std::chrono::steady_clock;
+
+	Log::LogInitializeParams LogParams;
+	LogParams.bLogConsole = true;
+	Log::Initialize(LogParams);
+
+	ECaseType   Type = ECaseType::TEST;
+	std::string Filter;
+	bool        bList = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string Param = argv[i];
+		const size_t iEquals = Param.find('=');
+		const std::string ParamName  = Param.substr(0, iEquals);
+		const std::string ParamValue = iEquals == std::string::npos ? "" : Param.substr(iEquals + 1);
+
+		if (ParamName == "-Test")      { Type = ECaseType::TEST;      Filter = ParamValue; }
+		if (ParamName == "-Benchmark") { Type = ECaseType::BENCHMARK; Filter = ParamValue; }
+		if (ParamName == "-List")      { bList = true; }
+	}
+
+	if (bList)
+	{
+		for (const FCase& Case : GetCases())
+			Log::Info("%-9s %s", Case.Type == ECaseType::TEST ? "Test" : "Benchmark", Case.pName);
+		Log::Exit();
+		return 0;
+	}
+
+	int NumRun = 0;
+	int NumFailed = 0;
+	for (const FCase& Case : GetCases())
+	{
+		if (Case.Type != Type || (!Filter.empty() && std::string(Case.pName).find(Filter) == std::string::npos))
+			continue;
+
+		Log::Info("[ RUN  ] %s", Case.pName);
+		sNumFailedChecks = 0;
+		const Clock::time_point Begin = Clock::now();
+		Case.pFunc();
+		const double Ms = std::chrono::duration<double, std::milli>(Clock::now() - Begin).count();
+
+		++NumRun;
+		if (sNumFailedChecks > 0)
+		{
+			++NumFailed;
+			Log::Error("[ FAIL ] %s (%d checks failed, %.1fms)", Case.pName, sNumFailedChecks, Ms);
+		}
+		else
+		{
+			Log::Info("[  OK  ] %s (%.1fms)", Case.pName, Ms);
+		}
+	}
+
+	if (Type == ECaseType::TEST)
+		Log::Info("%d/%d tests passed", NumRun - NumFailed, NumRun);
+	Log::Exit();
+	return NumFailed;
+}
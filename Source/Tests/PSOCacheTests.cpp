@@ -0,0 +1,235 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/PSOCache.h"
+#include "Source/Renderer/ShaderCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+constexpr uint64 DEVICE_ID       = 0x10DE2684000001ull;
+constexpr uint64 OTHER_DEVICE_ID = 0x10DE2684000002ull; // same GPU, different driver
+
+// a blob w/ distinct contents per PSO
+static std::vector<uint8> MakeBlob(size_t Size, uint8 Seed)
+{
+	std::vector<uint8> Blob(Size);
+	for (size_t i = 0; i < Size; ++i)
+		Blob[i] = static_cast<uint8>(Seed + i * 7);
+	return Blob;
+}
+
+static FHash128 MakePSOHash(const char* pName, int Permutation)
+{
+	HashBuilder128 h;
+	h.Add(pName);
+	h.Add(Permutation);
+	return h.GetHash();
+}
+
+static std::string GetBlobFilePath(const std::string& CacheDirectory, const FHash128& PSOHash)
+{
+	return CacheDirectory + PSOHash.ToString() + ".pso";
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(HashBuilder128_IsStable)
+{
+	// the PSO cache keys are persisted: the hash must not depend on the process, the build or the machine
+	VQ_CHECK(ShaderCache::Hash(nullptr, 0) == 0xEF46DB3751D8E999ull); // XXH64 spec: empty input, seed 0
+	VQ_CHECK(ShaderCache::Hash("abc", 3) == 0x44BC2CF5AD770999ull);
+
+	HashBuilder128 h0, h1;
+	for (HashBuilder128* h : { &h0, &h1 })
+	{
+		h->Add("ForwardLighting_PSO");
+		h->Add(std::string("PS_main"));
+		h->Add(uint32(3));
+		h->Add(1.5f);
+		h->Add(true);
+	}
+	const FHash128 Hash = h0.GetHash();
+	VQ_CHECK(!Hash.IsNull());
+	VQ_CHECK(Hash == h1.GetHash());
+	VQ_CHECK(Hash == h0.GetHash()); // GetHash() doesn't consume the data
+	VQ_CHECK(Hash.Lo != Hash.Hi);   // 2 different seeds
+
+	// the string form is what the blob files are named after
+	const std::string HashStr = Hash.ToString();
+	FHash128 Parsed;
+	VQ_CHECK(HashStr.size() == 32);
+	VQ_CHECK(FHash128::FromString(HashStr, Parsed) && Parsed == Hash);
+	VQ_CHECK(!FHash128::FromString("not a hash", Parsed));
+	VQ_CHECK(!FHash128::FromString(std::string(32, 'x'), Parsed));
+}
+
+VQ_TEST(HashBuilder128_IsOrderSensitive)
+{
+	auto fnHash = [](auto&&... Values) { HashBuilder128 h; (h.Add(Values), ...); return h.GetHash(); };
+
+	VQ_CHECK(fnHash(1, 2) != fnHash(2, 1));
+	VQ_CHECK(fnHash("VS", "PS") != fnHash("PS", "VS"));
+
+	// the string terminators keep the field boundaries
+	VQ_CHECK(fnHash(std::string("AB"), std::string("C")) != fnHash(std::string("A"), std::string("BC")));
+	VQ_CHECK(fnHash("AB", "C") != fnHash("A", "BC"));
+
+	// a null string isn't an empty string
+	VQ_CHECK(fnHash(static_cast<const char*>(nullptr)) != fnHash(""));
+
+	// the type width is part of the value
+	VQ_CHECK(fnHash(uint32(1)) != fnHash(uint64(1)));
+}
+
+VQ_TEST(PSOCache_IndexRoundTrip)
+{
+	const std::string CacheDirectory = Tests::CreateTempDirectory("PSOCache_IndexRoundTrip");
+	const FHash128 Hash0 = MakePSOHash("PSO_0", 0);
+	const FHash128 Hash1 = MakePSOHash("PSO_1", 1);
+	const std::vector<uint8> Blob0 = MakeBlob(1024, 1);
+	const std::vector<uint8> Blob1 = MakeBlob(333, 2);
+	{
+		PSOCache Cache;
+		Cache.Initialize(CacheDirectory, DEVICE_ID);
+		std::vector<uint8> Blob;
+		VQ_CHECK(!Cache.LoadBlob(Hash0, Blob));
+		Cache.StoreBlob(Hash0, "PSO_0", Blob0.data(), Blob0.size());
+		Cache.StoreBlob(Hash1, "PSO 1 w/ spaces in its name", Blob1.data(), Blob1.size());
+		Cache.StoreBlob(MakePSOHash("Empty", 0), "Empty", nullptr, 0); // ignored
+		Cache.SaveIndex();
+		VQ_CHECK(Cache.GetStats().NumEntries == 2);
+	}
+
+	PSOCache Cache;
+	Cache.Initialize(CacheDirectory, DEVICE_ID);
+	VQ_CHECK(Cache.GetStats().NumEntries == 2);
+
+	std::vector<uint8> Blob;
+	VQ_CHECK(Cache.LoadBlob(Hash0, Blob) && Blob == Blob0);
+	VQ_CHECK(Cache.LoadBlob(Hash1, Blob) && Blob == Blob1);
+	VQ_CHECK(!Cache.LoadBlob(MakePSOHash("PSO_0", 1), Blob)); // another permutation
+
+	FPSOCacheStats Stats = Cache.GetStats();
+	VQ_CHECK(Stats.NumHits == 2 && Stats.NumMisses == 1 && Stats.NumRejected == 0);
+
+	// the driver refusing a blob turns the hit into a miss & drops the entry
+	Cache.RejectBlob(Hash1);
+	Stats = Cache.GetStats();
+	VQ_CHECK(Stats.NumEntries == 1 && Stats.NumHits == 1 && Stats.NumMisses == 2 && Stats.NumRejected == 1);
+	VQ_CHECK(!Cache.LoadBlob(Hash1, Blob));
+	Cache.SaveIndex();
+
+	PSOCache Reloaded;
+	Reloaded.Initialize(CacheDirectory, DEVICE_ID);
+	VQ_CHECK(Reloaded.GetStats().NumEntries == 1);
+	VQ_CHECK(Reloaded.LoadBlob(Hash0, Blob) && Blob == Blob0);
+}
+
+VQ_TEST(PSOCache_RejectsTheIndexOfAnotherDevice)
+{
+	const std::string CacheDirectory = Tests::CreateTempDirectory("PSOCache_RejectsTheIndexOfAnotherDevice");
+	const FHash128 Hash = MakePSOHash("PSO", 0);
+	const std::vector<uint8> Blob0 = MakeBlob(256, 3);
+	{
+		PSOCache Cache;
+		Cache.Initialize(CacheDirectory, DEVICE_ID);
+		Cache.StoreBlob(Hash, "PSO", Blob0.data(), Blob0.size());
+		Cache.SaveIndex();
+	}
+
+	// the blob file is intact, but a blob from another GPU or driver must never reach the driver
+	PSOCache Cache;
+	Cache.Initialize(CacheDirectory, OTHER_DEVICE_ID);
+	std::vector<uint8> Blob;
+	VQ_CHECK(Cache.GetStats().NumEntries == 0);
+	VQ_CHECK(!Cache.LoadBlob(Hash, Blob));
+
+	// the index is rewritten for the new device
+	Cache.SaveIndex();
+	PSOCache Original;
+	Original.Initialize(CacheDirectory, DEVICE_ID);
+	VQ_CHECK(Original.GetStats().NumEntries == 0);
+	VQ_CHECK(!Original.LoadBlob(Hash, Blob));
+}
+
+VQ_TEST(PSOCache_RejectsCorruptOrMissingBlobs)
+{
+	const std::string CacheDirectory = Tests::CreateTempDirectory("PSOCache_RejectsCorruptOrMissingBlobs");
+	const FHash128 HashMissing   = MakePSOHash("Missing", 0);
+	const FHash128 HashTruncated = MakePSOHash("Truncated", 0);
+	const FHash128 HashCorrupt   = MakePSOHash("Corrupt", 0);
+	const FHash128 HashIntact    = MakePSOHash("Intact", 0);
+	const std::vector<uint8> Blob0 = MakeBlob(512, 4);
+	{
+		PSOCache Cache;
+		Cache.Initialize(CacheDirectory, DEVICE_ID);
+		for (const FHash128& Hash : { HashMissing, HashTruncated, HashCorrupt, HashIntact })
+			Cache.StoreBlob(Hash, Hash.ToString(), Blob0.data(), Blob0.size());
+		Cache.SaveIndex();
+	}
+
+	std::filesystem::remove(GetBlobFilePath(CacheDirectory, HashMissing));
+	std::filesystem::resize_file(GetBlobFilePath(CacheDirectory, HashTruncated), Blob0.size() / 2);
+	{
+		// same size, 1 byte flipped: only the content hash catches it
+		std::fstream File(GetBlobFilePath(CacheDirectory, HashCorrupt), std::ios::in | std::ios::out | std::ios::binary);
+		File.seekp(100);
+		File.put(static_cast<char>(Blob0[100] ^ 0xFF));
+	}
+
+	PSOCache Cache;
+	Cache.Initialize(CacheDirectory, DEVICE_ID);
+	VQ_CHECK(Cache.GetStats().NumEntries == 4);
+
+	std::vector<uint8> Blob;
+	VQ_CHECK(!Cache.LoadBlob(HashMissing, Blob)   && Blob.empty());
+	VQ_CHECK(!Cache.LoadBlob(HashTruncated, Blob) && Blob.empty());
+	VQ_CHECK(!Cache.LoadBlob(HashCorrupt, Blob)   && Blob.empty());
+	VQ_CHECK(Cache.LoadBlob(HashIntact, Blob)     && Blob == Blob0);
+
+	const FPSOCacheStats Stats = Cache.GetStats();
+	VQ_CHECK(Stats.NumEntries == 1 && Stats.NumHits == 1 && Stats.NumMisses == 3);
+
+	// the bad entries are dropped from the index, & recompiled PSOs replace their blobs
+	Cache.StoreBlob(HashCorrupt, "Corrupt", Blob0.data(), Blob0.size());
+	Cache.SaveIndex();
+	PSOCache Reloaded;
+	Reloaded.Initialize(CacheDirectory, DEVICE_ID);
+	VQ_CHECK(Reloaded.GetStats().NumEntries == 2);
+	VQ_CHECK(Reloaded.LoadBlob(HashCorrupt, Blob) && Blob == Blob0);
+	VQ_CHECK(!Reloaded.LoadBlob(HashTruncated, Blob));
+}
+
+VQ_TEST(PSOCache_IgnoresAnIndexOfAnotherVersion)
+{
+	const std::string CacheDirectory = Tests::CreateTempDirectory("PSOCache_IgnoresAnIndexOfAnotherVersion");
+	{
+		std::ofstream Index(CacheDirectory + "PSOCache.idx");
+		Index << "VERSION 0\nDEVICE 0010de2684000001\nPSO " << MakePSOHash("PSO", 0).ToString() << " 4 0 PSO\n";
+	}
+	PSOCache Cache;
+	Cache.Initialize(CacheDirectory, DEVICE_ID);
+	VQ_CHECK(Cache.GetStats().NumEntries == 0);
+}
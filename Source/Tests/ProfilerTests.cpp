@@ -0,0 +1,157 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/Profiler.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(Profiler_DisabledScopesArentRecorded)
+{
+	Profiler::SetEnabled(false);
+	VQ_CHECK(Profiler::BeginScope() == 0);
+	Profiler::EndScope("Test_DisabledScope", 0);
+	Profiler::SetEnabled(true);
+	VQ_CHECK(Profiler::BeginScope() != 0);
+}
+
+VQ_TEST(Profiler_ExportsTheScopesOfAllThreads)
+{
+	const std::string TracePath = (std::filesystem::temp_directory_path() / "VQETests_Profiler.json").string();
+	Profiler::SetEnabled(true);
+
+	std::thread Worker([]()
+	{
+		Profiler::SetThreadName("Test_WorkerThread");
+		const uint64 t0 = Profiler::BeginScope();
+		Profiler::EndScope("Test_WorkerScope", t0);
+	});
+	Worker.join(); // the rings outlive their threads
+
+	const uint64 t0 = Profiler::BeginScope();
+	Profiler::Counter("Test_Counter", 42.0);
+	Profiler::EndScope("Test_\"Quoted\"Scope", t0);
+
+	VQ_CHECK(Profiler::ExportChromeTrace(TracePath));
+	std::ifstream File(TracePath);
+	std::stringstream ss; ss << File.rdbuf();
+	const std::string Trace = ss.str();
+	File.close();
+	std::filesystem::remove(TracePath);
+
+	VQ_CHECK(Trace.find("\"Test_WorkerThread\"") != std::string::npos);
+	VQ_CHECK(Trace.find("\"Test_WorkerScope\",\"ph\":\"X\"") != std::string::npos);
+	VQ_CHECK(Trace.find("\"Test_\\\"Quoted\\\"Scope\",\"ph\":\"X\"") != std::string::npos);
+	VQ_CHECK(Trace.find("\"Test_Counter\",\"ph\":\"C\"") != std::string::npos);
+	VQ_CHECK(Trace.find("\"value\":42") != std::string::npos);
+}
+
+VQ_TEST(FrameHistory_KeepsTheLastValues)
+{
+	FrameHistory History;
+	VQ_CHECK(History.GetCount() == 0 && History.GetAverage() == 0.0f);
+
+	for (size_t i = 0; i < FrameHistory::SIZE + 10; ++i)
+		History.Add(static_cast<float>(i));
+	VQ_CHECK(History.GetCount() == FrameHistory::SIZE);
+	VQ_CHECK(History.GetOffset() == 10);
+	VQ_CHECK(History.GetData()[History.GetOffset()] == 10.0f); // oldest
+	VQ_CHECK(History.GetMax() == static_cast<float>(FrameHistory::SIZE + 9));
+	VQ_CHECK(History.GetAverage() == (10.0f + FrameHistory::SIZE + 9) * 0.5f);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Records NumScopesPerThread nested scopes on NumThreads threads & logs the instrumentation overhead per scope
+static void BenchmarkProfilerScopes(uint NumScopesPerThread, uint NumThreads)
+{
+	using Clock = std::chrono::steady_clock;
+	constexpr uint SCOPE_DEPTH = 4;
+	const uint NumIterations = std::max(1u, NumScopesPerThread / SCOPE_DEPTH);
+	Log::Info("  %u threads x %u scopes, %u nested", NumThreads, NumIterations * SCOPE_DEPTH, SCOPE_DEPTH);
+
+	// returns the avg ns per scope across the threads
+	auto fnRun = [&](bool bEnabled) -> double
+	{
+		const bool bWasEnabled = Profiler::IsEnabled();
+		Profiler::SetEnabled(bEnabled);
+
+		std::vector<double> ThreadNsPerScope(NumThreads, 0.0);
+		std::vector<std::thread> Threads;
+		for (uint iThread = 0; iThread < NumThreads; ++iThread)
+		{
+			Threads.emplace_back([&, iThread]()
+			{
+				Profiler::SetThreadName("ProfilerBenchmark"); // registration isn't part of the per scope overhead
+				const Clock::time_point Begin = Clock::now();
+				for (uint i = 0; i < NumIterations; ++i)
+				{
+					const uint64 t0 = Profiler::BeginScope();
+					{
+						const uint64 t1 = Profiler::BeginScope();
+						{
+							const uint64 t2 = Profiler::BeginScope();
+							{
+								const uint64 t3 = Profiler::BeginScope();
+								Profiler::EndScope("Benchmark_Depth3", t3);
+							}
+							Profiler::EndScope("Benchmark_Depth2", t2);
+						}
+						Profiler::EndScope("Benchmark_Depth1", t1);
+					}
+					Profiler::EndScope("Benchmark_Depth0", t0);
+				}
+				const double ElapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - Begin).count();
+				ThreadNsPerScope[iThread] = ElapsedNs / (static_cast<double>(NumIterations) * SCOPE_DEPTH);
+			});
+		}
+		for (std::thread& t : Threads)
+			t.join();
+
+		Profiler::SetEnabled(bWasEnabled);
+		double Sum = 0.0;
+		for (double NsPerScope : ThreadNsPerScope)
+			Sum += NsPerScope;
+		return Sum / std::max(1u, NumThreads);
+	};
+
+	const double NsPerScopeDisabled = fnRun(false);
+	const double NsPerScopeEnabled  = fnRun(true);
+	Log::Info("  disabled : %6.1f ns/scope", NsPerScopeDisabled);
+	Log::Info("  enabled  : %6.1f ns/scope (%.1fM scopes/s per thread)", NsPerScopeEnabled, NsPerScopeEnabled > 0.0 ? 1000.0 / NsPerScopeEnabled : 0.0);
+}
+
+VQ_BENCHMARK(Profiler)
+{
+	BenchmarkProfilerScopes(1000000, 1);
+	BenchmarkProfilerScopes(250000, 4);
+}
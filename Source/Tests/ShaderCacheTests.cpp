@@ -0,0 +1,207 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/ShaderCache.h"
+#include "Source/Renderer/Shader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void WriteTextFile(const std::string& FilePath, const std::string& Text)
+{
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	File << Text;
+}
+
+static FShaderStageCompileDesc MakeCompileDesc(const std::string& FilePath, const char* pEntryPoint = "PSMain", const char* pShaderModel = "ps_5_1")
+{
+	FShaderStageCompileDesc Desc;
+	Desc.FilePath = std::wstring(FilePath.begin(), FilePath.end());
+	Desc.EntryPoint = pEntryPoint;
+	Desc.ShaderModel = pShaderModel;
+	return Desc;
+}
+
+// Shader sources w/ an include graph:
+//   Forward.hlsl  -> Lighting.hlsl -> Common.hlsl
+//   Shadow.hlsl   -> Common.hlsl
+//   Tonemap.hlsl  -> Color.hlsl
+//   Fullscreen.hlsl
+struct FShaderSources
+{
+	std::string Directory;
+	std::vector<std::string> Shaders;
+
+	explicit FShaderSources(const char* pTestName) : Directory(Tests::CreateTempDirectory(pTestName))
+	{
+		WriteTextFile(Directory + "Common.hlsl"    , "#define PI 3.14159\n");
+		WriteTextFile(Directory + "Color.hlsl"     , "float Luminance(float3 c) { return dot(c, float3(0.2126, 0.7152, 0.0722)); }\n");
+		WriteTextFile(Directory + "Lighting.hlsl"  , "#include \"Common.hlsl\"\nfloat Lambert(float NdotL) { return NdotL / PI; }\n");
+		WriteTextFile(Directory + "Forward.hlsl"   , "#include \"Lighting.hlsl\"\nfloat4 PSMain() : SV_TARGET { return Lambert(1); }\n");
+		WriteTextFile(Directory + "Shadow.hlsl"    , "// depth only\n#include \"Common.hlsl\"\nfloat4 PSMain() : SV_TARGET { return PI; }\n");
+		WriteTextFile(Directory + "Tonemap.hlsl"   , "#include \"Color.hlsl\"\nfloat4 PSMain() : SV_TARGET { return Luminance(1); }\n");
+		WriteTextFile(Directory + "Fullscreen.hlsl", "float4 PSMain() : SV_TARGET { return 0; }\n");
+		Shaders = { "Forward.hlsl", "Shadow.hlsl", "Tonemap.hlsl", "Fullscreen.hlsl", "Lighting.hlsl" };
+	}
+
+	std::unordered_map<std::string, uint64> GetShaderKeys(ShaderCache& Cache) const
+	{
+		std::unordered_map<std::string, uint64> Keys;
+		for (const std::string& Shader : Shaders)
+			Keys[Shader] = Cache.GetShaderKey(MakeCompileDesc(Directory + Shader));
+		return Keys;
+	}
+};
+
+// the shaders whose key differs between the 2 runs
+static std::vector<std::string> GetChangedShaders(const std::unordered_map<std::string, uint64>& Before, const std::unordered_map<std::string, uint64>& After)
+{
+	std::vector<std::string> Changed;
+	for (const auto& it : Before)
+	{
+		if (After.at(it.first) != it.second)
+			Changed.push_back(it.first);
+	}
+	std::sort(Changed.begin(), Changed.end());
+	return Changed;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(ShaderCache_IndexRoundTrip)
+{
+	const FShaderSources Sources("ShaderCache_IndexRoundTrip");
+	const std::string CacheDirectory = Sources.Directory + "Cache/";
+	std::filesystem::create_directories(CacheDirectory);
+
+	std::unordered_map<std::string, uint64> Keys;
+	{
+		ShaderCache Cache;
+		Cache.Initialize(CacheDirectory);
+		Keys = Sources.GetShaderKeys(Cache);
+		for (const auto& it : Keys)
+		{
+			VQ_CHECK(it.second != 0);
+			VQ_CHECK(!Cache.HasShaderBinary(it.second));
+			const std::string BinaryPath = Cache.GetShaderBinaryPath(MakeCompileDesc(Sources.Directory + it.first), it.second);
+			WriteTextFile(BinaryPath, "DXBC");
+			Cache.AddShaderBinary(it.second, BinaryPath);
+		}
+		VQ_CHECK(Cache.GetStats().NumSourceFilesHashed == 7);
+		Cache.SaveIndex();
+	}
+
+	// a missing source file doesn't get a key
+	{
+		ShaderCache Cache;
+		Cache.Initialize(CacheDirectory);
+		VQ_CHECK(Cache.GetShaderKey(MakeCompileDesc(Sources.Directory + "Missing.hlsl")) == 0);
+	}
+
+	ShaderCache Cache;
+	Cache.Initialize(CacheDirectory);
+	VQ_CHECK(Cache.GetStats().NumShaderBinaries == Keys.size());
+	VQ_CHECK(Sources.GetShaderKeys(Cache) == Keys);
+	for (const auto& it : Keys)
+		VQ_CHECK(Cache.HasShaderBinary(it.second));
+
+	// the unchanged sources are only stat'ed, not re-read
+	FShaderCacheStats Stats = Cache.GetStats();
+	VQ_CHECK(Stats.NumSourceFilesHashed == 0);
+	VQ_CHECK(Stats.NumSourceFiles == 7);
+	VQ_CHECK(Stats.NumCacheHits == Keys.size() && Stats.NumCacheMisses == 0);
+
+	// the compile settings are part of the key
+	const uint64 KeyForward = Keys.at("Forward.hlsl");
+	FShaderStageCompileDesc Desc = MakeCompileDesc(Sources.Directory + "Forward.hlsl");
+	Desc.Macros.push_back({ "SHADOWS", "1" });
+	VQ_CHECK(Cache.GetShaderKey(Desc) != KeyForward);
+	VQ_CHECK(Cache.GetShaderKey(MakeCompileDesc(Sources.Directory + "Forward.hlsl", "PSMain_Transparent")) != KeyForward);
+	VQ_CHECK(Cache.GetShaderKey(MakeCompileDesc(Sources.Directory + "Forward.hlsl", "PSMain", "ps_6_0")) != KeyForward);
+
+	// binaries deleted by hand are dropped from the index
+	std::filesystem::remove(Cache.GetShaderBinaryPath(MakeCompileDesc(Sources.Directory + "Tonemap.hlsl"), Keys.at("Tonemap.hlsl")));
+	ShaderCache Reloaded;
+	Reloaded.Initialize(CacheDirectory);
+	VQ_CHECK(Reloaded.GetStats().NumShaderBinaries == Keys.size() - 1);
+	VQ_CHECK(!Reloaded.HasShaderBinary(Keys.at("Tonemap.hlsl")));
+	VQ_CHECK(Reloaded.HasShaderBinary(KeyForward));
+}
+
+VQ_TEST(ShaderCache_IncludeEditInvalidatesItsIncluders)
+{
+	const FShaderSources Sources("ShaderCache_IncludeEditInvalidatesItsIncluders");
+	const std::string CacheDirectory = Sources.Directory + "Cache/";
+	std::filesystem::create_directories(CacheDirectory);
+
+	std::unordered_map<std::string, uint64> Keys;
+	{
+		ShaderCache Cache;
+		Cache.Initialize(CacheDirectory);
+		Keys = Sources.GetShaderKeys(Cache);
+		Cache.SaveIndex();
+	}
+
+	// next run: Common.hlsl was edited while the engine wasn't running
+	WriteTextFile(Sources.Directory + "Common.hlsl", "#define PI 3.14159265\n");
+	{
+		ShaderCache Cache;
+		Cache.Initialize(CacheDirectory);
+		const std::unordered_map<std::string, uint64> NewKeys = Sources.GetShaderKeys(Cache);
+		VQ_CHECK(GetChangedShaders(Keys, NewKeys) == std::vector<std::string>({ "Forward.hlsl", "Lighting.hlsl", "Shadow.hlsl" }));
+		VQ_CHECK(Cache.GetStats().NumSourceFilesHashed == 1);
+		Keys = NewKeys;
+		Cache.SaveIndex();
+	}
+
+	// hot reload: Color.hlsl is edited while running, the file watcher invalidates it
+	ShaderCache Cache;
+	Cache.Initialize(CacheDirectory);
+	VQ_CHECK(Sources.GetShaderKeys(Cache) == Keys);
+
+	const std::string ColorFile = Sources.Directory + "Color.hlsl";
+	VQ_CHECK(Cache.DependsOnAny(Sources.Directory + "Tonemap.hlsl", { ColorFile }));
+	VQ_CHECK(!Cache.DependsOnAny(Sources.Directory + "Forward.hlsl", { ColorFile }));
+	VQ_CHECK(Cache.DependsOnAny(Sources.Directory + "Forward.hlsl", { Sources.Directory + "Common.hlsl" })); // transitively
+
+	WriteTextFile(ColorFile, "float Luminance(float3 c) { return dot(c, float3(0.299, 0.587, 0.114)); }\n");
+	Cache.InvalidateSourceFiles({ ColorFile });
+	const std::unordered_map<std::string, uint64> NewKeys = Sources.GetShaderKeys(Cache);
+	VQ_CHECK(GetChangedShaders(Keys, NewKeys) == std::vector<std::string>({ "Tonemap.hlsl" }));
+
+	// a new include is picked up: the include list comes from the edited file
+	WriteTextFile(Sources.Directory + "Fullscreen.hlsl", "#include \"Color.hlsl\"\nfloat4 PSMain() : SV_TARGET { return Luminance(0); }\n");
+	Cache.InvalidateSourceFiles({ Sources.Directory + "Fullscreen.hlsl" });
+	const std::unordered_map<std::string, uint64> KeysWithNewInclude = Sources.GetShaderKeys(Cache);
+	VQ_CHECK(GetChangedShaders(NewKeys, KeysWithNewInclude) == std::vector<std::string>({ "Fullscreen.hlsl" }));
+	VQ_CHECK(Cache.DependsOnAny(Sources.Directory + "Fullscreen.hlsl", { ColorFile }));
+
+	// the comment lines are skipped: an #include in a comment isn't a dependency
+	WriteTextFile(Sources.Directory + "Fullscreen.hlsl", "//#include \"Color.hlsl\"\nfloat4 PSMain() : SV_TARGET { return 0; }\n");
+	Cache.InvalidateSourceFiles({ Sources.Directory + "Fullscreen.hlsl" });
+	Cache.GetShaderKey(MakeCompileDesc(Sources.Directory + "Fullscreen.hlsl"));
+	VQ_CHECK(!Cache.DependsOnAny(Sources.Directory + "Fullscreen.hlsl", { ColorFile }));
+}
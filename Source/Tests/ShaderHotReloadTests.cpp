@@ -0,0 +1,285 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/FileWatcher.h"
+#include "Source/Renderer/PipelineSwapQueue.h"
+#include "Source/Renderer/DeferredDeletionQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stands in for the PSOs: the swap protocol is the same for any pipeline type
+struct FFakePipeline
+{
+	uint64 PipelineID = 0;
+	int    Version = 0;
+};
+
+// The renderer side of the swap: the bound pipeline of each ID, & the pipelines released by the queue
+struct FFakePipelineTable
+{
+	std::vector<std::unique_ptr<FFakePipeline>> Pipelines; // owns every pipeline created by the test
+	std::vector<FFakePipeline*>                 Bound;     // indexed by the pipeline ID
+	std::vector<FFakePipeline*>                 Released;
+
+	FFakePipeline* Create(uint64 PipelineID, int Version)
+	{
+		Pipelines.push_back(std::make_unique<FFakePipeline>(FFakePipeline{ PipelineID, Version }));
+		return Pipelines.back().get();
+	}
+	FFakePipeline* Swap(uint64 PipelineID, FFakePipeline* pNewPipeline)
+	{
+		VQ_CHECK(pNewPipeline->PipelineID == PipelineID);
+		FFakePipeline* pOld = Bound[PipelineID];
+		Bound[PipelineID] = pNewPipeline;
+		return pOld;
+	}
+	void Release(FFakePipeline* p)
+	{
+		VQ_CHECK(std::find(Released.begin(), Released.end(), p) == Released.end()); // released once
+		VQ_CHECK(std::find(Bound.begin(), Bound.end(), p) == Bound.end());           // never while bound
+		Released.push_back(p);
+	}
+	inline bool IsReleased(const FFakePipeline* p) const { return std::find(Released.begin(), Released.end(), p) != Released.end(); }
+
+	PipelineSwapQueue<FFakePipeline>::SwapFn_t    GetSwapFn()    { return [this](uint64 ID, FFakePipeline* p) { return Swap(ID, p); }; }
+	PipelineSwapQueue<FFakePipeline>::ReleaseFn_t GetReleaseFn() { return [this](FFakePipeline* p) { Release(p); }; }
+};
+
+// a compile the test finishes by hand, nullptr for a compile error
+struct FFakeCompile
+{
+	std::promise<FFakePipeline*> Promise;
+	std::shared_future<FFakePipeline*> Future = Promise.get_future().share();
+};
+
+static void WriteTextFile(const std::string& FilePath, const std::string& Text)
+{
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	File << Text;
+}
+
+static bool Contains(const std::vector<std::string>& Files, const std::string& File)
+{
+	return std::find(Files.begin(), Files.end(), File) != Files.end();
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(PipelineSwapQueue_SwapsOnlyFinishedCompiles)
+{
+	FFakePipelineTable Table;
+	Table.Bound = { Table.Create(0, 0), Table.Create(1, 0) };
+	PipelineSwapQueue<FFakePipeline> Queue;
+
+	FFakeCompile Compile0, Compile1;
+	Queue.Enqueue(0, Compile0.Future);
+	Queue.Enqueue(1, Compile1.Future);
+
+	PipelineSwapQueue<FFakePipeline>::FSwapResult Result = Queue.SwapReady(1, Table.GetSwapFn());
+	VQ_CHECK(Result.NumSwapped == 0 && Result.NumFailed == 0);
+	VQ_CHECK(Queue.GetNumPending() == 2);
+
+	FFakePipeline* pNew1 = Table.Create(1, 1);
+	Compile1.Promise.set_value(pNew1);
+	Result = Queue.SwapReady(1, Table.GetSwapFn());
+	VQ_CHECK(Result.NumSwapped == 1);
+	VQ_CHECK(Table.Bound[1] == pNew1);
+	VQ_CHECK(Table.Bound[0]->Version == 0);
+	VQ_CHECK(Queue.GetNumPending() == 1);
+	VQ_CHECK(Queue.GetNumRetired() == 1);
+
+	Compile0.Promise.set_value(Table.Create(0, 1));
+	Queue.ReleaseAll(Table.GetReleaseFn());
+	VQ_CHECK(Table.Released.size() == 2); // the replaced v0 of pipeline 1 & the never swapped v1 of pipeline 0
+}
+
+VQ_TEST(PipelineSwapQueue_FailedCompileKeepsThePipeline)
+{
+	FFakePipelineTable Table;
+	FFakePipeline* pOriginal = Table.Create(0, 0);
+	Table.Bound = { pOriginal };
+	PipelineSwapQueue<FFakePipeline> Queue;
+
+	FFakeCompile Compile;
+	Queue.Enqueue(0, Compile.Future);
+	Compile.Promise.set_value(nullptr);
+
+	const PipelineSwapQueue<FFakePipeline>::FSwapResult Result = Queue.SwapReady(1, Table.GetSwapFn());
+	VQ_CHECK(Result.NumSwapped == 0);
+	VQ_CHECK(Result.NumFailed == 1);
+	VQ_CHECK(Table.Bound[0] == pOriginal);
+	VQ_CHECK(Queue.GetNumPending() == 0);
+	VQ_CHECK(Queue.GetNumRetired() == 0);
+	VQ_CHECK(Queue.ReleaseRetired(~0ull, Table.GetReleaseFn()) == 0);
+	VQ_CHECK(Table.Released.empty());
+}
+
+VQ_TEST(PipelineSwapQueue_SupersededCompileIsNeverBound)
+{
+	FFakePipelineTable Table;
+	FFakePipeline* pOriginal = Table.Create(0, 0);
+	Table.Bound = { pOriginal };
+	PipelineSwapQueue<FFakePipeline> Queue;
+
+	// the shader is saved twice: the 2nd compile supersedes the 1st, whichever finishes first
+	FFakeCompile Older, Newer;
+	Queue.Enqueue(0, Older.Future);
+	Queue.Enqueue(0, Newer.Future);
+
+	FFakePipeline* pOlder = Table.Create(0, 1);
+	Older.Promise.set_value(pOlder);
+	PipelineSwapQueue<FFakePipeline>::FSwapResult Result = Queue.SwapReady(5, Table.GetSwapFn());
+	VQ_CHECK(Result.NumSwapped == 0);
+	VQ_CHECK(Table.Bound[0] == pOriginal);
+
+	// never bound: doesn't wait for any frame to complete
+	VQ_CHECK(Queue.ReleaseRetired(0, Table.GetReleaseFn()) == 1);
+	VQ_CHECK(Table.IsReleased(pOlder));
+
+	FFakePipeline* pNewer = Table.Create(0, 2);
+	Newer.Promise.set_value(pNewer);
+	Result = Queue.SwapReady(5, Table.GetSwapFn());
+	VQ_CHECK(Result.NumSwapped == 1);
+	VQ_CHECK(Table.Bound[0] == pNewer);
+
+	// a failed newer compile still supersedes the older one: the pipeline stays at its current version
+	FFakeCompile Succeeds, Fails;
+	Queue.Enqueue(0, Succeeds.Future);
+	Queue.Enqueue(0, Fails.Future);
+	FFakePipeline* pSuperseded = Table.Create(0, 3);
+	Succeeds.Promise.set_value(pSuperseded);
+	Fails.Promise.set_value(nullptr);
+	Result = Queue.SwapReady(6, Table.GetSwapFn());
+	VQ_CHECK(Result.NumSwapped == 0 && Result.NumFailed == 1);
+	VQ_CHECK(Table.Bound[0] == pNewer);
+
+	Queue.ReleaseAll(Table.GetReleaseFn());
+	VQ_CHECK(Table.IsReleased(pOriginal) && Table.IsReleased(pSuperseded) && !Table.IsReleased(pNewer));
+}
+
+VQ_TEST(PipelineSwapQueue_ReleasesOnceTheRecordingFrameCompletes)
+{
+	FFakePipelineTable Table;
+	FFakePipeline* pOriginal = Table.Create(0, 0);
+	Table.Bound = { pOriginal };
+	PipelineSwapQueue<FFakePipeline> Queue;
+
+	FrameFenceTracker Fences;
+	uint64 CompletedValue = 0;
+	const uint NumFramesInFlight = 3;
+	auto fnSubmitFrame = [&]()
+	{
+		const uint64 Signaled = Fences.OnFrameSubmitted();
+		if (Signaled > NumFramesInFlight)
+			CompletedValue = Signaled - NumFramesInFlight;
+	};
+	for (int i = 0; i < 10; ++i)
+		fnSubmitFrame();
+
+	// swapped at the start of a frame: the frames in flight & the one being recorded may reference the old pipeline
+	FFakeCompile Compile;
+	Queue.Enqueue(0, Compile.Future);
+	Compile.Promise.set_value(Table.Create(0, 1));
+	const uint64 RetireFence = Fences.GetRecordingFrameFence();
+	VQ_CHECK(Queue.SwapReady(RetireFence, Table.GetSwapFn()).NumSwapped == 1);
+
+	while (CompletedValue < RetireFence)
+	{
+		VQ_CHECK(Queue.ReleaseRetired(CompletedValue, Table.GetReleaseFn()) == 0);
+		VQ_CHECK(!Table.IsReleased(pOriginal));
+		fnSubmitFrame();
+	}
+	VQ_CHECK(CompletedValue == RetireFence);
+	VQ_CHECK(Queue.ReleaseRetired(CompletedValue, Table.GetReleaseFn()) == 1);
+	VQ_CHECK(Table.IsReleased(pOriginal));
+	VQ_CHECK(Queue.GetNumRetired() == 0);
+}
+
+VQ_TEST(FileWatcher_ReportsSettledChanges)
+{
+	const std::string Directory = Tests::CreateTempDirectory("FileWatcher");
+	const std::string ShaderFile  = Directory + "Shader.hlsl";
+	const std::string IncludeFile = Directory + "Include.hlsl";
+	WriteTextFile(ShaderFile, "float4 PSMain() : SV_TARGET { return 0; }");
+	WriteTextFile(IncludeFile, "#define X 1");
+
+	FileWatcher Watcher;
+	Watcher.Initialize({ ShaderFile, IncludeFile }, 0);
+	VQ_CHECK(Watcher.GetNumWatchedFiles() == 2);
+	VQ_CHECK(Watcher.PollChanges().empty());
+
+	// the size changes too, the write time resolution of the file system doesn't matter
+	WriteTextFile(ShaderFile, "float4 PSMain() : SV_TARGET { return 1.0f; }");
+	VQ_CHECK(Watcher.PollChanges().empty()); // waits a poll for the file to settle
+	std::vector<std::string> Changes = Watcher.PollChanges();
+	VQ_CHECK(Changes.size() == 1 && Contains(Changes, ShaderFile));
+	VQ_CHECK(Watcher.PollChanges().empty()); // reported once
+
+	// an editor writing in steps: only the final state is reported
+	WriteTextFile(IncludeFile, "");
+	VQ_CHECK(Watcher.PollChanges().empty());
+	WriteTextFile(IncludeFile, "#define X 22");
+	VQ_CHECK(Watcher.PollChanges().empty());
+	Changes = Watcher.PollChanges();
+	VQ_CHECK(Changes.size() == 1 && Contains(Changes, IncludeFile));
+
+	// files added later are watched from their current state
+	const std::string NewIncludeFile = Directory + "NewInclude.hlsl";
+	WriteTextFile(NewIncludeFile, "#define Y 1");
+	Watcher.AddFiles({ ShaderFile, NewIncludeFile });
+	VQ_CHECK(Watcher.GetNumWatchedFiles() == 3);
+	VQ_CHECK(Watcher.PollChanges().empty());
+	WriteTextFile(NewIncludeFile, "#define Y 100");
+	Watcher.PollChanges();
+	Changes = Watcher.PollChanges();
+	VQ_CHECK(Changes.size() == 1 && Contains(Changes, NewIncludeFile));
+
+	Watcher.Exit();
+}
+
+VQ_TEST(FileWatcher_PollingThread)
+{
+	const std::string Directory = Tests::CreateTempDirectory("FileWatcherThread");
+	const std::string ShaderFile = Directory + "Shader.hlsl";
+	WriteTextFile(ShaderFile, "a");
+
+	FileWatcher Watcher;
+	Watcher.Initialize({ ShaderFile }, 5);
+	WriteTextFile(ShaderFile, "abc");
+
+	std::vector<std::string> Changes;
+	for (int i = 0; i < 400 && Changes.empty(); ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		Changes = Watcher.PopChangedFiles();
+	}
+	VQ_CHECK(Changes.size() == 1 && Contains(Changes, ShaderFile));
+	Watcher.Exit();
+}
@@ -0,0 +1,66 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#pragma once
+
+#include "Source/Engine/Core/Types.h"
+
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------
+// VQETests
+//----------------------------------------------------------------------------------------------------------------
+// Self-registering tests & benchmarks of the engine & renderer systems that run w/o a GPU or a window.
+// The tests check the behavior w/ fake clocks, fences & backends; the benchmarks run synthetic workloads
+// and log their timings. See Main.cpp for the command line.
+namespace Tests
+{
+	using Func_t = void(*)();
+
+	enum class ECaseType
+	{
+		TEST = 0,
+		BENCHMARK,
+
+		NUM_CASE_TYPES
+	};
+
+	struct FRegistrar
+	{
+		FRegistrar(ECaseType Type, const char* pName, Func_t pFunc);
+	};
+
+	void ReportFailure(const char* pFile, int Line, const char* pExpression); // fails the running test
+
+	// empty <OS temp dir>/VQETests/<pName>/ for the tests' files, w/ a trailing separator
+	std::string CreateTempDirectory(const char* pName);
+}
+
+#define VQ_TEST(Name)\
+	static void Test_##Name();\
+	static const Tests::FRegistrar sRegistrar_Test_##Name(Tests::ECaseType::TEST, #Name, &Test_##Name);\
+	static void Test_##Name()
+
+#define VQ_BENCHMARK(Name)\
+	static void Benchmark_##Name();\
+	static const Tests::FRegistrar sRegistrar_Benchmark_##Name(Tests::ECaseType::BENCHMARK, #Name, &Benchmark_##Name);\
+	static void Benchmark_##Name()
+
+#define VQ_CHECK(Expression)\
+	do { if (!(Expression)) Tests::ReportFailure(__FILE__, __LINE__, #Expression); } while (0)
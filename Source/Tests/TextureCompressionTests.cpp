@@ -0,0 +1,369 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/TextureCache.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Reference decoders for the cooked blocks: the size/quality numbers are measured w/o a GPU
+static void DecodeBC1Block(const uint8* pBlock, uint8 Out[16][4])
+{
+	const uint16 c0 = static_cast<uint16>(pBlock[0] | (pBlock[1] << 8));
+	const uint16 c1 = static_cast<uint16>(pBlock[2] | (pBlock[3] << 8));
+	int Palette[4][4];
+	for (int p = 0; p < 2; ++p)
+	{
+		const uint16 c = p == 0 ? c0 : c1;
+		const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		Palette[p][0] = (r << 3) | (r >> 2);
+		Palette[p][1] = (g << 2) | (g >> 4);
+		Palette[p][2] = (b << 3) | (b >> 2);
+		Palette[p][3] = 255;
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		Palette[2][c] = c0 > c1 ? (2 * Palette[0][c] + Palette[1][c]) / 3 : (Palette[0][c] + Palette[1][c]) / 2;
+		Palette[3][c] = c0 > c1 ? (Palette[0][c] + 2 * Palette[1][c]) / 3 : 0;
+	}
+	Palette[2][3] = 255;
+	Palette[3][3] = c0 > c1 ? 255 : 0;
+
+	const uint32 Indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (uint32(pBlock[7]) << 24);
+	for (int i = 0; i < 16; ++i)
+	for (int c = 0; c < 4; ++c)
+		Out[i][c] = static_cast<uint8>(Palette[(Indices >> (2 * i)) & 3][c]);
+}
+
+static void DecodeBC4Block(const uint8* pBlock, uint8 Out[16])
+{
+	const int v0 = pBlock[0];
+	const int v1 = pBlock[1];
+	int Palette[8] = { v0, v1 };
+	for (int k = 1; k <= 6; ++k)
+		Palette[k + 1] = v0 > v1 ? ((7 - k) * v0 + k * v1 + 3) / 7 : 0;
+	if (v0 <= v1)
+	{
+		for (int k = 1; k <= 4; ++k)
+			Palette[k + 1] = ((5 - k) * v0 + k * v1 + 2) / 5;
+		Palette[6] = 0;
+		Palette[7] = 255;
+	}
+
+	uint64 Indices = 0;
+	for (int b = 0; b < 6; ++b)
+		Indices |= uint64(pBlock[2 + b]) << (8 * b);
+	for (int i = 0; i < 16; ++i)
+		Out[i] = static_cast<uint8>(Palette[(Indices >> (3 * i)) & 7]);
+}
+
+// Decodes the top mip of a cooked texture to RGBA8, BC4/BC5 leave the missing channels 0 (A: 255) like the GPU
+static std::vector<uint8> DecodeTopMip(const FCookedTexture& Texture)
+{
+	const uint W = Texture.Width;
+	const uint H = Texture.Height;
+	std::vector<uint8> RGBA8(size_t(W) * H * 4);
+	if (Texture.Format == DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		memcpy(RGBA8.data(), Texture.GetMipData(0), RGBA8.size());
+		return RGBA8;
+	}
+
+	const size_t BlockSize = (Texture.Format == DXGI_FORMAT_BC1_UNORM || Texture.Format == DXGI_FORMAT_BC4_UNORM) ? 8 : 16;
+	const uint NumBlocksX = W / 4;
+	const uint NumBlocksY = H / 4;
+	uint8 Texels[16][4];
+	uint8 Channel[16];
+	for (uint by = 0; by < NumBlocksY; ++by)
+	for (uint bx = 0; bx < NumBlocksX; ++bx)
+	{
+		const uint8* pBlock = Texture.GetMipData(0) + (by * NumBlocksX + bx) * BlockSize;
+		memset(Texels, 0, sizeof(Texels));
+		switch (Texture.Format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			DecodeBC1Block(pBlock, Texels);
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+			DecodeBC1Block(pBlock + 8, Texels);
+			DecodeBC4Block(pBlock, Channel);
+			for (int i = 0; i < 16; ++i) Texels[i][3] = Channel[i];
+			break;
+		case DXGI_FORMAT_BC4_UNORM:
+			DecodeBC4Block(pBlock, Channel);
+			for (int i = 0; i < 16; ++i) { Texels[i][0] = Channel[i]; Texels[i][3] = 255; }
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+			DecodeBC4Block(pBlock, Channel);
+			for (int i = 0; i < 16; ++i) Texels[i][0] = Channel[i];
+			DecodeBC4Block(pBlock + 8, Channel);
+			for (int i = 0; i < 16; ++i) { Texels[i][1] = Channel[i]; Texels[i][3] = 255; }
+			break;
+		default:
+			VQ_CHECK(false);
+			break;
+		}
+		for (uint i = 0; i < 16; ++i)
+			memcpy(&RGBA8[((by * 4 + i / 4) * W + bx * 4 + i % 4) * 4], Texels[i], 4);
+	}
+	return RGBA8;
+}
+
+// PSNR in dB over the channels the format stores, 99 for a lossless match
+static double CalculatePSNR(const std::vector<uint8>& Reference, const std::vector<uint8>& Decoded, int NumChannels)
+{
+	double SquaredError = 0.0;
+	const size_t NumTexels = Reference.size() / 4;
+	for (size_t i = 0; i < NumTexels; ++i)
+	for (int c = 0; c < NumChannels; ++c)
+	{
+		const double d = double(Reference[i * 4 + c]) - double(Decoded[i * 4 + c]);
+		SquaredError += d * d;
+	}
+	const double MSE = SquaredError / (double(NumTexels) * NumChannels);
+	return MSE == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / MSE);
+}
+
+// mean angle in degrees between the source normals & the BC5 normals w/ Z reconstructed like ReconstructPackedNormalZ()
+static double CalculateMeanNormalErrorDegrees(const std::vector<uint8>& Reference, const std::vector<uint8>& Decoded)
+{
+	auto fnUnpack = [](const uint8* p, bool bReconstructZ, float n[3])
+	{
+		n[0] = p[0] / 255.0f * 2.0f - 1.0f;
+		n[1] = p[1] / 255.0f * 2.0f - 1.0f;
+		n[2] = bReconstructZ ? std::sqrt(std::max(0.0f, 1.0f - n[0] * n[0] - n[1] * n[1])) : p[2] / 255.0f * 2.0f - 1.0f;
+		const float Length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int c = 0; c < 3; ++c) n[c] /= Length;
+	};
+
+	double SumDegrees = 0.0;
+	const size_t NumTexels = Reference.size() / 4;
+	for (size_t i = 0; i < NumTexels; ++i)
+	{
+		float a[3], b[3];
+		fnUnpack(&Reference[i * 4], false, a);
+		fnUnpack(&Decoded[i * 4], true, b);
+		const float CosAngle = std::clamp(a[0] * b[0] + a[1] * b[1] + a[2] * b[2], -1.0f, 1.0f);
+		SumDegrees += std::acos(CosAngle) * 180.0 / 3.14159265358979;
+	}
+	return SumDegrees / NumTexels;
+}
+
+enum class ESyntheticImage { ALBEDO, NORMAL_MAP, MASK };
+
+// smooth gradients w/ some high frequency detail & noise, roughly what the material textures look like
+static std::vector<uint8> CreateSyntheticImage(ESyntheticImage Type, uint W, uint H)
+{
+	std::vector<uint8> RGBA8(size_t(W) * H * 4);
+	std::mt19937 Rng(W * 31 + H);
+	std::uniform_int_distribution<int> Noise(-4, 4);
+	auto fnUNorm = [](float v) { return static_cast<uint8>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+	for (uint y = 0; y < H; ++y)
+	for (uint x = 0; x < W; ++x)
+	{
+		const float u = float(x) / W;
+		const float v = float(y) / H;
+		const float Detail = 0.5f + 0.5f * std::sin(u * 60.0f) * std::cos(v * 45.0f);
+		uint8* p = &RGBA8[(size_t(y) * W + x) * 4];
+		switch (Type)
+		{
+		case ESyntheticImage::ALBEDO:
+			p[0] = fnUNorm(0.6f * u + 0.3f * Detail + Noise(Rng) / 255.0f);
+			p[1] = fnUNorm(0.5f * v + 0.2f * Detail + Noise(Rng) / 255.0f);
+			p[2] = fnUNorm(0.3f + 0.4f * (1.0f - u) * v + Noise(Rng) / 255.0f);
+			p[3] = 255;
+			break;
+		case ESyntheticImage::NORMAL_MAP: // tangent space normals of a bumpy height field
+		{
+			const float dx = 0.6f * std::cos(u * 60.0f) * std::cos(v * 45.0f) + Noise(Rng) / 128.0f;
+			const float dy = -0.6f * std::sin(u * 60.0f) * std::sin(v * 45.0f) + Noise(Rng) / 128.0f;
+			const float InvLength = 1.0f / std::sqrt(dx * dx + dy * dy + 1.0f);
+			p[0] = fnUNorm(-dx * InvLength * 0.5f + 0.5f);
+			p[1] = fnUNorm(-dy * InvLength * 0.5f + 0.5f);
+			p[2] = fnUNorm(InvLength * 0.5f + 0.5f);
+			p[3] = 255;
+		} break;
+		case ESyntheticImage::MASK:
+			p[0] = p[1] = p[2] = fnUNorm(0.2f + 0.6f * Detail * v + Noise(Rng) / 255.0f);
+			p[3] = fnUNorm(0.25f + 0.5f * u + 0.25f * Detail); // exercises the BC3 alpha block
+			break;
+		}
+	}
+	return RGBA8;
+}
+
+struct FCompressionCase
+{
+	const char*         pName;
+	ETextureCompression Compression;
+	ESyntheticImage     Image;
+	DXGI_FORMAT         ExpectedFormat;
+	int                 NumChannels;  // measured channels
+	size_t              BytesPerBlock;
+	double              MinPSNR;      // quality floor of the test, the benchmark logs the measured values
+};
+static const FCompressionCase COMPRESSION_CASES[] =
+{
+	{ "BC1 albedo" , ETextureCompression::BC1_BC3, ESyntheticImage::ALBEDO    , DXGI_FORMAT_BC1_UNORM, 3, 8 , 30.0 },
+	{ "BC3 rgba"   , ETextureCompression::BC1_BC3, ESyntheticImage::MASK      , DXGI_FORMAT_BC3_UNORM, 4, 16, 30.0 },
+	{ "BC4 mask"   , ETextureCompression::BC4    , ESyntheticImage::MASK      , DXGI_FORMAT_BC4_UNORM, 1, 8 , 35.0 },
+	{ "BC5 normals", ETextureCompression::BC5    , ESyntheticImage::NORMAL_MAP, DXGI_FORMAT_BC5_UNORM, 2, 16, 35.0 },
+};
+
+VQ_TEST(TextureCompression_CookedSize)
+{
+	const uint W = 256;
+	const uint H = 128;
+	for (const FCompressionCase& c : COMPRESSION_CASES)
+	{
+		const std::vector<uint8> Image = CreateSyntheticImage(c.Image, W, H);
+		FCookedTexture Uncompressed;
+		FCookedTexture Cooked;
+		VQ_CHECK(TextureCache::CookTexture(Image.data(), W, H, ETextureCompression::NONE, true, false, Uncompressed));
+		VQ_CHECK(TextureCache::CookTexture(Image.data(), W, H, c.Compression, true, false, Cooked));
+		VQ_CHECK(Cooked.Format == c.ExpectedFormat);
+		VQ_CHECK(Cooked.MipCount == Uncompressed.MipCount);
+		VQ_CHECK(TextureCache::GetMipSize(Cooked, 0) == size_t(W / 4) * (H / 4) * c.BytesPerBlock);
+
+		// 4bpp / 8bpp vs RGBA8's 32bpp, the mips smaller than a block are padded to a whole block
+		VQ_CHECK(TextureCache::GetMipSize(Uncompressed, 0) == TextureCache::GetMipSize(Cooked, 0) * (64 / c.BytesPerBlock));
+		VQ_CHECK(Cooked.Data.size() * (64 / c.BytesPerBlock) >= Uncompressed.Data.size());
+		VQ_CHECK(Cooked.Data.size() * (64 / c.BytesPerBlock) <  Uncompressed.Data.size() * 2);
+	}
+
+	// sizes that can't be block compressed are rejected rather than cooked w/ garbage edges
+	const std::vector<uint8> Odd = CreateSyntheticImage(ESyntheticImage::ALBEDO, 30, 30);
+	FCookedTexture Rejected;
+	VQ_CHECK(!TextureCache::CookTexture(Odd.data(), 30, 30, ETextureCompression::BC1, true, false, Rejected));
+}
+
+VQ_TEST(TextureCompression_Quality)
+{
+	const uint W = 256;
+	const uint H = 256;
+	for (const FCompressionCase& c : COMPRESSION_CASES)
+	{
+		const std::vector<uint8> Image = CreateSyntheticImage(c.Image, W, H);
+		FCookedTexture Cooked;
+		VQ_CHECK(TextureCache::CookTexture(Image.data(), W, H, c.Compression, false, false, Cooked));
+		const double PSNR = CalculatePSNR(Image, DecodeTopMip(Cooked), c.NumChannels);
+		if (PSNR < c.MinPSNR)
+			Log::Error("  %s: PSNR=%.2fdB < %.2fdB", c.pName, PSNR, c.MinPSNR);
+		VQ_CHECK(PSNR >= c.MinPSNR);
+	}
+
+	// BC5 drops Z: the normals the shaders reconstruct should stay within a degree of the source on average
+	const std::vector<uint8> NormalMap = CreateSyntheticImage(ESyntheticImage::NORMAL_MAP, W, H);
+	FCookedTexture Cooked;
+	VQ_CHECK(TextureCache::CookTexture(NormalMap.data(), W, H, ETextureCompression::BC5, false, false, Cooked));
+	VQ_CHECK(CalculateMeanNormalErrorDegrees(NormalMap, DecodeTopMip(Cooked)) < 1.0);
+
+	// the uncompressed cook is lossless
+	FCookedTexture Uncompressed;
+	VQ_CHECK(TextureCache::CookTexture(NormalMap.data(), W, H, ETextureCompression::NONE, false, false, Uncompressed));
+	VQ_CHECK(CalculatePSNR(NormalMap, DecodeTopMip(Uncompressed), 4) == 99.0);
+}
+
+VQ_TEST(TextureCache_FileHashCacheSkipsUnchangedFiles)
+{
+	const std::string Directory = Tests::CreateTempDirectory("TextureCache_FileHashCacheSkipsUnchangedFiles");
+	const std::string FilePath = Directory + "Albedo.png";
+	auto fnWriteFile = [&](const std::string& Contents)
+	{
+		std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+		File << Contents;
+	};
+	const std::string Contents = "not really a png";
+	fnWriteFile(Contents);
+
+	const uint64 Hash = TextureCache::HashFile(FilePath);
+	VQ_CHECK(Hash != 0);
+	VQ_CHECK(Hash == TextureCache::HashMemory(Contents.data(), Contents.size())); // the async loads hash the file contents they've read
+	VQ_CHECK(TextureCache::HashFile(Directory + "Missing.png") == 0);
+	{
+		FileHashCache Cache;
+		Cache.Initialize(Directory);
+		VQ_CHECK(Cache.HashFile(FilePath) == Hash);
+		VQ_CHECK(Cache.HashFile(FilePath) == Hash);
+		VQ_CHECK(Cache.HashFile(Directory + "Missing.png") == 0);
+		VQ_CHECK(Cache.GetStats().NumFilesHashed == 1);
+		Cache.SaveIndex();
+	}
+
+	// next run: only stat'ed
+	{
+		FileHashCache Cache;
+		Cache.Initialize(Directory);
+		VQ_CHECK(Cache.HashFile(FilePath) == Hash);
+		VQ_CHECK(Cache.GetStats().NumFilesHashed == 0 && Cache.GetStats().NumFiles == 1);
+	}
+
+	// an edited file is re-hashed: same size, the write time changes
+	const std::string Edited = "not really a PNG";
+	fnWriteFile(Edited);
+	std::filesystem::last_write_time(FilePath, std::filesystem::last_write_time(FilePath) + std::chrono::seconds(1));
+	FileHashCache Cache;
+	Cache.Initialize(Directory);
+	VQ_CHECK(Cache.HashFile(FilePath) == TextureCache::HashMemory(Edited.data(), Edited.size()));
+	VQ_CHECK(Cache.GetStats().NumFilesHashed == 1);
+}
+
+VQ_BENCHMARK(TextureCompression)
+{
+	for (uint Size : { 1024u, 2048u })
+	{
+		Log::Info("  %ux%u w/ mips:", Size, Size);
+		for (const FCompressionCase& c : COMPRESSION_CASES)
+		{
+			const std::vector<uint8> Image = CreateSyntheticImage(c.Image, Size, Size);
+			FCookedTexture Uncompressed;
+			FCookedTexture Cooked;
+			TextureCache::CookTexture(Image.data(), Size, Size, ETextureCompression::NONE, true, false, Uncompressed);
+
+			const auto t0 = std::chrono::high_resolution_clock::now();
+			const bool bCooked = TextureCache::CookTexture(Image.data(), Size, Size, c.Compression, true, false, Cooked);
+			const auto t1 = std::chrono::high_resolution_clock::now();
+			VQ_CHECK(bCooked);
+
+			const double CookMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+			const double PSNR = CalculatePSNR(Image, DecodeTopMip(Cooked), c.NumChannels);
+			Log::Info("    %-12s: %7.2fMB vs RGBA8 %7.2fMB (%4.1f%%) | PSNR=%5.2fdB | cook=%8.2fms"
+				, c.pName
+				, Cooked.Data.size() / (1024.0 * 1024.0)
+				, Uncompressed.Data.size() / (1024.0 * 1024.0)
+				, 100.0 * Cooked.Data.size() / Uncompressed.Data.size()
+				, PSNR
+				, CookMs
+			);
+			if (c.Compression == ETextureCompression::BC5)
+				Log::Info("    %-12s: mean normal error=%.3f degrees", "", CalculateMeanNormalErrorDegrees(Image, DecodeTopMip(Cooked)));
+		}
+	}
+}
@@ -0,0 +1,337 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/TextureResidency.h"
+#include "Source/Renderer/TextureUploadQueue.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+struct FFakeTextureUploadDesc
+{
+	TextureID id = INVALID_ID;
+	std::shared_ptr<TextureResidencyPromise> pResidencyPromise;
+	bool bFitsInUploadHeap = true;
+};
+using FakeTextureUploadQueue = TextureUploadQueue<FFakeTextureUploadDesc>;
+
+// Stands in for the GPU side of VQRenderer's texture uploads: recording an upload takes CopyLatency, the uploads
+// that don't fit in the upload heap aren't recorded. The submitted batches complete right away unless the GPU is
+// held, then they complete on CompleteBatches(). While paused, the upload thread blocks in RecordTextureUpload().
+class FakeUploadBackend : public FakeTextureUploadQueue::IBackend
+{
+public:
+	FakeUploadBackend(std::chrono::microseconds CopyLatency, bool bPaused = false, bool bHoldGPU = false)
+		: mCopyLatency(CopyLatency), mbPaused(bPaused), mbHoldGPU(bHoldGPU) {}
+
+	FTextureResidencyHandle CreateTextureAsync(FakeTextureUploadQueue& Queue, bool bFitsInUploadHeap = true)
+	{
+		FFakeTextureUploadDesc desc;
+		desc.id = mNextID.fetch_add(1);
+		desc.pResidencyPromise = std::make_shared<TextureResidencyPromise>();
+		desc.bFitsInUploadHeap = bFitsInUploadHeap;
+
+		const FTextureResidencyHandle Handle = FTextureResidencyHandle::Create(desc.id, desc.pResidencyPromise);
+		Queue.Enqueue(std::move(desc));
+		Queue.StartUploads();
+		return Handle;
+	}
+
+	void Resume()          { { std::lock_guard<std::mutex> lk(mMtx); mbPaused = false; } mCV.notify_all(); }
+	void CompleteBatches() { { std::lock_guard<std::mutex> lk(mMtx); mCompletedFence = mSubmittedFence; mbHoldGPU = false; } mCV.notify_all(); }
+
+	void WaitForSubmittedBatches(uint64 NumBatches) { std::unique_lock<std::mutex> lk(mMtx); mCV.wait(lk, [&]() { return mSubmittedFence >= NumBatches; }); }
+	bool IsResidentOnBackend(TextureID id) const    { std::lock_guard<std::mutex> lk(mMtx); return mResidentIDs.count(id) != 0; }
+
+	std::atomic<int>      NumRecorded = 0;
+	std::atomic<int>      NumDiscarded = 0;
+	std::function<void()> fnOnSubmit; // called on the upload thread after a batch is submitted
+
+	//
+	// IBackend
+	//
+	bool RecordTextureUpload(FFakeTextureUploadDesc& desc) override
+	{
+		{
+			std::unique_lock<std::mutex> lk(mMtx);
+			mCV.wait(lk, [&]() { return !mbPaused; });
+		}
+		if (!desc.bFitsInUploadHeap)
+			return false;
+		std::this_thread::sleep_for(mCopyLatency);
+		++NumRecorded;
+		return true;
+	}
+	uint64 SubmitTextureUploads() override
+	{
+		uint64 FenceValue = 0;
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			FenceValue = ++mSubmittedFence;
+			if (!mbHoldGPU)
+				mCompletedFence = mSubmittedFence;
+		}
+		mCV.notify_all();
+		if (fnOnSubmit)
+			fnOnSubmit();
+		return FenceValue;
+	}
+	bool IsTextureUploadBatchComplete(uint64 FenceValue) override { std::lock_guard<std::mutex> lk(mMtx); return mCompletedFence >= FenceValue; }
+	void WaitForTextureUploadBatch(uint64 FenceValue) override    { std::unique_lock<std::mutex> lk(mMtx); mCV.wait(lk, [&]() { return mCompletedFence >= FenceValue; }); }
+	void OnTextureResident(TextureID id) override                 { std::lock_guard<std::mutex> lk(mMtx); mResidentIDs.insert(id); }
+	void DiscardTextureUpload(FFakeTextureUploadDesc&) override   { ++NumDiscarded; }
+
+private:
+	std::chrono::microseconds mCopyLatency;
+	mutable std::mutex        mMtx;
+	std::condition_variable   mCV;
+	bool                      mbPaused = false;
+	bool                      mbHoldGPU = false;
+	uint64                    mSubmittedFence = 0;
+	uint64                    mCompletedFence = 0;
+	std::set<TextureID>       mResidentIDs;
+	std::atomic<TextureID>    mNextID = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(TextureResidency_NoUploadIsResident)
+{
+	FTextureResidencyHandle h; // e.g. render targets: nothing to upload
+	VQ_CHECK(h.IsUploadDone());
+	VQ_CHECK(h.IsResident());
+	VQ_CHECK(!h.IsUploadFailed());
+	VQ_CHECK(h.WaitForResidency());
+}
+
+VQ_TEST(TextureResidency_FailedHandle)
+{
+	const FTextureResidencyHandle h = FTextureResidencyHandle::Failed();
+	VQ_CHECK(h.ID == INVALID_ID);
+	VQ_CHECK(h.IsUploadDone());
+	VQ_CHECK(!h.IsResident());
+	VQ_CHECK(h.IsUploadFailed());
+	VQ_CHECK(!h.WaitForResidency());
+}
+
+VQ_TEST(TextureResidency_WorkersDontWaitOnTheUploads)
+{
+	constexpr int NUM_WORKERS = 4;
+	constexpr int NUM_TEXTURES_PER_WORKER = 16;
+	FakeUploadBackend Backend(std::chrono::microseconds(0), true); // nothing gets uploaded until Resume()
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+
+	std::vector<FTextureResidencyHandle> Handles[NUM_WORKERS];
+	std::vector<std::thread> Workers;
+	for (int i = 0; i < NUM_WORKERS; ++i)
+		Workers.emplace_back([&, i]() { for (int t = 0; t < NUM_TEXTURES_PER_WORKER; ++t) Handles[i].push_back(Backend.CreateTextureAsync(Queue)); });
+	for (std::thread& t : Workers)
+		t.join(); // would deadlock if the workers waited on residency
+
+	for (const std::vector<FTextureResidencyHandle>& v : Handles)
+	for (const FTextureResidencyHandle& h : v)
+		VQ_CHECK(h.ID != INVALID_ID && !h.IsUploadDone());
+
+	Backend.Resume();
+	for (const std::vector<FTextureResidencyHandle>& v : Handles)
+	for (const FTextureResidencyHandle& h : v)
+	{
+		VQ_CHECK(h.WaitForResidency());
+		VQ_CHECK(h.IsResident());
+		VQ_CHECK(Backend.IsResidentOnBackend(h.ID));
+	}
+	VQ_CHECK(Backend.NumRecorded == NUM_WORKERS * NUM_TEXTURES_PER_WORKER);
+}
+
+VQ_TEST(TextureResidency_FailedUploadsFailTheResidency)
+{
+	FakeUploadBackend Backend(std::chrono::microseconds(0));
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+	const FTextureResidencyHandle Fits = Backend.CreateTextureAsync(Queue);
+	const FTextureResidencyHandle DoesntFit = Backend.CreateTextureAsync(Queue, false);
+	VQ_CHECK(Fits.WaitForResidency());
+	VQ_CHECK(!DoesntFit.WaitForResidency());
+	VQ_CHECK(DoesntFit.IsUploadFailed());
+	VQ_CHECK(!Backend.IsResidentOnBackend(DoesntFit.ID));
+}
+
+VQ_TEST(TextureResidency_ResidentOnceTheBatchIsComplete)
+{
+	FakeUploadBackend Backend(std::chrono::microseconds(0), false, true); // the GPU doesn't complete the batches until CompleteBatches()
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+
+	const FTextureResidencyHandle h = Backend.CreateTextureAsync(Queue);
+	Backend.WaitForSubmittedBatches(1);
+	VQ_CHECK(!h.IsUploadDone()); // recorded & submitted, but not copied yet
+	VQ_CHECK(!Backend.IsResidentOnBackend(h.ID));
+
+	Backend.CompleteBatches();
+	VQ_CHECK(h.WaitForResidency());
+	VQ_CHECK(Backend.IsResidentOnBackend(h.ID));
+}
+
+VQ_TEST(TextureResidency_RecordsWhileTheGPUCopies)
+{
+	FakeUploadBackend Backend(std::chrono::microseconds(0), false, true);
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+
+	FTextureResidencyHandle h1;
+	Backend.fnOnSubmit = [&]() { if (h1.ID == INVALID_ID) h1 = Backend.CreateTextureAsync(Queue); }; // queued while the 1st batch is in flight
+	const FTextureResidencyHandle h0 = Backend.CreateTextureAsync(Queue);
+	Backend.WaitForSubmittedBatches(2); // would block if the upload thread waited on the 1st batch before recording the 2nd
+	VQ_CHECK(!h0.IsUploadDone() && !h1.IsUploadDone());
+
+	Backend.CompleteBatches();
+	VQ_CHECK(h0.WaitForResidency());
+	VQ_CHECK(h1.WaitForResidency());
+}
+
+VQ_TEST(TextureResidency_ContinuesOnTheUploads)
+{
+	FakeUploadBackend Backend(std::chrono::microseconds(0), false, true);
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+
+	std::atomic<int> NumCalls = 0;
+	std::promise<bool> Continued;
+	const FTextureResidencyHandle h = Backend.CreateTextureAsync(Queue);
+	h.OnUploadDone([&](bool bResident) { ++NumCalls; Continued.set_value(bResident); });
+	Backend.WaitForSubmittedBatches(1);
+	VQ_CHECK(NumCalls == 0); // the batch is still in flight
+
+	Backend.CompleteBatches();
+	VQ_CHECK(Continued.get_future().get()); // runs on the upload thread
+	VQ_CHECK(NumCalls == 1);
+
+	bool bResidentAfterTheUpload = false; // registered after the upload: runs right away
+	h.OnUploadDone([&](bool bResident) { bResidentAfterTheUpload = bResident; });
+	VQ_CHECK(bResidentAfterTheUpload);
+	VQ_CHECK(NumCalls == 1);
+
+	bool bFailedResident = true;
+	FTextureResidencyHandle::Failed().OnUploadDone([&](bool bResident) { bFailedResident = bResident; });
+	VQ_CHECK(!bFailedResident);
+
+	bool bNoUploadResident = false;
+	FTextureResidencyHandle().OnUploadDone([&](bool bResident) { bNoUploadResident = bResident; });
+	VQ_CHECK(bNoUploadResident);
+}
+
+VQ_TEST(TextureResidency_ExitFailsTheQueuedUploads)
+{
+	constexpr int NUM_TEXTURES = 8;
+	FakeUploadBackend Backend(std::chrono::microseconds(0), true);
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+
+	std::vector<FTextureResidencyHandle> Handles;
+	for (int i = 0; i < NUM_TEXTURES; ++i)
+		Handles.push_back(Backend.CreateTextureAsync(Queue));
+
+	// the upload thread may be blocked recording the 1st texture: exit, then let it finish the recording
+	std::thread ExitThread([&]() { Queue.Exit(); });
+	while (!Queue.IsExiting())
+		std::this_thread::yield();
+	Backend.Resume();
+	ExitThread.join();
+
+	int NumResident = 0;
+	for (const FTextureResidencyHandle& h : Handles)
+	{
+		VQ_CHECK(h.IsUploadDone());
+		if (h.WaitForResidency()) // no broken promise
+			++NumResident;
+	}
+	VQ_CHECK(NumResident <= 1);
+	VQ_CHECK(Backend.NumRecorded == NumResident);
+	VQ_CHECK(Backend.NumDiscarded == NUM_TEXTURES - NumResident); // the CPU data of the dropped uploads is freed
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Loads NumTextures w/ NumWorkers texture loading workers which decode for DecodeTime before creating each texture,
+// the upload thread takes CopyLatency per texture. bWaitForResidency: each worker waits for its texture to be
+// resident before decoding the next one, otherwise all the textures are waited on once at the end like the
+// scene load waiting for the material assignments. Returns the scene load wall time in ms.
+static double RunSceneLoad(int NumTextures, int NumWorkers, std::chrono::microseconds DecodeTime, std::chrono::microseconds CopyLatency, bool bWaitForResidency)
+{
+	using Clock = std::chrono::high_resolution_clock;
+	FakeUploadBackend Backend(CopyLatency);
+	FakeTextureUploadQueue Queue;
+	Queue.Start(&Backend);
+	std::vector<FTextureResidencyHandle> Handles(NumTextures);
+	std::atomic<int> NextTexture = 0;
+
+	const Clock::time_point Begin = Clock::now();
+	std::vector<std::thread> Workers;
+	for (int i = 0; i < NumWorkers; ++i)
+	{
+		Workers.emplace_back([&]()
+		{
+			for (int t = NextTexture.fetch_add(1); t < NumTextures; t = NextTexture.fetch_add(1))
+			{
+				const Clock::time_point DecodeEnd = Clock::now() + DecodeTime;
+				while (Clock::now() < DecodeEnd); // decoding keeps the worker busy
+
+				Handles[t] = Backend.CreateTextureAsync(Queue);
+				if (bWaitForResidency)
+					Handles[t].WaitForResidency();
+			}
+		});
+	}
+	for (std::thread& t : Workers)
+		t.join();
+	for (const FTextureResidencyHandle& h : Handles)
+		h.WaitForResidency();
+	return std::chrono::duration<double, std::milli>(Clock::now() - Begin).count();
+}
+
+VQ_BENCHMARK(SceneLoadTextureResidency)
+{
+	const int NumTextures = 128;
+	const int NumWorkers = std::max(1u, std::thread::hardware_concurrency() / 2);
+	const std::chrono::microseconds DecodeTime(4000);
+	Log::Info("  %d textures, %d workers, %.1fms decode/texture", NumTextures, NumWorkers, DecodeTime.count() / 1000.0);
+	for (int CopyLatencyUs : { 250, 1000, 2000 })
+	{
+		const std::chrono::microseconds CopyLatency(CopyLatencyUs);
+		const double BlockingMs = RunSceneLoad(NumTextures, NumWorkers, DecodeTime, CopyLatency, true);
+		const double AsyncMs = RunSceneLoad(NumTextures, NumWorkers, DecodeTime, CopyLatency, false);
+		Log::Info("  %4.2fms upload/texture : wait for residency per texture=%8.2fms | wait once at the end=%8.2fms"
+			, CopyLatencyUs / 1000.0, BlockingMs, AsyncMs);
+	}
+}
@@ -0,0 +1,248 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/TextureStreaming.h"
+
+#include "Libs/VQUtils/Source/Timer.h"
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+using namespace TextureStreaming;
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+// square, 1 byte per texel, mips of 128 & smaller always resident
+static FTexture CreateTestTexture(uint Size)
+{
+	FTexture Texture;
+	Texture.Width = Texture.Height = Size;
+	Texture.MipCount = static_cast<uint>(std::log2(Size)) + 1;
+	for (uint mip = 0; mip < Texture.MipCount; ++mip)
+	{
+		Texture.MipSizes[mip] = static_cast<uint64>(Size >> mip) * (Size >> mip);
+		if ((Size >> mip) > 128)
+			Texture.MinResidentMip = mip + 1;
+	}
+	Texture.ResidentMip = Texture.DesiredMip = Texture.TargetMip = Texture.MinResidentMip;
+	return Texture;
+}
+
+VQ_TEST(TextureStreaming_DesiredMipFollowsTheScreenSize)
+{
+	const FTexture Texture = CreateTestTexture(1024);
+	VQ_CHECK(Texture.MinResidentMip == 3);
+	VQ_CHECK(GetDesiredMip(Texture, 2048.0f) == 0);
+	VQ_CHECK(GetDesiredMip(Texture, 1024.0f) == 0);
+	VQ_CHECK(GetDesiredMip(Texture, 256.0f) == 2);
+	VQ_CHECK(GetDesiredMip(Texture, 10.0f) == Texture.MinResidentMip);
+	VQ_CHECK(GetDesiredMip(Texture, 0.0f) == Texture.MinResidentMip); // not visible
+}
+
+VQ_TEST(TextureStreaming_ScreenSizeOfTheClosestMesh)
+{
+	FView View;
+	View.CameraPosition = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	View.ProjectionScaleY = 1.0f;
+	View.ViewportHeight = 1000.0f;
+
+	std::vector<FVisibleMesh> Meshes(3);
+	Meshes[0].MaterialIndex = 0; Meshes[0].Center = XMFLOAT3(0.0f, 0.0f, 100.0f); Meshes[0].Radius = 1.0f;
+	Meshes[1].MaterialIndex = 0; Meshes[1].Center = XMFLOAT3(0.0f, 0.0f,  10.0f); Meshes[1].Radius = 1.0f;
+	Meshes[2].MaterialIndex = 2; Meshes[2].Center = XMFLOAT3(0.0f, 0.0f,  10.0f); Meshes[2].Radius = 1.0f; Meshes[2].UVScale = 4.0f;
+
+	std::vector<float> MaterialScreenSizes;
+	ComputeMaterialScreenSizes(View, Meshes, 3, MaterialScreenSizes);
+	VQ_CHECK(MaterialScreenSizes.size() == 3);
+	VQ_CHECK(std::abs(MaterialScreenSizes[0] - 100.0f) < 1e-3f);
+	VQ_CHECK(MaterialScreenSizes[1] == 0.0f);
+	VQ_CHECK(std::abs(MaterialScreenSizes[2] - 400.0f) < 1e-3f);
+}
+
+VQ_TEST(TextureStreaming_StreamsInWithinTheBudget)
+{
+	std::vector<FTexture> Textures = { CreateTestTexture(1024) };
+	Textures[0].DesiredMip = 0;
+	Textures[0].LastVisibleFrame = 1;
+
+	VQ_CHECK(AllocateBudget(Textures, Textures[0].GetSize(0), 1) == Textures[0].GetSize(0));
+	VQ_CHECK(Textures[0].TargetMip == 0);
+
+	// not visible this frame: keeps what it has
+	Textures[0].ResidentMip = 1;
+	VQ_CHECK(AllocateBudget(Textures, Textures[0].GetSize(0), 2) == Textures[0].GetSize(1));
+	VQ_CHECK(Textures[0].TargetMip == 1);
+}
+
+VQ_TEST(TextureStreaming_EvictsTheLeastRecentlyVisibleFirst)
+{
+	constexpr uint64 FRAME = 10;
+	std::vector<FTexture> Textures(3, CreateTestTexture(1024));
+	for (FTexture& Texture : Textures)
+		Texture.ResidentMip = Texture.DesiredMip = 0;
+	Textures[0].LastVisibleFrame = 5;
+	Textures[1].LastVisibleFrame = 8;
+	Textures[2].LastVisibleFrame = FRAME;
+
+	const uint64 Budget = Textures[2].GetSize(0) + Textures[1].GetSize(0) + Textures[0].GetSize(Textures[0].MinResidentMip);
+	VQ_CHECK(AllocateBudget(Textures, Budget, FRAME) == Budget);
+	VQ_CHECK(Textures[0].TargetMip == Textures[0].MinResidentMip);
+	VQ_CHECK(Textures[1].TargetMip == 0);
+	VQ_CHECK(Textures[2].TargetMip == 0);
+}
+
+VQ_TEST(TextureStreaming_DropsTheMostOversampledVisibleMipsFirst)
+{
+	constexpr uint64 FRAME = 1;
+	std::vector<FTexture> Textures(2, CreateTestTexture(1024));
+	for (FTexture& Texture : Textures)
+	{
+		Texture.ResidentMip = Texture.MinResidentMip;
+		Texture.DesiredMip = 0;
+		Texture.LastVisibleFrame = FRAME;
+	}
+	Textures[0].ScreenSize = 1024.0f; // 1 texel per pixel
+	Textures[1].ScreenSize = 2048.0f; // magnified
+
+	const uint64 Budget = Textures[0].GetSize(0) + Textures[1].GetSize(0) - Textures[0].MipSizes[0];
+	VQ_CHECK(AllocateBudget(Textures, Budget, FRAME) <= Budget);
+	VQ_CHECK(Textures[0].TargetMip == 1);
+	VQ_CHECK(Textures[1].TargetMip == 0);
+
+	// nothing left to drop: the mip tails stay
+	const uint64 MipTailsSize = Textures[0].GetSize(Textures[0].MinResidentMip) * 2;
+	VQ_CHECK(AllocateBudget(Textures, 0, FRAME) == MipTailsSize);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// synthetic scene w/ NumMaterials materials (3 textures each) and a moving camera, logs the timings
+static void BenchmarkTextureStreaming(uint NumMaterials, uint NumFrames)
+{
+	constexpr uint   NUM_TEXTURES_PER_MATERIAL = 3; // albedo (BC1), normals (BC5), roughness/metalness (BC1)
+	constexpr uint   MIP_TAIL_SIZE = 128;
+	constexpr uint64 BUDGET_BYTES = 1024ull << 20;
+	constexpr float  SCENE_SIZE = 2000.0f;
+	constexpr float  VIEW_DISTANCE = 1000.0f;
+	constexpr float  VIEWPORT_HEIGHT = 1080.0f;
+	const     float  PROJECTION_SCALE_Y = 1.0f / std::tan(XM_PIDIV4 * 0.5f);
+
+	Log::Info("  %u materials, %u textures, %u frames, %lluMB budget"
+		, NumMaterials, NumMaterials * NUM_TEXTURES_PER_MATERIAL, NumFrames, BUDGET_BYTES >> 20);
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<uint> distTextureSize(9, 12); // 512 - 4096
+	std::uniform_real_distribution<float> distPosition(-SCENE_SIZE * 0.5f, SCENE_SIZE * 0.5f);
+	std::uniform_real_distribution<float> distRadius(0.5f, 20.0f);
+	std::uniform_int_distribution<uint> distUVScale(0, 2);
+
+	std::vector<FTexture> Textures(NumMaterials * NUM_TEXTURES_PER_MATERIAL);
+	std::vector<FMaterialTextureRef> MaterialTextureRefs;
+	for (uint i = 0; i < Textures.size(); ++i)
+	{
+		FTexture& Texture = Textures[i];
+		const uint64 BlockSize = (i % NUM_TEXTURES_PER_MATERIAL) == 1 ? 16 : 8;
+		Texture.Width = Texture.Height = 1u << distTextureSize(rng);
+		Texture.MipCount = static_cast<uint>(std::log2(Texture.Width)) + 1;
+		for (uint mip = 0; mip < Texture.MipCount; ++mip)
+		{
+			const uint64 NumBlocks = std::max(1u, (Texture.Width >> mip) / 4);
+			Texture.MipSizes[mip] = NumBlocks * NumBlocks * BlockSize;
+			if ((Texture.Width >> mip) > MIP_TAIL_SIZE)
+				Texture.MinResidentMip = mip + 1;
+		}
+		Texture.ResidentMip = Texture.DesiredMip = Texture.TargetMip = Texture.MinResidentMip;
+		MaterialTextureRefs.push_back({ i / NUM_TEXTURES_PER_MATERIAL, i });
+	}
+
+	std::vector<FVisibleMesh> Meshes(NumMaterials * 2);
+	for (uint i = 0; i < Meshes.size(); ++i)
+	{
+		Meshes[i].MaterialIndex = i % NumMaterials;
+		Meshes[i].Center = XMFLOAT3(distPosition(rng), distPosition(rng) * 0.05f, distPosition(rng));
+		Meshes[i].Radius = distRadius(rng);
+		Meshes[i].UVScale = static_cast<float>(1u << distUVScale(rng));
+	}
+
+	double TimeScreenSizes = 0.0, TimePriorities = 0.0, TimeBudget = 0.0, TimeMax = 0.0;
+	uint64 NumVisibleMeshes = 0, NumTextureChanges = 0, TargetBytes = 0;
+	std::vector<FVisibleMesh> VisibleMeshes;
+	std::vector<float> MaterialScreenSizes;
+	Timer t; t.Start();
+	for (uint64 Frame = 1; Frame <= NumFrames; ++Frame)
+	{
+		// camera circles the scene looking at the center, the visibility stands in for the culling
+		const float Angle = XM_2PI * Frame / NumFrames;
+		FView View;
+		View.CameraPosition = XMFLOAT3(std::cos(Angle) * SCENE_SIZE * 0.4f, 10.0f, std::sin(Angle) * SCENE_SIZE * 0.4f);
+		View.ProjectionScaleY = PROJECTION_SCALE_Y;
+		View.ViewportHeight = VIEWPORT_HEIGHT;
+		const XMFLOAT3 LookDir(-std::cos(Angle), 0.0f, -std::sin(Angle));
+
+		VisibleMeshes.clear();
+		for (const FVisibleMesh& Mesh : Meshes)
+		{
+			const float dx = Mesh.Center.x - View.CameraPosition.x;
+			const float dz = Mesh.Center.z - View.CameraPosition.z;
+			const float Distance = std::sqrt(dx * dx + dz * dz);
+			if (Distance < VIEW_DISTANCE && (dx * LookDir.x + dz * LookDir.z) > 0.7f * Distance)
+				VisibleMeshes.push_back(Mesh);
+		}
+		NumVisibleMeshes += VisibleMeshes.size();
+		t.StopGetDeltaTimeAndReset();
+
+		ComputeMaterialScreenSizes(View, VisibleMeshes, NumMaterials, MaterialScreenSizes);
+		const double dt0 = t.StopGetDeltaTimeAndReset();
+		UpdateTexturePriorities(Textures, MaterialTextureRefs, MaterialScreenSizes, Frame);
+		const double dt1 = t.StopGetDeltaTimeAndReset();
+		TargetBytes += AllocateBudget(Textures, BUDGET_BYTES, Frame);
+		const double dt2 = t.StopGetDeltaTimeAndReset();
+
+		TimeScreenSizes += dt0;
+		TimePriorities  += dt1;
+		TimeBudget      += dt2;
+		TimeMax = std::max(TimeMax, dt0 + dt1 + dt2);
+
+		// textures are streamed instantly
+		for (FTexture& Texture : Textures)
+		{
+			NumTextureChanges += Texture.TargetMip != Texture.ResidentMip ? 1 : 0;
+			Texture.ResidentMip = Texture.TargetMip;
+		}
+	}
+
+	const double ToMsAvg = 1000.0 / NumFrames;
+	Log::Info("  avg %.3fms (screen sizes %.3fms, priorities %.3fms, budget %.3fms), max %.3fms per frame"
+		, (TimeScreenSizes + TimePriorities + TimeBudget) * ToMsAvg, TimeScreenSizes * ToMsAvg, TimePriorities * ToMsAvg, TimeBudget * ToMsAvg, TimeMax * 1000.0);
+	Log::Info("  avg %llu visible meshes, %llu texture changes, %lluMB targeted per frame"
+		, NumVisibleMeshes / NumFrames, NumTextureChanges / NumFrames, (TargetBytes / NumFrames) >> 20);
+}
+}
+
+VQ_BENCHMARK(TextureStreaming)
+{
+	BenchmarkTextureStreaming(10000, 1000);
+}
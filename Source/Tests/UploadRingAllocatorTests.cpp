@@ -0,0 +1,316 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Renderer/ResourceHeaps.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Tracks the allocations handed out by the ring & the fence value of the batch they're submitted in,
+// an allocation is live until the fence completes its batch. New allocations shouldn't overlap live ones.
+struct FRingChecker
+{
+	struct FAllocation
+	{
+		SIZE_T Offset = 0;
+		SIZE_T Size = 0;
+		UINT64 FenceValue = 0; // 0: current batch, not submitted yet
+	};
+
+	UploadRingAllocator  Ring;
+	IUploadFence*        pFence = nullptr;
+	std::vector<FAllocation> Allocations;
+
+	FRingChecker(IUploadFence* pFence_, SIZE_T RingSize, uint32 MaxInFlightBatches) : pFence(pFence_) { Ring.Initialize(RingSize, MaxInFlightBatches, pFence); }
+
+	bool Allocate(SIZE_T Size, SIZE_T Align, SIZE_T* pOutOffset = nullptr)
+	{
+		SIZE_T Offset = 0;
+		if (!Ring.Allocate(Size, Align, Offset))
+			return false;
+
+		VQ_CHECK(Offset % Align == 0);
+		VQ_CHECK(Offset + Size <= Ring.GetSize());
+		const UINT64 CompletedValue = pFence->GetCompletedValue();
+		for (const FAllocation& a : Allocations)
+		{
+			const bool bLive = a.FenceValue == 0 || a.FenceValue > CompletedValue;
+			const bool bOverlaps = Offset < a.Offset + a.Size && a.Offset < Offset + Size;
+			VQ_CHECK(!(bLive && bOverlaps));
+		}
+		Allocations.push_back({ Offset, Size, 0 });
+		if (pOutOffset)
+			*pOutOffset = Offset;
+		return true;
+	}
+
+	UINT64 Submit()
+	{
+		const UINT64 FenceValue = Ring.SubmitBatch();
+		for (FAllocation& a : Allocations)
+			if (a.FenceValue == 0)
+				a.FenceValue = FenceValue;
+
+		const UINT64 CompletedValue = pFence->GetCompletedValue();
+		Allocations.erase(std::remove_if(Allocations.begin(), Allocations.end(), [=](const FAllocation& a) { return a.FenceValue != 0 && a.FenceValue <= CompletedValue; }), Allocations.end());
+		return FenceValue;
+	}
+
+	// same as UploadHeap::Suballocate(): flush the current batch or wait on the oldest one until the allocation fits
+	SIZE_T Suballocate(SIZE_T Size, SIZE_T Align)
+	{
+		SIZE_T Offset = 0;
+		while (!Allocate(Size, Align, &Offset))
+		{
+			if (!Ring.IsCurrentBatchEmpty())
+			{
+				Submit();
+				Ring.RetireCompletedBatches();
+			}
+			else if (!Ring.WaitForOldestBatch())
+			{
+				VQ_CHECK(false); // an empty ring should fit any allocation smaller than the ring
+				return 0;
+			}
+		}
+		return Offset;
+	}
+};
+
+// Stands in for the copy queue: a thread completes the signaled fence values in order,
+// spending BatchCopyTime on each, while the CPU keeps filling the ring.
+class UploadFence_FakeGPU : public IUploadFence
+{
+public:
+	UploadFence_FakeGPU(std::chrono::microseconds BatchCopyTime) : mBatchCopyTime(BatchCopyTime), mThread([this]() { GPU_Main(); }) {}
+	~UploadFence_FakeGPU()
+	{
+		{
+			std::lock_guard<std::mutex> lk(mMtx);
+			mbExit = true;
+		}
+		mCV.notify_all();
+		mThread.join();
+	}
+
+	UINT64 Signal() override
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		++mLastSignaledValue;
+		mCV.notify_all();
+		return mLastSignaledValue;
+	}
+	UINT64 GetCompletedValue() const override { std::lock_guard<std::mutex> lk(mMtx); return mCompletedValue; }
+	void   WaitForValue(UINT64 Value) override
+	{
+		std::unique_lock<std::mutex> lk(mMtx);
+		mCV.wait(lk, [&]() { return mCompletedValue >= Value; });
+	}
+
+private:
+	void GPU_Main()
+	{
+		std::unique_lock<std::mutex> lk(mMtx);
+		while (true)
+		{
+			mCV.wait(lk, [&]() { return mbExit || mCompletedValue < mLastSignaledValue; });
+			if (mbExit)
+				return;
+			lk.unlock();
+			std::this_thread::sleep_for(mBatchCopyTime);
+			lk.lock();
+			++mCompletedValue;
+			mCV.notify_all();
+		}
+	}
+
+	std::chrono::microseconds mBatchCopyTime;
+	mutable std::mutex        mMtx;
+	std::condition_variable   mCV;
+	UINT64                    mLastSignaledValue = 0;
+	UINT64                    mCompletedValue = 0;
+	bool                      mbExit = false;
+	std::thread               mThread;
+};
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(UploadRingAllocator_OversizedAllocationFails)
+{
+	UploadFence_CPU Fence;
+	FRingChecker Checker(&Fence, 1024, 3);
+	VQ_CHECK(!Checker.Allocate(1025, 1));
+	VQ_CHECK(Checker.Allocate(1024, 1));
+	VQ_CHECK(!Checker.Allocate(1, 1)); // full
+}
+
+VQ_TEST(UploadRingAllocator_EmptySubmitsArentInFlight)
+{
+	UploadFence_CPU Fence(100); // the GPU never catches up on its own
+	FRingChecker Checker(&Fence, 1024, 3);
+	VQ_CHECK(Checker.Allocate(100, 1));
+	const UINT64 FenceValue = Checker.Submit();
+	VQ_CHECK(Checker.Ring.GetNumInFlightBatches() == 1);
+
+	// e.g. the buffer uploads that don't use the ring: they get a fence value but don't take up a batch slot,
+	// so they don't force a wait on the batches in flight either
+	for (int i = 0; i < 8; ++i)
+	{
+		VQ_CHECK(Checker.Submit() > FenceValue);
+		VQ_CHECK(Checker.Ring.GetNumInFlightBatches() == 1);
+	}
+	VQ_CHECK(Fence.GetCompletedValue() == 0);
+	VQ_CHECK(Checker.Ring.GetUsedSize() == 100);
+}
+
+VQ_TEST(UploadRingAllocator_DoesntRewindUnderTheBatchesInFlight)
+{
+	// An empty submit between two batches used to leave a zero-sized batch in flight: the ring rewound to 0
+	// once the used size dropped to 0, and the stale end offset of the empty batch moved the tail into the
+	// allocations made after the rewind when it retired.
+	UploadFence_CPU Fence(100);
+	FRingChecker Checker(&Fence, 1000, 3);
+	SIZE_T Offset = 0;
+	VQ_CHECK(Checker.Allocate(100, 1, &Offset) && Offset == 0);
+	Checker.Submit();
+	Checker.Submit(); // empty
+	VQ_CHECK(Checker.Ring.WaitForOldestBatch());
+	VQ_CHECK(Checker.Ring.GetUsedSize() == 0);
+
+	VQ_CHECK(Checker.Allocate(200, 1, &Offset) && Offset == 0); // nothing in flight: rewinds
+	Checker.Submit();
+	VQ_CHECK(Checker.Ring.WaitForOldestBatch());
+	VQ_CHECK(Checker.Allocate(700, 1));
+	VQ_CHECK(Checker.Allocate(100, 1));
+	Checker.Allocate(50, 1); // overlaps the 200 bytes if they're still in flight
+}
+
+VQ_TEST(UploadRingAllocator_WrapAroundPadsTheRemainder)
+{
+	UploadFence_CPU Fence(100);
+	FRingChecker Checker(&Fence, 1000, 3);
+	VQ_CHECK(Checker.Allocate(400, 1));
+	Checker.Submit();
+	VQ_CHECK(Checker.Allocate(400, 1));
+	Checker.Submit();
+	VQ_CHECK(Checker.Ring.WaitForOldestBatch()); // tail: 400
+
+	SIZE_T Offset = 0;
+	VQ_CHECK(!Checker.Allocate(500, 1)); // neither fits in [800, 1000) nor [0, 400)
+	VQ_CHECK(Checker.Allocate(300, 1, &Offset) && Offset == 0);
+	VQ_CHECK(Checker.Ring.GetUsedSize() == 400 + 200 + 300); // the 2nd batch, the padding & the new allocation
+
+	Checker.Submit();
+	Checker.Ring.WaitForAllBatches();
+	VQ_CHECK(Checker.Ring.GetUsedSize() == 0);
+	VQ_CHECK(Checker.Ring.GetNumInFlightBatches() == 0);
+}
+
+VQ_TEST(UploadRingAllocator_RandomizedAllocations)
+{
+	std::mt19937 Rng(1234);
+	const SIZE_T Aligns[] = { 1, 16, 256, 512 };
+	for (UINT64 Latency = 0; Latency < 4; ++Latency)
+	{
+		UploadFence_CPU Fence(Latency);
+		FRingChecker Checker(&Fence, 4096, 3);
+		for (int i = 0; i < 20000; ++i)
+		{
+			const SIZE_T Size = 1 + Rng() % 1500;
+			Checker.Suballocate(Size, Aligns[Rng() % 4]);
+			VQ_CHECK(Checker.Ring.GetUsedSize() <= Checker.Ring.GetSize());
+			VQ_CHECK(Checker.Ring.GetNumInFlightBatches() <= Checker.Ring.GetMaxInFlightBatches());
+
+			switch (Rng() % 8)
+			{
+			case 0: Checker.Submit(); Checker.Submit(); break; // w/ an empty batch
+			case 1: Checker.Submit(); break;
+			case 2: Checker.Ring.RetireCompletedBatches(); break;
+			case 3: Checker.Ring.WaitForOldestBatch(); break;
+			default: break;
+			}
+		}
+		Checker.Submit();
+		Checker.Ring.WaitForAllBatches();
+		VQ_CHECK(Checker.Ring.GetUsedSize() == 0);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Copies NumTextures x TextureSize bytes into a 32MB staging ring & submits a batch per texture while a fake copy
+// queue takes BatchCopyTime per batch. MaxInFlightBatches=1 & waiting after each submit is the synchronous upload.
+static double RunUploadBenchmark(uint NumTextures, SIZE_T TextureSize, std::chrono::microseconds BatchCopyTime, uint32 MaxInFlightBatches, bool bWaitAfterSubmit)
+{
+	constexpr SIZE_T RING_SIZE = 32 * 1024 * 1024;
+	std::vector<UINT8> Heap(RING_SIZE);
+	std::vector<UINT8> Texture(TextureSize, 0xAB);
+
+	UploadFence_FakeGPU Fence(BatchCopyTime);
+	UploadRingAllocator Ring;
+	Ring.Initialize(RING_SIZE, MaxInFlightBatches, &Fence);
+
+	using Clock = std::chrono::high_resolution_clock;
+	const Clock::time_point Begin = Clock::now();
+	for (uint i = 0; i < NumTextures; ++i)
+	{
+		SIZE_T Offset = 0;
+		while (!Ring.Allocate(TextureSize, 512, Offset))
+		{
+			if (!Ring.IsCurrentBatchEmpty())
+				Ring.SubmitBatch();
+			else
+				Ring.WaitForOldestBatch();
+		}
+		memcpy(Heap.data() + Offset, Texture.data(), TextureSize);
+
+		const UINT64 FenceValue = Ring.SubmitBatch();
+		if (bWaitAfterSubmit)
+			Fence.WaitForValue(FenceValue);
+		Ring.RetireCompletedBatches();
+	}
+	Ring.WaitForAllBatches();
+	return std::chrono::duration<double, std::milli>(Clock::now() - Begin).count();
+}
+
+VQ_BENCHMARK(UploadRing)
+{
+	const uint   NumTextures = 64;
+	const SIZE_T TextureSize = 4 * 1024 * 1024; // 1k x 1k RGBA8
+	for (int CopyTimeUs : { 0, 1000, 4000 })
+	{
+		const std::chrono::microseconds BatchCopyTime(CopyTimeUs);
+		const double SyncMs      = RunUploadBenchmark(NumTextures, TextureSize, BatchCopyTime, 1, true);
+		const double PipelinedMs = RunUploadBenchmark(NumTextures, TextureSize, BatchCopyTime, UploadHeap::NUM_IN_FLIGHT_BATCHES, false);
+		Log::Info("  %u x %lluMB, %4.1fms GPU copy/batch : wait after each submit=%8.2fms | %u batches in flight=%8.2fms"
+			, NumTextures, TextureSize >> 20, CopyTimeUs / 1000.0, SyncMs, UploadHeap::NUM_IN_FLIGHT_BATCHES, PipelinedMs);
+	}
+}
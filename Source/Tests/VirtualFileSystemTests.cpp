@@ -0,0 +1,176 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+
+#include "Tests.h"
+
+#include "Source/Engine/Core/VirtualFileSystem.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+static void WriteTestFile(const std::string& FilePath, const std::vector<uint8>& Data)
+{
+	std::ofstream File(FilePath, std::ios::binary);
+	File.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+}
+
+static bool ReadLooseTestFile(const std::string& FilePath, std::vector<uint8>& OutData)
+{
+	std::ifstream File(FilePath, std::ios::binary | std::ios::ate);
+	if (!File.is_open())
+		return false;
+	OutData.resize(static_cast<size_t>(File.tellg()));
+	File.seekg(0, std::ios::beg);
+	File.read(reinterpret_cast<char*>(OutData.data()), OutData.size());
+	return File.good() || File.eof();
+}
+
+static bool HasContents(const FFileData& Data, const std::vector<uint8>& Expected)
+{
+	return Data.IsValid() && Data.Size == Expected.size() && memcmp(Data.pData, Expected.data(), Expected.size()) == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// TESTS
+//----------------------------------------------------------------------------------------------------------------
+VQ_TEST(VirtualFileSystem_NormalizePath)
+{
+	VQ_CHECK(VirtualFileSystem::NormalizePath("Data\\Textures/./Brick.PNG") == "data/textures/brick.png");
+	VQ_CHECK(VirtualFileSystem::NormalizePath("Data/Models/../Textures//Brick.png") == "data/textures/brick.png");
+	VQ_CHECK(VirtualFileSystem::NormalizePath("../Data/x.bin") == "../data/x.bin");
+	VQ_CHECK(VirtualFileSystem::NormalizePath("./") == "");
+}
+
+VQ_TEST(VirtualFileSystem_PakFileRoundTrip)
+{
+	const std::string Directory = Tests::CreateTempDirectory("PakFile");
+	const std::string DataDirectory = Directory + "Data/";
+	std::filesystem::create_directories(DataDirectory + "Sub");
+
+	// compressible, incompressible & a file added after packing
+	std::vector<uint8> Text(256 * 1024);
+	for (size_t i = 0; i < Text.size(); ++i)
+		Text[i] = static_cast<uint8>("VQE pak file test "[i % 18]);
+	std::vector<uint8> Noise(100 * 1000 + 7);
+	std::mt19937 rng(42);
+	for (uint8& Byte : Noise)
+		Byte = static_cast<uint8>(rng());
+	const std::vector<uint8> Loose = { 1, 2, 3 };
+
+	WriteTestFile(DataDirectory + "Text.txt", Text);
+	WriteTestFile(DataDirectory + "Sub/Noise.bin", Noise);
+	const std::string PakFilePath = Directory + "Test.pak";
+	VQ_CHECK(VirtualFileSystem::BuildPakFile(PakFilePath, DataDirectory));
+	WriteTestFile(DataDirectory + "Loose.bin", Loose);
+
+	VQ_CHECK(VirtualFileSystem::MountPakFile(PakFilePath));
+	VQ_CHECK(VirtualFileSystem::IsAnyPakFileMounted());
+
+	VQ_CHECK(VirtualFileSystem::IsPacked(DataDirectory + "Text.txt"));
+	VQ_CHECK(VirtualFileSystem::IsPacked(DataDirectory + "SUB\\.\\Noise.bin"));
+	VQ_CHECK(!VirtualFileSystem::IsPacked(DataDirectory + "Loose.bin"));
+	VQ_CHECK(HasContents(VirtualFileSystem::ReadFile(DataDirectory + "Text.txt"), Text));
+	VQ_CHECK(HasContents(VirtualFileSystem::ReadFile(DataDirectory + "Sub/Noise.bin"), Noise));
+	VQ_CHECK(HasContents(VirtualFileSystem::ReadFile(DataDirectory + "Loose.bin"), Loose)); // loose fallback
+	VQ_CHECK(VirtualFileSystem::FileExists(DataDirectory + "Loose.bin"));
+	VQ_CHECK(!VirtualFileSystem::FileExists(DataDirectory + "Missing.bin"));
+	VQ_CHECK(!VirtualFileSystem::ReadFile(DataDirectory + "Missing.bin").IsValid());
+
+	// the packed entries are read from the pak, not from the loose files
+	WriteTestFile(DataDirectory + "Text.txt", Loose);
+	VQ_CHECK(HasContents(VirtualFileSystem::ReadFile(DataDirectory + "Text.txt"), Text));
+
+	VirtualFileSystem::UnmountAll();
+	VQ_CHECK(!VirtualFileSystem::IsAnyPakFileMounted());
+	VQ_CHECK(HasContents(VirtualFileSystem::ReadFile(DataDirectory + "Text.txt"), Loose));
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// BENCHMARKS
+//----------------------------------------------------------------------------------------------------------------
+// Reads every file under Data/ twice: loose (std::ifstream) and packed through Data.pak, which is built if it
+// doesn't exist, logs cold (first pass) & warm timings. 'Cold' is the first read since process start, the OS
+// file cache may still be warm from an earlier run.
+VQ_BENCHMARK(PakFile)
+{
+	const std::string PakFilePath = "Data.pak";
+	if (!std::filesystem::exists(PakFilePath) && !VirtualFileSystem::BuildPakFile(PakFilePath, "Data/"))
+		return;
+	if (!VirtualFileSystem::MountPakFile(PakFilePath))
+		return;
+
+	std::vector<std::string> Files;
+	std::error_code ec;
+	for (const std::filesystem::directory_entry& Entry : std::filesystem::recursive_directory_iterator("Data", ec))
+	{
+		if (Entry.is_regular_file() && VirtualFileSystem::IsPacked(Entry.path().generic_string()))
+			Files.push_back(Entry.path().generic_string());
+	}
+
+	// touch every byte so the mapped pages are actually read in
+	auto fnChecksum = [](const uint8* pData, size_t Size)
+	{
+		uint64 Sum = 0;
+		for (size_t i = 0; i < Size; ++i) Sum += pData[i];
+		return Sum;
+	};
+	auto fnReadLoose = [&]()
+	{
+		uint64 Sum = 0;
+		std::vector<uint8> Data;
+		for (const std::string& FilePath : Files)
+		{
+			if (ReadLooseTestFile(FilePath, Data))
+				Sum += fnChecksum(Data.data(), Data.size());
+		}
+		return Sum;
+	};
+	auto fnReadPacked = [&]()
+	{
+		uint64 Sum = 0;
+		for (const std::string& FilePath : Files)
+		{
+			const FFileData Data = VirtualFileSystem::ReadFile(FilePath);
+			if (Data.IsValid())
+				Sum += fnChecksum(Data.pData, Data.Size);
+		}
+		return Sum;
+	};
+
+	Timer t; t.Start();
+	const uint64 SumLooseCold  = fnReadLoose();  const float fLooseCold  = t.StopGetDeltaTimeAndReset(); t.Start();
+	const uint64 SumLooseWarm  = fnReadLoose();  const float fLooseWarm  = t.StopGetDeltaTimeAndReset(); t.Start();
+	const uint64 SumPackedCold = fnReadPacked(); const float fPackedCold = t.StopGetDeltaTimeAndReset(); t.Start();
+	const uint64 SumPackedWarm = fnReadPacked(); const float fPackedWarm = t.StopGetDeltaTimeAndReset();
+	VirtualFileSystem::UnmountAll();
+
+	if (SumLooseCold != SumPackedCold || SumLooseWarm != SumPackedWarm)
+	{
+		Log::Warning("  loose files and %s contents differ, the pak file may be out of date", PakFilePath.c_str());
+	}
+	Log::Info("  %s (%zu packed files)", PakFilePath.c_str(), Files.size());
+	Log::Info("  Loose  : cold=%.3fs warm=%.3fs", fLooseCold, fLooseWarm);
+	Log::Info("  Packed : cold=%.3fs warm=%.3fs", fPackedCold, fPackedWarm);
+}